@@ -21,6 +21,8 @@
 #include "itkImageToImageMetric.h"
 
 #include "itkImageSamplerBase.h"
+#include "itkImageFullSampler.h"
+#include "itkImageGridSampler.h"
 #include "itkGradientImageFilter.h"
 #include "itkBSplineInterpolateImageFunction.h"
 #include "itkReducedDimensionBSplineInterpolateImageFunction.h"
@@ -29,11 +31,20 @@
 #include "itkFixedArray.h"
 #include "itkAdvancedTransform.h"
 #include "vnl/vnl_sparse_matrix.h"
+#include "itkCompressedSparseRowMatrix.h"
+#include "itkThreadScratchArena.h"
+#ifdef ELASTIX_USE_OPENCL
+#include "itkGPUAdvancedImageToImageMetricEvaluator.h"
+#endif
 
 // Needed for checking for B-spline for faster implementation
 #include "itkAdvancedBSplineDeformableTransform.h"
 #include "itkAdvancedCombinationTransform.h"
 
+// Needed for the compile-time specialized kernels
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkRecursiveBSplineTransform.h"
+
 #include "itkMultiThreader.h"
 
 namespace itk
@@ -64,6 +75,35 @@ namespace itk
  *   unless you have a good reason for it...
  * \li Some convenience functions are provided, such as the IsInsideMovingMask
  *   and CheckNumberOfSamples.
+ * \li Compile-time specialized kernels. The hot loops of the metrics are written
+ *   as member function templates, parameterized by a sample evaluator. Once per
+ *   resolution, SelectFastPathKernel() checks if the transform and interpolator
+ *   are of a type for which an evaluator exists, that calls them without virtual
+ *   dispatch. Otherwise the GenericSampleEvaluator is used, which calls the virtual
+ *   functions of this class. See itkAdvancedImageToImageMetricDispatchKernelMacro.
+ * \li Single precision accumulation. With UseSinglePrecisionAccumulation the
+ *   threads accumulate their part of the derivative in float, and the per-thread
+ *   derivatives are summed in double in AccumulateDerivativesThreaderCallback().
+ *   The transform Jacobians, the final derivative and the parameters remain double.
+ *   This halves the memory traffic of the accumulation, which dominates for
+ *   transforms with many parameters. Only metrics that override
+ *   GetSupportsSinglePrecisionAccumulation() use it: currently AdvancedMeanSquares
+ *   and the low-memory derivative of ParzenWindowMutualInformation. There are no
+ *   float Jacobians and no float optimizer.
+ * \li Deterministic reduction. With UseDeterministicReduction the threaded loops
+ *   divide the samples over NumberOfDeterministicWorkUnits work units, independent
+ *   of the number of threads. The per-work-unit derivatives are summed pairwise
+ *   by PairwiseSum(). The results then do not depend on the number of threads.
+ *   With fewer samples than work units, only the nonempty work units are used
+ *   and have a derivative, see InitializeDeterministicWorkUnits(). Only metrics
+ *   that override GetSupportsDeterministicReduction() use it. The self Hessian
+ *   does not need it: each entry receives its terms in the order of the
+ *   samples, see LaunchGetSelfHessianThreaderCallback().
+ * \li OpenCL evaluation. With UseOpenCL, and when elastix is compiled with
+ *   OpenCL, the sample loops of metrics that override GetSupportsOpenCL() are
+ *   evaluated by the GPUAdvancedImageToImageMetricEvaluator. SelectOpenCLEvaluator()
+ *   checks if the transform, interpolator and masks allow it; otherwise the CPU
+ *   is used.
  *
  * The parameters used in this class are:
  * \parameter MovingImageDerivativeScales: scale the moving image derivatives. Use\n
@@ -139,6 +179,7 @@ public:
   typedef typename ImageSamplerType::Pointer                      ImageSamplerPointer;
   typedef typename ImageSamplerType::OutputVectorContainerType    ImageSampleContainerType;
   typedef typename ImageSamplerType::OutputVectorContainerPointer ImageSampleContainerPointer;
+  typedef typename ImageSamplerType::RandomGeneratorType          RandomGeneratorType;
 
   /** Typedefs for Limiter support. */
   typedef LimiterFunctionBase< RealType, FixedImageDimension >  FixedImageLimiterType;
@@ -164,8 +205,9 @@ public:
   typedef typename BSplineOrder3TransformType::Pointer                             BSplineOrder3TransformPointer;
 
   /** Hessian type; for SelfHessian (experimental feature) */
-  typedef typename DerivativeType::ValueType    HessianValueType;
-  typedef vnl_sparse_matrix< HessianValueType > HessianType;
+  typedef typename DerivativeType::ValueType            HessianValueType;
+  typedef vnl_sparse_matrix< HessianValueType >         HessianType;
+  typedef CompressedSparseRowMatrix< HessianValueType > CSRHessianType;
 
   /** Typedefs for multi-threading. */
   typedef itk::MultiThreader                      ThreaderType;
@@ -200,6 +242,14 @@ public:
   }
 
 
+  /** Set/Get the random number generator of the metrics that draw random
+   * numbers themselves. Default: the global instance of the
+   * MersenneTwisterRandomVariateGenerator. Registrations that run at the
+   * same time each set their own generator.
+   */
+  itkSetObjectMacro( RandomGenerator, RandomGeneratorType );
+  itkGetObjectMacro( RandomGenerator, RandomGeneratorType );
+
   /** Inheriting classes can specify whether they use the image sampler functionality;
    * This method allows the user to inspect this setting. */
   itkGetConstMacro( UseImageSampler, bool );
@@ -264,6 +314,15 @@ public:
    */
   virtual void GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const;
 
+  /** Experimental feature: compute SelfHessian in compressed sparse row format.
+   * Only the upper triangular part is stored. The sparsity pattern of H is
+   * set by InitializeSelfHessianPattern(). Metrics that override this function
+   * can assemble H multi-threaded, see ThreadedGetSelfHessian().
+   * This base class just returns an identity matrix of the right size.
+   */
+  virtual void GetCompressedSelfHessian( const TransformParametersType & parameters,
+    CSRHessianType & H ) const;
+
   /** Set number of threads to use for computations. */
   virtual void SetNumberOfThreads( ThreadIdType numberOfThreads );
 
@@ -286,6 +345,86 @@ public:
   virtual void BeforeThreadedGetValueAndDerivative(
     const TransformParametersType & parameters ) const;
 
+  /** Whether the compile-time specialized kernels may be used in the hot loops,
+   * when the transform and interpolator allow it. Default true.
+   */
+  itkSetMacro( UseFastPathKernels, bool );
+  itkGetConstMacro( UseFastPathKernels, bool );
+  itkBooleanMacro( UseFastPathKernels );
+
+  /** Whether Initialize() selected a compile-time specialized kernel. */
+  bool GetUsesFastPathKernel( void ) const
+  { return this->m_FastPathKernel != GenericKernel; }
+
+  /** Whether the threads may accumulate the derivative in single precision.
+   * Only used by metrics that support it, and only when multi-threading.
+   * Default false.
+   */
+  itkSetMacro( UseSinglePrecisionAccumulation, bool );
+  itkGetConstMacro( UseSinglePrecisionAccumulation, bool );
+  itkBooleanMacro( UseSinglePrecisionAccumulation );
+
+  /** The maximum number of work units with deterministic reduction. */
+  itkStaticConstMacro( MaximumNumberOfDeterministicWorkUnits, unsigned int, 256 );
+
+  /** Whether the threaded loops divide the samples over a fixed number of
+   * work units instead of over the threads, and reduce the results of the
+   * work units in a fixed order. The value and derivative then do not depend
+   * on the number of threads. Only used by metrics that support it, and only
+   * when multi-threading. Default false.
+   */
+  itkSetMacro( UseDeterministicReduction, bool );
+  itkGetConstMacro( UseDeterministicReduction, bool );
+  itkBooleanMacro( UseDeterministicReduction );
+
+  /** The maximum number of work units with deterministic reduction. Each used
+   * work unit has its own derivative, so the memory use is proportional to it.
+   * Default 16.
+   */
+  itkSetClampMacro( NumberOfDeterministicWorkUnits, ThreadIdType,
+    1, MaximumNumberOfDeterministicWorkUnits );
+  itkGetConstMacro( NumberOfDeterministicWorkUnits, ThreadIdType );
+
+  /** Whether the B-spline weights may be tabulated for samples on the voxel
+   * lattice of the fixed image, see ComputeBSplineWeightTables(). Default false.
+   */
+  itkSetMacro( UseBSplineWeightTables, bool );
+  itkGetConstMacro( UseBSplineWeightTables, bool );
+  itkBooleanMacro( UseBSplineWeightTables );
+
+  /** Whether the sample loops may be evaluated on an OpenCL device. Only used
+   * by metrics that support it, and only when elastix is compiled with OpenCL.
+   * Default false.
+   */
+  itkSetMacro( UseOpenCL, bool );
+  itkGetConstMacro( UseOpenCL, bool );
+  itkBooleanMacro( UseOpenCL );
+
+  /** Whether the OpenCL evaluator was selected by the last Initialize(). */
+  itkGetConstMacro( UseOpenCLEvaluator, bool );
+
+  /** Whether the transform, or the current transform of a combination
+   * transform, is a B-spline transform. Set by Initialize().
+   */
+  itkGetConstMacro( TransformIsBSpline, bool );
+
+  /** Whether GetValueAndDerivative() may run concurrently with that of other
+   * metrics sharing the same transform and image sampler. The contract is:
+   * \li The metric changes shared objects (the transform parameters, the image
+   *   sampler output) only in BeforeThreadedGetValueAndDerivative(). The
+   *   CombinationImageToImageMetric calls that function once for all concurrent
+   *   metrics, before it starts them, and switches it off while they run.
+   * \li All other state that GetValueAndDerivative() writes belongs to the metric
+   *   itself, such as its per-thread variables.
+   * \li The threaded loops use only the threads of the metric's own threader,
+   *   or OpenMP with an explicit num_threads clause.
+   * The multi-threaded code paths of metrics satisfy this when they do not
+   * update the sampler in the threaded part; such metrics return
+   * m_UseMultiThread. Default false.
+   */
+  virtual bool GetSupportsConcurrentGetValueAndDerivative( void ) const
+  { return false; }
+
 protected:
 
   /** Constructor. */
@@ -329,6 +468,208 @@ protected:
   typedef typename
     AdvancedTransformType::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
 
+  /** Typedefs for the transforms for which the kernels are specialized. */
+  typedef AdvancedMatrixOffsetTransformBase< ScalarType,
+    FixedImageDimension, MovingImageDimension >       AffineTransformType;
+  typedef RecursiveBSplineTransform< ScalarType,
+    FixedImageDimension, 3 >                          RecursiveBSplineOrder3TransformType;
+
+  /** The kernels that can be selected by SelectFastPathKernel(). */
+  typedef enum {
+    GenericKernel,
+    AffineLinearKernel,
+    AffineBSplineKernel,
+    BSplineLinearKernel,
+    BSplineBSplineKernel,
+    RecursiveBSplineLinearKernel,
+    RecursiveBSplineBSplineKernel
+  } FastPathKernelType;
+
+  /** \class GenericSampleEvaluator
+   * \brief Evaluates a sample by calling the virtual functions of the metric.
+   *
+   * The sample evaluators are created per thread by the kernels of the metrics.
+   */
+  class GenericSampleEvaluator
+  {
+public:
+
+    GenericSampleEvaluator( const Self * metric ) : m_Metric( metric ) {}
+
+    inline bool TransformPoint( const FixedImagePointType & fixedImagePoint,
+      MovingImagePointType & mappedPoint )
+    {
+      return this->m_Metric->TransformPoint( fixedImagePoint, mappedPoint );
+    }
+
+
+    inline bool IsInsideMovingMask( const MovingImagePointType & point ) const
+    {
+      return this->m_Metric->IsInsideMovingMask( point );
+    }
+
+
+    inline bool EvaluateMovingImageValueAndDerivative(
+      const MovingImagePointType & mappedPoint,
+      RealType & movingImageValue,
+      MovingImageDerivativeType * gradient ) const
+    {
+      return this->m_Metric->EvaluateMovingImageValueAndDerivative(
+        mappedPoint, movingImageValue, gradient );
+    }
+
+
+    inline bool EvaluateTransformJacobian( const FixedImagePointType & fixedImagePoint,
+      TransformJacobianType & jacobian, NonZeroJacobianIndicesType & nzji )
+    {
+      return this->m_Metric->EvaluateTransformJacobian( fixedImagePoint, jacobian, nzji );
+    }
+
+
+    inline void EvaluateJacobianWithImageGradientProduct(
+      const FixedImagePointType & fixedImagePoint,
+      const MovingImageDerivativeType & movingImageDerivative,
+      DerivativeType & imageJacobian, NonZeroJacobianIndicesType & nzji )
+    {
+      this->m_Metric->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+        fixedImagePoint, movingImageDerivative, imageJacobian, nzji );
+    }
+
+
+private:
+
+    const Self * m_Metric;
+  };
+
+  /** \class FastSampleEvaluator
+   * \brief Evaluates a sample by calling TTransform and TInterpolator directly.
+   *
+   * The functions of the transform and interpolator are called qualified, so
+   * without virtual dispatch, and can be inlined. This is only correct if the
+   * dynamic types of m_FastPathCurrentTransform and m_Interpolator are exactly
+   * TTransform and TInterpolator, which is checked by SelectFastPathKernel().
+   * An initial transform, which is composed with the current transform, is
+   * still called through its virtual functions, once per fixed point.
+   */
+  template< class TTransform, class TInterpolator >
+  class FastSampleEvaluator
+  {
+public:
+
+    FastSampleEvaluator( const Self * metric ) :
+      m_Transform( static_cast< const TTransform * >(
+        metric->m_FastPathCurrentTransform.GetPointer() ) ),
+      m_InitialTransform( metric->m_FastPathInitialTransform.GetPointer() ),
+      m_Interpolator( static_cast< const TInterpolator * >(
+        metric->m_Interpolator.GetPointer() ) ),
+      m_MovingImageMask( metric->m_MovingImageMask.GetPointer() ),
+      m_HasCachedPoint( false )
+    {}
+
+    inline bool TransformPoint( const FixedImagePointType & fixedImagePoint,
+      MovingImagePointType & mappedPoint )
+    {
+      mappedPoint = this->m_Transform->TTransform::TransformPoint(
+        this->GetCurrentInputPoint( fixedImagePoint ) );
+      return true;
+    }
+
+
+    inline bool IsInsideMovingMask( const MovingImagePointType & point ) const
+    {
+      return this->m_MovingImageMask == 0 || this->m_MovingImageMask->IsInside( point );
+    }
+
+
+    inline bool EvaluateMovingImageValueAndDerivative(
+      const MovingImagePointType & mappedPoint,
+      RealType & movingImageValue,
+      MovingImageDerivativeType * gradient ) const
+    {
+      MovingImageContinuousIndexType cindex;
+      this->m_Interpolator->ConvertPointToContinuousIndex( mappedPoint, cindex );
+      if( !this->m_Interpolator->TInterpolator::IsInsideBuffer( cindex ) )
+      {
+        return false;
+      }
+      if( gradient )
+      {
+        this->m_Interpolator->TInterpolator::EvaluateValueAndDerivativeAtContinuousIndex(
+          cindex, movingImageValue, *gradient );
+      }
+      else
+      {
+        movingImageValue = this->m_Interpolator->TInterpolator::EvaluateAtContinuousIndex( cindex );
+      }
+      return true;
+    }
+
+
+    inline bool EvaluateTransformJacobian( const FixedImagePointType & fixedImagePoint,
+      TransformJacobianType & jacobian, NonZeroJacobianIndicesType & nzji )
+    {
+      this->m_Transform->TTransform::GetJacobian(
+        this->GetCurrentInputPoint( fixedImagePoint ), jacobian, nzji );
+      return true;
+    }
+
+
+    inline void EvaluateJacobianWithImageGradientProduct(
+      const FixedImagePointType & fixedImagePoint,
+      const MovingImageDerivativeType & movingImageDerivative,
+      DerivativeType & imageJacobian, NonZeroJacobianIndicesType & nzji )
+    {
+      this->m_Transform->TTransform::EvaluateJacobianWithImageGradientProduct(
+        this->GetCurrentInputPoint( fixedImagePoint ),
+        movingImageDerivative, imageJacobian, nzji );
+    }
+
+
+private:
+
+    /** The input point of the current transform. With an initial transform
+     * it is computed once for consecutive calls with the same fixed point.
+     */
+    inline const FixedImagePointType & GetCurrentInputPoint(
+      const FixedImagePointType & fixedImagePoint )
+    {
+      if( this->m_InitialTransform == 0 )
+      {
+        return fixedImagePoint;
+      }
+      if( !this->m_HasCachedPoint || fixedImagePoint != this->m_CachedFixedImagePoint )
+      {
+        this->m_CachedFixedImagePoint = fixedImagePoint;
+        this->m_CachedInputPoint      = this->m_InitialTransform->TransformPoint( fixedImagePoint );
+        this->m_HasCachedPoint        = true;
+      }
+      return this->m_CachedInputPoint;
+    }
+
+
+    const TTransform *            m_Transform;
+    const AdvancedTransformType * m_InitialTransform;
+    const TInterpolator *         m_Interpolator;
+    const MovingImageMaskType *   m_MovingImageMask;
+    bool                          m_HasCachedPoint;
+    FixedImagePointType           m_CachedFixedImagePoint;
+    FixedImagePointType           m_CachedInputPoint;
+  };
+
+  /** The sample evaluators of the specialized kernels. */
+  typedef FastSampleEvaluator< AffineTransformType,
+    LinearInterpolatorType >                  AffineLinearSampleEvaluator;
+  typedef FastSampleEvaluator< AffineTransformType,
+    BSplineInterpolatorType >                 AffineBSplineSampleEvaluator;
+  typedef FastSampleEvaluator< BSplineOrder3TransformType,
+    LinearInterpolatorType >                  BSplineLinearSampleEvaluator;
+  typedef FastSampleEvaluator< BSplineOrder3TransformType,
+    BSplineInterpolatorType >                 BSplineBSplineSampleEvaluator;
+  typedef FastSampleEvaluator< RecursiveBSplineOrder3TransformType,
+    LinearInterpolatorType >                  RecursiveBSplineLinearSampleEvaluator;
+  typedef FastSampleEvaluator< RecursiveBSplineOrder3TransformType,
+    BSplineInterpolatorType >                 RecursiveBSplineBSplineSampleEvaluator;
+
   /** Protected Variables **************/
 
   /** Variables for ImageSampler support. m_ImageSampler is mutable,
@@ -336,6 +677,9 @@ protected:
    */
   mutable ImageSamplerPointer m_ImageSampler;
 
+  /** The random number generator, see SetRandomGenerator(). */
+  typename RandomGeneratorType::Pointer m_RandomGenerator;
+
   /** Variables for image derivative computation. */
   bool                                   m_InterpolatorIsLinear;
   bool                                   m_InterpolatorIsBSpline;
@@ -353,6 +697,36 @@ protected:
   typename AdvancedTransformType::Pointer m_AdvancedTransform;
   mutable bool m_TransformIsBSpline;
 
+  /** Variables for the compile-time specialized kernels, set by
+   * SelectFastPathKernel(). The current transform is the transform that is
+   * optimized; the initial transform is composed with it, or 0.
+   */
+  bool                                         m_UseFastPathKernels;
+  bool                                         m_UseSinglePrecisionAccumulation;
+  bool                                         m_UseDeterministicReduction;
+  ThreadIdType                                 m_NumberOfDeterministicWorkUnits;
+  FastPathKernelType                           m_FastPathKernel;
+  typename AdvancedTransformType::ConstPointer m_FastPathCurrentTransform;
+  typename AdvancedTransformType::ConstPointer m_FastPathInitialTransform;
+
+  /** Variables for the weight tables, set by ComputeBSplineWeightTables().
+   * The transform of which this metric requested the tables, and the lattice.
+   */
+  bool                                                          m_UseBSplineWeightTables;
+  typename RecursiveBSplineOrder3TransformType::Pointer         m_BSplineWeightTablesTransform;
+  typename RecursiveBSplineOrder3TransformType::InputPointType  m_BSplineWeightTablesOrigin;
+  typename RecursiveBSplineOrder3TransformType::SpacingType     m_BSplineWeightTablesSpacing;
+  typename RecursiveBSplineOrder3TransformType::DirectionType   m_BSplineWeightTablesDirection;
+
+  /** Variables for the OpenCL evaluation, set by SelectOpenCLEvaluator(). */
+  bool m_UseOpenCL;
+  bool m_UseOpenCLEvaluator;
+#ifdef ELASTIX_USE_OPENCL
+  typedef GPUAdvancedImageToImageMetricEvaluator<
+    FixedImageType, MovingImageType, ScalarType > OpenCLEvaluatorType;
+  typename OpenCLEvaluatorType::Pointer m_OpenCLEvaluator;
+#endif
+
   /** Variables for the Limiters. */
   FixedImageLimiterPointer     m_FixedImageLimiter;
   MovingImageLimiterPointer    m_MovingImageLimiter;
@@ -396,6 +770,89 @@ protected:
   /** AccumulateDerivatives threader callback function. */
   static ITK_THREAD_RETURN_TYPE AccumulateDerivativesThreaderCallback( void * arg );
 
+  /** Multi-threaded first pass of GetCompressedSelfHessian(). The contribution
+   * of a sample to the SelfHessian is F^T F, with F a small matrix of factors
+   * per nonzero Jacobian index. Each thread computes F for its part of the
+   * current block of samples, see GetSelfHessianSamplesOfThread() and
+   * GetSelfHessianFactors().
+   */
+  virtual inline void ThreadedGetSelfHessian( ThreadIdType threadID ){}
+
+  /** GetSelfHessian threader callback function. */
+  static ITK_THREAD_RETURN_TYPE GetSelfHessianThreaderCallback( void * arg );
+
+  /** AddSelfHessianFactors threader callback function. */
+  static ITK_THREAD_RETURN_TYPE AddSelfHessianFactorsThreaderCallback( void * arg );
+
+  /** Launch MultiThread GetSelfHessian, adding the contributions of the
+   * samples to H. The contribution of a sample is F^T F, with F its matrix
+   * of numberOfFactors rows and a column per nonzero Jacobian index. The
+   * samples are processed in blocks. For each block, the threads first
+   * compute the factors of their part of the samples, with
+   * ThreadedGetSelfHessian(), and then add the contributions of all samples
+   * of the block to their own range of rows of H, with
+   * ThreadedAddSelfHessianFactors(). Each entry of H thus receives its terms
+   * in the order of the samples, independent of the number of threads.
+   * Throws an exception when a contribution fell outside the sparsity
+   * pattern of H. Returns the number of pixels counted.
+   */
+  SizeValueType LaunchGetSelfHessianThreaderCallback(
+    ImageSampleContainerType * samples, const unsigned int numberOfFactors,
+    CSRHessianType & H ) const;
+
+  /** Get the samples of the current block that are handled by thread
+   * threadID in ThreadedGetSelfHessian(). The sample numbers refer to the
+   * whole sample container.
+   */
+  void GetSelfHessianSamplesOfThread( ThreadIdType threadID,
+    unsigned long & begin, unsigned long & end ) const;
+
+  /** Get the factors of sample sampleNr of the current block, to be set by
+   * ThreadedGetSelfHessian(). factors[ a * n + i ] is factor a of nonzero
+   * Jacobian index i, with n the number of nonzero Jacobian indices. The
+   * indices nzji are stored with them, and the sample is counted. Samples
+   * for which this function is not called do not contribute.
+   */
+  HessianValueType * GetSelfHessianFactors( unsigned long sampleNr,
+    const NonZeroJacobianIndicesType & nzji ) const;
+
+  /** Add the contributions of all samples of the current block to the rows
+   * of H of thread threadID. Only the upper triangle is stored, so the term
+   * of the pair (i, j) is added to entry ( min( nzji[i], nzji[j] ),
+   * max( nzji[i], nzji[j] ) ).
+   */
+  void ThreadedAddSelfHessianFactors( ThreadIdType threadID ) const;
+
+  /** Set the sparsity pattern of the SelfHessian, and set it to zero.
+   * For a B-spline transform, possibly as current transform of a combination
+   * transform, two parameters are coupled when the supports of their control
+   * points overlap, which is when the grid indices differ at most the spline
+   * order in each direction. For transforms with a dense Jacobian the pattern
+   * is the full upper triangle. Other transforms are not supported.
+   */
+  virtual void InitializeSelfHessianPattern( CSRHessianType & H ) const;
+
+  /** Variables for the multi-threaded SelfHessian, only set during
+   * LaunchGetSelfHessianThreaderCallback(). The current block consists of
+   * the samples m_SelfHessianBlockBegin up to m_SelfHessianBlockEnd. Their
+   * factors, nonzero Jacobian indices and whether they are counted are
+   * stored per sample of the block. Thread i adds to the rows
+   * m_SelfHessianRowBegin[ i ] up to m_SelfHessianRowBegin[ i + 1 ] of
+   * m_SelfHessian, and counts the terms that fell outside the pattern in
+   * m_SelfHessianMissedPerThread.
+   */
+  mutable ImageSampleContainerPointer     m_SelfHessianSampleContainer;
+  mutable CSRHessianType *                m_SelfHessian;
+  mutable unsigned long                   m_SelfHessianBlockBegin;
+  mutable unsigned long                   m_SelfHessianBlockEnd;
+  mutable unsigned int                    m_SelfHessianNumberOfFactors;
+  mutable unsigned int                    m_SelfHessianNumberOfIndices;
+  mutable std::vector< HessianValueType > m_SelfHessianFactors;
+  mutable NonZeroJacobianIndicesType      m_SelfHessianIndices;
+  mutable std::vector< unsigned char >    m_SelfHessianSampleCounted;
+  mutable std::vector< SizeValueType >    m_SelfHessianRowBegin;
+  mutable std::vector< SizeValueType >    m_SelfHessianMissedPerThread;
+
   /** Variables for multi-threading. */
   bool m_UseMetricSingleThreaded;
   bool m_UseMultiThread;
@@ -436,12 +893,17 @@ protected:
   mutable AlignedGetValuePerThreadStruct * m_GetValuePerThreadVariables;
   mutable ThreadIdType                     m_GetValuePerThreadVariablesSize;
 
+  /** The type of the per-thread derivatives with single precision accumulation. */
+  typedef float                              SingleDerivativeValueType;
+  typedef Array< SingleDerivativeValueType > SingleDerivativeType;
+
   // test per thread struct with padding and alignment
   struct GetValueAndDerivativePerThreadStruct
   {
-    SizeValueType  st_NumberOfPixelsCounted;
-    MeasureType    st_Value;
-    DerivativeType st_Derivative;
+    SizeValueType        st_NumberOfPixelsCounted;
+    MeasureType          st_Value;
+    DerivativeType       st_Derivative;
+    SingleDerivativeType st_SingleDerivative;
   };
   itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, GetValueAndDerivativePerThreadStruct,
     PaddedGetValueAndDerivativePerThreadStruct );
@@ -453,6 +915,86 @@ protected:
   /** Initialize some multi-threading related parameters. */
   virtual void InitializeThreadingParameters( void ) const;
 
+  /** Whether the threaded loops of this metric accumulate into st_SingleDerivative
+   * when m_UseSinglePrecisionAccumulationInThreads is true. Default false.
+   */
+  virtual bool GetSupportsSinglePrecisionAccumulation( void ) const
+  { return false; }
+
+  /** Set by Initialize(): the threads use st_SingleDerivative instead of
+   * st_Derivative. Then only st_SingleDerivative is allocated.
+   */
+  bool m_UseSinglePrecisionAccumulationInThreads;
+
+  /** Whether the threaded loops of this metric use m_NumberOfWorkUnits
+   * for the division of the samples and the reductions. Default false.
+   */
+  virtual bool GetSupportsDeterministicReduction( void ) const
+  { return false; }
+
+  /** Set by Initialize(): the threaded loops reduce the results of a fixed
+   * number of work units in a fixed order.
+   */
+  bool m_UseDeterministicReductionInThreads;
+
+  /** The number of parts in which the threaded loops divide the samples.
+   * Equal to m_NumberOfThreads. With deterministic reduction it is set by
+   * InitializeDeterministicWorkUnits() to the number of nonempty work units,
+   * at most m_NumberOfDeterministicWorkUnits. Thread t processes the work
+   * units t, t + numberOfThreads, etc., see GetValueAndDerivativeThreaderCallback().
+   */
+  mutable ThreadIdType m_NumberOfWorkUnits;
+
+  /** With deterministic reduction, divide the samples over at most
+   * m_NumberOfDeterministicWorkUnits work units, such that none is empty.
+   * This only depends on the number of samples, not on the number of threads.
+   * Only the derivatives of these work units are allocated; those of the
+   * other work units are freed. Called by BeforeThreadedGetValueAndDerivative().
+   * Metrics with their own per-thread derivatives should override it.
+   */
+  virtual void InitializeDeterministicWorkUnits( const SizeValueType numberOfSamples ) const;
+
+  /** The number of nonempty work units of the deterministic reduction. */
+  ThreadIdType GetNumberOfDeterministicWorkUnits( const SizeValueType numberOfSamples ) const;
+
+  /** Sum values[ 0 ], ..., values[ n - 1 ] pairwise, in an order that only
+   * depends on n. The values are overwritten.
+   */
+  template< class TValue >
+  static TValue PairwiseSum( TValue * values, ThreadIdType n );
+
+  /** The temporaries of the sample loops, per thread. They live across
+   * iterations and resolutions, so that the sample loops make no heap
+   * allocations once the sizes are stable. The derivative temporaries,
+   * like dM/dmu, are taken from st_Arena, which is released at the start
+   * of each call of a sample loop.
+   */
+  typedef ThreadScratchArena< DerivativeValueType > ScratchArenaType;
+  struct ScratchSpacePerThreadStruct
+  {
+    NonZeroJacobianIndicesType st_NonZeroJacobianIndices;
+    TransformJacobianType      st_TransformJacobian;
+    ScratchArenaType           st_Arena;
+  };
+  itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, ScratchSpacePerThreadStruct,
+    PaddedScratchSpacePerThreadStruct );
+  itkAlignedTypedef( ITK_CACHE_LINE_ALIGNMENT, PaddedScratchSpacePerThreadStruct,
+    AlignedScratchSpacePerThreadStruct );
+  mutable AlignedScratchSpacePerThreadStruct * m_ScratchSpacePerThreadVariables;
+  mutable ThreadIdType                         m_ScratchSpacePerThreadVariablesSize;
+
+  /** Size the scratch space of all threads, using the number of nonzero
+   * Jacobian indices of the transform. Called by Initialize(). The memory
+   * is only reallocated when the number of threads changes, or when more
+   * memory is needed than before.
+   */
+  virtual void InitializeScratchSpace( void ) const;
+
+  /** The number of values that the sample loops take from the arena of
+   * a thread. Default: the number of nonzero Jacobian indices, for dM/dmu.
+   */
+  virtual SizeValueType GetNumberOfScratchValuesPerThread( void ) const;
+
   /** Protected methods ************** */
 
   /** Methods for image sampler support **********/
@@ -508,6 +1050,45 @@ protected:
   /** Check if the transform is a B-spline. Called by Initialize. */
   virtual void CheckForBSplineTransform( void ) const;
 
+  /** Select the kernel for the hot loops of the metric. Called by Initialize,
+   * after the checks of the interpolator and transform. A specialized kernel is
+   * selected when:
+   * \li UseFastPathKernels is true, no gradient image is used, and no moving
+   *   image derivative scales are used;
+   * \li the transform is an AffineTransformType, BSplineOrder3TransformType or
+   *   RecursiveBSplineOrder3TransformType, or a combination transform with such
+   *   a current transform, and no initial transform or one that is composed;
+   * \li the interpolator is a LinearInterpolatorType or BSplineInterpolatorType.
+   * Exact types are required, since the evaluators bypass virtual dispatch.
+   */
+  virtual void SelectFastPathKernel( void );
+
+  /** Request the weight tables of a RecursiveBSplineOrder3TransformType, when
+   * UseBSplineWeightTables is set and the samples lie on the voxel lattice of
+   * the fixed image, so without image sampler or with an ImageFullSampler or
+   * ImageGridSampler. The transform only uses the tables if the grid is
+   * aligned with the voxel lattice, see
+   * RecursiveBSplineTransform::ComputeWeightTables(). The request of the
+   * previous call is released first, so the tables that other metrics
+   * requested on the same transform are kept. Called by Initialize.
+   */
+  virtual void ComputeBSplineWeightTables( void );
+
+  /** Select the OpenCL evaluation of the sample loops. Called by Initialize.
+   * The OpenCL evaluator is used when:
+   * \li UseOpenCL is true, the metric supports it, and an OpenCL context is created;
+   * \li the interpolator is a LinearInterpolatorType;
+   * \li no moving mask, gradient image or moving image derivative scales are used;
+   * \li the transform is a combination transform without initial transform, and
+   *   the evaluator supports its current transform.
+   * Otherwise m_UseOpenCLEvaluator is false, and the CPU is used.
+   */
+  virtual void SelectOpenCLEvaluator( void );
+
+  /** Whether the metric implements the OpenCL evaluation. Default false. */
+  virtual bool GetSupportsOpenCL( void ) const
+  { return false; }
+
   /** Transform a point from FixedImage domain to MovingImage domain.
    * This function also checks if mapped point is within support region of
    * the transform. It returns true if so, and false otherwise.
@@ -576,6 +1157,39 @@ private:
 
 } // end namespace itk
 
+/** Call this->kernel< TSampleEvaluator > arguments, with the sample evaluator
+ * that belongs to the kernel selected by SelectFastPathKernel(). This macro is
+ * meant for the threaded functions of metrics that inherit from the
+ * AdvancedImageToImageMetric, which implement their loop over the samples as
+ * a member function template, e.g.:
+ *   itkAdvancedImageToImageMetricDispatchKernelMacro( ThreadedGetValueKernel, ( threadId ) );
+ */
+#define itkAdvancedImageToImageMetricDispatchKernelMacro( kernel, arguments )          \
+  switch( this->m_FastPathKernel )                                                     \
+  {                                                                                    \
+    case Superclass::AffineLinearKernel:                                               \
+      this->template kernel< typename Superclass::AffineLinearSampleEvaluator > arguments; \
+      break;                                                                           \
+    case Superclass::AffineBSplineKernel:                                              \
+      this->template kernel< typename Superclass::AffineBSplineSampleEvaluator > arguments; \
+      break;                                                                           \
+    case Superclass::BSplineLinearKernel:                                              \
+      this->template kernel< typename Superclass::BSplineLinearSampleEvaluator > arguments; \
+      break;                                                                           \
+    case Superclass::BSplineBSplineKernel:                                             \
+      this->template kernel< typename Superclass::BSplineBSplineSampleEvaluator > arguments; \
+      break;                                                                           \
+    case Superclass::RecursiveBSplineLinearKernel:                                     \
+      this->template kernel< typename Superclass::RecursiveBSplineLinearSampleEvaluator > arguments; \
+      break;                                                                           \
+    case Superclass::RecursiveBSplineBSplineKernel:                                    \
+      this->template kernel< typename Superclass::RecursiveBSplineBSplineSampleEvaluator > arguments; \
+      break;                                                                           \
+    default:                                                                           \
+      this->template kernel< typename Superclass::GenericSampleEvaluator > arguments;  \
+      break;                                                                           \
+  }
+
 #ifndef ITK_MANUAL_INSTANTIATION
 #include "itkAdvancedImageToImageMetric.hxx"
 #endif
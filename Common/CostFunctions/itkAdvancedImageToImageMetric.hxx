@@ -23,6 +23,8 @@
 #include "itkImageRegionConstIterator.h"          // used for extrema computation
 #include "itkImageRegionConstIteratorWithIndex.h" // used for extrema computation
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
+#include <typeinfo>
+#include <algorithm>
 
 #ifdef ELASTIX_USE_OPENMP
 #include <omp.h>
@@ -50,6 +52,7 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   this->m_ImageSampler                = 0;
   this->m_UseImageSampler             = false;
   this->m_RequiredRatioOfValidSamples = 0.25;
+  this->m_RandomGenerator             = RandomGeneratorType::GetInstance();
 
   this->m_LinearInterpolator              = 0;
   this->m_BSplineInterpolator             = 0;
@@ -68,6 +71,24 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   this->m_ScaleGradientWithRespectToMovingImageOrientation = false;
   this->m_MovingImageDerivativeScales.Fill( 1.0 );
 
+  this->m_UseFastPathKernels       = true;
+  this->m_FastPathKernel           = GenericKernel;
+  this->m_FastPathCurrentTransform = 0;
+  this->m_FastPathInitialTransform = 0;
+
+  this->m_UseSinglePrecisionAccumulation          = false;
+  this->m_UseSinglePrecisionAccumulationInThreads = false;
+
+  this->m_UseDeterministicReduction          = false;
+  this->m_UseDeterministicReductionInThreads = false;
+  this->m_NumberOfDeterministicWorkUnits     = 16;
+
+  this->m_UseBSplineWeightTables       = false;
+  this->m_BSplineWeightTablesTransform = 0;
+
+  this->m_UseOpenCL          = false;
+  this->m_UseOpenCLEvaluator = false;
+
   this->m_FixedImageLimiter     = 0;
   this->m_MovingImageLimiter    = 0;
   this->m_UseFixedImageLimiter  = false;
@@ -86,15 +107,13 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   /** Threading related variables. */
   this->m_UseMetricSingleThreaded = true;
   this->m_UseMultiThread = false;
+  this->m_NumberOfWorkUnits = this->m_NumberOfThreads;
   this->m_Threader->SetUseThreadPool( false ); // setting to true makes elastix hang
                                                // at a WaitForSingleMethodThread()
 
   /** OpenMP related. Switch to on when available */
 #ifdef ELASTIX_USE_OPENMP
   this->m_UseOpenMP = true;
-
-  const int nthreads = static_cast< int >( this->m_NumberOfThreads );
-  omp_set_num_threads( nthreads );
 #else
   this->m_UseOpenMP = false;
 #endif
@@ -107,6 +126,16 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   this->m_GetValuePerThreadVariablesSize              = 0;
   this->m_GetValueAndDerivativePerThreadVariables     = NULL;
   this->m_GetValueAndDerivativePerThreadVariablesSize = 0;
+  this->m_ScratchSpacePerThreadVariables              = NULL;
+  this->m_ScratchSpacePerThreadVariablesSize          = 0;
+
+  // SelfHessian related
+  this->m_SelfHessianSampleContainer = 0;
+  this->m_SelfHessian                = 0;
+  this->m_SelfHessianBlockBegin      = 0;
+  this->m_SelfHessianBlockEnd        = 0;
+  this->m_SelfHessianNumberOfFactors = 0;
+  this->m_SelfHessianNumberOfIndices = 0;
 
 } // end Constructor
 
@@ -121,6 +150,14 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 {
   delete[] this->m_GetValuePerThreadVariables;
   delete[] this->m_GetValueAndDerivativePerThreadVariables;
+  delete[] this->m_ScratchSpacePerThreadVariables;
+
+  /** Release the weight tables requested by this metric. */
+  if( this->m_BSplineWeightTablesTransform.IsNotNull() )
+  {
+    this->m_BSplineWeightTablesTransform->ReleaseWeightTables( this->m_BSplineWeightTablesOrigin,
+      this->m_BSplineWeightTablesSpacing, this->m_BSplineWeightTablesDirection );
+  }
 } // end Destructor
 
 
@@ -135,10 +172,12 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 {
   Superclass::SetNumberOfThreads( numberOfThreads );
 
-#ifdef ELASTIX_USE_OPENMP
-  const int nthreads = static_cast< int >( this->m_NumberOfThreads );
-  omp_set_num_threads( nthreads );
-#endif
+  /** With deterministic reduction the number of work units is fixed. */
+  if( !this->m_UseDeterministicReductionInThreads )
+  {
+    this->m_NumberOfWorkUnits = this->m_NumberOfThreads;
+  }
+
 } // end SetNumberOfThreads()
 
 
@@ -169,10 +208,32 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   /** Check if the transform is a B-spline transform. */
   this->CheckForBSplineTransform();
 
+  /** Select the kernel for the hot loops. */
+  this->SelectFastPathKernel();
+
+  /** Tabulate the B-spline weights for samples on the voxel lattice. */
+  this->ComputeBSplineWeightTables();
+
+  /** Check if the sample loops are evaluated with OpenCL. */
+  this->SelectOpenCLEvaluator();
+
+  /** Check if the threads accumulate in single precision. */
+  this->m_UseSinglePrecisionAccumulationInThreads = this->m_UseMultiThread
+    && this->m_UseSinglePrecisionAccumulation
+    && this->GetSupportsSinglePrecisionAccumulation();
+
+  /** Check if the threaded loops use a fixed number of work units. */
+  this->m_UseDeterministicReductionInThreads = this->m_UseMultiThread
+    && this->m_UseDeterministicReduction
+    && this->GetSupportsDeterministicReduction();
+  this->m_NumberOfWorkUnits = this->m_UseDeterministicReductionInThreads
+    ? this->m_NumberOfDeterministicWorkUnits : this->m_NumberOfThreads;
+
   /** Initialize some threading related parameters. */
   if( this->m_UseMultiThread )
   {
     this->InitializeThreadingParameters();
+    this->InitializeScratchSpace();
   }
 
 } // end Initialize()
@@ -197,37 +258,117 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
    * This has performance benefits for larger vector sizes.
    */
 
-  /** Only resize the array of structs when needed. */
-  if( this->m_GetValuePerThreadVariablesSize != this->m_NumberOfThreads )
+  /** Only resize the array of structs when needed. With deterministic reduction
+   * the number of work units may be lowered in each iteration, so do not shrink.
+   */
+  if( this->m_GetValuePerThreadVariablesSize < this->m_NumberOfWorkUnits
+    || ( !this->m_UseDeterministicReductionInThreads
+    && this->m_GetValuePerThreadVariablesSize != this->m_NumberOfWorkUnits ) )
   {
     delete[] this->m_GetValuePerThreadVariables;
-    this->m_GetValuePerThreadVariables     = new AlignedGetValuePerThreadStruct[ this->m_NumberOfThreads ];
-    this->m_GetValuePerThreadVariablesSize = this->m_NumberOfThreads;
+    this->m_GetValuePerThreadVariables     = new AlignedGetValuePerThreadStruct[ this->m_NumberOfWorkUnits ];
+    this->m_GetValuePerThreadVariablesSize = this->m_NumberOfWorkUnits;
   }
 
   /** Only resize the array of structs when needed. */
-  if( this->m_GetValueAndDerivativePerThreadVariablesSize != this->m_NumberOfThreads )
+  if( this->m_GetValueAndDerivativePerThreadVariablesSize < this->m_NumberOfWorkUnits
+    || ( !this->m_UseDeterministicReductionInThreads
+    && this->m_GetValueAndDerivativePerThreadVariablesSize != this->m_NumberOfWorkUnits ) )
   {
     delete[] this->m_GetValueAndDerivativePerThreadVariables;
-    this->m_GetValueAndDerivativePerThreadVariables     = new AlignedGetValueAndDerivativePerThreadStruct[ this->m_NumberOfThreads ];
-    this->m_GetValueAndDerivativePerThreadVariablesSize = this->m_NumberOfThreads;
+    this->m_GetValueAndDerivativePerThreadVariables     = new AlignedGetValueAndDerivativePerThreadStruct[ this->m_NumberOfWorkUnits ];
+    this->m_GetValueAndDerivativePerThreadVariablesSize = this->m_NumberOfWorkUnits;
   }
 
   /** Some initialization. */
-  for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
+  for( ThreadIdType i = 0; i < this->m_NumberOfWorkUnits; ++i )
   {
     this->m_GetValuePerThreadVariables[ i ].st_NumberOfPixelsCounted = NumericTraits< SizeValueType >::Zero;
     this->m_GetValuePerThreadVariables[ i ].st_Value                 = NumericTraits< MeasureType >::Zero;
 
     this->m_GetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted = NumericTraits< SizeValueType >::Zero;
     this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value                 = NumericTraits< MeasureType >::Zero;
-    this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative.SetSize( this->GetNumberOfParameters() );
-    this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+
+    /** With deterministic reduction the derivatives are allocated by
+     * InitializeDeterministicWorkUnits(), once the number of samples is known.
+     */
+    if( this->m_UseDeterministicReductionInThreads )
+    {
+      continue;
+    }
+    if( this->m_UseSinglePrecisionAccumulationInThreads )
+    {
+      this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative.SetSize( 0 );
+      this->m_GetValueAndDerivativePerThreadVariables[ i ].st_SingleDerivative.SetSize( this->GetNumberOfParameters() );
+      this->m_GetValueAndDerivativePerThreadVariables[ i ].st_SingleDerivative.Fill( NumericTraits< SingleDerivativeValueType >::ZeroValue() );
+    }
+    else
+    {
+      this->m_GetValueAndDerivativePerThreadVariables[ i ].st_SingleDerivative.SetSize( 0 );
+      this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative.SetSize( this->GetNumberOfParameters() );
+      this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    }
   }
 
 } // end InitializeThreadingParameters()
 
 
+/**
+ * ********************* InitializeScratchSpace ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeScratchSpace( void ) const
+{
+  /** Only resize the array of structs when needed. */
+  if( this->m_ScratchSpacePerThreadVariablesSize != this->m_NumberOfWorkUnits )
+  {
+    delete[] this->m_ScratchSpacePerThreadVariables;
+    this->m_ScratchSpacePerThreadVariables     = new AlignedScratchSpacePerThreadStruct[ this->m_NumberOfWorkUnits ];
+    this->m_ScratchSpacePerThreadVariablesSize = this->m_NumberOfWorkUnits;
+  }
+
+  /** Only the advanced transform reports its number of nonzero Jacobian indices. */
+  NumberOfParametersType nnzji = this->GetNumberOfParameters();
+  if( this->m_AdvancedTransform.IsNotNull() )
+  {
+    nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  }
+
+  /** Size the temporaries. The resize functions do not reallocate
+   * when the size does not change.
+   */
+  const SizeValueType numberOfScratchValues = this->GetNumberOfScratchValuesPerThread();
+  for( ThreadIdType i = 0; i < this->m_NumberOfWorkUnits; ++i )
+  {
+    this->m_ScratchSpacePerThreadVariables[ i ].st_NonZeroJacobianIndices.resize( nnzji );
+    this->m_ScratchSpacePerThreadVariables[ i ].st_TransformJacobian.SetSize( MovingImageDimension, nnzji );
+    this->m_ScratchSpacePerThreadVariables[ i ].st_Arena.Reserve( numberOfScratchValues );
+  }
+
+} // end InitializeScratchSpace()
+
+
+/**
+ * ********************* GetNumberOfScratchValuesPerThread ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+SizeValueType
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetNumberOfScratchValuesPerThread( void ) const
+{
+  if( this->m_AdvancedTransform.IsNotNull() )
+  {
+    return this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  }
+  return this->GetNumberOfParameters();
+
+} // end GetNumberOfScratchValuesPerThread()
+
+
 /**
  * ****************** ComputeFixedImageExtrema ***************************
  */
@@ -633,6 +774,221 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 } // end CheckForBSplineTransform()
 
 
+/**
+ * ****************** SelectFastPathKernel **********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::SelectFastPathKernel( void )
+{
+  this->m_FastPathKernel           = GenericKernel;
+  this->m_FastPathCurrentTransform = 0;
+  this->m_FastPathInitialTransform = 0;
+
+  /** The specialized evaluators only support the default image derivatives. */
+  if( !this->m_UseFastPathKernels || this->GetComputeGradient()
+    || this->m_UseMovingImageDerivativeScales
+    || this->m_AdvancedTransform.IsNull() || this->m_Interpolator.IsNull() )
+  {
+    return;
+  }
+
+  /** Find the transform that is optimized. A combination transform may be
+   * skipped if it just composes an initial transform with it.
+   */
+  const AdvancedTransformType * currentTransform = this->m_AdvancedTransform.GetPointer();
+  const AdvancedTransformType * initialTransform = 0;
+  const CombinationTransformType * combination
+    = dynamic_cast< const CombinationTransformType * >( currentTransform );
+  if( combination )
+  {
+    if( !combination->IsPlainCombination() )
+    {
+      return;
+    }
+    currentTransform = combination->GetCurrentTransform();
+    initialTransform = combination->GetInitialTransform();
+    if( initialTransform && !combination->GetUseComposition() )
+    {
+      return;
+    }
+  }
+  if( currentTransform == 0 )
+  {
+    return;
+  }
+
+  /** Check the exact types. */
+  const std::type_info & transformType    = typeid( *currentTransform );
+  const std::type_info & interpolatorType = typeid( *this->m_Interpolator );
+  const bool             isLinear         = interpolatorType == typeid( LinearInterpolatorType );
+  const bool             isBSpline        = interpolatorType == typeid( BSplineInterpolatorType );
+  if( !isLinear && !isBSpline )
+  {
+    return;
+  }
+
+  if( transformType == typeid( AffineTransformType ) )
+  {
+    this->m_FastPathKernel = isLinear ? AffineLinearKernel : AffineBSplineKernel;
+  }
+  else if( transformType == typeid( BSplineOrder3TransformType ) )
+  {
+    this->m_FastPathKernel = isLinear ? BSplineLinearKernel : BSplineBSplineKernel;
+  }
+  else if( transformType == typeid( RecursiveBSplineOrder3TransformType ) )
+  {
+    this->m_FastPathKernel = isLinear ? RecursiveBSplineLinearKernel : RecursiveBSplineBSplineKernel;
+  }
+  else
+  {
+    return;
+  }
+
+  this->m_FastPathCurrentTransform = currentTransform;
+  this->m_FastPathInitialTransform = initialTransform;
+  itkDebugMacro( "Selected fast path kernel " << this->m_FastPathKernel );
+
+} // end SelectFastPathKernel()
+
+
+/**
+ * ****************** ComputeBSplineWeightTables **********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeBSplineWeightTables( void )
+{
+  /** Release the tables of the previous call; those of other metrics are kept. */
+  if( this->m_BSplineWeightTablesTransform.IsNotNull() )
+  {
+    this->m_BSplineWeightTablesTransform->ReleaseWeightTables( this->m_BSplineWeightTablesOrigin,
+      this->m_BSplineWeightTablesSpacing, this->m_BSplineWeightTablesDirection );
+    this->m_BSplineWeightTablesTransform = 0;
+  }
+  if( !this->m_UseBSplineWeightTables )
+  {
+    return;
+  }
+
+  /** Find the recursive B-spline transform. It should be evaluated at the
+   * sample positions, so an initial transform is only allowed when added.
+   */
+  CombinationTransformType * combination
+    = dynamic_cast< CombinationTransformType * >( this->m_AdvancedTransform.GetPointer() );
+  RecursiveBSplineOrder3TransformType * bsplineTransform = 0;
+  bool                                  onSamplePositions = true;
+  if( combination )
+  {
+    bsplineTransform = dynamic_cast< RecursiveBSplineOrder3TransformType * >(
+      combination->GetCurrentTransform() );
+    onSamplePositions = combination->IsPlainCombination()
+      && ( combination->GetInitialTransform() == 0 || combination->GetUseAddition() );
+  }
+  else
+  {
+    bsplineTransform = dynamic_cast< RecursiveBSplineOrder3TransformType * >(
+      this->m_AdvancedTransform.GetPointer() );
+  }
+  if( bsplineTransform == 0 || !onSamplePositions )
+  {
+    return;
+  }
+
+  /** The full and grid sampler select voxel positions. */
+  typedef ImageFullSampler< FixedImageType > FullSamplerType;
+  typedef ImageGridSampler< FixedImageType > GridSamplerType;
+  const bool onVoxelPositions = !this->m_UseImageSampler
+    || dynamic_cast< FullSamplerType * >( this->m_ImageSampler.GetPointer() ) != 0
+    || dynamic_cast< GridSamplerType * >( this->m_ImageSampler.GetPointer() ) != 0;
+  if( !onVoxelPositions )
+  {
+    return;
+  }
+
+  /** Request the tables, and remember the request to release it later. */
+  this->m_BSplineWeightTablesTransform = bsplineTransform;
+  this->m_BSplineWeightTablesOrigin    = this->m_FixedImage->GetOrigin();
+  this->m_BSplineWeightTablesSpacing   = this->m_FixedImage->GetSpacing();
+  this->m_BSplineWeightTablesDirection = this->m_FixedImage->GetDirection();
+  if( bsplineTransform->ComputeWeightTables( this->m_BSplineWeightTablesOrigin,
+    this->m_BSplineWeightTablesSpacing, this->m_BSplineWeightTablesDirection ) )
+  {
+    itkDebugMacro( "Computed the weight tables of the B-spline transform" );
+  }
+
+} // end ComputeBSplineWeightTables()
+
+
+/**
+ * ****************** SelectOpenCLEvaluator **********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::SelectOpenCLEvaluator( void )
+{
+  this->m_UseOpenCLEvaluator = false;
+  if( !this->m_UseOpenCL || !this->GetSupportsOpenCL() )
+  {
+    return;
+  }
+
+#ifdef ELASTIX_USE_OPENCL
+  /** The evaluator implements the linear interpolator, without masks
+   * and image derivative scales, and no initial transforms.
+   */
+  const CombinationTransformType * combination
+    = dynamic_cast< const CombinationTransformType * >( this->m_AdvancedTransform.GetPointer() );
+  if( !OpenCLContext::GetInstance()->IsCreated()
+    || this->m_Interpolator.IsNull()
+    || typeid( *this->m_Interpolator ) != typeid( LinearInterpolatorType )
+    || this->m_MovingImageMask.IsNotNull() || this->GetComputeGradient()
+    || this->m_UseMovingImageDerivativeScales
+    || combination == 0 || !combination->IsPlainCombination()
+    || combination->GetInitialTransform() != 0 || combination->GetCurrentTransform() == 0 )
+  {
+    itkWarningMacro( << "The OpenCL evaluation of the metric does not support this "
+                     << "configuration. The CPU is used instead." );
+    return;
+  }
+
+  try
+  {
+    if( this->m_OpenCLEvaluator.IsNull() )
+    {
+      this->m_OpenCLEvaluator = OpenCLEvaluatorType::New();
+    }
+    if( !this->m_OpenCLEvaluator->SetTransform( combination->GetCurrentTransform() ) )
+    {
+      itkWarningMacro( << "The OpenCL evaluation of the metric does not support the "
+                       << combination->GetCurrentTransform()->GetNameOfClass()
+                       << ". The CPU is used instead." );
+      return;
+    }
+    this->m_OpenCLEvaluator->SetMovingImage( this->m_MovingImage );
+  }
+  catch( ExceptionObject & excp )
+  {
+    itkWarningMacro( << "The OpenCL evaluator could not be initialized:\n"
+                     << excp.GetDescription() << "\nThe CPU is used instead." );
+    return;
+  }
+
+  this->m_UseOpenCLEvaluator = true;
+#else
+  itkWarningMacro( << "UseOpenCL is set, but elastix is compiled without OpenCL. "
+                   << "The CPU is used instead." );
+#endif
+
+} // end SelectOpenCLEvaluator()
+
+
 /**
  * ******************* EvaluateMovingImageValueAndDerivative ******************
  */
@@ -898,6 +1254,225 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 } // end GetSelfHessian()
 
 
+/**
+ * ******************** GetCompressedSelfHessian ********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetCompressedSelfHessian(
+  const TransformParametersType & itkNotUsed( parameters ),
+  CSRHessianType & H ) const
+{
+  itkDebugMacro( "GetCompressedSelfHessian()" );
+
+  /** Set identity matrix as default implementation. */
+  H.SetDiagonalPattern( this->GetNumberOfParameters() );
+  H.Fill( 1.0 );
+
+} // end GetCompressedSelfHessian()
+
+
+/**
+ * ****************** InitializeSelfHessianPattern ******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeSelfHessianPattern( CSRHessianType & H ) const
+{
+  typedef typename CSRHessianType::IndexType         IndexType;
+  typedef typename CSRHessianType::RowPointersType   RowPointersType;
+  typedef typename CSRHessianType::ColumnIndicesType ColumnIndicesType;
+  typedef typename BSplineOrder1TransformType::RegionType GridRegionType;
+  typedef typename GridRegionType::SizeType               GridSizeType;
+
+  const NumberOfParametersType numberOfParameters = this->GetNumberOfParameters();
+
+  /** Get the B-spline transform, possibly the current transform of a combo transform. */
+  const AdvancedTransformType * transform = this->m_AdvancedTransform.GetPointer();
+  const CombinationTransformType * testPtr_combo
+    = dynamic_cast< const CombinationTransformType * >( transform );
+  if( testPtr_combo )
+  {
+    transform = testPtr_combo->GetCurrentTransform();
+  }
+  const BSplineOrder1TransformType * testPtr_1
+    = dynamic_cast< const BSplineOrder1TransformType * >( transform );
+  const BSplineOrder2TransformType * testPtr_2
+    = dynamic_cast< const BSplineOrder2TransformType * >( transform );
+  const BSplineOrder3TransformType * testPtr_3
+    = dynamic_cast< const BSplineOrder3TransformType * >( transform );
+
+  GridRegionType gridRegion;
+  int            splineOrder = 0;
+  if( testPtr_1 )
+  {
+    gridRegion  = testPtr_1->GetGridRegion();
+    splineOrder = 1;
+  }
+  else if( testPtr_2 )
+  {
+    gridRegion  = testPtr_2->GetGridRegion();
+    splineOrder = 2;
+  }
+  else if( testPtr_3 )
+  {
+    gridRegion  = testPtr_3->GetGridRegion();
+    splineOrder = 3;
+  }
+
+  const unsigned long numberOfControlPoints = gridRegion.GetNumberOfPixels();
+  if( splineOrder > 0
+    && numberOfControlPoints * FixedImageDimension == numberOfParameters )
+  {
+    /** Parameter d * N + c belongs to dimension d of control point c, with
+     * N the number of control points. Two control points have overlapping
+     * support if their grid indices differ at most splineOrder in each
+     * direction. All dimensions are coupled, so row d * N + c has nonzeros
+     * in columns e * N + c' for all e and all neighbours c' of c. Only the
+     * upper triangular part is stored.
+     */
+    const GridSizeType gridSize = gridRegion.GetSize();
+    unsigned long      strides[ FixedImageDimension ];
+    unsigned long      neighbours = 1;
+    for( unsigned int k = 0; k < FixedImageDimension; ++k )
+    {
+      strides[ k ] = ( k == 0 ) ? 1 : strides[ k - 1 ] * gridSize[ k - 1 ];
+      neighbours  *= vnl_math_min( static_cast< unsigned long >( 2 * splineOrder + 1 ),
+        static_cast< unsigned long >( gridSize[ k ] ) );
+    }
+
+    RowPointersType   rowPointers( numberOfParameters + 1 );
+    ColumnIndicesType columnIndices;
+    columnIndices.reserve( numberOfParameters * neighbours * ( FixedImageDimension + 1 ) / 2 );
+
+    long lo[ FixedImageDimension ];
+    long hi[ FixedImageDimension ];
+    long cur[ FixedImageDimension ];
+    for( unsigned long row = 0; row < numberOfParameters; ++row )
+    {
+      rowPointers[ row ] = columnIndices.size();
+
+      /** Compute the box of neighbouring control points. */
+      const unsigned long d = row / numberOfControlPoints;
+      unsigned long       c = row % numberOfControlPoints;
+      for( unsigned int k = 0; k < FixedImageDimension; ++k )
+      {
+        const long index = static_cast< long >( c % gridSize[ k ] );
+        c    /= gridSize[ k ];
+        lo[ k ] = vnl_math_max( index - splineOrder, 0L );
+        hi[ k ] = vnl_math_min( index + splineOrder, static_cast< long >( gridSize[ k ] ) - 1 );
+      }
+
+      /** Visit the neighbours in order of increasing column index. */
+      for( unsigned long e = d; e < FixedImageDimension; ++e )
+      {
+        std::copy( lo, lo + FixedImageDimension, cur );
+        bool done = false;
+        while( !done )
+        {
+          unsigned long col = e * numberOfControlPoints;
+          for( unsigned int k = 0; k < FixedImageDimension; ++k )
+          {
+            col += cur[ k ] * strides[ k ];
+          }
+          if( col >= row )
+          {
+            columnIndices.push_back( static_cast< IndexType >( col ) );
+          }
+
+          /** Next neighbour, x fastest. */
+          done = true;
+          for( unsigned int k = 0; k < FixedImageDimension; ++k )
+          {
+            if( cur[ k ] < hi[ k ] )
+            {
+              ++cur[ k ];
+              done = false;
+              break;
+            }
+            cur[ k ] = lo[ k ];
+          }
+        }
+      }
+    }
+    rowPointers[ numberOfParameters ] = columnIndices.size();
+
+    H.SetPattern( numberOfParameters, rowPointers, columnIndices );
+  }
+  else if( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() == numberOfParameters )
+  {
+    /** Every parameter is coupled to every other one. */
+    H.SetUpperTriangularPattern( numberOfParameters );
+  }
+  else
+  {
+    itkExceptionMacro( << "The sparsity pattern of the SelfHessian is not known "
+                       << "for this transform." );
+  }
+
+} // end InitializeSelfHessianPattern()
+
+
+/**
+ * *********************** GetNumberOfDeterministicWorkUnits ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+ThreadIdType
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetNumberOfDeterministicWorkUnits( const SizeValueType numberOfSamples ) const
+{
+  /** The threaded loops give each work unit ceil( samples / work units ) samples,
+   * so with few samples the last work units would be empty.
+   */
+  const SizeValueType maximumNumberOfWorkUnits = this->m_NumberOfDeterministicWorkUnits;
+  const SizeValueType samples                  = std::max< SizeValueType >( numberOfSamples, 1 );
+  const SizeValueType samplesPerWorkUnit       = ( samples + maximumNumberOfWorkUnits - 1 ) / maximumNumberOfWorkUnits;
+  return static_cast< ThreadIdType >( ( samples + samplesPerWorkUnit - 1 ) / samplesPerWorkUnit );
+
+} // end GetNumberOfDeterministicWorkUnits()
+
+
+/**
+ * *********************** InitializeDeterministicWorkUnits ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeDeterministicWorkUnits( const SizeValueType numberOfSamples ) const
+{
+  this->m_NumberOfWorkUnits = this->GetNumberOfDeterministicWorkUnits( numberOfSamples );
+
+  /** Allocate the derivatives of the used work units, and free the others.
+   * A derivative that is allocated is set to zero; the others are reset
+   * after each iteration by the accumulate functions.
+   */
+  const NumberOfParametersType numberOfParameters = this->GetNumberOfParameters();
+  const bool                   useSingle          = this->m_UseSinglePrecisionAccumulationInThreads;
+  for( ThreadIdType i = 0; i < this->m_GetValueAndDerivativePerThreadVariablesSize; ++i )
+  {
+    AlignedGetValueAndDerivativePerThreadStruct & workUnit = this->m_GetValueAndDerivativePerThreadVariables[ i ];
+    const NumberOfParametersType                  size     = i < this->m_NumberOfWorkUnits ? numberOfParameters : 0;
+    if( workUnit.st_Derivative.GetSize() != ( useSingle ? 0 : size ) )
+    {
+      workUnit.st_Derivative.SetSize( useSingle ? 0 : size );
+      workUnit.st_Derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    }
+    if( workUnit.st_SingleDerivative.GetSize() != ( useSingle ? size : 0 ) )
+    {
+      workUnit.st_SingleDerivative.SetSize( useSingle ? size : 0 );
+      workUnit.st_SingleDerivative.Fill( NumericTraits< SingleDerivativeValueType >::ZeroValue() );
+    }
+  }
+
+} // end InitializeDeterministicWorkUnits()
+
+
 /**
  * *********************** BeforeThreadedGetValueAndDerivative ***********************
  */
@@ -915,6 +1490,14 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
     {
       this->GetImageSampler()->Update();
     }
+
+    /** The number of work units depends on the number of samples. */
+    if( this->m_UseDeterministicReductionInThreads )
+    {
+      this->InitializeDeterministicWorkUnits( this->m_UseImageSampler
+        ? this->GetImageSampler()->GetOutput()->Size()
+        : static_cast< SizeValueType >( this->m_NumberOfDeterministicWorkUnits ) );
+    }
   }
 
 } // end BeforeThreadedGetValueAndDerivative()
@@ -929,13 +1512,19 @@ ITK_THREAD_RETURN_TYPE
 AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 ::GetValueThreaderCallback( void * arg )
 {
-  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
-  ThreadIdType     threadID   = infoStruct->ThreadID;
+  ThreadInfoType * infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID    = infoStruct->ThreadID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfThreads;
 
   MultiThreaderParameterType * temp
     = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
 
-  temp->st_Metric->ThreadedGetValue( threadID );
+  /** Process the work units of this thread. */
+  const ThreadIdType nrOfWorkUnits = temp->st_Metric->m_NumberOfWorkUnits;
+  for( ThreadIdType workUnit = threadID; workUnit < nrOfWorkUnits; workUnit += nrOfThreads )
+  {
+    temp->st_Metric->ThreadedGetValue( workUnit );
+  }
 
   return ITK_THREAD_RETURN_VALUE;
 
@@ -970,13 +1559,21 @@ ITK_THREAD_RETURN_TYPE
 AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 ::GetValueAndDerivativeThreaderCallback( void * arg )
 {
-  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
-  ThreadIdType     threadID   = infoStruct->ThreadID;
+  ThreadInfoType * infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID    = infoStruct->ThreadID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfThreads;
 
   MultiThreaderParameterType * temp
     = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
 
-  temp->st_Metric->ThreadedGetValueAndDerivative( threadID );
+  /** Process the work units of this thread. Without deterministic reduction
+   * there is one work unit per thread, with workUnit == threadID.
+   */
+  const ThreadIdType nrOfWorkUnits = temp->st_Metric->m_NumberOfWorkUnits;
+  for( ThreadIdType workUnit = threadID; workUnit < nrOfWorkUnits; workUnit += nrOfThreads )
+  {
+    temp->st_Metric->ThreadedGetValueAndDerivative( workUnit );
+  }
 
   return ITK_THREAD_RETURN_VALUE;
 
@@ -1031,10 +1628,61 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
    */
   const DerivativeValueType zero          = NumericTraits< DerivativeValueType >::Zero;
   const DerivativeValueType normalization = 1.0 / temp->st_NormalizationFactor;
+  const ThreadIdType        nrOfWorkUnits = temp->st_Metric->m_NumberOfWorkUnits;
+
+  /** With deterministic reduction, the derivatives of the work units are
+   * summed pairwise, in an order that does not depend on the number of threads.
+   */
+  if( temp->st_Metric->m_UseDeterministicReductionInThreads )
+  {
+    const bool                      useSingle  = temp->st_Metric->m_UseSinglePrecisionAccumulationInThreads;
+    const SingleDerivativeValueType singleZero = NumericTraits< SingleDerivativeValueType >::Zero;
+    DerivativeValueType             partialSums[ MaximumNumberOfDeterministicWorkUnits ];
+    for( unsigned int j = jmin; j < jmax; ++j )
+    {
+      for( ThreadIdType i = 0; i < nrOfWorkUnits; ++i )
+      {
+        AlignedGetValueAndDerivativePerThreadStruct & workUnit
+          = temp->st_Metric->m_GetValueAndDerivativePerThreadVariables[ i ];
+        if( useSingle )
+        {
+          partialSums[ i ]                  = workUnit.st_SingleDerivative[ j ];
+          workUnit.st_SingleDerivative[ j ] = singleZero;
+        }
+        else
+        {
+          partialSums[ i ]            = workUnit.st_Derivative[ j ];
+          workUnit.st_Derivative[ j ] = zero;
+        }
+      }
+      temp->st_DerivativePointer[ j ] = PairwiseSum( partialSums, nrOfWorkUnits ) * normalization;
+    }
+    return ITK_THREAD_RETURN_VALUE;
+  }
+
+  /** With single precision accumulation, only the sum is done in double. */
+  if( temp->st_Metric->m_UseSinglePrecisionAccumulationInThreads )
+  {
+    const SingleDerivativeValueType singleZero = NumericTraits< SingleDerivativeValueType >::Zero;
+    for( unsigned int j = jmin; j < jmax; ++j )
+    {
+      DerivativeValueType tmp = zero;
+      for( ThreadIdType i = 0; i < nrOfWorkUnits; ++i )
+      {
+        tmp += temp->st_Metric->m_GetValueAndDerivativePerThreadVariables[ i ].st_SingleDerivative[ j ];
+
+        /** Reset this variable for the next iteration. */
+        temp->st_Metric->m_GetValueAndDerivativePerThreadVariables[ i ].st_SingleDerivative[ j ] = singleZero;
+      }
+      temp->st_DerivativePointer[ j ] = tmp * normalization;
+    }
+    return ITK_THREAD_RETURN_VALUE;
+  }
+
   for( unsigned int j = jmin; j < jmax; ++j )
   {
     DerivativeValueType tmp = zero;
-    for( ThreadIdType i = 0; i < nrOfThreads; ++i )
+    for( ThreadIdType i = 0; i < nrOfWorkUnits; ++i )
     {
       tmp += temp->st_Metric->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative[ j ];
 
@@ -1049,6 +1697,303 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 } // end AccumulateDerivativesThreaderCallback()
 
 
+/**
+ *********** PairwiseSum *************
+ */
+
+template< class TFixedImage, class TMovingImage >
+template< class TValue >
+TValue
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::PairwiseSum( TValue * values, ThreadIdType n )
+{
+  /** Add the neighbours at distance 1, 2, 4, etc. The tree only depends
+   * on n, and the rounding error grows with log( n ) instead of n.
+   */
+  for( ThreadIdType stride = 1; stride < n; stride *= 2 )
+  {
+    for( ThreadIdType i = 0; i + stride < n; i += 2 * stride )
+    {
+      values[ i ] += values[ i + stride ];
+    }
+  }
+
+  return ( n > 0 ) ? values[ 0 ] : NumericTraits< TValue >::Zero;
+
+} // end PairwiseSum()
+
+
+/**
+ * **************** GetSelfHessianThreaderCallback *******
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetSelfHessianThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID   = infoStruct->ThreadID;
+
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Metric->ThreadedGetSelfHessian( threadID );
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end GetSelfHessianThreaderCallback()
+
+
+/**
+ * **************** AddSelfHessianFactorsThreaderCallback *******
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::AddSelfHessianFactorsThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID   = infoStruct->ThreadID;
+
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Metric->ThreadedAddSelfHessianFactors( threadID );
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end AddSelfHessianFactorsThreaderCallback()
+
+
+/**
+ * *********************** LaunchGetSelfHessianThreaderCallback***************
+ */
+
+template< class TFixedImage, class TMovingImage >
+SizeValueType
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::LaunchGetSelfHessianThreaderCallback(
+  ImageSampleContainerType * samples, const unsigned int numberOfFactors,
+  CSRHessianType & H ) const
+{
+  const ThreadIdType  numberOfThreads = this->m_NumberOfThreads;
+  const unsigned int  numberOfIndices = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  const unsigned long numberOfSamples = samples->Size();
+  const unsigned long valuesPerSample = numberOfFactors * numberOfIndices;
+
+  /** The factors of a block take about 16 MB. The block size does not
+   * influence the result.
+   */
+  const unsigned long blockSize = std::max< unsigned long >( 1,
+    ( 1UL << 21 ) / std::max< unsigned long >( valuesPerSample, 1 ) );
+
+  /** Divide the rows over the threads, with about the same number of
+   * nonzeros per thread. Every entry is owned by a single thread.
+   */
+  const typename CSRHessianType::RowPointersType & rowPointers  = H.GetRowPointers();
+  const SizeValueType                              numberOfRows = H.GetNumberOfRows();
+  this->m_SelfHessianRowBegin.resize( numberOfThreads + 1 );
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    const SizeValueType nonZeros = H.GetNumberOfNonZeros() * i / numberOfThreads;
+    this->m_SelfHessianRowBegin[ i ] = std::lower_bound(
+      rowPointers.begin(), rowPointers.begin() + numberOfRows, nonZeros ) - rowPointers.begin();
+  }
+  this->m_SelfHessianRowBegin[ numberOfThreads ] = numberOfRows;
+
+  /** Allocate the block. */
+  const unsigned long maximumBlockSize = std::min( blockSize, numberOfSamples );
+  this->m_SelfHessian                = &H;
+  this->m_SelfHessianSampleContainer = samples;
+  this->m_SelfHessianNumberOfFactors = numberOfFactors;
+  this->m_SelfHessianNumberOfIndices = numberOfIndices;
+  this->m_SelfHessianFactors.resize( maximumBlockSize * valuesPerSample );
+  this->m_SelfHessianIndices.resize( maximumBlockSize * numberOfIndices );
+  this->m_SelfHessianSampleCounted.resize( maximumBlockSize );
+  this->m_SelfHessianMissedPerThread.assign( numberOfThreads, 0 );
+
+  /** Process the samples block by block. */
+  void *        userData              = const_cast< void * >(
+    static_cast< const void * >( &this->m_ThreaderMetricParameters ) );
+  SizeValueType numberOfPixelsCounted = 0;
+  for( unsigned long blockBegin = 0; blockBegin < numberOfSamples; blockBegin += blockSize )
+  {
+    this->m_SelfHessianBlockBegin = blockBegin;
+    this->m_SelfHessianBlockEnd   = std::min( blockBegin + blockSize, numberOfSamples );
+    std::fill( this->m_SelfHessianSampleCounted.begin(), this->m_SelfHessianSampleCounted.end(), 0 );
+
+    /** Compute the factors of the samples of the block. */
+    this->m_Threader->SetSingleMethod( this->GetSelfHessianThreaderCallback, userData );
+    this->m_Threader->SingleMethodExecute();
+
+    /** Add their contributions to the rows of each thread. */
+    this->m_Threader->SetSingleMethod( this->AddSelfHessianFactorsThreaderCallback, userData );
+    this->m_Threader->SingleMethodExecute();
+
+    for( unsigned long k = 0; k < this->m_SelfHessianBlockEnd - blockBegin; ++k )
+    {
+      numberOfPixelsCounted += this->m_SelfHessianSampleCounted[ k ];
+    }
+  }
+
+  /** Gather the number of missed terms, and clean up. */
+  SizeValueType numberOfMissedTerms = 0;
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    numberOfMissedTerms += this->m_SelfHessianMissedPerThread[ i ];
+  }
+  this->m_SelfHessian                = 0;
+  this->m_SelfHessianSampleContainer = 0;
+  std::vector< HessianValueType >().swap( this->m_SelfHessianFactors );
+  NonZeroJacobianIndicesType().swap( this->m_SelfHessianIndices );
+  std::vector< unsigned char >().swap( this->m_SelfHessianSampleCounted );
+
+  /** A term outside the pattern means that InitializeSelfHessianPattern()
+   * does not match the Jacobian of the transform.
+   */
+  if( numberOfMissedTerms > 0 )
+  {
+    itkExceptionMacro( << numberOfMissedTerms << " terms of the SelfHessian fall outside "
+                       << "its sparsity pattern. The pattern does not match the nonzero "
+                       << "Jacobian indices of the transform." );
+  }
+
+  return numberOfPixelsCounted;
+
+} // end LaunchGetSelfHessianThreaderCallback()
+
+
+/**
+ * *********************** GetSelfHessianSamplesOfThread ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetSelfHessianSamplesOfThread( ThreadIdType threadID,
+  unsigned long & begin, unsigned long & end ) const
+{
+  const unsigned long blockSize = this->m_SelfHessianBlockEnd - this->m_SelfHessianBlockBegin;
+  const unsigned long nrOfSamplesPerThreads
+    = ( blockSize + this->m_NumberOfThreads - 1 ) / this->m_NumberOfThreads;
+
+  begin = std::min( nrOfSamplesPerThreads * threadID, blockSize ) + this->m_SelfHessianBlockBegin;
+  end   = std::min( nrOfSamplesPerThreads * ( threadID + 1 ), blockSize ) + this->m_SelfHessianBlockBegin;
+
+} // end GetSelfHessianSamplesOfThread()
+
+
+/**
+ * *********************** GetSelfHessianFactors ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename AdvancedImageToImageMetric< TFixedImage, TMovingImage >::HessianValueType
+* AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetSelfHessianFactors( unsigned long sampleNr,
+  const NonZeroJacobianIndicesType & nzji ) const
+{
+  const unsigned long k = sampleNr - this->m_SelfHessianBlockBegin;
+  const unsigned int  n = this->m_SelfHessianNumberOfIndices;
+
+  std::copy( nzji.begin(), nzji.begin() + n, this->m_SelfHessianIndices.begin() + k * n );
+  this->m_SelfHessianSampleCounted[ k ] = 1;
+  return &this->m_SelfHessianFactors[ k * this->m_SelfHessianNumberOfFactors * n ];
+
+} // end GetSelfHessianFactors()
+
+
+/**
+ * *********************** ThreadedAddSelfHessianFactors ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedAddSelfHessianFactors( ThreadIdType threadID ) const
+{
+  typedef typename CSRHessianType::IndexType              IndexType;
+  typedef typename NonZeroJacobianIndicesType::value_type JacobianIndexType;
+
+  const SizeValueType rowBegin = this->m_SelfHessianRowBegin[ threadID ];
+  const SizeValueType rowEnd   = this->m_SelfHessianRowBegin[ threadID + 1 ];
+  if( rowBegin == rowEnd )
+  {
+    return;
+  }
+
+  CSRHessianType &                H = *this->m_SelfHessian;
+  const unsigned int              m = this->m_SelfHessianNumberOfFactors;
+  const unsigned int              n = this->m_SelfHessianNumberOfIndices;
+  std::vector< HessianValueType > rowValues( n );
+  SizeValueType                   missed = 0;
+
+  for( unsigned long k = 0; k < this->m_SelfHessianBlockEnd - this->m_SelfHessianBlockBegin; ++k )
+  {
+    if( !this->m_SelfHessianSampleCounted[ k ] )
+    {
+      continue;
+    }
+    const HessianValueType *  factors = &this->m_SelfHessianFactors[ k * m * n ];
+    const JacobianIndexType * nzji    = &this->m_SelfHessianIndices[ k * n ];
+
+    /** For ascending indices, which is the usual case, the pairs (i, j), j >= i,
+     * lie in row nzji[ i ], and the rows of this thread are a range of i.
+     */
+    bool ascending = true;
+    for( unsigned int i = 1; i < n && ascending; ++i )
+    {
+      ascending = nzji[ i ] > nzji[ i - 1 ];
+    }
+
+    if( ascending )
+    {
+      const unsigned int iBegin = std::lower_bound( nzji, nzji + n, rowBegin ) - nzji;
+      const unsigned int iEnd   = std::lower_bound( nzji, nzji + n, rowEnd ) - nzji;
+      for( unsigned int i = iBegin; i < iEnd; ++i )
+      {
+        for( unsigned int j = i; j < n; ++j )
+        {
+          HessianValueType value = 0.0;
+          for( unsigned int a = 0; a < m; ++a )
+          {
+            value += factors[ a * n + i ] * factors[ a * n + j ];
+          }
+          rowValues[ j ] = value;
+        }
+        missed += H.AddToRow( static_cast< IndexType >( nzji[ i ] ), nzji + i, &rowValues[ i ], n - i );
+      }
+      continue;
+    }
+
+    /** Otherwise check the row of every pair. */
+    for( unsigned int i = 0; i < n; ++i )
+    {
+      for( unsigned int j = i; j < n; ++j )
+      {
+        const JacobianIndexType row = std::min( nzji[ i ], nzji[ j ] );
+        if( row < rowBegin || row >= rowEnd )
+        {
+          continue;
+        }
+        const JacobianIndexType col   = std::max( nzji[ i ], nzji[ j ] );
+        HessianValueType        value = 0.0;
+        for( unsigned int a = 0; a < m; ++a )
+        {
+          value += factors[ a * n + i ] * factors[ a * n + j ];
+        }
+        missed += H.AddToRow( static_cast< IndexType >( row ), &col, &value, 1 );
+      }
+    }
+  }
+
+  this->m_SelfHessianMissedPerThread[ threadID ] += missed;
+
+} // end ThreadedAddSelfHessianFactors()
+
+
 /**
  * *********************** CheckNumberOfSamples ***********************
  */
@@ -1138,10 +2083,31 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   os << indent.GetNextIndent() << "AdvancedTransform: "
      << this->m_AdvancedTransform.GetPointer() << std::endl;
 
+  /** Variables related to the specialized kernels. */
+  os << indent << "Variables related to the specialized kernels: " << std::endl;
+  os << indent.GetNextIndent() << "UseFastPathKernels: "
+     << this->m_UseFastPathKernels << std::endl;
+  os << indent.GetNextIndent() << "FastPathKernel: "
+     << this->m_FastPathKernel << std::endl;
+  os << indent.GetNextIndent() << "UseSinglePrecisionAccumulation: "
+     << this->m_UseSinglePrecisionAccumulation << std::endl;
+  os << indent.GetNextIndent() << "UseDeterministicReduction: "
+     << this->m_UseDeterministicReduction << std::endl;
+  os << indent.GetNextIndent() << "NumberOfDeterministicWorkUnits: "
+     << this->m_NumberOfDeterministicWorkUnits << std::endl;
+  os << indent.GetNextIndent() << "UseBSplineWeightTables: "
+     << this->m_UseBSplineWeightTables << std::endl;
+  os << indent.GetNextIndent() << "UseOpenCL: "
+     << this->m_UseOpenCL << std::endl;
+  os << indent.GetNextIndent() << "UseOpenCLEvaluator: "
+     << this->m_UseOpenCLEvaluator << std::endl;
+
   /** Other variables. */
   os << indent << "Other variables of the AdvancedImageToImageMetric: " << std::endl;
   os << indent.GetNextIndent() << "RequiredRatioOfValidSamples: "
      << this->m_RequiredRatioOfValidSamples << std::endl;
+  os << indent.GetNextIndent() << "RandomGenerator: "
+     << this->m_RandomGenerator.GetPointer() << std::endl;
   os << indent.GetNextIndent() << "UseMovingImageDerivativeScales: "
      << this->m_UseMovingImageDerivativeScales << std::endl;
   os << indent.GetNextIndent() << "MovingImageDerivativeScales: "
@@ -0,0 +1,181 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkCompressedSparseRowMatrix_h
+#define __itkCompressedSparseRowMatrix_h
+
+#include "vnl/vnl_sparse_matrix.h"
+#include "vnl/vnl_vector.h"
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * \class CompressedSparseRowMatrix
+ * \brief A sparse matrix with a fixed sparsity pattern, in compressed sparse
+ * row (CSR) format.
+ *
+ * The sparsity pattern is set once with SetPattern(), after which only the
+ * values of the entries in the pattern can be changed. Since the pattern does
+ * not change, different rows can be updated concurrently by different threads,
+ * without any memory allocation. This makes the class suitable for assembling
+ * the SelfHessian of a metric, of which the pattern is known in advance from
+ * the support of the transform parameters.
+ *
+ * The class does not know about symmetry. The SelfHessian only stores the
+ * upper triangular part, so for those matrices entry (i,j) with i > j should
+ * be read as GetEntry(j,i).
+ *
+ * \ingroup CostFunctions
+ */
+
+template< class TValue >
+class CompressedSparseRowMatrix
+{
+public:
+
+  /** Standard typedefs. */
+  typedef CompressedSparseRowMatrix Self;
+
+  typedef TValue                         ValueType;
+  typedef unsigned int                   IndexType;
+  typedef std::size_t                    OffsetType;
+  typedef std::vector< OffsetType >      RowPointersType;
+  typedef std::vector< IndexType >       ColumnIndicesType;
+  typedef std::vector< ValueType >       ValuesType;
+  typedef vnl_sparse_matrix< ValueType > VnlSparseMatrixType;
+  typedef vnl_vector< ValueType >        VnlVectorType;
+
+  /** Constructor, creating an empty matrix. */
+  CompressedSparseRowMatrix();
+
+  /** Set the sparsity pattern. The rowPointers contain the offsets in
+   * columnIndices at which each row starts, plus the total number of
+   * entries at the end. The column indices of each row must be sorted
+   * in ascending order. All values are set to zero.
+   */
+  void SetPattern( IndexType numberOfColumns,
+    const RowPointersType & rowPointers,
+    const ColumnIndicesType & columnIndices );
+
+  /** Set a pattern with only the diagonal entries. */
+  void SetDiagonalPattern( IndexType size );
+
+  /** Set a pattern with all entries on and above the diagonal. */
+  void SetUpperTriangularPattern( IndexType size );
+
+  /** Get the size of the matrix and the number of entries in the pattern. */
+  IndexType GetNumberOfRows( void ) const
+  { return this->m_RowPointers.empty() ? 0 : static_cast< IndexType >( this->m_RowPointers.size() - 1 ); }
+  IndexType GetNumberOfColumns( void ) const { return this->m_NumberOfColumns; }
+  OffsetType GetNumberOfNonZeros( void ) const { return this->m_ColumnIndices.size(); }
+
+  /** Direct access to the CSR arrays. */
+  const RowPointersType & GetRowPointers( void ) const { return this->m_RowPointers; }
+  const ColumnIndicesType & GetColumnIndices( void ) const { return this->m_ColumnIndices; }
+  const ValuesType & GetValues( void ) const { return this->m_Values; }
+  ValuesType & GetValues( void ) { return this->m_Values; }
+
+  /** Check if two matrices have the same pattern. */
+  bool HasSamePattern( const Self & other ) const;
+
+  /** Set all values in the pattern. */
+  void Fill( const ValueType & value );
+
+  /** Multiply all values by a factor. */
+  void Scale( const ValueType & factor );
+
+  /** Get a pointer to entry (row,col), or 0 if it is not in the pattern. */
+  ValueType * GetEntryPointer( IndexType row, IndexType col );
+
+  /** Get entry (row,col), which is zero if it is not in the pattern. */
+  ValueType GetEntry( IndexType row, IndexType col ) const;
+
+  /** Add values to the entries (row, cols[k]), k = 0 .. n-1. The columns are
+   * preferably sorted in ascending order, which makes it a single pass over
+   * the row. Returns the number of values that could not be added, because
+   * their entry is not in the pattern.
+   */
+  template< class TColumnIndex >
+  unsigned int AddToRow( IndexType row,
+    const TColumnIndex * cols, const ValueType * values, unsigned int n )
+  {
+    if( this->m_RowPointers[ row ] == this->m_RowPointers[ row + 1 ] )
+    {
+      return n;
+    }
+    const IndexType * rowBegin = &this->m_ColumnIndices[ 0 ] + this->m_RowPointers[ row ];
+    const IndexType * rowEnd   = &this->m_ColumnIndices[ 0 ] + this->m_RowPointers[ row + 1 ];
+    ValueType *       rowData  = &this->m_Values[ 0 ] + this->m_RowPointers[ row ];
+    const IndexType * it       = rowBegin;
+    unsigned int      missed   = 0;
+
+    for( unsigned int k = 0; k < n; ++k )
+    {
+      const IndexType col = static_cast< IndexType >( cols[ k ] );
+      if( k > 0 && col < static_cast< IndexType >( cols[ k - 1 ] ) )
+      {
+        it = rowBegin;
+      }
+      it = this->LowerBound( it, rowEnd, col );
+      if( it != rowEnd && *it == col )
+      {
+        rowData[ it - rowBegin ] += values[ k ];
+      }
+      else
+      {
+        ++missed;
+      }
+    }
+    return missed;
+  }
+
+
+  /** Add weight * other to this matrix. This is fastest if both matrices
+   * have the same pattern. Otherwise, the pattern of other should be a
+   * subset of this pattern; the number of nonzero entries of other that
+   * are not in this pattern, and are therefore ignored, is returned.
+   */
+  OffsetType Add( const Self & other, const ValueType & weight );
+
+  /** Get the diagonal of the matrix. */
+  void GetDiagonal( VnlVectorType & diagonal ) const;
+
+  /** Convert to a vnl_sparse_matrix. Zero entries are not stored. */
+  void GetVnlSparseMatrix( VnlSparseMatrixType & matrix ) const;
+
+private:
+
+  /** Find the first column index in [begin,end) that is not smaller than col. */
+  static const IndexType * LowerBound( const IndexType * begin,
+    const IndexType * end, IndexType col );
+
+  IndexType         m_NumberOfColumns;
+  RowPointersType   m_RowPointers;
+  ColumnIndicesType m_ColumnIndices;
+  ValuesType        m_Values;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkCompressedSparseRowMatrix.hxx"
+#endif
+
+#endif // end #ifndef __itkCompressedSparseRowMatrix_h
@@ -0,0 +1,325 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkCompressedSparseRowMatrix_hxx
+#define __itkCompressedSparseRowMatrix_hxx
+
+#include "itkCompressedSparseRowMatrix.h"
+#include <algorithm>
+
+namespace itk
+{
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+template< class TValue >
+CompressedSparseRowMatrix< TValue >
+::CompressedSparseRowMatrix()
+{
+  this->m_NumberOfColumns = 0;
+
+} // end Constructor
+
+
+/**
+ * ********************* SetPattern *****************************
+ */
+
+template< class TValue >
+void
+CompressedSparseRowMatrix< TValue >
+::SetPattern( IndexType numberOfColumns,
+  const RowPointersType & rowPointers,
+  const ColumnIndicesType & columnIndices )
+{
+  this->m_NumberOfColumns = numberOfColumns;
+  this->m_RowPointers     = rowPointers;
+  this->m_ColumnIndices   = columnIndices;
+  this->m_Values.assign( columnIndices.size(), ValueType( 0 ) );
+
+} // end SetPattern()
+
+
+/**
+ * ****************** SetDiagonalPattern ************************
+ */
+
+template< class TValue >
+void
+CompressedSparseRowMatrix< TValue >
+::SetDiagonalPattern( IndexType size )
+{
+  this->m_NumberOfColumns = size;
+  this->m_RowPointers.resize( size + 1 );
+  this->m_ColumnIndices.resize( size );
+  for( IndexType i = 0; i < size; ++i )
+  {
+    this->m_RowPointers[ i ]   = i;
+    this->m_ColumnIndices[ i ] = i;
+  }
+  this->m_RowPointers[ size ] = size;
+  this->m_Values.assign( size, ValueType( 0 ) );
+
+} // end SetDiagonalPattern()
+
+
+/**
+ * *************** SetUpperTriangularPattern ********************
+ */
+
+template< class TValue >
+void
+CompressedSparseRowMatrix< TValue >
+::SetUpperTriangularPattern( IndexType size )
+{
+  this->m_NumberOfColumns = size;
+  this->m_RowPointers.resize( size + 1 );
+  this->m_ColumnIndices.resize( static_cast< OffsetType >( size ) * ( size + 1 ) / 2 );
+  OffsetType offset = 0;
+  for( IndexType i = 0; i < size; ++i )
+  {
+    this->m_RowPointers[ i ] = offset;
+    for( IndexType j = i; j < size; ++j, ++offset )
+    {
+      this->m_ColumnIndices[ offset ] = j;
+    }
+  }
+  this->m_RowPointers[ size ] = offset;
+  this->m_Values.assign( offset, ValueType( 0 ) );
+
+} // end SetUpperTriangularPattern()
+
+
+/**
+ * ********************* HasSamePattern *************************
+ */
+
+template< class TValue >
+bool
+CompressedSparseRowMatrix< TValue >
+::HasSamePattern( const Self & other ) const
+{
+  return this->m_NumberOfColumns == other.m_NumberOfColumns
+         && this->m_RowPointers == other.m_RowPointers
+         && this->m_ColumnIndices == other.m_ColumnIndices;
+
+} // end HasSamePattern()
+
+
+/**
+ * ************************* Fill *******************************
+ */
+
+template< class TValue >
+void
+CompressedSparseRowMatrix< TValue >
+::Fill( const ValueType & value )
+{
+  std::fill( this->m_Values.begin(), this->m_Values.end(), value );
+
+} // end Fill()
+
+
+/**
+ * ************************* Scale ******************************
+ */
+
+template< class TValue >
+void
+CompressedSparseRowMatrix< TValue >
+::Scale( const ValueType & factor )
+{
+  typename ValuesType::iterator it;
+  for( it = this->m_Values.begin(); it != this->m_Values.end(); ++it )
+  {
+    *it *= factor;
+  }
+
+} // end Scale()
+
+
+/**
+ * ********************* LowerBound *****************************
+ */
+
+template< class TValue >
+const typename CompressedSparseRowMatrix< TValue >::IndexType *
+CompressedSparseRowMatrix< TValue >
+::LowerBound( const IndexType * begin, const IndexType * end, IndexType col )
+{
+  /** The columns are usually visited in order, so first try a few steps. */
+  for( unsigned int k = 0; k < 4 && begin != end; ++k, ++begin )
+  {
+    if( *begin >= col )
+    {
+      return begin;
+    }
+  }
+  return std::lower_bound( begin, end, col );
+
+} // end LowerBound()
+
+
+/**
+ * ******************** GetEntryPointer *************************
+ */
+
+template< class TValue >
+typename CompressedSparseRowMatrix< TValue >::ValueType *
+CompressedSparseRowMatrix< TValue >
+::GetEntryPointer( IndexType row, IndexType col )
+{
+  if( row >= this->GetNumberOfRows()
+    || this->m_RowPointers[ row ] == this->m_RowPointers[ row + 1 ] )
+  {
+    return 0;
+  }
+  const IndexType * rowBegin = &this->m_ColumnIndices[ 0 ] + this->m_RowPointers[ row ];
+  const IndexType * rowEnd   = &this->m_ColumnIndices[ 0 ] + this->m_RowPointers[ row + 1 ];
+  const IndexType * it       = std::lower_bound( rowBegin, rowEnd, col );
+  if( it == rowEnd || *it != col )
+  {
+    return 0;
+  }
+  return &this->m_Values[ 0 ] + ( it - &this->m_ColumnIndices[ 0 ] );
+
+} // end GetEntryPointer()
+
+
+/**
+ * *********************** GetEntry *****************************
+ */
+
+template< class TValue >
+typename CompressedSparseRowMatrix< TValue >::ValueType
+CompressedSparseRowMatrix< TValue >
+::GetEntry( IndexType row, IndexType col ) const
+{
+  const ValueType * entry = const_cast< Self * >( this )->GetEntryPointer( row, col );
+  return entry ? *entry : ValueType( 0 );
+
+} // end GetEntry()
+
+
+/**
+ * ************************** Add *******************************
+ */
+
+template< class TValue >
+typename CompressedSparseRowMatrix< TValue >::OffsetType
+CompressedSparseRowMatrix< TValue >
+::Add( const Self & other, const ValueType & weight )
+{
+  /** Fast path: the same pattern. */
+  if( this->HasSamePattern( other ) )
+  {
+    for( OffsetType k = 0; k < this->m_Values.size(); ++k )
+    {
+      this->m_Values[ k ] += weight * other.m_Values[ k ];
+    }
+    return 0;
+  }
+
+  /** Add the nonzero entries of other row by row. */
+  OffsetType        missed       = 0;
+  const IndexType   numberOfRows = other.GetNumberOfRows();
+  ColumnIndicesType rowColumns;
+  ValuesType        rowValues;
+  for( IndexType i = 0; i < numberOfRows; ++i )
+  {
+    rowColumns.clear();
+    rowValues.clear();
+    for( OffsetType k = other.m_RowPointers[ i ]; k < other.m_RowPointers[ i + 1 ]; ++k )
+    {
+      if( other.m_Values[ k ] != ValueType( 0 ) )
+      {
+        rowColumns.push_back( other.m_ColumnIndices[ k ] );
+        rowValues.push_back( weight * other.m_Values[ k ] );
+      }
+    }
+    if( rowColumns.empty() )
+    {
+      continue;
+    }
+    if( i >= this->GetNumberOfRows() )
+    {
+      missed += rowColumns.size();
+      continue;
+    }
+    missed += this->AddToRow( i, &rowColumns[ 0 ], &rowValues[ 0 ],
+      static_cast< unsigned int >( rowColumns.size() ) );
+  }
+  return missed;
+
+} // end Add()
+
+
+/**
+ * ********************** GetDiagonal ***************************
+ */
+
+template< class TValue >
+void
+CompressedSparseRowMatrix< TValue >
+::GetDiagonal( VnlVectorType & diagonal ) const
+{
+  const IndexType numberOfRows = this->GetNumberOfRows();
+  diagonal.set_size( numberOfRows );
+  for( IndexType i = 0; i < numberOfRows; ++i )
+  {
+    diagonal[ i ] = this->GetEntry( i, i );
+  }
+
+} // end GetDiagonal()
+
+
+/**
+ * ******************* GetVnlSparseMatrix ***********************
+ */
+
+template< class TValue >
+void
+CompressedSparseRowMatrix< TValue >
+::GetVnlSparseMatrix( VnlSparseMatrixType & matrix ) const
+{
+  typedef typename VnlSparseMatrixType::row    RowType;
+  typedef typename VnlSparseMatrixType::pair_t ElementType;
+
+  const IndexType numberOfRows = this->GetNumberOfRows();
+  matrix.set_size( numberOfRows, this->m_NumberOfColumns );
+  for( IndexType i = 0; i < numberOfRows; ++i )
+  {
+    /** The columns are sorted, so the row can be filled at once. */
+    RowType & row = matrix.get_row( i );
+    row.reserve( this->m_RowPointers[ i + 1 ] - this->m_RowPointers[ i ] );
+    for( OffsetType k = this->m_RowPointers[ i ]; k < this->m_RowPointers[ i + 1 ]; ++k )
+    {
+      if( this->m_Values[ k ] != ValueType( 0 ) )
+      {
+        row.push_back( ElementType( this->m_ColumnIndices[ k ], this->m_Values[ k ] ) );
+      }
+    }
+  }
+
+} // end GetVnlSparseMatrix()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkCompressedSparseRowMatrix_hxx
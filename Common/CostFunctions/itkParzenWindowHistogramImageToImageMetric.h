@@ -262,6 +262,10 @@ protected:
   typedef IncrementalMarginalPDFType::SizeType         IncrementalMarginalPDFSizeType;
   typedef Array< PDFValueType >                        ParzenValueContainerType;
 
+  /** The maximum size of the Parzen window, for B-spline kernels up to
+   * order 3. Used to allocate the Parzen values on the stack. */
+  itkStaticConstMacro( MaximumParzenWindowSize, unsigned int, 4 );
+
   /** Typedefs for Parzen kernel. */
   typedef KernelFunctionBase2< PDFValueType >  KernelFunctionType;
   typedef typename KernelFunctionType::Pointer KernelFunctionPointer;
@@ -324,9 +328,14 @@ protected:
   /** Initialize threading related parameters. */
   virtual void InitializeThreadingParameters( void ) const;
 
-  /** Multi-threaded versions of the ComputePDF function. */
+  /** Multi-threaded versions of the ComputePDF function.
+   * Dispatches to ThreadedComputePDFsKernel(). */
   inline void ThreadedComputePDFs( ThreadIdType threadId );
 
+  /** The loop over the samples of ThreadedComputePDFs(). */
+  template< class TSampleEvaluator >
+  void ThreadedComputePDFsKernel( ThreadIdType threadId );
+
   /** Single-threadedly accumulate results. */
   inline void AfterThreadedComputePDFs( void ) const;
 
@@ -470,18 +470,22 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   jointPDFRegion.SetIndex( jointPDFIndex );
   jointPDFRegion.SetSize( jointPDFSize );
 
-  /** Only resize the array of structs when needed. */
-  if( this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariablesSize != this->m_NumberOfThreads )
+  /** Only resize the array of structs when needed. With deterministic reduction
+   * the number of work units may be lowered in each iteration, so do not shrink.
+   */
+  if( this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariablesSize < this->m_NumberOfWorkUnits
+    || ( !this->m_UseDeterministicReductionInThreads
+    && this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariablesSize != this->m_NumberOfWorkUnits ) )
   {
     delete[] this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables;
     this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables
       = new AlignedParzenWindowHistogramGetValueAndDerivativePerThreadStruct[
-      this->m_NumberOfThreads ];
-    this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariablesSize = this->m_NumberOfThreads;
+      this->m_NumberOfWorkUnits ];
+    this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariablesSize = this->m_NumberOfWorkUnits;
   }
 
   /** Some initialization. */
-  for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
+  for( ThreadIdType i = 0; i < this->m_NumberOfWorkUnits; ++i )
   {
     this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted = NumericTraits< SizeValueType >::Zero;
 
@@ -582,9 +586,13 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
     = static_cast< OffsetValueType >( vcl_floor(
     movingImageParzenWindowTerm + this->m_MovingParzenTermToIndexOffset ) );
 
-  /** The Parzen values. */
-  ParzenValueContainerType fixedParzenValues( this->m_JointPDFWindow.GetSize()[ 1 ] );
-  ParzenValueContainerType movingParzenValues( this->m_JointPDFWindow.GetSize()[ 0 ] );
+  /** The Parzen values. Allocate memory on the stack. */
+  PDFValueType             fixedParzenValuesArray[ MaximumParzenWindowSize ];
+  PDFValueType             movingParzenValuesArray[ MaximumParzenWindowSize ];
+  ParzenValueContainerType fixedParzenValues( fixedParzenValuesArray,
+                                              this->m_JointPDFWindow.GetSize()[ 1 ], false );
+  ParzenValueContainerType movingParzenValues( movingParzenValuesArray,
+                                               this->m_JointPDFWindow.GetSize()[ 0 ], false );
   this->EvaluateParzenValues(
     fixedImageParzenWindowTerm, fixedImageParzenWindowIndex,
     this->m_FixedKernel, fixedParzenValues );
@@ -621,8 +629,9 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   else
   {
     /** Compute the derivatives of the moving Parzen window. */
-    ParzenValueContainerType derivativeMovingParzenValues(
-    this->m_JointPDFWindow.GetSize()[ 0 ] );
+    PDFValueType             derivativeMovingParzenValuesArray[ MaximumParzenWindowSize ];
+    ParzenValueContainerType derivativeMovingParzenValues( derivativeMovingParzenValuesArray,
+                                                           this->m_JointPDFWindow.GetSize()[ 0 ], false );
     this->EvaluateParzenValues(
       movingImageParzenWindowTerm, movingImageParzenWindowIndex,
       this->m_DerivativeMovingKernel, derivativeMovingParzenValues );
@@ -846,9 +855,13 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   PDFDerivativeValueType * incRightBasePtr = this->m_IncrementalJointPDFRight->GetBufferPointer();
   PDFDerivativeValueType * incLeftBasePtr  = this->m_IncrementalJointPDFLeft->GetBufferPointer();
 
-  /** The Parzen value containers. */
-  ParzenValueContainerType fixedParzenValues( this->m_JointPDFWindow.GetSize()[ 1 ] );
-  ParzenValueContainerType movingParzenValues( this->m_JointPDFWindow.GetSize()[ 0 ] );
+  /** The Parzen value containers. Allocate memory on the stack. */
+  PDFValueType             fixedParzenValuesArray[ MaximumParzenWindowSize ];
+  PDFValueType             movingParzenValuesArray[ MaximumParzenWindowSize ];
+  ParzenValueContainerType fixedParzenValues( fixedParzenValuesArray,
+                                              this->m_JointPDFWindow.GetSize()[ 1 ], false );
+  ParzenValueContainerType movingParzenValues( movingParzenValuesArray,
+                                               this->m_JointPDFWindow.GetSize()[ 0 ], false );
 
   /** Determine fixed image Parzen window arguments (see eq. 6 of Mattes paper [2]). */
   const double fixedImageParzenWindowTerm
@@ -1154,6 +1167,24 @@ void
 ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 ::ThreadedComputePDFs( ThreadIdType threadId )
 {
+  itkAdvancedImageToImageMetricDispatchKernelMacro( ThreadedComputePDFsKernel, ( threadId ) );
+
+} // end ThreadedComputePDFs()
+
+
+/**
+ * ******************* ThreadedComputePDFsKernel *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+template< class TSampleEvaluator >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedComputePDFsKernel( ThreadIdType threadId )
+{
+  /** The evaluator of the transform, mask and interpolator. */
+  TSampleEvaluator evaluator( this );
+
   /** Get a handle to the pre-allocated joint PDF for the current thread.
    * The initialization is performed here, so that it is done multi-threadedly
    * instead of sequentially in InitializeThreadingParameters().
@@ -1168,7 +1199,7 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   /** Get the samples for this thread. */
   const unsigned long nrOfSamplesPerThreads
     = static_cast< unsigned long >( vcl_ceil( static_cast< double >( sampleContainerSize )
-    / static_cast< double >( this->m_NumberOfThreads ) ) );
+    / static_cast< double >( this->m_NumberOfWorkUnits ) ) );
 
   unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
   unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
@@ -1194,12 +1225,12 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
     MovingImagePointType        mappedPoint;
 
     /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    bool sampleOk = evaluator.TransformPoint( fixedPoint, mappedPoint );
 
     /** Check if point is inside mask. */
     if( sampleOk )
     {
-      sampleOk = this->IsInsideMovingMask( mappedPoint );
+      sampleOk = evaluator.IsInsideMovingMask( mappedPoint );
     }
 
     /** Compute the moving image value and check if the point is
@@ -1207,7 +1238,7 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
      */
     if( sampleOk )
     {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
+      sampleOk = evaluator.EvaluateMovingImageValueAndDerivative(
         mappedPoint, movingImageValue, 0 );
     }
 
@@ -1232,7 +1263,7 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
 
-} // end ThreadedComputePDFs()
+} // end ThreadedComputePDFsKernel()
 
 
 /**
@@ -1247,7 +1278,7 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   /** Accumulate the number of pixels. */
   this->m_NumberOfPixelsCounted
     = this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ 0 ].st_NumberOfPixelsCounted;
-  for( ThreadIdType i = 1; i < this->m_NumberOfThreads; ++i )
+  for( ThreadIdType i = 1; i < this->m_NumberOfWorkUnits; ++i )
   {
     this->m_NumberOfPixelsCounted
       += this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted;
@@ -1264,36 +1295,24 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   /** Compute alpha. */
   this->m_Alpha = 1.0 / static_cast< double >( this->m_NumberOfPixelsCounted );
 
-  /** Accumulate joint histogram. */
+  /** Accumulate joint histogram. The histograms of all threads have the
+   * same region, so their buffers can be summed directly, without
+   * allocating an iterator per thread in every iteration.
+   */
   // could be multi-threaded too, by each thread updating only a part of the JointPDF.
-  typedef ImageScanlineIterator< JointPDFType > JointPDFIteratorType;
-  JointPDFIteratorType                it( this->m_JointPDF, this->m_JointPDF->GetBufferedRegion() );
-  std::vector< JointPDFIteratorType > itT( this->m_NumberOfThreads );
-  for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
+  PDFValueType *      jointPDFBuffer = this->m_JointPDF->GetBufferPointer();
+  const SizeValueType numberOfBins   = this->m_JointPDF->GetBufferedRegion().GetNumberOfPixels();
+  for( SizeValueType j = 0; j < numberOfBins; ++j )
   {
-    itT[ i ] = JointPDFIteratorType(
-      this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_JointPDF,
-      this->m_JointPDF->GetBufferedRegion() );
+    jointPDFBuffer[ j ] = NumericTraits< PDFValueType >::Zero;
   }
-
-  PDFValueType sum;
-  while( !it.IsAtEnd() )
+  for( ThreadIdType i = 0; i < this->m_NumberOfWorkUnits; ++i )
   {
-    while( !it.IsAtEndOfLine() )
+    const PDFValueType * threadBuffer
+      = this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_JointPDF->GetBufferPointer();
+    for( SizeValueType j = 0; j < numberOfBins; ++j )
     {
-      sum = NumericTraits< PDFValueType >::Zero;
-      for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
-      {
-        sum += itT[ i ].Value();
-        ++itT[ i ];
-      }
-      it.Set( sum );
-      ++it;
-    }
-    it.NextLine();
-    for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
-    {
-      itT[ i ].NextLine();
+      jointPDFBuffer[ j ] += threadBuffer[ j ];
     }
   }
 
@@ -1309,13 +1328,19 @@ ITK_THREAD_RETURN_TYPE
 ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 ::ComputePDFsThreaderCallback( void * arg )
 {
-  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
-  ThreadIdType     threadId   = infoStruct->ThreadID;
+  ThreadInfoType * infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId    = infoStruct->ThreadID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfThreads;
 
   ParzenWindowHistogramMultiThreaderParameterType * temp
     = static_cast< ParzenWindowHistogramMultiThreaderParameterType * >( infoStruct->UserData );
 
-  temp->m_Metric->ThreadedComputePDFs( threadId );
+  /** Process the work units of this thread. */
+  const ThreadIdType nrOfWorkUnits = temp->m_Metric->m_NumberOfWorkUnits;
+  for( ThreadIdType workUnit = threadId; workUnit < nrOfWorkUnits; workUnit += nrOfThreads )
+  {
+    temp->m_Metric->ThreadedComputePDFs( workUnit );
+  }
 
   return ITK_THREAD_RETURN_VALUE;
 
@@ -0,0 +1,105 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkThreadScratchArena_h
+#define __itkThreadScratchArena_h
+
+#include "itkArray.h"
+#include "itkIntTypes.h"
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * \class ThreadScratchArena
+ * \brief A buffer from which the temporary arrays of one thread are taken.
+ *
+ * The arena owns a single contiguous buffer. Allocate() lets an itk::Array
+ * point into this buffer, without transferring ownership, in the same way
+ * as the B-spline transforms wrap their weights around a stack array.
+ * Release() makes all memory available again at once. The buffer is only
+ * reallocated by Reserve() when it has to grow, so an arena that lives
+ * across iterations and resolutions makes no heap allocations once it has
+ * reached its final size.
+ *
+ * If an allocation does not fit, the array allocates its own memory, and
+ * GetNumberOfOverflows() is incremented. This is correct but slow, so
+ * the arena should be reserved large enough beforehand.
+ *
+ * The arena is not thread-safe; each thread should have its own.
+ * The arrays obtained from the arena are invalidated by Reserve(), and
+ * should not be used after Release().
+ *
+ * \ingroup CostFunctions
+ */
+
+template< class TValue >
+class ThreadScratchArena
+{
+public:
+
+  /** Standard typedefs. */
+  typedef ThreadScratchArena Self;
+
+  typedef TValue                   ValueType;
+  typedef Array< ValueType >       ArrayType;
+  typedef std::vector< ValueType > BufferType;
+
+  /** Constructor, creating an empty arena. */
+  ThreadScratchArena();
+
+  /** Make sure the arena can hold at least numberOfValues values,
+   * and release all memory.
+   */
+  void Reserve( SizeValueType numberOfValues );
+
+  /** Let array point to size values of the arena. The values are not
+   * initialized.
+   */
+  void Allocate( ArrayType & array, SizeValueType size );
+
+  /** Make all memory of the arena available again. */
+  void Release( void ) { this->m_NumberOfAllocatedValues = 0; }
+
+  /** Get the number of values the arena can hold. */
+  SizeValueType GetCapacity( void ) const
+  { return static_cast< SizeValueType >( this->m_Buffer.size() ); }
+
+  /** Get the number of values handed out since the last Release(). */
+  SizeValueType GetNumberOfAllocatedValues( void ) const
+  { return this->m_NumberOfAllocatedValues; }
+
+  /** Get the number of allocations that did not fit in the arena. */
+  SizeValueType GetNumberOfOverflows( void ) const
+  { return this->m_NumberOfOverflows; }
+
+private:
+
+  BufferType    m_Buffer;
+  SizeValueType m_NumberOfAllocatedValues;
+  SizeValueType m_NumberOfOverflows;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkThreadScratchArena.hxx"
+#endif
+
+#endif // end #ifndef __itkThreadScratchArena_h
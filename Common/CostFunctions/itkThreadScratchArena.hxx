@@ -0,0 +1,91 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkThreadScratchArena_hxx
+#define __itkThreadScratchArena_hxx
+
+#include "itkThreadScratchArena.h"
+
+namespace itk
+{
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+template< class TValue >
+ThreadScratchArena< TValue >
+::ThreadScratchArena()
+{
+  this->m_NumberOfAllocatedValues = 0;
+  this->m_NumberOfOverflows       = 0;
+
+} // end Constructor
+
+
+/**
+ * ********************* Reserve ****************************
+ */
+
+template< class TValue >
+void
+ThreadScratchArena< TValue >
+::Reserve( SizeValueType numberOfValues )
+{
+  /** Only grow, to avoid reallocations when the size alternates. */
+  if( numberOfValues > this->m_Buffer.size() )
+  {
+    BufferType( numberOfValues ).swap( this->m_Buffer );
+  }
+  this->m_NumberOfAllocatedValues = 0;
+
+} // end Reserve()
+
+
+/**
+ * ********************* Allocate ****************************
+ */
+
+template< class TValue >
+void
+ThreadScratchArena< TValue >
+::Allocate( ArrayType & array, SizeValueType size )
+{
+  if( size > 0 && this->m_NumberOfAllocatedValues + size <= this->m_Buffer.size() )
+  {
+    array.SetData( &this->m_Buffer[ this->m_NumberOfAllocatedValues ], size, false );
+    this->m_NumberOfAllocatedValues += size;
+    return;
+  }
+
+  /** It does not fit, so let the array allocate its own memory.
+   * SetData() first, to make sure the array does not resize into
+   * the memory of the arena.
+   */
+  if( size > 0 )
+  {
+    ++this->m_NumberOfOverflows;
+  }
+  array.SetData( 0, 0, false );
+  array.SetSize( size );
+
+} // end Allocate()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkThreadScratchArena_hxx
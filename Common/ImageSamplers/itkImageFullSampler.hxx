@@ -34,6 +34,12 @@ void
 ImageFullSampler< TInputImage >
 ::GenerateData( void )
 {
+  /** Reuse the samples of another sampler with the same input and settings. */
+  if( this->CopyPrecomputedSampleContainer() )
+  {
+    return;
+  }
+
   /** If desired we exercise a multi-threaded version. */
   if( this->m_UseMultiThread )
   {
@@ -66,6 +66,12 @@ void
 ImageGridSampler< TInputImage >
 ::GenerateData( void )
 {
+  /** Reuse the samples of another sampler with the same input and settings. */
+  if( this->CopyPrecomputedSampleContainer() )
+  {
+    return;
+  }
+
   /** Get handles to the input image, output sample container, and the mask. */
   InputImageConstPointer inputImage = this->GetInput();
   typename ImageSampleContainerType::Pointer sampleContainer = this->GetOutput();
@@ -21,6 +21,7 @@
 #include "itkImageRandomSamplerBase.h"
 #include "itkInterpolateImageFunction.h"
 #include "itkBSplineInterpolateImageFunction.h"
+#include "itkBSplineDecompositionImageFilter.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 
 namespace itk
@@ -33,6 +34,13 @@ namespace itk
  * This image sampler generates not only samples that correspond with
  * pixel locations, but selects points in physical space.
  *
+ * With UseBatchedInterpolation, and a 3rd order B-spline interpolator, the
+ * image values at the random coordinates are not computed by the interpolator,
+ * but by EvaluateCubicBSplineBatch(). It uses a float B-spline coefficient image,
+ * which is only recomputed when the input image changes, and computes the
+ * weights of a batch of samples in tight loops that the compiler can vectorize.
+ * Without a mask the batches are distributed over the threads.
+ *
  * \ingroup ImageSamplers
  */
 
@@ -88,8 +96,8 @@ public:
     InputImageType, CoordRepType, double >                    DefaultInterpolatorType;
 
   /** The random number generator used to generate random coordinates. */
-  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
-  typedef typename RandomGeneratorType::Pointer                  RandomGeneratorPointer;
+  typedef typename Superclass::RandomGeneratorType RandomGeneratorType;
+  typedef typename RandomGeneratorType::Pointer    RandomGeneratorPointer;
 
   /** Set/Get the interpolator. A 3rd order B-spline interpolator is used by default. */
   itkSetObjectMacro( Interpolator, InterpolatorType );
@@ -105,6 +113,22 @@ public:
   itkGetConstMacro( UseRandomSampleRegion, bool );
   itkSetMacro( UseRandomSampleRegion, bool );
 
+  /** Set/Get whether a 3rd order B-spline interpolator is evaluated in batches,
+   * on a float coefficient image. Only used without a mask. Default: false. */
+  itkSetMacro( UseBatchedInterpolation, bool );
+  itkGetConstMacro( UseBatchedInterpolation, bool );
+  itkBooleanMacro( UseBatchedInterpolation );
+
+  /** The B-spline coefficients of the batched interpolation. */
+  typedef float                                            CoefficientType;
+  typedef Image< CoefficientType, InputImageDimension >    CoefficientImageType;
+  typedef typename CoefficientImageType::Pointer           CoefficientImagePointer;
+  typedef BSplineDecompositionImageFilter<
+    InputImageType, CoefficientImageType >                 DecompositionFilterType;
+
+  /** The number of samples of which the weights are computed together. */
+  itkStaticConstMacro( BatchSize, unsigned int, 64 );
+
 protected:
 
   typedef typename InterpolatorType::ContinuousIndexType InputImageContinuousIndexType;
@@ -127,6 +151,21 @@ protected:
     const InputImageRegionType & inputRegionForThread,
     ThreadIdType threadId );
 
+  /** Set the input image of the interpolator, or compute the coefficient
+   * image for the batched interpolation, but only when the input changed. */
+  virtual void InitializeInterpolator( void );
+
+  /** Whether the batched interpolation is used for the current interpolator. */
+  bool GetUseBatchedInterpolationInternal( void ) const;
+
+  /** Compute the cubic B-spline interpolant at numberOfSamples continuous
+   * indices, stored one after the other in continuousIndices, and store
+   * them in values. Thread-safe. */
+  void EvaluateCubicBSplineBatch(
+    const double * continuousIndices,
+    unsigned long numberOfSamples,
+    ImageSampleValueType * values ) const;
+
   /** Generate a point randomly in a bounding box. */
   virtual void GenerateRandomCoordinate(
     const InputImageContinuousIndexType & smallestContIndex,
@@ -134,7 +173,6 @@ protected:
     InputImageContinuousIndexType &       randomContIndex );
 
   InterpolatorPointer    m_Interpolator;
-  RandomGeneratorPointer m_RandomGenerator;
   InputImageSpacingType  m_SampleRegionSize;
 
   /** Generate the two corners of a sampling region, given the two corners
@@ -156,6 +194,15 @@ private:
   void operator=( const Self & );                 // purposely not implemented
 
   bool m_UseRandomSampleRegion;
+  bool m_UseBatchedInterpolation;
+
+  /** The input image for which the coefficient image was computed. */
+  const InputImageType *  m_CoefficientImageInput;
+  ModifiedTimeType        m_CoefficientImageInputMTime;
+  CoefficientImagePointer m_CoefficientImage;
+
+  /** The modified time of the input image of the interpolator. */
+  ModifiedTimeType m_InterpolatorInputMTime;
 
 };
 
@@ -38,12 +38,14 @@ ImageRandomCoordinateSampler< TInputImage >
   bsplineInterpolator->SetSplineOrder( 3 );
   this->m_Interpolator = bsplineInterpolator;
 
-  /** Setup random generator. */
-  this->m_RandomGenerator = RandomGeneratorType::GetInstance();
-
   this->m_UseRandomSampleRegion = false;
   this->m_SampleRegionSize.Fill( 1.0 );
 
+  this->m_UseBatchedInterpolation    = false;
+  this->m_CoefficientImageInput      = 0;
+  this->m_CoefficientImageInputMTime = 0;
+  this->m_InterpolatorInputMTime     = 0;
+
 } // end Constructor
 
 
@@ -70,7 +72,7 @@ ImageRandomCoordinateSampler< TInputImage >
   typename InterpolatorType::Pointer interpolator            = this->GetInterpolator();
 
   /** Set up the interpolator. */
-  interpolator->SetInputImage( inputImage ); // only once?
+  this->InitializeInterpolator();
 
   /** Convert inputImageRegion to bounding box in physical space. */
   InputImageSizeType unitSize;
@@ -95,7 +97,43 @@ ImageRandomCoordinateSampler< TInputImage >
 
   InputImageContinuousIndexType sampleContIndex;
   /** Fill the sample container. */
-  if( mask.IsNull() )
+  if( mask.IsNull() && this->GetUseBatchedInterpolationInternal() )
+  {
+    /** Generate all coordinates first, in the same order as below. */
+    const unsigned long numberOfSamples = this->GetNumberOfSamples();
+    this->m_RandomNumberList.resize( numberOfSamples * InputImageDimension );
+    for( unsigned long i = 0; i < numberOfSamples; ++i )
+    {
+      this->GenerateRandomCoordinate( smallestContIndex, largestContIndex, sampleContIndex );
+      for( unsigned int j = 0; j < InputImageDimension; ++j )
+      {
+        this->m_RandomNumberList[ i * InputImageDimension + j ] = sampleContIndex[ j ];
+      }
+    }
+
+    /** Evaluate the image in batches. */
+    ImageSampleValueType batchValues[ BatchSize ];
+    unsigned long        sampleId = 0;
+    for( iter = sampleContainer->Begin(); iter != end; )
+    {
+      const unsigned long batchSize = vnl_math_min(
+        static_cast< unsigned long >( BatchSize ), numberOfSamples - sampleId );
+      this->EvaluateCubicBSplineBatch(
+        &this->m_RandomNumberList[ sampleId * InputImageDimension ], batchSize, batchValues );
+
+      for( unsigned long b = 0; b < batchSize; ++b, ++iter, ++sampleId )
+      {
+        for( unsigned int j = 0; j < InputImageDimension; ++j )
+        {
+          sampleContIndex[ j ] = this->m_RandomNumberList[ sampleId * InputImageDimension + j ];
+        }
+        inputImage->TransformContinuousIndexToPhysicalPoint(
+          sampleContIndex, ( *iter ).Value().m_ImageCoordinates );
+        ( *iter ).Value().m_ImageValue = batchValues[ b ];
+      }
+    }
+  }
+  else if( mask.IsNull() )
   {
     /** Start looping over the sample container. */
     for( iter = sampleContainer->Begin(); iter != end; ++iter )
@@ -179,8 +217,7 @@ ImageRandomCoordinateSampler< TInputImage >
 ::BeforeThreadedGenerateData( void )
 {
   /** Set up the interpolator. */
-  typename InterpolatorType::Pointer interpolator = this->GetInterpolator();
-  interpolator->SetInputImage( this->GetInput() ); // only once per resolution?
+  this->InitializeInterpolator();
 
   /** Clear the random number list. */
   this->m_RandomNumberList.resize( 0 );
@@ -259,6 +296,33 @@ ImageRandomCoordinateSampler< TInputImage >
   /** Fill the local sample container. */
   InputImageContinuousIndexType sampleCIndex;
   unsigned long                 sampleId = sampleStart;
+  if( this->GetUseBatchedInterpolationInternal() )
+  {
+    /** Evaluate the image in batches. */
+    ImageSampleValueType batchValues[ BatchSize ];
+    unsigned long        numberOfSamplesLeft = chunkSize;
+    for( iter = sampleContainerThisThread->Begin(); iter != end; )
+    {
+      const unsigned long batchSize = vnl_math_min(
+        static_cast< unsigned long >( BatchSize ), numberOfSamplesLeft );
+      this->EvaluateCubicBSplineBatch(
+        &this->m_RandomNumberList[ sampleId ], batchSize, batchValues );
+
+      for( unsigned long b = 0; b < batchSize; ++b, ++iter )
+      {
+        for( unsigned int j = 0; j < InputImageDimension; ++j, sampleId++ )
+        {
+          sampleCIndex[ j ] = this->m_RandomNumberList[ sampleId ];
+        }
+        inputImage->TransformContinuousIndexToPhysicalPoint(
+          sampleCIndex, ( *iter ).Value().m_ImageCoordinates );
+        ( *iter ).Value().m_ImageValue = batchValues[ b ];
+      }
+      numberOfSamplesLeft -= batchSize;
+    }
+    return;
+  }
+
   for( iter = sampleContainerThisThread->Begin(); iter != end; ++iter )
   {
     /** Create a random point out of InputImageDimension random numbers. */
@@ -283,6 +347,192 @@ ImageRandomCoordinateSampler< TInputImage >
 } // end ThreadedGenerateData()
 
 
+/**
+ * ******************* InitializeInterpolator *******************
+ */
+
+template< class TInputImage >
+void
+ImageRandomCoordinateSampler< TInputImage >
+::InitializeInterpolator( void )
+{
+  const InputImageType * inputImage = this->GetInput();
+
+  /** Compute the float coefficients, only when the input changed. */
+  if( this->GetUseBatchedInterpolationInternal() )
+  {
+    if( this->m_CoefficientImage.IsNull()
+      || this->m_CoefficientImageInput != inputImage
+      || this->m_CoefficientImageInputMTime != inputImage->GetMTime() )
+    {
+      typename DecompositionFilterType::Pointer decomposition = DecompositionFilterType::New();
+      decomposition->SetSplineOrder( 3 );
+      decomposition->SetInput( inputImage );
+      decomposition->Update();
+
+      this->m_CoefficientImage = decomposition->GetOutput();
+      this->m_CoefficientImage->DisconnectPipeline();
+      this->m_CoefficientImageInput      = inputImage;
+      this->m_CoefficientImageInputMTime = inputImage->GetMTime();
+    }
+    return;
+  }
+
+  /** SetInputImage() of a B-spline interpolator recomputes the coefficients,
+   * so only call it when the input changed.
+   */
+  InterpolatorType * interpolator = this->GetInterpolator();
+  if( interpolator->GetInputImage() != inputImage
+    || this->m_InterpolatorInputMTime != inputImage->GetMTime() )
+  {
+    interpolator->SetInputImage( inputImage );
+    this->m_InterpolatorInputMTime = inputImage->GetMTime();
+  }
+
+} // end InitializeInterpolator()
+
+
+/**
+ * ******************* GetUseBatchedInterpolationInternal *******************
+ */
+
+template< class TInputImage >
+bool
+ImageRandomCoordinateSampler< TInputImage >
+::GetUseBatchedInterpolationInternal( void ) const
+{
+  if( !this->m_UseBatchedInterpolation || this->GetMask() != 0 )
+  {
+    return false;
+  }
+
+  const DefaultInterpolatorType * bsplineInterpolator
+    = dynamic_cast< const DefaultInterpolatorType * >( this->m_Interpolator.GetPointer() );
+  return bsplineInterpolator != 0 && bsplineInterpolator->GetSplineOrder() == 3;
+
+} // end GetUseBatchedInterpolationInternal()
+
+
+/**
+ * ******************* EvaluateCubicBSplineBatch *******************
+ */
+
+template< class TInputImage >
+void
+ImageRandomCoordinateSampler< TInputImage >
+::EvaluateCubicBSplineBatch(
+  const double * continuousIndices,
+  unsigned long numberOfSamples,
+  ImageSampleValueType * values ) const
+{
+  typedef typename CoefficientImageType::OffsetValueType OffsetValueType;
+  const unsigned int Dimension = InputImageDimension;
+
+  /** Get the coefficients and the geometry of the buffer. */
+  const CoefficientType * coefficients = this->m_CoefficientImage->GetBufferPointer();
+  const OffsetValueType * offsetTable  = this->m_CoefficientImage->GetOffsetTable();
+  const typename CoefficientImageType::RegionType & bufferedRegion
+    = this->m_CoefficientImage->GetBufferedRegion();
+  OffsetValueType start[ Dimension ];
+  OffsetValueType dataLength[ Dimension ];
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    start[ d ]      = bufferedRegion.GetIndex()[ d ];
+    dataLength[ d ] = static_cast< OffsetValueType >( bufferedRegion.GetSize()[ d ] );
+  }
+
+  /** The weights and the buffer offsets of the 4 support points per dimension.
+   * The weights are stored per support point, so that they are computed for
+   * all samples of the batch in one loop.
+   */
+  CoefficientType weights[ Dimension ][ 4 ][ BatchSize ];
+  OffsetValueType offsets[ Dimension ][ 4 ][ BatchSize ];
+  const CoefficientType sixth = 1.0f / 6.0f;
+
+  for( unsigned long first = 0; first < numberOfSamples; first += BatchSize )
+  {
+    const unsigned int batchSize = static_cast< unsigned int >(
+      vnl_math_min( static_cast< unsigned long >( BatchSize ), numberOfSamples - first ) );
+    const double * cindex = continuousIndices + first * Dimension;
+
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      /** The cubic B-spline weights, without branches. */
+      for( unsigned int b = 0; b < batchSize; ++b )
+      {
+        const double          x     = cindex[ b * Dimension + d ] - start[ d ];
+        const double          xf    = vcl_floor( x );
+        const CoefficientType t     = static_cast< CoefficientType >( x - xf );
+        const CoefficientType t2    = t * t;
+        const CoefficientType t3    = t2 * t;
+        const CoefficientType omt   = 1.0f - t;
+        weights[ d ][ 0 ][ b ] = sixth * omt * omt * omt;
+        weights[ d ][ 1 ][ b ] = sixth * ( 3.0f * t3 - 6.0f * t2 + 4.0f );
+        weights[ d ][ 2 ][ b ] = sixth * ( -3.0f * t3 + 3.0f * t2 + 3.0f * t + 1.0f );
+        weights[ d ][ 3 ][ b ] = sixth * t3;
+        offsets[ d ][ 0 ][ b ] = static_cast< OffsetValueType >( xf ) - 1;
+      }
+
+      /** The offsets, with the mirror boundary conditions of the
+       * BSplineInterpolateImageFunction.
+       */
+      const OffsetValueType length  = dataLength[ d ];
+      const OffsetValueType length2 = 2 * length - 2;
+      for( unsigned int b = 0; b < batchSize; ++b )
+      {
+        const OffsetValueType firstIndex = offsets[ d ][ 0 ][ b ];
+        for( unsigned int k = 0; k < 4; ++k )
+        {
+          OffsetValueType index = firstIndex + k;
+          if( length == 1 )
+          {
+            index = 0;
+          }
+          else if( index < 0 || index >= length )
+          {
+            index = ( index < 0 ) ? -index : index;
+            index = index % length2;
+            index = ( index >= length ) ? length2 - index : index;
+          }
+          offsets[ d ][ k ][ b ] = index * offsetTable[ d ];
+        }
+      }
+    }
+
+    /** Sum the weighted coefficients. The loop runs over the support lines
+     * along the first dimension, 4^(Dimension-1) per sample.
+     */
+    const unsigned int numberOfLines = 1u << ( 2 * ( Dimension - 1 ) );
+    for( unsigned int b = 0; b < batchSize; ++b )
+    {
+      double value = 0.0;
+      for( unsigned int line = 0; line < numberOfLines; ++line )
+      {
+        CoefficientType lineWeight = 1.0f;
+        OffsetValueType lineOffset = 0;
+        unsigned int    digits     = line;
+        for( unsigned int d = 1; d < Dimension; ++d, digits >>= 2 )
+        {
+          const unsigned int k = digits & 3u;
+          lineWeight *= weights[ d ][ k ][ b ];
+          lineOffset += offsets[ d ][ k ][ b ];
+        }
+
+        const CoefficientType * lineCoefficients = coefficients + lineOffset;
+        const CoefficientType   lineValue
+          = weights[ 0 ][ 0 ][ b ] * lineCoefficients[ offsets[ 0 ][ 0 ][ b ] ]
+          + weights[ 0 ][ 1 ][ b ] * lineCoefficients[ offsets[ 0 ][ 1 ][ b ] ]
+          + weights[ 0 ][ 2 ][ b ] * lineCoefficients[ offsets[ 0 ][ 2 ][ b ] ]
+          + weights[ 0 ][ 3 ][ b ] * lineCoefficients[ offsets[ 0 ][ 3 ][ b ] ];
+        value += static_cast< double >( lineWeight ) * lineValue;
+      }
+      values[ first + b ] = static_cast< ImageSampleValueType >( value );
+    }
+  }
+
+} // end EvaluateCubicBSplineBatch()
+
+
 /**
  * ******************* GenerateRandomCoordinate *******************
  */
@@ -360,7 +610,7 @@ ImageRandomCoordinateSampler< TInputImage >
   Superclass::PrintSelf( os, indent );
 
   os << indent << "Interpolator: " << this->m_Interpolator.GetPointer() << std::endl;
-  os << indent << "RandomGenerator: " << this->m_RandomGenerator.GetPointer() << std::endl;
+  os << indent << "UseBatchedInterpolation: " << this->m_UseBatchedInterpolation << std::endl;
 
 } // end PrintSelf()
 
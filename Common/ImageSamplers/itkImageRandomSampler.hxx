@@ -20,9 +20,6 @@
 
 #include "itkImageRandomSampler.h"
 
-#include "itkMersenneTwisterRandomVariateGenerator.h"
-#include "itkImageRandomConstIteratorWithIndex.h"
-
 namespace itk
 {
 
@@ -50,10 +47,11 @@ ImageRandomSampler< TInputImage >
   /** Reserve memory for the output. */
   sampleContainer->Reserve( this->GetNumberOfSamples() );
 
-  /** Setup a random iterator over the input image. */
-  typedef ImageRandomConstIteratorWithIndex< InputImageType > RandomIteratorType;
-  RandomIteratorType randIter( inputImage, this->GetCroppedInputImageRegion() );
-  randIter.GoToBegin();
+  /** Jump to a first random position, which is not used, in order to
+   * generate the same sequence as the multi-threaded version.
+   */
+  InputImageIndexType index;
+  this->GenerateRandomIndex( index );
 
   /** Setup an iterator over the output, which is of ImageSampleContainerType. */
   typename ImageSampleContainerType::Iterator iter;
@@ -61,20 +59,15 @@ ImageRandomSampler< TInputImage >
 
   if( mask.IsNull() )
   {
-    /** number of samples + 1, because of the initial ++randIter. */
-    randIter.SetNumberOfSamples( this->GetNumberOfSamples() + 1 );
-    /** Advance one, in order to generate the same sequence as when using a mask */
-    ++randIter;
     for( iter = sampleContainer->Begin(); iter != end; ++iter )
     {
-      /** Get the index, transform it to the physical coordinates and put it in the sample. */
-      InputImageIndexType index = randIter.GetIndex();
+      /** Jump to a random position. */
+      this->GenerateRandomIndex( index );
+      /** Transform the index to the physical coordinates and put it in the sample. */
       inputImage->TransformIndexToPhysicalPoint( index,
         ( *iter ).Value().m_ImageCoordinates );
       /** Get the value and put it in the sample. */
-      ( *iter ).Value().m_ImageValue = randIter.Get();
-      /** Jump to a random position. */
-      ++randIter;
+      ( *iter ).Value().m_ImageValue = static_cast< ImageSampleValueType >( inputImage->GetPixel( index ) );
 
     } // end for loop
   }   // end if no mask
@@ -87,7 +80,8 @@ ImageRandomSampler< TInputImage >
     }
 
     /** Make sure we are not eternally trying to find samples: */
-    randIter.SetNumberOfSamples( 10 * this->GetNumberOfSamples() );
+    const unsigned long maximumNumberOfJumps = 10 * this->GetNumberOfSamples();
+    unsigned long       numberOfJumps        = 0;
 
     /** Loop over the sample container. */
     InputImagePointType inputPoint;
@@ -98,9 +92,9 @@ ImageRandomSampler< TInputImage >
       do
       {
         /** Jump to a random position. */
-        ++randIter;
+        this->GenerateRandomIndex( index );
         /** Check if we are not trying eternally to find a valid point. */
-        if( randIter.IsAtEnd() )
+        if( ++numberOfJumps >= maximumNumberOfJumps )
         {
           /** Squeeze the sample container to the size that is still valid. */
           typename ImageSampleContainerType::iterator stlnow = sampleContainer->begin();
@@ -110,8 +104,7 @@ ImageRandomSampler< TInputImage >
           itkExceptionMacro( << "Could not find enough image samples within "
                              << "reasonable time. Probably the mask is too small" );
         }
-        /** Get the index, and transform it to the physical coordinates. */
-        InputImageIndexType index = randIter.GetIndex();
+        /** Transform the index to the physical coordinates. */
         inputImage->TransformIndexToPhysicalPoint( index, inputPoint );
         /** Check if it's inside the mask. */
         insideMask = mask->IsInside( inputPoint );
@@ -120,16 +113,16 @@ ImageRandomSampler< TInputImage >
 
       /** Put the coordinates and the value in the sample. */
       ( *iter ).Value().m_ImageCoordinates = inputPoint;
-      ( *iter ).Value().m_ImageValue       = randIter.Get();
+      ( *iter ).Value().m_ImageValue       = static_cast< ImageSampleValueType >( inputImage->GetPixel( index ) );
 
     } // end for loop
-
-    /** Extra random sample to make sure the same sequence is generated
-     * with and without mask.
-     */
-    ++randIter;
   }
 
+  /** Extra random sample to make sure the same sequence is generated
+   * with and without mask, and by the multi-threaded version.
+   */
+  this->GenerateRandomIndex( index );
+
 } // end GenerateData()
 
 
@@ -63,6 +63,8 @@ public:
   typedef typename Superclass::ImageSampleContainerType     ImageSampleContainerType;
   typedef typename Superclass::ImageSampleContainerPointer  ImageSampleContainerPointer;
   typedef typename Superclass::MaskType                     MaskType;
+  typedef typename Superclass::InputImageIndexType          InputImageIndexType;
+  typedef typename Superclass::RandomGeneratorType          RandomGeneratorType;
 
   /** The input image dimension. */
   itkStaticConstMacro( InputImageDimension, unsigned int,
@@ -82,6 +84,12 @@ protected:
   /** Multi-threaded function that does the work. */
   virtual void BeforeThreadedGenerateData( void );
 
+  /** Jump to a random index of the cropped input image region. Uses the
+   * random generator of this sampler, and otherwise does the same as a jump
+   * of the ImageRandomConstIteratorWithIndex.
+   */
+  void GenerateRandomIndex( InputImageIndexType & index ) const;
+
   /** PrintSelf. */
   void PrintSelf( std::ostream & os, Indent indent ) const;
 
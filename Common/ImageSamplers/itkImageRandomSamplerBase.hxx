@@ -20,9 +20,6 @@
 
 #include "itkImageRandomSamplerBase.h"
 
-#include "itkMersenneTwisterRandomVariateGenerator.h"
-#include "itkImageRandomConstIteratorWithIndex.h"
-
 namespace itk
 {
 
@@ -48,10 +45,8 @@ void
 ImageRandomSamplerBase< TInputImage >
 ::BeforeThreadedGenerateData( void )
 {
-  /** Create a random number generator. Also used in the ImageRandomConstIteratorWithIndex. */
-  typedef typename Statistics::MersenneTwisterRandomVariateGenerator::Pointer GeneratorPointer;
-  GeneratorPointer localGenerator = Statistics::MersenneTwisterRandomVariateGenerator::GetInstance();
-  // \todo: should probably be global?
+  /** Get the random number generator of this sampler. */
+  RandomGeneratorType * localGenerator = this->GetRandomGenerator();
 
   /** Clear the random number list. */
   this->m_RandomNumberList.resize( 0 );
@@ -74,6 +69,34 @@ ImageRandomSamplerBase< TInputImage >
 } // end BeforeThreadedGenerateData()
 
 
+/**
+ * ******************* GenerateRandomIndex *******************
+ */
+
+template< class TInputImage >
+void
+ImageRandomSamplerBase< TInputImage >
+::GenerateRandomIndex( InputImageIndexType & index ) const
+{
+  const InputImageRegionType & region    = this->GetCroppedInputImageRegion();
+  const double                 numPixels = static_cast< double >( region.GetNumberOfPixels() );
+
+  /** Translate a random position to an index, copied from ImageRandomConstIteratorWithIndex. */
+  unsigned long randomPosition = static_cast< unsigned long >(
+    this->m_RandomGenerator->GetVariateWithOpenRange( numPixels - 0.5 ) );
+  unsigned long residual;
+  for( unsigned int dim = 0; dim < InputImageDimension; dim++ )
+  {
+    const unsigned long sizeInThisDimension = region.GetSize()[ dim ];
+    residual        = randomPosition % sizeInThisDimension;
+    index[ dim ]    = residual + region.GetIndex()[ dim ];
+    randomPosition -= residual;
+    randomPosition /= sizeInThisDimension;
+  }
+
+} // end GenerateRandomIndex()
+
+
 /**
  * ******************* PrintSelf *******************
  */
@@ -75,8 +75,8 @@ public:
   typedef typename InputImageType::PointType InputImagePointType;
 
   /** The random number generator used to generate random indices. */
-  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
-  typedef typename RandomGeneratorType::Pointer                  RandomGeneratorPointer;
+  typedef typename Superclass::RandomGeneratorType RandomGeneratorType;
+  typedef typename RandomGeneratorType::Pointer    RandomGeneratorPointer;
 
 protected:
 
@@ -101,7 +101,6 @@ protected:
     const InputImageRegionType & inputRegionForThread,
     ThreadIdType threadId );
 
-  RandomGeneratorPointer     m_RandomGenerator;
   InternalFullSamplerPointer m_InternalFullSampler;
 
 private:
@@ -22,6 +22,7 @@
 #include "itkImageSample.h"
 #include "itkVectorDataContainer.h"
 #include "itkSpatialObject.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
 
 namespace itk
 {
@@ -87,6 +88,7 @@ public:
   typedef typename MaskType::ConstPointer                       MaskConstPointer;
   typedef std::vector< MaskConstPointer >                       MaskVectorType;
   typedef std::vector< InputImageRegionType >                   InputImageRegionVectorType;
+  typedef Statistics::MersenneTwisterRandomVariateGenerator     RandomGeneratorType;
 
   /** ******************** Masks ******************** */
 
@@ -170,6 +172,22 @@ public:
   /** \todo: Temporary, should think about interface. */
   itkSetMacro( UseMultiThread, bool );
 
+  /** Set/Get the random number generator of the random samplers.
+   * Default: the global instance of the MersenneTwisterRandomVariateGenerator.
+   * Registrations that run at the same time each set their own generator.
+   */
+  itkSetObjectMacro( RandomGenerator, RandomGeneratorType );
+  itkGetObjectMacro( RandomGenerator, RandomGeneratorType );
+
+  /** Set/Get a sample container computed by another sampler with the same
+   * input image, masks, regions and settings, for example by the same
+   * sampler of a previous registration of a batch. When it is set, samplers
+   * that select the same samples on every update copy it to their output,
+   * instead of sampling the input image again. Default: 0.
+   */
+  itkSetConstObjectMacro( PrecomputedSampleContainer, ImageSampleContainerType );
+  itkGetConstObjectMacro( PrecomputedSampleContainer, ImageSampleContainerType );
+
 protected:
 
   /** The constructor. */
@@ -203,9 +221,15 @@ protected:
 
   virtual void AfterThreadedGenerateData( void );
 
+  /** Copy the precomputed sample container to the output, if it is set.
+   * Returns false if it is not set.
+   */
+  bool CopyPrecomputedSampleContainer( void );
+
   /***/
   unsigned long                              m_NumberOfSamples;
   std::vector< ImageSampleContainerPointer > m_ThreaderSampleContainer;
+  typename RandomGeneratorType::Pointer      m_RandomGenerator;
 
   //tmp?
   bool m_UseMultiThread;
@@ -228,6 +252,8 @@ private:
   InputImageRegionType m_CroppedInputImageRegion;
   InputImageRegionType m_DummyInputImageRegion;
 
+  typename ImageSampleContainerType::ConstPointer m_PrecomputedSampleContainer;
+
 };
 
 } // end namespace itk
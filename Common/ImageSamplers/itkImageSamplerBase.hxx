@@ -35,6 +35,7 @@ ImageSamplerBase< TInputImage >
   this->m_NumberOfMasks             = 0;
   this->m_NumberOfInputImageRegions = 0;
   this->m_NumberOfSamples           = 0;
+  this->m_RandomGenerator           = RandomGeneratorType::GetInstance();
 
   //tmp?
   this->m_UseMultiThread = false;
@@ -458,6 +459,28 @@ ImageSamplerBase< TInputImage >
 } // end AfterThreadedGenerateData()
 
 
+/**
+ * ******************* CopyPrecomputedSampleContainer *******************
+ */
+
+template< class TInputImage >
+bool
+ImageSamplerBase< TInputImage >
+::CopyPrecomputedSampleContainer( void )
+{
+  if( this->m_PrecomputedSampleContainer.IsNull() )
+  {
+    return false;
+  }
+
+  typename ImageSampleContainerType::Pointer sampleContainer = this->GetOutput();
+  sampleContainer->Initialize();
+  sampleContainer->CastToSTLContainer() = this->m_PrecomputedSampleContainer->CastToSTLConstContainer();
+  return true;
+
+} // end CopyPrecomputedSampleContainer()
+
+
 /**
  * ******************* PrintSelf *******************
  */
@@ -485,6 +508,8 @@ ImageSamplerBase< TInputImage >
     os << indent.GetNextIndent() << this->m_InputImageRegionVector[ i ] << std::endl;
   }
   os << indent << "CroppedInputImageRegion" << this->m_CroppedInputImageRegion << std::endl;
+  os << indent << "RandomGenerator: " << this->m_RandomGenerator.GetPointer() << std::endl;
+  os << indent << "PrecomputedSampleContainer: " << this->m_PrecomputedSampleContainer.GetPointer() << std::endl;
 
 } // end PrintSelf()
 
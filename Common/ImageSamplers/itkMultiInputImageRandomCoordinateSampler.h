@@ -21,7 +21,9 @@
 #include "itkImageRandomSamplerBase.h"
 #include "itkInterpolateImageFunction.h"
 #include "itkBSplineInterpolateImageFunction.h"
+#include "itkBSplineDecompositionImageFilter.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include <vector>
 
 namespace itk
 {
@@ -33,6 +35,14 @@ namespace itk
  * This image sampler generates not only samples that correspond with
  * pixel locations, but selects points in physical space.
  *
+ * With ComputeChannelValues the sampler also interpolates all inputs at
+ * the sample points, and stores the values of all channels of a sample
+ * contiguously in GetChannelValues(). The interpolation uses B-spline
+ * coefficients of the order of the interpolator, which must be a B-spline
+ * interpolator. The interpolation weights are computed once per sample
+ * and shared by all inputs with the same geometry as the first input.
+ * This is done multi-threaded, when UseMultiThread is set.
+ *
  * \ingroup ImageSamplers
  */
 
@@ -86,8 +96,8 @@ public:
   typedef BSplineInterpolateImageFunction< InputImageType, CoordRepType, double > DefaultInterpolatorType;
 
   /** The random number generator used to generate random coordinates. */
-  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
-  typedef typename RandomGeneratorType::Pointer                  RandomGeneratorPointer;
+  typedef typename Superclass::RandomGeneratorType RandomGeneratorType;
+  typedef typename RandomGeneratorType::Pointer    RandomGeneratorPointer;
 
   /** Set/Get the interpolator. A 3rd order B-spline interpolator is used by default. */
   itkSetObjectMacro( Interpolator, InterpolatorType );
@@ -104,6 +114,30 @@ public:
   itkGetConstMacro( UseRandomSampleRegion, bool );
   itkSetMacro( UseRandomSampleRegion, bool );
 
+  /** Set/Get whether to compute the values of all inputs at the samples.
+   * Default: false. */
+  itkSetMacro( ComputeChannelValues, bool );
+  itkGetConstMacro( ComputeChannelValues, bool );
+  itkBooleanMacro( ComputeChannelValues );
+
+  /** The values of all channels, stored per sample:
+   * value of input c at sample i = channelValues[ i * numberOfChannels + c ].
+   */
+  typedef std::vector< ImageSampleValueType > ChannelValueContainerType;
+
+  /** Get the channel values of the last update. Only filled when
+   * ComputeChannelValues is set.
+   */
+  const ChannelValueContainerType & GetChannelValues( void ) const
+  { return this->m_ChannelValues; }
+
+  /** Get the number of channels of GetChannelValues(). */
+  itkGetConstMacro( NumberOfChannels, unsigned int );
+
+  /** Get the spline order used for the channel values, which is the
+   * spline order of the interpolator. */
+  itkGetConstMacro( ChannelSplineOrder, unsigned int );
+
 protected:
 
   typedef typename InterpolatorType::ContinuousIndexType InputImageContinuousIndexType;
@@ -128,7 +162,6 @@ protected:
     InputImageContinuousIndexType &       randomContIndex );
 
   InterpolatorPointer    m_Interpolator;
-  RandomGeneratorPointer m_RandomGenerator;
   InputImageSpacingType  m_SampleRegionSize;
 
   /** Generate the two corners of a sampling region. */
@@ -136,6 +169,48 @@ protected:
     InputImageContinuousIndexType & smallestContIndex,
     InputImageContinuousIndexType & largestContIndex );
 
+  /** Typedefs for the B-spline coefficients of the channels. */
+  typedef double                                         CoefficientType;
+  typedef Image< CoefficientType, InputImageDimension >  CoefficientImageType;
+  typedef typename CoefficientImageType::Pointer         CoefficientImagePointer;
+  typedef typename CoefficientImageType::OffsetValueType OffsetValueType;
+  typedef BSplineDecompositionImageFilter<
+    InputImageType, CoefficientImageType >               DecompositionFilterType;
+
+  /** The maximum support of the B-spline kernel, for spline order 5. */
+  itkStaticConstMacro( MaximumSupportSize, unsigned int, 6 );
+
+  /** Compute the B-spline coefficients of all inputs, if they changed. */
+  virtual void InitializeChannelCoefficients( void );
+
+  /** Compute the channel values of the samples, multi-threaded if requested. */
+  virtual void ComputeAllChannelValues( void );
+
+  /** Compute the channel values of the samples [first, last). */
+  void ComputeChannelValuesOfSamples( unsigned long first, unsigned long last );
+
+  /** Compute the B-spline weights and mirrored buffer offsets of a
+   * continuous index in a coefficient image. */
+  void ComputeWeightsAndOffsets(
+    const InputImageContinuousIndexType & cindex,
+    const CoefficientImageType * coefficientImage,
+    double weights[][ MaximumSupportSize ],
+    OffsetValueType offsets[][ MaximumSupportSize ] ) const;
+
+  /** Sum the weighted coefficients of a coefficient image. */
+  double EvaluateWithWeightsAndOffsets(
+    const CoefficientImageType * coefficientImage,
+    const double weights[][ MaximumSupportSize ],
+    const OffsetValueType offsets[][ MaximumSupportSize ] ) const;
+
+  /** The callback of the channel value computation. */
+  static ITK_THREAD_RETURN_TYPE ComputeChannelValuesThreaderCallback( void * arg );
+
+  struct ChannelValuesMultiThreaderParameterType
+  {
+    Self * st_Self;
+  };
+
 private:
 
   /** The private constructor. */
@@ -145,6 +220,17 @@ private:
 
   bool m_UseRandomSampleRegion;
 
+  /** Members for the channel values. */
+  bool                                   m_ComputeChannelValues;
+  unsigned int                           m_NumberOfChannels;
+  unsigned int                           m_ChannelSplineOrder;
+  ChannelValueContainerType              m_ChannelValues;
+  std::vector< CoefficientImagePointer > m_ChannelCoefficients;
+  std::vector< const InputImageType * >  m_ChannelCoefficientInputs;
+  std::vector< ModifiedTimeType >        m_ChannelCoefficientInputMTimes;
+  std::vector< unsigned int >            m_ChannelCoefficientSplineOrders;
+  std::vector< bool >                    m_ChannelHasSameGeometry;
+
 };
 
 } // end namespace itk
@@ -21,6 +21,7 @@
 #include "itkMultiInputImageRandomCoordinateSampler.h"
 #include "vnl/vnl_inverse.h"
 #include "itkConfigure.h"
+#include <cmath>
 
 namespace itk
 {
@@ -39,12 +40,13 @@ MultiInputImageRandomCoordinateSampler< TInputImage >
   bsplineInterpolator->SetSplineOrder( 3 );
   this->m_Interpolator = bsplineInterpolator;
 
-  /** Setup the random generator. */
-  this->m_RandomGenerator = RandomGeneratorType::GetInstance();
-
   this->m_UseRandomSampleRegion = false;
   this->m_SampleRegionSize.Fill( 1.0 );
 
+  this->m_ComputeChannelValues = false;
+  this->m_NumberOfChannels     = 0;
+  this->m_ChannelSplineOrder   = 0;
+
 }   // end Constructor()
 
 
@@ -70,8 +72,18 @@ MultiInputImageRandomCoordinateSampler< TInputImage >
   typename MaskType::ConstPointer mask                       = this->GetMask();
   typename InterpolatorType::Pointer interpolator            = this->GetInterpolator();
 
-  /** Set up the interpolator. */
-  interpolator->SetInputImage( inputImage );
+  /** Set up the interpolator, or the coefficients of all channels. */
+  const bool computeChannelValues = this->m_ComputeChannelValues;
+  if( computeChannelValues )
+  {
+    this->InitializeChannelCoefficients();
+  }
+  else
+  {
+    interpolator->SetInputImage( inputImage );
+    this->m_ChannelValues.clear();
+    this->m_NumberOfChannels = 0;
+  }
 
   /** Get the intersection of all sample regions. */
   InputImageContinuousIndexType smallestContIndex;
@@ -104,8 +116,11 @@ MultiInputImageRandomCoordinateSampler< TInputImage >
       inputImage->TransformContinuousIndexToPhysicalPoint( sampleContIndex, samplePoint );
 
       /** Compute the value at the contindex. */
-      sampleValue = static_cast< ImageSampleValueType >(
-        this->m_Interpolator->EvaluateAtContinuousIndex( sampleContIndex ) );
+      if( !computeChannelValues )
+      {
+        sampleValue = static_cast< ImageSampleValueType >(
+          this->m_Interpolator->EvaluateAtContinuousIndex( sampleContIndex ) );
+      }
 
     } // end for loop
   }   // end if no mask
@@ -150,15 +165,334 @@ MultiInputImageRandomCoordinateSampler< TInputImage >
       while( !this->IsInsideAllMasks( samplePoint ) );
 
       /** Compute the value at the contindex. */
-      sampleValue = static_cast< ImageSampleValueType >(
-        this->m_Interpolator->EvaluateAtContinuousIndex( sampleContIndex ) );
+      if( !computeChannelValues )
+      {
+        sampleValue = static_cast< ImageSampleValueType >(
+          this->m_Interpolator->EvaluateAtContinuousIndex( sampleContIndex ) );
+      }
 
     } // end for loop
   }   // end if mask
 
+  /** Compute the values of all channels, including the sample values. */
+  if( computeChannelValues )
+  {
+    this->ComputeAllChannelValues();
+  }
+
 }   // end GenerateData()
 
 
+/**
+ * ******************* InitializeChannelCoefficients *******************
+ */
+
+template< class TInputImage >
+void
+MultiInputImageRandomCoordinateSampler< TInputImage >
+::InitializeChannelCoefficients( void )
+{
+  /** The channels are interpolated with the spline order of the interpolator. */
+  const DefaultInterpolatorType * bsplineInterpolator
+    = dynamic_cast< const DefaultInterpolatorType * >( this->m_Interpolator.GetPointer() );
+  if( bsplineInterpolator == 0 )
+  {
+    itkExceptionMacro( << "ERROR: ComputeChannelValues requires a B-spline interpolator." );
+  }
+  this->m_ChannelSplineOrder = bsplineInterpolator->GetSplineOrder();
+  if( this->m_ChannelSplineOrder >= MaximumSupportSize )
+  {
+    itkExceptionMacro( << "ERROR: ComputeChannelValues supports spline orders up to "
+                       << MaximumSupportSize - 1 << "." );
+  }
+
+  /** Compute the coefficients of the inputs that changed. */
+  this->m_NumberOfChannels = this->GetNumberOfInputs();
+  this->m_ChannelCoefficients.resize( this->m_NumberOfChannels );
+  this->m_ChannelCoefficientInputs.resize( this->m_NumberOfChannels, 0 );
+  this->m_ChannelCoefficientInputMTimes.resize( this->m_NumberOfChannels, 0 );
+  this->m_ChannelCoefficientSplineOrders.resize( this->m_NumberOfChannels, 0 );
+  this->m_ChannelHasSameGeometry.resize( this->m_NumberOfChannels, false );
+  for( unsigned int c = 0; c < this->m_NumberOfChannels; ++c )
+  {
+    const InputImageType * input = this->GetInput( c );
+    if( this->m_ChannelCoefficients[ c ].IsNull()
+      || this->m_ChannelCoefficientInputs[ c ] != input
+      || this->m_ChannelCoefficientInputMTimes[ c ] != input->GetMTime()
+      || this->m_ChannelCoefficientSplineOrders[ c ] != this->m_ChannelSplineOrder )
+    {
+      typename DecompositionFilterType::Pointer decomposition = DecompositionFilterType::New();
+      decomposition->SetSplineOrder( this->m_ChannelSplineOrder );
+      decomposition->SetInput( input );
+      decomposition->Update();
+
+      this->m_ChannelCoefficients[ c ] = decomposition->GetOutput();
+      this->m_ChannelCoefficients[ c ]->DisconnectPipeline();
+      this->m_ChannelCoefficientInputs[ c ]       = input;
+      this->m_ChannelCoefficientInputMTimes[ c ]  = input->GetMTime();
+      this->m_ChannelCoefficientSplineOrders[ c ] = this->m_ChannelSplineOrder;
+    }
+  }
+
+  /** Channels with the same geometry as the first one share its weights. */
+  const CoefficientImageType * coefficients0 = this->m_ChannelCoefficients[ 0 ];
+  for( unsigned int c = 0; c < this->m_NumberOfChannels; ++c )
+  {
+    const CoefficientImageType * coefficients = this->m_ChannelCoefficients[ c ];
+    this->m_ChannelHasSameGeometry[ c ]
+      = coefficients->GetBufferedRegion() == coefficients0->GetBufferedRegion()
+      && coefficients->GetOrigin() == coefficients0->GetOrigin()
+      && coefficients->GetSpacing() == coefficients0->GetSpacing()
+      && coefficients->GetDirection() == coefficients0->GetDirection();
+  }
+
+} // end InitializeChannelCoefficients()
+
+
+/**
+ * ******************* ComputeAllChannelValues *******************
+ */
+
+template< class TInputImage >
+void
+MultiInputImageRandomCoordinateSampler< TInputImage >
+::ComputeAllChannelValues( void )
+{
+  const unsigned long numberOfSamples = this->GetOutput()->Size();
+  this->m_ChannelValues.resize( numberOfSamples * this->m_NumberOfChannels );
+
+  /** Single-threadedly. */
+  if( !this->m_UseMultiThread || this->GetNumberOfThreads() == 1 )
+  {
+    this->ComputeChannelValuesOfSamples( 0, numberOfSamples );
+    return;
+  }
+
+  /** Multi-threadedly: each thread handles a contiguous range of samples. */
+  ChannelValuesMultiThreaderParameterType temp;
+  temp.st_Self = this;
+  this->GetMultiThreader()->SetNumberOfThreads( this->GetNumberOfThreads() );
+  this->GetMultiThreader()->SetSingleMethod( this->ComputeChannelValuesThreaderCallback, &temp );
+  this->GetMultiThreader()->SingleMethodExecute();
+
+} // end ComputeAllChannelValues()
+
+
+/**
+ * ******************* ComputeChannelValuesThreaderCallback *******************
+ */
+
+template< class TInputImage >
+ITK_THREAD_RETURN_TYPE
+MultiInputImageRandomCoordinateSampler< TInputImage >
+::ComputeChannelValuesThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * infoStruct
+    = static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  ThreadIdType threadId    = infoStruct->ThreadID;
+  ThreadIdType nrOfThreads = infoStruct->NumberOfThreads;
+
+  ChannelValuesMultiThreaderParameterType * temp
+    = static_cast< ChannelValuesMultiThreaderParameterType * >( infoStruct->UserData );
+
+  const unsigned long numberOfSamples = temp->st_Self->GetOutput()->Size();
+  const unsigned long chunkSize       = ( numberOfSamples + nrOfThreads - 1 ) / nrOfThreads;
+  const unsigned long first           = vnl_math_min( threadId * chunkSize, numberOfSamples );
+  const unsigned long last            = vnl_math_min( first + chunkSize, numberOfSamples );
+
+  temp->st_Self->ComputeChannelValuesOfSamples( first, last );
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end ComputeChannelValuesThreaderCallback()
+
+
+/**
+ * ******************* ComputeChannelValuesOfSamples *******************
+ */
+
+template< class TInputImage >
+void
+MultiInputImageRandomCoordinateSampler< TInputImage >
+::ComputeChannelValuesOfSamples( unsigned long first, unsigned long last )
+{
+  ImageSampleContainerType *   sampleContainer  = this->GetOutput();
+  const unsigned int           numberOfChannels = this->m_NumberOfChannels;
+  const CoefficientImageType * coefficients0    = this->m_ChannelCoefficients[ 0 ];
+
+  double                        weights0[ InputImageDimension ][ MaximumSupportSize ];
+  OffsetValueType               offsets0[ InputImageDimension ][ MaximumSupportSize ];
+  double                        weights[ InputImageDimension ][ MaximumSupportSize ];
+  OffsetValueType               offsets[ InputImageDimension ][ MaximumSupportSize ];
+  InputImageContinuousIndexType cindex;
+
+  for( unsigned long i = first; i < last; ++i )
+  {
+    ImageSampleType &           sample = sampleContainer->ElementAt( i );
+    const InputImagePointType & point  = sample.m_ImageCoordinates;
+
+    /** The weights of the first channel, shared by all channels of the same geometry. */
+    coefficients0->TransformPhysicalPointToContinuousIndex( point, cindex );
+    this->ComputeWeightsAndOffsets( cindex, coefficients0, weights0, offsets0 );
+
+    ImageSampleValueType * values = &this->m_ChannelValues[ i * numberOfChannels ];
+    for( unsigned int c = 0; c < numberOfChannels; ++c )
+    {
+      const CoefficientImageType * coefficients = this->m_ChannelCoefficients[ c ];
+      double                       value;
+      if( this->m_ChannelHasSameGeometry[ c ] )
+      {
+        value = this->EvaluateWithWeightsAndOffsets( coefficients, weights0, offsets0 );
+      }
+      else
+      {
+        coefficients->TransformPhysicalPointToContinuousIndex( point, cindex );
+        this->ComputeWeightsAndOffsets( cindex, coefficients, weights, offsets );
+        value = this->EvaluateWithWeightsAndOffsets( coefficients, weights, offsets );
+      }
+      values[ c ] = static_cast< ImageSampleValueType >( value );
+    }
+
+    /** The sample value is the value of the first channel. */
+    sample.m_ImageValue = values[ 0 ];
+  }
+
+} // end ComputeChannelValuesOfSamples()
+
+
+/**
+ * ******************* ComputeWeightsAndOffsets *******************
+ */
+
+template< class TInputImage >
+void
+MultiInputImageRandomCoordinateSampler< TInputImage >
+::ComputeWeightsAndOffsets(
+  const InputImageContinuousIndexType & cindex,
+  const CoefficientImageType * coefficientImage,
+  double weights[][ MaximumSupportSize ],
+  OffsetValueType offsets[][ MaximumSupportSize ] ) const
+{
+  const unsigned int      splineOrder = this->m_ChannelSplineOrder;
+  const unsigned int      supportSize = splineOrder + 1;
+  const OffsetValueType * offsetTable = coefficientImage->GetOffsetTable();
+  const typename CoefficientImageType::RegionType & bufferedRegion
+    = coefficientImage->GetBufferedRegion();
+
+  /** The binomial coefficients (n+1 over k), used for the B-spline kernel
+   * B_n(u) = 1/n! sum_k (-1)^k (n+1 over k) max( 0, u + (n+1)/2 - k )^n.
+   */
+  double binomials[ MaximumSupportSize + 1 ];
+  double factorial = 1.0;
+  binomials[ 0 ] = 1.0;
+  for( unsigned int k = 1; k <= supportSize; ++k )
+  {
+    binomials[ k ] = binomials[ k - 1 ] * ( supportSize - k + 1 ) / k;
+  }
+  for( unsigned int k = 2; k <= splineOrder; ++k )
+  {
+    factorial *= k;
+  }
+
+  for( unsigned int d = 0; d < InputImageDimension; ++d )
+  {
+    /** The first support point, as in the BSplineInterpolateImageFunction. */
+    const double          x          = cindex[ d ] - bufferedRegion.GetIndex()[ d ];
+    const OffsetValueType firstIndex = ( splineOrder & 1 )
+      ? static_cast< OffsetValueType >( vcl_floor( x ) ) - splineOrder / 2
+      : static_cast< OffsetValueType >( vcl_floor( x + 0.5 ) ) - splineOrder / 2;
+
+    /** The weights. */
+    for( unsigned int k = 0; k < supportSize; ++k )
+    {
+      if( splineOrder == 0 )
+      {
+        weights[ d ][ k ] = 1.0;
+        continue;
+      }
+      const double u   = x - static_cast< double >( firstIndex + k ) + 0.5 * supportSize;
+      double       sum = 0.0;
+      for( unsigned int j = 0; j <= supportSize && u > j; ++j )
+      {
+        const double term = std::pow( u - j, static_cast< int >( splineOrder ) ) * binomials[ j ];
+        sum += ( j & 1 ) ? -term : term;
+      }
+      weights[ d ][ k ] = sum / factorial;
+    }
+
+    /** The offsets, with mirror boundary conditions. */
+    const OffsetValueType length  = static_cast< OffsetValueType >( bufferedRegion.GetSize()[ d ] );
+    const OffsetValueType length2 = 2 * length - 2;
+    for( unsigned int k = 0; k < supportSize; ++k )
+    {
+      OffsetValueType index = firstIndex + k;
+      if( length == 1 )
+      {
+        index = 0;
+      }
+      else if( index < 0 || index >= length )
+      {
+        index = ( index < 0 ) ? -index : index;
+        index = index % length2;
+        index = ( index >= length ) ? length2 - index : index;
+      }
+      offsets[ d ][ k ] = index * offsetTable[ d ];
+    }
+  }
+
+} // end ComputeWeightsAndOffsets()
+
+
+/**
+ * ******************* EvaluateWithWeightsAndOffsets *******************
+ */
+
+template< class TInputImage >
+double
+MultiInputImageRandomCoordinateSampler< TInputImage >
+::EvaluateWithWeightsAndOffsets(
+  const CoefficientImageType * coefficientImage,
+  const double weights[][ MaximumSupportSize ],
+  const OffsetValueType offsets[][ MaximumSupportSize ] ) const
+{
+  const CoefficientType * coefficients = coefficientImage->GetBufferPointer();
+  const unsigned int      supportSize  = this->m_ChannelSplineOrder + 1;
+
+  /** Loop over the support lines along the first dimension. */
+  unsigned int numberOfLines = 1;
+  for( unsigned int d = 1; d < InputImageDimension; ++d )
+  {
+    numberOfLines *= supportSize;
+  }
+
+  double value = 0.0;
+  for( unsigned int line = 0; line < numberOfLines; ++line )
+  {
+    double          lineWeight = 1.0;
+    OffsetValueType lineOffset = 0;
+    unsigned int    digits     = line;
+    for( unsigned int d = 1; d < InputImageDimension; ++d )
+    {
+      const unsigned int k = digits % supportSize;
+      digits     /= supportSize;
+      lineWeight *= weights[ d ][ k ];
+      lineOffset += offsets[ d ][ k ];
+    }
+
+    const CoefficientType * lineCoefficients = coefficients + lineOffset;
+    double                  lineValue        = 0.0;
+    for( unsigned int k = 0; k < supportSize; ++k )
+    {
+      lineValue += weights[ 0 ][ k ] * lineCoefficients[ offsets[ 0 ][ k ] ];
+    }
+    value += lineWeight * lineValue;
+  }
+
+  return value;
+
+} // end EvaluateWithWeightsAndOffsets()
+
+
 /**
  * ******************* GenerateSampleRegion *******************
  */
@@ -295,7 +629,7 @@ MultiInputImageRandomCoordinateSampler< TInputImage >
   Superclass::PrintSelf( os, indent );
 
   os << indent << "Interpolator: " << this->m_Interpolator.GetPointer() << std::endl;
-  os << indent << "RandomGenerator: " << this->m_RandomGenerator.GetPointer() << std::endl;
+  os << indent << "ComputeChannelValues: " << this->m_ComputeChannelValues << std::endl;
 
 }   // end PrintSelf
 
@@ -0,0 +1,350 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkGPUAdvancedImageToImageMetricEvaluator_h
+#define __itkGPUAdvancedImageToImageMetricEvaluator_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkArray.h"
+#include "itkOpenCLContext.h"
+#include "itkOpenCLKernelManager.h"
+
+#include "itkAdvancedTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkImageSample.h"
+#include "itkVectorDataContainer.h"
+#include "itkHardLimiterFunction.h"
+#include "itkExponentialLimiterFunction.h"
+
+#include <vector>
+
+namespace itk
+{
+/** Create a helper GPU Kernel class for GPUAdvancedImageToImageMetricEvaluator */
+itkGPUKernelClassMacro( GPUAdvancedImageToImageMetricKernel );
+
+/** The limiter as passed to the OpenCL kernels, see
+ * GPUAdvancedImageToImageMetric.cl. Type 0 is no limiter,
+ * 1 the HardLimiterFunction and 2 the ExponentialLimiterFunction.
+ */
+typedef struct
+{
+  cl_uint  Type;
+  cl_float LowerBound;
+  cl_float UpperBound;
+  cl_float LowerThreshold;
+  cl_float UpperThreshold;
+  cl_float UTminUB;
+  cl_float UTminUBinv;
+  cl_float LTminLB;
+  cl_float LTminLBinv;
+} GPUAdvancedImageToImageMetricLimiter;
+
+/** The parameters as passed to the OpenCL kernels, see
+ * GPUAdvancedImageToImageMetric.cl. The matrices are stored
+ * row-major, with as many columns as the image dimension.
+ */
+typedef struct
+{
+  cl_float MovingPointToIndex[ 9 ];
+  cl_float MovingGradientMatrix[ 9 ];
+  cl_float MovingOrigin[ 3 ];
+  cl_uint  MovingSize[ 3 ];
+  cl_float Matrix[ 9 ];
+  cl_float Offset[ 3 ];
+  cl_float GridPointToIndex[ 9 ];
+  cl_float GridOrigin[ 3 ];
+  cl_uint  GridSize[ 3 ];
+  cl_uint  NumberOfParametersPerDimension;
+  GPUAdvancedImageToImageMetricLimiter FixedLimiter;
+  GPUAdvancedImageToImageMetricLimiter MovingLimiter;
+  cl_uint  NumberOfFixedHistogramBins;
+  cl_uint  NumberOfMovingHistogramBins;
+  cl_float FixedImageBinSize;
+  cl_float MovingImageBinSize;
+  cl_float FixedImageNormalizedMin;
+  cl_float MovingImageNormalizedMin;
+  cl_float FixedParzenTermToIndexOffset;
+  cl_float MovingParzenTermToIndexOffset;
+} GPUAdvancedImageToImageMetricParameters;
+
+/** \class GPUAdvancedImageToImageMetricEvaluator
+ * \brief Evaluates the sample loops of some AdvancedImageToImageMetric's with OpenCL.
+ *
+ * The sample loops of the AdvancedMeanSquaresImageToImageMetric and the
+ * ParzenWindowMutualInformationImageToImageMetric are evaluated on the
+ * OpenCL device, for a linearly interpolated moving image, and for an
+ * AdvancedMatrixOffsetTransformBase or a third order AdvancedBSplineDeformableTransform.
+ * The moving image, the samples and the transform coefficients are kept
+ * on the device, only the derivative and some small partial sums per
+ * work group are read back. The images should be 2D or 3D.
+ *
+ * The device uses single precision, so the results differ slightly from
+ * those of the CPU metrics.
+ *
+ * For the affine transforms the derivative is not accumulated per parameter
+ * on the device. Because the transform Jacobian is affine in the point,
+ * it suffices to sum the moments \f$\sum_i w_i g_i\f$ and \f$\sum_i w_i g_i x_i^T\f$
+ * of the moving image gradients \f$g_i\f$, which are mapped to the derivative
+ * with the Jacobian on the host.
+ *
+ * The kernels do not scatter to global memory with atomics, so the results
+ * do not depend on the scheduling of the work items. For the B-spline
+ * transform the samples are sorted on the grid cell of their support, once
+ * per set of samples and grid. Each sample stores its contribution, and a
+ * second kernel sums per parameter the samples of the cells whose support
+ * contains it, in a fixed order. The joint histogram is summed per work group
+ * in the order of the samples, and then over the work groups in order.
+ *
+ * \ingroup GPUCommon
+ */
+template< class TFixedImage, class TMovingImage, class TScalarType >
+class ITK_EXPORT GPUAdvancedImageToImageMetricEvaluator : public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef GPUAdvancedImageToImageMetricEvaluator Self;
+  typedef Object                                 Superclass;
+  typedef SmartPointer< Self >                   Pointer;
+  typedef SmartPointer< const Self >             ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( GPUAdvancedImageToImageMetricEvaluator, Object );
+
+  /** The image dimension. */
+  itkStaticConstMacro( FixedImageDimension, unsigned int, TFixedImage::ImageDimension );
+  itkStaticConstMacro( MovingImageDimension, unsigned int, TMovingImage::ImageDimension );
+
+  /** Typedefs. */
+  typedef TFixedImage                               FixedImageType;
+  typedef TMovingImage                              MovingImageType;
+  typedef TScalarType                               ScalarType;
+  typedef ImageSample< FixedImageType >             ImageSampleType;
+  typedef VectorDataContainer<
+    unsigned long, ImageSampleType >                ImageSampleContainerType;
+  typedef AdvancedTransform< ScalarType,
+    itkGetStaticConstMacro( FixedImageDimension ),
+    itkGetStaticConstMacro( MovingImageDimension ) > AdvancedTransformType;
+  typedef AdvancedMatrixOffsetTransformBase< ScalarType,
+    itkGetStaticConstMacro( FixedImageDimension ),
+    itkGetStaticConstMacro( MovingImageDimension ) > MatrixOffsetTransformType;
+  typedef AdvancedBSplineDeformableTransform< ScalarType,
+    itkGetStaticConstMacro( FixedImageDimension ), 3 > BSplineTransformType;
+  typedef Array< double >                      DerivativeType;
+  typedef GPUAdvancedImageToImageMetricLimiter LimiterParametersType;
+
+  /** The parameters of the Parzen window histograms, see
+   * ParzenWindowHistogramImageToImageMetric.
+   */
+  struct ParzenWindowParametersType
+  {
+    LimiterParametersType FixedLimiter;
+    LimiterParametersType MovingLimiter;
+    unsigned long         NumberOfFixedHistogramBins;
+    unsigned long         NumberOfMovingHistogramBins;
+    double                FixedImageBinSize;
+    double                MovingImageBinSize;
+    double                FixedImageNormalizedMin;
+    double                MovingImageNormalizedMin;
+    double                FixedParzenTermToIndexOffset;
+    double                MovingParzenTermToIndexOffset;
+  };
+
+  /** Set the transform. Returns false if the transform is not
+   * supported, in which case the CPU implementation should be used.
+   */
+  bool SetTransform( const AdvancedTransformType * transform );
+
+  /** Set the moving image. The image is copied to the device
+   * as float, when it is changed.
+   */
+  void SetMovingImage( const MovingImageType * image );
+
+  /** Set the samples. The samples are copied to the device only when the
+   * sampler generated new samples, so once per resolution unless the sampler
+   * selects new samples every iteration.
+   */
+  void SetSamples( const ImageSampleContainerType * samples );
+
+  /** Set the parameters of the Parzen window histograms. */
+  void SetParzenWindowParameters( const ParzenWindowParametersType & parameters );
+
+  /** Convert a limiter to its OpenCL representation. Returns false if the
+   * limiter is not supported. A null limiter is supported.
+   */
+  template< class TLimiter >
+  static bool GetLimiterParameters( const TLimiter * limiter,
+    LimiterParametersType & parameters )
+  {
+    typedef typename TLimiter::InputType InputType;
+    typedef HardLimiterFunction< InputType, TLimiter::Dimension >        HardLimiterType;
+    typedef ExponentialLimiterFunction< InputType, TLimiter::Dimension > ExponentialLimiterType;
+
+    parameters.Type = 0;
+    if( limiter == 0 ) { return true; }
+    parameters.LowerBound     = static_cast< cl_float >( limiter->GetLowerBound() );
+    parameters.UpperBound     = static_cast< cl_float >( limiter->GetUpperBound() );
+    parameters.LowerThreshold = static_cast< cl_float >( limiter->GetLowerThreshold() );
+    parameters.UpperThreshold = static_cast< cl_float >( limiter->GetUpperThreshold() );
+
+    /** Same as ExponentialLimiterFunction::ComputeLimiterSettings(). */
+    const double UTminUB = limiter->GetUpperThreshold() - limiter->GetUpperBound();
+    const double LTminLB = limiter->GetLowerThreshold() - limiter->GetLowerBound();
+    parameters.UTminUB    = UTminUB < -1e-10 ? static_cast< cl_float >( UTminUB ) : 0.0f;
+    parameters.UTminUBinv = UTminUB < -1e-10 ? static_cast< cl_float >( 1.0 / UTminUB ) : 0.0f;
+    parameters.LTminLB    = LTminLB > 1e-10 ? static_cast< cl_float >( LTminLB ) : 0.0f;
+    parameters.LTminLBinv = LTminLB > 1e-10 ? static_cast< cl_float >( 1.0 / LTminLB ) : 0.0f;
+
+    if( dynamic_cast< const HardLimiterType * >( limiter ) != 0 )
+    {
+      parameters.Type = 1;
+      return true;
+    }
+    if( dynamic_cast< const ExponentialLimiterType * >( limiter ) != 0 )
+    {
+      parameters.Type = 2;
+      return true;
+    }
+    return false;
+  }
+
+
+  /** Compute the sum of squared differences, the number of valid samples,
+   * and optionally the derivative 2 (m - f) dM/dmu, summed over the samples.
+   * The result is not normalized.
+   */
+  void ComputeMeanSquares( double & value, SizeValueType & numberOfPixelsCounted,
+    DerivativeType & derivative, const bool computeDerivative );
+
+  /** Compute the joint histogram of the Parzen windows, indexed [ fixed ][ moving ],
+   * and the number of valid samples. The fixed Parzen window has order 0,
+   * the moving Parzen window order 3.
+   */
+  void ComputeJointPDF( std::vector< float > & jointPDF,
+    SizeValueType & numberOfPixelsCounted );
+
+  /** Compute the derivative of the mutual information from the ratios
+   * alpha log( p(f,m) / p(m) ), indexed [ fixed ][ moving ].
+   */
+  void ComputeParzenWindowDerivative( const std::vector< float > & pRatio,
+    DerivativeType & derivative );
+
+protected:
+
+  GPUAdvancedImageToImageMetricEvaluator();
+  virtual ~GPUAdvancedImageToImageMetricEvaluator() {}
+  virtual void PrintSelf( std::ostream & os, Indent indent ) const;
+
+  /** Build the program for the current transform kind, if needed. */
+  void BuildProgram( void );
+
+  /** Copy the current transform parameters to the device, and the samples
+   * when they or the B-spline grid changed.
+   */
+  void UpdateTransformParameters( void );
+
+  /** Copy the parameters of the kernels to the device. */
+  void CopyParametersToDevice( void );
+
+  /** Copy the samples to the device. For the B-spline transform they are
+   * sorted on the grid cell of their support, and the first sample of each
+   * cell is copied as well.
+   */
+  void CopySamplesToDevice( void );
+
+  /** Set the common arguments, launch the kernel, and sum the partials. */
+  void LaunchSampleKernel( OpenCLKernel & kernel, const std::size_t firstArgument,
+    std::vector< double > & partials );
+
+  /** Map the sums of the affine moments to the derivative, or gather the
+   * derivative of the B-spline transform on the device and read it.
+   */
+  void ComputeDerivativeFromPartials( const std::vector< double > & partials,
+    DerivativeType & derivative );
+
+private:
+
+  GPUAdvancedImageToImageMetricEvaluator( const Self & ); // purposely not implemented
+  void operator=( const Self & );                         // purposely not implemented
+
+  /** The supported transforms. */
+  typedef enum {
+    NoTransform = 0,
+    AffineTransform,
+    BSplineTransform
+  } TransformKindType;
+
+  OpenCLKernelManager::Pointer            m_KernelManager;
+  OpenCLProgram                           m_Program;
+  OpenCLKernel                            m_SupportCellsKernel;
+  OpenCLKernel                            m_GatherDerivativeKernel;
+  OpenCLKernel                            m_SumHistogramsKernel;
+  OpenCLKernel                            m_MeanSquaresKernel;
+  OpenCLKernel                            m_JointPDFKernel;
+  OpenCLKernel                            m_ParzenWindowDerivativeKernel;
+  TransformKindType                       m_ProgramTransformKind;
+  std::size_t                             m_WorkGroupSize;
+  std::size_t                             m_MaximumNumberOfGroups;
+  std::size_t                             m_NumberOfGroups;
+  std::size_t                             m_NumberOfPartials;
+
+  TransformKindType                       m_TransformKind;
+  typename AdvancedTransformType::ConstPointer m_Transform;
+  GPUAdvancedImageToImageMetricParameters m_Parameters;
+
+  const MovingImageType *                 m_MovingImage;
+  unsigned long                           m_MovingImageMTime;
+  /** The samples in the order of the container, and the B-spline grid
+   * for which the device samples are sorted.
+   */
+  const ImageSampleContainerType *        m_Samples;
+  unsigned long                           m_SamplesMTime;
+  unsigned long                           m_SamplesUpdateMTime;
+  SizeValueType                           m_NumberOfSamples;
+  std::vector< float >                    m_FixedPoints;
+  std::vector< float >                    m_FixedValues;
+  bool                                    m_SamplesChanged;
+  std::vector< float >                    m_SamplesGrid;
+
+  OpenCLBuffer                            m_MovingImageBuffer;
+  OpenCLBuffer                            m_FixedPointsBuffer;
+  OpenCLBuffer                            m_FixedValuesBuffer;
+  OpenCLBuffer                            m_ParametersBuffer;
+  OpenCLBuffer                            m_CoefficientsBuffer;
+  OpenCLBuffer                            m_DerivativeBuffer;
+  OpenCLBuffer                            m_SampleDerivativesBuffer;
+  OpenCLBuffer                            m_CellOffsetsBuffer;
+  OpenCLBuffer                            m_PartialsBuffer;
+  OpenCLBuffer                            m_GroupHistogramsBuffer;
+  OpenCLBuffer                            m_HistogramBuffer;
+  OpenCLBuffer                            m_PRatioBuffer;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkGPUAdvancedImageToImageMetricEvaluator.hxx"
+#endif
+
+#endif /* __itkGPUAdvancedImageToImageMetricEvaluator_h */
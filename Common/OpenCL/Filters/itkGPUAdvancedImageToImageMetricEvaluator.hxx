@@ -0,0 +1,878 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkGPUAdvancedImageToImageMetricEvaluator_hxx
+#define __itkGPUAdvancedImageToImageMetricEvaluator_hxx
+
+#include "itkGPUAdvancedImageToImageMetricEvaluator.h"
+
+#include "itkGPUMath.h"
+#include "itkGPUImageBase.h"
+#include "itkGPUMatrixOffsetTransformBase.h"
+#include "itkGPUBSplineBaseTransform.h"
+#include "itkOpenCLUtil.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template< class TFixedImage, class TMovingImage, class TScalarType >
+GPUAdvancedImageToImageMetricEvaluator< TFixedImage, TMovingImage, TScalarType >
+::GPUAdvancedImageToImageMetricEvaluator()
+{
+  this->m_KernelManager         = OpenCLKernelManager::New();
+  this->m_ProgramTransformKind  = NoTransform;
+  this->m_WorkGroupSize         = 64;
+  this->m_MaximumNumberOfGroups = 1024;
+  this->m_NumberOfGroups        = 0;
+  this->m_NumberOfPartials      = 0;
+  this->m_TransformKind         = NoTransform;
+  std::memset( &this->m_Parameters, 0, sizeof( this->m_Parameters ) );
+
+  this->m_MovingImage        = 0;
+  this->m_MovingImageMTime   = 0;
+  this->m_Samples            = 0;
+  this->m_SamplesMTime       = 0;
+  this->m_SamplesUpdateMTime = 0;
+  this->m_NumberOfSamples    = 0;
+  this->m_SamplesChanged     = false;
+
+} // end Constructor
+
+
+/**
+ * ******************* SetTransform *******************
+ */
+
+template< class TFixedImage, class TMovingImage, class TScalarType >
+bool
+GPUAdvancedImageToImageMetricEvaluator< TFixedImage, TMovingImage, TScalarType >
+::SetTransform( const AdvancedTransformType * transform )
+{
+  this->m_Transform     = transform;
+  this->m_TransformKind = NoTransform;
+
+  /** Only 2D and 3D are implemented in OpenCL. */
+  if( FixedImageDimension != MovingImageDimension
+    || ( FixedImageDimension != 2 && FixedImageDimension != 3 ) )
+  {
+    return false;
+  }
+
+  if( dynamic_cast< const MatrixOffsetTransformType * >( transform ) != 0 )
+  {
+    this->m_TransformKind = AffineTransform;
+  }
+  else if( dynamic_cast< const BSplineTransformType * >( transform ) != 0 )
+  {
+    this->m_TransformKind = BSplineTransform;
+  }
+  else
+  {
+    return false;
+  }
+
+  this->BuildProgram();
+  return true;
+
+} // end SetTransform()
+
+
+/**
+ * ******************* SetMovingImage *******************
+ */
+
+template< class TFixedImage, class TMovingImage, class TScalarType >
+void
+GPUAdvancedImageToImageMetricEvaluator< TFixedImage, TMovingImage, TScalarType >
+::SetMovingImage( const MovingImageType * image )
+{
+  if( image == this->m_MovingImage && image->GetMTime() == this->m_MovingImageMTime )
+  {
+    return;
+  }
+  this->m_MovingImage      = image;
+  this->m_MovingImageMTime = image->GetMTime();
+
+  const unsigned int Dimension = MovingImageDimension;
+  typedef typename MovingImageType::RegionType RegionType;
+  const RegionType region = image->GetBufferedRegion();
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    if( region.GetSize()[ i ] < 2 )
+    {
+      itkExceptionMacro( << "The moving image should have at least two pixels in each dimension." );
+    }
+  }
+
+  /** The geometry of the moving image. The start index of the buffer is
+   * taken into the origin, so that the device buffer starts at index 0.
+   */
+  typename MovingImageType::PointType origin;
+  image->TransformIndexToPhysicalPoint( region.GetIndex(), origin );
+  const typename MovingImageType::DirectionType direction = image->GetDirection();
+  const typename MovingImageType::SpacingType   spacing   = image->GetSpacing();
+  typename MovingImageType::DirectionType       indexToPoint;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      indexToPoint[ i ][ j ] = direction[ i ][ j ] * spacing[ j ];
+      this->m_Parameters.MovingGradientMatrix[ i * Dimension + j ]
+        = static_cast< cl_float >( direction[ i ][ j ] / spacing[ j ] );
+    }
+  }
+  const typename MovingImageType::DirectionType pointToIndex( indexToPoint.GetInverse() );
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      this->m_Parameters.MovingPointToIndex[ i * Dimension + j ]
+        = static_cast< cl_float >( pointToIndex[ i ][ j ] );
+    }
+    this->m_Parameters.MovingOrigin[ i ] = static_cast< cl_float >( origin[ i ] );
+    this->m_Parameters.MovingSize[ i ]   = static_cast< cl_uint >( region.GetSize()[ i ] );
+  }
+
+  /** Copy the pixels as float. */
+  const std::size_t numberOfPixels = region.GetNumberOfPixels();
+  const typename MovingImageType::PixelType * buffer = image->GetBufferPointer();
+  std::vector< float > pixels( numberOfPixels );
+  for( std::size_t i = 0; i < numberOfPixels; ++i )
+  {
+    pixels[ i ] = static_cast< float >( buffer[ i ] );
+  }
+
+  this->m_MovingImageBuffer = OpenCLContext::GetInstance()->CreateBufferCopy(
+    &pixels[ 0 ], OpenCLMemoryObject::ReadOnly, numberOfPixels * sizeof( float ) );
+  if( this->m_MovingImageBuffer.IsNull() )
+  {
+    itkExceptionMacro( << "Could not create the OpenCL buffer of the moving image." );
+  }
+
+} // end SetMovingImage()
+
+
+/**
+ * ******************* SetSamples *******************
+ */
+
+template< class TFixedImage, class TMovingImage, class TScalarType >
+void
+GPUAdvancedImageToImageMetricEvaluator< TFixedImage, TMovingImage, TScalarType >
+::SetSamples( const ImageSampleContainerType * samples )
+{
+  /** The update time of the container changes when the sampler generates new
+   * samples. The modified time does not always, because the multi-threaded
+   * samplers fill the container with the std::vector functions.
+   */
+  if( samples == this->m_Samples && samples->GetMTime() == this->m_SamplesMTime
+    && samples->GetUpdateMTime() == this->m_SamplesUpdateMTime )
+  {
+    return;
+  }
+  this->m_Samples            = samples;
+  this->m_SamplesMTime       = samples->GetMTime();
+  this->m_SamplesUpdateMTime = samples->GetUpdateMTime();
+  this->m_NumberOfSamples    = samples->Size();
+  this->m_SamplesChanged     = true;
+
+  /** Keep the samples in the order of the container; they are copied to
+   * the device by UpdateTransformParameters().
+   */
+  const unsigned int Dimension = FixedImageDimension;
+  this->m_FixedPoints.resize( this->m_NumberOfSamples * Dimension );
+  this->m_FixedValues.resize( this->m_NumberOfSamples );
+  for( SizeValueType i = 0; i < this->m_NumberOfSamples; ++i )
+  {
+    const ImageSampleType & sample = samples->ElementAt( i );
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      this->m_FixedPoints[ i * Dimension + d ] = static_cast< float >( sample.m_ImageCoordinates[ d ] );
+    }
+    this->m_FixedValues[ i ] = static_cast< float >( sample.m_ImageValue );
+  }
+
+} // end SetSamples()
+
+
+/**
+ * ******************* SetParzenWindowParameters *******************
+ */
+
+template< class TFixedImage, class TMovingImage, class TScalarType >
+void
+GPUAdvancedImageToImageMetricEvaluator< TFixedImage, TMovingImage, TScalarType >
+::SetParzenWindowParameters( const ParzenWindowParametersType & parameters )
+{
+  GPUAdvancedImageToImageMetricParameters & p = this->m_Parameters;
+  p.FixedLimiter                  = parameters.FixedLimiter;
+  p.MovingLimiter                 = parameters.MovingLimiter;
+  p.NumberOfFixedHistogramBins    = static_cast< cl_uint >( parameters.NumberOfFixedHistogramBins );
+  p.NumberOfMovingHistogramBins   = static_cast< cl_uint >( parameters.NumberOfMovingHistogramBins );
+  p.FixedImageBinSize             = static_cast< cl_float >( parameters.FixedImageBinSize );
+  p.MovingImageBinSize            = static_cast< cl_float >( parameters.MovingImageBinSize );
+  p.FixedImageNormalizedMin       = static_cast< cl_float >( parameters.FixedImageNormalizedMin );
+  p.MovingImageNormalizedMin      = static_cast< cl_float >( parameters.MovingImageNormalizedMin );
+  p.FixedParzenTermToIndexOffset  = static_cast< cl_float >( parameters.FixedParzenTermToIndexOffset );
+  p.MovingParzenTermToIndexOffset = static_cast< cl_float >( parameters.MovingParzenTermToIndexOffset );
+
+} // end SetParzenWindowParameters()
+
+
+/**
+ * ******************* BuildProgram *******************
+ */
+
+template< class TFixedImage, class TMovingImage, class TScalarType >
+void
+GPUAdvancedImageToImageMetricEvaluator< TFixedImage, TMovingImage, TScalarType >
+::BuildProgram( void )
+{
+  if( this->m_ProgramTransformKind == this->m_TransformKind )
+  {
+    return;
+  }
+
+  /** The value and the number of samples, and for the affine
+   * transforms the moments of the moving image gradient.
+   */
+  const unsigned int Dimension = FixedImageDimension;
+  this->m_NumberOfPartials = 2;
+  if( this->m_TransformKind == AffineTransform )
+  {
+    this->m_NumberOfPartials += Dimension + Dimension * Dimension;
+  }
+
+  std::ostringstream defines;
+  defines << "#define DIM_" << Dimension << "\n";
+  defines << "#define INPIXELTYPE float\n";
+  if( this->m_TransformKind == AffineTransform )
+  {
+    defines << "#define TRANSFORM_AFFINE\n";
+  }
+  else
+  {
+    defines << "#define TRANSFORM_BSPLINE\n";
+  }
+  defines << "#define WORKGROUP_SIZE " << this->m_WorkGroupSize << "\n";
+  defines << "#define NUMBER_OF_PARTIALS " << this->m_NumberOfPartials << "\n";
+
+  std::ostringstream source;
+  source << GPUMathKernel::GetOpenCLSource();
+  source << GPUImageBaseKernel::GetOpenCLSource();
+  source << GPUMatrixOffsetTransformBaseKernel::GetOpenCLSource();
+  source << GPUBSplineTransformKernel::GetOpenCLSource();
+  source << GPUAdvancedImageToImageMetricKernel::GetOpenCLSource();
+
+  /** Build the program, which is taken from the program cache if possible. */
+  this->m_Program = this->m_KernelManager->BuildProgramFromSourceCode(
+    source.str(), defines.str() );
+  if( this->m_Program.IsNull() )
+  {
+    itkExceptionMacro( << "Kernel has not been loaded from string:\n"
+                       << defines.str() << std::endl << source.str() );
+  }
+
+  this->m_SumHistogramsKernel          = this->m_Program.CreateKernel( "SumGroupHistograms" );
+  this->m_MeanSquaresKernel            = this->m_Program.CreateKernel( "AdvancedMeanSquaresValueAndDerivative" );
+  this->m_JointPDFKernel               = this->m_Program.CreateKernel( "ParzenWindowJointPDF" );
+  this->m_ParzenWindowDerivativeKernel = this->m_Program.CreateKernel( "ParzenWindowMutualInformationDerivative" );
+  if( this->m_TransformKind == BSplineTransform )
+  {
+    this->m_SupportCellsKernel     = this->m_Program.CreateKernel( "ComputeBSplineSupportCells" );
+    this->m_GatherDerivativeKernel = this->m_Program.CreateKernel( "GatherBSplineDerivative" );
+    if( this->m_SupportCellsKernel.IsNull() || this->m_GatherDerivativeKernel.IsNull() )
+    {
+      itkExceptionMacro( << "Could not create the B-spline kernels of the metric." );
+    }
+  }
+  if( this->m_SumHistogramsKernel.IsNull() || this->m_MeanSquaresKernel.IsNull()
+    || this->m_JointPDFKernel.IsNull() || this->m_ParzenWindowDerivativeKernel.IsNull() )
+  {
+    itkExceptionMacro( << "Could not create the kernels of the metric." );
+  }
+
+  this->m_ProgramTransformKind = this->m_TransformKind;
+
+} // end BuildProgram()
+
+
+/**
+ * ******************* UpdateTransformParameters *******************
+ */
+
+template< class TFixedImage, class TMovingImage, class TScalarType >
+void
+GPUAdvancedImageToImageMetricEvaluator< TFixedImage, TMovingImage, TScalarType >
+::UpdateTransformParameters( void )
+{
+  const unsigned int     Dimension = FixedImageDimension;
+  OpenCLContext::Pointer context   = OpenCLContext::GetInstance();
+  std::vector< float >   coefficients( 1, 0.0f );
+
+  if( this->m_TransformKind == AffineTransform )
+  {
+    const MatrixOffsetTransformType * transform
+      = dynamic_cast< const MatrixOffsetTransformType * >( this->m_Transform.GetPointer() );
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      for( unsigned int j = 0; j < Dimension; ++j )
+      {
+        this->m_Parameters.Matrix[ i * Dimension + j ]
+          = static_cast< cl_float >( transform->GetMatrix()[ i ][ j ] );
+      }
+      this->m_Parameters.Offset[ i ] = static_cast< cl_float >( transform->GetOffset()[ i ] );
+    }
+  }
+  else if( this->m_TransformKind == BSplineTransform )
+  {
+    const BSplineTransformType * transform
+      = dynamic_cast< const BSplineTransformType * >( this->m_Transform.GetPointer() );
+
+    /** The geometry of the grid. As for the moving image, the start
+     * index of the grid region is taken into the origin.
+     */
+    typedef typename BSplineTransformType::DirectionType DirectionType;
+    const typename BSplineTransformType::RegionType region    = transform->GetGridRegion();
+    const typename BSplineTransformType::SpacingType spacing  = transform->GetGridSpacing();
+    const DirectionType                              direction = transform->GetGridDirection();
+    typename BSplineTransformType::OriginType        origin    = transform->GetGridOrigin();
+    DirectionType                                    indexToPoint;
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      for( unsigned int j = 0; j < Dimension; ++j )
+      {
+        indexToPoint[ i ][ j ] = direction[ i ][ j ] * spacing[ j ];
+      }
+    }
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      for( unsigned int j = 0; j < Dimension; ++j )
+      {
+        origin[ i ] += indexToPoint[ i ][ j ] * region.GetIndex()[ j ];
+      }
+    }
+    const DirectionType pointToIndex( indexToPoint.GetInverse() );
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      for( unsigned int j = 0; j < Dimension; ++j )
+      {
+        this->m_Parameters.GridPointToIndex[ i * Dimension + j ]
+          = static_cast< cl_float >( pointToIndex[ i ][ j ] );
+      }
+      this->m_Parameters.GridOrigin[ i ] = static_cast< cl_float >( origin[ i ] );
+      this->m_Parameters.GridSize[ i ]   = static_cast< cl_uint >( region.GetSize()[ i ] );
+    }
+    this->m_Parameters.NumberOfParametersPerDimension
+      = static_cast< cl_uint >( transform->GetNumberOfParametersPerDimension() );
+
+    /** The coefficients, laid out as the transform parameters. */
+    const typename BSplineTransformType::ParametersType & parameters = transform->GetParameters();
+    coefficients.resize( parameters.GetSize() );
+    for( std::size_t i = 0; i < coefficients.size(); ++i )
+    {
+      coefficients[ i ] = static_cast< float >( parameters[ i ] );
+    }
+  }
+
+  const std::size_t coefficientsSize = coefficients.size() * sizeof( float );
+  if( this->m_CoefficientsBuffer.IsNull() || this->m_CoefficientsBuffer.GetSize() != coefficientsSize )
+  {
+    this->m_CoefficientsBuffer = context->CreateBufferDevice(
+      OpenCLMemoryObject::ReadOnly, coefficientsSize );
+    this->m_DerivativeBuffer = context->CreateBufferDevice(
+      OpenCLMemoryObject::ReadWrite, coefficientsSize );
+  }
+  if( this->m_CoefficientsBuffer.IsNull() || this->m_DerivativeBuffer.IsNull()
+    || !this->m_CoefficientsBuffer.Write( &coefficients[ 0 ], coefficientsSize ) )
+  {
+    itkExceptionMacro( << "Could not copy the transform parameters to the OpenCL device." );
+  }
+
+  /** Copy the samples, when they changed or, for the B-spline transform, when
+   * the grid changed, on which they are sorted.
+   */
+  std::vector< float > grid;
+  if( this->m_TransformKind == BSplineTransform )
+  {
+    const GPUAdvancedImageToImageMetricParameters & p = this->m_Parameters;
+    grid.assign( p.GridPointToIndex, p.GridPointToIndex + 9 );
+    grid.insert( grid.end(), p.GridOrigin, p.GridOrigin + 3 );
+    grid.insert( grid.end(), p.GridSize, p.GridSize + 3 );
+  }
+  if( this->m_SamplesChanged || grid != this->m_SamplesGrid )
+  {
+    this->m_SamplesGrid = grid;
+    this->CopySamplesToDevice();
+  }
+
+} // end UpdateTransformParameters()
+
+
+/**
+ * ******************* CopyParametersToDevice *******************
+ */
+
+template< class TFixedImage, class TMovingImage, class TScalarType >
+void
+GPUAdvancedImageToImageMetricEvaluator< TFixedImage, TMovingImage, TScalarType >
+::CopyParametersToDevice( void )
+{
+  if( this->m_ParametersBuffer.IsNull() )
+  {
+    this->m_ParametersBuffer = OpenCLContext::GetInstance()->CreateBufferDevice(
+      OpenCLMemoryObject::ReadOnly, sizeof( this->m_Parameters ) );
+  }
+  if( this->m_ParametersBuffer.IsNull()
+    || !this->m_ParametersBuffer.Write( &this->m_Parameters, sizeof( this->m_Parameters ) ) )
+  {
+    itkExceptionMacro( << "Could not copy the parameters of the metric to the OpenCL device." );
+  }
+
+} // end CopyParametersToDevice()
+
+
+/**
+ * ******************* CopySamplesToDevice *******************
+ */
+
+template< class TFixedImage, class TMovingImage, class TScalarType >
+void
+GPUAdvancedImageToImageMetricEvaluator< TFixedImage, TMovingImage, TScalarType >
+::CopySamplesToDevice( void )
+{
+  const unsigned int     Dimension       = FixedImageDimension;
+  const SizeValueType    numberOfSamples = this->m_NumberOfSamples;
+  OpenCLContext::Pointer context         = OpenCLContext::GetInstance();
+  this->m_SamplesChanged = false;
+  this->m_NumberOfGroups = std::min( this->m_MaximumNumberOfGroups,
+    static_cast< std::size_t >( ( numberOfSamples + this->m_WorkGroupSize - 1 ) / this->m_WorkGroupSize ) );
+
+  /** The contributions of the samples to the B-spline derivative: the weighted
+   * gradient and the 1D weights of the third order support. The other
+   * transforms do not use them, but the kernels need a buffer.
+   */
+  const unsigned int supportSize           = 4;
+  const std::size_t  sampleDerivativesSize = this->m_TransformKind == BSplineTransform
+    ? numberOfSamples * Dimension * ( 1 + supportSize ) * sizeof( float ) : sizeof( float );
+  if( this->m_SampleDerivativesBuffer.IsNull()
+    || this->m_SampleDerivativesBuffer.GetSize() != sampleDerivativesSize )
+  {
+    this->m_SampleDerivativesBuffer = context->CreateBufferDevice(
+      OpenCLMemoryObject::ReadWrite, sampleDerivativesSize );
+    if( this->m_SampleDerivativesBuffer.IsNull() )
+    {
+      itkExceptionMacro( << "Could not create the OpenCL buffer of the sample derivatives." );
+    }
+  }
+  if( numberOfSamples == 0 )
+  {
+    return;
+  }
+
+  /** Copy the samples in the order of the container. Reuse the buffers when
+   * the number of samples does not change, which is the case for the random
+   * samplers.
+   */
+  const std::size_t pointsSize = this->m_FixedPoints.size() * sizeof( float );
+  const std::size_t valuesSize = this->m_FixedValues.size() * sizeof( float );
+  if( this->m_FixedValuesBuffer.IsNull() || this->m_FixedValuesBuffer.GetSize() != valuesSize )
+  {
+    this->m_FixedPointsBuffer = context->CreateBufferDevice( OpenCLMemoryObject::ReadOnly, pointsSize );
+    this->m_FixedValuesBuffer = context->CreateBufferDevice( OpenCLMemoryObject::ReadOnly, valuesSize );
+  }
+  if( this->m_FixedPointsBuffer.IsNull() || this->m_FixedValuesBuffer.IsNull()
+    || !this->m_FixedPointsBuffer.Write( &this->m_FixedPoints[ 0 ], pointsSize )
+    || !this->m_FixedValuesBuffer.Write( &this->m_FixedValues[ 0 ], valuesSize ) )
+  {
+    itkExceptionMacro( << "Could not copy the samples to the OpenCL device." );
+  }
+  if( this->m_TransformKind != BSplineTransform )
+  {
+    return;
+  }
+
+  /** Compute the grid cells of the supports of the samples on the device,
+   * so that they are the same as in the sample kernels.
+   */
+  this->CopyParametersToDevice();
+  OpenCLBuffer cellsBuffer = context->CreateBufferDevice(
+    OpenCLMemoryObject::WriteOnly, numberOfSamples * sizeof( cl_uint ) );
+  if( cellsBuffer.IsNull() )
+  {
+    itkExceptionMacro( << "Could not create the OpenCL buffer of the support cells." );
+  }
+  this->m_SupportCellsKernel.SetArg( 0, this->m_FixedPointsBuffer );
+  this->m_SupportCellsKernel.SetArg( 1, static_cast< cl_uint >( numberOfSamples ) );
+  this->m_SupportCellsKernel.SetArg( 2, this->m_ParametersBuffer );
+  this->m_SupportCellsKernel.SetArg( 3, cellsBuffer );
+  const std::size_t globalSize
+    = ( ( numberOfSamples + this->m_WorkGroupSize - 1 ) / this->m_WorkGroupSize ) * this->m_WorkGroupSize;
+  this->m_SupportCellsKernel.LaunchKernel(
+    OpenCLSize( globalSize ), OpenCLSize( this->m_WorkGroupSize ) ).WaitForFinished();
+
+  std::vector< cl_uint > cells( numberOfSamples );
+  if( !cellsBuffer.Read( &cells[ 0 ], numberOfSamples * sizeof( cl_uint ) ) )
+  {
+    itkExceptionMacro( << "Could not read the support cells from the OpenCL device." );
+  }
+
+  /** Sort the samples on their cell, keeping the order of the container
+   * within a cell. The samples outside the grid have the number of cells,
+   * and come last.
+   */
+  std::size_t numberOfCells = 1;
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    numberOfCells *= this->m_Parameters.GridSize[ d ];
+  }
+  std::vector< cl_uint > cellOffsets( numberOfCells + 2, 0 );
+  for( SizeValueType i = 0; i < numberOfSamples; ++i )
+  {
+    ++cellOffsets[ cells[ i ] + 1 ];
+  }
+  for( std::size_t c = 1; c < cellOffsets.size(); ++c )
+  {
+    cellOffsets[ c ] += cellOffsets[ c - 1 ];
+  }
+  std::vector< cl_uint > next( cellOffsets.begin(), cellOffsets.end() - 1 );
+  std::vector< float >   points( this->m_FixedPoints.size() );
+  std::vector< float >   values( this->m_FixedValues.size() );
+  for( SizeValueType i = 0; i < numberOfSamples; ++i )
+  {
+    const cl_uint j = next[ cells[ i ] ]++;
+    std::copy( &this->m_FixedPoints[ i * Dimension ], &this->m_FixedPoints[ i * Dimension ] + Dimension,
+      &points[ j * Dimension ] );
+    values[ j ] = this->m_FixedValues[ i ];
+  }
+
+  const std::size_t cellOffsetsSize = ( numberOfCells + 1 ) * sizeof( cl_uint );
+  if( this->m_CellOffsetsBuffer.IsNull() || this->m_CellOffsetsBuffer.GetSize() != cellOffsetsSize )
+  {
+    this->m_CellOffsetsBuffer = context->CreateBufferDevice(
+      OpenCLMemoryObject::ReadOnly, cellOffsetsSize );
+  }
+  if( this->m_CellOffsetsBuffer.IsNull()
+    || !this->m_CellOffsetsBuffer.Write( &cellOffsets[ 0 ], cellOffsetsSize )
+    || !this->m_FixedPointsBuffer.Write( &points[ 0 ], pointsSize )
+    || !this->m_FixedValuesBuffer.Write( &values[ 0 ], valuesSize ) )
+  {
+    itkExceptionMacro( << "Could not copy the sorted samples to the OpenCL device." );
+  }
+
+} // end CopySamplesToDevice()
+
+
+/**
+ * ******************* LaunchSampleKernel *******************
+ */
+
+template< class TFixedImage, class TMovingImage, class TScalarType >
+void
+GPUAdvancedImageToImageMetricEvaluator< TFixedImage, TMovingImage, TScalarType >
+::LaunchSampleKernel( OpenCLKernel & kernel, const std::size_t firstArgument,
+  std::vector< double > & partials )
+{
+  partials.assign( this->m_NumberOfPartials, 0.0 );
+  if( this->m_NumberOfSamples == 0 )
+  {
+    return;
+  }
+
+  /** The work groups loop over chunks of the samples. */
+  const std::size_t numberOfGroups = this->m_NumberOfGroups;
+  const std::size_t partialsSize   = numberOfGroups * this->m_NumberOfPartials * sizeof( float );
+  if( this->m_PartialsBuffer.IsNull() || this->m_PartialsBuffer.GetSize() != partialsSize )
+  {
+    this->m_PartialsBuffer = OpenCLContext::GetInstance()->CreateBufferDevice(
+      OpenCLMemoryObject::WriteOnly, partialsSize );
+  }
+  if( this->m_PartialsBuffer.IsNull() )
+  {
+    itkExceptionMacro( << "Could not create the OpenCL buffers of the metric." );
+  }
+  this->CopyParametersToDevice();
+
+  /** The arguments that all sample kernels have in common. */
+  kernel.SetArg( 0, this->m_FixedPointsBuffer );
+  kernel.SetArg( 1, this->m_FixedValuesBuffer );
+  kernel.SetArg( 2, static_cast< cl_uint >( this->m_NumberOfSamples ) );
+  kernel.SetArg( 3, this->m_MovingImageBuffer );
+  kernel.SetArg( 4, this->m_ParametersBuffer );
+  kernel.SetArg( 5, this->m_CoefficientsBuffer );
+  kernel.SetArg( static_cast< cl_uint >( firstArgument ), this->m_PartialsBuffer );
+
+  OpenCLEvent event = kernel.LaunchKernel(
+    OpenCLSize( numberOfGroups * this->m_WorkGroupSize ), OpenCLSize( this->m_WorkGroupSize ) );
+  event.WaitForFinished();
+
+  /** Sum the partials of the work groups in double precision. */
+  std::vector< float > groupPartials( numberOfGroups * this->m_NumberOfPartials );
+  if( !this->m_PartialsBuffer.Read( &groupPartials[ 0 ], partialsSize ) )
+  {
+    itkExceptionMacro( << "Could not read the partial sums from the OpenCL device." );
+  }
+  for( std::size_t g = 0; g < numberOfGroups; ++g )
+  {
+    for( std::size_t i = 0; i < this->m_NumberOfPartials; ++i )
+    {
+      partials[ i ] += groupPartials[ g * this->m_NumberOfPartials + i ];
+    }
+  }
+
+} // end LaunchSampleKernel()
+
+
+/**
+ * ******************* ComputeDerivativeFromPartials *******************
+ */
+
+template< class TFixedImage, class TMovingImage, class TScalarType >
+void
+GPUAdvancedImageToImageMetricEvaluator< TFixedImage, TMovingImage, TScalarType >
+::ComputeDerivativeFromPartials( const std::vector< double > & partials,
+  DerivativeType & derivative )
+{
+  const unsigned int Dimension = FixedImageDimension;
+  derivative.SetSize( this->m_Transform->GetNumberOfParameters() );
+  derivative.Fill( NumericTraits< double >::ZeroValue() );
+
+  if( this->m_TransformKind == BSplineTransform )
+  {
+    if( this->m_NumberOfSamples == 0 )
+    {
+      return;
+    }
+
+    /** Sum the contributions of the samples per control point. */
+    const std::size_t numberOfControlPoints = this->m_Parameters.NumberOfParametersPerDimension;
+    this->m_GatherDerivativeKernel.SetArg( 0, this->m_SampleDerivativesBuffer );
+    this->m_GatherDerivativeKernel.SetArg( 1, this->m_CellOffsetsBuffer );
+    this->m_GatherDerivativeKernel.SetArg( 2, this->m_ParametersBuffer );
+    this->m_GatherDerivativeKernel.SetArg( 3, this->m_DerivativeBuffer );
+    const std::size_t globalSize = ( ( numberOfControlPoints + this->m_WorkGroupSize - 1 )
+      / this->m_WorkGroupSize ) * this->m_WorkGroupSize;
+    this->m_GatherDerivativeKernel.LaunchKernel(
+      OpenCLSize( globalSize ), OpenCLSize( this->m_WorkGroupSize ) ).WaitForFinished();
+
+    std::vector< float > deviceDerivative( derivative.GetSize() );
+    if( !this->m_DerivativeBuffer.Read( &deviceDerivative[ 0 ],
+      deviceDerivative.size() * sizeof( float ) ) )
+    {
+      itkExceptionMacro( << "Could not read the derivative from the OpenCL device." );
+    }
+    for( std::size_t mu = 0; mu < deviceDerivative.size(); ++mu )
+    {
+      derivative[ mu ] = deviceDerivative[ mu ];
+    }
+    return;
+  }
+
+  /** The Jacobian of the affine transforms is affine in the point:
+   * J(x) = J(0) + sum_j x_j ( J(e_j) - J(0) ), so the derivative
+   * sum_k w_k g_k^T J(x_k) follows from the moments G = sum_k w_k g_k
+   * and H = sum_k w_k g_k x_k^T.
+   */
+  typedef typename AdvancedTransformType::InputPointType             InputPointType;
+  typedef typename AdvancedTransformType::JacobianType               JacobianType;
+  typedef typename AdvancedTransformType::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
+  const double *             G = &partials[ 2 ];
+  const double *             H = &partials[ 2 + Dimension ];
+  InputPointType             point;
+  JacobianType               jacobian0, jacobian;
+  NonZeroJacobianIndicesType nzji;
+
+  point.Fill( 0.0 );
+  this->m_Transform->GetJacobian( point, jacobian0, nzji );
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    for( std::size_t mu = 0; mu < nzji.size(); ++mu )
+    {
+      derivative[ nzji[ mu ] ] += G[ i ] * jacobian0( i, mu );
+    }
+  }
+
+  for( unsigned int j = 0; j < Dimension; ++j )
+  {
+    point.Fill( 0.0 );
+    point[ j ] = 1.0;
+    this->m_Transform->GetJacobian( point, jacobian, nzji );
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      for( std::size_t mu = 0; mu < nzji.size(); ++mu )
+      {
+        derivative[ nzji[ mu ] ] += H[ i * Dimension + j ]
+          * ( jacobian( i, mu ) - jacobian0( i, mu ) );
+      }
+    }
+  }
+
+} // end ComputeDerivativeFromPartials()
+
+
+/**
+ * ******************* ComputeMeanSquares *******************
+ */
+
+template< class TFixedImage, class TMovingImage, class TScalarType >
+void
+GPUAdvancedImageToImageMetricEvaluator< TFixedImage, TMovingImage, TScalarType >
+::ComputeMeanSquares( double & value, SizeValueType & numberOfPixelsCounted,
+  DerivativeType & derivative, const bool computeDerivative )
+{
+  this->UpdateTransformParameters();
+
+  std::vector< double > partials;
+  this->m_MeanSquaresKernel.SetArg( 6, static_cast< cl_uint >( computeDerivative ) );
+  this->m_MeanSquaresKernel.SetArg( 7, this->m_SampleDerivativesBuffer );
+  this->LaunchSampleKernel( this->m_MeanSquaresKernel, 8, partials );
+
+  value                 = partials[ 0 ];
+  numberOfPixelsCounted = static_cast< SizeValueType >( partials[ 1 ] + 0.5 );
+  if( computeDerivative )
+  {
+    this->ComputeDerivativeFromPartials( partials, derivative );
+  }
+
+} // end ComputeMeanSquares()
+
+
+/**
+ * ******************* ComputeJointPDF *******************
+ */
+
+template< class TFixedImage, class TMovingImage, class TScalarType >
+void
+GPUAdvancedImageToImageMetricEvaluator< TFixedImage, TMovingImage, TScalarType >
+::ComputeJointPDF( std::vector< float > & jointPDF, SizeValueType & numberOfPixelsCounted )
+{
+  this->UpdateTransformParameters();
+
+  const std::size_t size = this->m_Parameters.NumberOfFixedHistogramBins
+    * this->m_Parameters.NumberOfMovingHistogramBins;
+  numberOfPixelsCounted = 0;
+  if( this->m_NumberOfSamples == 0 )
+  {
+    jointPDF.assign( size, 0.0f );
+    return;
+  }
+
+  /** The histograms of the work groups, and their sum. */
+  OpenCLContext::Pointer context            = OpenCLContext::GetInstance();
+  const std::size_t      groupHistogramSize = this->m_NumberOfGroups * size * sizeof( float );
+  if( this->m_GroupHistogramsBuffer.IsNull() || this->m_GroupHistogramsBuffer.GetSize() != groupHistogramSize )
+  {
+    this->m_GroupHistogramsBuffer = context->CreateBufferDevice(
+      OpenCLMemoryObject::ReadWrite, groupHistogramSize );
+  }
+  if( this->m_HistogramBuffer.IsNull() || this->m_HistogramBuffer.GetSize() != size * sizeof( float ) )
+  {
+    this->m_HistogramBuffer = context->CreateBufferDevice(
+      OpenCLMemoryObject::WriteOnly, size * sizeof( float ) );
+  }
+  if( this->m_GroupHistogramsBuffer.IsNull() || this->m_HistogramBuffer.IsNull() )
+  {
+    itkExceptionMacro( << "Could not create the OpenCL buffers of the joint histogram." );
+  }
+
+  std::vector< double > partials;
+  this->m_JointPDFKernel.SetArg( 6, this->m_GroupHistogramsBuffer );
+  this->LaunchSampleKernel( this->m_JointPDFKernel, 7, partials );
+  numberOfPixelsCounted = static_cast< SizeValueType >( partials[ 1 ] + 0.5 );
+
+  /** Sum the histograms of the work groups, in order. */
+  this->m_SumHistogramsKernel.SetArg( 0, this->m_GroupHistogramsBuffer );
+  this->m_SumHistogramsKernel.SetArg( 1, static_cast< cl_uint >( this->m_NumberOfGroups ) );
+  this->m_SumHistogramsKernel.SetArg( 2, static_cast< cl_uint >( size ) );
+  this->m_SumHistogramsKernel.SetArg( 3, this->m_HistogramBuffer );
+  const std::size_t globalSize
+    = ( ( size + this->m_WorkGroupSize - 1 ) / this->m_WorkGroupSize ) * this->m_WorkGroupSize;
+  this->m_SumHistogramsKernel.LaunchKernel(
+    OpenCLSize( globalSize ), OpenCLSize( this->m_WorkGroupSize ) ).WaitForFinished();
+
+  jointPDF.resize( size );
+  if( !this->m_HistogramBuffer.Read( &jointPDF[ 0 ], size * sizeof( float ) ) )
+  {
+    itkExceptionMacro( << "Could not read the joint histogram from the OpenCL device." );
+  }
+
+} // end ComputeJointPDF()
+
+
+/**
+ * ******************* ComputeParzenWindowDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage, class TScalarType >
+void
+GPUAdvancedImageToImageMetricEvaluator< TFixedImage, TMovingImage, TScalarType >
+::ComputeParzenWindowDerivative( const std::vector< float > & pRatio,
+  DerivativeType & derivative )
+{
+  /** The transform parameters are those of the last ComputeJointPDF(). */
+  const std::size_t size = pRatio.size() * sizeof( float );
+  if( this->m_PRatioBuffer.IsNull() || this->m_PRatioBuffer.GetSize() != size )
+  {
+    this->m_PRatioBuffer = OpenCLContext::GetInstance()->CreateBufferDevice(
+      OpenCLMemoryObject::ReadOnly, size );
+  }
+  if( this->m_PRatioBuffer.IsNull() || !this->m_PRatioBuffer.Write( &pRatio[ 0 ], size ) )
+  {
+    itkExceptionMacro( << "Could not copy the PRatio array to the OpenCL device." );
+  }
+
+  std::vector< double > partials;
+  this->m_ParzenWindowDerivativeKernel.SetArg( 6, this->m_PRatioBuffer );
+  this->m_ParzenWindowDerivativeKernel.SetArg( 7, this->m_SampleDerivativesBuffer );
+  this->LaunchSampleKernel( this->m_ParzenWindowDerivativeKernel, 8, partials );
+  this->ComputeDerivativeFromPartials( partials, derivative );
+
+} // end ComputeParzenWindowDerivative()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template< class TFixedImage, class TMovingImage, class TScalarType >
+void
+GPUAdvancedImageToImageMetricEvaluator< TFixedImage, TMovingImage, TScalarType >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "TransformKind: " << this->m_TransformKind << std::endl;
+  os << indent << "WorkGroupSize: " << this->m_WorkGroupSize << std::endl;
+  os << indent << "MaximumNumberOfGroups: " << this->m_MaximumNumberOfGroups << std::endl;
+  os << indent << "NumberOfGroups: " << this->m_NumberOfGroups << std::endl;
+  os << indent << "NumberOfPartials: " << this->m_NumberOfPartials << std::endl;
+  os << indent << "NumberOfSamples: " << this->m_NumberOfSamples << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkGPUAdvancedImageToImageMetricEvaluator_hxx
@@ -36,11 +36,68 @@
 #include "itkOpenCLContext.h"
 #include "itkOpenCLMacro.h"
 
+#include "itksys/MD5.h"
+#include "itksys/SystemTools.hxx"
+#include "itkSimpleFastMutexLock.h"
+#include "itkMutexLockHolder.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#if defined( _WIN32 ) && !defined( __CYGWIN__ )
+  #include <process.h>
+#else
+  #include <unistd.h>
+#endif
+
+// Defined in itkOpenCLProgram.cxx, used for the key of the program cache
+namespace OpenCLProgramSupport
+{
+bool GetOpenCLMathAndOptimizationOptions( std::string & options );
+}
+
 namespace itk
 {
+// The directory of the program cache, shared by all kernel managers
+static std::string OpenCLProgramCacheDirectory;
+static bool        OpenCLProgramCacheDirectoryIsSet = false;
+
+// Counter for unique temporary file names of the program cache, within
+// this process
+static unsigned long       OpenCLProgramCacheTemporaryFileCounter = 0;
+static SimpleFastMutexLock OpenCLProgramCacheTemporaryFileMutex;
+
+//------------------------------------------------------------------------------
+// Returns a temporary file name for the cache file, which is unique among the
+// processes that share the cache directory and among the writes of this process
+static std::string
+GetProgramCacheTemporaryFileName( const std::string & fileName )
+{
+  unsigned long counter = 0;
+  {
+    MutexLockHolder< SimpleFastMutexLock > holder( OpenCLProgramCacheTemporaryFileMutex );
+    counter = OpenCLProgramCacheTemporaryFileCounter++;
+  }
+
+#if defined( _WIN32 ) && !defined( __CYGWIN__ )
+  const long processId = static_cast< long >( _getpid() );
+#else
+  const long processId = static_cast< long >( getpid() );
+#endif
+
+  std::ostringstream temporaryFileName;
+  temporaryFileName << fileName << "." << processId << "." << counter << ".tmp";
+  return temporaryFileName.str();
+}
+
+
+//------------------------------------------------------------------------------
 OpenCLKernelManager::OpenCLKernelManager()
 {
-  this->m_Context = OpenCLContext::GetInstance();
+  this->m_Context                    = OpenCLContext::GetInstance();
+  this->m_LastProgramLoadedFromCache = false;
 }
 
 
@@ -103,12 +160,48 @@ OpenCLKernelManager::BuildProgramFromSourceCode( const std::string & sourceCode,
   const std::string & extraBuildOptions )
 {
   const std::list< OpenCLDevice > devices = this->m_Context->GetDevices();
-  OpenCLProgram                   program = this->m_Context->BuildProgramFromSourceCode( devices,
+  this->m_LastProgramLoadedFromCache = false;
+
+  // The cache is only used for a single device, for which binaries
+  // can be created with OpenCLContext::CreateProgramFromBinaryCode()
+  const bool useCache = !GetProgramCacheDirectory().empty() && !sourceCode.empty()
+    && devices.size() == 1 && devices.front() == this->m_Context->GetDefaultDevice();
+
+  std::string key;
+  if( useCache )
+  {
+    // Compose the source in the same way as OpenCLContext does
+    std::stringstream sstream;
+    if( !prefixSourceCode.empty() )
+    {
+      sstream << prefixSourceCode << std::endl;
+    }
+    sstream << sourceCode;
+    if( !postfixSourceCode.empty() )
+    {
+      sstream << std::endl << postfixSourceCode;
+    }
+
+    key = this->GetProgramCacheKey( devices.front(), sstream.str(), extraBuildOptions );
+    OpenCLProgram program = this->LoadProgramFromCache( key, devices, extraBuildOptions );
+    if( !program.IsNull() )
+    {
+      this->m_LastProgramLoadedFromCache = true;
+      return program;
+    }
+  }
+
+  OpenCLProgram program = this->m_Context->BuildProgramFromSourceCode( devices,
     sourceCode,
     prefixSourceCode,
     postfixSourceCode,
     extraBuildOptions );
 
+  if( useCache && !program.IsNull() )
+  {
+    this->StoreProgramInCache( key, program, devices.front() );
+  }
+
   return program;
 }
 
@@ -120,6 +213,20 @@ OpenCLKernelManager::BuildProgramFromSourceFile( const std::string & fileName,
   const std::string & postfixSourceCode,
   const std::string & extraBuildOptions )
 {
+  // With the program cache the source is needed for the key,
+  // so the file is read here
+  if( !GetProgramCacheDirectory().empty() )
+  {
+    std::ifstream inputFile( fileName.c_str(), std::ifstream::in | std::ifstream::binary );
+    if( inputFile.is_open() )
+    {
+      std::stringstream sstream;
+      sstream << inputFile.rdbuf();
+      return this->BuildProgramFromSourceCode( sstream.str(),
+        prefixSourceCode, postfixSourceCode, extraBuildOptions );
+    }
+  }
+
   const std::list< OpenCLDevice > devices = this->m_Context->GetDevices();
   OpenCLProgram                   program = this->m_Context->BuildProgramFromSourceFile( devices,
     fileName,
@@ -127,10 +234,178 @@ OpenCLKernelManager::BuildProgramFromSourceFile( const std::string & fileName,
     postfixSourceCode,
     extraBuildOptions );
 
+  this->m_LastProgramLoadedFromCache = false;
   return program;
 }
 
 
+//------------------------------------------------------------------------------
+void
+OpenCLKernelManager::SetProgramCacheDirectory( const std::string & directory )
+{
+  OpenCLProgramCacheDirectory      = directory;
+  OpenCLProgramCacheDirectoryIsSet = true;
+  if( !directory.empty() )
+  {
+    itksys::SystemTools::MakeDirectory( directory.c_str() );
+  }
+}
+
+
+//------------------------------------------------------------------------------
+std::string
+OpenCLKernelManager::GetProgramCacheDirectory()
+{
+  if( !OpenCLProgramCacheDirectoryIsSet )
+  {
+    const char * directory = std::getenv( "ELASTIX_OPENCL_PROGRAM_CACHE_DIR" );
+    SetProgramCacheDirectory( directory ? std::string( directory ) : std::string() );
+  }
+  return OpenCLProgramCacheDirectory;
+}
+
+
+//------------------------------------------------------------------------------
+std::string
+OpenCLKernelManager::GetProgramCacheKey( const OpenCLDevice & device,
+  const std::string & source,
+  const std::string & extraBuildOptions ) const
+{
+  // The options that OpenCLProgram::Build() adds
+  std::string options;
+  OpenCLProgramSupport::GetOpenCLMathAndOptimizationOptions( options );
+
+  std::ostringstream key;
+  key << "Device: " << device.GetVendor() << " " << device.GetName() << "\n"
+      << "Version: " << device.GetVersion() << "\n"
+      << "Driver version: " << device.GetDriverVersion() << "\n"
+      << "Build options: " << options << " " << extraBuildOptions << "\n"
+      << source;
+  return key.str();
+}
+
+
+//------------------------------------------------------------------------------
+std::string
+OpenCLKernelManager::GetProgramCacheFileName( const std::string & key ) const
+{
+  // Create unique filename based on the key
+  itksysMD5 * md5 = itksysMD5_New();
+  itksysMD5_Initialize( md5 );
+  itksysMD5_Append( md5, (unsigned char *)key.c_str(), key.size() );
+  const std::size_t DigestSize = 32u;
+  char              Digest[ DigestSize ];
+  itksysMD5_FinalizeHex( md5, Digest );
+  itksysMD5_Delete( md5 );
+
+  return GetProgramCacheDirectory() + "/ocl-" + std::string( Digest, DigestSize ) + ".bin";
+}
+
+
+//------------------------------------------------------------------------------
+OpenCLProgram
+OpenCLKernelManager::LoadProgramFromCache( const std::string & key,
+  const std::list< OpenCLDevice > & devices,
+  const std::string & extraBuildOptions )
+{
+  // The file contains the size of the key, the key, and the binary.
+  // The key is compared, to exclude collisions of the file name.
+  std::ifstream file( this->GetProgramCacheFileName( key ).c_str(),
+    std::ifstream::in | std::ifstream::binary );
+  if( !file.is_open() )
+  {
+    return OpenCLProgram();
+  }
+
+  std::size_t keySize = 0;
+  file.read( reinterpret_cast< char * >( &keySize ), sizeof( keySize ) );
+  if( !file || keySize != key.size() )
+  {
+    return OpenCLProgram();
+  }
+  std::string storedKey( keySize, '\0' );
+  file.read( &storedKey[ 0 ], keySize );
+  if( !file || storedKey != key )
+  {
+    return OpenCLProgram();
+  }
+
+  std::size_t binarySize = 0;
+  file.read( reinterpret_cast< char * >( &binarySize ), sizeof( binarySize ) );
+  if( !file || binarySize == 0 )
+  {
+    return OpenCLProgram();
+  }
+  std::vector< unsigned char > binary( binarySize );
+  file.read( reinterpret_cast< char * >( &binary[ 0 ] ), binarySize );
+  if( !file )
+  {
+    return OpenCLProgram();
+  }
+
+  // A binary that is rejected by the driver is rebuilt from source
+  try
+  {
+    OpenCLProgram program = this->m_Context->CreateProgramFromBinaryCode( &binary[ 0 ], binarySize );
+    if( !program.IsNull() && program.Build( devices, extraBuildOptions ) )
+    {
+      return program;
+    }
+  }
+  catch( ExceptionObject & )
+  {
+    itkOpenCLWarningMacro( << "The cached OpenCL program binary could not be used, "
+                           << "building from source." );
+  }
+
+  return OpenCLProgram();
+}
+
+
+//------------------------------------------------------------------------------
+void
+OpenCLKernelManager::StoreProgramInCache( const std::string & key,
+  const OpenCLProgram & program, const OpenCLDevice & device )
+{
+  std::vector< unsigned char > binary;
+  if( !program.GetBinary( device, binary ) )
+  {
+    return;
+  }
+
+  // Write to a temporary file first, so that other processes never read
+  // a partially written binary
+  const std::string fileName          = this->GetProgramCacheFileName( key );
+  const std::string temporaryFileName = GetProgramCacheTemporaryFileName( fileName );
+  {
+    std::ofstream file( temporaryFileName.c_str(),
+      std::ofstream::out | std::ofstream::binary | std::ofstream::trunc );
+    if( !file.is_open() )
+    {
+      return;
+    }
+
+    const std::size_t keySize    = key.size();
+    const std::size_t binarySize = binary.size();
+    file.write( reinterpret_cast< const char * >( &keySize ), sizeof( keySize ) );
+    file.write( key.c_str(), keySize );
+    file.write( reinterpret_cast< const char * >( &binarySize ), sizeof( binarySize ) );
+    file.write( reinterpret_cast< const char * >( &binary[ 0 ] ), binarySize );
+    if( !file )
+    {
+      file.close();
+      std::remove( temporaryFileName.c_str() );
+      return;
+    }
+  }
+
+  if( std::rename( temporaryFileName.c_str(), fileName.c_str() ) != 0 )
+  {
+    std::remove( temporaryFileName.c_str() );
+  }
+}
+
+
 //------------------------------------------------------------------------------
 bool
 OpenCLKernelManager::SetKernelArg( const std::size_t kernelId,
@@ -52,6 +52,14 @@ namespace itk
  * This class is responsible for managing the GPU kernel and
  * command queue.
  *
+ * Programs built from source can be stored in an on-disk cache of
+ * program binaries, so that later processes skip the compilation.
+ * The cache is keyed by the device, its driver version, the source code
+ * and the build options, and is only used for contexts with a single
+ * device. The cache is disabled by default; it is enabled by
+ * SetProgramCacheDirectory(), or by the environment variable
+ * ELASTIX_OPENCL_PROGRAM_CACHE_DIR.
+ *
  * \note This file was taken from ITK 4.1.0.
  * It was modified by Denis P. Shamonin and Marius Staring.
  * Division of Image Processing,
@@ -113,6 +121,20 @@ public:
     const std::string & postfixSourceCode = std::string(),
     const std::string & extraBuildOptions = std::string() );
 
+  /** Sets the directory of the on-disk cache of program binaries, which is
+   * shared by all kernel managers. An empty directory disables the cache.
+   * The directory is created if it does not exist. */
+  static void SetProgramCacheDirectory( const std::string & directory );
+
+  /** Returns the directory of the on-disk cache of program binaries.
+   * If it was not set, ELASTIX_OPENCL_PROGRAM_CACHE_DIR is used. */
+  static std::string GetProgramCacheDirectory();
+
+  /** Returns true if the last program built by this manager was
+   * loaded from the program cache. */
+  bool GetLastProgramLoadedFromCache() const
+  { return this->m_LastProgramLoadedFromCache; }
+
   /** Sets the global work size for all instances of the kernels to \a size.
    * \sa SetLocalWorkSizeForAllKernels(), SetGlobalWorkOffsetForAllKernels() */
   void SetGlobalWorkSizeForAllKernels( const OpenCLSize & size );
@@ -142,12 +164,31 @@ protected:
 
   void ResetArguments( const std::size_t kernelIdx );
 
+  /** Returns the key of a program in the program cache. */
+  std::string GetProgramCacheKey( const OpenCLDevice & device,
+    const std::string & source,
+    const std::string & extraBuildOptions ) const;
+
+  /** Returns the file name of a program in the program cache. */
+  std::string GetProgramCacheFileName( const std::string & key ) const;
+
+  /** Loads and builds a program from the program cache. Returns a null
+   * program if it is not in the cache, or if it can not be built. */
+  OpenCLProgram LoadProgramFromCache( const std::string & key,
+    const std::list< OpenCLDevice > & devices,
+    const std::string & extraBuildOptions );
+
+  /** Stores the binary of a built program in the program cache. */
+  void StoreProgramInCache( const std::string & key,
+    const OpenCLProgram & program, const OpenCLDevice & device );
+
 private:
 
   OpenCLKernelManager( const Self & );   // purposely not implemented
   void operator=( const Self & );        // purposely not implemented
 
   OpenCLContext * m_Context;
+  bool            m_LastProgramLoadedFromCache;
 
   struct KernelArgumentList
   {
@@ -394,6 +394,64 @@ std::list< OpenCLDevice > OpenCLProgram::GetDevices() const
 }
 
 
+//------------------------------------------------------------------------------
+bool
+OpenCLProgram::GetBinary( const OpenCLDevice & device,
+  std::vector< unsigned char > & binary ) const
+{
+  binary.clear();
+
+  cl_uint size;
+  if( clGetProgramInfo( this->m_Id, CL_PROGRAM_NUM_DEVICES,
+    sizeof( size ), &size, 0 ) != CL_SUCCESS || size == 0 )
+  {
+    return false;
+  }
+  std::vector< cl_device_id > devices( size );
+  if( clGetProgramInfo( this->m_Id, CL_PROGRAM_DEVICES,
+    size * sizeof( cl_device_id ), &devices[ 0 ], 0 ) != CL_SUCCESS )
+  {
+    return false;
+  }
+
+  // Find the index of the device in the program
+  std::size_t index = 0;
+  while( index < size && devices[ index ] != device.GetDeviceId() )
+  {
+    ++index;
+  }
+  if( index == size )
+  {
+    return false;
+  }
+
+  // The binaries are returned for all devices of the program at once
+  std::vector< std::size_t > binarySizes( size );
+  if( clGetProgramInfo( this->m_Id, CL_PROGRAM_BINARY_SIZES,
+    size * sizeof( std::size_t ), &binarySizes[ 0 ], 0 ) != CL_SUCCESS
+    || binarySizes[ index ] == 0 )
+  {
+    return false;
+  }
+
+  std::vector< std::vector< unsigned char > > binaries( size );
+  std::vector< unsigned char * >              binaryPointers( size, 0 );
+  for( std::size_t i = 0; i < size; ++i )
+  {
+    binaries[ i ].resize( binarySizes[ i ] );
+    binaryPointers[ i ] = binarySizes[ i ] > 0 ? &binaries[ i ][ 0 ] : 0;
+  }
+  if( clGetProgramInfo( this->m_Id, CL_PROGRAM_BINARIES,
+    size * sizeof( unsigned char * ), &binaryPointers[ 0 ], 0 ) != CL_SUCCESS )
+  {
+    return false;
+  }
+
+  binary.swap( binaries[ index ] );
+  return true;
+}
+
+
 //------------------------------------------------------------------------------
 OpenCLKernel
 OpenCLProgram::CreateKernel( const std::string & name ) const
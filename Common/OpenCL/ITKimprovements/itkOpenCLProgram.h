@@ -22,6 +22,7 @@
 #include "itkOpenCLKernel.h"
 
 #include <string>
+#include <vector>
 
 namespace itk
 {
@@ -101,6 +102,13 @@ public:
    * \sa GetBinaries() */
   std::list< OpenCLDevice > GetDevices() const;
 
+  /** Copies the binary of this program for \a device into \a binary,
+   * which can be used to recreate the program with
+   * OpenCLContext::CreateProgramFromBinaryCode().
+   * Returns false if the program has not been built for \a device.
+   * \sa GetDevices() */
+  bool GetBinary( const OpenCLDevice & device, std::vector< unsigned char > & binary ) const;
+
   /** Creates a kernel for the entry point associated with \a name
    * in this program.
    * \sa Build() */
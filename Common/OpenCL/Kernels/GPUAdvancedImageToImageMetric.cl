@@ -0,0 +1,849 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+//
+// OpenCL implementation of the sample loops of the
+// itk::AdvancedMeanSquaresImageToImageMetric and the
+// itk::ParzenWindowMutualInformationImageToImageMetric.
+//
+// The program is built with the defines DIM_2 or DIM_3, TRANSFORM_AFFINE or
+// TRANSFORM_BSPLINE, WORKGROUP_SIZE and NUMBER_OF_PARTIALS, after the sources
+// of GPUImageBase.cl, GPUMatrixOffsetTransformBase.cl and GPUBSplineTransform.cl.
+//
+// Each work item processes one sample at a time, with a linearly interpolated
+// moving image; the work groups process chunks of WORKGROUP_SIZE samples. The
+// value, the number of valid samples and, for the affine transform, the moments
+// of the derivative are summed per work group into the partials. The host sums
+// the partials of the work groups, and maps the moments to the derivative with
+// the transform Jacobian, which is affine in the point.
+//
+// Nothing is scattered to global memory with atomics, so that the results do
+// not depend on the scheduling of the work items. For the B-spline transform
+// each sample stores its contribution to the derivative, and the samples are
+// sorted by the grid cell of their support. GatherBSplineDerivative() then sums,
+// per parameter, the samples of the cells whose support contains it, in a fixed
+// order. The joint histogram is summed per work group in the order of the
+// samples, and SumGroupHistograms() sums the work groups in order.
+
+//------------------------------------------------------------------------------
+#ifdef DIM_2
+#define DIMENSION 2
+#endif // DIM_2
+
+#ifdef DIM_3
+#define DIMENSION 3
+#endif // DIM_3
+
+// The support of the third order B-spline transform
+#define BSPLINE_SUPPORT_SIZE 4
+#define BSPLINE_NUMBER_OF_WEIGHTS ( DIMENSION == 2 ? 16 : 64 )
+
+// The first partials, followed by the affine moments
+#define PARTIAL_VALUE 0
+#define PARTIAL_COUNT 1
+#define PARTIAL_GRADIENT 2
+#define PARTIAL_GRADIENT_POINT ( 2 + DIMENSION )
+
+// The contribution of a sample to the B-spline derivative: weight * gradient,
+// followed by the 1D B-spline weights of its support
+#define SAMPLE_DERIVATIVE_SIZE ( DIMENSION * ( 1 + BSPLINE_SUPPORT_SIZE ) )
+
+//------------------------------------------------------------------------------
+// Definition of the limiters, see itk::HardLimiterFunction
+// and itk::ExponentialLimiterFunction. Type 0 is no limiter.
+typedef struct {
+  uint  type;
+  float lower_bound;
+  float upper_bound;
+  float lower_threshold;
+  float upper_threshold;
+  float ut_min_ub;
+  float ut_min_ub_inv;
+  float lt_min_lb;
+  float lt_min_lb_inv;
+} GPUAdvancedImageToImageMetricLimiter;
+
+//------------------------------------------------------------------------------
+// Definition of the parameters of the sample loops. The matrices are
+// stored row-major, with DIMENSION columns.
+typedef struct {
+  float moving_point_to_index[ 9 ];
+  float moving_gradient_matrix[ 9 ]; // direction * inverse spacing
+  float moving_origin[ 3 ];
+  uint  moving_size[ 3 ];
+  float matrix[ 9 ];
+  float offset[ 3 ];
+  float grid_point_to_index[ 9 ];
+  float grid_origin[ 3 ];
+  uint  grid_size[ 3 ];
+  uint  number_of_parameters_per_dimension;
+  GPUAdvancedImageToImageMetricLimiter fixed_limiter;
+  GPUAdvancedImageToImageMetricLimiter moving_limiter;
+  uint  number_of_fixed_histogram_bins;
+  uint  number_of_moving_histogram_bins;
+  float fixed_image_bin_size;
+  float moving_image_bin_size;
+  float fixed_image_normalized_min;
+  float moving_image_normalized_min;
+  float fixed_parzen_term_to_index_offset;
+  float moving_parzen_term_to_index_offset;
+} GPUAdvancedImageToImageMetricParameters;
+
+//------------------------------------------------------------------------------
+// Sum the partials of the work items of a work group, and store the
+// result of the work group in group_partials.
+void reduce_partials( const float *partials,
+  __local float *local_partials,
+  __global float *group_partials )
+{
+  const uint lid = get_local_id( 0 );
+  for( uint i = 0; i < NUMBER_OF_PARTIALS; ++i )
+  {
+    local_partials[ i * WORKGROUP_SIZE + lid ] = partials[ i ];
+  }
+  barrier( CLK_LOCAL_MEM_FENCE );
+
+  for( uint stride = WORKGROUP_SIZE / 2; stride > 0; stride >>= 1 )
+  {
+    if( lid < stride )
+    {
+      for( uint i = 0; i < NUMBER_OF_PARTIALS; ++i )
+      {
+        local_partials[ i * WORKGROUP_SIZE + lid ]
+          += local_partials[ i * WORKGROUP_SIZE + lid + stride ];
+      }
+    }
+    barrier( CLK_LOCAL_MEM_FENCE );
+  }
+
+  if( lid == 0 )
+  {
+    const uint group_offset = get_group_id( 0 ) * NUMBER_OF_PARTIALS;
+    for( uint i = 0; i < NUMBER_OF_PARTIALS; ++i )
+    {
+      group_partials[ group_offset + i ] = local_partials[ i * WORKGROUP_SIZE ];
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// OpenCL implementation of itk::HardLimiterFunction::Evaluate() and
+// itk::ExponentialLimiterFunction::Evaluate(). The derivative of the
+// limited function is multiplied by gradient_factor.
+float apply_limiter( const float value,
+  __constant const GPUAdvancedImageToImageMetricLimiter *limiter,
+  float *gradient_factor )
+{
+  *gradient_factor = 1.0f;
+  if( limiter->type == 1 )
+  {
+    if( value > limiter->upper_bound )
+    {
+      *gradient_factor = 0.0f;
+      return limiter->upper_bound;
+    }
+    if( value < limiter->lower_bound )
+    {
+      *gradient_factor = 0.0f;
+      return limiter->lower_bound;
+    }
+  }
+  else if( limiter->type == 2 )
+  {
+    const float diffU = value - limiter->upper_threshold;
+    if( diffU > 1e-10f )
+    {
+      const float temp = limiter->ut_min_ub * exp( limiter->ut_min_ub_inv * diffU );
+      *gradient_factor = limiter->ut_min_ub_inv * temp;
+      return temp + limiter->upper_bound;
+    }
+    const float diffL = value - limiter->lower_threshold;
+    if( diffL < -1e-10f )
+    {
+      const float temp = limiter->lt_min_lb * exp( limiter->lt_min_lb_inv * diffL );
+      *gradient_factor = limiter->lt_min_lb_inv * temp;
+      return temp + limiter->lower_bound;
+    }
+  }
+  return value;
+}
+
+//------------------------------------------------------------------------------
+// OpenCL implementation of the third order itk::BSplineKernelFunction2
+// and itk::BSplineDerivativeKernelFunction2 for all points in the support.
+void evaluate_third_order_parzen_values( const float u,
+  float *values, float *derivative_values )
+{
+  const float absu = fabs( u );
+  const float uu   = u * u;
+  const float uuu  = uu * absu;
+
+  values[ 0 ] = (  8.0f - 12.0f * absu +  6.0f * uu -        uuu ) / 6.0f;
+  values[ 1 ] = ( -5.0f + 21.0f * absu - 15.0f * uu + 3.0f * uuu ) / 6.0f;
+  values[ 2 ] = (  4.0f - 12.0f * absu + 12.0f * uu - 3.0f * uuu ) / 6.0f;
+  values[ 3 ] = ( -1.0f +  3.0f * absu -  3.0f * uu +        uuu ) / 6.0f;
+
+  derivative_values[ 0 ] =  0.5f * uu - 2.0f * absu + 2.0f;
+  derivative_values[ 1 ] = -1.5f * uu + 5.0f * absu - 3.5f;
+  derivative_values[ 2 ] =  1.5f * uu - 4.0f * absu + 2.0f;
+  derivative_values[ 3 ] = -0.5f * uu +        absu - 0.5f;
+}
+
+//------------------------------------------------------------------------------
+// OpenCL implementation of the zero order itk::BSplineKernelFunction2.
+float evaluate_zero_order_parzen_value( const float u )
+{
+  const float absu = fabs( u );
+  if( absu < 0.5f ) { return 1.0f; }
+  if( absu == 0.5f ) { return 0.5f; }
+  return 0.0f;
+}
+
+//------------------------------------------------------------------------------
+// OpenCL implementation of itk::ImageFunction::IsInsideBuffer() and
+// itk::AdvancedLinearInterpolateImageFunction::EvaluateValueAndDerivative(),
+// for an image with start index 0. The index is mirrored at the image
+// border, which also mirrors the derivative.
+bool evaluate_moving_image_value_and_derivative(
+  const float *mapped_point,
+  __global const float *moving_image,
+  __constant const GPUAdvancedImageToImageMetricParameters *parameters,
+  float *value, float *gradient )
+{
+  float cindex[ DIMENSION ];
+  for( uint i = 0; i < DIMENSION; ++i )
+  {
+    cindex[ i ] = 0.0f;
+    for( uint j = 0; j < DIMENSION; ++j )
+    {
+      cindex[ i ] = mad( parameters->moving_point_to_index[ i * DIMENSION + j ],
+        mapped_point[ j ] - parameters->moving_origin[ j ], cindex[ i ] );
+    }
+    if( cindex[ i ] < -0.5f || cindex[ i ] >= (float)( parameters->moving_size[ i ] ) - 0.5f )
+    {
+      return false;
+    }
+  }
+
+  // Mirror the index and compute the base index and the distance to it
+  float sign[ DIMENSION ];
+  float dist[ DIMENSION ];
+  uint  base[ DIMENSION ];
+  for( uint i = 0; i < DIMENSION; ++i )
+  {
+    const float end = (float)( parameters->moving_size[ i ] - 1 );
+    float x = cindex[ i ];
+    sign[ i ] = 1.0f;
+    if( x < 0.0f ) { x = -x; sign[ i ] = -sign[ i ]; }
+    if( x > end ) { x = 2.0f * end - x; sign[ i ] = -sign[ i ]; }
+
+    // A point on the last index uses the last interval
+    const int b = clamp( (int)( floor( x ) ), 0, (int)( parameters->moving_size[ i ] ) - 2 );
+    base[ i ] = (uint)( b );
+    dist[ i ] = x - (float)( b );
+  }
+
+  // Loop over the corners of the interpolation cell
+  float local_gradient[ DIMENSION ];
+  for( uint i = 0; i < DIMENSION; ++i ) { local_gradient[ i ] = 0.0f; }
+  *value = 0.0f;
+  for( uint corner = 0; corner < ( 1u << DIMENSION ); ++corner )
+  {
+    uint  offset = 0;
+    uint  stride = 1;
+    float weight = 1.0f;
+    for( uint i = 0; i < DIMENSION; ++i )
+    {
+      const uint bit = ( corner >> i ) & 1u;
+      offset += ( base[ i ] + bit ) * stride;
+      stride *= parameters->moving_size[ i ];
+      weight *= bit ? dist[ i ] : 1.0f - dist[ i ];
+    }
+
+    const float pixel = moving_image[ offset ];
+    *value = mad( weight, pixel, *value );
+
+    for( uint d = 0; d < DIMENSION; ++d )
+    {
+      float derivative_weight = ( ( corner >> d ) & 1u ) ? 1.0f : -1.0f;
+      for( uint i = 0; i < DIMENSION; ++i )
+      {
+        if( i != d )
+        {
+          derivative_weight *= ( ( corner >> i ) & 1u ) ? dist[ i ] : 1.0f - dist[ i ];
+        }
+      }
+      local_gradient[ d ] = mad( derivative_weight, pixel, local_gradient[ d ] );
+    }
+  }
+
+  // Take the spacing and the direction cosines into account
+  for( uint i = 0; i < DIMENSION; ++i )
+  {
+    gradient[ i ] = 0.0f;
+    for( uint j = 0; j < DIMENSION; ++j )
+    {
+      gradient[ i ] = mad( parameters->moving_gradient_matrix[ i * DIMENSION + j ],
+        sign[ j ] * local_gradient[ j ], gradient[ i ] );
+    }
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+#ifdef TRANSFORM_AFFINE
+// The affine transform has no support region to store.
+typedef struct {
+  uint dummy;
+} TransformSupport;
+
+void transform_point( const float *point, float *mapped_point,
+  __constant const GPUAdvancedImageToImageMetricParameters *parameters,
+  __global const float *coefficients,
+  TransformSupport *support )
+{
+  __constant const float *m = parameters->matrix;
+  __constant const float *o = parameters->offset;
+#ifdef DIM_2
+  const float2 tpoint = matrix_offset_transform_point_2d(
+    (float2)( point[ 0 ], point[ 1 ] ),
+    (float4)( m[ 0 ], m[ 1 ], m[ 2 ], m[ 3 ] ),
+    (float2)( o[ 0 ], o[ 1 ] ) );
+  mapped_point[ 0 ] = tpoint.x;
+  mapped_point[ 1 ] = tpoint.y;
+#endif // DIM_2
+#ifdef DIM_3
+  const float3 tpoint = matrix_offset_transform_point_3d(
+    (float3)( point[ 0 ], point[ 1 ], point[ 2 ] ),
+    (float16)( m[ 0 ], m[ 1 ], m[ 2 ], m[ 3 ], m[ 4 ], m[ 5 ], m[ 6 ], m[ 7 ], m[ 8 ],
+    0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f ),
+    (float3)( o[ 0 ], o[ 1 ], o[ 2 ] ) );
+  mapped_point[ 0 ] = tpoint.x;
+  mapped_point[ 1 ] = tpoint.y;
+  mapped_point[ 2 ] = tpoint.z;
+#endif // DIM_3
+}
+
+// The moments are kept in the partials, nothing is stored per sample.
+void clear_sample_derivative( const uint sample,
+  __global float *sample_derivatives )
+{
+}
+
+// Add the moments weight * gradient and weight * gradient * point^T.
+void accumulate_derivative( const float weight, const float *gradient,
+  const float *point, const TransformSupport *support,
+  __constant const GPUAdvancedImageToImageMetricParameters *parameters,
+  const uint sample, float *partials, __global float *sample_derivatives )
+{
+  for( uint i = 0; i < DIMENSION; ++i )
+  {
+    const float wg = weight * gradient[ i ];
+    partials[ PARTIAL_GRADIENT + i ] += wg;
+    for( uint j = 0; j < DIMENSION; ++j )
+    {
+      partials[ PARTIAL_GRADIENT_POINT + i * DIMENSION + j ]
+        = mad( wg, point[ j ], partials[ PARTIAL_GRADIENT_POINT + i * DIMENSION + j ] );
+    }
+  }
+}
+#endif // TRANSFORM_AFFINE
+
+//------------------------------------------------------------------------------
+#ifdef TRANSFORM_BSPLINE
+// The support region of the third order B-spline transform at a point.
+typedef struct {
+  bool  inside;
+  uint  start[ DIMENSION ];
+  float weights1d[ DIMENSION * BSPLINE_SUPPORT_SIZE ];
+} TransformSupport;
+
+// Get the weight and the coefficient index of weight k of the support,
+// in the order of evaluate_2d() and evaluate_3d().
+void get_bspline_weight_and_index( const TransformSupport *support,
+  __constant const GPUAdvancedImageToImageMetricParameters *parameters,
+  const uint k, float *weight, uint *index )
+{
+  uint rest   = k;
+  uint stride = 1;
+  *weight = 1.0f;
+  *index  = 0;
+  for( uint d = 0; d < DIMENSION; ++d )
+  {
+    const uint i = rest % BSPLINE_SUPPORT_SIZE;
+    rest   /= BSPLINE_SUPPORT_SIZE;
+    *weight *= support->weights1d[ d * BSPLINE_SUPPORT_SIZE + i ];
+    *index  += ( support->start[ d ] + i ) * stride;
+    stride  *= parameters->grid_size[ d ];
+  }
+}
+
+// Compute the continuous grid index of a point, and the start of its support.
+// Returns false outside the valid region of the grid.
+bool compute_bspline_support_start( const float *point,
+  __constant const GPUAdvancedImageToImageMetricParameters *parameters,
+  float *cindex, uint *start )
+{
+  bool inside = true;
+  for( uint i = 0; i < DIMENSION; ++i )
+  {
+    cindex[ i ] = 0.0f;
+    for( uint j = 0; j < DIMENSION; ++j )
+    {
+      cindex[ i ] = mad( parameters->grid_point_to_index[ i * DIMENSION + j ],
+        point[ j ] - parameters->grid_origin[ j ], cindex[ i ] );
+    }
+    if( cindex[ i ] < 1.0f || cindex[ i ] >= (float)( parameters->grid_size[ i ] ) - 2.0f )
+    {
+      inside = false;
+    }
+  }
+  if( !inside ) { return false; }
+
+  for( uint d = 0; d < DIMENSION; ++d )
+  {
+    start[ d ] = (uint)( floor( cindex[ d ] - 1.0f ) );
+  }
+  return true;
+}
+
+// OpenCL implementation of itk::AdvancedBSplineDeformableTransform::TransformPoint()
+// for a grid with start index 0. Outside the valid region the point is not moved.
+void transform_point( const float *point, float *mapped_point,
+  __constant const GPUAdvancedImageToImageMetricParameters *parameters,
+  __global const float *coefficients,
+  TransformSupport *support )
+{
+  float cindex[ DIMENSION ];
+  for( uint i = 0; i < DIMENSION; ++i ) { mapped_point[ i ] = point[ i ]; }
+  support->inside = compute_bspline_support_start( point, parameters, cindex, support->start );
+  if( !support->inside ) { return; }
+
+  for( uint d = 0; d < DIMENSION; ++d )
+  {
+    set_weights( cindex[ d ], 3, (long)( support->start[ d ] ),
+      d * BSPLINE_SUPPORT_SIZE, support->weights1d );
+  }
+
+  const uint number_of_parameters_per_dimension = parameters->number_of_parameters_per_dimension;
+  for( uint k = 0; k < BSPLINE_NUMBER_OF_WEIGHTS; ++k )
+  {
+    float weight;
+    uint  index;
+    get_bspline_weight_and_index( support, parameters, k, &weight, &index );
+    for( uint d = 0; d < DIMENSION; ++d )
+    {
+      mapped_point[ d ] = mad( weight,
+        coefficients[ d * number_of_parameters_per_dimension + index ], mapped_point[ d ] );
+    }
+  }
+}
+
+// Clear the contribution of a sample, for samples that are not valid.
+void clear_sample_derivative( const uint sample,
+  __global float *sample_derivatives )
+{
+  __global float *sample_derivative = sample_derivatives + sample * SAMPLE_DERIVATIVE_SIZE;
+  for( uint i = 0; i < SAMPLE_DERIVATIVE_SIZE; ++i ) { sample_derivative[ i ] = 0.0f; }
+}
+
+// Store weight * gradient and the 1D weights of the support of the sample,
+// from which GatherBSplineDerivative() computes weight * gradient * dT/dmu.
+void accumulate_derivative( const float weight, const float *gradient,
+  const float *point, const TransformSupport *support,
+  __constant const GPUAdvancedImageToImageMetricParameters *parameters,
+  const uint sample, float *partials, __global float *sample_derivatives )
+{
+  if( !support->inside ) { return; }
+
+  __global float *sample_derivative = sample_derivatives + sample * SAMPLE_DERIVATIVE_SIZE;
+  for( uint d = 0; d < DIMENSION; ++d )
+  {
+    sample_derivative[ d ] = weight * gradient[ d ];
+  }
+  for( uint i = 0; i < DIMENSION * BSPLINE_SUPPORT_SIZE; ++i )
+  {
+    sample_derivative[ DIMENSION + i ] = support->weights1d[ i ];
+  }
+}
+
+// Compute the grid cell of the support of each sample, which is the linear
+// index of its start. Samples outside the valid region get the number of
+// cells. The host sorts the samples by these cells.
+__kernel void ComputeBSplineSupportCells(
+  __global const float *fixed_points,
+  const uint number_of_samples,
+  __constant const GPUAdvancedImageToImageMetricParameters *parameters,
+  __global uint *cells )
+{
+  const uint sample = get_global_id( 0 );
+  if( sample >= number_of_samples ) { return; }
+
+  float point[ DIMENSION ];
+  float cindex[ DIMENSION ];
+  uint  start[ DIMENSION ];
+  for( uint i = 0; i < DIMENSION; ++i )
+  {
+    point[ i ] = fixed_points[ sample * DIMENSION + i ];
+  }
+
+  uint cell   = 0;
+  uint stride = 1;
+  const bool inside = compute_bspline_support_start( point, parameters, cindex, start );
+  for( uint d = 0; d < DIMENSION; ++d )
+  {
+    cell   += start[ d ] * stride;
+    stride *= parameters->grid_size[ d ];
+  }
+  cells[ sample ] = inside ? cell : stride;
+}
+
+// Compute the derivative of the B-spline transform from the contributions of
+// the samples, which are sorted by the cell of their support; the samples of
+// cell c are cell_offsets[ c ] up to cell_offsets[ c + 1 ]. Each work item
+// computes the derivative of one control point, summing the cells whose
+// support contains it, and their samples, in a fixed order.
+__kernel void GatherBSplineDerivative(
+  __global const float *sample_derivatives,
+  __global const uint *cell_offsets,
+  __constant const GPUAdvancedImageToImageMetricParameters *parameters,
+  __global float *derivative )
+{
+  const uint number_of_parameters_per_dimension = parameters->number_of_parameters_per_dimension;
+  const uint control_point = get_global_id( 0 );
+  if( control_point >= number_of_parameters_per_dimension ) { return; }
+
+  uint index[ DIMENSION ];
+  uint rest = control_point;
+  for( uint d = 0; d < DIMENSION; ++d )
+  {
+    index[ d ] = rest % parameters->grid_size[ d ];
+    rest      /= parameters->grid_size[ d ];
+  }
+
+  float sum[ DIMENSION ];
+  for( uint d = 0; d < DIMENSION; ++d ) { sum[ d ] = 0.0f; }
+
+  // Loop over the supports that contain the control point, at offset[ d ]
+  // from their start
+  for( uint k = 0; k < BSPLINE_NUMBER_OF_WEIGHTS; ++k )
+  {
+    uint offset[ DIMENSION ];
+    uint cell   = 0;
+    uint stride = 1;
+    bool valid  = true;
+    rest = k;
+    for( uint d = 0; d < DIMENSION; ++d )
+    {
+      offset[ d ] = rest % BSPLINE_SUPPORT_SIZE;
+      rest       /= BSPLINE_SUPPORT_SIZE;
+      valid = valid && index[ d ] >= offset[ d ]
+        && index[ d ] - offset[ d ] + BSPLINE_SUPPORT_SIZE <= parameters->grid_size[ d ];
+      cell   += ( index[ d ] - offset[ d ] ) * stride;
+      stride *= parameters->grid_size[ d ];
+    }
+    if( !valid ) { continue; }
+
+    for( uint sample = cell_offsets[ cell ]; sample < cell_offsets[ cell + 1 ]; ++sample )
+    {
+      __global const float *sample_derivative = sample_derivatives + sample * SAMPLE_DERIVATIVE_SIZE;
+      float weight = 1.0f;
+      for( uint d = 0; d < DIMENSION; ++d )
+      {
+        weight *= sample_derivative[ DIMENSION + d * BSPLINE_SUPPORT_SIZE + offset[ d ] ];
+      }
+      for( uint d = 0; d < DIMENSION; ++d )
+      {
+        sum[ d ] = mad( weight, sample_derivative[ d ], sum[ d ] );
+      }
+    }
+  }
+
+  for( uint d = 0; d < DIMENSION; ++d )
+  {
+    derivative[ d * number_of_parameters_per_dimension + control_point ] = sum[ d ];
+  }
+}
+#endif // TRANSFORM_BSPLINE
+
+//------------------------------------------------------------------------------
+// Transform the sample and interpolate the moving image. Returns false
+// for samples that are not valid, and for the padding work items.
+bool evaluate_sample( const uint sample,
+  __global const float *fixed_points,
+  const uint number_of_samples,
+  __global const float *moving_image,
+  __constant const GPUAdvancedImageToImageMetricParameters *parameters,
+  __global const float *coefficients,
+  float *point, TransformSupport *support,
+  float *moving_value, float *gradient )
+{
+  if( sample >= number_of_samples ) { return false; }
+
+  float mapped_point[ DIMENSION ];
+  for( uint i = 0; i < DIMENSION; ++i )
+  {
+    point[ i ] = fixed_points[ sample * DIMENSION + i ];
+  }
+  transform_point( point, mapped_point, parameters, coefficients, support );
+
+  return evaluate_moving_image_value_and_derivative(
+    mapped_point, moving_image, parameters, moving_value, gradient );
+}
+
+//------------------------------------------------------------------------------
+// Add the contributions of the samples of a chunk to the histogram of the work
+// group. Each work item adds to its own bins, in the order of the samples. A
+// sample adds values[ m ] to bin + m, or nothing when bin is negative.
+void add_to_group_histogram( __local const int *local_bins,
+  __local const float *local_values,
+  __global float *histogram )
+{
+  const uint lid = get_local_id( 0 );
+  for( uint s = 0; s < WORKGROUP_SIZE; ++s )
+  {
+    const int bin = local_bins[ s ];
+    if( bin < 0 ) { continue; }
+    for( uint m = 0; m < BSPLINE_SUPPORT_SIZE; ++m )
+    {
+      const uint b = (uint)( bin ) + m;
+      if( b % WORKGROUP_SIZE == lid )
+      {
+        histogram[ b ] += local_values[ s * BSPLINE_SUPPORT_SIZE + m ];
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Sum the histograms of the work groups, in the order of the work groups.
+__kernel void SumGroupHistograms(
+  __global const float *group_histograms,
+  const uint number_of_groups,
+  const uint size,
+  __global float *joint_pdf )
+{
+  const uint bin = get_global_id( 0 );
+  if( bin >= size ) { return; }
+
+  float sum = 0.0f;
+  for( uint g = 0; g < number_of_groups; ++g )
+  {
+    sum += group_histograms[ g * size + bin ];
+  }
+  joint_pdf[ bin ] = sum;
+}
+
+//------------------------------------------------------------------------------
+// OpenCL implementation of the sample loop of
+// itk::AdvancedMeanSquaresImageToImageMetric::GetValueAndDerivative().
+// The value and derivative are not normalized.
+__kernel __attribute__( ( reqd_work_group_size( WORKGROUP_SIZE, 1, 1 ) ) )
+void AdvancedMeanSquaresValueAndDerivative(
+  __global const float *fixed_points,
+  __global const float *fixed_values,
+  const uint number_of_samples,
+  __global const float *moving_image,
+  __constant const GPUAdvancedImageToImageMetricParameters *parameters,
+  __global const float *coefficients,
+  const uint compute_derivative,
+  __global float *sample_derivatives,
+  __global float *group_partials )
+{
+  __local float local_partials[ NUMBER_OF_PARTIALS * WORKGROUP_SIZE ];
+  float partials[ NUMBER_OF_PARTIALS ];
+  for( uint i = 0; i < NUMBER_OF_PARTIALS; ++i ) { partials[ i ] = 0.0f; }
+
+  for( uint sample = get_global_id( 0 ); sample < number_of_samples; sample += get_global_size( 0 ) )
+  {
+    float point[ DIMENSION ];
+    float gradient[ DIMENSION ];
+    float moving_value;
+    TransformSupport support;
+    if( compute_derivative ) { clear_sample_derivative( sample, sample_derivatives ); }
+    if( evaluate_sample( sample, fixed_points, number_of_samples, moving_image,
+      parameters, coefficients, point, &support, &moving_value, gradient ) )
+    {
+      const float diff = moving_value - fixed_values[ sample ];
+      partials[ PARTIAL_VALUE ] = mad( diff, diff, partials[ PARTIAL_VALUE ] );
+      partials[ PARTIAL_COUNT ] += 1.0f;
+      if( compute_derivative )
+      {
+        accumulate_derivative( 2.0f * diff, gradient, point, &support,
+          parameters, sample, partials, sample_derivatives );
+      }
+    }
+  }
+
+  reduce_partials( partials, local_partials, group_partials );
+}
+
+//------------------------------------------------------------------------------
+// OpenCL implementation of the sample loop of
+// itk::ParzenWindowHistogramImageToImageMetric::ComputePDFs(), for a zero
+// order fixed and a third order moving Parzen window. The joint histogram
+// of each work group is stored in group_histograms, indexed
+// [ group ][ fixed bin ][ moving bin ].
+__kernel __attribute__( ( reqd_work_group_size( WORKGROUP_SIZE, 1, 1 ) ) )
+void ParzenWindowJointPDF(
+  __global const float *fixed_points,
+  __global const float *fixed_values,
+  const uint number_of_samples,
+  __global const float *moving_image,
+  __constant const GPUAdvancedImageToImageMetricParameters *parameters,
+  __global const float *coefficients,
+  __global float *group_histograms,
+  __global float *group_partials )
+{
+  __local float local_partials[ NUMBER_OF_PARTIALS * WORKGROUP_SIZE ];
+  __local int   local_bins[ WORKGROUP_SIZE ];
+  __local float local_values[ WORKGROUP_SIZE * BSPLINE_SUPPORT_SIZE ];
+  float partials[ NUMBER_OF_PARTIALS ];
+  for( uint i = 0; i < NUMBER_OF_PARTIALS; ++i ) { partials[ i ] = 0.0f; }
+
+  const uint lid  = get_local_id( 0 );
+  const uint size = parameters->number_of_fixed_histogram_bins
+    * parameters->number_of_moving_histogram_bins;
+  __global float *histogram = group_histograms + get_group_id( 0 ) * size;
+  for( uint b = lid; b < size; b += WORKGROUP_SIZE ) { histogram[ b ] = 0.0f; }
+
+  // All work items of the group loop over the same chunks
+  for( uint chunk = get_group_id( 0 ) * WORKGROUP_SIZE; chunk < number_of_samples;
+    chunk += get_global_size( 0 ) )
+  {
+    const uint sample = chunk + lid;
+    float point[ DIMENSION ];
+    float gradient[ DIMENSION ];
+    float moving_value;
+    TransformSupport support;
+    local_bins[ lid ] = -1;
+    if( evaluate_sample( sample, fixed_points, number_of_samples, moving_image,
+      parameters, coefficients, point, &support, &moving_value, gradient ) )
+    {
+      partials[ PARTIAL_COUNT ] += 1.0f;
+
+      float gradient_factor;
+      const float fixed_value = apply_limiter( fixed_values[ sample ],
+        &parameters->fixed_limiter, &gradient_factor );
+      moving_value = apply_limiter( moving_value,
+        &parameters->moving_limiter, &gradient_factor );
+
+      const float fixed_term = fixed_value / parameters->fixed_image_bin_size
+        - parameters->fixed_image_normalized_min;
+      const float moving_term = moving_value / parameters->moving_image_bin_size
+        - parameters->moving_image_normalized_min;
+      const int fixed_index = (int)( floor( fixed_term
+        + parameters->fixed_parzen_term_to_index_offset ) );
+      const int moving_index = (int)( floor( moving_term
+        + parameters->moving_parzen_term_to_index_offset ) );
+
+      const float fixed_parzen_value
+        = evaluate_zero_order_parzen_value( (float)( fixed_index ) - fixed_term );
+      float moving_parzen_values[ BSPLINE_SUPPORT_SIZE ];
+      float derivative_moving_parzen_values[ BSPLINE_SUPPORT_SIZE ];
+      evaluate_third_order_parzen_values( (float)( moving_index ) - moving_term,
+        moving_parzen_values, derivative_moving_parzen_values );
+
+      local_bins[ lid ] = fixed_index * (int)( parameters->number_of_moving_histogram_bins )
+        + moving_index;
+      for( uint m = 0; m < BSPLINE_SUPPORT_SIZE; ++m )
+      {
+        local_values[ lid * BSPLINE_SUPPORT_SIZE + m ] = fixed_parzen_value * moving_parzen_values[ m ];
+      }
+    }
+    barrier( CLK_LOCAL_MEM_FENCE );
+
+    add_to_group_histogram( local_bins, local_values, histogram );
+    barrier( CLK_LOCAL_MEM_FENCE );
+  }
+
+  reduce_partials( partials, local_partials, group_partials );
+}
+
+//------------------------------------------------------------------------------
+// OpenCL implementation of the sample loop of
+// itk::ParzenWindowMutualInformationImageToImageMetric::ComputeDerivativeLowMemory(),
+// for a zero order fixed and a third order moving Parzen window. The ratios
+// are indexed [ fixed bin ][ moving bin ], and include alpha.
+__kernel __attribute__( ( reqd_work_group_size( WORKGROUP_SIZE, 1, 1 ) ) )
+void ParzenWindowMutualInformationDerivative(
+  __global const float *fixed_points,
+  __global const float *fixed_values,
+  const uint number_of_samples,
+  __global const float *moving_image,
+  __constant const GPUAdvancedImageToImageMetricParameters *parameters,
+  __global const float *coefficients,
+  __global const float *pratio,
+  __global float *sample_derivatives,
+  __global float *group_partials )
+{
+  __local float local_partials[ NUMBER_OF_PARTIALS * WORKGROUP_SIZE ];
+  float partials[ NUMBER_OF_PARTIALS ];
+  for( uint i = 0; i < NUMBER_OF_PARTIALS; ++i ) { partials[ i ] = 0.0f; }
+
+  for( uint sample = get_global_id( 0 ); sample < number_of_samples; sample += get_global_size( 0 ) )
+  {
+    float point[ DIMENSION ];
+    float gradient[ DIMENSION ];
+    float moving_value;
+    TransformSupport support;
+    clear_sample_derivative( sample, sample_derivatives );
+    if( !evaluate_sample( sample, fixed_points, number_of_samples, moving_image,
+      parameters, coefficients, point, &support, &moving_value, gradient ) )
+    {
+      continue;
+    }
+    partials[ PARTIAL_COUNT ] += 1.0f;
+
+    float gradient_factor;
+    const float fixed_value = apply_limiter( fixed_values[ sample ],
+      &parameters->fixed_limiter, &gradient_factor );
+    moving_value = apply_limiter( moving_value,
+      &parameters->moving_limiter, &gradient_factor );
+    for( uint i = 0; i < DIMENSION; ++i ) { gradient[ i ] *= gradient_factor; }
+
+    const float fixed_term = fixed_value / parameters->fixed_image_bin_size
+      - parameters->fixed_image_normalized_min;
+    const float moving_term = moving_value / parameters->moving_image_bin_size
+      - parameters->moving_image_normalized_min;
+    const int fixed_index = (int)( floor( fixed_term
+      + parameters->fixed_parzen_term_to_index_offset ) );
+    const int moving_index = (int)( floor( moving_term
+      + parameters->moving_parzen_term_to_index_offset ) );
+
+    const float fixed_parzen_value
+      = evaluate_zero_order_parzen_value( (float)( fixed_index ) - fixed_term );
+    float moving_parzen_values[ BSPLINE_SUPPORT_SIZE ];
+    float derivative_moving_parzen_values[ BSPLINE_SUPPORT_SIZE ];
+    evaluate_third_order_parzen_values( (float)( moving_index ) - moving_term,
+      moving_parzen_values, derivative_moving_parzen_values );
+
+    const uint row = fixed_index * parameters->number_of_moving_histogram_bins;
+    const float fv_et = fixed_parzen_value / parameters->moving_image_bin_size;
+    float sum = 0.0f;
+    for( uint m = 0; m < BSPLINE_SUPPORT_SIZE; ++m )
+    {
+      sum = mad( pratio[ row + moving_index + m ],
+        fv_et * derivative_moving_parzen_values[ m ], sum );
+    }
+
+    accumulate_derivative( sum, gradient, point, &support,
+      parameters, sample, partials, sample_derivatives );
+  }
+
+  reduce_partials( partials, local_partials, group_partials );
+}
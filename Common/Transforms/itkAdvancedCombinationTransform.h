@@ -235,6 +235,12 @@ public:
    * return DisplacementField category. */
   virtual TransformCategoryType GetTransformCategory() const;
 
+  /** Whether TransformPoint() and the Jacobian functions only combine the
+   * initial and current transform, as implemented in this class. If so,
+   * callers may evaluate the initial and current transform themselves.
+   * Subclasses that change the mapping should return false. */
+  virtual bool IsPlainCombination( void ) const { return true; }
+
   /** Whether the advanced transform has nonzero matrices. */
   virtual bool GetHasNonZeroSpatialHessian( void ) const;
 
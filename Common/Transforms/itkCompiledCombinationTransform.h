@@ -0,0 +1,277 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkCompiledCombinationTransform_h
+#define __itkCompiledCombinationTransform_h
+
+#include "itkTransform.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkImage.h"
+#include "itkVectorLinearInterpolateImageFunction.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * \class CompiledCombinationTransform
+ *
+ * \brief A flattened, faster to evaluate copy of a chain of
+ * AdvancedCombinationTransforms.
+ *
+ * A chain of transforms, as read by transformix from a series of
+ * InitialTransformParametersFileName's, is a nesting of
+ * AdvancedCombinationTransforms, which costs a number of virtual
+ * calls per point per stage. The Compile() function turns such a chain
+ * into a flat list of stages, in the order in which they are applied:
+ * \li Compositions are unrolled. Additions can not be unrolled, so
+ *   they are kept as a single stage.
+ * \li Consecutive linear stages are folded into a single matrix and offset.
+ * \li Optionally, when the chain contains nonlinear stages, the complete
+ *   chain is baked into a dense displacement grid, which is evaluated by
+ *   linear interpolation. Linear stages are reproduced exactly by this
+ *   interpolation, so only the nonlinear stages are approximated. The
+ *   grid is only used when the maximum error, measured halfway between
+ *   the grid points, is below MaximumBakingError. Points outside the grid
+ *   are mapped by the (folded) stages.
+ *
+ * The original chain is referenced, not copied, so it should not be
+ * changed after Compile() has been called.
+ *
+ * \ingroup Transforms
+ */
+
+template< typename TScalarType, unsigned int NDimensions = 3 >
+class CompiledCombinationTransform :
+  public Transform< TScalarType, NDimensions, NDimensions >
+{
+public:
+
+  /** Standard itk. */
+  typedef CompiledCombinationTransform Self;
+  typedef Transform< TScalarType,
+    NDimensions, NDimensions >         Superclass;
+  typedef SmartPointer< Self >         Pointer;
+  typedef SmartPointer< const Self >   ConstPointer;
+
+  /** New method for creating an object using a factory. */
+  itkNewMacro( Self );
+
+  /** ITK Type info. */
+  itkTypeMacro( CompiledCombinationTransform, Transform );
+
+  /** Input and Output space dimension. */
+  itkStaticConstMacro( SpaceDimension, unsigned int, NDimensions );
+
+  /** Typedefs inherited from Superclass.*/
+  typedef typename Superclass::ScalarType                ScalarType;
+  typedef typename Superclass::ParametersType            ParametersType;
+  typedef typename Superclass::FixedParametersType       FixedParametersType;
+  typedef typename Superclass::JacobianType              JacobianType;
+  typedef typename Superclass::InputVectorType           InputVectorType;
+  typedef typename Superclass::OutputVectorType          OutputVectorType;
+  typedef typename Superclass::InputCovariantVectorType  InputCovariantVectorType;
+  typedef typename Superclass::OutputCovariantVectorType OutputCovariantVectorType;
+  typedef typename Superclass::InputVnlVectorType        InputVnlVectorType;
+  typedef typename Superclass::OutputVnlVectorType       OutputVnlVectorType;
+  typedef typename Superclass::InputPointType            InputPointType;
+  typedef typename Superclass::OutputPointType           OutputPointType;
+  typedef typename Superclass::TransformCategoryType     TransformCategoryType;
+
+  /** Typedefs for the transform chain. */
+  typedef Superclass                           TransformType;
+  typedef typename TransformType::ConstPointer TransformConstPointer;
+  typedef AdvancedCombinationTransform<
+    ScalarType, NDimensions >                  CombinationTransformType;
+  typedef Matrix< ScalarType,
+    NDimensions, NDimensions >                 MatrixType;
+
+  /** Typedefs for the displacement grid. */
+  typedef Vector< ScalarType, NDimensions > DisplacementType;
+  typedef Image< DisplacementType,
+    NDimensions >                           DisplacementGridType;
+  typedef typename DisplacementGridType::Pointer       DisplacementGridPointer;
+  typedef typename DisplacementGridType::SizeType      GridSizeType;
+  typedef typename DisplacementGridType::SpacingType   GridSpacingType;
+  typedef typename DisplacementGridType::PointType     GridOriginType;
+  typedef typename DisplacementGridType::DirectionType GridDirectionType;
+  typedef VectorLinearInterpolateImageFunction<
+    DisplacementGridType, ScalarType >                 DisplacementInterpolatorType;
+  typedef typename DisplacementInterpolatorType::Pointer DisplacementInterpolatorPointer;
+
+  /** Set/Get the transform chain that is compiled. */
+  itkSetConstObjectMacro( Transform, TransformType );
+  itkGetConstObjectMacro( Transform, TransformType );
+
+  /** Whether the chain is baked into a displacement grid, if it contains
+   * nonlinear stages. Default: false.
+   */
+  itkSetMacro( BakeNonlinearStages, bool );
+  itkGetConstMacro( BakeNonlinearStages, bool );
+  itkBooleanMacro( BakeNonlinearStages );
+
+  /** Set/Get the geometry of the displacement grid. The grid should cover
+   * the domain in which the transform is evaluated, e.g. the output
+   * domain of a resampler.
+   */
+  itkSetMacro( GridOrigin, GridOriginType );
+  itkGetConstReferenceMacro( GridOrigin, GridOriginType );
+  itkSetMacro( GridSpacing, GridSpacingType );
+  itkGetConstReferenceMacro( GridSpacing, GridSpacingType );
+  itkSetMacro( GridSize, GridSizeType );
+  itkGetConstReferenceMacro( GridSize, GridSizeType );
+  itkSetMacro( GridDirection, GridDirectionType );
+  itkGetConstReferenceMacro( GridDirection, GridDirectionType );
+
+  /** Set/Get the maximum error (in physical units) that is accepted
+   * for the displacement grid. Default: 0.01.
+   */
+  itkSetMacro( MaximumBakingError, double );
+  itkGetConstMacro( MaximumBakingError, double );
+
+  /** Set/Get the maximum number of points at which the error of the
+   * displacement grid is measured. Default: 10000.
+   */
+  itkSetMacro( NumberOfBakingTestPoints, SizeValueType );
+  itkGetConstMacro( NumberOfBakingTestPoints, SizeValueType );
+
+  /** Flatten, fold and possibly bake the transform chain. */
+  virtual void Compile( void );
+
+  /** Get the number of stages of the transform chain, before and after folding. */
+  itkGetConstMacro( NumberOfOriginalStages, SizeValueType );
+  virtual SizeValueType GetNumberOfStages( void ) const
+  {
+    return this->m_Stages.size();
+  }
+
+
+  /** Whether the displacement grid is used, and its measured error. */
+  itkGetConstMacro( IsBaked, bool );
+  itkGetConstMacro( BakingError, double );
+
+  /** Method to transform a point. */
+  virtual OutputPointType TransformPoint( const InputPointType & point ) const;
+
+  /** The following pure virtual functions must be overloaded.
+   * For now just throw an exception, since these are not used in elastix.
+   */
+  virtual OutputVectorType TransformVector( const InputVectorType & ) const
+  {
+    itkExceptionMacro(
+        << "TransformVector(const InputVectorType &) is not implemented "
+        << "for CompiledCombinationTransform" );
+  }
+
+
+  virtual OutputVnlVectorType TransformVector( const InputVnlVectorType & ) const
+  {
+    itkExceptionMacro(
+        << "TransformVector(const InputVnlVectorType &) is not implemented "
+        << "for CompiledCombinationTransform" );
+  }
+
+
+  virtual OutputCovariantVectorType TransformCovariantVector( const InputCovariantVectorType & ) const
+  {
+    itkExceptionMacro(
+        << "TransformCovariantVector(const InputCovariantVectorType &) is not implemented "
+        << "for CompiledCombinationTransform" );
+  }
+
+
+  virtual void ComputeJacobianWithRespectToParameters(
+    const InputPointType &, JacobianType & ) const
+  {
+    itkExceptionMacro(
+        << "ComputeJacobianWithRespectToParameters() is not implemented "
+        << "for CompiledCombinationTransform" );
+  }
+
+
+  /** A compiled chain has no parameters of its own. */
+  virtual void SetParameters( const ParametersType & ) {}
+  virtual void SetFixedParameters( const FixedParametersType & ) {}
+
+  /** Linear if all stages are folded into a single linear one. */
+  virtual TransformCategoryType GetTransformCategory() const;
+
+protected:
+
+  /** Constructor. */
+  CompiledCombinationTransform();
+
+  /** Destructor. */
+  virtual ~CompiledCombinationTransform() {}
+
+  /** PrintSelf. */
+  virtual void PrintSelf( std::ostream & os, Indent indent ) const;
+
+  /** A stage of the chain: either a folded linear stage, or a transform. */
+  struct StageType
+  {
+    bool                  m_IsLinear;
+    MatrixType            m_Matrix;
+    OutputVectorType      m_Offset;
+    TransformConstPointer m_Transform;
+  };
+
+  /** Append the stages of a (sub)chain to m_Stages, in order of application. */
+  virtual void FlattenTransform( const TransformType * transform );
+
+  /** Fold consecutive linear stages. */
+  virtual void FoldLinearStages( void );
+
+  /** Bake the stages into the displacement grid and measure the error. */
+  virtual void BakeStages( void );
+
+  /** Map a point through m_Stages. */
+  inline OutputPointType TransformPointThroughStages( const InputPointType & point ) const;
+
+private:
+
+  CompiledCombinationTransform( const Self & ); // purposely not implemented
+  void operator=( const Self & );               // purposely not implemented
+
+  /** Member variables. */
+  TransformConstPointer    m_Transform;
+  std::vector< StageType > m_Stages;
+  SizeValueType            m_NumberOfOriginalStages;
+
+  bool              m_BakeNonlinearStages;
+  GridOriginType    m_GridOrigin;
+  GridSpacingType   m_GridSpacing;
+  GridSizeType      m_GridSize;
+  GridDirectionType m_GridDirection;
+  double            m_MaximumBakingError;
+  SizeValueType     m_NumberOfBakingTestPoints;
+
+  bool                            m_IsBaked;
+  double                          m_BakingError;
+  DisplacementGridPointer         m_DisplacementGrid;
+  DisplacementInterpolatorPointer m_DisplacementInterpolator;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkCompiledCombinationTransform.hxx"
+#endif
+
+#endif // end #ifndef __itkCompiledCombinationTransform_h
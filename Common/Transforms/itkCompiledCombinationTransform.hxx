@@ -0,0 +1,407 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkCompiledCombinationTransform_hxx
+#define __itkCompiledCombinationTransform_hxx
+
+#include "itkCompiledCombinationTransform.h"
+#include "itkTransformToDisplacementFieldFilter.h"
+
+#include <algorithm>
+
+namespace itk
+{
+
+/**
+ * ************************ Constructor *************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+CompiledCombinationTransform< TScalarType, NDimensions >
+::CompiledCombinationTransform() : Superclass( 0 )
+{
+  this->m_Transform              = 0;
+  this->m_NumberOfOriginalStages = 0;
+
+  this->m_BakeNonlinearStages = false;
+  this->m_GridOrigin.Fill( 0.0 );
+  this->m_GridSpacing.Fill( 1.0 );
+  this->m_GridSize.Fill( 0 );
+  this->m_GridDirection.SetIdentity();
+  this->m_MaximumBakingError       = 0.01;
+  this->m_NumberOfBakingTestPoints = 10000;
+
+  this->m_IsBaked                  = false;
+  this->m_BakingError              = 0.0;
+  this->m_DisplacementGrid         = 0;
+  this->m_DisplacementInterpolator = 0;
+
+} // end Constructor
+
+
+/**
+ * ************************ Compile *************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+CompiledCombinationTransform< TScalarType, NDimensions >
+::Compile( void )
+{
+  if( this->m_Transform.IsNull() )
+  {
+    itkExceptionMacro( << "No transform set to compile." );
+  }
+
+  /** Start from scratch. */
+  this->m_Stages.clear();
+  this->m_IsBaked                  = false;
+  this->m_BakingError              = 0.0;
+  this->m_DisplacementGrid         = 0;
+  this->m_DisplacementInterpolator = 0;
+
+  /** Unroll the chain and fold the linear stages. */
+  this->FlattenTransform( this->m_Transform );
+  this->m_NumberOfOriginalStages = this->m_Stages.size();
+  this->FoldLinearStages();
+
+  /** Bake the chain, if it contains nonlinear stages. */
+  bool isLinear = true;
+  for( unsigned int i = 0; i < this->m_Stages.size(); ++i )
+  {
+    isLinear &= this->m_Stages[ i ].m_IsLinear;
+  }
+  if( this->m_BakeNonlinearStages && !isLinear )
+  {
+    this->BakeStages();
+  }
+
+  this->Modified();
+
+} // end Compile()
+
+
+/**
+ * ************************ FlattenTransform *************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+CompiledCombinationTransform< TScalarType, NDimensions >
+::FlattenTransform( const TransformType * transform )
+{
+  /** Unroll compositions: T(x) = T_1( T_0(x) ). */
+  const CombinationTransformType * combination
+    = dynamic_cast< const CombinationTransformType * >( transform );
+  if( combination )
+  {
+    const TransformType * initialTransform = combination->GetInitialTransform();
+    const TransformType * currentTransform = combination->GetCurrentTransform();
+    if( currentTransform == 0 )
+    {
+      itkExceptionMacro( << "The transform chain contains a combination without current transform." );
+    }
+
+    if( initialTransform == 0 )
+    {
+      this->FlattenTransform( currentTransform );
+      return;
+    }
+    if( combination->GetUseComposition() )
+    {
+      this->FlattenTransform( initialTransform );
+      this->FlattenTransform( currentTransform );
+      return;
+    }
+  }
+
+  /** Anything else is a single stage. For linear stages, read the matrix
+   * and offset from the images of the origin and the unit vectors.
+   */
+  StageType stage;
+  stage.m_IsLinear  = transform->IsLinear();
+  stage.m_Transform = transform;
+  stage.m_Matrix.SetIdentity();
+  stage.m_Offset.Fill( 0.0 );
+  if( stage.m_IsLinear )
+  {
+    InputPointType point;
+    point.Fill( 0.0 );
+    const OutputPointType origin = transform->TransformPoint( point );
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      point.Fill( 0.0 );
+      point[ j ] = 1.0;
+      const OutputPointType column = transform->TransformPoint( point );
+      for( unsigned int i = 0; i < SpaceDimension; ++i )
+      {
+        stage.m_Matrix( i, j ) = column[ i ] - origin[ i ];
+      }
+    }
+    for( unsigned int i = 0; i < SpaceDimension; ++i )
+    {
+      stage.m_Offset[ i ] = origin[ i ];
+    }
+  }
+
+  this->m_Stages.push_back( stage );
+
+} // end FlattenTransform()
+
+
+/**
+ * ************************ FoldLinearStages *************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+CompiledCombinationTransform< TScalarType, NDimensions >
+::FoldLinearStages( void )
+{
+  /** B( A x + a ) + b = BA x + ( B a + b ) */
+  std::vector< StageType > foldedStages;
+  for( unsigned int k = 0; k < this->m_Stages.size(); ++k )
+  {
+    const StageType & stage = this->m_Stages[ k ];
+    if( stage.m_IsLinear && !foldedStages.empty() && foldedStages.back().m_IsLinear )
+    {
+      StageType & folded = foldedStages.back();
+      folded.m_Offset    = stage.m_Matrix * folded.m_Offset + stage.m_Offset;
+      folded.m_Matrix    = stage.m_Matrix * folded.m_Matrix;
+      folded.m_Transform = 0;
+    }
+    else
+    {
+      foldedStages.push_back( stage );
+    }
+  }
+
+  this->m_Stages.swap( foldedStages );
+
+} // end FoldLinearStages()
+
+
+/**
+ * ************************ BakeStages *************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+CompiledCombinationTransform< TScalarType, NDimensions >
+::BakeStages( void )
+{
+  /** The grid needs at least one cell. */
+  SizeValueType numberOfCells = 1;
+  for( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    if( this->m_GridSize[ i ] < 2 )
+    {
+      return;
+    }
+    numberOfCells *= this->m_GridSize[ i ] - 1;
+  }
+
+  /** Sample the stages on the grid, multi-threadedly.
+   * m_IsBaked is still false, so this evaluates the stages.
+   */
+  typedef TransformToDisplacementFieldFilter<
+    DisplacementGridType, ScalarType >      GeneratorType;
+  typename GeneratorType::Pointer generator = GeneratorType::New();
+  typename DisplacementGridType::IndexType startIndex;
+  startIndex.Fill( 0 );
+  generator->SetSize( this->m_GridSize );
+  generator->SetOutputSpacing( this->m_GridSpacing );
+  generator->SetOutputOrigin( this->m_GridOrigin );
+  generator->SetOutputStartIndex( startIndex );
+  generator->SetOutputDirection( this->m_GridDirection );
+  generator->SetTransform( this );
+  generator->Update();
+
+  DisplacementGridPointer grid = generator->GetOutput();
+  grid->DisconnectPipeline();
+
+  DisplacementInterpolatorPointer interpolator = DisplacementInterpolatorType::New();
+  interpolator->SetInputImage( grid );
+
+  /** Measure the error halfway between the grid points, where the
+   * linear interpolation is least accurate. The cells are visited with
+   * a fixed stride, so the result is reproducible.
+   */
+  const SizeValueType numberOfTestPoints
+    = std::max( this->m_NumberOfBakingTestPoints, static_cast< SizeValueType >( 1 ) );
+  const SizeValueType stride
+    = std::max( numberOfCells / numberOfTestPoints, static_cast< SizeValueType >( 1 ) );
+
+  double maximumError = 0.0;
+  for( SizeValueType cell = stride / 2; cell < numberOfCells; cell += stride )
+  {
+    typename DisplacementInterpolatorType::ContinuousIndexType cindex;
+    SizeValueType remainder = cell;
+    for( unsigned int i = 0; i < SpaceDimension; ++i )
+    {
+      cindex[ i ] = static_cast< ScalarType >( remainder % ( this->m_GridSize[ i ] - 1 ) ) + 0.5;
+      remainder  /= this->m_GridSize[ i ] - 1;
+    }
+
+    InputPointType point;
+    grid->TransformContinuousIndexToPhysicalPoint( cindex, point );
+
+    const OutputPointType exact = this->TransformPointThroughStages( point );
+    const typename DisplacementInterpolatorType::OutputType displacement
+      = interpolator->EvaluateAtContinuousIndex( cindex );
+    double error = 0.0;
+    for( unsigned int i = 0; i < SpaceDimension; ++i )
+    {
+      const double diff = exact[ i ] - ( point[ i ] + displacement[ i ] );
+      error += diff * diff;
+    }
+    maximumError = std::max( maximumError, error );
+  }
+  this->m_BakingError = vcl_sqrt( maximumError );
+
+  /** Only keep the grid when it is accurate enough. */
+  if( this->m_BakingError <= this->m_MaximumBakingError )
+  {
+    this->m_DisplacementGrid         = grid;
+    this->m_DisplacementInterpolator = interpolator;
+    this->m_IsBaked                  = true;
+  }
+
+} // end BakeStages()
+
+
+/**
+ * ************************ TransformPoint *************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+typename CompiledCombinationTransform< TScalarType, NDimensions >::OutputPointType
+CompiledCombinationTransform< TScalarType, NDimensions >
+::TransformPoint( const InputPointType & point ) const
+{
+  /** Use the displacement grid, if the point is inside. */
+  if( this->m_IsBaked )
+  {
+    typename DisplacementInterpolatorType::ContinuousIndexType cindex;
+    this->m_DisplacementGrid->TransformPhysicalPointToContinuousIndex( point, cindex );
+
+    bool inside = true;
+    for( unsigned int i = 0; i < SpaceDimension; ++i )
+    {
+      inside &= cindex[ i ] >= 0.0
+        && cindex[ i ] <= static_cast< double >( this->m_GridSize[ i ] - 1 );
+    }
+
+    if( inside )
+    {
+      const typename DisplacementInterpolatorType::OutputType displacement
+        = this->m_DisplacementInterpolator->EvaluateAtContinuousIndex( cindex );
+      OutputPointType outputPoint;
+      for( unsigned int i = 0; i < SpaceDimension; ++i )
+      {
+        outputPoint[ i ] = point[ i ] + displacement[ i ];
+      }
+      return outputPoint;
+    }
+  }
+
+  return this->TransformPointThroughStages( point );
+
+} // end TransformPoint()
+
+
+/**
+ * ******************* TransformPointThroughStages *********************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+typename CompiledCombinationTransform< TScalarType, NDimensions >::OutputPointType
+CompiledCombinationTransform< TScalarType, NDimensions >
+::TransformPointThroughStages( const InputPointType & point ) const
+{
+  OutputPointType outputPoint = point;
+  for( typename std::vector< StageType >::const_iterator it = this->m_Stages.begin();
+    it != this->m_Stages.end(); ++it )
+  {
+    if( it->m_IsLinear )
+    {
+      outputPoint = it->m_Matrix * outputPoint + it->m_Offset;
+    }
+    else
+    {
+      outputPoint = it->m_Transform->TransformPoint( outputPoint );
+    }
+  }
+
+  return outputPoint;
+
+} // end TransformPointThroughStages()
+
+
+/**
+ * ***************** GetTransformCategory **************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+typename CompiledCombinationTransform< TScalarType, NDimensions >::TransformCategoryType
+CompiledCombinationTransform< TScalarType, NDimensions >
+::GetTransformCategory() const
+{
+  /** After folding, a linear chain consists of at most one stage. */
+  if( !this->m_IsBaked && this->m_Stages.size() <= 1
+    && ( this->m_Stages.empty() || this->m_Stages[ 0 ].m_IsLinear ) )
+  {
+    return Self::Linear;
+  }
+
+  return Self::UnknownTransformCategory;
+
+} // end GetTransformCategory()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+CompiledCombinationTransform< TScalarType, NDimensions >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  this->Superclass::PrintSelf( os, indent );
+
+  os << indent << "Transform: " << this->m_Transform.GetPointer() << std::endl;
+  os << indent << "NumberOfOriginalStages: " << this->m_NumberOfOriginalStages << std::endl;
+  os << indent << "NumberOfStages: " << this->m_Stages.size() << std::endl;
+
+  os << indent << "BakeNonlinearStages: " << this->m_BakeNonlinearStages << std::endl;
+  os << indent << "GridOrigin: " << this->m_GridOrigin << std::endl;
+  os << indent << "GridSpacing: " << this->m_GridSpacing << std::endl;
+  os << indent << "GridSize: " << this->m_GridSize << std::endl;
+  os << indent << "GridDirection: " << this->m_GridDirection << std::endl;
+  os << indent << "MaximumBakingError: " << this->m_MaximumBakingError << std::endl;
+  os << indent << "NumberOfBakingTestPoints: " << this->m_NumberOfBakingTestPoints << std::endl;
+
+  os << indent << "IsBaked: " << this->m_IsBaked << std::endl;
+  os << indent << "BakingError: " << this->m_BakingError << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkCompiledCombinationTransform_hxx
@@ -26,6 +26,7 @@
 #include "itkBSplineInterpolationSecondOrderDerivativeWeightFunction.h"
 #include "itkAdvancedBSplineDeformableTransform.h"
 #include "itkCyclicBSplineDeformableTransform.h"
+#include "itkRecursiveBSplineInterpolationWeightFunction.h"
 
 namespace itk
 {
@@ -35,6 +36,11 @@ namespace itk
  * \brief Deformable transform using a B-spline representation in which the
  *   B-spline grid is formulated in a cyclic way.
  *
+ * TransformPoint, GetJacobian, EvaluateJacobianWithImageGradientProduct and
+ * GetSpatialJacobian use a recursive implementation, in which the wrap around
+ * of the last dimension is handled by remapping the indices of the support
+ * region in that dimension.
+ *
  * \ingroup Transforms
  */
 template<
@@ -75,9 +81,12 @@ public:
   typedef typename Superclass::SpatialHessianType SpatialHessianType;
   typedef typename Superclass
     ::JacobianOfSpatialHessianType JacobianOfSpatialHessianType;
-  typedef typename Superclass::InternalMatrixType     InternalMatrixType;
-  typedef typename Superclass::ParametersType         ParametersType;
-  typedef typename Superclass::NumberOfParametersType NumberOfParametersType;
+  typedef typename Superclass::InternalMatrixType      InternalMatrixType;
+  typedef typename Superclass::ParametersType          ParametersType;
+  typedef typename Superclass::NumberOfParametersType  NumberOfParametersType;
+  typedef typename Superclass::ParametersValueType     ParametersValueType;
+  typedef typename Superclass::DerivativeType          DerivativeType;
+  typedef typename Superclass::MovingImageGradientType MovingImageGradientType;
 
   /** Parameters as SpaceDimension number of images. */
   typedef typename ParametersType::ValueType PixelType;
@@ -92,6 +101,7 @@ public:
   typedef typename ImageType::DirectionType    DirectionType;
   typedef typename ImageType::PointType        OriginType;
   typedef typename RegionType::IndexType       GridOffsetType;
+  typedef typename GridOffsetType::OffsetValueType OffsetValueType;
   typedef typename Superclass::InputPointType  InputPointType;
   typedef typename Superclass::OutputPointType OutputPointType;
   typedef typename Superclass::WeightsType     WeightsType;
@@ -111,10 +121,16 @@ public:
     itkGetStaticConstMacro( SplineOrder ) >     RedWeightsFunctionType;
   typedef typename RedWeightsFunctionType::
     ContinuousIndexType RedContinuousIndexType;
+  typedef RecursiveBSplineInterpolationWeightFunction< ScalarType,
+    itkGetStaticConstMacro( SpaceDimension ),
+    itkGetStaticConstMacro( SplineOrder ) >     RecursiveBSplineWeightFunctionType;
 
   /** This method specifies the region over which the grid resides. */
   virtual void SetGridRegion( const RegionType & region );
 
+  /** Compute point transformation. The last dimension is not displaced. */
+  virtual OutputPointType TransformPoint( const InputPointType & point ) const;
+
   /** Transform points by a B-spline deformable transformation.
    * On return, weights contains the interpolation weights used to compute the
    * deformation and indices of the x (zeroth) dimension coefficient parameters
@@ -135,6 +151,21 @@ public:
     WeightsType & weights,
     ParameterIndexArrayType & indices ) const;
 
+  /** Compute the Jacobian of the transformation. */
+  virtual void GetJacobian(
+    const InputPointType & ipp,
+    JacobianType & j,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+
+  /** Compute the inner product of the Jacobian with the moving image gradient.
+   * The Jacobian is (partially) constructed inside this function, but not returned.
+   */
+  virtual void EvaluateJacobianWithImageGradientProduct(
+    const InputPointType & ipp,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+
   /** Compute the spatial Jacobian of the transformation. */
   virtual void GetSpatialJacobian(
     const InputPointType & ipp,
@@ -145,13 +176,22 @@ protected:
   CyclicBSplineDeformableTransform();
   virtual ~CyclicBSplineDeformableTransform();
 
-  void ComputeNonZeroJacobianIndices(
+  typename RecursiveBSplineWeightFunctionType::Pointer m_RecursiveBSplineWeightFunction;
+
+  /** Compute the nonzero Jacobian indices. */
+  virtual void ComputeNonZeroJacobianIndices(
     NonZeroJacobianIndicesType & nonZeroJacobianIndices,
     const RegionType & supportRegion ) const;
 
   /** Check if a continuous index is inside the valid region. */
   bool InsideValidRegion( const ContinuousIndexType & index ) const;
 
+  /** Compute the wrapped offsets of the slices of the support region in the
+   * last dimension, and the offset of the support region in the other dimensions.
+   */
+  OffsetValueType ComputeSupportOffsets( const IndexType & supportIndex,
+    OffsetValueType * sliceOffsets ) const;
+
   /** Split an image region into two regions based on the last dimension. */
   virtual void SplitRegion(
     const RegionType & imageRegion,
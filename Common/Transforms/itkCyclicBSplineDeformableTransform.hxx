@@ -21,6 +21,7 @@
 #include "itkCyclicBSplineDeformableTransform.h"
 #include "itkContinuousIndex.h"
 #include "itkImageRegionIterator.h"
+#include "itkRecursiveCyclicBSplineTransformImplementation.h"
 
 namespace itk
 {
@@ -29,7 +30,9 @@ namespace itk
 template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
 CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
 ::CyclicBSplineDeformableTransform() : Superclass()
-{}
+{
+  this->m_RecursiveBSplineWeightFunction = RecursiveBSplineWeightFunctionType::New();
+}
 
 /** Destructor. */
 template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
@@ -145,6 +148,101 @@ CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
 }
 
 
+/**
+ * ********************* ComputeSupportOffsets ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+typename CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::OffsetValueType
+CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::ComputeSupportOffsets( const IndexType & supportIndex,
+  OffsetValueType * sliceOffsets ) const
+{
+  /** The offset to the support region in the dimensions that do not wrap. */
+  const OffsetValueType * gridOffsetTable      = this->m_CoefficientImages[ 0 ]->GetOffsetTable();
+  OffsetValueType         offsetToSupportIndex = 0;
+  for( unsigned int j = 0; j < SpaceDimension - 1; ++j )
+  {
+    offsetToSupportIndex += supportIndex[ j ] * gridOffsetTable[ j ];
+  }
+
+  /** The offsets of the slices in the last dimension, wrapped around the grid. */
+  const OffsetValueType lastDimSize = static_cast< OffsetValueType >(
+    this->m_CoefficientImages[ 0 ]->GetLargestPossibleRegion().GetSize( SpaceDimension - 1 ) );
+  RecursiveCyclicBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalarType >
+    ::ComputeSliceOffsets( sliceOffsets, supportIndex[ SpaceDimension - 1 ],
+    lastDimSize, gridOffsetTable );
+
+  return offsetToSupportIndex;
+
+} // end ComputeSupportOffsets()
+
+
+/**
+ * ********************* TransformPoint ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+typename CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::OutputPointType
+CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::TransformPoint( const InputPointType & point ) const
+{
+  /** Check if the coefficient image has been set. */
+  OutputPointType outputPoint = point;
+  if( !this->m_CoefficientImages[ 0 ] )
+  {
+    itkWarningMacro( << "B-spline coefficients have not been set" );
+    return outputPoint;
+  }
+
+  /** Convert to continuous index. */
+  ContinuousIndexType cindex;
+  this->TransformPointToContinuousGridIndex( point, cindex );
+
+  /** NOTE: if the support region does not lie totally within the grid
+   * (except for the last dimension, which wraps around) we assume
+   * zero displacement and return the input point.
+   */
+  if( !this->InsideValidRegion( cindex ) )
+  {
+    return outputPoint;
+  }
+
+  /** Compute the interpolation weights. */
+  const unsigned int numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray1D[ numberOfWeights ];
+  WeightsType weights1D( weightsArray1D, numberOfWeights, false );
+  IndexType   supportIndex;
+  this->m_RecursiveBSplineWeightFunction->Evaluate( cindex, weights1D, supportIndex );
+
+  /** Get handles to the mu's of the dimensions that are displaced. */
+  OffsetValueType       sliceOffsets[ SplineOrder + 1 ];
+  const OffsetValueType offsetToSupportIndex = this->ComputeSupportOffsets( supportIndex, sliceOffsets );
+  ScalarType *          mu[ SpaceDimension - 1 ];
+  for( unsigned int j = 0; j < SpaceDimension - 1; ++j )
+  {
+    mu[ j ] = this->m_CoefficientImages[ j ]->GetBufferPointer() + offsetToSupportIndex;
+  }
+
+  /** Call the recursive TransformPoint function. */
+  ScalarType displacement[ SpaceDimension - 1 ];
+  RecursiveCyclicBSplineTransformImplementation< SpaceDimension - 1, SpaceDimension, SplineOrder, TScalarType >
+    ::TransformPoint( displacement, mu, this->m_CoefficientImages[ 0 ]->GetOffsetTable(),
+    weightsArray1D, sliceOffsets );
+
+  /** The output point is the start point + displacement. */
+  for( unsigned int j = 0; j < SpaceDimension - 1; ++j )
+  {
+    outputPoint[ j ] += displacement[ j ];
+  }
+
+  return outputPoint;
+
+} // end TransformPoint()
+
+
 /** Transform a point. */
 template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
 void
@@ -299,6 +397,129 @@ CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
 }
 
 
+/**
+ * ********************* GetJacobian ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::GetJacobian( const InputPointType & ipp, JacobianType & jacobian,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+{
+  /** Convert the physical point to a continuous index, which
+   * is needed for the 'Evaluate()' functions below.
+   */
+  ContinuousIndexType cindex;
+  this->TransformPointToContinuousGridIndex( ipp, cindex );
+
+  /** Initialize. */
+  const NumberOfParametersType nnzji = this->GetNumberOfNonZeroJacobianIndices();
+  if( ( jacobian.cols() != nnzji ) || ( jacobian.rows() != SpaceDimension ) )
+  {
+    jacobian.SetSize( SpaceDimension, nnzji );
+    jacobian.Fill( 0.0 );
+  }
+
+  /** NOTE: if the support region does not lie totally within the grid
+   * we assume zero displacement and zero Jacobian.
+   */
+  if( !this->InsideValidRegion( cindex ) )
+  {
+    nonZeroJacobianIndices.resize( nnzji );
+    for( NumberOfParametersType i = 0; i < nnzji; ++i )
+    {
+      nonZeroJacobianIndices[ i ] = i;
+    }
+    return;
+  }
+
+  /** Compute the interpolation weights. */
+  const unsigned int numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray1D[ numberOfWeights ];
+  WeightsType weights1D( weightsArray1D, numberOfWeights, false );
+  IndexType   supportIndex;
+  this->m_RecursiveBSplineWeightFunction->Evaluate( cindex, weights1D, supportIndex );
+
+  /** Recursively compute the first numberOfIndices entries of the Jacobian.
+   * The weights do not depend on the wrap around, so the regular recursive
+   * implementation is used. The pointer has changed after this function call.
+   */
+  ParametersValueType * jacobianPointer = jacobian.data_block();
+  RecursiveBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalarType >
+    ::GetJacobian( jacobianPointer, weightsArray1D, 1.0 );
+
+  /** Compute the nonzero Jacobian indices. */
+  RegionType supportRegion;
+  supportRegion.SetSize( this->m_SupportSize );
+  supportRegion.SetIndex( supportIndex );
+  this->ComputeNonZeroJacobianIndices( nonZeroJacobianIndices, supportRegion );
+
+} // end GetJacobian()
+
+
+/**
+ * ********************* EvaluateJacobianWithImageGradientProduct ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::EvaluateJacobianWithImageGradientProduct(
+  const InputPointType & ipp,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+{
+  /** Convert the physical point to a continuous index, which
+   * is needed for the 'Evaluate()' functions below.
+   */
+  ContinuousIndexType cindex;
+  this->TransformPointToContinuousGridIndex( ipp, cindex );
+
+  /** NOTE: if the support region does not lie totally within the grid
+   * we assume zero displacement and zero Jacobian.
+   */
+  const NumberOfParametersType nnzji = this->GetNumberOfNonZeroJacobianIndices();
+  if( !this->InsideValidRegion( cindex ) )
+  {
+    nonZeroJacobianIndices.resize( nnzji );
+    for( NumberOfParametersType i = 0; i < nnzji; ++i )
+    {
+      nonZeroJacobianIndices[ i ] = i;
+    }
+    imageJacobian.Fill( 0.0 );
+    return;
+  }
+
+  /** Compute the interpolation weights. */
+  const unsigned int numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray1D[ numberOfWeights ];
+  WeightsType weights1D( weightsArray1D, numberOfWeights, false );
+  IndexType   supportIndex;
+  this->m_RecursiveBSplineWeightFunction->Evaluate( cindex, weights1D, supportIndex );
+
+  /** Recursively compute the inner product of the Jacobian and the moving image gradient.
+   * As for the Jacobian, the regular recursive implementation is used.
+   */
+  double migArray[ SpaceDimension ];
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    migArray[ j ] = movingImageGradient[ j ];
+  }
+  ParametersValueType * imageJacobianPointer = imageJacobian.data_block();
+  RecursiveBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalarType >
+    ::EvaluateJacobianWithImageGradientProduct( imageJacobianPointer, migArray, weightsArray1D, 1.0 );
+
+  /** Compute the nonzero Jacobian indices. */
+  RegionType supportRegion;
+  supportRegion.SetSize( this->m_SupportSize );
+  supportRegion.SetIndex( supportIndex );
+  this->ComputeNonZeroJacobianIndices( nonZeroJacobianIndices, supportRegion );
+
+} // end EvaluateJacobianWithImageGradientProduct()
+
+
 /**
  * ********************* GetSpatialJacobian ****************************
  */
@@ -318,8 +539,8 @@ CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
   }
 
   /** Convert the physical point to a continuous index, which
-       * is needed for the 'Evaluate()' functions below.
-       */
+   * is needed for the 'Evaluate()' functions below.
+   */
   ContinuousIndexType cindex;
   this->TransformPointToContinuousGridIndex( ipp, cindex );
 
@@ -331,67 +552,44 @@ CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
     return;
   }
 
-  /** Compute the number of affected B-spline parameters. */
-  /** Allocate memory on the stack: */
-  const SizeValueType numberOfWeights = WeightsFunctionType::NumberOfWeights;
-  typename WeightsType::ValueType weightsArray[ numberOfWeights ];
-  WeightsType weights( weightsArray, numberOfWeights, false );
-
-  IndexType supportIndex;
-  this->m_DerivativeWeightsFunctions[ 0 ]->ComputeStartIndex(
-    cindex, supportIndex );
-  RegionType supportRegion;
-  supportRegion.SetSize( this->m_SupportSize );
-  supportRegion.SetIndex( supportIndex );
-
-  /** Split support region into two parts. */
-  RegionType supportRegions[ 2 ];
-  this->SplitRegion( this->m_CoefficientImages[ 0 ]->GetLargestPossibleRegion(),
-    supportRegion, supportRegions[ 0 ], supportRegions[ 1 ] );
+  /** Compute the interpolation weights and derivative weights. */
+  const unsigned int numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray1D[ numberOfWeights ];
+  WeightsType weights1D( weightsArray1D, numberOfWeights, false );
+  typename WeightsType::ValueType derivativeWeightsArray1D[ numberOfWeights ];
+  WeightsType derivativeWeights1D( derivativeWeightsArray1D, numberOfWeights, false );
+  IndexType   supportIndex;
+  this->m_RecursiveBSplineWeightFunction->Evaluate( cindex, weights1D, supportIndex );
+  this->m_RecursiveBSplineWeightFunction->EvaluateDerivative( cindex, derivativeWeights1D, supportIndex );
+
+  /** Get handles to the mu's. */
+  OffsetValueType       sliceOffsets[ SplineOrder + 1 ];
+  const OffsetValueType offsetToSupportIndex = this->ComputeSupportOffsets( supportIndex, sliceOffsets );
+  ScalarType *          mu[ SpaceDimension ];
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    mu[ j ] = this->m_CoefficientImages[ j ]->GetBufferPointer() + offsetToSupportIndex;
+  }
 
-  sj.Fill( 0.0 );
+  /** Recursively compute the spatial Jacobian. */
+  double spatialJacobian[ SpaceDimension * ( SpaceDimension + 1 ) ];
+  RecursiveCyclicBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalarType >
+    ::GetSpatialJacobian( spatialJacobian, mu, this->m_CoefficientImages[ 0 ]->GetOffsetTable(),
+    weightsArray1D, derivativeWeightsArray1D, sliceOffsets );
 
-  /** Compute the spatial Jacobian sj:
-       *    dT_{dim} / dx_i = delta_{dim,i} + \sum coefs_{dim} * weights.
-       */
+  /** Copy the correct elements to the spatial Jacobian.
+   * The first SpaceDimension elements are the displacement.
+   */
   for( unsigned int i = 0; i < SpaceDimension; ++i )
   {
-    /** Compute the derivative weights. */
-    this->m_DerivativeWeightsFunctions[ i ]->Evaluate( cindex, supportIndex, weights );
-
-    /** Compute the spatial Jacobian sj:
-            *    dT_{dim} / dx_i = \sum coefs_{dim} * weights.
-            */
-    for( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
     {
-      /** Compute the sum for this dimension. */
-      double sum = 0.0;
-
-      typename WeightsType::const_iterator itWeights = weights.begin();
-
-      for( unsigned int r = 0; r < 2; ++r )
-      {
-        /** Create an iterator over the correct part of the coefficient
-                       * image. Create an iterator over the weights vector.
-                       */
-        ImageRegionConstIterator< ImageType > itCoef(
-        this->m_CoefficientImages[ dim ], supportRegions[ r ] );
-
-        while( !itCoef.IsAtEnd() )
-        {
-          sum += itCoef.Value() * ( *itWeights );
-          ++itWeights;
-          ++itCoef;
-        }
-      } // end for r
-
-      /** Update the spatial Jacobian sj. */
-      sj( dim, i ) += sum;
-    } // end for dim
-  }   // end for i
+      sj( i, j ) = spatialJacobian[ i + ( j + 1 ) * SpaceDimension ];
+    }
+  }
 
   /** Take into account grid spacing and direction cosines. */
-  sj = sj * this->m_PointToIndexMatrix;
+  sj = sj * this->m_PointToIndexMatrix2;
 
   /** Add identity. */
   for( unsigned int dim = 0; dim < SpaceDimension; ++dim )
@@ -415,44 +613,18 @@ CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
 {
   nonZeroJacobianIndices.resize( this->GetNumberOfNonZeroJacobianIndices() );
 
-  /** Split support region into two parts. */
-  RegionType supportRegions[ 2 ];
-  this->SplitRegion( this->m_CoefficientImages[ 0 ]->GetLargestPossibleRegion(),
-    supportRegion, supportRegions[ 0 ], supportRegions[ 1 ] );
-
-  /** Initialize some helper variables. */
-  const SizeValueType numberOfWeights = WeightsFunctionType::NumberOfWeights;
-  const SizeValueType parametersPerDim
-    = this->GetNumberOfParametersPerDimension();
-  unsigned long mu = 0;
+  /** Compute the offset to the support region and the wrapped slice offsets. */
+  OffsetValueType     sliceOffsets[ SplineOrder + 1 ];
+  const unsigned long currentIndex     = this->ComputeSupportOffsets( supportRegion.GetIndex(), sliceOffsets );
+  const unsigned long parametersPerDim = this->GetNumberOfParametersPerDimension();
 
-  for( unsigned int r = 0; r < 2; ++r )
-  {
-    /** Create iterator over the coefficient image (for current supportRegion). */
-    ImageRegionConstIteratorWithIndex< ImageType >
-    iterator( this->m_CoefficientImages[ 0 ], supportRegions[ r ] );
-
-    /** For all control points in the support region, set which of the
-            * indices in the parameter array are non-zero.
-            */
-    const PixelType * basePointer = this->m_CoefficientImages[ 0 ]->GetBufferPointer();
-    while( !iterator.IsAtEnd() )
-    {
-      /** Translate the index into a parameter number for the x-direction. */
-      const IdentifierType parameterNumber = &( iterator.Value() ) - basePointer;
-
-      /** Update the nonZeroJacobianIndices for all directions. */
-      for( unsigned int dim = 0; dim < SpaceDimension; ++dim )
-      {
-        nonZeroJacobianIndices[ mu + dim * numberOfWeights ]
-          = parameterNumber + dim * parametersPerDim;
-      }
-
-      /** Increase the iterators. */
-      ++iterator;
-      ++mu;
-    } // end while
-  }   // end for (supportregions)
+  /** Call the recursive implementation. The wrapped support region is
+   * traversed in the same order as the weights.
+   */
+  unsigned long * nzjiPointer = &nonZeroJacobianIndices[ 0 ];
+  RecursiveCyclicBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalarType >
+    ::ComputeNonZeroJacobianIndices( nzjiPointer, parametersPerDim, currentIndex,
+    this->m_CoefficientImages[ 0 ]->GetOffsetTable(), sliceOffsets );
 
 } // end ComputeNonZeroJacobianIndices()
 
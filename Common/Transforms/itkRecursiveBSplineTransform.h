@@ -188,6 +188,43 @@ public:
     JacobianOfSpatialHessianType & jsh,
     NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
 
+  /** Precompute tables of the B-spline weights for points on the voxel lattice
+   * of an image with the given origin, spacing and direction. This is useful
+   * when the transform is mostly evaluated at voxel positions, for example
+   * with the full or grid sampler. Tables are only computed when the image
+   * direction equals the grid direction, and the grid spacing is an integer
+   * multiple of the image spacing, since then the weights repeat periodically.
+   * Returns whether the tables are computed. Points that are not on the
+   * lattice are evaluated as usual, so the result does not change.
+   *
+   * Several users, for example the metrics of a multi-metric registration,
+   * can each request the tables of their own lattice. The requests are
+   * counted per lattice, and the tables of a lattice are kept until each
+   * request is undone by ReleaseWeightTables(). When the grid changes, the
+   * tables of the requested lattices are recomputed.
+   */
+  virtual bool ComputeWeightTables( const InputPointType & imageOrigin,
+    const SpacingType & imageSpacing, const DirectionType & imageDirection );
+
+  /** Undo one request of ComputeWeightTables() for the same lattice. */
+  virtual void ReleaseWeightTables( const InputPointType & imageOrigin,
+    const SpacingType & imageSpacing, const DirectionType & imageDirection );
+
+  /** Remove the weight tables of all lattices, and all requests. */
+  virtual void ClearWeightTables( void );
+
+  /** The number of lattices of which the weight tables are computed. */
+  unsigned int GetNumberOfWeightTables( void ) const
+  {
+    return this->m_RecursiveBSplineWeightFunction->GetNumberOfWeightTables();
+  }
+
+
+  /** Set the grid, and recompute the weight tables for the new grid. */
+  virtual void SetGridSpacing( const SpacingType & spacing );
+  virtual void SetGridDirection( const DirectionType & direction );
+  virtual void SetGridOrigin( const OriginType & origin );
+
 protected:
 
   RecursiveBSplineTransform();
@@ -203,6 +240,28 @@ protected:
     NonZeroJacobianIndicesType & nonZeroJacobianIndices,
     const RegionType & supportRegion ) const;
 
+  /** Get the lattice of the weight tables for an image, in continuous grid
+   * indices. Returns false if the image lattice is not aligned with the grid.
+   */
+  bool GetWeightTableLattice( const InputPointType & imageOrigin,
+    const SpacingType & imageSpacing, const DirectionType & imageDirection,
+    ContinuousIndexType & firstIndex,
+    typename RecursiveBSplineWeightFunctionType::SizeType & period ) const;
+
+  /** Recompute the weight tables of all requested lattices. */
+  void UpdateWeightTables( void );
+
+  /** The image lattices of which the weight tables are requested. */
+  struct WeightTableRequestType
+  {
+    InputPointType m_ImageOrigin;
+    SpacingType    m_ImageSpacing;
+    DirectionType  m_ImageDirection;
+    unsigned int   m_Count;
+  };
+
+  std::vector< WeightTableRequestType > m_WeightTableRequests;
+
 private:
 
   RecursiveBSplineTransform( const Self & ); // purposely not implemented
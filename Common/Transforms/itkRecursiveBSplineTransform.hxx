@@ -22,6 +22,8 @@
 
 #include "itkRecursiveBSplineTransformImplementation.h"
 
+#include <cmath>
+
 
 namespace itk
 {
@@ -654,6 +656,214 @@ RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
 } // end GetJacobianOfSpatialHessian()
 
 
+/**
+ * ********************* GetWeightTableLattice ****************************
+ */
+
+template< class TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+bool
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::GetWeightTableLattice( const InputPointType & imageOrigin,
+  const SpacingType & imageSpacing, const DirectionType & imageDirection,
+  ContinuousIndexType & firstIndex,
+  typename RecursiveBSplineWeightFunctionType::SizeType & period ) const
+{
+  /** The tables are small, but a too large period would not be useful. */
+  const double maximumPeriod = 1024.0;
+
+  /** The voxel lattice should be aligned with the grid. */
+  const DirectionType & gridDirection = this->GetGridDirection();
+  for( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      if( std::abs( imageDirection[ i ][ j ] - gridDirection[ i ][ j ] ) > 1e-6 )
+      {
+        return false;
+      }
+    }
+  }
+
+  /** The grid spacing should be an integer multiple of the image spacing. */
+  const SpacingType & gridSpacing = this->GetGridSpacing();
+  for( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    const double ratio   = gridSpacing[ i ] / imageSpacing[ i ];
+    const double rounded = std::floor( ratio + 0.5 );
+    if( rounded < 1.0 || rounded > maximumPeriod || std::abs( ratio - rounded ) > 1e-6 * ratio )
+    {
+      return false;
+    }
+    period[ i ] = static_cast< typename RecursiveBSplineWeightFunctionType::SizeType::SizeValueType >( rounded );
+  }
+
+  /** The image origin is a lattice point. */
+  this->TransformPointToContinuousGridIndex( imageOrigin, firstIndex );
+  return true;
+
+} // end GetWeightTableLattice()
+
+
+/**
+ * ********************* ComputeWeightTables ****************************
+ */
+
+template< class TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+bool
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::ComputeWeightTables( const InputPointType & imageOrigin,
+  const SpacingType & imageSpacing, const DirectionType & imageDirection )
+{
+  /** Count the request, also when the lattice is not aligned with the
+   * current grid, since it may be aligned with a later grid.
+   */
+  bool found = false;
+  for( unsigned int k = 0; k < this->m_WeightTableRequests.size() && !found; ++k )
+  {
+    WeightTableRequestType & request = this->m_WeightTableRequests[ k ];
+    if( request.m_ImageOrigin == imageOrigin && request.m_ImageSpacing == imageSpacing
+      && request.m_ImageDirection == imageDirection )
+    {
+      ++request.m_Count;
+      found = true;
+    }
+  }
+  if( !found )
+  {
+    WeightTableRequestType request;
+    request.m_ImageOrigin    = imageOrigin;
+    request.m_ImageSpacing   = imageSpacing;
+    request.m_ImageDirection = imageDirection;
+    request.m_Count          = 1;
+    this->m_WeightTableRequests.push_back( request );
+  }
+
+  ContinuousIndexType                                   firstIndex;
+  typename RecursiveBSplineWeightFunctionType::SizeType period;
+  if( !this->GetWeightTableLattice( imageOrigin, imageSpacing, imageDirection, firstIndex, period ) )
+  {
+    return false;
+  }
+  this->m_RecursiveBSplineWeightFunction->AddWeightTables( firstIndex, period );
+  return true;
+
+} // end ComputeWeightTables()
+
+
+/**
+ * ********************* ReleaseWeightTables ****************************
+ */
+
+template< class TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::ReleaseWeightTables( const InputPointType & imageOrigin,
+  const SpacingType & imageSpacing, const DirectionType & imageDirection )
+{
+  for( unsigned int k = 0; k < this->m_WeightTableRequests.size(); ++k )
+  {
+    WeightTableRequestType & request = this->m_WeightTableRequests[ k ];
+    if( request.m_ImageOrigin == imageOrigin && request.m_ImageSpacing == imageSpacing
+      && request.m_ImageDirection == imageDirection )
+    {
+      /** The tables of the other lattices are kept. */
+      if( --request.m_Count == 0 )
+      {
+        this->m_WeightTableRequests.erase( this->m_WeightTableRequests.begin() + k );
+        this->UpdateWeightTables();
+      }
+      return;
+    }
+  }
+
+} // end ReleaseWeightTables()
+
+
+/**
+ * ********************* ClearWeightTables ****************************
+ */
+
+template< class TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::ClearWeightTables( void )
+{
+  this->m_WeightTableRequests.clear();
+  this->m_RecursiveBSplineWeightFunction->ClearWeightTables();
+
+} // end ClearWeightTables()
+
+
+/**
+ * ********************* UpdateWeightTables ****************************
+ */
+
+template< class TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::UpdateWeightTables( void )
+{
+  this->m_RecursiveBSplineWeightFunction->ClearWeightTables();
+  for( unsigned int k = 0; k < this->m_WeightTableRequests.size(); ++k )
+  {
+    const WeightTableRequestType &                        request = this->m_WeightTableRequests[ k ];
+    ContinuousIndexType                                   firstIndex;
+    typename RecursiveBSplineWeightFunctionType::SizeType period;
+    if( this->GetWeightTableLattice( request.m_ImageOrigin, request.m_ImageSpacing,
+      request.m_ImageDirection, firstIndex, period ) )
+    {
+      this->m_RecursiveBSplineWeightFunction->AddWeightTables( firstIndex, period );
+    }
+  }
+
+} // end UpdateWeightTables()
+
+
+/**
+ * ********************* SetGridSpacing ****************************
+ */
+
+template< class TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::SetGridSpacing( const SpacingType & spacing )
+{
+  this->Superclass::SetGridSpacing( spacing );
+  this->UpdateWeightTables();
+
+} // end SetGridSpacing()
+
+
+/**
+ * ********************* SetGridDirection ****************************
+ */
+
+template< class TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::SetGridDirection( const DirectionType & direction )
+{
+  this->Superclass::SetGridDirection( direction );
+  this->UpdateWeightTables();
+
+} // end SetGridDirection()
+
+
+/**
+ * ********************* SetGridOrigin ****************************
+ */
+
+template< class TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::SetGridOrigin( const OriginType & origin )
+{
+  this->Superclass::SetGridOrigin( origin );
+  this->UpdateWeightTables();
+
+} // end SetGridOrigin()
+
+
 /**
  * ********************* ComputeNonZeroJacobianIndices ****************************
  */
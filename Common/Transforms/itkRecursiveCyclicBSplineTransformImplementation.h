@@ -0,0 +1,206 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkRecursiveCyclicBSplineTransformImplementation_h
+#define __itkRecursiveCyclicBSplineTransformImplementation_h
+
+#include "itkRecursiveBSplineTransformImplementation.h"
+
+namespace itk
+{
+
+/** \class RecursiveCyclicBSplineTransformImplementation
+ *
+ * \brief This helper class contains the recursive implementation of the
+ * cyclic B-spline transform
+ *
+ * In a cyclic B-spline grid the last dimension wraps around, so the support
+ * region of a point may continue at the start of the grid. This class handles
+ * the last dimension: the SplineOrder + 1 slices of the support region are
+ * found with the wrapped slice offsets, which are computed once per point by
+ * ComputeSliceOffsets(). The other dimensions are handled by the regular
+ * RecursiveBSplineTransformImplementation, so the support region never needs
+ * to be split into two regions.
+ *
+ * The Jacobian and its product with the image gradient only depend on the
+ * weights, which have the same order as the wrapped support region. They are
+ * computed with the regular RecursiveBSplineTransformImplementation.
+ *
+ * \ingroup ITKTransform
+ */
+
+template< unsigned int OutputDimension, unsigned int SpaceDimension, unsigned int SplineOrder, class TScalar >
+class RecursiveCyclicBSplineTransformImplementation
+{
+public:
+
+  /** Typedef related to the coordinate representation type and the weights type. */
+  typedef TScalar ScalarType;
+  typedef double  InternalFloatType;
+
+  /** Helper constant variable. */
+  itkStaticConstMacro( HelperConstVariable, unsigned int,
+    ( SpaceDimension - 1 ) * ( SplineOrder + 1 ) );
+
+  /** The implementation of the dimensions that do not wrap around. */
+  typedef RecursiveBSplineTransformImplementation<
+    OutputDimension, SpaceDimension - 1, SplineOrder, TScalar > LowerDimensionImplementationType;
+
+  typedef ScalarType *  OutputPointType;
+  typedef ScalarType ** CoefficientPointerVectorType;
+
+  /** Compute the offsets of the slices of the support region in the last
+   * dimension, given the start index of the support region in that dimension
+   * and the size of the grid in that dimension. The offsets are wrapped
+   * around the grid, and are in units of the coefficient buffer.
+   */
+  static inline void ComputeSliceOffsets(
+    OffsetValueType * sliceOffsets,
+    const OffsetValueType supportStartIndex,
+    const OffsetValueType gridSize,
+    const OffsetValueType * gridOffsetTable )
+  {
+    OffsetValueType index = supportStartIndex % gridSize;
+    if( index < 0 )
+    {
+      index += gridSize;
+    }
+
+    const OffsetValueType bot = gridOffsetTable[ SpaceDimension - 1 ];
+    for( unsigned int k = 0; k <= SplineOrder; ++k )
+    {
+      sliceOffsets[ k ] = index * bot;
+      if( ++index == gridSize )
+      {
+        index = 0;
+      }
+    }
+  } // end ComputeSliceOffsets()
+
+
+  /** TransformPoint recursive implementation.
+   * mu should point to the start of the support region in the first slice
+   * of the grid, i.e. the offset of the last dimension is not included.
+   */
+  static inline void TransformPoint(
+    OutputPointType opp, const CoefficientPointerVectorType mu,
+    const OffsetValueType * gridOffsetTable,
+    const double * weights1D,
+    const OffsetValueType * sliceOffsets )
+  {
+    /** Create a temporary opp and initialize the original. */
+    ScalarType * tmp_mu[ OutputDimension ];
+    ScalarType   tmp_opp[ OutputDimension ];
+    for( unsigned int j = 0; j < OutputDimension; ++j )
+    {
+      opp[ j ] = 0.0;
+    }
+
+    for( unsigned int k = 0; k <= SplineOrder; ++k )
+    {
+      /** Jump to the (wrapped) slice. */
+      for( unsigned int j = 0; j < OutputDimension; ++j )
+      {
+        tmp_mu[ j ] = mu[ j ] + sliceOffsets[ k ];
+      }
+
+      /** Recurse. */
+      LowerDimensionImplementationType
+        ::TransformPoint( tmp_opp, tmp_mu, gridOffsetTable, weights1D );
+
+      /** Accumulate the weights. */
+      for( unsigned int j = 0; j < OutputDimension; ++j )
+      {
+        opp[ j ] += tmp_opp[ j ] * weights1D[ k + HelperConstVariable ];
+      }
+    }
+  } // end TransformPoint()
+
+
+  /** ComputeNonZeroJacobianIndices recursive implementation.
+   * currentIndex should not include the offset of the last dimension.
+   */
+  static inline void ComputeNonZeroJacobianIndices(
+    unsigned long * & nzji,
+    const unsigned long parametersPerDim,
+    const unsigned long currentIndex,
+    const OffsetValueType * gridOffsetTable,
+    const OffsetValueType * sliceOffsets )
+  {
+    for( unsigned int k = 0; k <= SplineOrder; ++k )
+    {
+      /** Recurse. */
+      LowerDimensionImplementationType
+        ::ComputeNonZeroJacobianIndices( nzji, parametersPerDim,
+        currentIndex + sliceOffsets[ k ], gridOffsetTable );
+    }
+  } // end ComputeNonZeroJacobianIndices()
+
+
+  /** GetSpatialJacobian recursive implementation.
+   * As an (almost) free by-product this function delivers the displacement,
+   * i.e. the TransformPoint() function.
+   */
+  static inline void GetSpatialJacobian(
+    InternalFloatType * sj,
+    const CoefficientPointerVectorType mu,
+    const OffsetValueType * gridOffsetTable,
+    const double * weights1D,                    // normal B-spline weights
+    const double * derivativeWeights1D,          // 1st derivative of B-spline
+    const OffsetValueType * sliceOffsets )
+  {
+    /** Create a temporary sj and initialize the original. */
+    ScalarType *      tmp_mu[ OutputDimension ];
+    InternalFloatType tmp_sj[ OutputDimension * SpaceDimension ];
+    for( unsigned int n = 0; n < OutputDimension * ( SpaceDimension + 1 ); ++n )
+    {
+      sj[ n ] = 0.0;
+    }
+
+    for( unsigned int k = 0; k <= SplineOrder; ++k )
+    {
+      /** Jump to the (wrapped) slice. */
+      for( unsigned int j = 0; j < OutputDimension; ++j )
+      {
+        tmp_mu[ j ] = mu[ j ] + sliceOffsets[ k ];
+      }
+
+      /** Recurse. */
+      LowerDimensionImplementationType
+        ::GetSpatialJacobian( tmp_sj, tmp_mu, gridOffsetTable, weights1D, derivativeWeights1D );
+
+      /** Accumulate the weights part. */
+      for( unsigned int n = 0; n < OutputDimension * SpaceDimension; ++n )
+      {
+        sj[ n ] += tmp_sj[ n ] * weights1D[ k + HelperConstVariable ];
+      }
+
+      /** Accumulate the derivative weights part. */
+      for( unsigned int j = 0; j < OutputDimension; ++j )
+      {
+        sj[ OutputDimension * SpaceDimension + j ]
+          += tmp_sj[ j ] * derivativeWeights1D[ k + HelperConstVariable ];
+      }
+    }
+  } // end GetSpatialJacobian()
+
+
+};
+
+} // end namespace itk
+
+#endif /* __itkRecursiveCyclicBSplineTransformImplementation_h */
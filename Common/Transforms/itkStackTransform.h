@@ -234,6 +234,25 @@ public:
   /** Get number of nonzero Jacobian indices. */
   virtual NumberOfParametersType GetNumberOfNonZeroJacobianIndices( void ) const;
 
+  /** Get the number of parameters of one sub transform. The parameter vector
+   * consists of one block of this size per sub transform, and the nonzero
+   * Jacobian indices of a point all lie in the block of its sub transform.
+   */
+  virtual NumberOfParametersType GetNumberOfParametersPerSubTransform( void ) const
+  {
+    if( this->m_SubTransformContainer.size() == 0 )
+    {
+      return 0;
+    }
+    return this->m_SubTransformContainer[ 0 ]->GetNumberOfParameters();
+  }
+
+
+  /** Get the index of the sub transform that maps the input point, based
+   * on its last coordinate, the stack origin and the stack spacing.
+   */
+  virtual unsigned int GetSubTransformIndex( const InputPointType & ipp ) const;
+
   /** Must be provided. */
   virtual void GetSpatialJacobian(
     const InputPointType & ipp, SpatialJacobianType & sj ) const
@@ -114,10 +114,7 @@ StackTransform< TScalarType, NInputDimensions, NOutputDimensions >
 
   /** Transform point using right subtransform. */
   SubTransformOutputPointType oppr;
-  const unsigned int          subt
-    = vnl_math_min( this->m_NumberOfSubTransforms - 1, static_cast< unsigned int >(
-      vnl_math_max( 0,
-      vnl_math_rnd( ( ipp[ ReducedInputSpaceDimension ] - m_StackOrigin ) / m_StackSpacing ) ) ) );
+  const unsigned int          subt = this->GetSubTransformIndex( ipp );
   oppr = this->m_SubTransformContainer[ subt ]->TransformPoint( ippr );
 
   /** Increase dimension of input point. */
@@ -153,10 +150,7 @@ StackTransform< TScalarType, NInputDimensions, NOutputDimensions >
   }
 
   /** Get Jacobian from right subtransform. */
-  const unsigned int subt
-    = vnl_math_min( this->m_NumberOfSubTransforms - 1, static_cast< unsigned int >(
-      vnl_math_max( 0,
-      vnl_math_rnd( ( ipp[ ReducedInputSpaceDimension ] - m_StackOrigin ) / m_StackSpacing ) ) ) );
+  const unsigned int       subt = this->GetSubTransformIndex( ipp );
   SubTransformJacobianType subjac;
   this->m_SubTransformContainer[ subt ]->GetJacobian( ippr, subjac, nzji );
 
@@ -180,6 +174,22 @@ StackTransform< TScalarType, NInputDimensions, NOutputDimensions >
 } // end GetJacobian()
 
 
+/**
+ * ********************* GetSubTransformIndex ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+unsigned int
+StackTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::GetSubTransformIndex( const InputPointType & ipp ) const
+{
+  return vnl_math_min( this->m_NumberOfSubTransforms - 1, static_cast< unsigned int >(
+    vnl_math_max( 0,
+    vnl_math_rnd( ( ipp[ ReducedInputSpaceDimension ] - m_StackOrigin ) / m_StackSpacing ) ) ) );
+
+} // end GetSubTransformIndex()
+
+
 /**
  * ********************* GetNumberOfNonZeroJacobianIndices ****************************
  */
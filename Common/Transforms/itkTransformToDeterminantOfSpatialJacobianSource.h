@@ -61,6 +61,12 @@ namespace itk
  *
  * This filter is implemented as a multithreaded filter.  It provides a
  * ThreadedGenerateData() method for its implementation.
+ * The output is computed scanline by scanline, and only for the requested
+ * region, so that the filter can be used in a streaming pipeline. The
+ * transform is evaluated point by point, also for B-spline transforms: the
+ * transform is in general a combination with an initial transform, for which
+ * a scanline of the output is not a scanline of the B-spline grid, so the
+ * B-spline weights of a scanline cannot be reused.
  *
  * \author Marius Staring, Leiden University Medical Center, The Netherlands.
  *
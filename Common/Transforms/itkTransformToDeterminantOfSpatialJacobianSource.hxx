@@ -38,7 +38,7 @@
 
 #include "itkAdvancedIdentityTransform.h"
 #include "itkProgressReporter.h"
-#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageLinearIteratorWithIndex.h"
 #include "vnl/vnl_det.h"
 
 namespace itk
@@ -244,9 +244,11 @@ TransformToDeterminantOfSpatialJacobianSource< TOutputImage, TTransformPrecision
   // Get the output pointer
   OutputImagePointer outputPtr = this->GetOutput();
 
-  // Create an iterator that will walk the output region for this thread.
-  typedef ImageRegionIteratorWithIndex< TOutputImage > OutputIteratorType;
+  // Create an iterator that will walk the output region for this thread
+  // scanline by scanline.
+  typedef ImageLinearIteratorWithIndex< TOutputImage > OutputIteratorType;
   OutputIteratorType it( outputPtr, outputRegionForThread );
+  it.SetDirection( 0 );
   it.GoToBegin();
 
   // pixel coordinates
@@ -255,22 +257,28 @@ TransformToDeterminantOfSpatialJacobianSource< TOutputImage, TTransformPrecision
   // Support for progress methods/callbacks
   ProgressReporter progress( this, threadId, outputRegionForThread.GetNumberOfPixels() );
 
+  SpatialJacobianType sj;
+
   // Walk the output region
   while( !it.IsAtEnd() )
   {
-    // Determine the coordinates of the current voxel
-    outputPtr->TransformIndexToPhysicalPoint( it.GetIndex(), point );
+    while( !it.IsAtEndOfLine() )
+    {
+      // Determine the coordinates of the current voxel from its index,
+      // so that the rounding errors do not accumulate along the scanline.
+      outputPtr->TransformIndexToPhysicalPoint( it.GetIndex(), point );
 
-    SpatialJacobianType sj;
-    this->m_Transform->GetSpatialJacobian( point, sj );
-    const PixelType detjac = static_cast< PixelType >( vnl_det( sj.GetVnlMatrix() ) );
+      this->m_Transform->GetSpatialJacobian( point, sj );
+      const PixelType detjac = static_cast< PixelType >( vnl_det( sj.GetVnlMatrix() ) );
 
-    // Set it
-    it.Set( detjac );
+      // Set it
+      it.Set( detjac );
 
-    // Update progress and iterator
-    progress.CompletedPixel();
-    ++it;
+      // Update progress and iterator
+      progress.CompletedPixel();
+      ++it;
+    }
+    it.NextLine();
   }
 
 } // end NonlinearThreadedGenerateData()
@@ -323,7 +331,6 @@ TransformToDeterminantOfSpatialJacobianSource< TOutputImage, TTransformPrecision
   outputPtr->SetSpacing( m_OutputSpacing );
   outputPtr->SetOrigin( m_OutputOrigin );
   outputPtr->SetDirection( m_OutputDirection );
-  outputPtr->Allocate();
 
 } // end GenerateOutputInformation()
 
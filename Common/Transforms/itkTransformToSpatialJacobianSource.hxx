@@ -22,7 +22,7 @@
 
 #include "itkAdvancedIdentityTransform.h"
 #include "itkProgressReporter.h"
-#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageLinearIteratorWithIndex.h"
 #include "vnl/vnl_copy.h"
 
 namespace itk
@@ -239,9 +239,11 @@ TransformToSpatialJacobianSource< TOutputImage, TTransformPrecisionType >
   // Get the output pointer
   OutputImagePointer outputPtr = this->GetOutput();
 
-  // Create an iterator that will walk the output region for this thread.
-  typedef ImageRegionIteratorWithIndex< TOutputImage > OutputIteratorType;
+  // Create an iterator that will walk the output region for this thread
+  // scanline by scanline.
+  typedef ImageLinearIteratorWithIndex< TOutputImage > OutputIteratorType;
   OutputIteratorType it( outputPtr, outputRegionForThread );
+  it.SetDirection( 0 );
   it.GoToBegin();
 
   // pixel coordinates
@@ -257,21 +259,26 @@ TransformToSpatialJacobianSource< TOutputImage, TTransformPrecisionType >
   // Walk the output region
   while( !it.IsAtEnd() )
   {
-    // Determine the coordinates of the current voxel
-    outputPtr->TransformIndexToPhysicalPoint( it.GetIndex(), point );
+    while( !it.IsAtEndOfLine() )
+    {
+      // Determine the coordinates of the current voxel from its index,
+      // so that the rounding errors do not accumulate along the scanline.
+      outputPtr->TransformIndexToPhysicalPoint( it.GetIndex(), point );
 
-    this->m_Transform->GetSpatialJacobian( point, sj );
+      this->m_Transform->GetSpatialJacobian( point, sj );
 
-    // cast spatial jacobian to output pixel type
-    vnl_copy( sj.GetVnlMatrix().begin(), sjOut.GetVnlMatrix().begin(),
-      nrElements );
+      // cast spatial jacobian to output pixel type
+      vnl_copy( sj.GetVnlMatrix().begin(), sjOut.GetVnlMatrix().begin(),
+        nrElements );
 
-    // Set it
-    it.Set( sjOut );
+      // Set it
+      it.Set( sjOut );
 
-    // Update progress and iterator
-    progress.CompletedPixel();
-    ++it;
+      // Update progress and iterator
+      progress.CompletedPixel();
+      ++it;
+    }
+    it.NextLine();
   }
 
 } // end NonlinearThreadedGenerateData()
@@ -330,7 +337,6 @@ TransformToSpatialJacobianSource< TOutputImage, TTransformPrecisionType >
   outputPtr->SetSpacing( m_OutputSpacing );
   outputPtr->SetOrigin( m_OutputOrigin );
   outputPtr->SetDirection( m_OutputDirection );
-  outputPtr->Allocate();
 
 } // end GenerateOutputInformation()
 
@@ -20,6 +20,9 @@
 
 #include "itkObject.h"
 #include "itkArray.h"
+#include "itkMultiThreader.h"
+
+#include <vector>
 
 namespace itk
 {
@@ -33,6 +36,22 @@ namespace itk
  * on a denser grid. Therefore, the user needs to supply the old B-spline grid
  * (region, spacing, origin, direction), and the required B-spline grid.
  *
+ * By default the deformation field is sampled at the new control points,
+ * followed by a B-spline decomposition. If UseTwoScaleRelation is set to
+ * true, and the required grid is an integer refinement of the current grid
+ * (same direction, integer spacing ratio, and the knots of the current grid
+ * are also knots of the required grid), the new coefficients are computed
+ * directly from the old ones, using the two-scale relation of the B-spline:
+ *
+ *   beta^n( x ) = sum_k h_k beta^n( M x + (n+1)(M-1)/2 - k ),
+ *
+ * with M the refinement factor and h the binomial refinement mask. This
+ * representation is exact, needs no intermediate images, and is computed
+ * multi-threaded. Coefficients outside the current grid are assumed zero,
+ * as in the B-spline transform itself, so near the border of the grid the
+ * result is different from the default, which assumes mirror boundary
+ * conditions. Inside the valid region of the required grid both are the same.
+ * When the grids are not aligned the default method is used.
  */
 
 template< class TArray, class TImage >
@@ -94,6 +113,17 @@ public:
   /** Set the B-spline order. */
   itkSetMacro( BSplineOrder, unsigned int );
 
+  /** Use the two-scale relation when the grids are aligned. Default false. */
+  itkSetMacro( UseTwoScaleRelation, bool );
+  itkGetConstMacro( UseTwoScaleRelation, bool );
+  itkBooleanMacro( UseTwoScaleRelation );
+
+  /** Set the number of threads used by the two-scale relation. */
+  void SetNumberOfThreads( ThreadIdType numberOfThreads )
+  {
+    this->m_Threader->SetNumberOfThreads( numberOfThreads );
+  }
+
   /** Compute the output parameter array. */
   virtual void UpsampleParameters( const ArrayType & param_in,
     ArrayType & param_out );
@@ -112,6 +142,15 @@ protected:
   /** Function that checks if upsampling is required. */
   virtual bool DoUpsampling( void );
 
+  /** Function that checks if the two-scale relation can be used, and if so
+   * computes the one-dimensional refinement weights for each dimension.
+   */
+  virtual bool ComputeTwoScaleWeights( void );
+
+  /** Typedefs for multi-threading. */
+  typedef itk::MultiThreader             ThreaderType;
+  typedef ThreaderType::ThreadInfoStruct ThreadInfoType;
+
 private:
 
   UpsampleBSplineParametersFilter( const Self & ); // purposely not implemented
@@ -127,6 +166,33 @@ private:
   DirectionType m_RequiredGridDirection;
   RegionType    m_RequiredGridRegion;
   unsigned int  m_BSplineOrder;
+  bool          m_UseTwoScaleRelation;
+
+  /** For each dimension and each index of the required grid, the indices of
+   * the supporting coefficients of the current grid and their weights. Zero
+   * weights mark coefficients outside the current grid.
+   */
+  typedef std::vector< OffsetValueType > TwoScaleIndicesType;
+  typedef std::vector< double >          TwoScaleWeightsType;
+  TwoScaleIndicesType m_TwoScaleIndices[ Dimension ];
+  TwoScaleWeightsType m_TwoScaleWeights[ Dimension ];
+  unsigned int        m_TwoScaleSupportSize[ Dimension ];
+
+  /** Multi-threaded two-scale upsampling. */
+  ThreaderType::Pointer m_Threader;
+  struct MultiThreaderParameterType
+  {
+    const ArrayType * t_ParametersIn;
+    ArrayType *       t_ParametersOut;
+    Self *            t_Filter;
+  };
+
+  /** The callback function. */
+  static ITK_THREAD_RETURN_TYPE UpsampleParametersThreaderCallback( void * arg );
+
+  /** The threaded implementation of the two-scale upsampling. */
+  void ThreadedUpsampleParameters( ThreadIdType threadId, ThreadIdType numberOfThreads,
+    const ArrayType & parameters_in, ArrayType & parameters_out );
 
 };
 
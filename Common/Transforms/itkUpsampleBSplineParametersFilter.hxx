@@ -35,7 +35,13 @@ template< class TArray, class TImage >
 UpsampleBSplineParametersFilter< TArray, TImage >
 ::UpsampleBSplineParametersFilter()
 {
-  this->m_BSplineOrder = 3;
+  this->m_BSplineOrder        = 3;
+  this->m_UseTwoScaleRelation = false;
+  this->m_Threader            = ThreaderType::New();
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    this->m_TwoScaleSupportSize[ i ] = 0;
+  }
 
   // Initialize grid settings.
   this->m_CurrentGridOrigin.Fill( 0.0 );
@@ -64,6 +70,26 @@ UpsampleBSplineParametersFilter< TArray, TImage >
     return;
   }
 
+  /** Use the direct two-scale relation if possible. */
+  if( this->m_UseTwoScaleRelation && this->ComputeTwoScaleWeights() )
+  {
+    parameters_out.SetSize(
+      this->m_RequiredGridRegion.GetNumberOfPixels() * Dimension );
+
+    /** Fill the threader parameter struct with information. */
+    MultiThreaderParameterType * temp = new  MultiThreaderParameterType;
+    temp->t_ParametersIn  = &parameters_in;
+    temp->t_ParametersOut = &parameters_out;
+    temp->t_Filter        = this;
+
+    /** Call multi-threaded UpsampleParameters(). */
+    this->m_Threader->SetSingleMethod( UpsampleParametersThreaderCallback, (void *)( temp ) );
+    this->m_Threader->SingleMethodExecute();
+
+    delete temp;
+    return;
+  }
+
   /** Typedefs. */
   typedef itk::ResampleImageFilter<
     ImageType, ImageType >                        UpsampleFilterType;
@@ -183,6 +209,220 @@ UpsampleBSplineParametersFilter< TArray, TImage >
 } // end DoUpsampling()
 
 
+/**
+ * ******************* ComputeTwoScaleWeights *******************
+ */
+
+template< class TArray, class TImage >
+bool
+UpsampleBSplineParametersFilter< TArray, TImage >
+::ComputeTwoScaleWeights( void )
+{
+  const double tolerance = 1e-4;
+
+  /** The grids should have the same direction. */
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      if( vcl_abs( this->m_CurrentGridDirection[ i ][ j ]
+        - this->m_RequiredGridDirection[ i ][ j ] ) > tolerance )
+      {
+        return false;
+      }
+    }
+  }
+
+  /** The B-spline refinement mask for factor M is the (n+1)-fold
+   * convolution of a box of width M, divided by M^n.
+   */
+  const unsigned int n = this->m_BSplineOrder;
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    /** The spacing ratio should be a positive integer. */
+    const double ratio
+      = this->m_CurrentGridSpacing[ d ] / this->m_RequiredGridSpacing[ d ];
+    const long M = static_cast< long >( vnl_math_rnd( ratio ) );
+    if( M < 1 || vcl_abs( ratio - M ) > tolerance ) { return false; }
+
+    /** The position of the first required grid point in the continuous
+     * buffer index of the current grid. The direction cosines are orthonormal.
+     */
+    double p0 = 0.0;
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      p0 += this->m_CurrentGridDirection[ i ][ d ]
+        * ( this->m_RequiredGridOrigin[ i ] - this->m_CurrentGridOrigin[ i ] );
+    }
+    p0 = p0 / this->m_CurrentGridSpacing[ d ]
+      + static_cast< double >( this->m_RequiredGridRegion.GetIndex()[ d ] ) / M
+      - static_cast< double >( this->m_CurrentGridRegion.GetIndex()[ d ] );
+
+    /** The knots of the current grid should be knots of the required grid. */
+    const long   K  = static_cast< long >( ( n + 1 ) * ( M - 1 ) );
+    const double qd = M * p0 + 0.5 * K;
+    const long   q  = static_cast< long >( vnl_math_rnd( qd ) );
+    if( vcl_abs( qd - q ) > tolerance ) { return false; }
+
+    /** Compute the refinement mask h of length K + 1. */
+    std::vector< double > mask( 1, 1.0 );
+    for( unsigned int c = 0; c < n + 1; ++c )
+    {
+      std::vector< double > tmp( mask.size() + M - 1, 0.0 );
+      for( std::size_t k = 0; k < mask.size(); ++k )
+      {
+        for( long m = 0; m < M; ++m ) { tmp[ k + m ] += mask[ k ]; }
+      }
+      mask.swap( tmp );
+    }
+    const double scale = 1.0 / vcl_pow( static_cast< double >( M ), static_cast< double >( n ) );
+
+    /** For each required index j the coefficient is sum_i c_i h_{j+q-Mi},
+     * with i ranging over the current grid.
+     */
+    const long         currentSize  = this->m_CurrentGridRegion.GetSize()[ d ];
+    const long         requiredSize = this->m_RequiredGridRegion.GetSize()[ d ];
+    const unsigned int supportSize  = static_cast< unsigned int >( K / M + 1 );
+    this->m_TwoScaleSupportSize[ d ] = supportSize;
+    this->m_TwoScaleIndices[ d ].assign( requiredSize * supportSize, 0 );
+    this->m_TwoScaleWeights[ d ].assign( requiredSize * supportSize, 0.0 );
+
+    for( long j = 0; j < requiredSize; ++j )
+    {
+      /** The smallest i with j + q - M i <= K. */
+      const long num  = j + q - K;
+      const long imin = num >= 0 ? ( num + M - 1 ) / M : -( ( -num ) / M );
+      for( unsigned int w = 0; w < supportSize; ++w )
+      {
+        const long i = imin + w;
+        const long k = j + q - M * i;
+        if( i < 0 || i >= currentSize || k < 0 || k > K ) { continue; }
+        this->m_TwoScaleIndices[ d ][ j * supportSize + w ] = i;
+        this->m_TwoScaleWeights[ d ][ j * supportSize + w ] = scale * mask[ k ];
+      }
+    }
+  }
+
+  return true;
+
+} // end ComputeTwoScaleWeights()
+
+
+/**
+ * ******************* UpsampleParametersThreaderCallback *******************
+ */
+
+template< class TArray, class TImage >
+ITK_THREAD_RETURN_TYPE
+UpsampleBSplineParametersFilter< TArray, TImage >
+::UpsampleParametersThreaderCallback( void * arg )
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType *             infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType                 threadID   = infoStruct->ThreadID;
+  ThreadIdType                 nrOfThreads = infoStruct->NumberOfThreads;
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  /** Call the real implementation. */
+  temp->t_Filter->ThreadedUpsampleParameters( threadID, nrOfThreads,
+    *( temp->t_ParametersIn ), *( temp->t_ParametersOut ) );
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end UpsampleParametersThreaderCallback()
+
+
+/**
+ * ******************* ThreadedUpsampleParameters *******************
+ */
+
+template< class TArray, class TImage >
+void
+UpsampleBSplineParametersFilter< TArray, TImage >
+::ThreadedUpsampleParameters( ThreadIdType threadId, ThreadIdType numberOfThreads,
+  const ArrayType & parameters_in, ArrayType & parameters_out )
+{
+  const SizeValueType currentNumberOfPixels
+    = this->m_CurrentGridRegion.GetNumberOfPixels();
+  const SizeValueType requiredNumberOfPixels
+    = this->m_RequiredGridRegion.GetNumberOfPixels();
+
+  /** Strides in the current grid. */
+  SizeValueType currentStrides[ Dimension ];
+  currentStrides[ 0 ] = 1;
+  for( unsigned int d = 1; d < Dimension; ++d )
+  {
+    currentStrides[ d ] = currentStrides[ d - 1 ]
+      * this->m_CurrentGridRegion.GetSize()[ d - 1 ];
+  }
+
+  /** Compute the range of required grid points for this thread. */
+  const SizeValueType chunk
+    = ( requiredNumberOfPixels + numberOfThreads - 1 ) / numberOfThreads;
+  const SizeValueType jmin = threadId * chunk;
+  const SizeValueType jmax = vnl_math_min( jmin + chunk, requiredNumberOfPixels );
+
+  const ValueType * in  = parameters_in.data_block();
+  ValueType *       out = parameters_out.data_block();
+
+  unsigned int  j[ Dimension ];
+  unsigned int  w[ Dimension ];
+  ValueType     value[ Dimension ];
+  for( SizeValueType jj = jmin; jj < jmax; ++jj )
+  {
+    /** Get the index in the required grid. */
+    SizeValueType rest = jj;
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      const SizeValueType size = this->m_RequiredGridRegion.GetSize()[ d ];
+      j[ d ] = static_cast< unsigned int >( rest % size );
+      rest  /= size;
+      w[ d ] = 0;
+    }
+    std::fill( value, value + Dimension, NumericTraits< ValueType >::ZeroValue() );
+
+    /** Loop over the tensor product of the 1D supports. The weights are
+     * shared between the Dimension coefficient images.
+     */
+    bool done = false;
+    while( !done )
+    {
+      double        weight = 1.0;
+      SizeValueType offset = 0;
+      for( unsigned int d = 0; d < Dimension && weight != 0.0; ++d )
+      {
+        const std::size_t pos = j[ d ] * this->m_TwoScaleSupportSize[ d ] + w[ d ];
+        weight *= this->m_TwoScaleWeights[ d ][ pos ];
+        offset += this->m_TwoScaleIndices[ d ][ pos ] * currentStrides[ d ];
+      }
+
+      if( weight != 0.0 )
+      {
+        for( unsigned int c = 0; c < Dimension; ++c )
+        {
+          value[ c ] += weight * in[ c * currentNumberOfPixels + offset ];
+        }
+      }
+
+      /** Next support point. */
+      done = true;
+      for( unsigned int d = 0; d < Dimension; ++d )
+      {
+        if( ++w[ d ] < this->m_TwoScaleSupportSize[ d ] ) { done = false; break; }
+        w[ d ] = 0;
+      }
+    }
+
+    for( unsigned int c = 0; c < Dimension; ++c )
+    {
+      out[ c * requiredNumberOfPixels + jj ] = value[ c ];
+    }
+  }
+
+} // end ThreadedUpsampleParameters()
+
+
 /**
  * ******************* PrintSelf *******************
  */
@@ -205,6 +445,7 @@ UpsampleBSplineParametersFilter< TArray, TImage >
   os << indent << "RequiredGridRegion: "  << this->m_RequiredGridRegion << std::endl;
 
   os << indent << "BSplineOrder: " << this->m_BSplineOrder << std::endl;
+  os << indent << "UseTwoScaleRelation: " << this->m_UseTwoScaleRelation << std::endl;
 
 } // end PrintSelf()
 
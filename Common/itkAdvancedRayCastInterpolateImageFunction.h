@@ -48,6 +48,9 @@ namespace itk
  * image and uses bilinear interpolation to integrate each plane of
  * voxels traversed.
  *
+ * The geometry of the volume, its bounding planes and corners, is computed
+ * once by SetInputImage() and reused by every call of Evaluate().
+ *
  * \warning This interpolator works for 3-dimensional images only.
  *
  * \ingroup ImageFunctions
@@ -118,6 +121,11 @@ public:
   /** ContinuousIndex typedef support. */
   typedef typename Superclass::ContinuousIndexType ContinuousIndexType;
 
+  /** Set the input image, and compute the geometry of the volume that is
+   * used by Evaluate().
+   */
+  virtual void SetInputImage( const InputImageType * ptr );
+
   /** \brief
    * Interpolate the image at a point position.
    *
@@ -208,6 +216,20 @@ protected:
   /// Pointer to the interpolator
   InterpolatorPointer m_Interpolator;
 
+  /** The geometry of the volume of the input image, computed by
+   * SetInputImage(). It is used by Evaluate() while the size and spacing
+   * of the input image are unchanged.
+   */
+  struct VolumeGeometryType
+  {
+    bool                                 st_IsValid;
+    SizeType                             st_Size;
+    typename InputImageType::SpacingType st_Spacing;
+    double                               st_BoundingPlane[ 6 ][ 4 ];
+    double                               st_BoundingCorner[ 8 ][ 3 ];
+  };
+  VolumeGeometryType m_VolumeGeometry;
+
 private:
 
   AdvancedRayCastInterpolateImageFunction( const Self & ); // purposely not implemented
@@ -167,6 +167,17 @@ public:
   /// Initialise the object
   void Initialise( void );
 
+  /** Initialise the object with the planes and corners of the volume that
+   * a previous Initialise() computed for an image with the same size and
+   * spacing, see GetBoundingPlanesAndCorners().
+   */
+  void Initialise( const double boundingPlane[ 6 ][ 4 ],
+    const double boundingCorner[ 8 ][ 3 ] );
+
+  /// Get the planes and corners of the volume, computed by Initialise()
+  void GetBoundingPlanesAndCorners( double boundingPlane[ 6 ][ 4 ],
+    double boundingCorner[ 8 ][ 3 ] ) const;
+
 protected:
 
   /// Calculate the endpoint coordinats of the ray in voxels.
@@ -349,6 +360,64 @@ RayCastHelper< TInputImage, TCoordRep >
 }
 
 
+/* -----------------------------------------------------------------------
+   Initialise() - Initialise the object with a precomputed volume geometry
+   ----------------------------------------------------------------------- */
+
+template< class TInputImage, class TCoordRep >
+void
+RayCastHelper< TInputImage, TCoordRep >
+::Initialise( const double boundingPlane[ 6 ][ 4 ],
+  const double boundingCorner[ 8 ][ 3 ] )
+{
+  // Save the dimensions of the volume
+  this->RecordVolumeDimensions();
+
+  // Copy the planes and corners which define the volume.
+  for( int j = 0; j < 6; j++ )
+  {
+    for( int k = 0; k < 4; k++ )
+    {
+      m_BoundingPlane[ j ][ k ] = boundingPlane[ j ][ k ];
+    }
+  }
+  for( int j = 0; j < 8; j++ )
+  {
+    for( int k = 0; k < 3; k++ )
+    {
+      m_BoundingCorner[ j ][ k ] = boundingCorner[ j ][ k ];
+    }
+  }
+}
+
+
+/* -----------------------------------------------------------------------
+   GetBoundingPlanesAndCorners() - Get the planes and corners of the volume
+   ----------------------------------------------------------------------- */
+
+template< class TInputImage, class TCoordRep >
+void
+RayCastHelper< TInputImage, TCoordRep >
+::GetBoundingPlanesAndCorners( double boundingPlane[ 6 ][ 4 ],
+  double boundingCorner[ 8 ][ 3 ] ) const
+{
+  for( int j = 0; j < 6; j++ )
+  {
+    for( int k = 0; k < 4; k++ )
+    {
+      boundingPlane[ j ][ k ] = m_BoundingPlane[ j ][ k ];
+    }
+  }
+  for( int j = 0; j < 8; j++ )
+  {
+    for( int k = 0; k < 3; k++ )
+    {
+      boundingCorner[ j ][ k ] = m_BoundingCorner[ j ][ k ];
+    }
+  }
+}
+
+
 /* -----------------------------------------------------------------------
    RecordVolumeDimensions() - Record volume dimensions and resolution
    ----------------------------------------------------------------------- */
@@ -1524,6 +1593,38 @@ AdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
   m_FocalPoint[ 0 ] = 0.;
   m_FocalPoint[ 1 ] = 0.;
   m_FocalPoint[ 2 ] = 0.;
+
+  m_VolumeGeometry.st_IsValid = false;
+}
+
+
+/* -----------------------------------------------------------------------
+   SetInputImage - Set the input image and compute its volume geometry
+   ----------------------------------------------------------------------- */
+
+template< class TInputImage, class TCoordRep >
+void
+AdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
+::SetInputImage( const InputImageType * ptr )
+{
+  this->Superclass::SetInputImage( ptr );
+
+  m_VolumeGeometry.st_IsValid = false;
+  if( ptr == 0 )
+  {
+    return;
+  }
+
+  RayCastHelper< TInputImage, TCoordRep > ray;
+  ray.SetImage( ptr );
+  ray.ZeroState();
+  ray.Initialise();
+  ray.GetBoundingPlanesAndCorners( m_VolumeGeometry.st_BoundingPlane,
+    m_VolumeGeometry.st_BoundingCorner );
+
+  m_VolumeGeometry.st_Size    = ptr->GetLargestPossibleRegion().GetSize();
+  m_VolumeGeometry.st_Spacing = ptr->GetSpacing();
+  m_VolumeGeometry.st_IsValid = true;
 }
 
 
@@ -1563,10 +1664,22 @@ AdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
 
   DirectionType direction = transformedFocalPoint - point;
 
+  /** The volume geometry of SetInputImage() is reused, unless the size or
+   * spacing of the image changed since.
+   */
   RayCastHelper< TInputImage, TCoordRep > ray;
   ray.SetImage( this->m_Image );
   ray.ZeroState();
-  ray.Initialise();
+  if( m_VolumeGeometry.st_IsValid
+    && m_VolumeGeometry.st_Size == this->m_Image->GetLargestPossibleRegion().GetSize()
+    && m_VolumeGeometry.st_Spacing == this->m_Image->GetSpacing() )
+  {
+    ray.Initialise( m_VolumeGeometry.st_BoundingPlane, m_VolumeGeometry.st_BoundingCorner );
+  }
+  else
+  {
+    ray.Initialise();
+  }
 
   ray.SetRay( point, direction );
   ray.IntegrateAboveThreshold( integral, m_Threshold );
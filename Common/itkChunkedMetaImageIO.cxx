@@ -0,0 +1,210 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkChunkedMetaImageIO.h"
+#include "itkByteSwapper.h"
+#include "itkMultiThreader.h"
+#include "itksys/SystemTools.hxx"
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+ChunkedMetaImageIO
+::ChunkedMetaImageIO()
+{
+  this->m_NumberOfThreads      = MultiThreader::GetGlobalDefaultNumberOfThreads();
+  this->m_ReadChunksInParallel = false;
+
+} // end Constructor
+
+
+/**
+ * ******************* ReadHeaderFields *******************
+ */
+
+bool
+ChunkedMetaImageIO
+::ReadHeaderFields( HeaderFieldsType & fields ) const
+{
+  std::ifstream header( this->GetFileName() );
+  if( !header.is_open() )
+  {
+    return false;
+  }
+
+  /** The fields have the form "Name = Value"; ElementDataFile is the last one. */
+  std::string line;
+  while( std::getline( header, line ) )
+  {
+    const std::string::size_type equals = line.find( '=' );
+    if( equals == std::string::npos )
+    {
+      continue;
+    }
+    const std::string name  = itksys::SystemTools::TrimWhitespace( line.substr( 0, equals ) );
+    const std::string value = itksys::SystemTools::TrimWhitespace( line.substr( equals + 1 ) );
+    fields[ name ] = value;
+    if( name == "ElementDataFile" )
+    {
+      return true;
+    }
+  }
+  return false;
+
+} // end ReadHeaderFields()
+
+
+/**
+ * ******************* GetChunkTable *******************
+ */
+
+bool
+ChunkedMetaImageIO
+::GetChunkTable( const HeaderFieldsType & fields,
+  SizeValueType & chunkLength, ChunkSizesType & compressedChunkSizes ) const
+{
+  HeaderFieldsType::const_iterator field = fields.find( "CompressedDataChunkLength" );
+  if( field == fields.end() )
+  {
+    return false;
+  }
+  std::istringstream lengthStream( field->second );
+  if( !( lengthStream >> chunkLength ) || chunkLength == 0 )
+  {
+    return false;
+  }
+
+  /** The table is split over the fields CompressedDataChunkSizes_k. */
+  compressedChunkSizes.clear();
+  for( unsigned int k = 0;; ++k )
+  {
+    std::ostringstream name;
+    name << "CompressedDataChunkSizes_" << k;
+    field = fields.find( name.str() );
+    if( field == fields.end() )
+    {
+      break;
+    }
+    std::istringstream sizesStream( field->second );
+    SizeValueType      size = 0;
+    while( sizesStream >> size )
+    {
+      compressedChunkSizes.push_back( size );
+    }
+  }
+  return !compressedChunkSizes.empty();
+
+} // end GetChunkTable()
+
+
+/**
+ * ******************* Read *******************
+ */
+
+void
+ChunkedMetaImageIO
+::Read( void * buffer )
+{
+  this->m_ReadChunksInParallel = false;
+
+  /** Check for a chunk table, a separate data file and a full read. */
+  HeaderFieldsType fields;
+  SizeValueType    chunkLength = 0;
+  ChunkSizesType   compressedChunkSizes;
+  const bool       chunked = this->ReadHeaderFields( fields )
+    && this->GetChunkTable( fields, chunkLength, compressedChunkSizes )
+    && fields[ "CompressedData" ] == "True"
+    && fields[ "ElementDataFile" ] != "LOCAL"
+    && fields[ "ElementDataFile" ] != "LIST"
+    && this->GetIORegion().GetNumberOfPixels() == this->GetImageSizeInPixels()
+    && ( this->GetByteOrder() == ImageIOBase::BigEndian )
+    == ByteSwapper< int >::SystemIsBigEndian();
+  if( !chunked )
+  {
+    this->Superclass::Read( buffer );
+    return;
+  }
+
+  /** The data file is relative to the header. */
+  std::string dataFileName = fields[ "ElementDataFile" ];
+  if( !itksys::SystemTools::FileIsFullPath( dataFileName.c_str() ) )
+  {
+    const std::string path = itksys::SystemTools::GetFilenamePath( this->GetFileName() );
+    if( !path.empty() )
+    {
+      dataFileName = path + "/" + dataFileName;
+    }
+  }
+
+  /** Read the compressed stream. */
+  std::ifstream dataFile( dataFileName.c_str(), std::ios::in | std::ios::binary );
+  if( !dataFile.is_open() )
+  {
+    itkExceptionMacro( << "The file " << dataFileName << " could not be opened for reading." );
+  }
+  dataFile.seekg( 0, std::ios::end );
+  const SizeValueType streamSize = static_cast< SizeValueType >( dataFile.tellg() );
+  dataFile.seekg( 0, std::ios::beg );
+  std::vector< ByteType > stream( streamSize );
+  if( streamSize > 0 )
+  {
+    dataFile.read( reinterpret_cast< char * >( &stream[ 0 ] ), streamSize );
+  }
+  if( streamSize == 0 || dataFile.gcount() != static_cast< std::streamsize >( streamSize ) )
+  {
+    itkExceptionMacro( << "The file " << dataFileName << " could not be read." );
+  }
+
+  /** Decompress the chunks in parallel, and verify the checksum. */
+  if( !ChunkedZlibCodec::DecompressChunks( &stream[ 0 ], streamSize, chunkLength,
+    compressedChunkSizes, buffer, this->GetImageSizeInBytes(), this->m_NumberOfThreads ) )
+  {
+    itkExceptionMacro( << "The chunked compressed data of " << dataFileName
+                       << " is corrupt, or does not match the chunk table of "
+                       << this->GetFileName() << "." );
+  }
+  this->m_ReadChunksInParallel = true;
+
+} // end Read()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+void
+ChunkedMetaImageIO
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "NumberOfThreads: " << this->m_NumberOfThreads << std::endl;
+  os << indent << "ReadChunksInParallel: " << this->m_ReadChunksInParallel << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
@@ -0,0 +1,106 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkChunkedMetaImageIO_h
+#define __itkChunkedMetaImageIO_h
+
+#include "itkMetaImageIO.h"
+#include "itkChunkedZlibCodec.h"
+
+#include <map>
+#include <string>
+
+namespace itk
+{
+
+/** \class ChunkedMetaImageIO
+ * \brief A MetaImageIO that decompresses chunked compressed data in parallel.
+ *
+ * The ImageFileCastWriter can write the compressed data of a MetaImage in
+ * independently compressed chunks, and lists the chunk sizes in the header,
+ * in the field CompressedDataChunkLength and the fields
+ * CompressedDataChunkSizes_0, CompressedDataChunkSizes_1, etc. When the
+ * header of the file contains this chunk table, Read() decompresses the chunks
+ * in parallel with ChunkedZlibCodec::DecompressChunks(), which verifies the
+ * Adler-32 checksum of the stream by combining the checksums of the chunks.
+ *
+ * All other files, and reads of a part of a chunked file, are passed on to
+ * the MetaImageIO, which decompresses serially. The same holds for a chunked
+ * file of which the byte order differs from the byte order of this system.
+ *
+ * \ingroup ImageIO
+ */
+
+class ChunkedMetaImageIO : public MetaImageIO
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef ChunkedMetaImageIO         Self;
+  typedef MetaImageIO                Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( ChunkedMetaImageIO, MetaImageIO );
+
+  /** Typedefs. */
+  typedef ChunkedZlibCodec::ByteType       ByteType;
+  typedef ChunkedZlibCodec::ChunkSizesType ChunkSizesType;
+
+  /** Set/Get the number of threads that decompress the chunks. */
+  itkSetClampMacro( NumberOfThreads, ThreadIdType, 1, ITK_MAX_THREADS );
+  itkGetConstMacro( NumberOfThreads, ThreadIdType );
+
+  /** Get whether the last call to Read() decompressed the chunks in parallel. */
+  itkGetConstMacro( ReadChunksInParallel, bool );
+
+  /** Read the image data, in parallel if the file has a chunk table. */
+  virtual void Read( void * buffer );
+
+protected:
+
+  ChunkedMetaImageIO();
+  virtual ~ChunkedMetaImageIO() {}
+
+  void PrintSelf( std::ostream & os, Indent indent ) const;
+
+  typedef std::map< std::string, std::string > HeaderFieldsType;
+
+  /** Read the fields of the header, up to and including ElementDataFile. */
+  bool ReadHeaderFields( HeaderFieldsType & fields ) const;
+
+  /** Get the chunk table of the header. Returns false if there is none. */
+  bool GetChunkTable( const HeaderFieldsType & fields,
+    SizeValueType & chunkLength, ChunkSizesType & compressedChunkSizes ) const;
+
+private:
+
+  ChunkedMetaImageIO( const Self & ); // purposely not implemented
+  void operator=( const Self & );     // purposely not implemented
+
+  ThreadIdType m_NumberOfThreads;
+  bool         m_ReadChunksInParallel;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkChunkedMetaImageIO_h
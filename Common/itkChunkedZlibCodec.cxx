@@ -0,0 +1,331 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkChunkedZlibCodec.h"
+#include "itk_zlib.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace itk
+{
+
+namespace
+{
+
+/** The parameters of the threads of DecompressChunks(). */
+struct DecompressChunksThreaderParameters
+{
+  const ChunkedZlibCodec::ByteType *       m_Stream;
+  const ChunkedZlibCodec::ChunkSizesType * m_CompressedChunkSizes;
+  std::vector< SizeValueType >             m_ChunkOffsets;
+  SizeValueType                            m_ChunkSize;
+  ChunkedZlibCodec::ByteType *             m_Output;
+  SizeValueType                            m_OutputSize;
+  std::vector< unsigned long >             m_ChunkChecksums;
+  std::vector< char >                      m_ChunkIsValid;
+};
+
+/** Whether a size can be passed to zlib in one call. */
+bool
+FitsInZlibSize( const SizeValueType size )
+{
+  return size <= static_cast< SizeValueType >( std::numeric_limits< uInt >::max() );
+}
+
+
+} // end namespace
+
+/**
+ * ******************* CompressChunk *******************
+ */
+
+bool
+ChunkedZlibCodec
+::CompressChunk( const void * data, SizeValueType size,
+  bool lastChunk, int compressionLevel,
+  BufferType & output, unsigned long & checksum )
+{
+  if( !FitsInZlibSize( size ) )
+  {
+    return false;
+  }
+
+  /** A raw deflate stream, without zlib header and trailer. */
+  z_stream stream;
+  std::memset( &stream, 0, sizeof( stream ) );
+  if( deflateInit2( &stream, compressionLevel, Z_DEFLATED,
+    -MAX_WBITS, 8, Z_DEFAULT_STRATEGY ) != Z_OK )
+  {
+    return false;
+  }
+
+  Bytef * input = const_cast< Bytef * >( static_cast< const Bytef * >( data ) );
+  stream.next_in  = input;
+  stream.avail_in = static_cast< uInt >( size );
+
+  /** The sync flush of all but the last chunk adds an empty stored block,
+   * which is not included in deflateBound().
+   */
+  output.resize( deflateBound( &stream, static_cast< uLong >( size ) ) + 16 );
+  const int     flush   = lastChunk ? Z_FINISH : Z_SYNC_FLUSH;
+  SizeValueType written = 0;
+  bool          success = false;
+  while( true )
+  {
+    stream.next_out  = &output[ written ];
+    stream.avail_out = static_cast< uInt >( output.size() - written );
+    const int result = deflate( &stream, flush );
+    written = output.size() - stream.avail_out;
+
+    if( result == Z_STREAM_ERROR )
+    {
+      break;
+    }
+    if( lastChunk ? result == Z_STREAM_END : ( stream.avail_in == 0 && stream.avail_out > 0 ) )
+    {
+      success = true;
+      break;
+    }
+    output.resize( 2 * output.size() );
+  }
+  deflateEnd( &stream );
+  output.resize( written );
+
+  checksum = adler32( adler32( 0L, Z_NULL, 0 ), input, static_cast< uInt >( size ) );
+  return success;
+
+} // end CompressChunk()
+
+
+/**
+ * ******************* GetStreamHeader *******************
+ */
+
+void
+ChunkedZlibCodec
+::GetStreamHeader( ByteType header[ 2 ] )
+{
+  /** Deflate with a 32K window and the default compression level. */
+  header[ 0 ] = 0x78;
+  header[ 1 ] = 0x9C;
+
+} // end GetStreamHeader()
+
+
+/**
+ * ******************* CombineChecksums *******************
+ */
+
+unsigned long
+ChunkedZlibCodec
+::CombineChecksums( unsigned long checksum,
+  unsigned long chunkChecksum, SizeValueType chunkSize )
+{
+  return adler32_combine( checksum, chunkChecksum, static_cast< z_off_t >( chunkSize ) );
+
+} // end CombineChecksums()
+
+
+/**
+ * ******************* GetStreamTrailer *******************
+ */
+
+void
+ChunkedZlibCodec
+::GetStreamTrailer( unsigned long checksum, ByteType trailer[ 4 ] )
+{
+  /** The Adler-32 checksum, most significant byte first. */
+  trailer[ 0 ] = static_cast< ByteType >( ( checksum >> 24 ) & 0xff );
+  trailer[ 1 ] = static_cast< ByteType >( ( checksum >> 16 ) & 0xff );
+  trailer[ 2 ] = static_cast< ByteType >( ( checksum >> 8 ) & 0xff );
+  trailer[ 3 ] = static_cast< ByteType >( checksum & 0xff );
+
+} // end GetStreamTrailer()
+
+
+/**
+ * ******************* DecompressChunk *******************
+ */
+
+bool
+ChunkedZlibCodec
+::DecompressChunk( const ByteType * input, SizeValueType inputSize,
+  bool lastChunk, ByteType * output, SizeValueType outputSize )
+{
+  if( !FitsInZlibSize( inputSize ) || !FitsInZlibSize( outputSize ) )
+  {
+    return false;
+  }
+
+  z_stream stream;
+  std::memset( &stream, 0, sizeof( stream ) );
+  if( inflateInit2( &stream, -MAX_WBITS ) != Z_OK )
+  {
+    return false;
+  }
+
+  stream.next_in   = const_cast< Bytef * >( input );
+  stream.avail_in  = static_cast< uInt >( inputSize );
+  stream.next_out  = output;
+  stream.avail_out = static_cast< uInt >( outputSize );
+  int result = inflate( &stream, lastChunk ? Z_FINISH : Z_SYNC_FLUSH );
+
+  /** When the output is full, the empty block of the sync flush may remain.
+   * It should be consumed without producing any more output.
+   */
+  if( !lastChunk && result == Z_OK && stream.avail_out == 0 && stream.avail_in > 0 )
+  {
+    Bytef extra;
+    stream.next_out  = &extra;
+    stream.avail_out = 1;
+    result           = inflate( &stream, Z_SYNC_FLUSH );
+    if( stream.avail_out != 1 )
+    {
+      result = Z_DATA_ERROR;
+    }
+    stream.avail_out = 0;
+  }
+  inflateEnd( &stream );
+
+  if( lastChunk )
+  {
+    return result == Z_STREAM_END && stream.avail_in == 0 && stream.avail_out == 0;
+  }
+  return ( result == Z_OK || result == Z_BUF_ERROR )
+         && stream.avail_in == 0 && stream.avail_out == 0;
+
+} // end DecompressChunk()
+
+
+/**
+ * ******************* DecompressChunksThreaderCallback *******************
+ */
+
+ITK_THREAD_RETURN_TYPE
+ChunkedZlibCodec
+::DecompressChunksThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct *    infoStruct = static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  DecompressChunksThreaderParameters * parameters
+    = static_cast< DecompressChunksThreaderParameters * >( infoStruct->UserData );
+  const ThreadIdType threadID        = infoStruct->ThreadID;
+  const ThreadIdType numberOfThreads = infoStruct->NumberOfThreads;
+
+  /** The chunks are assigned to the threads round robin. */
+  const SizeValueType numberOfChunks = parameters->m_CompressedChunkSizes->size();
+  for( SizeValueType chunk = threadID; chunk < numberOfChunks; chunk += numberOfThreads )
+  {
+    const SizeValueType begin = chunk * parameters->m_ChunkSize;
+    const SizeValueType size  = chunk + 1 < numberOfChunks
+      ? parameters->m_ChunkSize : parameters->m_OutputSize - begin;
+    ByteType * output = parameters->m_Output + begin;
+
+    parameters->m_ChunkIsValid[ chunk ] = DecompressChunk(
+      parameters->m_Stream + parameters->m_ChunkOffsets[ chunk ],
+      ( *parameters->m_CompressedChunkSizes )[ chunk ],
+      chunk + 1 == numberOfChunks, output, size );
+    parameters->m_ChunkChecksums[ chunk ]
+      = adler32( adler32( 0L, Z_NULL, 0 ), output, static_cast< uInt >( size ) );
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end DecompressChunksThreaderCallback()
+
+
+/**
+ * ******************* DecompressChunks *******************
+ */
+
+bool
+ChunkedZlibCodec
+::DecompressChunks( const void * stream, SizeValueType streamSize,
+  SizeValueType chunkSize, const ChunkSizesType & compressedChunkSizes,
+  void * output, SizeValueType outputSize, unsigned int numberOfThreads )
+{
+  /** Check that the chunk sizes match the stream and the output. */
+  const SizeValueType numberOfChunks = compressedChunkSizes.size();
+  if( numberOfChunks == 0 || chunkSize == 0
+    || ( numberOfChunks - 1 ) * chunkSize >= outputSize
+    || outputSize - ( numberOfChunks - 1 ) * chunkSize > chunkSize )
+  {
+    return false;
+  }
+
+  DecompressChunksThreaderParameters parameters;
+  parameters.m_Stream               = static_cast< const ByteType * >( stream );
+  parameters.m_CompressedChunkSizes = &compressedChunkSizes;
+  parameters.m_ChunkSize            = chunkSize;
+  parameters.m_Output               = static_cast< ByteType * >( output );
+  parameters.m_OutputSize           = outputSize;
+  parameters.m_ChunkChecksums.resize( numberOfChunks, 0 );
+  parameters.m_ChunkIsValid.resize( numberOfChunks, 0 );
+  parameters.m_ChunkOffsets.resize( numberOfChunks );
+
+  SizeValueType offset = HeaderSize;
+  for( SizeValueType chunk = 0; chunk < numberOfChunks; ++chunk )
+  {
+    parameters.m_ChunkOffsets[ chunk ] = offset;
+    offset                            += compressedChunkSizes[ chunk ];
+  }
+  if( offset + TrailerSize != streamSize )
+  {
+    return false;
+  }
+
+  /** Check the header. */
+  ByteType header[ 2 ];
+  GetStreamHeader( header );
+  if( ( parameters.m_Stream[ 0 ] & 0x0f ) != ( header[ 0 ] & 0x0f )
+    || ( ( parameters.m_Stream[ 0 ] << 8 ) + parameters.m_Stream[ 1 ] ) % 31 != 0
+    || ( parameters.m_Stream[ 1 ] & 0x20 ) != 0 )
+  {
+    return false;
+  }
+
+  /** Decompress the chunks in parallel. */
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads( std::min(
+    static_cast< SizeValueType >( std::max( numberOfThreads, 1u ) ), numberOfChunks ) );
+  threader->SetSingleMethod( DecompressChunksThreaderCallback, &parameters );
+  threader->SingleMethodExecute();
+
+  /** Check all chunks and the checksum of the complete data. */
+  unsigned long checksum = 0;
+  for( SizeValueType chunk = 0; chunk < numberOfChunks; ++chunk )
+  {
+    if( !parameters.m_ChunkIsValid[ chunk ] )
+    {
+      return false;
+    }
+    const SizeValueType size = chunk + 1 < numberOfChunks
+      ? chunkSize : outputSize - chunk * chunkSize;
+    checksum = chunk == 0 ? parameters.m_ChunkChecksums[ chunk ]
+      : CombineChecksums( checksum, parameters.m_ChunkChecksums[ chunk ], size );
+  }
+  ByteType trailer[ 4 ];
+  GetStreamTrailer( checksum, trailer );
+
+  return std::memcmp( trailer, parameters.m_Stream + offset, TrailerSize ) == 0;
+
+} // end DecompressChunks()
+
+
+} // end namespace itk
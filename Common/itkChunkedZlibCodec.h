@@ -0,0 +1,109 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkChunkedZlibCodec_h
+#define __itkChunkedZlibCodec_h
+
+#include "itkMacro.h"
+#include "itkIntTypes.h"
+#include "itkMultiThreader.h"
+
+#include <vector>
+#include <cstddef>
+
+namespace itk
+{
+
+/** \class ChunkedZlibCodec
+ * \brief Compresses and decompresses a zlib stream in independent chunks.
+ *
+ * The data is divided in chunks of a fixed uncompressed size, that are deflated
+ * independently, and can therefore be compressed in parallel. Every chunk but
+ * the last ends with a sync flush, so that it ends on a byte boundary, and the
+ * last chunk ends the deflate stream. The chunks, preceded by the zlib header
+ * and followed by the Adler-32 checksum of all data, form one ordinary zlib
+ * stream, which any zlib reader can decompress.
+ *
+ * Given the compressed sizes of the chunks, DecompressChunks() decompresses
+ * the chunks of such a stream in parallel. The ChunkedMetaImageIO uses it to
+ * read MetaImages with a chunk table.
+ *
+ * \ingroup ImageIO
+ */
+
+class ChunkedZlibCodec
+{
+public:
+
+  /** Typedefs. */
+  typedef unsigned char                ByteType;
+  typedef std::vector< ByteType >      BufferType;
+  typedef std::vector< SizeValueType > ChunkSizesType;
+
+  /** The sizes of the zlib header and the checksum trailer. */
+  itkStaticConstMacro( HeaderSize, unsigned int, 2 );
+  itkStaticConstMacro( TrailerSize, unsigned int, 4 );
+
+  /** The compression level of zlib's Z_DEFAULT_COMPRESSION. */
+  itkStaticConstMacro( DefaultCompressionLevel, int, 6 );
+
+  /** Deflate one chunk of data into output, which is resized to the size
+   * of the compressed chunk. The Adler-32 checksum of the uncompressed
+   * chunk is returned in checksum. Returns false if zlib fails.
+   */
+  static bool CompressChunk( const void * data, SizeValueType size,
+    bool lastChunk, int compressionLevel,
+    BufferType & output, unsigned long & checksum );
+
+  /** Get the zlib header, which precedes the first chunk. */
+  static void GetStreamHeader( ByteType header[ 2 ] );
+
+  /** Combine the checksum of the preceding data with the checksum of a chunk. */
+  static unsigned long CombineChecksums( unsigned long checksum,
+    unsigned long chunkChecksum, SizeValueType chunkSize );
+
+  /** Get the trailer of the stream, which follows the last chunk. */
+  static void GetStreamTrailer( unsigned long checksum, ByteType trailer[ 4 ] );
+
+  /** Decompress a chunked stream, including its header and trailer, in parallel.
+   * chunkSize is the uncompressed size of all chunks but the last,
+   * compressedChunkSizes the compressed sizes of all chunks. The output should
+   * have room for exactly outputSize bytes. Returns false if the stream is
+   * corrupt or does not match the chunk sizes.
+   */
+  static bool DecompressChunks( const void * stream, SizeValueType streamSize,
+    SizeValueType chunkSize, const ChunkSizesType & compressedChunkSizes,
+    void * output, SizeValueType outputSize, unsigned int numberOfThreads );
+
+private:
+
+  /** Inflate one chunk. */
+  static bool DecompressChunk( const ByteType * input, SizeValueType inputSize,
+    bool lastChunk, ByteType * output, SizeValueType outputSize );
+
+  /** The thread function of DecompressChunks(). */
+  static ITK_THREAD_RETURN_TYPE DecompressChunksThreaderCallback( void * arg );
+
+  ChunkedZlibCodec();                           // purposely not implemented
+  ChunkedZlibCodec( const ChunkedZlibCodec & ); // purposely not implemented
+  void operator=( const ChunkedZlibCodec & );   // purposely not implemented
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkChunkedZlibCodec_h
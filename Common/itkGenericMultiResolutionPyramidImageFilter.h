@@ -20,6 +20,8 @@
 
 #include "itkMultiResolutionPyramidImageFilter.h"
 #include "itkSmoothingRecursiveGaussianImageFilter.h"
+#include "itkRecursiveGaussianImageFilter.h"
+#include "itkShrinkImageFilter.h"
 
 namespace itk
 {
@@ -98,6 +100,28 @@ namespace itk
  * compute only single level of the pyramid via SetCurrentLevel() and
  * SetComputeOnlyForCurrentLevel() methods.
  *
+ * With SetComputeFromPreviousLevel() the levels are computed in a cascade,
+ * starting at the finest level. A coarser level is then derived from the
+ * next finer level instead of from the full resolution input, whenever the
+ * schedules allow it: the ShrinkImageFilter is used, the shrink factors of
+ * the coarser level are integer multiples of the finer ones, and all levels
+ * are kept in memory. The missing smoothing is applied on the (small) finer
+ * level with sigma = sqrt( sigma_coarse^2 - sigma_fine^2 ).
+ * Note that when the image size is not divisible by the shrink factors, the
+ * shrinker may pick samples that are shifted by a single voxel of the finer
+ * level compared to shrinking the input directly. The output geometry is
+ * the same in both cases.
+ *
+ * When the ShrinkImageFilter is used, a level that is smoothed and shrunk is
+ * computed one axis at a time: the image is smoothed along an axis and
+ * directly shrunk along that axis, before the next axis is smoothed. Since
+ * the shrinker only picks voxels, this gives the same result as smoothing
+ * along all axes followed by shrinking, but without a full size smoothed
+ * intermediate image. Only the first axis is smoothed at full size. The axes
+ * are processed in the order of the SmoothingRecursiveGaussianImageFilter,
+ * and the intermediate images are of its RealImageType. With the resampler
+ * the full smoothed image is still needed for the interpolation.
+ *
  * \author Denis P. Shamonin and Marius Staring. Division of Image Processing,
  * Department of Radiology, Leiden, The Netherlands
  *
@@ -220,6 +244,13 @@ public:
   itkGetConstMacro( ComputeOnlyForCurrentLevel, bool );
   itkBooleanMacro( ComputeOnlyForCurrentLevel );
 
+  /** Set a control on whether the levels are computed from the previous
+   * (finer) level, where the schedules allow it. Default false.
+   */
+  itkSetMacro( ComputeFromPreviousLevel, bool );
+  itkGetConstMacro( ComputeFromPreviousLevel, bool );
+  itkBooleanMacro( ComputeFromPreviousLevel );
+
 #ifdef ITK_USE_CONCEPT_CHECKING
   /** Begin concept checking */
   itkConceptMacro( SameDimensionCheck,
@@ -265,6 +296,7 @@ protected:
   SmoothingScheduleType m_SmoothingSchedule;
   unsigned int          m_CurrentLevel;
   bool                  m_ComputeOnlyForCurrentLevel;
+  bool                  m_ComputeFromPreviousLevel;
   bool                  m_SmoothingScheduleDefined;
 
 private:
@@ -284,6 +316,16 @@ private:
   typedef ImageToImageFilter< InputImageType, OutputImageType >
     ImageToImageFilterDifferentTypes;
 
+  /** Typedefs for smoothing one axis at a time, where the intermediate
+   * images have the same pixel type as in the smoother.
+   */
+  typedef typename SmootherType::RealImageType RealImageType;
+
+  /** Typedef for the cascade, where a level is computed from the previous
+   * level. Then input and output types are always the same.
+   */
+  typedef ShrinkImageFilter< OutputImageType, OutputImageType > ShrinkerSameTypes;
+
   /** Smooth image at current level. Returns true if performed.
    * This method does not perform execution.
    */
@@ -310,6 +352,29 @@ private:
     typename ImageToImageFilterSameTypes::Pointer & rescaleSameTypes,
     typename ImageToImageFilterDifferentTypes::Pointer & rescaleDifferentTypes );
 
+  /** Returns true if the level can be computed from the previous (finer)
+   * level, given the schedules and the settings of this filter.
+   */
+  bool CanComputeFromPreviousLevel( const unsigned int level ) const;
+
+  /** Compute the level from the previous (finer) level, by smoothing with
+   * the remaining sigma followed by shrinking with the relative factors.
+   * This method does perform execution.
+   */
+  void GenerateLevelFromPreviousLevel( const unsigned int level,
+    const OutputImagePointer & outputPtr );
+
+  /** Compute the level by smoothing the image one axis at a time, and
+   * shrinking each axis directly after it is smoothed. At least one sigma
+   * should be nonzero. This method does perform execution.
+   */
+  template< class TImage >
+  void GenerateSmoothedAndShrunkLevel( const unsigned int level,
+    const TImage * input,
+    const SigmaArrayType & sigmaArray,
+    const RescaleFactorArrayType & shrinkFactors,
+    const OutputImagePointer & outputPtr );
+
   /** Initialize m_SmoothingSchedule to default values for backward compatibility. */
   void SetSmoothingScheduleToDefault( void );
 
@@ -24,6 +24,8 @@
 #include "itkShrinkImageFilter.h"
 #include "itkImageAlgorithm.h"
 
+#include <vector>
+
 namespace // anonymous namespace
 {
 /**
@@ -61,6 +63,7 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
 {
   this->m_CurrentLevel               = 0;
   this->m_ComputeOnlyForCurrentLevel = false;
+  this->m_ComputeFromPreviousLevel   = false;
   SmoothingScheduleType temp( this->GetNumberOfLevels(), ImageDimension );
   temp.Fill( NumericTraits< ScalarRealType >::ZeroValue() );
   this->m_SmoothingSchedule        = temp;
@@ -333,11 +336,18 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
   typename ImageToImageFilterSameTypes::Pointer rescaleSameTypes;
   typename ImageToImageFilterDifferentTypes::Pointer rescaleDifferentTypes;
 
-  for( unsigned int level = 0; level < this->m_NumberOfLevels; ++level )
+  // In the cascade the finest level is computed first,
+  // so that the coarser levels can be derived from it.
+  const bool useCascade = this->m_ComputeFromPreviousLevel
+    && !this->m_ComputeOnlyForCurrentLevel;
+
+  for( unsigned int i = 0; i < this->m_NumberOfLevels; ++i )
   {
+    const unsigned int level = useCascade ? this->m_NumberOfLevels - 1 - i : i;
+
     if( !this->m_ComputeOnlyForCurrentLevel )
     {
-      this->UpdateProgress( static_cast< float >( level )
+      this->UpdateProgress( static_cast< float >( i )
         / static_cast< float >( this->m_NumberOfLevels ) );
     }
 
@@ -348,6 +358,26 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
       outputPtr->SetBufferedRegion( outputPtr->GetRequestedRegion() );
       outputPtr->Allocate();
 
+      // Derive this level from the previous (finer) level if possible
+      if( this->CanComputeFromPreviousLevel( level ) )
+      {
+        this->GenerateLevelFromPreviousLevel( level, outputPtr );
+        continue;
+      }
+
+      // Smooth and shrink one axis at a time if both are needed
+      SigmaArrayType         sigmaArray;
+      RescaleFactorArrayType shrinkFactors;
+      this->GetSigma( level, sigmaArray );
+      this->GetShrinkFactors( level, shrinkFactors );
+      if( this->GetUseShrinkImageFilter() && !this->AreSigmasAllZeros( sigmaArray )
+        && !this->AreRescaleFactorsAllOnes( shrinkFactors ) )
+      {
+        this->GenerateSmoothedAndShrunkLevel( level, input.GetPointer(),
+          sigmaArray, shrinkFactors, outputPtr );
+        continue;
+      }
+
       // Setup the smoother
       const bool smootherIsUsed = this->SetupSmoother( level, smoother, input );
 
@@ -453,6 +483,182 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
 } // end SetupShrinkerOrResampler()
 
 
+/**
+ * ******************* CanComputeFromPreviousLevel ***********************
+ */
+
+template< class TInputImage, class TOutputImage, class TPrecisionType >
+bool
+GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
+::CanComputeFromPreviousLevel( const unsigned int level ) const
+{
+  // The cascade requires all levels in memory and the grid aligned shrinker.
+  // The finest level has no previous level.
+  if( !this->m_ComputeFromPreviousLevel || this->m_ComputeOnlyForCurrentLevel
+    || !this->GetUseShrinkImageFilter() || level + 1 >= this->m_NumberOfLevels )
+  {
+    return false;
+  }
+
+  for( unsigned int dim = 0; dim < ImageDimension; dim++ )
+  {
+    // The shrink factors should be integer multiples of the previous level
+    const unsigned int factor         = this->m_Schedule[ level ][ dim ];
+    const unsigned int previousFactor = this->m_Schedule[ level + 1 ][ dim ];
+    if( previousFactor == 0 || factor % previousFactor != 0 )
+    {
+      return false;
+    }
+
+    // The previous level should not be smoothed more than this level
+    if( this->m_SmoothingSchedule[ level ][ dim ]
+      < this->m_SmoothingSchedule[ level + 1 ][ dim ] )
+    {
+      return false;
+    }
+  }
+
+  return true;
+} // end CanComputeFromPreviousLevel()
+
+
+/**
+ * ******************* GenerateLevelFromPreviousLevel ***********************
+ */
+
+template< class TInputImage, class TOutputImage, class TPrecisionType >
+void
+GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
+::GenerateLevelFromPreviousLevel( const unsigned int level,
+  const OutputImagePointer & outputPtr )
+{
+  // Graft the previous level in a new image, so that the pipeline
+  // below does not refer back to this filter.
+  OutputImagePointer previous = OutputImageType::New();
+  previous->Graft( this->GetOutput( level + 1 ) );
+
+  // Gaussians compose by adding variances, so only the remaining sigma is
+  // applied. The shrink factors are relative to the previous level.
+  SigmaArrayType         sigmaArray;
+  RescaleFactorArrayType shrinkFactors;
+  for( unsigned int dim = 0; dim < ImageDimension; dim++ )
+  {
+    const ScalarRealType sigma         = this->m_SmoothingSchedule[ level ][ dim ];
+    const ScalarRealType previousSigma = this->m_SmoothingSchedule[ level + 1 ][ dim ];
+    sigmaArray[ dim ] = vcl_sqrt( vnl_math_max(
+      sigma * sigma - previousSigma * previousSigma,
+      NumericTraits< ScalarRealType >::ZeroValue() ) );
+    shrinkFactors[ dim ] = this->m_Schedule[ level ][ dim ]
+      / this->m_Schedule[ level + 1 ][ dim ];
+  }
+
+  if( !this->AreSigmasAllZeros( sigmaArray ) )
+  {
+    this->GenerateSmoothedAndShrunkLevel( level, previous.GetPointer(),
+      sigmaArray, shrinkFactors, outputPtr );
+    return;
+  }
+
+  typename ShrinkerSameTypes::Pointer shrinker = ShrinkerSameTypes::New();
+  shrinker->SetInput( previous );
+  shrinker->SetShrinkFactors( shrinkFactors );
+  UpdateAndGraft< Self, ShrinkerSameTypes, OutputImageType >(
+    this, shrinker, outputPtr, level );
+
+} // end GenerateLevelFromPreviousLevel()
+
+
+/**
+ * ******************* GenerateSmoothedAndShrunkLevel ***********************
+ */
+
+template< class TInputImage, class TOutputImage, class TPrecisionType >
+template< class TImage >
+void
+GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
+::GenerateSmoothedAndShrunkLevel( const unsigned int level,
+  const TImage * input,
+  const SigmaArrayType & sigmaArray,
+  const RescaleFactorArrayType & shrinkFactors,
+  const OutputImagePointer & outputPtr )
+{
+  // Typedefs
+  typedef RecursiveGaussianImageFilter< TImage, RealImageType >        FirstSmootherType;
+  typedef RecursiveGaussianImageFilter< RealImageType, RealImageType > SmootherRealType;
+  typedef ShrinkImageFilter< RealImageType, RealImageType >            ShrinkerRealType;
+  typedef ShrinkImageFilter< RealImageType, OutputImageType >          LastShrinkerType;
+
+  // Smooth the axes in the order of the SmoothingRecursiveGaussianImageFilter,
+  // which starts with the last axis. Axes without smoothing are skipped.
+  std::vector< unsigned int > axes;
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+  {
+    const unsigned int dim = ( i + ImageDimension - 1 ) % ImageDimension;
+    if( sigmaArray[ dim ] > NumericTraits< ScalarRealType >::ZeroValue() )
+    {
+      axes.push_back( dim );
+    }
+  }
+
+  // The axes without smoothing are shrunk together with the first axis.
+  RescaleFactorArrayType factors;
+  for( unsigned int dim = 0; dim < ImageDimension; dim++ )
+  {
+    factors[ dim ] = sigmaArray[ dim ] > NumericTraits< ScalarRealType >::ZeroValue()
+      ? 1 : shrinkFactors[ dim ];
+  }
+
+  // The data objects do not keep their sources alive,
+  // so keep the filters of the pipeline here.
+  std::vector< ProcessObject::Pointer > filters;
+
+  typename FirstSmootherType::Pointer firstSmoother = FirstSmootherType::New();
+  firstSmoother->SetInput( input );
+  firstSmoother->SetDirection( axes[ 0 ] );
+  firstSmoother->SetSigma( sigmaArray[ axes[ 0 ] ] );
+  firstSmoother->SetZeroOrder();
+  firstSmoother->SetNormalizeAcrossScale( false );
+  firstSmoother->ReleaseDataFlagOn();
+  filters.push_back( firstSmoother.GetPointer() );
+  RealImageType * current = firstSmoother->GetOutput();
+
+  // Shrink each axis directly after it is smoothed. The last axis is shrunk
+  // by the last shrinker, which also casts to the output type.
+  factors[ axes[ 0 ] ] = shrinkFactors[ axes[ 0 ] ];
+  for( unsigned int i = 1; i < axes.size(); i++ )
+  {
+    if( !this->AreRescaleFactorsAllOnes( factors ) )
+    {
+      typename ShrinkerRealType::Pointer shrinker = ShrinkerRealType::New();
+      shrinker->SetInput( current );
+      shrinker->SetShrinkFactors( factors );
+      shrinker->ReleaseDataFlagOn();
+      filters.push_back( shrinker.GetPointer() );
+      current = shrinker->GetOutput();
+      factors.Fill( 1 );
+    }
+
+    typename SmootherRealType::Pointer smoother = SmootherRealType::New();
+    smoother->SetInput( current );
+    smoother->SetDirection( axes[ i ] );
+    smoother->SetSigma( sigmaArray[ axes[ i ] ] );
+    smoother->SetZeroOrder();
+    smoother->SetNormalizeAcrossScale( false );
+    smoother->ReleaseDataFlagOn();
+    filters.push_back( smoother.GetPointer() );
+    current = smoother->GetOutput();
+    factors[ axes[ i ] ] = shrinkFactors[ axes[ i ] ];
+  }
+
+  typename LastShrinkerType::Pointer lastShrinker = LastShrinkerType::New();
+  lastShrinker->SetInput( current );
+  lastShrinker->SetShrinkFactors( factors );
+  UpdateAndGraft< Self, LastShrinkerType, OutputImageType >(
+    this, lastShrinker, outputPtr, level );
+
+} // end GenerateSmoothedAndShrunkLevel()
+
+
 /**
  * ******************* DefineShrinkerOrResampler ***********************
  */
@@ -914,6 +1120,8 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
      << this->m_CurrentLevel << std::endl;
   os << indent << "ComputeOnlyForCurrentLevel: "
      << ( this->m_ComputeOnlyForCurrentLevel ? "true" : "false" ) << std::endl;
+  os << indent << "ComputeFromPreviousLevel: "
+     << ( this->m_ComputeFromPreviousLevel ? "true" : "false" ) << std::endl;
   os << indent << "SmoothingScheduleDefined: "
      << ( this->m_SmoothingScheduleDefined ? "true" : "false" ) << std::endl;
   os << indent << "Smoothing Schedule: ";
@@ -24,6 +24,15 @@
 #include "itkSize.h"
 #include "itkImageIORegion.h"
 #include "itkCastImageFilter.h"
+#include "itkChunkedZlibCodec.h"
+#include "itkMultiThreader.h"
+#include "itkMetaDataObject.h"
+#include "metaImage.h"
+
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <locale>
 
 namespace itk
 {
@@ -35,6 +44,18 @@ namespace itk
  * if necessary. This is useful in some cases, to avoid the use of
  * a itk::CastImageFilter (to save memory for example).
  *
+ * A compressed MetaImage with a separate data file (.mhd) is written in
+ * chunks of CompressionChunkSize bytes, which are cast and compressed in
+ * parallel by NumberOfThreads threads, without a cast copy of the whole
+ * image. The chunks together form a single zlib stream, so that the file
+ * can be read by any MetaImage reader. The compressed sizes of the chunks
+ * are listed in the header, in the field CompressedDataChunkLength and the
+ * fields CompressedDataChunkSizes_0, CompressedDataChunkSizes_1, etc., such
+ * that ChunkedZlibCodec::DecompressChunks() can decompress the data in
+ * parallel too. The header is written by MetaIO, like that of the
+ * MetaImageIO, including the meta data dictionary. Other file formats are
+ * written by the ImageIO.
+ *
  */
 template< class TInputImage >
 class ITKIOImageBase_HIDDEN ImageFileCastWriter : public ImageFileWriter< TInputImage >
@@ -70,6 +91,12 @@ public:
   /** Determine the default outputcomponentType */
   std::string GetDefaultOutputComponentType( void ) const;
 
+  /** Set/Get the uncompressed size in bytes of the chunks that are compressed
+   * in parallel. Zero disables the chunked compression. Default: 1 MB.
+   */
+  itkSetMacro( CompressionChunkSize, SizeValueType );
+  itkGetConstMacro( CompressionChunkSize, SizeValueType );
+
 protected:
 
   ImageFileCastWriter();
@@ -78,10 +105,100 @@ protected:
   /** Does the real work. */
   void GenerateData( void );
 
+  /** Typedefs for the chunked compression. */
+  typedef MultiThreader                           ThreaderType;
+  typedef typename ThreaderType::ThreadInfoStruct ThreadInfoType;
+  typedef ChunkedZlibCodec::BufferType            BufferType;
+  typedef ChunkedZlibCodec::ChunkSizesType        ChunkSizesType;
+
+  /** A function that casts a number of components from the input buffer
+   * to the output buffer.
+   */
+  typedef void (* ConvertChunkFunctionType)( const void * input,
+    SizeValueType numberOfComponents, void * output );
+
+  /** Cast a number of components. */
+  template< class InputComponentType, class OutputComponentType >
+  static void CastChunk( const void * input,
+    SizeValueType numberOfComponents, void * output )
+  {
+    const InputComponentType * in  = static_cast< const InputComponentType * >( input );
+    OutputComponentType *      out = static_cast< OutputComponentType * >( output );
+    for( SizeValueType i = 0; i < numberOfComponents; ++i )
+    {
+      out[ i ] = static_cast< OutputComponentType >( in[ i ] );
+    }
+  }
+
+
+  /** Whether the image is written as a chunked compressed MetaImage. */
+  virtual bool CanWriteChunkedCompressedMetaImage( void );
+
+  /** Cast and compress the input buffer in chunks, in parallel, and write
+   * the data file and the header of the MetaImage.
+   */
+  virtual void WriteChunkedCompressedMetaImage( const void * inputBuffer );
+
+  /** Write the header of the chunked compressed MetaImage. */
+  virtual void WriteChunkedCompressedMetaImageHeader(
+    const std::string & dataFileName, SizeValueType compressedDataSize,
+    SizeValueType chunkLength, const ChunkSizesType & compressedChunkSizes );
+
+  /** The MetaImage element type of the ImageIO's component type, or MET_OTHER
+   * if there is none.
+   */
+  MET_ValueEnumType GetMetaImageElementType( void );
+
+  /** Add the entries of the meta data dictionary of the ImageIO that hold a
+   * string or a number to the fields of the MetaImage, as the MetaImageIO does.
+   */
+  void AddMetaDataDictionaryToMetaImage( MetaImage & metaImage );
+
+  /** Get a meta data entry of type T as a string. */
+  template< class T >
+  static bool ExposeMetaDataAsString( const MetaDataDictionary & dictionary,
+    const std::string & key, std::string & value )
+  {
+    T typedValue;
+    if( !ExposeMetaData< T >( dictionary, key, typedValue ) )
+    {
+      return false;
+    }
+    std::ostringstream stream;
+    stream.imbue( std::locale::classic() );
+    stream << std::setprecision( 17 ) << typedValue;
+    value = stream.str();
+    return true;
+  }
+
+
+  /** A MetaImage of which the compressed data size can be set, such that
+   * its header can be written without the data.
+   */
+  class ChunkedCompressedMetaImage : public MetaImage
+  {
+public:
+
+    void SetCompressedDataSize( SizeValueType size )
+    {
+      this->m_CompressedDataSize = size;
+    }
+
+
+  };
+
+  /** Cast and compress the chunks of one wave of threads. */
+  void ThreadedCompressChunks( ThreadIdType threadID );
+
+  /** The thread function of WriteChunkedCompressedMetaImage(). */
+  static ITK_THREAD_RETURN_TYPE CompressChunksThreaderCallback( void * arg );
+
   /** Templated function that casts the input image and returns a
    * a pointer to the PixelBuffer. Assumes scalar singlecomponent images
    * The buffer data is valid until this->m_Caster is destroyed or assigned
-   * a new caster. The ImageIO's PixelType is also adapted by this function */
+   * a new caster. The ImageIO's PixelType is also adapted by this function.
+   * When the image is written chunked compressed, the image is not cast,
+   * but the function that casts the chunks is selected, and 0 is returned. */
   template< class OutputComponentType >
   void * ConvertScalarImage( const DataObject * inputImage,
     const OutputComponentType & itkNotUsed( dummy ) )
@@ -95,6 +212,15 @@ protected:
     //this->GetImageIO()->SetPixelTypeInfo( typeid(OutputComponentType) );
     this->GetImageIO()->SetPixelTypeInfo( static_cast< const OutputComponentType * >( 0 ) );
 
+    /** With chunked compression, the chunks are cast while they are written. */
+    if( this->m_WriteChunkedCompressed )
+    {
+      this->m_ConvertChunkFunction
+        = &Self::template CastChunk< InputImageComponentType, OutputComponentType >;
+      this->m_InputComponentSize = sizeof( InputImageComponentType );
+      return 0;
+    }
+
     /** cast the input image */
     typename CasterType::Pointer caster                    = CasterType::New();
     this->m_Caster                                         = caster;
@@ -118,12 +244,35 @@ protected:
 
   ProcessObject::Pointer m_Caster;
 
+  /** The parameters of the threads of WriteChunkedCompressedMetaImage().
+   * In each wave, every thread casts and compresses one chunk.
+   */
+  struct ChunkedCompressionParametersType
+  {
+    const unsigned char *        st_InputBuffer;
+    SizeValueType                st_NumberOfComponents;
+    SizeValueType                st_ChunkLength;
+    SizeValueType                st_NumberOfChunks;
+    SizeValueType                st_FirstChunk;
+    std::vector< BufferType >    st_CastBuffers;
+    std::vector< BufferType >    st_CompressedChunks;
+    std::vector< unsigned long > st_Checksums;
+    std::vector< char >          st_Success;
+  };
+
+  ChunkedCompressionParametersType m_ChunkedCompressionParameters;
+
 private:
 
   ImageFileCastWriter( const Self & ); // purposely not implemented
   void operator=( const Self & );      // purposely not implemented
 
   std::string m_OutputComponentType;
+
+  SizeValueType            m_CompressionChunkSize;
+  bool                     m_WriteChunkedCompressed;
+  ConvertChunkFunctionType m_ConvertChunkFunction;
+  SizeValueType            m_InputComponentSize;
 };
 
 } // end namespace itk
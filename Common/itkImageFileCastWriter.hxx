@@ -27,6 +27,12 @@
 #include "itkVectorImage.h"
 #include "itkDefaultConvertPixelTraits.h"
 #include "itkMetaImageIO.h"
+#include "itkByteSwapper.h"
+#include "itkSpatialOrientationAdapter.h"
+#include <itksys/SystemTools.hxx>
+
+#include <algorithm>
+#include <fstream>
 
 namespace itk
 {
@@ -36,8 +42,12 @@ template< class TInputImage >
 ImageFileCastWriter< TInputImage >
 ::ImageFileCastWriter()
 {
-  this->m_Caster              = 0;
-  this->m_OutputComponentType = this->GetDefaultOutputComponentType();
+  this->m_Caster                 = 0;
+  this->m_OutputComponentType    = this->GetDefaultOutputComponentType();
+  this->m_CompressionChunkSize   = 1 << 20;
+  this->m_WriteChunkedCompressed = false;
+  this->m_ConvertChunkFunction   = 0;
+  this->m_InputComponentSize     = 0;
 }
 
 
@@ -103,6 +113,11 @@ ImageFileCastWriter< TInputImage >
   /** Setup the image IO for writing. */
   this->GetImageIO()->SetFileName( this->GetFileName() );
 
+  /** Compressed MetaImages are cast and compressed in chunks, in parallel. */
+  this->m_WriteChunkedCompressed = this->CanWriteChunkedCompressedMetaImage();
+  this->m_ConvertChunkFunction   = 0;
+  this->m_InputComponentSize     = this->GetImageIO()->GetComponentSize();
+
   /** Get the number of Components */
   unsigned int numberOfComponents = this->GetImageIO()->GetNumberOfComponents();
 
@@ -171,7 +186,14 @@ ImageFileCastWriter< TInputImage >
     }
 
     /** Do the writing */
-    this->GetImageIO()->Write( convertedDataBuffer );
+    if( this->m_WriteChunkedCompressed )
+    {
+      this->WriteChunkedCompressedMetaImage( input->GetBufferPointer() );
+    }
+    else
+    {
+      this->GetImageIO()->Write( convertedDataBuffer );
+    }
     /** Release the caster's memory */
     this->m_Caster = 0;
 
@@ -180,12 +202,373 @@ ImageFileCastWriter< TInputImage >
   {
     /** No casting needed or possible, just write */
     const void * dataPtr = (const void *)input->GetBufferPointer();
-    this->GetImageIO()->Write( dataPtr );
+    if( this->m_WriteChunkedCompressed )
+    {
+      this->WriteChunkedCompressedMetaImage( dataPtr );
+    }
+    else
+    {
+      this->GetImageIO()->Write( dataPtr );
+    }
+  }
+
+}
+
+
+//---------------------------------------------------------
+template< class TInputImage >
+bool
+ImageFileCastWriter< TInputImage >
+::CanWriteChunkedCompressedMetaImage( void )
+{
+  if( this->m_CompressionChunkSize == 0 || !this->GetUseCompression() )
+  {
+    return false;
+  }
+
+  /** Only MetaImages with a separate data file; for a .mha the header,
+   * which contains the compressed size, precedes the data.
+   */
+  if( dynamic_cast< MetaImageIO * >( this->GetImageIO() ) == 0 )
+  {
+    return false;
+  }
+  const std::string extension = itksys::SystemTools::LowerCase(
+    itksys::SystemTools::GetFilenameLastExtension( this->GetFileName() ) );
+  if( extension != ".mhd" )
+  {
+    return false;
+  }
+
+  /** The image should be written at once. */
+  const InputImageType * input = this->GetInput();
+  return input->GetBufferedRegion() == input->GetLargestPossibleRegion();
+}
+
+
+//---------------------------------------------------------
+template< class TInputImage >
+void
+ImageFileCastWriter< TInputImage >
+::WriteChunkedCompressedMetaImage( const void * inputBuffer )
+{
+  ImageIOBase *       imageIO       = this->GetImageIO();
+  const SizeValueType componentSize = imageIO->GetComponentSize();
+  if( this->GetMetaImageElementType() == MET_OTHER )
+  {
+    itkExceptionMacro( << "The component type "
+                       << imageIO->GetComponentTypeAsString( imageIO->GetComponentType() )
+                       << " can not be written as a MetaImage." );
   }
 
+  /** The chunks contain a whole number of components. */
+  ChunkedCompressionParametersType & parameters = this->m_ChunkedCompressionParameters;
+  parameters.st_InputBuffer        = static_cast< const unsigned char * >( inputBuffer );
+  parameters.st_NumberOfComponents = imageIO->GetImageSizeInComponents();
+  parameters.st_ChunkLength        = std::max( this->m_CompressionChunkSize / componentSize,
+    static_cast< SizeValueType >( 1 ) );
+  parameters.st_NumberOfChunks = std::max( static_cast< SizeValueType >( 1 ),
+    ( parameters.st_NumberOfComponents + parameters.st_ChunkLength - 1 ) / parameters.st_ChunkLength );
+
+  /** Each wave of threads compresses one chunk per thread. */
+  const ThreadIdType numberOfThreads = static_cast< ThreadIdType >( std::min(
+    static_cast< SizeValueType >( std::max( this->GetNumberOfThreads(), static_cast< ThreadIdType >( 1 ) ) ),
+    parameters.st_NumberOfChunks ) );
+  parameters.st_CastBuffers.resize( numberOfThreads );
+  parameters.st_CompressedChunks.resize( numberOfThreads );
+  parameters.st_Checksums.assign( numberOfThreads, 0 );
+  parameters.st_Success.assign( numberOfThreads, 0 );
+
+  /** The data file has the name of the header, with the extension .zraw. */
+  const std::string dataFileName
+    = itksys::SystemTools::GetFilenameWithoutLastExtension( this->GetFileName() ) + ".zraw";
+  const std::string path         = itksys::SystemTools::GetFilenamePath( this->GetFileName() );
+  const std::string dataFullName = path.empty() ? dataFileName : path + "/" + dataFileName;
+
+  std::ofstream dataFile( dataFullName.c_str(), std::ios::out | std::ios::binary );
+  if( !dataFile.is_open() )
+  {
+    itkExceptionMacro( << "The file " << dataFullName << " could not be opened for writing." );
+  }
+
+  ChunkedZlibCodec::ByteType header[ ChunkedZlibCodec::HeaderSize ];
+  ChunkedZlibCodec::GetStreamHeader( header );
+  dataFile.write( reinterpret_cast< const char * >( header ), ChunkedZlibCodec::HeaderSize );
+
+  typename ThreaderType::Pointer threader = ThreaderType::New();
+  threader->SetNumberOfThreads( numberOfThreads );
+  threader->SetSingleMethod( CompressChunksThreaderCallback, this );
+
+  ChunkSizesType compressedChunkSizes;
+  SizeValueType  compressedDataSize = ChunkedZlibCodec::HeaderSize + ChunkedZlibCodec::TrailerSize;
+  unsigned long  checksum           = 0;
+  for( parameters.st_FirstChunk = 0; parameters.st_FirstChunk < parameters.st_NumberOfChunks;
+    parameters.st_FirstChunk += numberOfThreads )
+  {
+    threader->SingleMethodExecute();
+
+    /** Append the chunks in order. */
+    for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+    {
+      const SizeValueType chunk = parameters.st_FirstChunk + i;
+      if( chunk >= parameters.st_NumberOfChunks )
+      {
+        break;
+      }
+      if( !parameters.st_Success[ i ] )
+      {
+        itkExceptionMacro( << "Compressing chunk " << chunk << " of " << dataFullName << " failed." );
+      }
+
+      const BufferType &  compressedChunk = parameters.st_CompressedChunks[ i ];
+      const SizeValueType chunkSize       = componentSize * std::min( parameters.st_ChunkLength,
+        parameters.st_NumberOfComponents - chunk * parameters.st_ChunkLength );
+      dataFile.write( reinterpret_cast< const char * >( &compressedChunk[ 0 ] ), compressedChunk.size() );
+      compressedChunkSizes.push_back( compressedChunk.size() );
+      compressedDataSize += compressedChunk.size();
+      checksum            = chunk == 0 ? parameters.st_Checksums[ i ]
+        : ChunkedZlibCodec::CombineChecksums( checksum, parameters.st_Checksums[ i ], chunkSize );
+    }
+  }
+
+  ChunkedZlibCodec::ByteType trailer[ ChunkedZlibCodec::TrailerSize ];
+  ChunkedZlibCodec::GetStreamTrailer( checksum, trailer );
+  dataFile.write( reinterpret_cast< const char * >( trailer ), ChunkedZlibCodec::TrailerSize );
+  dataFile.close();
+  if( dataFile.fail() )
+  {
+    itkExceptionMacro( << "Writing the file " << dataFullName << " failed." );
+  }
+
+  /** Release the buffers of the threads. */
+  parameters.st_CastBuffers.clear();
+  parameters.st_CompressedChunks.clear();
+
+  this->WriteChunkedCompressedMetaImageHeader( dataFileName, compressedDataSize,
+    parameters.st_ChunkLength * componentSize, compressedChunkSizes );
+}
+
+
+//---------------------------------------------------------
+template< class TInputImage >
+ITK_THREAD_RETURN_TYPE
+ImageFileCastWriter< TInputImage >
+::CompressChunksThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  Self *           self       = static_cast< Self * >( infoStruct->UserData );
+
+  self->ThreadedCompressChunks( infoStruct->ThreadID );
+
+  return ITK_THREAD_RETURN_VALUE;
 }
 
 
+//---------------------------------------------------------
+template< class TInputImage >
+void
+ImageFileCastWriter< TInputImage >
+::ThreadedCompressChunks( ThreadIdType threadID )
+{
+  ChunkedCompressionParametersType & parameters = this->m_ChunkedCompressionParameters;
+  const SizeValueType                chunk      = parameters.st_FirstChunk + threadID;
+  if( chunk >= parameters.st_NumberOfChunks )
+  {
+    return;
+  }
+
+  const SizeValueType firstComponent     = chunk * parameters.st_ChunkLength;
+  const SizeValueType numberOfComponents = std::min( parameters.st_ChunkLength,
+    parameters.st_NumberOfComponents - firstComponent );
+  const SizeValueType outputComponentSize = this->GetImageIO()->GetComponentSize();
+
+  /** Cast the chunk into the buffer of this thread, if necessary. */
+  const unsigned char * input = parameters.st_InputBuffer + firstComponent * this->m_InputComponentSize;
+  const void *          data  = input;
+  if( this->m_ConvertChunkFunction != 0 && numberOfComponents > 0 )
+  {
+    BufferType & castBuffer = parameters.st_CastBuffers[ threadID ];
+    castBuffer.resize( parameters.st_ChunkLength * outputComponentSize );
+    this->m_ConvertChunkFunction( input, numberOfComponents, &castBuffer[ 0 ] );
+    data = &castBuffer[ 0 ];
+  }
+
+  parameters.st_Success[ threadID ] = ChunkedZlibCodec::CompressChunk(
+    data, numberOfComponents * outputComponentSize,
+    chunk + 1 == parameters.st_NumberOfChunks, ChunkedZlibCodec::DefaultCompressionLevel,
+    parameters.st_CompressedChunks[ threadID ], parameters.st_Checksums[ threadID ] );
+}
+
+
+//---------------------------------------------------------
+template< class TInputImage >
+void
+ImageFileCastWriter< TInputImage >
+::WriteChunkedCompressedMetaImageHeader(
+  const std::string & dataFileName, SizeValueType compressedDataSize,
+  SizeValueType chunkLength, const ChunkSizesType & compressedChunkSizes )
+{
+  ImageIOBase *      imageIO            = this->GetImageIO();
+  const unsigned int numberOfDimensions = imageIO->GetNumberOfDimensions();
+
+  /** Fill in the MetaImage, as the MetaImageIO does. */
+  std::vector< int >    dimSize( numberOfDimensions );
+  std::vector< double > spacing( numberOfDimensions );
+  std::vector< double > transformMatrix( numberOfDimensions * numberOfDimensions );
+  for( unsigned int i = 0; i < numberOfDimensions; ++i )
+  {
+    dimSize[ i ] = static_cast< int >( imageIO->GetDimensions( i ) );
+    spacing[ i ] = imageIO->GetSpacing( i );
+    const std::vector< double > direction = imageIO->GetDirection( i );
+    for( unsigned int j = 0; j < numberOfDimensions; ++j )
+    {
+      transformMatrix[ i * numberOfDimensions + j ] = direction[ j ];
+    }
+  }
+
+  ChunkedCompressedMetaImage metaImage;
+  metaImage.SetDoublePrecision( 17 );
+  metaImage.InitializeEssential( numberOfDimensions, &dimSize[ 0 ], &spacing[ 0 ],
+    this->GetMetaImageElementType(), imageIO->GetNumberOfComponents(), 0, false );
+  this->AddMetaDataDictionaryToMetaImage( metaImage );
+  for( unsigned int i = 0; i < numberOfDimensions; ++i )
+  {
+    metaImage.Position( i, imageIO->GetOrigin( i ) );
+  }
+  metaImage.TransformMatrix( &transformMatrix[ 0 ] );
+  metaImage.BinaryData( true );
+  metaImage.BinaryDataByteOrderMSB( ByteSwapper< int >::SystemIsBigEndian() );
+  metaImage.CompressedData( true );
+  metaImage.SetCompressedDataSize( compressedDataSize );
+
+  /** The anatomical orientation of a 3D image. The orientation codes contain
+   * the terms of the three axes in their three lowest bytes.
+   */
+  if( numberOfDimensions == 3 )
+  {
+    SpatialOrientationAdapter::DirectionType direction;
+    for( unsigned int i = 0; i < 3; ++i )
+    {
+      for( unsigned int j = 0; j < 3; ++j )
+      {
+        direction[ i ][ j ] = imageIO->GetDirection( j )[ i ];
+      }
+    }
+    const unsigned int orientation = SpatialOrientationAdapter().FromDirectionCosines( direction );
+    std::string        anatomicalOrientation;
+    for( unsigned int i = 0; i < 3; ++i )
+    {
+      switch( ( orientation >> ( 8 * i ) ) & 0xff )
+      {
+        case SpatialOrientation::ITK_COORDINATE_Right:
+          anatomicalOrientation += 'R'; break;
+        case SpatialOrientation::ITK_COORDINATE_Left:
+          anatomicalOrientation += 'L'; break;
+        case SpatialOrientation::ITK_COORDINATE_Posterior:
+          anatomicalOrientation += 'P'; break;
+        case SpatialOrientation::ITK_COORDINATE_Anterior:
+          anatomicalOrientation += 'A'; break;
+        case SpatialOrientation::ITK_COORDINATE_Inferior:
+          anatomicalOrientation += 'I'; break;
+        case SpatialOrientation::ITK_COORDINATE_Superior:
+          anatomicalOrientation += 'S'; break;
+        default:
+          break;
+      }
+    }
+    if( anatomicalOrientation.size() == 3 )
+    {
+      metaImage.AnatomicalOrientation( anatomicalOrientation.c_str() );
+    }
+  }
+
+  /** The chunk table. A MetaIO field holds a limited number of values, so
+   * the table is split over several fields.
+   */
+  const unsigned long chunkLengthField = chunkLength;
+  metaImage.AddUserField( "CompressedDataChunkLength", MET_ULONG, 1, &chunkLengthField );
+  const SizeValueType numberOfChunks = compressedChunkSizes.size();
+  const SizeValueType chunksPerField = 32;
+  for( SizeValueType i = 0; i < numberOfChunks; i += chunksPerField )
+  {
+    const SizeValueType          n = std::min( chunksPerField, numberOfChunks - i );
+    std::vector< unsigned long > sizes(
+      compressedChunkSizes.begin() + i, compressedChunkSizes.begin() + i + n );
+    std::ostringstream name;
+    name << "CompressedDataChunkSizes_" << i / chunksPerField;
+    metaImage.AddUserField( name.str().c_str(), MET_ULONG_ARRAY, static_cast< int >( n ), &sizes[ 0 ] );
+  }
+
+  /** Write only the header; the data file is written already. */
+  if( !metaImage.Write( this->GetFileName(), dataFileName.c_str(), false ) )
+  {
+    itkExceptionMacro( << "Writing the file " << this->GetFileName() << " failed." );
+  }
+}
+
+
+//---------------------------------------------------------
+template< class TInputImage >
+void
+ImageFileCastWriter< TInputImage >
+::AddMetaDataDictionaryToMetaImage( MetaImage & metaImage )
+{
+  const MetaDataDictionary &       dictionary = this->GetImageIO()->GetMetaDataDictionary();
+  const std::vector< std::string > keys       = dictionary.GetKeys();
+  for( std::vector< std::string >::const_iterator key = keys.begin(); key != keys.end(); ++key )
+  {
+    std::string value;
+    if( ExposeMetaData< std::string >( dictionary, *key, value )
+      || ExposeMetaDataAsString< double >( dictionary, *key, value )
+      || ExposeMetaDataAsString< float >( dictionary, *key, value )
+      || ExposeMetaDataAsString< long >( dictionary, *key, value )
+      || ExposeMetaDataAsString< unsigned long >( dictionary, *key, value )
+      || ExposeMetaDataAsString< int >( dictionary, *key, value )
+      || ExposeMetaDataAsString< unsigned int >( dictionary, *key, value )
+      || ExposeMetaDataAsString< short >( dictionary, *key, value )
+      || ExposeMetaDataAsString< unsigned short >( dictionary, *key, value ) )
+    {
+      metaImage.AddUserField( key->c_str(), MET_STRING,
+        static_cast< int >( value.size() ), value.c_str() );
+    }
+  }
+}
+
+
+//---------------------------------------------------------
+template< class TInputImage >
+MET_ValueEnumType
+ImageFileCastWriter< TInputImage >
+::GetMetaImageElementType( void )
+{
+  /** The MetaIO types of 4 and 8 bytes are (U)LONG and (U)LONG_LONG. */
+  switch( this->GetImageIO()->GetComponentType() )
+  {
+    case ImageIOBase::UCHAR:
+      return MET_UCHAR;
+    case ImageIOBase::CHAR:
+      return MET_CHAR;
+    case ImageIOBase::USHORT:
+      return MET_USHORT;
+    case ImageIOBase::SHORT:
+      return MET_SHORT;
+    case ImageIOBase::UINT:
+      return MET_UINT;
+    case ImageIOBase::INT:
+      return MET_INT;
+    case ImageIOBase::ULONG:
+      return sizeof( unsigned long ) == 4 ? MET_ULONG : MET_ULONG_LONG;
+    case ImageIOBase::LONG:
+      return sizeof( long ) == 4 ? MET_LONG : MET_LONG_LONG;
+    case ImageIOBase::FLOAT:
+      return MET_FLOAT;
+    case ImageIOBase::DOUBLE:
+      return MET_DOUBLE;
+    default:
+      return MET_OTHER;
+  }
+}
+
 } // end namespace itk
 
 #endif
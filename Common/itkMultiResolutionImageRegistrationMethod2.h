@@ -154,6 +154,9 @@ public:
     MovingImageType, MovingImageType >                MovingImagePyramidType;
   typedef typename MovingImagePyramidType::Pointer MovingImagePyramidPointer;
 
+  /** Type of the precomputed outputs of the fixed image pyramid. */
+  typedef std::vector< FixedImageConstPointer > FixedImagePyramidOutputsType;
+
   /** Type of the Transformation parameters This is the same type used to
    *  represent the search space of the optimization algorithm.
    */
@@ -204,6 +207,35 @@ public:
   itkSetObjectMacro( MovingImagePyramid, MovingImagePyramidType );
   itkGetObjectMacro( MovingImagePyramid, MovingImagePyramidType );
 
+  /** Set precomputed outputs of a fixed image pyramid, one per level.
+   * When there is one output for every level, that fixed image pyramid is not
+   * updated, and the metric gets these images instead. This way registrations
+   * that share the fixed image, such as the jobs of a batch, compute the fixed
+   * image pyramid only once. Subclasses with more than one fixed image pyramid
+   * use the position \a pos. Default: empty.
+   */
+  virtual void SetFixedImagePyramidOutputs( const FixedImagePyramidOutputsType & outputs,
+    unsigned int pos );
+
+  virtual void SetFixedImagePyramidOutputs( const FixedImagePyramidOutputsType & outputs )
+  { this->SetFixedImagePyramidOutputs( outputs, 0 ); }
+
+  /** Get whether there is a precomputed output for every level of the fixed
+   * image pyramid at position \a pos.
+   */
+  virtual bool HasFixedImagePyramidOutputs( unsigned int pos ) const;
+
+  /** Get the fixed image at a level: the precomputed output, if there is
+   * one for every level, or else the output of the fixed image pyramid.
+   * Subclasses with more than one fixed image pyramid override the version
+   * with a position.
+   */
+  virtual const FixedImageType * GetFixedImageAtLevel( unsigned long level,
+    unsigned int pos ) const;
+
+  virtual const FixedImageType * GetFixedImageAtLevel( unsigned long level ) const
+  { return this->GetFixedImageAtLevel( level, 0 ); }
+
   /** Set/Get the number of multi-resolution levels. */
   itkSetClampMacro( NumberOfLevels, unsigned long, 1,
     NumericTraits< unsigned long >::max() );
@@ -295,6 +327,8 @@ private:
   MovingImagePyramidPointer m_MovingImagePyramid;
   FixedImagePyramidPointer  m_FixedImagePyramid;
 
+  std::vector< FixedImagePyramidOutputsType > m_FixedImagePyramidOutputs;
+
   FixedImageRegionType        m_FixedImageRegion;
   FixedImageRegionPyramidType m_FixedImageRegionPyramid;
 
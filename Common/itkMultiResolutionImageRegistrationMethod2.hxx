@@ -122,7 +122,7 @@ MultiResolutionImageRegistrationMethod2< TFixedImage, TMovingImage >
 
   // Setup the metric
   this->m_Metric->SetMovingImage( this->m_MovingImagePyramid->GetOutput( this->m_CurrentLevel ) );
-  this->m_Metric->SetFixedImage( this->m_FixedImagePyramid->GetOutput( this->m_CurrentLevel ) );
+  this->m_Metric->SetFixedImage( this->GetFixedImageAtLevel( this->m_CurrentLevel ) );
   this->m_Metric->SetTransform( this->m_Transform );
   this->m_Metric->SetInterpolator( this->m_Interpolator );
   this->m_Metric->SetFixedImageRegion( this->m_FixedImageRegionPyramid[ this->m_CurrentLevel ] );
@@ -199,10 +199,14 @@ MultiResolutionImageRegistrationMethod2< TFixedImage, TMovingImage >
     itkExceptionMacro( << "Moving image pyramid is not present" );
   }
 
-  // Setup the fixed image pyramid
+  // Setup the fixed image pyramid. Its schedule is used below, so the number
+  // of levels is set even when its outputs have been precomputed.
   this->m_FixedImagePyramid->SetNumberOfLevels( this->m_NumberOfLevels );
   this->m_FixedImagePyramid->SetInput( this->m_FixedImage );
-  this->m_FixedImagePyramid->UpdateLargestPossibleRegion();
+  if( !this->HasFixedImagePyramidOutputs( 0 ) )
+  {
+    this->m_FixedImagePyramid->UpdateLargestPossibleRegion();
+  }
 
   // Setup the moving image pyramid
   this->m_MovingImagePyramid->SetNumberOfLevels( this->m_NumberOfLevels );
@@ -247,11 +251,11 @@ MultiResolutionImageRegistrationMethod2< TFixedImage, TMovingImage >
 
   for( unsigned int level = 0; level < this->m_NumberOfLevels; level++ )
   {
-    SizeType         size;
-    IndexType        start;
-    CIndexType       startcindex;
-    CIndexType       endcindex;
-    FixedImageType * fixedImageAtLevel = this->m_FixedImagePyramid->GetOutput( level );
+    SizeType               size;
+    IndexType              start;
+    CIndexType             startcindex;
+    CIndexType             endcindex;
+    const FixedImageType * fixedImageAtLevel = this->GetFixedImageAtLevel( level );
     /** map the original fixed image region to the image resulting from the
      * FixedImagePyramid at level l.
      * To be on the safe side, the start point is ceiled, and the end point is
@@ -273,6 +277,65 @@ MultiResolutionImageRegistrationMethod2< TFixedImage, TMovingImage >
 } // end PreparePyramids()
 
 
+/*
+ * Set the precomputed outputs of a fixed image pyramid
+ */
+template< typename TFixedImage, typename TMovingImage >
+void
+MultiResolutionImageRegistrationMethod2< TFixedImage, TMovingImage >
+::SetFixedImagePyramidOutputs( const FixedImagePyramidOutputsType & outputs,
+  unsigned int pos )
+{
+  for( unsigned int level = 0; level < outputs.size(); ++level )
+  {
+    if( outputs[ level ].IsNull() )
+    {
+      itkExceptionMacro( << "The fixed image pyramid output of level " << level
+                         << " of pyramid " << pos << " is not present" );
+    }
+  }
+
+  if( pos >= this->m_FixedImagePyramidOutputs.size() )
+  {
+    this->m_FixedImagePyramidOutputs.resize( pos + 1 );
+  }
+  this->m_FixedImagePyramidOutputs[ pos ] = outputs;
+  this->Modified();
+
+} // end SetFixedImagePyramidOutputs()
+
+
+/*
+ * Check for precomputed outputs of a fixed image pyramid
+ */
+template< typename TFixedImage, typename TMovingImage >
+bool
+MultiResolutionImageRegistrationMethod2< TFixedImage, TMovingImage >
+::HasFixedImagePyramidOutputs( unsigned int pos ) const
+{
+  return pos < this->m_FixedImagePyramidOutputs.size()
+         && this->m_FixedImagePyramidOutputs[ pos ].size() == this->m_NumberOfLevels;
+
+} // end HasFixedImagePyramidOutputs()
+
+
+/*
+ * Get the fixed image at a level
+ */
+template< typename TFixedImage, typename TMovingImage >
+const typename MultiResolutionImageRegistrationMethod2< TFixedImage, TMovingImage >::FixedImageType
+* MultiResolutionImageRegistrationMethod2< TFixedImage, TMovingImage >
+::GetFixedImageAtLevel( unsigned long level, unsigned int pos ) const
+{
+  if( this->HasFixedImagePyramidOutputs( pos ) )
+  {
+    return this->m_FixedImagePyramidOutputs[ pos ][ level ].GetPointer();
+  }
+  return this->m_FixedImagePyramid->GetOutput( level );
+
+} // end GetFixedImageAtLevel()
+
+
 /*
  * Starts the Registration Process
  */
@@ -382,6 +445,12 @@ MultiResolutionImageRegistrationMethod2< TFixedImage, TMovingImage >
      << this->m_FixedImagePyramid.GetPointer() << std::endl;
   os << indent << "MovingImagePyramid: "
      << this->m_MovingImagePyramid.GetPointer() << std::endl;
+  os << indent << "FixedImagePyramidOutputs: ";
+  for( unsigned int pos = 0; pos < this->m_FixedImagePyramidOutputs.size(); ++pos )
+  {
+    os << this->m_FixedImagePyramidOutputs[ pos ].size() << " ";
+  }
+  os << std::endl;
 
   os << indent << "NumberOfLevels: " << this->m_NumberOfLevels << std::endl;
   os << indent << "CurrentLevel: " << this->m_CurrentLevel << std::endl;
@@ -24,6 +24,8 @@
 #include "itkBSplineDerivativeKernelFunction2.h"
 #include "itkBSplineSecondOrderDerivativeKernelFunction2.h"
 
+#include <vector>
+
 namespace itk
 {
 /** Recursive template to retrieve the number of B-spline indices at compile time. */
@@ -142,6 +144,37 @@ public:
   void EvaluateSecondOrderDerivative( const ContinuousIndexType & index,
     WeightsType & weights, const IndexType & startIndex ) const;
 
+  /** Precompute the 1D weights, derivative weights and second order
+   * derivative weights for a lattice of continuous indices. Along dimension i
+   * the lattice points are firstIndex[ i ] + k / period[ i ], for any integer
+   * k, so for a B-spline grid spacing that is period[ i ] times the spacing
+   * of the samples. The weights of such points then repeat with the period,
+   * and the Evaluate functions look them up instead of evaluating the
+   * kernels. Continuous indices that are not on the lattice are evaluated
+   * as usual, so the tables never change the result, only the speed.
+   * Tables can be added for several lattices; adding the tables of a
+   * lattice that already has tables does nothing.
+   */
+  void AddWeightTables( const ContinuousIndexType & firstIndex,
+    const SizeType & period );
+
+  /** Remove the weight tables of all lattices. */
+  void ClearWeightTables( void );
+
+  /** Whether weight tables are computed. */
+  bool GetUseWeightTables( void ) const
+  {
+    return !this->m_WeightTables.empty();
+  }
+
+
+  /** The number of lattices with weight tables. */
+  unsigned int GetNumberOfWeightTables( void ) const
+  {
+    return static_cast< unsigned int >( this->m_WeightTables.size() );
+  }
+
+
 protected:
 
   RecursiveBSplineInterpolationWeightFunction();
@@ -168,6 +201,33 @@ private:
   typename DerivativeKernelType::Pointer m_DerivativeKernel;
   typename SecondOrderDerivativeKernelType::Pointer m_SecondOrderDerivativeKernel;
 
+  /** The weight tables of one lattice. Per dimension period[ i ] rows of
+   * SplineOrder + 1 weights.
+   */
+  typedef typename WeightsType::ValueType WeightsValueType;
+  typedef std::vector< WeightsValueType > WeightTableType;
+  typedef std::vector< IndexValueType >   StartIndexTableType;
+  struct WeightTablesType
+  {
+    ContinuousIndexType m_FirstIndex;
+    SizeType            m_Period;
+    double              m_InversePeriod[ VSpaceDimension ];
+    WeightTableType     m_Weights[ VSpaceDimension ];
+    WeightTableType     m_DerivativeWeights[ VSpaceDimension ];
+    WeightTableType     m_SecondOrderDerivativeWeights[ VSpaceDimension ];
+    StartIndexTableType m_StartIndices[ VSpaceDimension ];
+  };
+
+  std::vector< WeightTablesType > m_WeightTables;
+
+  /** Find the weight tables of which the lattice contains the continuous
+   * index cindex[ i ] along dimension i, the row of that index, and the
+   * corresponding start index of the support region. Returns 0 if the
+   * continuous index is not on the lattice of any of the tables.
+   */
+  const WeightTablesType * LookUpWeightTable( const unsigned int i, const double cindex,
+    unsigned int & row, IndexValueType & startIndex ) const;
+
 };
 
 } // end namespace itk
@@ -25,6 +25,9 @@
 #include "itkMath.h"
 #include "itkImageRegionConstIteratorWithIndex.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace itk
 {
 
@@ -66,6 +69,12 @@ RecursiveBSplineInterpolationWeightFunction< TCoordRep, VSpaceDimension, VSpline
 
   os << indent << "NumberOfWeights: " << m_NumberOfWeights << std::endl;
   os << indent << "SupportSize: " << m_SupportSize << std::endl;
+  os << indent << "NumberOfWeightTables: " << m_WeightTables.size() << std::endl;
+  for( unsigned int k = 0; k < m_WeightTables.size(); ++k )
+  {
+    os << indent << "WeightTables[" << k << "]: FirstIndex " << m_WeightTables[ k ].m_FirstIndex
+       << ", Period " << m_WeightTables[ k ].m_Period << std::endl;
+  }
 } // end PrintSelf()
 
 
@@ -102,6 +111,18 @@ RecursiveBSplineInterpolationWeightFunction< TCoordRep, VSpaceDimension, VSpline
   typename WeightsType::ValueType * weightsPtr = &weights[ 0 ];
   for( unsigned int i = 0; i < SpaceDimension; ++i )
   {
+    /** Copy the weights from the table, if the index is on its lattice. */
+    unsigned int             row;
+    const WeightTablesType * tables = this->m_WeightTables.empty() ? 0
+      : this->LookUpWeightTable( i, cindex[ i ], row, startIndex[ i ] );
+    if( tables )
+    {
+      const WeightsValueType * tablePtr = &tables->m_Weights[ i ][ row * ( SplineOrder + 1 ) ];
+      std::copy( tablePtr, tablePtr + SplineOrder + 1, weightsPtr );
+      weightsPtr += SplineOrder + 1;
+      continue;
+    }
+
     startIndex[ i ] = Math::Floor< IndexValueType >(
       cindex[ i ] - static_cast< double >( SplineOrder - 1 ) / 2.0 );
 
@@ -127,6 +148,17 @@ RecursiveBSplineInterpolationWeightFunction< TCoordRep, VSpaceDimension, VSpline
 {
   for( unsigned int i = 0; i < SpaceDimension; ++i )
   {
+    unsigned int             row;
+    IndexValueType           tableStartIndex;
+    const WeightTablesType * tables = this->m_WeightTables.empty() ? 0
+      : this->LookUpWeightTable( i, cindex[ i ], row, tableStartIndex );
+    if( tables && tableStartIndex == startIndex[ i ] )
+    {
+      const WeightsValueType * tablePtr = &tables->m_DerivativeWeights[ i ][ row * ( SplineOrder + 1 ) ];
+      std::copy( tablePtr, tablePtr + SplineOrder + 1, &derivativeWeights[ i * this->m_SupportSize[ i ] ] );
+      continue;
+    }
+
     double x = cindex[ i ] - static_cast< double >( startIndex[ i ] );
     this->m_DerivativeKernel->Evaluate( x, &derivativeWeights[ i * this->m_SupportSize[ i ] ] );
   }
@@ -147,12 +179,138 @@ RecursiveBSplineInterpolationWeightFunction< TCoordRep, VSpaceDimension, VSpline
 {
   for( unsigned int i = 0; i < SpaceDimension; ++i )
   {
+    unsigned int             row;
+    IndexValueType           tableStartIndex;
+    const WeightTablesType * tables = this->m_WeightTables.empty() ? 0
+      : this->LookUpWeightTable( i, cindex[ i ], row, tableStartIndex );
+    if( tables && tableStartIndex == startIndex[ i ] )
+    {
+      const WeightsValueType * tablePtr = &tables->m_SecondOrderDerivativeWeights[ i ][ row * ( SplineOrder + 1 ) ];
+      std::copy( tablePtr, tablePtr + SplineOrder + 1, &hessianWeights[ i * this->m_SupportSize[ i ] ] );
+      continue;
+    }
+
     double x = cindex[ i ] - static_cast< double >( startIndex[ i ] );
     this->m_SecondOrderDerivativeKernel->Evaluate( x, &hessianWeights[ i * this->m_SupportSize[ i ] ] );
   }
 } // end EvaluateSecondOrderDerivative()
 
 
+/**
+ * ********************* AddWeightTables ****************************
+ */
+
+template< typename TCoordRep, unsigned int VSpaceDimension, unsigned int VSplineOrder >
+void
+RecursiveBSplineInterpolationWeightFunction< TCoordRep, VSpaceDimension, VSplineOrder >
+::AddWeightTables( const ContinuousIndexType & firstIndex, const SizeType & period )
+{
+  /** Check whether the lattice already has tables. */
+  for( unsigned int k = 0; k < this->m_WeightTables.size(); ++k )
+  {
+    if( this->m_WeightTables[ k ].m_FirstIndex == firstIndex
+      && this->m_WeightTables[ k ].m_Period == period )
+    {
+      return;
+    }
+  }
+
+  WeightTablesType tables;
+  tables.m_FirstIndex = firstIndex;
+  tables.m_Period     = period;
+
+  for( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    if( period[ i ] == 0 )
+    {
+      itkExceptionMacro( << "The period of the weight tables should be positive." );
+    }
+    tables.m_InversePeriod[ i ] = 1.0 / static_cast< double >( period[ i ] );
+    tables.m_Weights[ i ].resize( period[ i ] * ( SplineOrder + 1 ) );
+    tables.m_DerivativeWeights[ i ].resize( period[ i ] * ( SplineOrder + 1 ) );
+    tables.m_SecondOrderDerivativeWeights[ i ].resize( period[ i ] * ( SplineOrder + 1 ) );
+    tables.m_StartIndices[ i ].resize( period[ i ] );
+
+    /** Evaluate the kernels at the lattice points of the first period.
+     * The other lattice points differ an integer from these.
+     */
+    for( unsigned int row = 0; row < period[ i ]; ++row )
+    {
+      const double cindex = firstIndex[ i ]
+        + static_cast< double >( row ) * tables.m_InversePeriod[ i ];
+      const IndexValueType startIndex = Math::Floor< IndexValueType >(
+        cindex - static_cast< double >( SplineOrder - 1 ) / 2.0 );
+      const double x = cindex - static_cast< double >( startIndex );
+
+      tables.m_StartIndices[ i ][ row ] = startIndex;
+      this->m_Kernel->Evaluate( x, &tables.m_Weights[ i ][ row * ( SplineOrder + 1 ) ] );
+      this->m_DerivativeKernel->Evaluate( x, &tables.m_DerivativeWeights[ i ][ row * ( SplineOrder + 1 ) ] );
+      this->m_SecondOrderDerivativeKernel->Evaluate( x,
+        &tables.m_SecondOrderDerivativeWeights[ i ][ row * ( SplineOrder + 1 ) ] );
+    }
+  }
+
+  this->m_WeightTables.push_back( tables );
+
+} // end AddWeightTables()
+
+
+/**
+ * ********************* ClearWeightTables ****************************
+ */
+
+template< typename TCoordRep, unsigned int VSpaceDimension, unsigned int VSplineOrder >
+void
+RecursiveBSplineInterpolationWeightFunction< TCoordRep, VSpaceDimension, VSplineOrder >
+::ClearWeightTables( void )
+{
+  std::vector< WeightTablesType >().swap( this->m_WeightTables );
+
+} // end ClearWeightTables()
+
+
+/**
+ * ********************* LookUpWeightTable ****************************
+ */
+
+template< typename TCoordRep, unsigned int VSpaceDimension, unsigned int VSplineOrder >
+inline const typename RecursiveBSplineInterpolationWeightFunction< TCoordRep, VSpaceDimension, VSplineOrder >
+::WeightTablesType *
+RecursiveBSplineInterpolationWeightFunction< TCoordRep, VSpaceDimension, VSplineOrder >
+::LookUpWeightTable( const unsigned int i, const double cindex,
+  unsigned int & row, IndexValueType & startIndex ) const
+{
+  for( unsigned int k = 0; k < this->m_WeightTables.size(); ++k )
+  {
+    const WeightTablesType & tables = this->m_WeightTables[ k ];
+
+    /** The position on the lattice, in units of the lattice spacing. The
+     * tolerance only absorbs the rounding errors of the point coordinates.
+     */
+    const double period       = static_cast< double >( tables.m_Period[ i ] );
+    const double position     = ( cindex - tables.m_FirstIndex[ i ] ) * period;
+    const double latticePoint = std::floor( position + 0.5 );
+    if( std::abs( position - latticePoint ) > 1e-8 )
+    {
+      continue;
+    }
+
+    /** Split the lattice point in the number of periods and the row. */
+    const double periods  = std::floor( latticePoint * tables.m_InversePeriod[ i ] );
+    const double rowValue = latticePoint - periods * period;
+    if( rowValue < 0.0 || rowValue >= period )
+    {
+      continue;
+    }
+    row        = static_cast< unsigned int >( rowValue );
+    startIndex = tables.m_StartIndices[ i ][ row ] + static_cast< IndexValueType >( periods );
+    return &tables;
+  }
+  return 0;
+
+} // end LookUpWeightTable()
+
+
 } // end namespace itk
 
 #endif
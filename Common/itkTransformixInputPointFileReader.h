@@ -22,6 +22,7 @@
 #include "itkMeshFileReaderBase.h"
 
 #include <fstream>
+#include <vector>
 
 namespace itk
 {
@@ -40,6 +41,18 @@ namespace itk
  *
  * The second word in the text file represents the number of points that
  * should be read.
+ *
+ * The coordinates are parsed with a locale-free parser, reading the file
+ * in blocks. Alternatively, the points can be given in a raw binary file,
+ * which starts with an 8 character tag "elxpoint" or "elxindex", followed
+ * by the number of points as a 64-bit unsigned integer and the point
+ * dimension as a 32-bit unsigned integer. Then the coordinates of all
+ * points follow, as 64-bit floating point values. All numbers are stored
+ * in little endian byte order.
+ *
+ * Besides reading all points with Update(), the points can be read in
+ * chunks with ReadNextPoints(), after calling UpdateOutputInformation().
+ * This keeps the memory bounded for very large point files.
  **/
 
 template< class TOutputMesh >
@@ -63,6 +76,8 @@ public:
   typedef typename Superclass::DataObjectPointer DatabObjectPointer;
   typedef typename Superclass::OutputMeshType    OutputMeshType;
   typedef typename Superclass::OutputMeshPointer OutputMeshPointer;
+  typedef typename OutputMeshType::PointType     PointType;
+  typedef std::vector< PointType >               PointVectorType;
 
   /** Get whether the read points are indices; actually we should store this as a kind
    * of meta data in the output, but i don't understand this concept yet...
@@ -87,6 +102,17 @@ public:
    */
   virtual void GenerateOutputInformation( void );
 
+  /** Get whether the points are stored in the raw binary format. */
+  itkGetConstMacro( PointsAreBinary, bool );
+
+  /** Read the next numberOfPoints points of the file, or the remaining
+   * points when there are less. Call UpdateOutputInformation() first.
+   * Returns the number of points that is read. Throws an exception when
+   * the file does not contain the number of points of its header.
+   */
+  virtual unsigned long ReadNextPoints( PointVectorType & points,
+    const unsigned long numberOfPoints );
+
 protected:
 
   TransformixInputPointFileReader();
@@ -97,14 +123,41 @@ protected:
 
   unsigned long m_NumberOfPoints;
   bool          m_PointsAreIndices;
+  bool          m_PointsAreBinary;
 
   std::ifstream m_Reader;
 
+  /** Get the next white space separated word of the text file. The word is
+   * valid until the next call. Returns false at the end of the file.
+   */
+  bool ReadWord( const char * & wordBegin, const char * & wordEnd );
+
+  /** Check for the white space that separates the words. */
+  static bool IsWhiteSpace( const char c )
+  {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+  }
+
+
+  /** Convert a word to a double, independent of the locale. */
+  static bool ParseValue( const char * wordBegin, const char * wordEnd, double & value );
+
+  /** Throw an exception that the file does not contain enough points. */
+  void ThrowFileTooSmallException( void ) const;
+
 private:
 
   TransformixInputPointFileReader( const Self & ); // purposely not implemented
   void operator=( const Self & );                  // purposely not implemented
 
+  /** The number of points that has been read by ReadNextPoints(). */
+  unsigned long m_NumberOfPointsRead;
+
+  /** The block of the text file that is being parsed. */
+  std::vector< char > m_Buffer;
+  std::size_t         m_BufferPosition;
+  std::size_t         m_BufferSize;
+
 };
 
 } // end namespace itk
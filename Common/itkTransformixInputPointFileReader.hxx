@@ -15,11 +15,17 @@
  *  limitations under the License.
  *
  *=========================================================================*/
-
 #ifndef __itkTransformixInputPointFileReader_hxx
 #define __itkTransformixInputPointFileReader_hxx
 
 #include "itkTransformixInputPointFileReader.h"
+#include "itkByteSwapper.h"
+#include "itkIntTypes.h"
+
+#include <algorithm>
+#include <cstring>
+#include <locale>
+#include <sstream>
 
 namespace itk
 {
@@ -32,8 +38,12 @@ template< class TOutputMesh >
 TransformixInputPointFileReader< TOutputMesh >
 ::TransformixInputPointFileReader()
 {
-  this->m_NumberOfPoints   = 0;
-  this->m_PointsAreIndices = false;
+  this->m_NumberOfPoints     = 0;
+  this->m_PointsAreIndices   = false;
+  this->m_PointsAreBinary    = false;
+  this->m_NumberOfPointsRead = 0;
+  this->m_BufferPosition     = 0;
+  this->m_BufferSize         = 0;
 } // end constructor
 
 
@@ -69,7 +79,46 @@ TransformixInputPointFileReader< TOutputMesh >
   {
     this->m_Reader.close();
   }
-  this->m_Reader.open( this->m_FileName.c_str() );
+  this->m_Reader.clear();
+  this->m_Reader.open( this->m_FileName.c_str(), std::ios::in | std::ios::binary );
+  this->m_NumberOfPointsRead = 0;
+  this->m_BufferPosition     = 0;
+  this->m_BufferSize         = 0;
+
+  /** Check for the tag of the binary format. */
+  char tag[ 8 ];
+  this->m_Reader.read( tag, 8 );
+  const std::string tagString( tag, static_cast< std::size_t >( this->m_Reader.gcount() ) );
+  if( tagString == "elxpoint" || tagString == "elxindex" )
+  {
+    this->m_PointsAreBinary  = true;
+    this->m_PointsAreIndices = ( tagString == "elxindex" );
+
+    /** Read the number of points and the dimension. */
+    uint64_t numberOfPoints = 0;
+    uint32_t dimension      = 0;
+    this->m_Reader.read( reinterpret_cast< char * >( &numberOfPoints ), sizeof( numberOfPoints ) );
+    this->m_Reader.read( reinterpret_cast< char * >( &dimension ), sizeof( dimension ) );
+    ByteSwapper< uint64_t >::SwapFromSystemToLittleEndian( &numberOfPoints );
+    ByteSwapper< uint32_t >::SwapFromSystemToLittleEndian( &dimension );
+    if( !this->m_Reader || dimension != OutputMeshType::PointDimension )
+    {
+      std::ostringstream msg;
+      msg << "The binary point file has dimension " << dimension
+          << " instead of " << OutputMeshType::PointDimension << ". "
+          << std::endl << "Filename: " << this->m_FileName
+          << std::endl;
+      MeshFileReaderException e( __FILE__, __LINE__, msg.str().c_str(), ITK_LOCATION );
+      throw e;
+    }
+    this->m_NumberOfPoints = static_cast< unsigned long >( numberOfPoints );
+    return;
+  }
+
+  /** A text file: start at the beginning again. */
+  this->m_PointsAreBinary = false;
+  this->m_Reader.clear();
+  this->m_Reader.seekg( 0 );
 
   /** Read the first entry */
   std::string indexOrPoint;
@@ -111,64 +160,325 @@ TransformixInputPointFileReader< TOutputMesh >
 {
   typedef typename OutputMeshType::PointsContainer PointsContainerType;
   typedef typename PointsContainerType::Pointer    PointsContainerPointer;
-  typedef typename OutputMeshType::PointType       PointType;
-  const unsigned int dimension = OutputMeshType::PointDimension;
 
   OutputMeshPointer      output = this->GetOutput();
   PointsContainerPointer points = PointsContainerType::New();
 
   /** Read the file */
-  if( this->m_Reader.is_open() )
+  this->ReadNextPoints( points->CastToSTLContainer(), this->m_NumberOfPoints );
+
+  /** set in output */
+  output->Initialize();
+  output->SetPoints( points );
+
+  /** Close the reader */
+  this->m_Reader.close();
+
+  /** This indicates that the current BufferedRegion is equal to the
+   * requested region. This action prevents useless re-executions of
+   * the pipeline.
+   * (I copied this from the BinaryMaskToNarrowBandPointSetFilter) */
+  output->SetBufferedRegion( output->GetRequestedRegion() );
+
+} // end GenerateData()
+
+
+/**
+ * *************** ReadNextPoints ***********
+ */
+
+template< class TOutputMesh >
+unsigned long
+TransformixInputPointFileReader< TOutputMesh >
+::ReadNextPoints( PointVectorType & points, const unsigned long numberOfPoints )
+{
+  const unsigned int dimension = OutputMeshType::PointDimension;
+
+  if( !this->m_Reader.is_open() )
+  {
+    std::ostringstream msg;
+    msg << "The file has unexpectedly been closed. "
+        << std::endl << "Filename: " << this->m_FileName
+        << std::endl;
+    MeshFileReaderException e( __FILE__, __LINE__, msg.str().c_str(), ITK_LOCATION );
+    throw e;
+  }
+
+  const unsigned long n = std::min( numberOfPoints,
+    this->m_NumberOfPoints - this->m_NumberOfPointsRead );
+  points.resize( n );
+  if( n == 0 )
   {
-    for( unsigned int i = 0; i < this->m_NumberOfPoints; ++i )
+    return 0;
+  }
+
+  if( this->m_PointsAreBinary )
+  {
+    /** Read all coordinates of the chunk at once. */
+    std::vector< double > values( n * dimension );
+    const std::size_t     numberOfBytes = values.size() * sizeof( double );
+    this->m_Reader.read( reinterpret_cast< char * >( &values[ 0 ] ), numberOfBytes );
+    if( static_cast< std::size_t >( this->m_Reader.gcount() ) != numberOfBytes )
     {
-      // read point from textfile
-      PointType point;
-      for( unsigned int j = 0; j < dimension; j++ )
+      this->ThrowFileTooSmallException();
+    }
+    ByteSwapper< double >::SwapRangeFromSystemToLittleEndian( &values[ 0 ], values.size() );
+    for( unsigned long i = 0; i < n; ++i )
+    {
+      for( unsigned int j = 0; j < dimension; ++j )
       {
-        if( !this->m_Reader.eof() )
+        points[ i ][ j ] = values[ i * dimension + j ];
+      }
+    }
+  }
+  else
+  {
+    for( unsigned long i = 0; i < n; ++i )
+    {
+      for( unsigned int j = 0; j < dimension; ++j )
+      {
+        const char * wordBegin = 0;
+        const char * wordEnd   = 0;
+        if( !this->ReadWord( wordBegin, wordEnd ) )
         {
-          this->m_Reader >> point[ j ];
+          this->ThrowFileTooSmallException();
         }
-        else
+        double value = 0.0;
+        if( !ParseValue( wordBegin, wordEnd, value ) )
         {
           std::ostringstream msg;
-          msg << "The file is not large enough. "
+          msg << "The coordinate \"" << std::string( wordBegin, wordEnd )
+              << "\" of point " << this->m_NumberOfPointsRead + i << " is not a number. "
               << std::endl << "Filename: " << this->m_FileName
               << std::endl;
           MeshFileReaderException e( __FILE__, __LINE__, msg.str().c_str(), ITK_LOCATION );
           throw e;
-          return;
         }
+        points[ i ][ j ] = value;
       }
-      points->push_back( point );
     }
   }
-  else
+
+  this->m_NumberOfPointsRead += n;
+  return n;
+
+} // end ReadNextPoints()
+
+
+/**
+ * *************** ReadWord ***********
+ */
+
+template< class TOutputMesh >
+bool
+TransformixInputPointFileReader< TOutputMesh >
+::ReadWord( const char * & wordBegin, const char * & wordEnd )
+{
+  if( this->m_Buffer.empty() )
   {
-    std::ostringstream msg;
-    msg << "The file has unexpectedly been closed. "
-        << std::endl << "Filename: " << this->m_FileName
-        << std::endl;
-    MeshFileReaderException e( __FILE__, __LINE__, msg.str().c_str(), ITK_LOCATION );
-    throw e;
-    return;
+    this->m_Buffer.resize( 65536 );
   }
 
-  /** set in output */
-  output->Initialize();
-  output->SetPoints( points );
+  /** Skip the white space, and read the next block when needed. */
+  for(;; )
+  {
+    while( this->m_BufferPosition < this->m_BufferSize
+      && IsWhiteSpace( this->m_Buffer[ this->m_BufferPosition ] ) )
+    {
+      ++this->m_BufferPosition;
+    }
+    if( this->m_BufferPosition < this->m_BufferSize )
+    {
+      break;
+    }
+    this->m_Reader.read( &this->m_Buffer[ 0 ], this->m_Buffer.size() );
+    this->m_BufferPosition = 0;
+    this->m_BufferSize     = static_cast< std::size_t >( this->m_Reader.gcount() );
+    if( this->m_BufferSize == 0 )
+    {
+      return false;
+    }
+  }
 
-  /** Close the reader */
-  this->m_Reader.close();
+  /** Find the end of the word. When the word continues in the next block,
+   * it is moved to the start of the buffer, and the next block is appended.
+   */
+  std::size_t end = this->m_BufferPosition;
+  for(;; )
+  {
+    while( end < this->m_BufferSize && !IsWhiteSpace( this->m_Buffer[ end ] ) )
+    {
+      ++end;
+    }
+    if( end < this->m_BufferSize )
+    {
+      break;
+    }
 
-  /** This indicates that the current BufferedRegion is equal to the
-   * requested region. This action prevents useless re-executions of
-   * the pipeline.
-   * (I copied this from the BinaryMaskToNarrowBandPointSetFilter) */
-  output->SetBufferedRegion( output->GetRequestedRegion() );
+    const std::size_t length = end - this->m_BufferPosition;
+    if( this->m_BufferPosition > 0 )
+    {
+      std::memmove( &this->m_Buffer[ 0 ], &this->m_Buffer[ this->m_BufferPosition ], length );
+    }
+    if( length == this->m_Buffer.size() )
+    {
+      this->m_Buffer.resize( 2 * this->m_Buffer.size() );
+    }
+    this->m_Reader.read( &this->m_Buffer[ length ], this->m_Buffer.size() - length );
+    const std::size_t numberOfBytesRead = static_cast< std::size_t >( this->m_Reader.gcount() );
+    this->m_BufferPosition = 0;
+    this->m_BufferSize     = length + numberOfBytesRead;
+    end                    = length;
+    if( numberOfBytesRead == 0 )
+    {
+      break;
+    }
+  }
 
-} // end GenerateData()
+  wordBegin              = &this->m_Buffer[ 0 ] + this->m_BufferPosition;
+  wordEnd                = &this->m_Buffer[ 0 ] + end;
+  this->m_BufferPosition = end;
+  return true;
+
+} // end ReadWord()
+
+
+/**
+ * *************** ParseValue ***********
+ */
+
+template< class TOutputMesh >
+bool
+TransformixInputPointFileReader< TOutputMesh >
+::ParseValue( const char * wordBegin, const char * wordEnd, double & value )
+{
+  /** The powers of ten that are exactly representable as a double. */
+  static const double powersOfTen[ 23 ] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+
+  /** Read the sign. */
+  const char * p        = wordBegin;
+  bool         negative = false;
+  if( p != wordEnd && ( *p == '-' || *p == '+' ) )
+  {
+    negative = ( *p == '-' );
+    ++p;
+  }
+
+  /** Read the digits into an integer mantissa and a decimal exponent. */
+  uint64_t mantissa          = 0;
+  int      significantDigits = 0;
+  int      exponent          = 0;
+  bool     hasDigits         = false;
+  for( ; p != wordEnd && *p >= '0' && *p <= '9'; ++p )
+  {
+    hasDigits = true;
+    if( significantDigits < 19 )
+    {
+      mantissa = 10 * mantissa + ( *p - '0' );
+      if( mantissa != 0 )
+      {
+        ++significantDigits;
+      }
+    }
+    else
+    {
+      ++significantDigits;
+      ++exponent;
+    }
+  }
+  if( p != wordEnd && *p == '.' )
+  {
+    ++p;
+    for( ; p != wordEnd && *p >= '0' && *p <= '9'; ++p )
+    {
+      hasDigits = true;
+      if( significantDigits < 19 )
+      {
+        mantissa = 10 * mantissa + ( *p - '0' );
+        if( mantissa != 0 )
+        {
+          ++significantDigits;
+        }
+        --exponent;
+      }
+      else
+      {
+        ++significantDigits;
+      }
+    }
+  }
+
+  /** Read the exponent. */
+  bool isSimple = hasDigits;
+  if( isSimple && p != wordEnd && ( *p == 'e' || *p == 'E' ) )
+  {
+    ++p;
+    bool negativeExponent = false;
+    if( p != wordEnd && ( *p == '-' || *p == '+' ) )
+    {
+      negativeExponent = ( *p == '-' );
+      ++p;
+    }
+    int  e           = 0;
+    bool hasExponent = false;
+    for( ; p != wordEnd && *p >= '0' && *p <= '9'; ++p )
+    {
+      hasExponent = true;
+      if( e < 10000 )
+      {
+        e = 10 * e + ( *p - '0' );
+      }
+    }
+    isSimple  = hasExponent;
+    exponent += negativeExponent ? -e : e;
+  }
+
+  /** When the mantissa and the power of ten are exactly representable,
+   * one multiplication or division gives the correctly rounded value.
+   */
+  if( isSimple && p == wordEnd && significantDigits <= 15
+    && exponent >= -22 && exponent <= 22 )
+  {
+    value = static_cast< double >( mantissa );
+    value = exponent < 0 ? value / powersOfTen[ -exponent ] : value * powersOfTen[ exponent ];
+    value = negative ? -value : value;
+    return true;
+  }
+
+  /** Otherwise use a stream with the classic locale. */
+  std::istringstream stream( std::string( wordBegin, wordEnd ) );
+  stream.imbue( std::locale::classic() );
+  stream >> value;
+  if( stream.fail() )
+  {
+    return false;
+  }
+  char rest;
+  return !( stream >> rest );
+
+} // end ParseValue()
+
+
+/**
+ * *************** ThrowFileTooSmallException ***********
+ */
+
+template< class TOutputMesh >
+void
+TransformixInputPointFileReader< TOutputMesh >
+::ThrowFileTooSmallException( void ) const
+{
+  std::ostringstream msg;
+  msg << "The file is not large enough. "
+      << std::endl << "Filename: " << this->m_FileName
+      << std::endl;
+  MeshFileReaderException e( __FILE__, __LINE__, msg.str().c_str(), ITK_LOCATION );
+  throw e;
+
+} // end ThrowFileTooSmallException()
 
 
 } // end namespace itk
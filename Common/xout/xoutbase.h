@@ -97,6 +97,52 @@ public:
   }
 
 
+  /** Floating point values are also passed to ReceiveValue(), so that
+   * derived classes can keep them at full precision.
+   */
+  Self & operator<<( const double & _arg )
+  {
+    this->ReceiveValue( _arg );
+    return this->SendToTargets( _arg );
+  }
+
+
+  Self & operator<<( const float & _arg )
+  {
+    this->ReceiveValue( _arg );
+    return this->SendToTargets( _arg );
+  }
+
+
+  /** Integer values are passed to ReceiveInteger(). */
+  Self & operator<<( const int & _arg )
+  {
+    this->ReceiveInteger( _arg );
+    return this->SendToTargets( _arg );
+  }
+
+
+  Self & operator<<( const unsigned int & _arg )
+  {
+    this->ReceiveInteger( _arg );
+    return this->SendToTargets( _arg );
+  }
+
+
+  Self & operator<<( const long & _arg )
+  {
+    this->ReceiveInteger( static_cast< double >( _arg ) );
+    return this->SendToTargets( _arg );
+  }
+
+
+  Self & operator<<( const unsigned long & _arg )
+  {
+    this->ReceiveInteger( static_cast< double >( _arg ) );
+    return this->SendToTargets( _arg );
+  }
+
+
   Self & operator<<( ostream_type & (* pf)( ostream_type  & ) )
   {
     return this->SendToTargets( pf );
@@ -168,6 +214,14 @@ protected:
   /** Called each time << is used, but only when m_Call == true; */
   virtual void Callback( void ){}
 
+  /** Called each time a floating point value is passed with <<. */
+  virtual void ReceiveValue( const double & /** value */ ){}
+
+  /** Called each time an integer value is passed with <<. The value is
+   * passed as a double, which is exact up to 2^53.
+   */
+  virtual void ReceiveInteger( const double & /** value */ ){}
+
   template< class T >
   Self & SendToTargets( const T & _arg )
   {
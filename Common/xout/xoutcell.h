@@ -70,10 +70,45 @@ public:
   /** Write the buffered cell data to the outputs. */
   virtual void WriteBufferedData( void );
 
+  /** Write the buffered cell data in binary form to a stream, without
+   * emptying the buffer. A cell that only received a single number stores
+   * the value that was passed to it, together with its formatting, so the
+   * formatted text is not parsed again. Anything else is stored as text.
+   * The record is read back by xoutrow::ConvertBinaryToText().
+   */
+  virtual void WriteBinaryData( ostream_type & output );
+
+  /** The kinds of binary cell records. */
+  enum BinaryKindType { TextKind = 0, FloatKind = 1, IntegerKind = 2 };
+
+  /** The formatting flags of a FloatKind record. */
+  enum BinaryFlagsType { FixedFlag = 1, ScientificFlag = 2, ShowPointFlag = 4 };
+
 protected:
 
+  /** Remember a floating point or integer value that is sent to this cell. */
+  virtual void ReceiveValue( const double & value );
+
+  virtual void ReceiveInteger( const double & value );
+
+  /** Remember where the text of the last received value ends. */
+  virtual void Callback( void );
+
   InternalBufferType m_InternalBuffer;
 
+  /** The last received value, its formatting, and the position of its
+   * text in the internal buffer. m_NumberOfValues counts the values
+   * received since the last call to WriteBufferedData().
+   */
+  double             m_Value;
+  bool               m_ValueIsInteger;
+  ios_base::fmtflags m_ValueFlags;
+  std::streamsize    m_ValuePrecision;
+  std::streamoff     m_ValueBegin;
+  std::streamoff     m_ValueEnd;
+  bool               m_ValuePending;
+  unsigned int       m_NumberOfValues;
+
 };
 
 } // end namespace xoutlibrary
@@ -32,6 +32,17 @@ template< class charT, class traits >
 xoutcell< charT, traits >::xoutcell()
 {
   this->AddTargetCell( "InternalBuffer", &( this->m_InternalBuffer ) );
+  this->m_Value          = 0.0;
+  this->m_ValueIsInteger = false;
+  this->m_ValueFlags     = this->m_InternalBuffer.flags();
+  this->m_ValuePrecision = this->m_InternalBuffer.precision();
+  this->m_ValueBegin     = 0;
+  this->m_ValueEnd       = 0;
+  this->m_ValuePending   = false;
+  this->m_NumberOfValues = 0;
+
+  /** Call Callback() after each <<, to find the end of a value. */
+  this->m_Call = true;
 
 }   // end Constructor
 
@@ -65,11 +76,13 @@ xoutcell< charT, traits >::WriteBufferedData( void )
 
   const char * charbuf = strbuf.c_str();
 
-  /** Send the string to the outputs */
+  /** Send the string to the outputs. Flushing is left to the caller,
+   * since a cell is usually only part of a line.
+   */
   for( CStreamMapIteratorType cit = this->m_COutputs.begin();
     cit != this->m_COutputs.end(); ++cit )
   {
-    *( cit->second ) << charbuf << flush;
+    *( cit->second ) << charbuf;
   }
 
   /** Send the string to the outputs */
@@ -82,10 +95,120 @@ xoutcell< charT, traits >::WriteBufferedData( void )
 
   /** Empty the internal buffer */
   this->m_InternalBuffer.str( string( "" ) );
+  this->m_NumberOfValues = 0;
 
 }   // end WriteBufferedData
 
 
+/**
+ * ******************** WriteBinaryData *************************
+ */
+
+template< class charT, class traits >
+void
+xoutcell< charT, traits >::WriteBinaryData( ostream_type & output )
+{
+  /** The cell holds a number if a single value was received,
+   * and the buffer contains nothing but its text.
+   */
+  const std::streamoff size     = this->m_InternalBuffer.tellp();
+  const bool           isNumber = this->m_NumberOfValues == 1
+    && this->m_ValueBegin == 0 && this->m_ValueEnd == size;
+
+  if( isNumber && this->m_ValueIsInteger
+    && this->m_Value > -2147483648.0 && this->m_Value < 2147483648.0 )
+  {
+    const unsigned char kind    = IntegerKind;
+    const int           integer = static_cast< int >( this->m_Value );
+    output.write( reinterpret_cast< const char_type * >( &kind ), sizeof( kind ) );
+    output.write( reinterpret_cast< const char_type * >( &integer ), sizeof( integer ) );
+  }
+  else if( isNumber )
+  {
+    /** Large integers are stored as a double without decimals. */
+    unsigned char   format    = FixedFlag;
+    std::streamsize precision = 0;
+    if( !this->m_ValueIsInteger )
+    {
+      format = 0;
+      if( this->m_ValueFlags & ios_base::fixed ) { format |= FixedFlag; }
+      if( this->m_ValueFlags & ios_base::scientific ) { format |= ScientificFlag; }
+      if( this->m_ValueFlags & ios_base::showpoint ) { format |= ShowPointFlag; }
+      precision = this->m_ValuePrecision < 255 ? this->m_ValuePrecision : 255;
+    }
+
+    const unsigned char kind = FloatKind;
+    const unsigned char prec = static_cast< unsigned char >( precision );
+    output.write( reinterpret_cast< const char_type * >( &kind ), sizeof( kind ) );
+    output.write( reinterpret_cast< const char_type * >( &format ), sizeof( format ) );
+    output.write( reinterpret_cast< const char_type * >( &prec ), sizeof( prec ) );
+    output.write( reinterpret_cast< const char_type * >( &this->m_Value ), sizeof( this->m_Value ) );
+  }
+  else
+  {
+    const std::string & strbuf = this->m_InternalBuffer.str();
+    const unsigned char kind   = TextKind;
+    const unsigned int  length = static_cast< unsigned int >( strbuf.size() );
+    output.write( reinterpret_cast< const char_type * >( &kind ), sizeof( kind ) );
+    output.write( reinterpret_cast< const char_type * >( &length ), sizeof( length ) );
+    output.write( strbuf.c_str(), length );
+  }
+
+}   // end WriteBinaryData
+
+
+/**
+ * ********************** ReceiveValue **************************
+ */
+
+template< class charT, class traits >
+void
+xoutcell< charT, traits >::ReceiveValue( const double & value )
+{
+  /** This is called before the value is formatted. */
+  this->m_Value          = value;
+  this->m_ValueIsInteger = false;
+  this->m_ValueFlags     = this->m_InternalBuffer.flags();
+  this->m_ValuePrecision = this->m_InternalBuffer.precision();
+  this->m_ValueBegin     = this->m_InternalBuffer.tellp();
+  this->m_ValuePending   = true;
+  ++this->m_NumberOfValues;
+
+}   // end ReceiveValue
+
+
+/**
+ * ********************* ReceiveInteger *************************
+ */
+
+template< class charT, class traits >
+void
+xoutcell< charT, traits >::ReceiveInteger( const double & value )
+{
+  this->ReceiveValue( value );
+  this->m_ValueIsInteger = true;
+
+}   // end ReceiveInteger
+
+
+/**
+ * ************************ Callback ****************************
+ */
+
+template< class charT, class traits >
+void
+xoutcell< charT, traits >::Callback( void )
+{
+  /** This is called after each <<, so also after the value is formatted. */
+  if( this->m_ValuePending )
+  {
+    this->m_ValueEnd     = this->m_InternalBuffer.tellp();
+    this->m_ValuePending = false;
+  }
+
+}   // end Callback
+
+
 } // end namespace xoutlibrary
 
 #endif // end #ifndef __xoutcell_hxx
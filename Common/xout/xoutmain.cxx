@@ -20,13 +20,25 @@
 
 #include "xoutmain.h"
 
+/** Storage class of variables with one instance per thread. */
+#if defined( _MSC_VER )
+#define xoutThreadLocal __declspec( thread )
+#else
+#define xoutThreadLocal __thread
+#endif
+
 namespace xoutlibrary
 {
-static xoutbase_type * local_xout = 0;
+static xoutbase_type *                 local_xout  = 0;
+static xoutThreadLocal xoutbase_type * thread_xout = 0;
 
 xoutbase_type &
 get_xout( void )
 {
+  if( thread_xout != 0 )
+  {
+    return *thread_xout;
+  }
   return *local_xout;
 }
 
@@ -38,6 +50,15 @@ set_xout( xoutbase_type * arg )
 }
 
 
+void
+set_thread_xout( xoutbase_type * arg )
+{
+  thread_xout = arg;
+}
+
+
 } // end namespace
 
+#undef xoutThreadLocal
+
 #endif // end #ifndef __xoutmain_cxx
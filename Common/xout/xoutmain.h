@@ -37,10 +37,20 @@ typedef xoutsimple< char > xoutsimple_type;
 typedef xoutrow< char >    xoutrow_type;
 typedef xoutcell< char >   xoutcell_type;
 
+/** Get the xout of the calling thread, if it is set, or else the xout
+ * that is shared by all threads.
+ */
 xoutbase_type & get_xout( void );
 
+/** Set the xout that is shared by all threads. */
 void set_xout( xoutbase_type * arg );
 
+/** Set the xout of the calling thread only, so that registrations that run
+ * at the same time each write to their own xout. Pass 0 to use the shared
+ * xout again.
+ */
+void set_thread_xout( xoutbase_type * arg );
+
 } // end namespace xoutlibrary
 
 #endif // end #ifndef __xoutmain_h
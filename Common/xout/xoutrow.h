@@ -107,6 +107,31 @@ public:
 
   virtual void SetOutputs( const XStreamMapType & outputmap );
 
+  /** Add/Remove a binary output stream. Binary outputs receive the headers
+   * and rows in a compact binary form, in which floating point numbers keep
+   * their full precision. Binary outputs are not flushed after each row.
+   * The stream should be opened in binary mode. The format (in the byte
+   * order of the machine) is:
+   * \li header: the characters "ELXITER1", the number of cells as a
+   *   32-bit unsigned int, and per cell the length of its name as a 32-bit
+   *   unsigned int, followed by the name.
+   * \li row: per cell a record, starting with a byte that holds the kind of
+   *   record (see xoutcell::BinaryKindType). A TextKind record continues
+   *   with a 32-bit length and the text, an IntegerKind record with a 32-bit int,
+   *   and a FloatKind record with a byte with format flags, a byte with the
+   *   precision, and a double.
+   */
+  virtual int AddBinaryOutput( const char * name, ostream_type * output );
+
+  virtual int RemoveBinaryOutput( const char * name );
+
+  /** Convert a binary stream, written to a binary output, to the text that
+   * would have been written to a normal output. Returns 0 when successful,
+   * and 1 if the input is not valid.
+   */
+  static int ConvertBinaryToText( std::basic_istream< charT, traits > & input,
+    ostream_type & output );
+
 protected:
 
   /** Returns a target cell.
@@ -117,6 +142,12 @@ protected:
 
   XStreamMapType m_CellMap;
 
+  /** The binary outputs. */
+  CStreamMapType m_BinaryOutputs;
+
+  /** Write the current row to the binary outputs. */
+  virtual void WriteBinaryData( void );
+
 };
 
 } // end namespace xoutlibrary
@@ -19,6 +19,8 @@
 #define __xoutrow_hxx
 
 #include "xoutrow.h"
+#include <iomanip>
+#include <vector>
 
 namespace xoutlibrary
 {
@@ -66,6 +68,11 @@ void
 xoutrow< charT, traits >
 ::WriteBufferedData( void )
 {
+  /** Write the cell-data to the binary outputs first, since the
+   * cells are emptied below.
+   */
+  this->WriteBinaryData();
+
   /** Write the cell-data to the outputs, separated by tabs. */
   XStreamMapIteratorType xit   = this->m_XTargetCells.begin();
   XStreamMapIteratorType tmpIt = xit;
@@ -87,9 +94,191 @@ xoutrow< charT, traits >
   *( xit->second ) << "\n";
   xit->second->WriteBufferedData();
 
+  /** The cells do not flush their outputs, so flush once per row. */
+  for( CStreamMapIteratorType cit = this->m_COutputs.begin();
+    cit != this->m_COutputs.end(); ++cit )
+  {
+    cit->second->flush();
+  }
+
 } // end WriteBufferedData()
 
 
+/**
+ * ******************** WriteBinaryData *************************
+ */
+
+template< class charT, class traits >
+void
+xoutrow< charT, traits >
+::WriteBinaryData( void )
+{
+  for( CStreamMapIteratorType cit = this->m_BinaryOutputs.begin();
+    cit != this->m_BinaryOutputs.end(); ++cit )
+  {
+    for( XStreamMapIteratorType xit = this->m_XTargetCells.begin();
+      xit != this->m_XTargetCells.end(); ++xit )
+    {
+      XOutCellType * cell = dynamic_cast< XOutCellType * >( xit->second );
+      if( cell != 0 )
+      {
+        cell->WriteBinaryData( *( cit->second ) );
+      }
+      else
+      {
+        /** Unknown cell type: write an empty text record. */
+        const unsigned char kind   = XOutCellType::TextKind;
+        const unsigned int  length = 0;
+        cit->second->write( reinterpret_cast< const char_type * >( &kind ), sizeof( kind ) );
+        cit->second->write( reinterpret_cast< const char_type * >( &length ), sizeof( length ) );
+      }
+    }
+  }
+
+} // end WriteBinaryData()
+
+
+/**
+ * ********************* AddBinaryOutput ************************
+ */
+
+template< class charT, class traits >
+int
+xoutrow< charT, traits >
+::AddBinaryOutput( const char * name, ostream_type * output )
+{
+  if( this->m_BinaryOutputs.count( name ) )
+  {
+    return 1;
+  }
+  this->m_BinaryOutputs.insert( CStreamMapEntryType( name, output ) );
+  return 0;
+
+} // end AddBinaryOutput()
+
+
+/**
+ * ******************** RemoveBinaryOutput **********************
+ */
+
+template< class charT, class traits >
+int
+xoutrow< charT, traits >
+::RemoveBinaryOutput( const char * name )
+{
+  if( this->m_BinaryOutputs.count( name ) == 0 )
+  {
+    return 1;
+  }
+  this->m_BinaryOutputs.erase( name );
+  return 0;
+
+} // end RemoveBinaryOutput()
+
+
+/**
+ * ******************* ConvertBinaryToText **********************
+ */
+
+template< class charT, class traits >
+int
+xoutrow< charT, traits >
+::ConvertBinaryToText( std::basic_istream< charT, traits > & input,
+  ostream_type & output )
+{
+  const std::string magic( "ELXITER1" );
+  unsigned int      numberOfCells = 0;
+  bool              headerRead    = false;
+
+  while( input.peek() != traits_type::eof() )
+  {
+    /** A header starts with the magic characters, a row with a kind byte. */
+    if( input.peek() == traits_type::to_int_type( magic[ 0 ] ) )
+    {
+      std::vector< char_type > buffer( magic.size() );
+      input.read( &buffer[ 0 ], buffer.size() );
+      if( !input || std::string( buffer.begin(), buffer.end() ) != magic )
+      {
+        return 1;
+      }
+      input.read( reinterpret_cast< char_type * >( &numberOfCells ), sizeof( numberOfCells ) );
+      for( unsigned int i = 0; i < numberOfCells && input; ++i )
+      {
+        unsigned int length = 0;
+        input.read( reinterpret_cast< char_type * >( &length ), sizeof( length ) );
+        buffer.resize( length + 1 );
+        input.read( &buffer[ 0 ], length );
+        output.write( &buffer[ 0 ], length );
+        output << ( i + 1 < numberOfCells ? "\t" : "\n" );
+      }
+      if( !input )
+      {
+        return 1;
+      }
+      headerRead = true;
+      continue;
+    }
+
+    if( !headerRead )
+    {
+      return 1;
+    }
+
+    /** Read and write a row. */
+    for( unsigned int i = 0; i < numberOfCells; ++i )
+    {
+      unsigned char kind = 0;
+      input.read( reinterpret_cast< char_type * >( &kind ), sizeof( kind ) );
+      if( kind == XOutCellType::TextKind )
+      {
+        unsigned int length = 0;
+        input.read( reinterpret_cast< char_type * >( &length ), sizeof( length ) );
+        std::vector< char_type > buffer( length + 1 );
+        input.read( &buffer[ 0 ], length );
+        output.write( &buffer[ 0 ], length );
+      }
+      else if( kind == XOutCellType::IntegerKind )
+      {
+        int value = 0;
+        input.read( reinterpret_cast< char_type * >( &value ), sizeof( value ) );
+        output << value;
+      }
+      else if( kind == XOutCellType::FloatKind )
+      {
+        unsigned char format    = 0;
+        unsigned char precision = 0;
+        double        value     = 0.0;
+        input.read( reinterpret_cast< char_type * >( &format ), sizeof( format ) );
+        input.read( reinterpret_cast< char_type * >( &precision ), sizeof( precision ) );
+        input.read( reinterpret_cast< char_type * >( &value ), sizeof( value ) );
+
+        ios_base::fmtflags flags = static_cast< ios_base::fmtflags >( 0 );
+        if( format & XOutCellType::FixedFlag ) { flags |= ios_base::fixed; }
+        if( format & XOutCellType::ScientificFlag ) { flags |= ios_base::scientific; }
+        output.unsetf( ios_base::floatfield );
+        output.setf( flags, ios_base::floatfield );
+        if( format & XOutCellType::ShowPointFlag ) { output << std::showpoint; }
+        else { output << std::noshowpoint; }
+        output << std::setprecision( precision ) << value;
+      }
+      else
+      {
+        return 1;
+      }
+
+      if( !input )
+      {
+        return 1;
+      }
+      output << ( i + 1 < numberOfCells ? "\t" : "\n" );
+    }
+  }
+
+  return 0;
+
+} // end ConvertBinaryToText()
+
+
 /**
  * ******************** AddTargetCell ***************************
  */
@@ -330,6 +519,21 @@ xoutrow< charT, traits >
   } // end for
   headerwriter.WriteBufferedData();
 
+  /** Write the cell-names to the binary outputs. */
+  for( CStreamMapIteratorType cit = this->m_BinaryOutputs.begin();
+    cit != this->m_BinaryOutputs.end(); ++cit )
+  {
+    const unsigned int numberOfCells = static_cast< unsigned int >( this->m_XTargetCells.size() );
+    *( cit->second ) << "ELXITER1";
+    cit->second->write( reinterpret_cast< const char_type * >( &numberOfCells ), sizeof( numberOfCells ) );
+    for( xit = this->m_XTargetCells.begin(); xit != this->m_XTargetCells.end(); ++xit )
+    {
+      const unsigned int length = static_cast< unsigned int >( xit->first.size() );
+      cit->second->write( reinterpret_cast< const char_type * >( &length ), sizeof( length ) );
+      cit->second->write( xit->first.c_str(), length );
+    }
+  }
+
 } // end WriteHeaders()
 
 
@@ -65,6 +65,13 @@ namespace elastix
  *    for rescaling the image, or the ResampleImageFilter. Skrinker is faster.\n
  *    example: <tt>(ImagePyramidUseShrinkImageFilter "true")</tt>\n
  *    Default false, so by default the resampler is used.
+ * \parameter ComputePyramidImagesFromPreviousResolution: Flag to specify if the coarser resolution
+ *    levels are computed from the finer ones, instead of from the full size input image.
+ *    This is much faster and uses less memory for large images. It is only effective when
+ *    ImagePyramidUseShrinkImageFilter is true, ComputePyramidImagesPerResolution is false,
+ *    and the rescale factors of a level are integer multiples of those of the next level.\n
+ *    example: <tt>(ComputePyramidImagesFromPreviousResolution "true")</tt>\n
+ *    Default false.
  *
  * \ingroup ImagePyramids
  */
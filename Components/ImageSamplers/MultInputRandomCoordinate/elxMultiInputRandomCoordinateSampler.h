@@ -75,6 +75,13 @@ namespace elastix
  *    With this option you can specify the order of interpolation.\n
  *    example: <tt>(FixedImageBSplineInterpolationOrder 0 0 1)</tt>\n
  *    Default value: 1. The parameter can be specified for each resolution.
+ * \parameter ComputeChannelValues: Whether to interpolate all fixed images at the samples,
+ *    sharing the interpolation weights between images of the same geometry. Metrics that
+ *    use the fixed feature images, such as the KNNGraphAlphaMutualInformation, then take the
+ *    fixed feature values from the sampler, if their fixed image interpolators have the
+ *    same B-spline order as the FixedImageBSplineInterpolationOrder.\n
+ *    example: <tt>(ComputeChannelValues "true")</tt>\n
+ *    Default value: false. The parameter can be specified for each resolution.
  *
  * \ingroup ImageSamplers
  * \sa MultiResolutionRegistrationWithFeatures
@@ -51,6 +51,12 @@ MultiInputRandomCoordinateSampler< TElastix >
   fixedImageInterpolator->SetSplineOrder( splineOrder );
   this->SetInterpolator( fixedImageInterpolator );
 
+  /** Set the ComputeChannelValues bool. */
+  bool computeChannelValues = false;
+  this->GetConfiguration()->ReadParameter( computeChannelValues,
+    "ComputeChannelValues", this->GetComponentLabel(), level, 0 );
+  this->SetComputeChannelValues( computeChannelValues );
+
   /** Set the UseRandomSampleRegion bool. */
   bool useRandomSampleRegion = false;
   this->GetConfiguration()->ReadParameter( useRandomSampleRegion,
@@ -70,6 +70,12 @@ namespace elastix
  *    With this option you can specify the order of interpolation.\n
  *    example: <tt>(FixedImageBSplineInterpolationOrder 0 0 1)</tt>\n
  *    Default value: 1. The parameter can be specified for each resolution.
+ * \parameter UseBatchedInterpolation: When the FixedImageBSplineInterpolationOrder is 3
+ *    and no fixed image mask is used, the samples can be interpolated in batches, from
+ *    B-spline coefficients in single precision. This is faster, but the sample values
+ *    differ slightly from those of the default interpolator.\n
+ *    example: <tt>(UseBatchedInterpolation "true")</tt>\n
+ *    Default value: false. The parameter can be specified for each resolution.
  *
  * \ingroup ImageSamplers
  */
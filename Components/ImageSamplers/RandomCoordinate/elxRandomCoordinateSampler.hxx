@@ -62,6 +62,12 @@ RandomCoordinateSampler< TElastix >
     this->SetInterpolator( fixedImageBSplineInterpolator );
   }
 
+  /** Set the UseBatchedInterpolation bool. */
+  bool useBatchedInterpolation = false;
+  this->GetConfiguration()->ReadParameter( useBatchedInterpolation,
+    "UseBatchedInterpolation", this->GetComponentLabel(), level, 0 );
+  this->SetUseBatchedInterpolation( useBatchedInterpolation );
+
   /** Set the UseRandomSampleRegion bool. */
   bool useRandomSampleRegion = false;
   this->GetConfiguration()->ReadParameter( useRandomSampleRegion,
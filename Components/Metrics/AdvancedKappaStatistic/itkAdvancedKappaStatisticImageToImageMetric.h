@@ -145,6 +145,10 @@ public:
     const TransformParametersType & parameters,
     MeasureType & Value, DerivativeType & Derivative ) const;
 
+  /** The multi-threaded code path may be evaluated concurrently. */
+  virtual bool GetSupportsConcurrentGetValueAndDerivative( void ) const
+  { return this->m_UseMultiThread; }
+
   /** Computes the moving gradient image dM/dx. */
   virtual void ComputeGradient( void );
 
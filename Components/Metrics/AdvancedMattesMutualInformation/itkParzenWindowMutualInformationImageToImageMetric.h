@@ -192,6 +192,9 @@ protected:
   typedef typename Superclass::ParzenValueContainerType            ParzenValueContainerType;
   typedef typename Superclass::KernelFunctionType                  KernelFunctionType;
   typedef typename Superclass::NonZeroJacobianIndicesType          NonZeroJacobianIndicesType;
+  typedef typename Superclass::ScratchSpacePerThreadStruct         ScratchSpacePerThreadStruct;
+  typedef typename Superclass::SingleDerivativeValueType           SingleDerivativeValueType;
+  typedef typename Superclass::SingleDerivativeType                SingleDerivativeType;
 
   /**  Get the value and analytic derivative.
    * Called by GetValueAndDerivative if UseFiniteDifferenceDerivative == false.
@@ -236,6 +239,28 @@ protected:
   /** Some initialization functions, called by Initialize. */
   virtual void InitializeHistograms( void );
 
+  /** The sample loop also takes the arrays for the Jacobian preconditioning
+   * from the scratch space, if UseJacobianPreconditioning is true. */
+  virtual SizeValueType GetNumberOfScratchValuesPerThread( void ) const;
+
+  /** The threaded low memory derivative supports single precision accumulation,
+   * except with Jacobian preconditioning, which scales the per-thread derivatives. */
+  virtual bool GetSupportsSinglePrecisionAccumulation( void ) const
+  { return !this->GetUseExplicitPDFDerivatives() && !this->m_UseJacobianPreconditioning; }
+
+  /** The threaded computation of the PDFs and the low memory derivative
+   * support deterministic reduction. */
+  virtual bool GetSupportsDeterministicReduction( void ) const
+  { return true; }
+
+  /** The low memory variant can be evaluated with OpenCL, for a zero order fixed
+   * and a third order moving Parzen window, without Jacobian preconditioning. */
+  virtual bool GetSupportsOpenCL( void ) const;
+
+#ifdef ELASTIX_USE_OPENCL
+  typedef typename Superclass::OpenCLEvaluatorType OpenCLEvaluatorType;
+#endif
+
   /** Threading related parameters. */
   struct ParzenWindowMutualInformationMultiThreaderParameterType
   {
@@ -243,9 +268,14 @@ protected:
   };
   ParzenWindowMutualInformationMultiThreaderParameterType m_ParzenWindowMutualInformationThreaderParameters;
 
-  /** Multi-threaded versions of the ComputePDF function. */
+  /** Multi-threaded versions of the ComputePDF function.
+   * Dispatches to ThreadedComputeDerivativeLowMemoryKernel(). */
   inline void ThreadedComputeDerivativeLowMemory( ThreadIdType threadId );
 
+  /** The loop over the samples of ThreadedComputeDerivativeLowMemory(). */
+  template< class TSampleEvaluator >
+  void ThreadedComputeDerivativeLowMemoryKernel( ThreadIdType threadId );
+
   /** Single-threadedly accumulate results. */
   inline void AfterThreadedComputeDerivativeLowMemory(
     DerivativeType & derivative ) const;
@@ -276,17 +306,26 @@ private:
 
   void ComputeDerivativeLowMemory( DerivativeType & derivative ) const;
 
-  /** Helper function to update the derivative for the low memory variant. */
+  /** Helper function to update the derivative for the low memory variant.
+   * The derivative is a DerivativeType, or a SingleDerivativeType with
+   * single precision accumulation. */
+  template< class TDerivative >
   void UpdateDerivativeLowMemory(
     const RealType & fixedImageValue,
     const RealType & movingImageValue,
     const DerivativeType & imageJacobian,
     const NonZeroJacobianIndicesType & nzji,
-    DerivativeType & derivative ) const;
+    TDerivative & derivative ) const;
 
   /** Helper function to compute m_PRatioArray in case of low memory consumption. */
   void ComputeValueAndPRatioArray( double & MI ) const;
 
+  /** Helper functions for the OpenCL evaluation of the low memory variant.
+   * They compute the joint histogram and the derivative on the device. */
+  void ComputePDFsOpenCL( const ParametersType & parameters ) const;
+
+  void ComputeDerivativeLowMemoryOpenCL( DerivativeType & derivative ) const;
+
 };
 
 } // end namespace itk
@@ -83,7 +83,14 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 ::GetValue( const ParametersType & parameters ) const
 {
   /** Construct the JointPDF and Alpha. */
-  this->ComputePDFs( parameters );
+  if( this->m_UseOpenCLEvaluator )
+  {
+    this->ComputePDFsOpenCL( parameters );
+  }
+  else
+  {
+    this->ComputePDFs( parameters );
+  }
 
   /** Normalize the pdfs: p = alpha h. */
   this->NormalizeJointPDF( this->m_JointPDF, this->m_Alpha );
@@ -255,9 +262,17 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 {
   /** Construct the JointPDF and Alpha.
    * This function contains a loop over the samples.
-   * It executes multi-threadedly when m_UseMultiThread == true.
+   * It executes multi-threadedly when m_UseMultiThread == true,
+   * or on the OpenCL device when m_UseOpenCLEvaluator == true.
    */
-  this->ComputePDFs( parameters );
+  if( this->m_UseOpenCLEvaluator )
+  {
+    this->ComputePDFsOpenCL( parameters );
+  }
+  else
+  {
+    this->ComputePDFs( parameters );
+  }
 
   /** Normalize the joint histogram by alpha. */
   this->NormalizeJointPDF( this->m_JointPDF, this->m_Alpha );
@@ -419,6 +434,12 @@ void
 ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 ::ComputeDerivativeLowMemory( DerivativeType & derivative ) const
 {
+  /** Evaluate the sample loop on the OpenCL device. */
+  if( this->m_UseOpenCLEvaluator )
+  {
+    return this->ComputeDerivativeLowMemoryOpenCL( derivative );
+  }
+
   /** Option for now to still use the single threaded code. */
   if( !this->m_UseMultiThread )
   {
@@ -434,6 +455,144 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 } // end ComputeDerivativeLowMemory()
 
 
+/**
+ * ******************** GetSupportsOpenCL *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::GetSupportsOpenCL( void ) const
+{
+  if( this->GetUseExplicitPDFDerivatives() || this->GetUseFiniteDifferenceDerivative()
+    || this->m_UseJacobianPreconditioning
+    || this->GetFixedKernelBSplineOrder() != 0 || this->GetMovingKernelBSplineOrder() != 3 )
+  {
+    return false;
+  }
+
+#ifdef ELASTIX_USE_OPENCL
+  /** The limiters should be implemented in OpenCL. */
+  typename OpenCLEvaluatorType::LimiterParametersType limiter;
+  return OpenCLEvaluatorType::GetLimiterParameters( this->GetFixedImageLimiter(), limiter )
+         && OpenCLEvaluatorType::GetLimiterParameters( this->GetMovingImageLimiter(), limiter );
+#else
+  return true;
+#endif
+
+} // end GetSupportsOpenCL()
+
+
+/**
+ * ******************** ComputePDFsOpenCL *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputePDFsOpenCL( const ParametersType & parameters ) const
+{
+#ifdef ELASTIX_USE_OPENCL
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   */
+  this->BeforeThreadedGetValueAndDerivative( parameters );
+
+  /** Pass the histogram settings and the samples to the device. */
+  typename OpenCLEvaluatorType::ParzenWindowParametersType parzen;
+  OpenCLEvaluatorType::GetLimiterParameters( this->GetFixedImageLimiter(), parzen.FixedLimiter );
+  OpenCLEvaluatorType::GetLimiterParameters( this->GetMovingImageLimiter(), parzen.MovingLimiter );
+  const JointPDFSizeType jointPDFSize = this->m_JointPDF->GetLargestPossibleRegion().GetSize();
+  parzen.NumberOfFixedHistogramBins    = jointPDFSize[ 1 ];
+  parzen.NumberOfMovingHistogramBins   = jointPDFSize[ 0 ];
+  parzen.FixedImageBinSize             = this->m_FixedImageBinSize;
+  parzen.MovingImageBinSize            = this->m_MovingImageBinSize;
+  parzen.FixedImageNormalizedMin       = this->m_FixedImageNormalizedMin;
+  parzen.MovingImageNormalizedMin      = this->m_MovingImageNormalizedMin;
+  parzen.FixedParzenTermToIndexOffset  = this->m_FixedParzenTermToIndexOffset;
+  parzen.MovingParzenTermToIndexOffset = this->m_MovingParzenTermToIndexOffset;
+  this->m_OpenCLEvaluator->SetParzenWindowParameters( parzen );
+
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  this->m_OpenCLEvaluator->SetSamples( sampleContainer );
+
+  /** Compute the joint histogram, which has the layout of m_JointPDF. */
+  std::vector< float > jointPDF;
+  SizeValueType        numberOfPixelsCounted = 0;
+  this->m_OpenCLEvaluator->ComputeJointPDF( jointPDF, numberOfPixelsCounted );
+  this->m_NumberOfPixelsCounted = numberOfPixelsCounted;
+
+  PDFValueType * jointPDFBuffer = this->m_JointPDF->GetBufferPointer();
+  for( std::size_t i = 0; i < jointPDF.size(); ++i )
+  {
+    jointPDFBuffer[ i ] = static_cast< PDFValueType >( jointPDF[ i ] );
+  }
+
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples( sampleContainer->Size(), this->m_NumberOfPixelsCounted );
+
+  /** Compute alpha. */
+  this->m_Alpha = 1.0 / static_cast< double >( this->m_NumberOfPixelsCounted );
+#else
+  itkExceptionMacro( << "elastix is compiled without OpenCL." );
+#endif
+
+} // end ComputePDFsOpenCL()
+
+
+/**
+ * ******************** ComputeDerivativeLowMemoryOpenCL *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeDerivativeLowMemoryOpenCL( DerivativeType & derivative ) const
+{
+#ifdef ELASTIX_USE_OPENCL
+  /** The device uses the samples and parameters of ComputePDFsOpenCL(). */
+  const unsigned int   numberOfFixedBins  = this->m_PRatioArray.rows();
+  const unsigned int   numberOfMovingBins = this->m_PRatioArray.cols();
+  std::vector< float > pRatio( numberOfFixedBins * numberOfMovingBins );
+  for( unsigned int f = 0; f < numberOfFixedBins; ++f )
+  {
+    for( unsigned int m = 0; m < numberOfMovingBins; ++m )
+    {
+      pRatio[ f * numberOfMovingBins + m ] = static_cast< float >( this->m_PRatioArray[ f ][ m ] );
+    }
+  }
+
+  this->m_OpenCLEvaluator->ComputeParzenWindowDerivative( pRatio, derivative );
+#else
+  itkExceptionMacro( << "elastix is compiled without OpenCL." );
+#endif
+
+} // end ComputeDerivativeLowMemoryOpenCL()
+
+
+/**
+ * ******************* GetNumberOfScratchValuesPerThread *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+SizeValueType
+ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::GetNumberOfScratchValuesPerThread( void ) const
+{
+  /** The superclass reserves space for dM/dmu. The jacobianPreconditioner
+   * has the same size, the preconditioningDivisor has the size of the derivative.
+   */
+  const SizeValueType numberOfValues = this->Superclass::GetNumberOfScratchValuesPerThread();
+  if( this->GetUseJacobianPreconditioning() )
+  {
+    return 2 * numberOfValues + this->GetNumberOfParameters();
+  }
+  return numberOfValues;
+
+} // end GetNumberOfScratchValuesPerThread()
+
+
 /**
  * ******************* ThreadedComputeDerivativeLowMemory *******************
  */
@@ -443,24 +602,52 @@ void
 ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 ::ThreadedComputeDerivativeLowMemory( ThreadIdType threadId )
 {
-  /** Initialize array that stores dM(x)/dmu, and the sparse Jacobian + indices. */
-  const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
-  NonZeroJacobianIndicesType   nzji  = NonZeroJacobianIndicesType( nnzji );
-  DerivativeType               imageJacobian( nzji.size() );
+  itkAdvancedImageToImageMetricDispatchKernelMacro( ThreadedComputeDerivativeLowMemoryKernel, ( threadId ) );
+
+} // end ThreadedComputeDerivativeLowMemory()
+
+
+/**
+ * ******************* ThreadedComputeDerivativeLowMemoryKernel *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+template< class TSampleEvaluator >
+void
+ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedComputeDerivativeLowMemoryKernel( ThreadIdType threadId )
+{
+  /** The evaluator of the transform, mask and interpolator. */
+  TSampleEvaluator evaluator( this );
+
+  /** Get the array that stores dM(x)/dmu, and the sparse Jacobian indices,
+   * from the scratch space of this thread, see InitializeScratchSpace().
+   */
+  ScratchSpacePerThreadStruct & scratch = this->m_ScratchSpacePerThreadVariables[ threadId ];
+  const NumberOfParametersType  nnzji   = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  NonZeroJacobianIndicesType &  nzji    = scratch.st_NonZeroJacobianIndices;
+  nzji.resize( nnzji );
+  DerivativeType imageJacobian;
+  scratch.st_Arena.Release();
+  scratch.st_Arena.Allocate( imageJacobian, nnzji );
 
   /** Get a handle to the pre-allocated derivative for the current thread.
    * The initialization is performed at the beginning of each resolution in
    * InitializeThreadingParameters(), and at the end of each iteration in
    * AfterThreadedGetValueAndDerivative() and the accumulate functions.
    */
-  DerivativeType & derivative = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative;
+  DerivativeType &       derivative       = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative;
+  SingleDerivativeType & singleDerivative = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_SingleDerivative;
+  const bool             useSingle        = this->m_UseSinglePrecisionAccumulationInThreads;
 
-  /** Declare and allocate arrays for Jacobian preconditioning. */
+  /** Declare arrays for Jacobian preconditioning, and take them from the
+   * scratch space. See GetNumberOfScratchValuesPerThread().
+   */
   DerivativeType jacobianPreconditioner, preconditioningDivisor;
   if( this->GetUseJacobianPreconditioning() )
   {
-    jacobianPreconditioner = DerivativeType( nzji.size() );
-    preconditioningDivisor = DerivativeType( this->GetNumberOfParameters() );
+    scratch.st_Arena.Allocate( jacobianPreconditioner, nnzji );
+    scratch.st_Arena.Allocate( preconditioningDivisor, this->GetNumberOfParameters() );
     preconditioningDivisor.Fill( 0.0 );
   }
 
@@ -471,7 +658,7 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   /** Get the samples for this thread. */
   const unsigned long nrOfSamplesPerThreads
     = static_cast< unsigned long >( vcl_ceil( static_cast< double >( sampleContainerSize )
-    / static_cast< double >( this->m_NumberOfThreads ) ) );
+    / static_cast< double >( this->m_NumberOfWorkUnits ) ) );
 
   unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
   unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
@@ -495,12 +682,12 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     MovingImagePointType        mappedPoint;
 
     /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    bool sampleOk = evaluator.TransformPoint( fixedPoint, mappedPoint );
 
     /** Check if the point is inside the moving mask. */
     if( sampleOk )
     {
-      sampleOk = this->IsInsideMovingMask( mappedPoint );
+      sampleOk = evaluator.IsInsideMovingMask( mappedPoint );
     }
 
     /** Compute the moving image value, its derivative, and check
@@ -508,7 +695,7 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
      */
     if( sampleOk )
     {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
+      sampleOk = evaluator.EvaluateMovingImageValueAndDerivative(
         mappedPoint, movingImageValue, &movingImageDerivative );
     }
 
@@ -522,24 +709,15 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
       movingImageValue = this->GetMovingImageLimiter()
         ->Evaluate( movingImageValue, movingImageDerivative );
 
-#if 0
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
-
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
-#else
       /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
-      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+      evaluator.EvaluateJacobianWithImageGradientProduct(
         fixedPoint, movingImageDerivative, imageJacobian, nzji );
-#endif
 
       /** If desired, apply the technique introduced by Tustison. */
-      TransformJacobianType jacobian;
       if( this->GetUseJacobianPreconditioning() )
       {
-        this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+        TransformJacobianType & jacobian = scratch.st_TransformJacobian;
+        evaluator.EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
 
         this->ComputeJacobianPreconditioner( jacobian, nzji,
           jacobianPreconditioner, preconditioningDivisor );
@@ -557,9 +735,18 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
       }
 
       /** Compute this sample's contribution to the joint distributions. */
-      this->UpdateDerivativeLowMemory(
-        fixedImageValue, movingImageValue, imageJacobian, nzji,
-        derivative );
+      if( useSingle )
+      {
+        this->UpdateDerivativeLowMemory(
+          fixedImageValue, movingImageValue, imageJacobian, nzji,
+          singleDerivative );
+      }
+      else
+      {
+        this->UpdateDerivativeLowMemory(
+          fixedImageValue, movingImageValue, imageJacobian, nzji,
+          derivative );
+      }
 
     } // end sampleOk
   }   // end loop over sample container
@@ -582,7 +769,7 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     }
   }
 
-} // end ThreadedComputeDerivativeLowMemory()
+} // end ThreadedComputeDerivativeLowMemoryKernel()
 
 
 /**
@@ -599,7 +786,7 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   if( !this->m_UseMultiThread && false ) // force multi-threaded
   {
     derivative = this->m_GetValueAndDerivativePerThreadVariables[ 0 ].st_Derivative;
-    for( ThreadIdType i = 1; i < this->m_NumberOfThreads; ++i )
+    for( ThreadIdType i = 1; i < this->m_NumberOfWorkUnits; ++i )
     {
       derivative += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative;
     }
@@ -609,12 +796,13 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   else if( false ) //this->m_UseOpenMP )
   {
     const int spaceDimension = static_cast< int >( this->GetNumberOfParameters() );
+    const int nthreads       = static_cast< int >( this->m_NumberOfThreads );
 
-    #pragma omp parallel for
+    #pragma omp parallel for num_threads( nthreads )
     for( int j = 0; j < spaceDimension; ++j )
     {
       DerivativeValueType sum = this->m_GetValueAndDerivativePerThreadVariables[ 0 ].st_Derivative[ j ];
-      for( ThreadIdType i = 1; i < this->m_NumberOfThreads; ++i )
+      for( ThreadIdType i = 1; i < this->m_NumberOfWorkUnits; ++i )
       {
         sum += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative[ j ];
       }
@@ -645,13 +833,19 @@ ITK_THREAD_RETURN_TYPE
 ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 ::ComputeDerivativeLowMemoryThreaderCallback( void * arg )
 {
-  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
-  ThreadIdType     threadId   = infoStruct->ThreadID;
+  ThreadInfoType * infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId    = infoStruct->ThreadID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfThreads;
 
   ParzenWindowMutualInformationMultiThreaderParameterType * temp
     = static_cast< ParzenWindowMutualInformationMultiThreaderParameterType * >( infoStruct->UserData );
 
-  temp->m_Metric->ThreadedComputeDerivativeLowMemory( threadId );
+  /** Process the work units of this thread. */
+  const ThreadIdType nrOfWorkUnits = temp->m_Metric->m_NumberOfWorkUnits;
+  for( ThreadIdType workUnit = threadId; workUnit < nrOfWorkUnits; workUnit += nrOfThreads )
+  {
+    temp->m_Metric->ThreadedComputeDerivativeLowMemory( workUnit );
+  }
 
   return ITK_THREAD_RETURN_VALUE;
 
@@ -760,6 +954,7 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
  */
 
 template< class TFixedImage, class TMovingImage >
+template< class TDerivative >
 void
 ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 ::UpdateDerivativeLowMemory(
@@ -767,8 +962,10 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   const RealType & movingImageValue,
   const DerivativeType & imageJacobian,
   const NonZeroJacobianIndicesType & nzji,
-  DerivativeType & derivative ) const
+  TDerivative & derivative ) const
 {
+  typedef typename TDerivative::ValueType TDerivativeValueType;
+
   /** In this function we need to do (see eq. 24 of Thevenaz [3]):
    *      derivative -= constant * imageJacobian *
    *          \sum_i \sum_k PRatio(i,k) * dB/dxi(xi,i,k),
@@ -797,14 +994,18 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     = static_cast< int >( vcl_floor(
     movingImageParzenWindowTerm + this->m_MovingParzenTermToIndexOffset ) );
 
-  /** Compute the fixed Parzen values. */
-  ParzenValueContainerType fixedParzenValues( this->m_JointPDFWindow.GetSize()[ 1 ] );
+  /** Compute the fixed Parzen values. Allocate memory on the stack. */
+  PDFValueType             fixedParzenValuesArray[ Superclass::MaximumParzenWindowSize ];
+  ParzenValueContainerType fixedParzenValues( fixedParzenValuesArray,
+                                              this->m_JointPDFWindow.GetSize()[ 1 ], false );
   this->EvaluateParzenValues(
     fixedImageParzenWindowTerm, fixedParzenWindowIndex,
     this->m_FixedKernel, fixedParzenValues );
 
   /** Compute the derivatives of the moving Parzen window. */
-  ParzenValueContainerType derivativeMovingParzenValues( this->m_JointPDFWindow.GetSize()[ 0 ] );
+  PDFValueType             derivativeMovingParzenValuesArray[ Superclass::MaximumParzenWindowSize ];
+  ParzenValueContainerType derivativeMovingParzenValues( derivativeMovingParzenValuesArray,
+                                                         this->m_JointPDFWindow.GetSize()[ 0 ], false );
   this->EvaluateParzenValues(
     movingImageParzenWindowTerm, movingParzenWindowIndex,
     this->m_DerivativeMovingKernel, derivativeMovingParzenValues );
@@ -830,7 +1031,7 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     /** Loop over all Jacobians. */
     for( unsigned int mu = 0; mu < this->GetNumberOfParameters(); ++mu )
     {
-      derivative[ mu ] += static_cast< DerivativeValueType >(
+      derivative[ mu ] += static_cast< TDerivativeValueType >(
         imageJacobian[ mu ] * sum );
     }
   }
@@ -840,7 +1041,7 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     for( unsigned int i = 0; i < imageJacobian.GetSize(); ++i )
     {
       const unsigned int mu = nzji[ i ];
-      derivative[ mu ] += static_cast< DerivativeValueType >(
+      derivative[ mu ] += static_cast< TDerivativeValueType >(
         imageJacobian[ i ] * sum );
     }
   }
@@ -1124,25 +1325,17 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     }
   }
 
-  /** Update divisor = sum_samples diag(jac'*jac) */
-  DerivativeType temp( M );
-  temp.Fill( 0.0 );
-  /** Compute this sample's contribution */
-  for( unsigned int drow = 0; drow < MovingImageDimension; ++drow )
+  /** Update divisor = sum_samples diag(jac'*jac).
+   * This sample's contribution is summed per column, without a temporary.
+   */
+  for( unsigned int mu = 0; mu < M; ++mu )
   {
-    DerivativeValueType *              tempit = temp.begin();
-    const TransformJacobianValueType * jacit1 = jac[ drow ];
-    for( unsigned int mu = 0; mu < M; ++mu )
+    DerivativeValueType sum = 0.0;
+    for( unsigned int drow = 0; drow < MovingImageDimension; ++drow )
     {
-      *tempit += vnl_math_sqr( *jacit1 );
-      ++tempit;
-      ++jacit1;
+      sum += vnl_math_sqr( jac[ drow ][ mu ] );
     }
-  }
-  /** Update divisor */
-  for( unsigned int mu = 0; mu < M; ++mu )
-  {
-    divisor[ nzji[ mu ] ] += temp[ mu ];
+    divisor[ nzji[ mu ] ] += sum;
   }
 
 } // end ComputeJacobianPreconditioner()
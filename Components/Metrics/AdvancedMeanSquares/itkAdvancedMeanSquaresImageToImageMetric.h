@@ -120,6 +120,7 @@ public:
     Superclass::MovingImageDerivativeScalesType MovingImageDerivativeScalesType;
   typedef typename Superclass::HessianValueType HessianValueType;
   typedef typename Superclass::HessianType      HessianType;
+  typedef typename Superclass::CSRHessianType   CSRHessianType;
   typedef typename Superclass::ThreaderType     ThreaderType;
   typedef typename Superclass::ThreadInfoType   ThreadInfoType;
 
@@ -147,9 +148,21 @@ public:
   virtual void GetValueAndDerivative( const TransformParametersType & parameters,
     MeasureType & value, DerivativeType & derivative ) const;
 
-  /** Experimental feature: compute SelfHessian */
+  /** The multi-threaded code path may be evaluated concurrently. */
+  virtual bool GetSupportsConcurrentGetValueAndDerivative( void ) const
+  { return this->m_UseMultiThread; }
+
+  /** Experimental feature: compute SelfHessian.
+   * Computes the compressed SelfHessian, and converts it to a vnl_sparse_matrix.
+   */
   virtual void GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const;
 
+  /** Experimental feature: compute SelfHessian in compressed sparse row format.
+   * The samples are distributed over the threads.
+   */
+  virtual void GetCompressedSelfHessian( const TransformParametersType & parameters,
+    CSRHessianType & H ) const;
+
   /** Default: 1.0 mm */
   itkSetMacro( SelfHessianSmoothingSigma, double );
   itkGetConstMacro( SelfHessianSmoothingSigma, double );
@@ -205,6 +218,9 @@ protected:
   typedef typename Superclass::CentralDifferenceGradientFilterType CentralDifferenceGradientFilterType;
   typedef typename Superclass::MovingImageDerivativeType           MovingImageDerivativeType;
   typedef typename Superclass::NonZeroJacobianIndicesType          NonZeroJacobianIndicesType;
+  typedef typename Superclass::ScratchSpacePerThreadStruct         ScratchSpacePerThreadStruct;
+  typedef typename Superclass::SingleDerivativeValueType           SingleDerivativeValueType;
+  typedef typename Superclass::SingleDerivativeType                SingleDerivativeType;
 
   /** Protected typedefs for SelfHessian */
   typedef SmoothingRecursiveGaussianImageFilter<
@@ -218,31 +234,58 @@ protected:
   double m_NormalizationFactor;
 
   /** Compute a pixel's contribution to the measure and derivatives;
-   * Called by GetValueAndDerivative(). */
+   * Called by GetValueAndDerivative(). The derivative is a DerivativeType,
+   * or a SingleDerivativeType with single precision accumulation. */
+  template< class TDerivative >
   void UpdateValueAndDerivativeTerms(
     const RealType fixedImageValue,
     const RealType movingImageValue,
     const DerivativeType & imageJacobian,
     const NonZeroJacobianIndicesType & nzji,
     MeasureType & measure,
-    DerivativeType & deriv ) const;
+    TDerivative & deriv ) const;
 
-  /** Compute a pixel's contribution to the SelfHessian;
-   * Called by GetSelfHessian(). */
-  void UpdateSelfHessianTerms(
-    const DerivativeType & imageJacobian,
-    const NonZeroJacobianIndicesType & nzji,
-    HessianType & H ) const;
+  /** The threaded loops support single precision accumulation. */
+  virtual bool GetSupportsSinglePrecisionAccumulation( void ) const
+  { return true; }
+
+  /** The threaded loops support deterministic reduction. */
+  virtual bool GetSupportsDeterministicReduction( void ) const
+  { return true; }
 
-  /** Get value for each thread. */
+  /** The sample loops can be evaluated with OpenCL. */
+  virtual bool GetSupportsOpenCL( void ) const
+  { return true; }
+
+  /** Get the value and optionally the derivative with the OpenCL evaluator.
+   * Called by GetValue() and GetValueAndDerivative() when
+   * m_UseOpenCLEvaluator is true. */
+  void GetValueAndDerivativeOpenCL( const TransformParametersType & parameters,
+    MeasureType & value, DerivativeType & derivative,
+    const bool computeDerivative ) const;
+
+  /** Compute the SelfHessian contributions of the samples of a thread;
+   * Called by GetCompressedSelfHessian(). */
+  inline void ThreadedGetSelfHessian( ThreadIdType threadID );
+
+  /** Get value for each thread. Dispatches to ThreadedGetValueKernel(). */
   inline void ThreadedGetValue( ThreadIdType threadID );
 
+  /** The loop over the samples of ThreadedGetValue(). */
+  template< class TSampleEvaluator >
+  void ThreadedGetValueKernel( ThreadIdType threadID );
+
   /** Gather the values from all threads. */
   inline void AfterThreadedGetValue( MeasureType & value ) const;
 
-  /** Get value and derivatives for each thread. */
+  /** Get value and derivatives for each thread.
+   * Dispatches to ThreadedGetValueAndDerivativeKernel(). */
   inline void ThreadedGetValueAndDerivative( ThreadIdType threadID );
 
+  /** The loop over the samples of ThreadedGetValueAndDerivative(). */
+  template< class TSampleEvaluator >
+  void ThreadedGetValueAndDerivativeKernel( ThreadIdType threadID );
+
   /** Gather the values and derivatives from all threads. */
   inline void AfterThreadedGetValueAndDerivative(
     MeasureType & value, DerivativeType & derivative ) const;
@@ -257,6 +300,12 @@ private:
   double       m_SelfHessianNoiseRange;
   unsigned int m_NumberOfSamplesForSelfHessian;
 
+  /** The smoothed fixed image and the noise that is added to its
+   * derivative, used while computing the SelfHessian.
+   */
+  mutable typename FixedImageInterpolatorType::Pointer m_SelfHessianFixedInterpolator;
+  mutable std::vector< double >                        m_SelfHessianNoise;
+
 };
 
 } // end namespace itk
@@ -225,6 +225,15 @@ typename AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >::Mea
 AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 ::GetValue( const TransformParametersType & parameters ) const
 {
+  /** Evaluate the sample loop on the OpenCL device. */
+  if( this->m_UseOpenCLEvaluator )
+  {
+    MeasureType    value = NumericTraits< MeasureType >::Zero;
+    DerivativeType dummyDerivative;
+    this->GetValueAndDerivativeOpenCL( parameters, value, dummyDerivative, false );
+    return value;
+  }
+
   /** Option for now to still use the single threaded code. */
   if( !this->m_UseMultiThread )
   {
@@ -266,6 +275,24 @@ void
 AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 ::ThreadedGetValue( ThreadIdType threadId )
 {
+  itkAdvancedImageToImageMetricDispatchKernelMacro( ThreadedGetValueKernel, ( threadId ) );
+
+} // end ThreadedGetValue()
+
+
+/**
+ * ******************* ThreadedGetValueKernel *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+template< class TSampleEvaluator >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetValueKernel( ThreadIdType threadId )
+{
+  /** The evaluator of the transform, mask and interpolator. */
+  TSampleEvaluator evaluator( this );
+
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
   const unsigned long         sampleContainerSize = sampleContainer->Size();
@@ -273,7 +300,7 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   /** Get the samples for this thread. */
   const unsigned long nrOfSamplesPerThreads
     = static_cast< unsigned long >( vcl_ceil( static_cast< double >( sampleContainerSize )
-    / static_cast< double >( this->m_NumberOfThreads ) ) );
+    / static_cast< double >( this->m_NumberOfWorkUnits ) ) );
 
   unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
   unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
@@ -301,12 +328,12 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
     MovingImagePointType        mappedPoint;
 
     /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    bool sampleOk = evaluator.TransformPoint( fixedPoint, mappedPoint );
 
     /** Check if point is inside mask. */
     if( sampleOk )
     {
-      sampleOk = this->IsInsideMovingMask( mappedPoint ); // thread-safe?
+      sampleOk = evaluator.IsInsideMovingMask( mappedPoint );
     }
 
     /** Compute the moving image value M(T(x)) and check if
@@ -314,7 +341,7 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
      */
     if( sampleOk )
     {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
+      sampleOk = evaluator.EvaluateMovingImageValueAndDerivative(
         mappedPoint, movingImageValue, 0 );
     }
 
@@ -338,7 +365,7 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
   this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Value                 = measure;
 
-} // end ThreadedGetValue()
+} // end ThreadedGetValueKernel()
 
 
 /**
@@ -352,7 +379,7 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 {
   /** Accumulate the number of pixels. */
   this->m_NumberOfPixelsCounted = this->m_GetValueAndDerivativePerThreadVariables[ 0 ].st_NumberOfPixelsCounted;
-  for( ThreadIdType i = 1; i < this->m_NumberOfThreads; ++i )
+  for( ThreadIdType i = 1; i < this->m_NumberOfWorkUnits; ++i )
   {
     this->m_NumberOfPixelsCounted += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted;
 
@@ -371,7 +398,7 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 
   /** Accumulate values. */
   value = NumericTraits< MeasureType >::Zero;
-  for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
+  for( ThreadIdType i = 0; i < this->m_NumberOfWorkUnits; ++i )
   {
     value += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value;
 
@@ -543,6 +570,12 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   const TransformParametersType & parameters,
   MeasureType & value, DerivativeType & derivative ) const
 {
+  /** Evaluate the sample loop on the OpenCL device. */
+  if( this->m_UseOpenCLEvaluator )
+  {
+    return this->GetValueAndDerivativeOpenCL( parameters, value, derivative, true );
+  }
+
   /** Option for now to still use the single threaded code. */
   if( !this->m_UseMultiThread )
   {
@@ -574,6 +607,59 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 } // end GetValueAndDerivative()
 
 
+/**
+ * ******************* GetValueAndDerivativeOpenCL *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::GetValueAndDerivativeOpenCL(
+  const TransformParametersType & parameters,
+  MeasureType & value, DerivativeType & derivative,
+  const bool computeDerivative ) const
+{
+#ifdef ELASTIX_USE_OPENCL
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   */
+  this->BeforeThreadedGetValueAndDerivative( parameters );
+
+  /** Copy the samples to the device, if they changed. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  this->m_OpenCLEvaluator->SetSamples( sampleContainer );
+
+  /** The sum of squared differences and 2 (m - f) dM/dmu. */
+  double        measure               = 0.0;
+  SizeValueType numberOfPixelsCounted = 0;
+  this->m_OpenCLEvaluator->ComputeMeanSquares(
+    measure, numberOfPixelsCounted, derivative, computeDerivative );
+  this->m_NumberOfPixelsCounted = numberOfPixelsCounted;
+
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples(
+    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
+
+  /** Compute the measure value and derivative. */
+  double normal_sum = 0.0;
+  if( this->m_NumberOfPixelsCounted > 0 )
+  {
+    normal_sum = this->m_NormalizationFactor
+      / static_cast< double >( this->m_NumberOfPixelsCounted );
+  }
+  value = measure * normal_sum;
+  if( computeDerivative )
+  {
+    derivative *= normal_sum;
+  }
+#else
+  itkExceptionMacro( << "elastix is compiled without OpenCL." );
+#endif
+
+} // end GetValueAndDerivativeOpenCL()
+
+
 /**
  * ******************* ThreadedGetValueAndDerivative *******************
  */
@@ -583,17 +669,43 @@ void
 AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 ::ThreadedGetValueAndDerivative( ThreadIdType threadId )
 {
-  /** Initialize array that stores dM(x)/dmu, and the sparse Jacobian + indices. */
-  const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
-  NonZeroJacobianIndicesType   nzji  = NonZeroJacobianIndicesType( nnzji );
-  DerivativeType               imageJacobian( nnzji );
+  itkAdvancedImageToImageMetricDispatchKernelMacro( ThreadedGetValueAndDerivativeKernel, ( threadId ) );
+
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivativeKernel *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+template< class TSampleEvaluator >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetValueAndDerivativeKernel( ThreadIdType threadId )
+{
+  /** The evaluator of the transform, mask and interpolator. */
+  TSampleEvaluator evaluator( this );
+
+  /** Get the array that stores dM(x)/dmu, and the sparse Jacobian indices,
+   * from the scratch space of this thread, see InitializeScratchSpace().
+   */
+  ScratchSpacePerThreadStruct & scratch = this->m_ScratchSpacePerThreadVariables[ threadId ];
+  const NumberOfParametersType  nnzji   = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  NonZeroJacobianIndicesType &  nzji    = scratch.st_NonZeroJacobianIndices;
+  nzji.resize( nnzji );
+  DerivativeType imageJacobian;
+  scratch.st_Arena.Release();
+  scratch.st_Arena.Allocate( imageJacobian, nnzji );
 
   /** Get a handle to the pre-allocated derivative for the current thread.
    * The initialization is performed at the beginning of each resolution in
    * InitializeThreadingParameters(), and at the end of each iteration in
    * AfterThreadedGetValueAndDerivative() and the accumulate functions.
    */
-  DerivativeType & derivative = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative;
+  DerivativeType &       derivative       = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative;
+  SingleDerivativeType & singleDerivative = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_SingleDerivative;
+  const bool             useSingle        = this->m_UseSinglePrecisionAccumulationInThreads;
 
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
@@ -602,7 +714,7 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   /** Get the samples for this thread. */
   const unsigned long nrOfSamplesPerThreads
     = static_cast< unsigned long >( vcl_ceil( static_cast< double >( sampleContainerSize )
-    / static_cast< double >( this->m_NumberOfThreads ) ) );
+    / static_cast< double >( this->m_NumberOfWorkUnits ) ) );
 
   unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
   unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
@@ -631,12 +743,12 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
     MovingImageDerivativeType   movingImageDerivative;
 
     /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    bool sampleOk = evaluator.TransformPoint( fixedPoint, mappedPoint );
 
     /** Check if point is inside mask. */
     if( sampleOk )
     {
-      sampleOk = this->IsInsideMovingMask( mappedPoint ); // thread-safe?
+      sampleOk = evaluator.IsInsideMovingMask( mappedPoint );
     }
 
     /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
@@ -644,7 +756,7 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
      */
     if( sampleOk )
     {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
+      sampleOk = evaluator.EvaluateMovingImageValueAndDerivative(
         mappedPoint, movingImageValue, &movingImageDerivative );
     }
 
@@ -656,24 +768,25 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
       const RealType & fixedImageValue
         = static_cast< RealType >( ( *threader_fiter ).Value().m_ImageValue );
 
-#if 0
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
-
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
-#else
       /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
-      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+      evaluator.EvaluateJacobianWithImageGradientProduct(
         fixedPoint, movingImageDerivative, imageJacobian, nzji );
-#endif
 
       /** Compute this pixel's contribution to the measure and derivatives. */
-      this->UpdateValueAndDerivativeTerms(
-        fixedImageValue, movingImageValue,
-        imageJacobian, nzji,
-        measure, derivative );
+      if( useSingle )
+      {
+        this->UpdateValueAndDerivativeTerms(
+          fixedImageValue, movingImageValue,
+          imageJacobian, nzji,
+          measure, singleDerivative );
+      }
+      else
+      {
+        this->UpdateValueAndDerivativeTerms(
+          fixedImageValue, movingImageValue,
+          imageJacobian, nzji,
+          measure, derivative );
+      }
 
     } // end if sampleOk
 
@@ -683,7 +796,7 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
   this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Value                 = measure;
 
-} // end ThreadedGetValueAndDerivative()
+} // end ThreadedGetValueAndDerivativeKernel()
 
 
 /**
@@ -698,7 +811,7 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 {
   /** Accumulate the number of pixels. */
   this->m_NumberOfPixelsCounted = this->m_GetValueAndDerivativePerThreadVariables[ 0 ].st_NumberOfPixelsCounted;
-  for( ThreadIdType i = 1; i < this->m_NumberOfThreads; ++i )
+  for( ThreadIdType i = 1; i < this->m_NumberOfWorkUnits; ++i )
   {
     this->m_NumberOfPixelsCounted += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted;
 
@@ -717,7 +830,7 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 
   /** Accumulate values. */
   value = NumericTraits< MeasureType >::Zero;
-  for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
+  for( ThreadIdType i = 0; i < this->m_NumberOfWorkUnits; ++i )
   {
     value += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value;
 
@@ -731,7 +844,7 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   if( !this->m_UseMultiThread && false ) // force multi-threaded
   {
     derivative = this->m_GetValueAndDerivativePerThreadVariables[ 0 ].st_Derivative * normal_sum;
-    for( ThreadIdType i = 1; i < this->m_NumberOfThreads; i++ )
+    for( ThreadIdType i = 1; i < this->m_NumberOfWorkUnits; i++ )
     {
       derivative += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative * normal_sum;
     }
@@ -751,12 +864,13 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   else
   {
     const int spaceDimension = static_cast< int >( this->GetNumberOfParameters() );
+    const int nthreads       = static_cast< int >( this->m_NumberOfThreads );
 
-    #pragma omp parallel for
+    #pragma omp parallel for num_threads( nthreads )
     for( int j = 0; j < spaceDimension; ++j )
     {
       DerivativeValueType tmp = NumericTraits< DerivativeValueType >::Zero;
-      for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
+      for( ThreadIdType i = 0; i < this->m_NumberOfWorkUnits; ++i )
       {
         tmp += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative[ j ];
       }
@@ -773,6 +887,7 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
  */
 
 template< class TFixedImage, class TMovingImage >
+template< class TDerivative >
 void
 AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 ::UpdateValueAndDerivativeTerms(
@@ -781,8 +896,10 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   const DerivativeType & imageJacobian,
   const NonZeroJacobianIndicesType & nzji,
   MeasureType & measure,
-  DerivativeType & deriv ) const
+  TDerivative & deriv ) const
 {
+  typedef typename TDerivative::ValueType TDerivativeValueType;
+
   /** The difference squared. */
   const RealType diff     = movingImageValue - fixedImageValue;
   const RealType diffdiff = diff * diff;
@@ -794,10 +911,10 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   {
     /** Loop over all Jacobians. */
     typename DerivativeType::const_iterator imjacit = imageJacobian.begin();
-    typename DerivativeType::iterator derivit       = deriv.begin();
+    TDerivativeValueType *                  derivit = deriv.begin();
     for( unsigned int mu = 0; mu < this->GetNumberOfParameters(); ++mu )
     {
-      ( *derivit ) += diff_2 * ( *imjacit );
+      ( *derivit ) += static_cast< TDerivativeValueType >( diff_2 * ( *imjacit ) );
       ++imjacit;
       ++derivit;
     }
@@ -808,7 +925,7 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
     for( unsigned int i = 0; i < imageJacobian.GetSize(); ++i )
     {
       const unsigned int index = nzji[ i ];
-      deriv[ index ] += diff_2 * imageJacobian[ i ];
+      deriv[ index ] += static_cast< TDerivativeValueType >( diff_2 * imageJacobian[ i ] );
     }
   }
 } // end UpdateValueAndDerivativeTerms()
@@ -824,26 +941,31 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 ::GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const
 {
   itkDebugMacro( "GetSelfHessian()" );
-  typedef Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
 
-  /** Initialize some variables. */
-  this->m_NumberOfPixelsCounted = 0;
-  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
-  randomGenerator->Initialize();
+  CSRHessianType compressedH;
+  this->GetCompressedSelfHessian( parameters, compressedH );
+  compressedH.GetVnlSparseMatrix( H );
 
-  /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
-  NonZeroJacobianIndicesType nzji(
-  this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
-  DerivativeType        imageJacobian( nzji.size() );
-  TransformJacobianType jacobian;
+} // end GetSelfHessian()
+
+
+/**
+ * ******************* GetCompressedSelfHessian *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::GetCompressedSelfHessian( const TransformParametersType & parameters,
+  CSRHessianType & H ) const
+{
+  itkDebugMacro( "GetCompressedSelfHessian()" );
 
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters( parameters );
 
-  /** Prepare Hessian */
-  H.set_size( this->GetNumberOfParameters(),
-    this->GetNumberOfParameters() );
-  //H.Fill(0.0); // done by set_size if sparse matrix
+  /** Prepare Hessian: set the sparsity pattern, and zero it. */
+  this->InitializeSelfHessianPattern( H );
 
   /** Smooth fixed image */
   typename SmootherType::Pointer smoother = SmootherType::New();
@@ -852,43 +974,107 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   smoother->Update();
 
   /** Set up interpolator for fixed image */
-  typename FixedImageInterpolatorType::Pointer fixedInterpolator = FixedImageInterpolatorType::New();
+  this->m_SelfHessianFixedInterpolator = FixedImageInterpolatorType::New();
   if( this->m_BSplineInterpolator.IsNotNull() )
   {
-    fixedInterpolator->SetSplineOrder( this->m_BSplineInterpolator->GetSplineOrder() );
+    this->m_SelfHessianFixedInterpolator->SetSplineOrder( this->m_BSplineInterpolator->GetSplineOrder() );
   }
   else
   {
-    fixedInterpolator->SetSplineOrder( 1 );
+    this->m_SelfHessianFixedInterpolator->SetSplineOrder( 1 );
   }
-  fixedInterpolator->SetInputImage( smoother->GetOutput() );
+  this->m_SelfHessianFixedInterpolator->SetInputImage( smoother->GetOutput() );
 
-  /** Set up random coordinate sampler
+  /** Set up grid sampler
    * Actually we could do without a sampler, but it's easy like this.
    */
   typename SelfHessianSamplerType::Pointer sampler = SelfHessianSamplerType::New();
-  //typename DummyFixedImageInterpolatorType::Pointer dummyInterpolator =
-  //  DummyFixedImageInterpolatorType::New();
   sampler->SetInputImageRegion( this->GetImageSampler()->GetInputImageRegion() );
   sampler->SetMask( this->GetImageSampler()->GetMask() );
   sampler->SetInput( smoother->GetInput() );
   sampler->SetNumberOfSamples( this->m_NumberOfSamplesForSelfHessian );
-  //sampler->SetInterpolator( dummyInterpolator );
 
   /** Update the imageSampler and get a handle to the sample container. */
   sampler->Update();
   ImageSampleContainerPointer sampleContainer = sampler->GetOutput();
 
+  /** Draw the noise that is added to the derivative of the fixed image in
+   * advance, so that the noise of a sample does not depend on the thread
+   * that handles it.
+   */
+  this->m_RandomGenerator->Initialize();
+  this->m_SelfHessianNoise.resize( sampleContainer->Size() * FixedImageDimension );
+  for( std::size_t k = 0; k < this->m_SelfHessianNoise.size(); ++k )
+  {
+    this->m_SelfHessianNoise[ k ] = this->m_RandomGenerator->GetVariateWithClosedRange(
+      this->m_SelfHessianNoiseRange ) - this->m_SelfHessianNoiseRange / 2.0;
+  }
+
+  /** Let the threads add the contributions of their samples. The contribution
+   * of a sample is the outer product of its image Jacobian: a single factor.
+   */
+  this->m_NumberOfPixelsCounted
+    = this->LaunchGetSelfHessianThreaderCallback( sampleContainer, 1, H );
+
+  /** Clean up. */
+  this->m_SelfHessianFixedInterpolator = 0;
+  std::vector< double >().swap( this->m_SelfHessianNoise );
+
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples(
+    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
+
+  /** Normalize the Hessian. */
+  if( this->m_NumberOfPixelsCounted > 0 )
+  {
+    const double normal_sum = 2.0 * this->m_NormalizationFactor
+      / static_cast< double >( this->m_NumberOfPixelsCounted );
+    H.Scale( normal_sum );
+  }
+  else
+  {
+    H.SetDiagonalPattern( this->GetNumberOfParameters() );
+    H.Fill( 1.0 );
+  }
+
+} // end GetCompressedSelfHessian()
+
+
+/**
+ * ******************* ThreadedGetSelfHessian *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetSelfHessian( ThreadIdType threadId )
+{
+  /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
+  const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  NonZeroJacobianIndicesType   nzji( nnzji );
+  DerivativeType               imageJacobian( nnzji );
+  TransformJacobianType        jacobian;
+
+  /** Get the samples of the current block for this thread. */
+  unsigned long pos_begin = 0;
+  unsigned long pos_end   = 0;
+  this->GetSelfHessianSamplesOfThread( threadId, pos_begin, pos_end );
+
   /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
+  ImageSampleContainerType * sampleContainer = this->m_SelfHessianSampleContainer;
+  typename ImageSampleContainerType::ConstIterator threader_fiter;
+  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator threader_fend   = sampleContainer->Begin();
 
-  /** Loop over the fixed image to calculate the mean squares. */
-  for( fiter = fbegin; fiter != fend; ++fiter )
+  threader_fbegin += (int)pos_begin;
+  threader_fend   += (int)pos_end;
+
+  /** Loop over the fixed image samples of this thread. */
+  unsigned long sampleNr = pos_begin;
+  for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter, ++sampleNr )
   {
     /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
+    const FixedImagePointType & fixedPoint = ( *threader_fiter ).Value().m_ImageCoordinates;
     MovingImagePointType        mappedPoint;
     MovingImageDerivativeType   movingImageDerivative;
 
@@ -913,18 +1099,15 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 
     if( sampleOk )
     {
-      this->m_NumberOfPixelsCounted++;
-
       /** Use the derivative of the fixed image for the self Hessian!
        * \todo: we can do this more efficient without the interpolation,
        * without the sampler, and with a precomputed gradient image,
        * but is this the bottleneck?
        */
-      movingImageDerivative = fixedInterpolator->EvaluateDerivative( fixedPoint );
+      movingImageDerivative = this->m_SelfHessianFixedInterpolator->EvaluateDerivative( fixedPoint );
       for( unsigned int d = 0; d < FixedImageDimension; ++d )
       {
-        movingImageDerivative[ d ] += randomGenerator->GetVariateWithClosedRange(
-          this->m_SelfHessianNoiseRange ) - this->m_SelfHessianNoiseRange / 2.0;
+        movingImageDerivative[ d ] += this->m_SelfHessianNoise[ sampleNr * FixedImageDimension + d ];
       }
 
       /** Get the TransformJacobian dT/dmu. */
@@ -934,109 +1117,17 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
       this->EvaluateTransformJacobianInnerProduct(
         jacobian, movingImageDerivative, imageJacobian );
 
-      /** Compute this pixel's contribution to the SelfHessian. */
-      this->UpdateSelfHessianTerms( imageJacobian, nzji, H );
+      /** This pixel's contribution to the SelfHessian is the outer product
+       * of the image Jacobian with itself.
+       */
+      std::copy( imageJacobian.begin(), imageJacobian.end(),
+        this->GetSelfHessianFactors( sampleNr, nzji ) );
 
     } // end if sampleOk
 
   } // end for loop over the image sample container
 
-  /** Check if enough samples were valid. */
-  this->CheckNumberOfSamples(
-    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
-
-  /** Compute the measure value and derivative. */
-  if( this->m_NumberOfPixelsCounted > 0 )
-  {
-    const double normal_sum = 2.0 * this->m_NormalizationFactor
-      / static_cast< double >( this->m_NumberOfPixelsCounted );
-    for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
-    {
-      H.scale_row( i, normal_sum );
-    }
-  }
-  else
-  {
-    //H.fill_diagonal(1.0);
-    for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
-    {
-      H( i, i ) = 1.0;
-    }
-  }
-
-} // end GetSelfHessian()
-
-
-/**
- * *************** UpdateSelfHessianTerms ***************************
- */
-
-template< class TFixedImage, class TMovingImage >
-void
-AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
-::UpdateSelfHessianTerms(
-  const DerivativeType & imageJacobian,
-  const NonZeroJacobianIndicesType & nzji,
-  HessianType & H ) const
-{
-  typedef typename HessianType::row    RowType;
-  typedef typename RowType::iterator   RowIteratorType;
-  typedef typename HessianType::pair_t ElementType;
-
-  // does not work for sparse matrix. \todo: distinguish between sparse and nonsparse
-  ///** Do rank-1 update of H */
-  //if ( nzji.size() == this->GetNumberOfParameters() )
-  //{
-  //  /** Loop over all Jacobians. */
-  //  vnl_matrix_update( H, imageJacobian, imageJacobian );
-  //}
-  //else
-  //{
-  /** Only pick the nonzero Jacobians.
-  * Save only upper triangular part of the matrix */
-  const unsigned int imjacsize = imageJacobian.GetSize();
-  for( unsigned int i = 0; i < imjacsize; ++i )
-  {
-    const unsigned int row      = nzji[ i ];
-    const double       imjacrow = imageJacobian[ i ];
-
-    RowType &       rowVector = H.get_row( row );
-    RowIteratorType rowIt     = rowVector.begin();
-
-    for( unsigned int j = i; j < imjacsize; ++j )
-    {
-      const unsigned int col = nzji[ j ];
-      const double       val = imjacrow * imageJacobian[ j ];
-      if( ( val < 1e-14 ) && ( val > -1e-14 ) )
-      {
-        continue;
-      }
-
-      /** The following implements:
-       * H(row,col) += imjacrow * imageJacobian[ j ];
-       * But more efficient.
-       */
-
-      /** Go to next element */
-      for(; ( rowIt != rowVector.end() ) && ( ( *rowIt ).first < col ); ++rowIt )
-      {}
-
-      if( ( rowIt == rowVector.end() ) || ( ( *rowIt ).first != col ) )
-      {
-        /** Add new column to the row and set iterator to that column. */
-        rowIt = rowVector.insert( rowIt, ElementType( col, val ) );
-      }
-      else
-      {
-        /** Add to existing value */
-        ( *rowIt ).second += val;
-      }
-    }
-  }
-
-  //} // end else
-
-} // end UpdateSelfHessianTerms()
+} // end ThreadedGetSelfHessian()
 
 
 } // end namespace itk
@@ -180,6 +180,10 @@ public:
     const TransformParametersType & parameters,
     MeasureType & value, DerivativeType & derivative ) const;
 
+  /** The multi-threaded code path may be evaluated concurrently. */
+  virtual bool GetSupportsConcurrentGetValueAndDerivative( void ) const
+  { return this->m_UseMultiThread; }
+
   /** Set/Get SubtractMean boolean. If true, the sample mean is subtracted
    * from the sample values in the cross-correlation formula and
    * typically results in narrower valleys in the cost function.
@@ -209,6 +213,7 @@ protected:
   typedef typename Superclass::CentralDifferenceGradientFilterType CentralDifferenceGradientFilterType;
   typedef typename Superclass::MovingImageDerivativeType           MovingImageDerivativeType;
   typedef typename Superclass::NonZeroJacobianIndicesType          NonZeroJacobianIndicesType;
+  typedef typename Superclass::ScratchSpacePerThreadStruct         ScratchSpacePerThreadStruct;
 
   /** Compute a pixel's contribution to the derivative terms;
    * Called by GetValueAndDerivative().
@@ -228,9 +233,20 @@ protected:
    */
   virtual void InitializeThreadingParameters( void ) const;
 
-  /** Get value and derivatives for each thread. */
+  /** Allocate the derivatives of the nonempty work units of the deterministic
+   * reduction, and free the others. Overrides the function in
+   * AdvancedImageToImageMetric, because here we use other derivatives.
+   */
+  virtual void InitializeDeterministicWorkUnits( const SizeValueType numberOfSamples ) const;
+
+  /** Get value and derivatives for each thread.
+   * Dispatches to ThreadedGetValueAndDerivativeKernel(). */
   inline void ThreadedGetValueAndDerivative( ThreadIdType threadID );
 
+  /** The loop over the samples of ThreadedGetValueAndDerivative(). */
+  template< class TSampleEvaluator >
+  void ThreadedGetValueAndDerivativeKernel( ThreadIdType threadID );
+
   /** Gather the values and derivatives from all threads */
   inline void AfterThreadedGetValueAndDerivative(
     MeasureType & value, DerivativeType & derivative ) const;
@@ -238,6 +254,10 @@ protected:
   /** AccumulateDerivatives threader callback function */
   static ITK_THREAD_RETURN_TYPE AccumulateDerivativesThreaderCallback( void * arg );
 
+  /** The threaded loops support deterministic reduction. */
+  virtual bool GetSupportsDeterministicReduction( void ) const
+  { return true; }
+
 private:
 
   AdvancedNormalizedCorrelationImageToImageMetric( const Self & ); // purposely not implemented
@@ -76,20 +76,24 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
    * which has performance benefits for larger vector sizes.
    */
 
-  /** Only resize the array of structs when needed. */
-  if( this->m_CorrelationGetValueAndDerivativePerThreadVariablesSize != this->m_NumberOfThreads )
+  /** Only resize the array of structs when needed. With deterministic reduction
+   * the number of work units may be lowered in each iteration, so do not shrink.
+   */
+  if( this->m_CorrelationGetValueAndDerivativePerThreadVariablesSize < this->m_NumberOfWorkUnits
+    || ( !this->m_UseDeterministicReductionInThreads
+    && this->m_CorrelationGetValueAndDerivativePerThreadVariablesSize != this->m_NumberOfWorkUnits ) )
   {
     delete[] this->m_CorrelationGetValueAndDerivativePerThreadVariables;
     this->m_CorrelationGetValueAndDerivativePerThreadVariables
       = new AlignedCorrelationGetValueAndDerivativePerThreadStruct[ this->
-      m_NumberOfThreads ];
-    this->m_CorrelationGetValueAndDerivativePerThreadVariablesSize = this->m_NumberOfThreads;
+      m_NumberOfWorkUnits ];
+    this->m_CorrelationGetValueAndDerivativePerThreadVariablesSize = this->m_NumberOfWorkUnits;
   }
 
   /** Some initialization. */
   const AccumulateType      zero1 = NumericTraits< AccumulateType >::Zero;
   const DerivativeValueType zero2 = NumericTraits< DerivativeValueType >::Zero;
-  for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
+  for( ThreadIdType i = 0; i < this->m_NumberOfWorkUnits; ++i )
   {
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted = NumericTraits< SizeValueType >::Zero;
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Sff                   = zero1;
@@ -97,6 +101,14 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Sfm                   = zero1;
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Sf                    = zero1;
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Sm                    = zero1;
+
+    /** With deterministic reduction the derivatives are allocated by
+     * InitializeDeterministicWorkUnits(), once the number of samples is known.
+     */
+    if( this->m_UseDeterministicReductionInThreads )
+    {
+      continue;
+    }
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF.SetSize( this->GetNumberOfParameters() );
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeM.SetSize( this->GetNumberOfParameters() );
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Differential.SetSize( this->GetNumberOfParameters() );
@@ -108,6 +120,38 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 } // end InitializeThreadingParameters()
 
 
+/**
+ * ******************* InitializeDeterministicWorkUnits *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeDeterministicWorkUnits( const SizeValueType numberOfSamples ) const
+{
+  this->m_NumberOfWorkUnits = this->GetNumberOfDeterministicWorkUnits( numberOfSamples );
+
+  /** Allocate the derivatives of the used work units, and free the others. */
+  const DerivativeValueType zero = NumericTraits< DerivativeValueType >::Zero;
+  for( ThreadIdType i = 0; i < this->m_CorrelationGetValueAndDerivativePerThreadVariablesSize; ++i )
+  {
+    AlignedCorrelationGetValueAndDerivativePerThreadStruct & workUnit
+      = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ];
+    const NumberOfParametersType size = i < this->m_NumberOfWorkUnits ? this->GetNumberOfParameters() : 0;
+    if( workUnit.st_DerivativeF.GetSize() != size )
+    {
+      workUnit.st_DerivativeF.SetSize( size );
+      workUnit.st_DerivativeM.SetSize( size );
+      workUnit.st_Differential.SetSize( size );
+      workUnit.st_DerivativeF.Fill( zero );
+      workUnit.st_DerivativeM.Fill( zero );
+      workUnit.st_Differential.Fill( zero );
+    }
+  }
+
+} // end InitializeDeterministicWorkUnits()
+
+
 /**
  * ******************* PrintSelf *******************
  */
@@ -530,10 +574,34 @@ void
 AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 ::ThreadedGetValueAndDerivative( ThreadIdType threadId )
 {
-  /** Initialize array that stores dM(x)/dmu, and the sparse Jacobian + indices. */
-  const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
-  NonZeroJacobianIndicesType   nzji  = NonZeroJacobianIndicesType( nnzji );
-  DerivativeType               imageJacobian( nzji.size() );
+  itkAdvancedImageToImageMetricDispatchKernelMacro( ThreadedGetValueAndDerivativeKernel, ( threadId ) );
+
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivativeKernel *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+template< class TSampleEvaluator >
+void
+AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetValueAndDerivativeKernel( ThreadIdType threadId )
+{
+  /** The evaluator of the transform, mask and interpolator. */
+  TSampleEvaluator evaluator( this );
+
+  /** Get the array that stores dM(x)/dmu, and the sparse Jacobian indices,
+   * from the scratch space of this thread, see InitializeScratchSpace().
+   */
+  ScratchSpacePerThreadStruct & scratch = this->m_ScratchSpacePerThreadVariables[ threadId ];
+  const NumberOfParametersType  nnzji   = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  NonZeroJacobianIndicesType &  nzji    = scratch.st_NonZeroJacobianIndices;
+  nzji.resize( nnzji );
+  DerivativeType imageJacobian;
+  scratch.st_Arena.Release();
+  scratch.st_Arena.Allocate( imageJacobian, nnzji );
 
   /** Get handles to the pre-allocated derivatives for the current thread.
    * The initialization is performed at the beginning of each resolution in
@@ -551,7 +619,7 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   /** Get the samples for this thread. */
   const unsigned long nrOfSamplesPerThreads
     = static_cast< unsigned long >( vcl_ceil( static_cast< double >( sampleContainerSize )
-    / static_cast< double >( this->m_NumberOfThreads ) ) );
+    / static_cast< double >( this->m_NumberOfWorkUnits ) ) );
 
   unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
   unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
@@ -584,12 +652,12 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
     MovingImageDerivativeType   movingImageDerivative;
 
     /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    bool sampleOk = evaluator.TransformPoint( fixedPoint, mappedPoint );
 
     /** Check if point is inside mask. */
     if( sampleOk )
     {
-      sampleOk = this->IsInsideMovingMask( mappedPoint );
+      sampleOk = evaluator.IsInsideMovingMask( mappedPoint );
     }
 
     /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
@@ -597,7 +665,7 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
      */
     if( sampleOk )
     {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
+      sampleOk = evaluator.EvaluateMovingImageValueAndDerivative(
         mappedPoint, movingImageValue, &movingImageDerivative );
     }
 
@@ -609,18 +677,9 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
       const RealType & fixedImageValue
         = static_cast< RealType >( ( *threader_fiter ).Value().m_ImageValue );
 
-#if 0
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
-
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
-#else
       /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
-      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+      evaluator.EvaluateJacobianWithImageGradientProduct(
         fixedPoint, movingImageDerivative, imageJacobian, nzji );
-#endif
 
       /** Update some sums needed to calculate the value of NC. */
       sff += fixedImageValue  * fixedImageValue;
@@ -646,7 +705,7 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_Sf                    = sf;
   this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_Sm                    = sm;
 
-} // end ThreadedGetValueAndDerivative()
+} // end ThreadedGetValueAndDerivativeKernel()
 
 
 /**
@@ -662,7 +721,7 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   /** Accumulate the number of pixels. */
   this->m_NumberOfPixelsCounted
     = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ 0 ].st_NumberOfPixelsCounted;
-  for( ThreadIdType i = 1; i < this->m_NumberOfThreads; ++i )
+  for( ThreadIdType i = 1; i < this->m_NumberOfWorkUnits; ++i )
   {
     this->m_NumberOfPixelsCounted
       += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted;
@@ -683,7 +742,7 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   AccumulateType       sfm  = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ 0 ].st_Sfm;
   AccumulateType       sf   = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ 0 ].st_Sf;
   AccumulateType       sm   = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ 0 ].st_Sm;
-  for( ThreadIdType i = 1; i < this->m_NumberOfThreads; ++i )
+  for( ThreadIdType i = 1; i < this->m_NumberOfWorkUnits; ++i )
   {
     sff += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Sff;
     smm += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Smm;
@@ -730,7 +789,7 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
     DerivativeType & derivativeM  = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ 0 ].st_DerivativeM;
     DerivativeType & differential = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ 0 ].st_Differential;
 
-    for( ThreadIdType i = 1; i < this->m_NumberOfThreads; ++i )
+    for( ThreadIdType i = 1; i < this->m_NumberOfWorkUnits; ++i )
     {
       derivativeF  += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF;
       derivativeM  += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeM;
@@ -778,11 +837,12 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   else
   {
     const int            spaceDimension = static_cast< int >( this->GetNumberOfParameters() );
+    const int            nthreads       = static_cast< int >( this->m_NumberOfThreads );
     const AccumulateType sf_N           = sf / N;
     const AccumulateType sm_N           = sm / N;
     const AccumulateType sfm_smm        = sfm / smm;
 
-    #pragma omp parallel for
+    #pragma omp parallel for num_threads( nthreads )
     for( int j = 0; j < spaceDimension; ++j )
     {
       DerivativeValueType derivativeF
@@ -792,7 +852,7 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
       DerivativeValueType differential
         = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ 0 ].st_Differential[ j ];
 
-      for( ThreadIdType i = 1; i < this->m_NumberOfThreads; ++i )
+      for( ThreadIdType i = 1; i < this->m_NumberOfWorkUnits; ++i )
       {
         derivativeF  += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF[ j ];
         derivativeM  += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeM[ j ];
@@ -842,16 +902,30 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   unsigned int jmax = ( threadId + 1 ) * subSize;
   jmax = ( jmax > numPar ) ? numPar : jmax;
 
-  const DerivativeValueType zero = NumericTraits< DerivativeValueType >::Zero;
+  const DerivativeValueType zero          = NumericTraits< DerivativeValueType >::Zero;
+  const ThreadIdType        nrOfWorkUnits = temp->st_Metric->m_NumberOfWorkUnits;
+  const bool                pairwise      = temp->st_Metric->m_UseDeterministicReductionInThreads;
   DerivativeValueType       derivativeF, derivativeM, differential;
+  DerivativeValueType       partialF[ Superclass::MaximumNumberOfDeterministicWorkUnits ];
+  DerivativeValueType       partialM[ Superclass::MaximumNumberOfDeterministicWorkUnits ];
+  DerivativeValueType       partialDifferential[ Superclass::MaximumNumberOfDeterministicWorkUnits ];
   for( unsigned int j = jmin; j < jmax; ++j )
   {
     derivativeF = derivativeM = differential = zero;
-    for( ThreadIdType i = 0; i < nrOfThreads; ++i )
+    for( ThreadIdType i = 0; i < nrOfWorkUnits; ++i )
     {
-      derivativeF  += temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF[ j ];
-      derivativeM  += temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeM[ j ];
-      differential += temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Differential[ j ];
+      if( pairwise )
+      {
+        partialF[ i ]            = temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF[ j ];
+        partialM[ i ]            = temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeM[ j ];
+        partialDifferential[ i ] = temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Differential[ j ];
+      }
+      else
+      {
+        derivativeF  += temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF[ j ];
+        derivativeM  += temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeM[ j ];
+        differential += temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Differential[ j ];
+      }
 
       /** Reset these variables for the next iteration. */
       temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF[ j ]  = zero;
@@ -859,6 +933,14 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
       temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Differential[ j ] = zero;
     }
 
+    /** With deterministic reduction, sum in an order that does not depend on the threads. */
+    if( pairwise )
+    {
+      derivativeF  = Superclass::PairwiseSum( partialF, nrOfWorkUnits );
+      derivativeM  = Superclass::PairwiseSum( partialM, nrOfWorkUnits );
+      differential = Superclass::PairwiseSum( partialDifferential, nrOfWorkUnits );
+    }
+
     if( subtractMean )
     {
       derivativeF -= sf_N * differential;
@@ -124,6 +124,7 @@ public:
   typedef typename Superclass::InternalMatrixType InternalMatrixType;
   typedef typename Superclass::HessianValueType   HessianValueType;
   typedef typename Superclass::HessianType        HessianType;
+  typedef typename Superclass::CSRHessianType     CSRHessianType;
 
   /** Define the dimension. */
   itkStaticConstMacro( FixedImageDimension, unsigned int, FixedImageType::ImageDimension );
@@ -146,6 +147,10 @@ public:
     MeasureType & value,
     DerivativeType & derivative ) const;
 
+  /** The multi-threaded code path may be evaluated concurrently. */
+  virtual bool GetSupportsConcurrentGetValueAndDerivative( void ) const
+  { return this->m_UseMultiThread; }
+
   /** Get value and derivatives for each thread. */
   inline void ThreadedGetValueAndDerivative( ThreadIdType threadID );
 
@@ -153,9 +158,17 @@ public:
   inline void AfterThreadedGetValueAndDerivative(
     MeasureType & value, DerivativeType & derivative ) const;
 
-  /** Experimental feature: compute SelfHessian */
+  /** Experimental feature: compute SelfHessian.
+   * Computes the compressed SelfHessian, and converts it to a vnl_sparse_matrix.
+   */
   virtual void GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const;
 
+  /** Experimental feature: compute SelfHessian in compressed sparse row format.
+   * The samples are distributed over the threads.
+   */
+  virtual void GetCompressedSelfHessian( const TransformParametersType & parameters,
+    CSRHessianType & H ) const;
+
   /** Default: 100000 */
   itkSetMacro( NumberOfSamplesForSelfHessian, unsigned int );
   itkGetConstMacro( NumberOfSamplesForSelfHessian, unsigned int );
@@ -174,6 +187,14 @@ protected:
   /** Typedefs for SelfHessian */
   typedef ImageGridSampler< FixedImageType > SelfHessianSamplerType;
 
+  /** Compute the SelfHessian contributions of the samples of a thread;
+   * Called by GetCompressedSelfHessian(). */
+  inline void ThreadedGetSelfHessian( ThreadIdType threadID );
+
+  /** The threaded loops support deterministic reduction. */
+  virtual bool GetSupportsDeterministicReduction( void ) const
+  { return true; }
+
   /** The constructor. */
   TransformBendingEnergyPenaltyTerm();
 
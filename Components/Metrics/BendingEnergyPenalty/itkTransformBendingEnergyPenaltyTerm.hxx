@@ -443,7 +443,7 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   /** Get the samples for this thread. */
   const unsigned long nrOfSamplesPerThreads
     = static_cast< unsigned long >( vcl_ceil( static_cast< double >( sampleContainerSize )
-    / static_cast< double >( this->m_NumberOfThreads ) ) );
+    / static_cast< double >( this->m_NumberOfWorkUnits ) ) );
 
   unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
   unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
@@ -594,7 +594,7 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
 {
   /** Accumulate the number of pixels. */
   this->m_NumberOfPixelsCounted = 0;
-  for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
+  for( ThreadIdType i = 0; i < this->m_NumberOfWorkUnits; ++i )
   {
     this->m_NumberOfPixelsCounted += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted;
 
@@ -609,7 +609,7 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
 
   /** Accumulate and normalize values. */
   value = NumericTraits< MeasureType >::Zero;
-  for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
+  for( ThreadIdType i = 0; i < this->m_NumberOfWorkUnits; ++i )
   {
     value += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value;
 
@@ -625,7 +625,7 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   if( !this->m_UseMultiThread )
   {
     derivative = this->m_GetValueAndDerivativePerThreadVariables[ 0 ].st_Derivative;
-    for( ThreadIdType i = 1; i < this->m_NumberOfThreads; ++i )
+    for( ThreadIdType i = 1; i < this->m_NumberOfWorkUnits; ++i )
     {
       derivative += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative;
     }
@@ -646,15 +646,14 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   // compute multi-threadedly with openmp
   else
   {
-    const DerivativeValueType numPix   = static_cast< DerivativeValueType >( this->m_NumberOfPixelsCounted );
-    const int                 nthreads = static_cast< int >( this->m_NumberOfThreads );
-    omp_set_num_threads( nthreads );
-    const int spaceDimension = static_cast< int >( this->GetNumberOfParameters() );
-    #pragma omp parallel for
+    const DerivativeValueType numPix         = static_cast< DerivativeValueType >( this->m_NumberOfPixelsCounted );
+    const int                 nthreads       = static_cast< int >( this->m_NumberOfThreads );
+    const int                 spaceDimension = static_cast< int >( this->GetNumberOfParameters() );
+    #pragma omp parallel for num_threads( nthreads )
     for( int j = 0; j < spaceDimension; ++j )
     {
       DerivativeValueType tmp = NumericTraits< DerivativeValueType >::Zero;
-      for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
+      for( ThreadIdType i = 0; i < this->m_NumberOfWorkUnits; ++i )
       {
         tmp += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative[ j ];
       }
@@ -677,35 +676,39 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
 {
   itkDebugMacro( "GetSelfHessian()" );
 
-  typedef typename HessianType::row    RowType;
-  typedef typename RowType::iterator   RowIteratorType;
-  typedef typename HessianType::pair_t ElementType;
+  CSRHessianType compressedH;
+  this->GetCompressedSelfHessian( parameters, compressedH );
+  compressedH.GetVnlSparseMatrix( H );
 
-  /** Initialize some variables. */
-  this->m_NumberOfPixelsCounted = 0;
+} // end GetSelfHessian()
 
-  /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
-  NonZeroJacobianIndicesType nonZeroJacobianIndices(
-  this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
-  JacobianOfSpatialHessianType jacobianOfSpatialHessian;
+
+/**
+ * ******************* GetCompressedSelfHessian *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::GetCompressedSelfHessian( const TransformParametersType & parameters,
+  CSRHessianType & H ) const
+{
+  itkDebugMacro( "GetCompressedSelfHessian()" );
 
   /** Make sure the transform parameters are up to date. */
   //this->SetTransformParameters( parameters );
 
-  /** Prepare Hessian */
-  H.set_size( this->GetNumberOfParameters(),
-    this->GetNumberOfParameters() );
-  //H.Fill(0.0); //done by set_size for sparse matrix
+  /** Return the identity if the Jacobian of the spatial Hessian is zero. */
   if( !this->m_AdvancedTransform->GetHasNonZeroJacobianOfSpatialHessian() )
   {
-    //H.fill_diagonal(1.0);
-    for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
-    {
-      H( i, i ) = 1.0;
-    }
+    H.SetDiagonalPattern( this->GetNumberOfParameters() );
+    H.Fill( 1.0 );
     return;
   }
 
+  /** Prepare Hessian: set the sparsity pattern, and zero it. */
+  this->InitializeSelfHessianPattern( H );
+
   /** Set up grid sampler */
   typename SelfHessianSamplerType::Pointer sampler = SelfHessianSamplerType::New();
   sampler->SetInputImageRegion( this->GetImageSampler()->GetInputImageRegion() );
@@ -717,16 +720,69 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   sampler->Update();
   ImageSampleContainerPointer sampleContainer = sampler->GetOutput();
 
+  /** Let the threads add the contributions of their samples. The contribution
+   * of a sample is the inner product of the spatial Hessians of the Jacobian:
+   * a factor for each of their elements.
+   */
+  this->m_NumberOfPixelsCounted = this->LaunchGetSelfHessianThreaderCallback(
+    sampleContainer, FixedImageDimension * FixedImageDimension * FixedImageDimension, H );
+
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples(
+    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
+
+  /** Normalize the Hessian. The factor 2 comes from the derivative of the
+   * squared second order derivatives.
+   */
+  if( this->m_NumberOfPixelsCounted > 0 )
+  {
+    const double normal_sum = 2.0 / static_cast< double >( this->m_NumberOfPixelsCounted );
+    H.Scale( normal_sum );
+  }
+  else
+  {
+    H.SetDiagonalPattern( this->GetNumberOfParameters() );
+    H.Fill( 1.0 );
+  }
+
+} // end GetCompressedSelfHessian()
+
+
+/**
+ * ******************* ThreadedGetSelfHessian *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::ThreadedGetSelfHessian( ThreadIdType threadId )
+{
+  /** Create and initialize some variables. */
+  const NumberOfParametersType nnzji
+    = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  NonZeroJacobianIndicesType   nonZeroJacobianIndices( nnzji );
+  JacobianOfSpatialHessianType jacobianOfSpatialHessian( nnzji );
+
+  /** Get the samples of the current block for this thread. */
+  unsigned long pos_begin = 0;
+  unsigned long pos_end   = 0;
+  this->GetSelfHessianSamplesOfThread( threadId, pos_begin, pos_end );
+
   /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
+  ImageSampleContainerType * sampleContainer = this->m_SelfHessianSampleContainer;
+  typename ImageSampleContainerType::ConstIterator threader_fiter;
+  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator threader_fend   = sampleContainer->Begin();
+
+  threader_fbegin += (int)pos_begin;
+  threader_fend   += (int)pos_end;
 
   /** Loop over the fixed image to calculate the d/dmu dT/dxdx terms. */
-  for( fiter = fbegin; fiter != fend; ++fiter )
+  unsigned long sampleNr = pos_begin;
+  for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter, ++sampleNr )
   {
     /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
+    const FixedImagePointType & fixedPoint = ( *threader_fiter ).Value().m_ImageCoordinates;
     MovingImagePointType        mappedPoint;
 
     /** Although the mapped point is not needed to compute the penalty term,
@@ -743,102 +799,36 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
       sampleOk = this->IsInsideMovingMask( mappedPoint );
     }
 
-    if( sampleOk )
+    if( !sampleOk )
     {
-      this->m_NumberOfPixelsCounted++;
+      continue;
+    }
 
-      this->m_AdvancedTransform->GetJacobianOfSpatialHessian( fixedPoint,
-        jacobianOfSpatialHessian, nonZeroJacobianIndices );
+    this->m_AdvancedTransform->GetJacobianOfSpatialHessian( fixedPoint,
+      jacobianOfSpatialHessian, nonZeroJacobianIndices );
 
-      /** Compute the contribution to the metric derivative of this point. */
-      for( unsigned int muA = 0; muA < nonZeroJacobianIndices.size(); ++muA )
+    /** The contribution of this point to entry (muA, muB) is
+     * \sum_k \sum_ij A_kij B_kij, with A and B the spatial Hessians of
+     * parameters muA and muB. Factor a = ( k, i, j ) of parameter mu is
+     * element ( i, j ) of the k-th spatial Hessian of mu.
+     */
+    HessianValueType * factors = this->GetSelfHessianFactors( sampleNr, nonZeroJacobianIndices );
+    for( unsigned int mu = 0; mu < nnzji; ++mu )
+    {
+      unsigned int a = 0;
+      for( unsigned int k = 0; k < FixedImageDimension; ++k )
       {
-        const unsigned int nmA       = nonZeroJacobianIndices[ muA ];
-        RowType &          rowVector = H.get_row( nmA );
-        RowIteratorType    rowIt     = rowVector.begin();
-
-        for( unsigned int muB = muA; muB < nonZeroJacobianIndices.size(); ++muB )
+        const InternalMatrixType & A = jacobianOfSpatialHessian[ mu ][ k ].GetVnlMatrix();
+        for( typename InternalMatrixType::const_iterator itA = A.begin(); itA != A.end(); ++itA, ++a )
         {
-          const unsigned int nmB = nonZeroJacobianIndices[ muB ];
-
-          RealType matrixProduct = 0.0;
-          for( unsigned int k = 0; k < FixedImageDimension; ++k )
-          {
-            /** This computes:
-             * \sum_i \sum_j A_ij B_ij = element_product(A,B).mean()*B.size()
-             */
-            const InternalMatrixType & A
-              = jacobianOfSpatialHessian[ muA ][ k ].GetVnlMatrix();
-            const InternalMatrixType & B
-              = jacobianOfSpatialHessian[ muB ][ k ].GetVnlMatrix();
-
-            typename InternalMatrixType::const_iterator itA    = A.begin();
-            typename InternalMatrixType::const_iterator itB    = B.begin();
-            typename InternalMatrixType::const_iterator itAend = A.end();
-            while( itA != itAend )
-            {
-              matrixProduct += ( *itA ) * ( *itB );
-              ++itA;
-              ++itB;
-            }
-
-          }
-
-          /** Store at the right location in the H matrix.
-          * Only upper triangular part is stored */
-
-          /** Update hessian element */
-          if( ( matrixProduct > 1e-12 ) || ( matrixProduct < 1e-12 ) )
-          {
-            /**
-            * H( nmA, nmB ) += 2.0 * matrixProduct;
-            * But more efficient
-            */
-            const double val = 2.0 * matrixProduct;
-
-            /** Go to next element */
-            for(; ( rowIt != rowVector.end() ) && ( ( *rowIt ).first < nmB ); ++rowIt )
-            {}
-
-            if( ( rowIt == rowVector.end() ) || ( ( *rowIt ).first != nmB ) )
-            {
-              /** Add new column to the row and set iterator to that column. */
-              rowIt = rowVector.insert( rowIt, ElementType( nmB, val ) );
-            }
-            else
-            {
-              /** Add to existing value */
-              ( *rowIt ).second += val;
-            }
-          }
+          factors[ a * nnzji + mu ] = *itA;
         }
       }
-    } // end if sampleOk
-  } // end for loop over the image sample container
-
-  /** Check if enough samples were valid. */
-  this->CheckNumberOfSamples(
-    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
-
-  /** Compute the measure value and derivative. */
-  if( this->m_NumberOfPixelsCounted > 0 )
-  {
-    const double normal_sum = 1.0 / static_cast< double >( this->m_NumberOfPixelsCounted );
-    for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
-    {
-      H.scale_row( i, normal_sum );
-    }
-  }
-  else
-  {
-    //H.fill_diagonal(1.0);
-    for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
-    {
-      H( i, i ) = 1.0;
     }
-  }
 
-} // end GetSelfHessian()
+  } // end for loop over the image sample container
+
+} // end ThreadedGetSelfHessian()
 
 
 } // end namespace itk
@@ -40,6 +40,9 @@
 /** Include for the spatial derivatives. */
 #include "itkArray2D.h"
 
+/** Include the sampler that can provide the fixed feature values. */
+#include "itkMultiInputImageRandomCoordinateSampler.h"
+
 namespace itk
 {
 /**
@@ -270,6 +273,11 @@ protected:
   double m_Alpha;
   double m_AvoidDivisionBy;
 
+  /** Whether the image sampler interpolates the fixed images in the same way
+   * as the fixed image interpolators, set by Initialize().
+   */
+  bool m_SamplerComputesFixedChannelValues;
+
 private:
 
   KNNGraphAlphaMutualInformationImageToImageMetric( const Self & ); // purposely not implemented
@@ -286,6 +294,10 @@ private:
   typedef Array2D< double >                         SpatialDerivativeType;
   typedef std::vector< SpatialDerivativeType >      SpatialDerivativeContainerType;
 
+  /** Typedefs for the fixed feature values computed by the sampler. */
+  typedef MultiInputImageRandomCoordinateSampler< FixedImageType > ChannelSamplerType;
+  typedef typename ChannelSamplerType::ChannelValueContainerType   ChannelValueContainerType;
+
   /** This function takes the fixed image samples from the ImageSampler
    * and puts them in the listSampleFixed, together with the fixed feature
    * image samples. Also the corresponding moving image values and moving
@@ -306,6 +318,19 @@ private:
     TransformJacobianIndicesContainerType & jacobiansIndices,
     SpatialDerivativeContainerType & spatialDerivatives ) const;
 
+  /** Check if the image sampler computes the values of all fixed images,
+   * from the same images and with the same interpolation as the fixed image
+   * interpolators. Called by Initialize().
+   */
+  virtual bool CheckSamplerChannelValues( void );
+
+  /** Returns the values of all fixed images at the samples, if the image
+   * sampler computed them with the same interpolation as the fixed image
+   * interpolators, see CheckSamplerChannelValues(). Otherwise 0 is returned,
+   * and the fixed feature images are interpolated by the metric.
+   */
+  virtual const ChannelValueContainerType * GetFixedImageChannelValues( void ) const;
+
   /** This function calculates the spatial derivative of the
    * featureNr feature image at the point mappedPoint.
    * \todo move this to base class.
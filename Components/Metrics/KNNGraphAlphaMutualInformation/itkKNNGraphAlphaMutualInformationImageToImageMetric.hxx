@@ -35,6 +35,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   this->SetUseImageSampler( true );
   this->m_Alpha           = 0.99;
   this->m_AvoidDivisionBy = 1e-10;
+  this->m_SamplerComputesFixedChannelValues = false;
 
   this->m_BinaryKNNTreeFixed  = 0;
   this->m_BinaryKNNTreeMoving = 0;
@@ -289,6 +290,9 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     itkExceptionMacro( << "ERROR: The kNN tree searcher is not set. " );
   }
 
+  /** Check if the fixed feature values can be taken from the image sampler. */
+  this->m_SamplerComputesFixedChannelValues = this->CheckSamplerChannelValues();
+
 } // end Initialize()
 
 
@@ -797,6 +801,9 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
   TransformJacobianType jacobian;
 
+  /** The fixed feature values may have been computed by the sampler already. */
+  const ChannelValueContainerType * fixedChannelValues = this->GetFixedImageChannelValues();
+
   /** Loop over the fixed image samples to calculate the list samples. */
   unsigned int ii = 0;
   for( fiter = fbegin; fiter != fend; ++fiter )
@@ -852,10 +859,18 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
         this->GetNumberOfFixedImages(), movingImageValue );
 
       /** Get and set the values of the fixed feature images. */
+      const unsigned long sampleIndex = fiter.Index();
       for( unsigned int j = 1; j < this->GetNumberOfFixedImages(); j++ )
       {
-        fixedFeatureValue = this->m_FixedImageInterpolatorVector[ j ]
-          ->Evaluate( fixedPoint );
+        if( fixedChannelValues )
+        {
+          fixedFeatureValue = ( *fixedChannelValues )[ sampleIndex * fixedSize + j ];
+        }
+        else
+        {
+          fixedFeatureValue = this->m_FixedImageInterpolatorVector[ j ]
+            ->Evaluate( fixedPoint );
+        }
         listSampleFixed->SetMeasurement(
           this->m_NumberOfPixelsCounted, j, fixedFeatureValue );
         listSampleJoint->SetMeasurement(
@@ -928,6 +943,85 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 } // end ComputeListSampleValuesAndDerivativePlusJacobian()
 
 
+/**
+ * ************************ CheckSamplerChannelValues *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::CheckSamplerChannelValues( void )
+{
+  /** Check that the sampler computes the values of all fixed images. */
+  ChannelSamplerType * sampler
+    = dynamic_cast< ChannelSamplerType * >( this->GetImageSampler() );
+  const unsigned int fixedSize = this->GetNumberOfFixedImages();
+  if( sampler == 0 || !sampler->GetComputeChannelValues()
+    || sampler->GetNumberOfInputs() != fixedSize )
+  {
+    return false;
+  }
+
+  /** Check that the sampler interpolates the fixed images themselves, and
+   * in the same way as the fixed image interpolators.
+   */
+  typedef BSplineInterpolateImageFunction<
+    FixedImageType, CoordinateRepresentationType, double > BSplineInterpolatorType;
+  for( unsigned int j = 0; j < fixedSize; ++j )
+  {
+    if( sampler->GetInput( j ) != this->GetFixedImage( j ) )
+    {
+      return false;
+    }
+    if( j == 0 )
+    {
+      continue;
+    }
+    const BSplineInterpolatorType * interpolator = dynamic_cast< const BSplineInterpolatorType * >(
+      this->m_FixedImageInterpolatorVector[ j ].GetPointer() );
+    if( interpolator == 0 || interpolator->GetSplineOrder() != sampler->GetChannelSplineOrder()
+      || interpolator->GetInputImage() != this->GetFixedImage( j ) )
+    {
+      return false;
+    }
+  }
+
+  return true;
+
+} // end CheckSamplerChannelValues()
+
+
+/**
+ * ************************ GetFixedImageChannelValues *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+const typename KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ChannelValueContainerType *
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::GetFixedImageChannelValues( void ) const
+{
+  if( !this->m_SamplerComputesFixedChannelValues )
+  {
+    return 0;
+  }
+
+  /** Check that the sampler computed the values for the current samples. */
+  ChannelSamplerType * sampler
+    = dynamic_cast< ChannelSamplerType * >( this->GetImageSampler() );
+  const unsigned int fixedSize = this->GetNumberOfFixedImages();
+  if( sampler == 0 || !sampler->GetComputeChannelValues()
+    || sampler->GetNumberOfChannels() != fixedSize
+    || sampler->GetChannelValues().size() != sampler->GetOutput()->Size() * fixedSize )
+  {
+    return 0;
+  }
+
+  return &sampler->GetChannelValues();
+
+} // end GetFixedImageChannelValues()
+
+
 /**
  * ************************ EvaluateMovingFeatureImageDerivatives *************************
  */
@@ -54,6 +54,11 @@ namespace elastix
  *    image, without using a fixed image. Possible values are "true" or "false".
  * \parameter NumEigenValues: number of eigenvalues used in the metric: sum(e) - e, where sum(e)
  *  is the sum of all eigenvalues and e is the sum of the first highest NumEigenValues eigenvalues.
+ * \parameter UseSliceBlockedDerivative: with a stack transform, such as the BSplineStackTransform,
+ *  EulerStackTransform, AffineLogStackTransform or TranslationStackTransform, the threads compute
+ *  the derivative per range of time points, and only zero and add the parameters of the
+ *  sub transforms they wrote. Used when there are at least as many time points as threads.
+ *  Can be given for each resolution. Default "true". \n
  *
  * \ingroup RegistrationMetrics
  * \ingroup Metrics
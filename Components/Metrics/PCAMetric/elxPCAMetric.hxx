@@ -67,6 +67,12 @@ PCAMetric< TElastix >
     "SubtractMean", this->GetComponentLabel(), 0, 0 );
   this->SetSubtractMean( subtractMean );
 
+  /** Get and set if the derivative is computed per block of time points. */
+  bool useSliceBlockedDerivative = true;
+  this->GetConfiguration()->ReadParameter( useSliceBlockedDerivative,
+    "UseSliceBlockedDerivative", this->GetComponentLabel(), level, 0 );
+  this->SetUseSliceBlockedDerivative( useSliceBlockedDerivative );
+
   /** Get and set the number of additional samples sampled at the fixed timepoint.  */
 //    unsigned int numAdditionalSamplesFixed = 0;
 //    this->GetConfiguration()->ReadParameter( numAdditionalSamplesFixed,
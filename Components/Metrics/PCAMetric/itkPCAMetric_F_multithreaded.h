@@ -24,6 +24,7 @@
 #include "itkImageRandomCoordinateSampler.h"
 #include "itkNearestNeighborInterpolateImageFunction.h"
 #include "itkExtractImageFilter.h"
+#include "itkStackTransform.h"
 
 namespace itk
 {
@@ -55,6 +56,16 @@ public:
   itkSetMacro( TransformIsStackTransform, bool );
   itkSetMacro( NumEigenValues, unsigned int );
 
+  /** Select if the threads of the derivative computation are assigned to
+   * time points instead of samples, when the transform is a StackTransform.
+   * Each thread then only zeroes and reduces the sub transform blocks of the
+   * derivative it wrote. Used when there are at least as many time points
+   * as threads. Default true.
+   */
+  itkSetMacro( UseSliceBlockedDerivative, bool );
+  itkGetConstMacro( UseSliceBlockedDerivative, bool );
+  itkBooleanMacro( UseSliceBlockedDerivative );
+
   /** Typedefs from the superclass. */
   typedef typename
     Superclass::CoordinateRepresentationType              CoordinateRepresentationType;
@@ -158,6 +169,9 @@ protected:
   typedef typename Superclass::CentralDifferenceGradientFilterType CentralDifferenceGradientFilterType;
   typedef typename Superclass::MovingImageDerivativeType           MovingImageDerivativeType;
   typedef typename Superclass::NonZeroJacobianIndicesType          NonZeroJacobianIndicesType;
+  typedef typename Superclass::CombinationTransformType            CombinationTransformType;
+  typedef StackTransform< typename Superclass::ScalarType,
+    FixedImageDimension, MovingImageDimension >                    StackTransformType;
 
   /** Computes the innerproduct of transform Jacobian with moving image gradient.
    * The results are stored in imageJacobian, which is supposed
@@ -180,6 +194,7 @@ protected:
     MatrixType                         st_DataBlock;
     std::vector< FixedImagePointType > st_ApprovedSamples;
     DerivativeType                     st_Derivative;
+    std::vector< bool >                st_DerivativeBlockIsUsed;
   };
 
   itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, PCAMetricGetSamplesPerThreadStruct,
@@ -197,6 +212,19 @@ protected:
 
   inline void ThreadedComputeDerivative( ThreadIdType threadID );
 
+  /** Compute the image Jacobian of a sample at time point d. */
+  inline void ComputeImageJacobianOfSample(
+    FixedImageContinuousIndexType & voxelCoord, const unsigned int d,
+    TransformJacobianType & jacobian, DerivativeType & imageJacobian,
+    NonZeroJacobianIndicesType & nzjis ) const;
+
+  /** Add the derivative terms of a sample at time point d. */
+  inline void AccumulateDerivativeOfSample(
+    const unsigned int pixelIndex, const unsigned int d,
+    const DerivativeType & imageJacobian,
+    const NonZeroJacobianIndicesType & nzjis,
+    DerivativeType & derivative ) const;
+
   /** Gather the values and derivatives from all threads */
   inline void AfterThreadedGetSamples( MeasureType & value ) const;
 
@@ -235,6 +263,12 @@ private:
   /** Integer to indicate how many eigenvalues you want to use in the metric */
   unsigned int m_NumEigenValues;
 
+  /** Variables for the slice-blocked derivative, set in Initialize(). */
+  bool         m_UseSliceBlockedDerivative;
+  bool         m_UseSliceBlockedDerivativeInThreads;
+  unsigned int m_NumberOfDerivativeBlocks;
+  unsigned int m_DerivativeBlockSize;
+
   /** Matrices, needed for derivative calculation */
   mutable std::vector< unsigned int > m_PixelStartIndex;
   mutable MatrixType                  m_Atmm;
@@ -28,6 +28,7 @@
 #include "vnl/algo/vnl_symmetric_eigensystem.h"
 #include <numeric>
 #include <fstream>
+#include <algorithm>
 
 #ifdef ELASTIX_USE_OPENMP
 #include <omp.h>
@@ -44,7 +45,11 @@ PCAMetric< TFixedImage, TMovingImage >
 ::PCAMetric() :
   m_SubtractMean( false ),
   m_TransformIsStackTransform( false ),
-  m_NumEigenValues( 6 )
+  m_NumEigenValues( 6 ),
+  m_UseSliceBlockedDerivative( true ),
+  m_UseSliceBlockedDerivativeInThreads( false ),
+  m_NumberOfDerivativeBlocks( 0 ),
+  m_DerivativeBlockSize( 0 )
 {
   this->SetUseImageSampler( true );
   this->SetUseFixedImageLimiter( false );
@@ -92,6 +97,37 @@ PCAMetric< TFixedImage, TMovingImage >
     std::cerr << "ERROR: Number of eigenvalues is larger than number of images. Maximum number of eigenvalues equals: "
               << this->m_G << std::endl;
   }
+
+  /** Check if the derivative can be computed per block of time points.
+   * The nonzero Jacobian indices of a StackTransform all lie in the block
+   * of parameters of one sub transform.
+   */
+  this->m_UseSliceBlockedDerivativeInThreads = false;
+  this->m_NumberOfDerivativeBlocks           = 0;
+  this->m_DerivativeBlockSize                = 0;
+  CombinationTransformType * combination
+    = dynamic_cast< CombinationTransformType * >( this->m_AdvancedTransform.GetPointer() );
+  const StackTransformType * stackTransform = 0;
+  if( combination )
+  {
+    stackTransform = dynamic_cast< const StackTransformType * >(
+      combination->GetCurrentTransform() );
+  }
+  else
+  {
+    stackTransform = dynamic_cast< const StackTransformType * >(
+      this->m_AdvancedTransform.GetPointer() );
+  }
+  if( stackTransform && stackTransform->GetNumberOfSubTransforms() > 1
+    && stackTransform->GetNumberOfParametersPerSubTransform() > 0 )
+  {
+    this->m_NumberOfDerivativeBlocks = stackTransform->GetNumberOfSubTransforms();
+    this->m_DerivativeBlockSize      = stackTransform->GetNumberOfParametersPerSubTransform();
+    this->m_UseSliceBlockedDerivativeInThreads = this->m_UseSliceBlockedDerivative
+      && this->m_UseMultiThread
+      && this->m_G >= this->m_NumberOfThreads;
+  }
+
 } // end Initializes
 
 
@@ -979,68 +1015,149 @@ PCAMetric< TFixedImage, TMovingImage >
 ::ThreadedComputeDerivative( ThreadIdType threadId )
 {
   /** Create variables to store intermediate results in. */
-  DerivativeType & derivative = this->m_PCAMetricGetSamplesPerThreadVariables[ threadId ].st_Derivative;
-  derivative.Fill( 0.0 );
+  DerivativeType &      derivative  = this->m_PCAMetricGetSamplesPerThreadVariables[ threadId ].st_Derivative;
+  std::vector< bool > & blockIsUsed = this->m_PCAMetricGetSamplesPerThreadVariables[ threadId ].st_DerivativeBlockIsUsed;
 
   /** Initialize some variables. */
-  RealType                  movingImageValue;
-  MovingImagePointType      mappedPoint;
-  MovingImageDerivativeType movingImageDerivative;
-
   TransformJacobianType      jacobian;
   DerivativeType             imageJacobian( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
   NonZeroJacobianIndicesType nzjis( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
 
-  unsigned int dummyindex = 0;
-  /** Second loop over fixed image samples. */
-  for( unsigned int pixelIndex = this->m_PixelStartIndex[ threadId ];
-    pixelIndex < ( this->m_PixelStartIndex[ threadId ] + this->m_PCAMetricGetSamplesPerThreadVariables[ threadId ].st_ApprovedSamples.size() );
-    ++pixelIndex )
+  if( !this->m_UseSliceBlockedDerivativeInThreads )
   {
-    /** Read fixed coordinates. */
-    FixedImagePointType fixedPoint = this->m_PCAMetricGetSamplesPerThreadVariables[ threadId ].st_ApprovedSamples[ dummyindex ];
-
-    /** Transform sampled point to voxel coordinates. */
-    FixedImageContinuousIndexType voxelCoord;
-    this->GetFixedImage()->TransformPhysicalPointToContinuousIndex( fixedPoint, voxelCoord );
+    derivative.Fill( 0.0 );
 
-    for( unsigned int d = 0; d < this->m_G; ++d )
+    unsigned int dummyindex = 0;
+    /** Second loop over fixed image samples. */
+    for( unsigned int pixelIndex = this->m_PixelStartIndex[ threadId ];
+      pixelIndex < ( this->m_PixelStartIndex[ threadId ] + this->m_PCAMetricGetSamplesPerThreadVariables[ threadId ].st_ApprovedSamples.size() );
+      ++pixelIndex )
     {
-      /** Set fixed point's last dimension to lastDimPosition. */
-      voxelCoord[ this->m_LastDimIndex ] = d;
+      /** Read fixed coordinates. */
+      const FixedImagePointType & fixedPoint = this->m_PCAMetricGetSamplesPerThreadVariables[ threadId ].st_ApprovedSamples[ dummyindex ];
 
-      /** Transform sampled point back to world coordinates. */
-      this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint( voxelCoord, fixedPoint );
-      this->TransformPoint( fixedPoint, mappedPoint );
+      /** Transform sampled point to voxel coordinates. */
+      FixedImageContinuousIndexType voxelCoord;
+      this->GetFixedImage()->TransformPhysicalPointToContinuousIndex( fixedPoint, voxelCoord );
 
-      this->EvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, &movingImageDerivative );
+      for( unsigned int d = 0; d < this->m_G; ++d )
+      {
+        this->ComputeImageJacobianOfSample( voxelCoord, d, jacobian, imageJacobian, nzjis );
+        this->AccumulateDerivativeOfSample( pixelIndex, d, imageJacobian, nzjis, derivative );
+      } //end loop over last dimension
+      dummyindex++;
 
-      /** Get the TransformJacobian dT/dmu */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzjis );
+    } // end second for loop over sample container
 
-      /** Compute the innerproduct (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
+    return;
+  }
 
-      /** build metric derivative components */
-      for( unsigned int p = 0; p < nzjis.size(); ++p )
+  /** This thread computes the derivative terms of its range of time points,
+   * for the approved samples of all threads. With a StackTransform these
+   * only write to the parameter blocks of the corresponding sub transforms,
+   * so only those blocks are zeroed, and reduced afterwards.
+   */
+  blockIsUsed.assign( this->m_NumberOfDerivativeBlocks, false );
+  const unsigned int dBegin = ( this->m_G * threadId ) / this->m_NumberOfThreads;
+  const unsigned int dEnd   = ( this->m_G * ( threadId + 1 ) ) / this->m_NumberOfThreads;
+  for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
+  {
+    const std::vector< FixedImagePointType > & approvedSamples
+      = this->m_PCAMetricGetSamplesPerThreadVariables[ i ].st_ApprovedSamples;
+    for( unsigned int s = 0; s < approvedSamples.size(); ++s )
+    {
+      const unsigned int pixelIndex = this->m_PixelStartIndex[ i ] + s;
+
+      /** Transform sampled point to voxel coordinates. */
+      FixedImageContinuousIndexType voxelCoord;
+      this->GetFixedImage()->TransformPhysicalPointToContinuousIndex( approvedSamples[ s ], voxelCoord );
+
+      for( unsigned int d = dBegin; d < dEnd; ++d )
       {
-        DerivativeValueType tmp = 0.0;
-        for( unsigned int z = 0; z < this->m_NumEigenValues; z++ )
+        this->ComputeImageJacobianOfSample( voxelCoord, d, jacobian, imageJacobian, nzjis );
+
+        /** Zero the block of this sub transform when it is first used. */
+        const unsigned int block = nzjis[ 0 ] / this->m_DerivativeBlockSize;
+        if( !blockIsUsed[ block ] )
         {
-          tmp += this->m_vSAtmm[ z ][ pixelIndex ] * imageJacobian[ p ] * this->m_Sv[ d ][ z ]
-            + this->m_vdSdmu_part1[ z ][ d ] * this->m_Atmm[ d ][ pixelIndex ] * imageJacobian[ p ] * this->m_CSv[ d ][ z ];
-        } //end loop over eigenvalues
-        derivative[ nzjis[ p ] ] += tmp;
-      } //end loop over non-zero jacobian indices
+          const unsigned int blockStart = block * this->m_DerivativeBlockSize;
+          std::fill( derivative.begin() + blockStart,
+            derivative.begin() + blockStart + this->m_DerivativeBlockSize,
+            NumericTraits< DerivativeValueType >::ZeroValue() );
+          blockIsUsed[ block ] = true;
+        }
 
-    } //end loop over last dimension
-    dummyindex++;
+        this->AccumulateDerivativeOfSample( pixelIndex, d, imageJacobian, nzjis, derivative );
+      }
+    }
+  }
 
-  } // end second for loop over sample container
+} // end ThreadedComputeDerivative()
+
+
+/**
+ * ******************* ComputeImageJacobianOfSample *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+PCAMetric< TFixedImage, TMovingImage >
+::ComputeImageJacobianOfSample(
+  FixedImageContinuousIndexType & voxelCoord, const unsigned int d,
+  TransformJacobianType & jacobian, DerivativeType & imageJacobian,
+  NonZeroJacobianIndicesType & nzjis ) const
+{
+  RealType                  movingImageValue;
+  MovingImagePointType      mappedPoint;
+  MovingImageDerivativeType movingImageDerivative;
+  FixedImagePointType       fixedPoint;
+
+  /** Set fixed point's last dimension to lastDimPosition. */
+  voxelCoord[ this->m_LastDimIndex ] = d;
+
+  /** Transform sampled point back to world coordinates. */
+  this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint( voxelCoord, fixedPoint );
+  this->TransformPoint( fixedPoint, mappedPoint );
+
+  this->EvaluateMovingImageValueAndDerivative(
+    mappedPoint, movingImageValue, &movingImageDerivative );
+
+  /** Get the TransformJacobian dT/dmu */
+  this->EvaluateTransformJacobian( fixedPoint, jacobian, nzjis );
+
+  /** Compute the innerproduct (dM/dx)^T (dT/dmu). */
+  this->EvaluateTransformJacobianInnerProduct(
+    jacobian, movingImageDerivative, imageJacobian );
+
+} // end ComputeImageJacobianOfSample()
+
+
+/**
+ * ******************* AccumulateDerivativeOfSample *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+PCAMetric< TFixedImage, TMovingImage >
+::AccumulateDerivativeOfSample(
+  const unsigned int pixelIndex, const unsigned int d,
+  const DerivativeType & imageJacobian,
+  const NonZeroJacobianIndicesType & nzjis,
+  DerivativeType & derivative ) const
+{
+  /** build metric derivative components */
+  for( unsigned int p = 0; p < nzjis.size(); ++p )
+  {
+    DerivativeValueType tmp = 0.0;
+    for( unsigned int z = 0; z < this->m_NumEigenValues; z++ )
+    {
+      tmp += this->m_vSAtmm[ z ][ pixelIndex ] * imageJacobian[ p ] * this->m_Sv[ d ][ z ]
+        + this->m_vdSdmu_part1[ z ][ d ] * this->m_Atmm[ d ][ pixelIndex ] * imageJacobian[ p ] * this->m_CSv[ d ][ z ];
+    } //end loop over eigenvalues
+    derivative[ nzjis[ p ] ] += tmp;
+  } //end loop over non-zero jacobian indices
 
-} // end ThreadedGetValueAndDerivative()
+} // end AccumulateDerivativeOfSample()
 
 
 /**
@@ -1053,10 +1170,36 @@ PCAMetric< TFixedImage, TMovingImage >
 ::AfterThreadedComputeDerivative(
   DerivativeType & derivative ) const
 {
-  derivative = this->m_PCAMetricGetSamplesPerThreadVariables[ 0 ].st_Derivative;
-  for( ThreadIdType i = 1; i < this->m_NumberOfThreads; ++i )
+  if( !this->m_UseSliceBlockedDerivativeInThreads )
   {
-    derivative += this->m_PCAMetricGetSamplesPerThreadVariables[ i ].st_Derivative;
+    derivative = this->m_PCAMetricGetSamplesPerThreadVariables[ 0 ].st_Derivative;
+    for( ThreadIdType i = 1; i < this->m_NumberOfThreads; ++i )
+    {
+      derivative += this->m_PCAMetricGetSamplesPerThreadVariables[ i ].st_Derivative;
+    }
+  }
+  else
+  {
+    /** Only add the blocks that a thread wrote. */
+    derivative.SetSize( this->GetNumberOfParameters() );
+    derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
+    {
+      const DerivativeType &      threadDerivative = this->m_PCAMetricGetSamplesPerThreadVariables[ i ].st_Derivative;
+      const std::vector< bool > & blockIsUsed      = this->m_PCAMetricGetSamplesPerThreadVariables[ i ].st_DerivativeBlockIsUsed;
+      for( unsigned int b = 0; b < blockIsUsed.size(); ++b )
+      {
+        if( !blockIsUsed[ b ] )
+        {
+          continue;
+        }
+        const unsigned int blockEnd = ( b + 1 ) * this->m_DerivativeBlockSize;
+        for( unsigned int j = b * this->m_DerivativeBlockSize; j < blockEnd; ++j )
+        {
+          derivative[ j ] += threadDerivative[ j ];
+        }
+      }
+    }
   }
 
   derivative *= -( 2.0 / ( DerivativeValueType( this->m_NumberOfPixelsCounted ) - 1.0 ) ); //normalize
@@ -91,10 +91,6 @@ PCAMetric2< TFixedImage, TMovingImage >
   /** Empty list of last dimension positions. */
   numbers.clear();
 
-  /** Initialize random number generator. */
-  Statistics::MersenneTwisterRandomVariateGenerator::Pointer randomGenerator
-    = Statistics::MersenneTwisterRandomVariateGenerator::GetInstance();
-
   /** Sample additional at fixed timepoint. */
   for( unsigned int i = 0; i < m_NumAdditionalSamplesFixed; ++i )
   {
@@ -107,7 +103,7 @@ PCAMetric2< TFixedImage, TMovingImage >
     int randomNum = 0;
     do
     {
-      randomNum = static_cast< int >( randomGenerator->GetVariateWithClosedRange( m ) );
+      randomNum = static_cast< int >( this->m_RandomGenerator->GetVariateWithClosedRange( m ) );
     } while( find( numbers.begin(), numbers.end(), randomNum ) != numbers.end() );
     numbers.push_back( randomNum );
   }
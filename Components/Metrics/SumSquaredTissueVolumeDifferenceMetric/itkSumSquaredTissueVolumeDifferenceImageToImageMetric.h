@@ -228,6 +228,10 @@ protected:
   inline void AfterThreadedGetValueAndDerivative(
     MeasureType & measure, DerivativeType & derivative ) const;
 
+  /** The threaded loops support deterministic reduction. */
+  virtual bool GetSupportsDeterministicReduction( void ) const
+  { return true; }
+
 private:
   SumSquaredTissueVolumeDifferenceImageToImageMetric(const Self&); // purposely not implemented
   void operator=(const Self&); // purposely not implemented
@@ -153,6 +153,15 @@ MovingGenericPyramid< TElastix >
     "ComputePyramidImagesPerResolution", 0, false );
   this->SetComputeOnlyForCurrentLevel( computeThisResolution );
 
+  /** Decide whether or not to compute the coarser pyramid images from the
+   * finer ones, when the schedules allow it. This is only effective when
+   * the shrinker is used and all resolutions are computed at once.
+   */
+  bool computeFromPreviousLevel = false;
+  this->m_Configuration->ReadParameter( computeFromPreviousLevel,
+    "ComputePyramidImagesFromPreviousResolution", 0, false );
+  this->SetComputeFromPreviousLevel( computeFromPreviousLevel );
+
 } // end SetMovingSchedule()
 
 
@@ -180,6 +180,48 @@ namespace elastix
  *   The parameter can be specified for each resolution, or for all resolutions at once.\n
  *   example: <tt>(NoiseCompensation "true")</tt>\n
  *   Default/recommended: true.
+ * \parameter UseConvergenceMonitor: Whether to stop a resolution before MaximumNumberOfIterations,
+ *   when the registration does not improve anymore. See the documentation of
+ *   itk::AdaptiveStochasticGradientDescentOptimizer for the stopping rule. The number of
+ *   iterations that is saved is reported in the elastix.log file. The value of the
+ *   monitor is shown in the column MonitorMetric of the iteration information.
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(UseConvergenceMonitor "true" "true" "false")</tt>\n
+ *   Default: false.
+ * \parameter ConvergenceMonitorInterval: The number of iterations between two evaluations
+ *   of the convergence monitor.
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(ConvergenceMonitorInterval 20)</tt>\n
+ *   Default: 10.
+ * \parameter ConvergenceMonitorNumberOfSamples: When the metric uses a random sampler and
+ *   NewSamplesEveryIteration is "true", the convergence monitor computes the metric value
+ *   on a fixed grid of this many samples, instead of on the random samples of the current
+ *   iteration, to obtain a value that is not disturbed by the sampling noise.
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(ConvergenceMonitorNumberOfSamples 10000)</tt>\n
+ *   Default: 5000.
+ * \parameter ConvergenceMonitorSmoothingFactor: The weight of the previous evaluations in
+ *   the exponentially smoothed metric value and gradient magnitude. Should be in [0,1).
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(ConvergenceMonitorSmoothingFactor 0.7)</tt>\n
+ *   Default: 0.5.
+ * \parameter ConvergenceMonitorValueTolerance: An evaluation of the monitor stalls when the
+ *   smoothed metric value decreases less than this fraction of its magnitude, or less than
+ *   this value itself when the magnitude is smaller than 1.
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(ConvergenceMonitorValueTolerance 0.001)</tt>\n
+ *   Default: 0.0001.
+ * \parameter ConvergenceMonitorGradientTolerance: An evaluation of the monitor stalls only
+ *   when also the smoothed gradient magnitude decreases less than this fraction of the
+ *   gradient magnitude at the first evaluation in the resolution.
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(ConvergenceMonitorGradientTolerance 0.05)</tt>\n
+ *   Default: 0.01.
+ * \parameter ConvergenceMonitorPatience: The number of consecutive stalled evaluations
+ *   after which the resolution is stopped.
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(ConvergenceMonitorPatience 5)</tt>\n
+ *   Default: 3.
  *
  * \todo: this class contains a lot of functional code, which actually does not belong here.
  *
@@ -400,6 +442,11 @@ protected:
    */
   virtual void AddRandomPerturbation( ParametersType & parameters, double sigma );
 
+  /** Compute the value for the convergence monitor. If the metrics use random
+   * samplers, the value is computed on a fixed grid of samples.
+   */
+  virtual double ComputeConvergenceMonitorValue( void );
+
 private:
 
   AdaptiveStochasticGradientDescent( const Self & );  // purposely not implemented
@@ -422,6 +469,15 @@ private:
   bool m_UseNoiseCompensation;
   bool m_OriginalButSigmoidToDefault;
 
+  /** Private variables for the convergence monitor. The grid samplers are
+   * created in the first evaluation of each resolution.
+   */
+  SizeValueType                          m_ConvergenceMonitorNumberOfSamples;
+  bool                                   m_ConvergenceMonitorSamplersInitialized;
+  bool                                   m_ShowConvergenceMonitorValue;
+  std::vector< ImageGridSamplerPointer > m_ConvergenceMonitorSamplers;
+  SizeValueType                          m_NumberOfSavedIterations;
+
 };
 
 } // end namespace elastix
@@ -59,6 +59,11 @@ AdaptiveStochasticGradientDescent< TElastix >
   this->m_UseNoiseCompensation        = true;
   this->m_OriginalButSigmoidToDefault = false;
 
+  this->m_ConvergenceMonitorNumberOfSamples     = 5000;
+  this->m_ConvergenceMonitorSamplersInitialized = false;
+  this->m_ShowConvergenceMonitorValue           = false;
+  this->m_NumberOfSavedIterations               = 0;
+
 } // Constructor
 
 
@@ -84,6 +89,10 @@ AdaptiveStochasticGradientDescent< TElastix >
   xl::xout[ "iteration" ][ "4:||Gradient||" ] << std::showpoint << std::fixed;
 
   this->m_SettingsVector.clear();
+  this->m_NumberOfSavedIterations = 0;
+
+  /** Perturb the parameters with the random generator of this registration. */
+  this->m_RandomGenerator = this->GetElastix()->GetRandomGenerator();
 
 } // end BeforeRegistration()
 
@@ -266,6 +275,59 @@ AdaptiveStochasticGradientDescent< TElastix >
 
   } // end else: no automatic parameter estimation
 
+  /** Set whether the convergence monitor is used; default: false. */
+  bool useConvergenceMonitor = false;
+  this->GetConfiguration()->ReadParameter( useConvergenceMonitor,
+    "UseConvergenceMonitor", this->GetComponentLabel(), level, 0 );
+  this->SetUseConvergenceMonitor( useConvergenceMonitor );
+  this->m_ShowConvergenceMonitorValue = useConvergenceMonitor;
+
+  /** Remove the MonitorMetric column, if it already existed. */
+  const std::string monitorMetricColumn = "5:MonitorMetric";
+  xl::xout[ "iteration" ].RemoveTargetCell( monitorMetricColumn.c_str() );
+
+  if( useConvergenceMonitor )
+  {
+    /** Read the settings of the convergence monitor. */
+    SizeValueType convergenceMonitorInterval = 10;
+    this->GetConfiguration()->ReadParameter( convergenceMonitorInterval,
+      "ConvergenceMonitorInterval", this->GetComponentLabel(), level, 0 );
+    this->SetConvergenceMonitorInterval( std::max(
+      convergenceMonitorInterval, static_cast< SizeValueType >( 1 ) ) );
+
+    this->m_ConvergenceMonitorNumberOfSamples = 5000;
+    this->GetConfiguration()->ReadParameter( this->m_ConvergenceMonitorNumberOfSamples,
+      "ConvergenceMonitorNumberOfSamples", this->GetComponentLabel(), level, 0 );
+
+    double smoothingFactor = 0.5;
+    this->GetConfiguration()->ReadParameter( smoothingFactor,
+      "ConvergenceMonitorSmoothingFactor", this->GetComponentLabel(), level, 0 );
+    this->SetConvergenceMonitorSmoothingFactor( smoothingFactor );
+
+    double valueTolerance = 1e-4;
+    this->GetConfiguration()->ReadParameter( valueTolerance,
+      "ConvergenceMonitorValueTolerance", this->GetComponentLabel(), level, 0 );
+    this->SetConvergenceMonitorValueTolerance( valueTolerance );
+
+    double gradientTolerance = 1e-2;
+    this->GetConfiguration()->ReadParameter( gradientTolerance,
+      "ConvergenceMonitorGradientTolerance", this->GetComponentLabel(), level, 0 );
+    this->SetConvergenceMonitorGradientTolerance( gradientTolerance );
+
+    SizeValueType patience = 3;
+    this->GetConfiguration()->ReadParameter( patience,
+      "ConvergenceMonitorPatience", this->GetComponentLabel(), level, 0 );
+    this->SetConvergenceMonitorPatience( patience );
+
+    /** Create a new column in the iteration info table. */
+    xl::xout[ "iteration" ].AddTargetCell( monitorMetricColumn.c_str() );
+    xl::xout[ "iteration" ][ monitorMetricColumn.c_str() ] << std::showpoint << std::fixed;
+  }
+
+  /** The samplers of the convergence monitor are created again for each resolution. */
+  this->m_ConvergenceMonitorSamplersInitialized = false;
+  this->m_ConvergenceMonitorSamplers.clear();
+
 } // end BeforeEachResolution()
 
 
@@ -292,6 +354,19 @@ AdaptiveStochasticGradientDescent< TElastix >
     xl::xout[ "iteration" ][ "4:||Gradient||" ] << this->GetGradient().magnitude();
   }
 
+  /** Print the value of the convergence monitor, if it was evaluated. */
+  if( this->m_ShowConvergenceMonitorValue )
+  {
+    if( this->GetUseConvergenceMonitor() && this->GetConvergenceMonitorEvaluated() )
+    {
+      xl::xout[ "iteration" ][ "5:MonitorMetric" ] << this->GetConvergenceMonitorValue();
+    }
+    else
+    {
+      xl::xout[ "iteration" ][ "5:MonitorMetric" ] << "---";
+    }
+  }
+
   /** Select new spatial samples for the computation of the metric. */
   if( this->GetNewSamplesEveryIteration() )
   {
@@ -318,7 +393,8 @@ AdaptiveStochasticGradientDescent< TElastix >
    * typedef enum {
    *   MaximumNumberOfIterations,
    *   MetricError,
-   *   MinimumStepSize } StopConditionType;
+   *   MinimumStepSize,
+   *   ConvergenceDetected } StopConditionType;
    */
   std::string stopcondition;
 
@@ -336,6 +412,10 @@ AdaptiveStochasticGradientDescent< TElastix >
       stopcondition = "The minimum step length has been reached";
       break;
 
+    case ConvergenceDetected:
+      stopcondition = "Convergence has been detected by the convergence monitor";
+      break;
+
     default:
       stopcondition = "Unknown";
       break;
@@ -344,6 +424,16 @@ AdaptiveStochasticGradientDescent< TElastix >
   /** Print the stopping condition. */
   elxout << "Stopping condition: " << stopcondition << "." << std::endl;
 
+  /** Print the number of iterations that the convergence monitor saved. */
+  if( this->GetStopCondition() == ConvergenceDetected )
+  {
+    const SizeValueType savedIterations
+      = this->GetNumberOfIterations() - ( this->GetCurrentIteration() + 1 );
+    this->m_NumberOfSavedIterations += savedIterations;
+    elxout << "Iterations saved by the convergence monitor: " << savedIterations
+           << " of " << this->GetNumberOfIterations() << "." << std::endl;
+  }
+
   /** Store the used parameters, for later printing to screen. */
   SettingsType settings;
   settings.a     = this->GetParam_a();
@@ -381,6 +471,12 @@ AdaptiveStochasticGradientDescent< TElastix >
          << bestValue
          << std::endl;
 
+  if( this->m_NumberOfSavedIterations > 0 )
+  {
+    elxout << "Iterations saved by the convergence monitor in all resolutions: "
+           << this->m_NumberOfSavedIterations << std::endl;
+  }
+
   elxout
     << "Settings of " << this->elxGetClassName()
     << " for all resolutions:" << std::endl;
@@ -1134,6 +1230,98 @@ AdaptiveStochasticGradientDescent< TElastix >
 } // end AddRandomPerturbation()
 
 
+/**
+ * *************** ComputeConvergenceMonitorValue ***************
+ */
+
+template< class TElastix >
+double
+AdaptiveStochasticGradientDescent< TElastix >
+::ComputeConvergenceMonitorValue( void )
+{
+  /** With deterministic samples the current value is not disturbed by sampling noise. */
+  if( !this->GetNewSamplesEveryIteration() )
+  {
+    return this->Superclass1::ComputeConvergenceMonitorValue();
+  }
+
+  /** Create a grid sampler for each metric with a random sampler. The grid
+   * samples are the same in all evaluations of this resolution.
+   */
+  const unsigned int M = this->GetElastix()->GetNumberOfMetrics();
+  std::vector< ImageRandomSamplerBasePointer > randomSamplerVec( M, 0 );
+  bool                                         stochasticValue = false;
+  for( unsigned int m = 0; m < M; ++m )
+  {
+    ImageSamplerBasePointer sampler
+      = this->GetElastix()->GetElxMetricBase( m )->GetAdvancedMetricImageSampler();
+    randomSamplerVec[ m ]
+      = dynamic_cast< ImageRandomSamplerBaseType * >( sampler.GetPointer() );
+    stochasticValue |= randomSamplerVec[ m ].IsNotNull();
+  }
+  if( !stochasticValue )
+  {
+    return this->Superclass1::ComputeConvergenceMonitorValue();
+  }
+
+  if( !this->m_ConvergenceMonitorSamplersInitialized )
+  {
+    this->m_ConvergenceMonitorSamplers.assign( M, 0 );
+    for( unsigned int m = 0; m < M; ++m )
+    {
+      if( randomSamplerVec[ m ].IsNotNull() )
+      {
+        ImageGridSamplerPointer gridSampler = ImageGridSamplerType::New();
+        gridSampler->SetInput( randomSamplerVec[ m ]->GetInput() );
+        gridSampler->SetInputImageRegion( randomSamplerVec[ m ]->GetInputImageRegion() );
+        gridSampler->SetMask( randomSamplerVec[ m ]->GetMask() );
+        gridSampler->SetNumberOfSamples( this->m_ConvergenceMonitorNumberOfSamples );
+        gridSampler->Update();
+        this->m_ConvergenceMonitorSamplers[ m ] = gridSampler;
+      }
+    }
+    this->m_ConvergenceMonitorSamplersInitialized = true;
+  }
+
+  /** Compute the value on the grid samples, and set back the random samplers. */
+  for( unsigned int m = 0; m < M; ++m )
+  {
+    if( this->m_ConvergenceMonitorSamplers[ m ].IsNotNull() )
+    {
+      this->GetElastix()->GetElxMetricBase( m )
+      ->SetAdvancedMetricImageSampler( this->m_ConvergenceMonitorSamplers[ m ] );
+    }
+  }
+
+  double value = this->GetValue();
+  try
+  {
+    value = this->GetScaledValue( this->GetScaledCurrentPosition() );
+  }
+  catch( itk::ExceptionObject & err )
+  {
+    /** The monitor is not essential for the registration, so do not stop it. */
+    xl::xout[ "warning" ]
+      << "WARNING: the convergence monitor could not compute the metric value "
+      << "and is turned off for this resolution.\n"
+      << err.GetDescription() << std::endl;
+    this->SetUseConvergenceMonitor( false );
+  }
+
+  for( unsigned int m = 0; m < M; ++m )
+  {
+    if( randomSamplerVec[ m ].IsNotNull() )
+    {
+      this->GetElastix()->GetElxMetricBase( m )
+      ->SetAdvancedMetricImageSampler( randomSamplerVec[ m ] );
+    }
+  }
+
+  return value;
+
+} // end ComputeConvergenceMonitorValue()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef __elxAdaptiveStochasticGradientDescent_hxx
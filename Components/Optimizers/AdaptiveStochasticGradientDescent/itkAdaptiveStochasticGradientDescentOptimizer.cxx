@@ -36,9 +36,174 @@ AdaptiveStochasticGradientDescentOptimizer
   this->m_SigmoidMin           = -0.8;
   this->m_SigmoidScale         = 1e-8;
 
+  this->m_UseConvergenceMonitor               = false;
+  this->m_ConvergenceMonitorInterval          = 10;
+  this->m_ConvergenceMonitorSmoothingFactor   = 0.5;
+  this->m_ConvergenceMonitorValueTolerance    = 1e-4;
+  this->m_ConvergenceMonitorGradientTolerance = 1e-2;
+  this->m_ConvergenceMonitorPatience          = 3;
+
+  this->ResetConvergenceMonitor();
+
 }   // end Constructor
 
 
+/**
+ * ********************** StartOptimization *********************
+ */
+
+void
+AdaptiveStochasticGradientDescentOptimizer
+::StartOptimization( void )
+{
+  this->ResetConvergenceMonitor();
+  this->Superclass::StartOptimization();
+
+} // end StartOptimization()
+
+
+/**
+ * ********************** AdvanceOneStep *********************
+ */
+
+void
+AdaptiveStochasticGradientDescentOptimizer
+::AdvanceOneStep( void )
+{
+  /** Evaluate the convergence monitor before the step, at the position
+   * where the current value and gradient were computed. This way the
+   * results are available to observers of the IterationEvent.
+   */
+  bool converged = false;
+  this->m_ConvergenceMonitorEvaluated = false;
+  if( this->m_UseConvergenceMonitor && this->m_ConvergenceMonitorInterval > 0 )
+  {
+    this->m_ConvergenceMonitorGradientMagnitudeSum += this->m_Gradient.magnitude();
+    this->m_ConvergenceMonitorNumberOfGradients++;
+
+    if( ( this->m_CurrentIteration + 1 ) % this->m_ConvergenceMonitorInterval == 0 )
+    {
+      const double value             = this->ComputeConvergenceMonitorValue();
+      const double gradientMagnitude = this->m_ConvergenceMonitorGradientMagnitudeSum
+        / static_cast< double >( this->m_ConvergenceMonitorNumberOfGradients );
+      this->m_ConvergenceMonitorGradientMagnitudeSum = 0.0;
+      this->m_ConvergenceMonitorNumberOfGradients    = 0;
+
+      /** ComputeConvergenceMonitorValue() may have switched off the monitor. */
+      if( this->m_UseConvergenceMonitor )
+      {
+        converged = this->UpdateConvergenceMonitor( value, gradientMagnitude );
+      }
+    }
+  }
+
+  this->Superclass::AdvanceOneStep();
+
+  /** Stop, unless this was the last iteration anyway. */
+  if( converged && !this->m_Stop
+    && this->m_CurrentIteration + 1 < this->m_NumberOfIterations )
+  {
+    this->m_StopCondition = ConvergenceDetected;
+    this->StopOptimization();
+  }
+
+} // end AdvanceOneStep()
+
+
+/**
+ * ****************** ComputeConvergenceMonitorValue *****************
+ */
+
+double
+AdaptiveStochasticGradientDescentOptimizer
+::ComputeConvergenceMonitorValue( void )
+{
+  return this->m_Value;
+
+} // end ComputeConvergenceMonitorValue()
+
+
+/**
+ * ********************* UpdateConvergenceMonitor ********************
+ */
+
+bool
+AdaptiveStochasticGradientDescentOptimizer
+::UpdateConvergenceMonitor( double value, double gradientMagnitude )
+{
+  this->m_ConvergenceMonitorValue     = value;
+  this->m_ConvergenceMonitorEvaluated = true;
+  this->m_ConvergenceMonitorNumberOfEvaluations++;
+
+  /** The first evaluation initializes the smoothed values. */
+  if( this->m_ConvergenceMonitorNumberOfEvaluations == 1 )
+  {
+    this->m_ConvergenceMonitorSmoothedValue             = value;
+    this->m_ConvergenceMonitorSmoothedGradientMagnitude = gradientMagnitude;
+    this->m_ConvergenceMonitorInitialGradientMagnitude  = gradientMagnitude;
+    this->m_ConvergenceMonitorNumberOfStalls            = 0;
+    return false;
+  }
+
+  /** Exponential smoothing. */
+  const double previousValue             = this->m_ConvergenceMonitorSmoothedValue;
+  const double previousGradientMagnitude = this->m_ConvergenceMonitorSmoothedGradientMagnitude;
+  const double lambda                    = this->m_ConvergenceMonitorSmoothingFactor;
+  this->m_ConvergenceMonitorSmoothedValue
+    = lambda * previousValue + ( 1.0 - lambda ) * value;
+  this->m_ConvergenceMonitorSmoothedGradientMagnitude
+    = lambda * previousGradientMagnitude + ( 1.0 - lambda ) * gradientMagnitude;
+
+  /** The values are minimized, also when the cost function is maximized,
+   * because the scaled cost function is negated in that case. The gradient
+   * decrease is compared with the first gradient magnitude, because the
+   * relative decrease of a converging gradient does not go to zero.
+   */
+  const double valueDecrease    = previousValue - this->m_ConvergenceMonitorSmoothedValue;
+  const double gradientDecrease = previousGradientMagnitude
+    - this->m_ConvergenceMonitorSmoothedGradientMagnitude;
+  const bool valueStalled = valueDecrease
+    <= this->m_ConvergenceMonitorValueTolerance
+    * vnl_math_max( vnl_math_abs( previousValue ), 1.0 );
+  const bool gradientStalled = gradientDecrease
+    <= this->m_ConvergenceMonitorGradientTolerance
+    * this->m_ConvergenceMonitorInitialGradientMagnitude;
+
+  if( valueStalled && gradientStalled )
+  {
+    this->m_ConvergenceMonitorNumberOfStalls++;
+  }
+  else
+  {
+    this->m_ConvergenceMonitorNumberOfStalls = 0;
+  }
+
+  return this->m_ConvergenceMonitorNumberOfStalls >= this->m_ConvergenceMonitorPatience;
+
+} // end UpdateConvergenceMonitor()
+
+
+/**
+ * ********************* ResetConvergenceMonitor ********************
+ */
+
+void
+AdaptiveStochasticGradientDescentOptimizer
+::ResetConvergenceMonitor( void )
+{
+  this->m_ConvergenceMonitorValue                     = 0.0;
+  this->m_ConvergenceMonitorSmoothedValue             = 0.0;
+  this->m_ConvergenceMonitorSmoothedGradientMagnitude = 0.0;
+  this->m_ConvergenceMonitorInitialGradientMagnitude  = 0.0;
+  this->m_ConvergenceMonitorGradientMagnitudeSum      = 0.0;
+  this->m_ConvergenceMonitorNumberOfGradients         = 0;
+  this->m_ConvergenceMonitorNumberOfEvaluations       = 0;
+  this->m_ConvergenceMonitorNumberOfStalls            = 0;
+  this->m_ConvergenceMonitorEvaluated                 = false;
+
+} // end ResetConvergenceMonitor()
+
+
 /**
  * ************************** UpdateCurrentTime ********************
  */
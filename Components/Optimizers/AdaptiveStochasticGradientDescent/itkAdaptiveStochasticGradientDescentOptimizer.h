@@ -65,6 +65,23 @@ namespace itk
 * \c NewSamplesEveryIteration to \c "true" to achieve this effect.
 * For more information on this strategy, you may have a look at:
 *
+* Optionally, a convergence monitor stops the optimization before the maximum
+* number of iterations is reached. Every \c ConvergenceMonitorInterval iterations
+* the monitor evaluates the value of ComputeConvergenceMonitorValue() and the mean
+* gradient magnitude over the last interval, and smooths both exponentially:
+*
+*     \f[ s_j = \lambda s_{j-1} + (1 - \lambda) v_j \f]
+*
+* with \f$\lambda\f$ the \c ConvergenceMonitorSmoothingFactor. An evaluation
+* stalls when the smoothed value decreases less than \c ConvergenceMonitorValueTolerance
+* times its magnitude (or times 1, for magnitudes smaller than 1), and the smoothed
+* gradient magnitude decreases less than \c ConvergenceMonitorGradientTolerance
+* times the gradient magnitude of the first evaluation. After
+* \c ConvergenceMonitorPatience consecutive stalled evaluations the optimization is
+* stopped, with stop condition ConvergenceDetected. By default the monitor tracks
+* the value of the current iteration; inheriting classes may compute the value
+* on a fixed set of samples instead, which is less noisy.
+*
 * \sa AdaptiveStochasticGradientDescent, StandardGradientDescentOptimizer
 * \ingroup Optimizers
 */
@@ -117,6 +134,50 @@ public:
   itkSetMacro( SigmoidScale, double );
   itkGetConstMacro( SigmoidScale, double );
 
+  /** Set/Get whether the convergence monitor is used. Default: false */
+  itkSetMacro( UseConvergenceMonitor, bool );
+  itkGetConstMacro( UseConvergenceMonitor, bool );
+  itkBooleanMacro( UseConvergenceMonitor );
+
+  /** Set/Get the number of iterations between two evaluations of the
+   * convergence monitor. Should be >0. Default: 10 */
+  itkSetMacro( ConvergenceMonitorInterval, unsigned long );
+  itkGetConstMacro( ConvergenceMonitorInterval, unsigned long );
+
+  /** Set/Get the weight of the previous smoothed values of the convergence
+   * monitor. Should be in [0,1). Default: 0.5 */
+  itkSetClampMacro( ConvergenceMonitorSmoothingFactor, double, 0.0, 1.0 );
+  itkGetConstMacro( ConvergenceMonitorSmoothingFactor, double );
+
+  /** Set/Get the minimum decrease of the smoothed value per evaluation,
+   * relative to the magnitude of the value, or 1. Default: 1e-4 */
+  itkSetMacro( ConvergenceMonitorValueTolerance, double );
+  itkGetConstMacro( ConvergenceMonitorValueTolerance, double );
+
+  /** Set/Get the minimum decrease of the smoothed gradient magnitude per
+   * evaluation, relative to the gradient magnitude of the first evaluation.
+   * Default: 1e-2 */
+  itkSetMacro( ConvergenceMonitorGradientTolerance, double );
+  itkGetConstMacro( ConvergenceMonitorGradientTolerance, double );
+
+  /** Set/Get the number of consecutive stalled evaluations after
+   * which the optimization is stopped. Default: 3 */
+  itkSetMacro( ConvergenceMonitorPatience, unsigned long );
+  itkGetConstMacro( ConvergenceMonitorPatience, unsigned long );
+
+  /** Get the smoothed value and gradient magnitude of the convergence monitor. */
+  itkGetConstMacro( ConvergenceMonitorSmoothedValue, double );
+  itkGetConstMacro( ConvergenceMonitorSmoothedGradientMagnitude, double );
+
+  /** Get the value of the last evaluation of the convergence monitor. */
+  itkGetConstMacro( ConvergenceMonitorValue, double );
+
+  /** Get whether the convergence monitor was evaluated in the current iteration. */
+  itkGetConstMacro( ConvergenceMonitorEvaluated, bool );
+
+  /** Reset the convergence monitor and call the superclass' implementation. */
+  virtual void StartOptimization( void );
+
 protected:
 
   AdaptiveStochasticGradientDescentOptimizer();
@@ -131,6 +192,24 @@ protected:
   */
   virtual void UpdateCurrentTime( void );
 
+  /** Evaluate the convergence monitor if necessary, call the superclass'
+   * implementation, and stop the optimization if convergence is detected.
+   */
+  virtual void AdvanceOneStep( void );
+
+  /** Compute the value that is tracked by the convergence monitor, at the
+   * current position. Default: the value of the current iteration.
+   */
+  virtual double ComputeConvergenceMonitorValue( void );
+
+  /** Add an evaluation to the convergence monitor.
+   * Returns true when convergence is detected.
+   */
+  virtual bool UpdateConvergenceMonitor( double value, double gradientMagnitude );
+
+  /** Reset the state of the convergence monitor. */
+  virtual void ResetConvergenceMonitor( void );
+
   /** The PreviousGradient, necessary for the CruzAcceleration */
   DerivativeType m_PreviousGradient;
 
@@ -145,6 +224,25 @@ private:
   double m_SigmoidMin;
   double m_SigmoidScale;
 
+  /** Settings of the convergence monitor. */
+  bool          m_UseConvergenceMonitor;
+  unsigned long m_ConvergenceMonitorInterval;
+  double        m_ConvergenceMonitorSmoothingFactor;
+  double        m_ConvergenceMonitorValueTolerance;
+  double        m_ConvergenceMonitorGradientTolerance;
+  unsigned long m_ConvergenceMonitorPatience;
+
+  /** State of the convergence monitor. */
+  double        m_ConvergenceMonitorValue;
+  double        m_ConvergenceMonitorSmoothedValue;
+  double        m_ConvergenceMonitorSmoothedGradientMagnitude;
+  double        m_ConvergenceMonitorInitialGradientMagnitude;
+  double        m_ConvergenceMonitorGradientMagnitudeSum;
+  unsigned long m_ConvergenceMonitorNumberOfGradients;
+  unsigned long m_ConvergenceMonitorNumberOfEvaluations;
+  unsigned long m_ConvergenceMonitorNumberOfStalls;
+  bool          m_ConvergenceMonitorEvaluated;
+
 };
 
 } // end namespace itk
@@ -102,6 +102,9 @@ CMAEvolutionStrategy< TElastix >::BeforeRegistration( void )
   xout[ "iteration" ][ "5b:MaximumD" ] << std::showpoint << std::fixed;
   xout[ "iteration" ][ "5c:MinimumD" ] << std::showpoint << std::fixed;
 
+  /** Draw the offspring with the random generator of this registration. */
+  this->SetRandomGenerator( this->GetElastix()->GetRandomGenerator() );
+
 }   // end BeforeRegistration
 
 
@@ -67,6 +67,8 @@ public:
   typedef Superclass::MeasureType            MeasureType;
   typedef Superclass::ScalesType             ScalesType;
 
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+
   typedef enum {
     MetricError,
     MaximumNumberOfIterations,
@@ -162,6 +164,12 @@ public:
   itkSetMacro( UseDecayingSigma, bool );
   itkGetConstMacro( UseDecayingSigma, bool );
 
+  /** Setting: the random number generator used to generate the offspring.
+   * Default: the global instance of the MersenneTwisterRandomVariateGenerator.
+   */
+  itkSetObjectMacro( RandomGenerator, RandomGeneratorType );
+  itkGetObjectMacro( RandomGenerator, RandomGeneratorType );
+
   /** Setting: the A parameter for the decaying sigma sequence.
   * Default: 50 */
   itkSetClampMacro( SigmaDecayA, double, 0.0, NumericTraits< double >::max() );
@@ -231,8 +239,6 @@ protected:
     std::pair< MeasureType, unsigned int >  MeasureIndexPairType;
   typedef std::vector< MeasureIndexPairType > MeasureContainerType;
 
-  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
-
   /** The random number generator used to generate the offspring. */
   RandomGeneratorType::Pointer m_RandomGenerator;
 
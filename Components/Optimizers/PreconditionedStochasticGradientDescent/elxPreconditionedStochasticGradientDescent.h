@@ -0,0 +1,213 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __elxPreconditionedStochasticGradientDescent_h
+#define __elxPreconditionedStochasticGradientDescent_h
+
+#include "elxIncludes.h" // include first to avoid MSVS warning
+#include "itkPreconditionedStochasticGradientDescentOptimizer.h"
+#include "itkAdvancedImageToImageMetric.h"
+
+namespace elastix
+{
+
+/**
+* \class PreconditionedStochasticGradientDescent
+* \brief An adaptive stochastic gradient descent optimizer, preconditioned
+* with the SelfHessian of the metric.
+*
+* This class is a wrap around the PreconditionedStochasticGradientDescentOptimizer
+* class. It takes care of setting parameters and printing progress information.
+* At the start of each resolution the SelfHessian of the metric is computed,
+* multi-threaded, in compressed sparse row format. The preconditioner is
+* obtained by inverting its diagonal blocks. Metrics that implement the
+* SelfHessian are the AdvancedMeanSquares metric and the
+* TransformBendingEnergyPenalty; other metrics contribute an identity matrix.
+* For more information about the optimisation method, please read the documentation
+* of the PreconditionedStochasticGradientDescentOptimizer class.
+*
+* The parameters used in this class are:
+* \parameter Optimizer: Select this optimizer as follows:\n
+*   <tt>(Optimizer "PreconditionedStochasticGradientDescent")</tt>
+* \parameter MaximumNumberOfIterations: The maximum number of iterations in each resolution. \n
+*   example: <tt>(MaximumNumberOfIterations 100 100 50)</tt> \n
+*    Default value: 500.
+* \parameter MaximumNumberOfSamplingAttempts: The maximum number of sampling attempts. Sometimes
+*   not enough corresponding samples can be drawn, upon which an exception is thrown. With this
+*   parameter it is possible to try to draw another set of samples. \n
+*   example: <tt>(MaximumNumberOfSamplingAttempts 10 15 10)</tt> \n
+*    Default value: 0, i.e. just fail immediately.
+* \parameter SP_a: The gain \f$a(k)\f$ at each iteration \f$k\f$ is defined by \n
+*   \f$a(k) =  SP\_a / (SP\_A + k + 1)^{SP\_alpha}\f$. \n
+*   SP_a can be defined for each resolution. Since the gradient is preconditioned
+*   with the inverse of (an approximation of) the Hessian, a value close to 1.0 is
+*   usually appropriate. \n
+*   example: <tt>(SP_a 1.0 1.0 0.5)</tt> \n
+*   The default value is 1.0.
+* \parameter SP_A: The gain \f$a(k)\f$ at each iteration \f$k\f$ is defined by \n
+*   \f$a(k) =  SP\_a / (SP\_A + k + 1)^{SP\_alpha}\f$. \n
+*   SP_A can be defined for each resolution. \n
+*   example: <tt>(SP_A 20.0 20.0 20.0)</tt> \n
+*   The default value is 20.0.
+* \parameter SP_alpha: The gain \f$a(k)\f$ at each iteration \f$k\f$ is defined by \n
+*   \f$a(k) =  SP\_a / (SP\_A + k + 1)^{SP\_alpha}\f$. \n
+*   SP_alpha can be defined for each resolution. \n
+*   example: <tt>(SP_alpha 1.0 1.0 1.0)</tt> \n
+*   The default value is 1.0.
+* \parameter UseAdaptiveStepSizes: Whether the adaptive step size mechanism of the
+*   AdaptiveStochasticGradientDescent optimizer should be used. Can be defined for each resolution. \n
+*   example: <tt>(UseAdaptiveStepSizes "false")</tt> \n
+*   Default value: "true".
+* \parameter SigmoidMax, SigmoidMin, SigmoidScale: The parameters of the sigmoid that
+*   is used by the adaptive step size mechanism. See the AdaptiveStochasticGradientDescent
+*   optimizer. Can be defined for each resolution. \n
+*   Default values: 1.0, -0.8, 1e-8.
+* \parameter PreconditionerType: The type of preconditioner: "Diagonal", which inverts
+*   the diagonal of the SelfHessian, or "BlockJacobi", which inverts the blocks of the
+*   SelfHessian that couple the dimensions of each B-spline control point. If the
+*   transform is not a B-spline transform, "Diagonal" is used, with a warning.
+*   Can be defined for each resolution. \n
+*   example: <tt>(PreconditionerType "BlockJacobi")</tt> \n
+*   Default value: "Diagonal".
+* \parameter PreconditionerRegularization: The diagonal blocks of \f$H + \lambda I\f$
+*   are inverted, with \f$\lambda\f$ this value times the mean of the diagonal of the
+*   SelfHessian \f$H\f$. Can be defined for each resolution. \n
+*   example: <tt>(PreconditionerRegularization 0.1)</tt> \n
+*   Default value: 0.01.
+*
+* \sa PreconditionedStochasticGradientDescentOptimizer
+* \ingroup Optimizers
+*/
+
+template< class TElastix >
+class PreconditionedStochasticGradientDescent :
+  public
+  itk::PreconditionedStochasticGradientDescentOptimizer,
+  public
+  OptimizerBase< TElastix >
+{
+public:
+
+  /** Standard ITK.*/
+  typedef PreconditionedStochasticGradientDescent          Self;
+  typedef PreconditionedStochasticGradientDescentOptimizer Superclass1;
+  typedef OptimizerBase< TElastix >                        Superclass2;
+  typedef itk::SmartPointer< Self >                        Pointer;
+  typedef itk::SmartPointer< const Self >                  ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( PreconditionedStochasticGradientDescent,
+    PreconditionedStochasticGradientDescentOptimizer );
+
+  /** Name of this class.
+  * Use this name in the parameter file to select this specific optimizer.
+  * example: <tt>(Optimizer "PreconditionedStochasticGradientDescent")</tt>\n
+  */
+  elxClassNameMacro( "PreconditionedStochasticGradientDescent" );
+
+  /** Typedef's inherited from Superclass1, the PreconditionedStochasticGradientDescentOptimizer.*/
+  typedef Superclass1::CostFunctionType    CostFunctionType;
+  typedef Superclass1::CostFunctionPointer CostFunctionPointer;
+  typedef Superclass1::StopConditionType   StopConditionType;
+  typedef Superclass1::SelfHessianType     SelfHessianType;
+
+  /** Typedef's inherited from Superclass2, the elastix OptimizerBase .*/
+  typedef typename Superclass2::ElastixType          ElastixType;
+  typedef typename Superclass2::ElastixPointer       ElastixPointer;
+  typedef typename Superclass2::ConfigurationType    ConfigurationType;
+  typedef typename Superclass2::ConfigurationPointer ConfigurationPointer;
+  typedef typename Superclass2::RegistrationType     RegistrationType;
+  typedef typename Superclass2::RegistrationPointer  RegistrationPointer;
+  typedef typename Superclass2::ITKBaseType          ITKBaseType;
+
+  /** Typedef for the ParametersType. */
+  typedef typename Superclass1::ParametersType ParametersType;
+
+  /** Methods invoked by elastix, in which parameters can be set and
+  * progress information can be printed. */
+  virtual void BeforeRegistration( void );
+
+  virtual void BeforeEachResolution( void );
+
+  virtual void AfterEachResolution( void );
+
+  virtual void AfterEachIteration( void );
+
+  virtual void AfterRegistration( void );
+
+  /** Check if any scales are set, and set the UseScales flag on or off;
+  * compute the preconditioner; after that call the superclass' implementation */
+  virtual void StartOptimization( void );
+
+  /** Stop optimisation and pass on exception. */
+  virtual void MetricErrorResponse( itk::ExceptionObject & err );
+
+  /** Add SetCurrentPositionPublic, which calls the protected
+  * SetCurrentPosition of the itkPreconditionedStochasticGradientDescentOptimizer class.
+  */
+  virtual void SetCurrentPositionPublic( const ParametersType & param )
+  {
+    this->Superclass1::SetCurrentPosition( param );
+  }
+
+
+  /** Set the MaximumNumberOfSamplingAttempts. */
+  itkSetMacro( MaximumNumberOfSamplingAttempts, unsigned long );
+
+  /** Get the MaximumNumberOfSamplingAttempts. */
+  itkGetConstReferenceMacro( MaximumNumberOfSamplingAttempts, unsigned long );
+
+protected:
+
+  PreconditionedStochasticGradientDescent();
+  virtual ~PreconditionedStochasticGradientDescent() {}
+
+  /** Protected typedefs */
+  typedef typename RegistrationType::FixedImageType  FixedImageType;
+  typedef typename RegistrationType::MovingImageType MovingImageType;
+  typedef itk::AdvancedImageToImageMetric<
+    FixedImageType, MovingImageType >                AdvancedMetricType;
+
+  /** Compute the SelfHessian of the metric and build the preconditioner. */
+  virtual void ComputePreconditioner( void );
+
+private:
+
+  PreconditionedStochasticGradientDescent( const Self & ); // purposely not implemented
+  void operator=( const Self & );                          // purposely not implemented
+
+  /** Private variables for the sampling attempts. */
+  unsigned long m_MaximumNumberOfSamplingAttempts;
+  unsigned long m_CurrentNumberOfSamplingAttempts;
+  unsigned long m_PreviousErrorAtIteration;
+
+  /** Settings of the preconditioner, read in BeforeEachResolution(). */
+  std::string m_PreconditionerType;
+  double      m_PreconditionerRegularization;
+
+};
+
+} // end namespace elastix
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "elxPreconditionedStochasticGradientDescent.hxx"
+#endif
+
+#endif // end #ifndef __elxPreconditionedStochasticGradientDescent_h
@@ -0,0 +1,375 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __elxPreconditionedStochasticGradientDescent_hxx
+#define __elxPreconditionedStochasticGradientDescent_hxx
+
+#include "elxPreconditionedStochasticGradientDescent.h"
+#include "itkTimeProbe.h"
+#include <iomanip>
+#include <string>
+
+namespace elastix
+{
+
+/**
+ * ***************** Constructor ***********************
+ */
+
+template< class TElastix >
+PreconditionedStochasticGradientDescent< TElastix >::PreconditionedStochasticGradientDescent()
+{
+  this->m_MaximumNumberOfSamplingAttempts = 0;
+  this->m_CurrentNumberOfSamplingAttempts = 0;
+  this->m_PreviousErrorAtIteration        = 0;
+  this->m_PreconditionerType              = "Diagonal";
+  this->m_PreconditionerRegularization    = 0.01;
+
+}   // end Constructor()
+
+
+/**
+ * ***************** BeforeRegistration ***********************
+ */
+
+template< class TElastix >
+void
+PreconditionedStochasticGradientDescent< TElastix >::BeforeRegistration( void )
+{
+  /** Add the target cell "stepsize" to xout["iteration"].*/
+  xout[ "iteration" ].AddTargetCell( "2:Metric" );
+  xout[ "iteration" ].AddTargetCell( "3a:Time" );
+  xout[ "iteration" ].AddTargetCell( "3b:StepSize" );
+  xout[ "iteration" ].AddTargetCell( "4:||Gradient||" );
+
+  /** Format the metric and stepsize as floats */
+  xl::xout[ "iteration" ][ "2:Metric" ] << std::showpoint << std::fixed;
+  xl::xout[ "iteration" ][ "3a:Time" ] << std::showpoint << std::fixed;
+  xl::xout[ "iteration" ][ "3b:StepSize" ] << std::showpoint << std::fixed;
+  xl::xout[ "iteration" ][ "4:||Gradient||" ] << std::showpoint << std::fixed;
+
+}   // end BeforeRegistration()
+
+
+/**
+ * ***************** BeforeEachResolution ***********************
+ */
+
+template< class TElastix >
+void
+PreconditionedStochasticGradientDescent< TElastix >
+::BeforeEachResolution( void )
+{
+  /** Get the current resolution level. */
+  unsigned int level = static_cast< unsigned int >(
+    this->m_Registration->GetAsITKBaseType()->GetCurrentLevel() );
+
+  /** Set the maximumNumberOfIterations. */
+  unsigned int maximumNumberOfIterations = 500;
+  this->GetConfiguration()->ReadParameter( maximumNumberOfIterations,
+    "MaximumNumberOfIterations", this->GetComponentLabel(), level, 0 );
+  this->SetNumberOfIterations( maximumNumberOfIterations );
+
+  /** Set the gain parameters. The gradient is preconditioned by (an approximation
+   * of) the inverse Hessian, so a = 1 corresponds to a Newton step.
+   */
+  double a     = 1.0;
+  double A     = 20.0;
+  double alpha = 1.0;
+
+  this->GetConfiguration()->ReadParameter( a, "SP_a", this->GetComponentLabel(), level, 0 );
+  this->GetConfiguration()->ReadParameter( A, "SP_A", this->GetComponentLabel(), level, 0 );
+  this->GetConfiguration()->ReadParameter( alpha, "SP_alpha", this->GetComponentLabel(), level, 0 );
+
+  this->SetParam_a( a );
+  this->SetParam_A( A );
+  this->SetParam_alpha( alpha );
+
+  /** Set the adaptive step size mechanism. */
+  bool useAdaptiveStepSizes = true;
+  this->GetConfiguration()->ReadParameter( useAdaptiveStepSizes,
+    "UseAdaptiveStepSizes", this->GetComponentLabel(), level, 0 );
+  this->SetUseAdaptiveStepSizes( useAdaptiveStepSizes );
+
+  double sigmoidMax   = 1.0;
+  double sigmoidMin   = -0.8;
+  double sigmoidScale = 1e-8;
+  this->GetConfiguration()->ReadParameter( sigmoidMax, "SigmoidMax", this->GetComponentLabel(), level, 0 );
+  this->GetConfiguration()->ReadParameter( sigmoidMin, "SigmoidMin", this->GetComponentLabel(), level, 0 );
+  this->GetConfiguration()->ReadParameter( sigmoidScale, "SigmoidScale", this->GetComponentLabel(), level, 0 );
+  this->SetSigmoidMax( sigmoidMax );
+  this->SetSigmoidMin( sigmoidMin );
+  this->SetSigmoidScale( sigmoidScale );
+
+  /** Set the preconditioner settings. */
+  this->m_PreconditionerType = "Diagonal";
+  this->GetConfiguration()->ReadParameter( this->m_PreconditionerType,
+    "PreconditionerType", this->GetComponentLabel(), level, 0 );
+  if( this->m_PreconditionerType != "Diagonal" && this->m_PreconditionerType != "BlockJacobi" )
+  {
+    itkExceptionMacro( << "ERROR: unknown PreconditionerType \""
+                       << this->m_PreconditionerType
+                       << "\". Choose \"Diagonal\" or \"BlockJacobi\"." );
+  }
+
+  this->m_PreconditionerRegularization = 0.01;
+  this->GetConfiguration()->ReadParameter( this->m_PreconditionerRegularization,
+    "PreconditionerRegularization", this->GetComponentLabel(), level, 0 );
+
+  /** Set the MaximumNumberOfSamplingAttempts. */
+  unsigned int maximumNumberOfSamplingAttempts = 0;
+  this->GetConfiguration()->ReadParameter( maximumNumberOfSamplingAttempts,
+    "MaximumNumberOfSamplingAttempts", this->GetComponentLabel(), level, 0 );
+  this->SetMaximumNumberOfSamplingAttempts( maximumNumberOfSamplingAttempts );
+  if( maximumNumberOfSamplingAttempts > 5 )
+  {
+    elxout[ "warning" ]
+      << "\nWARNING: You have set MaximumNumberOfSamplingAttempts to "
+      << maximumNumberOfSamplingAttempts << ".\n"
+      << "  This functionality is known to cause problems (stack overflow) for large values.\n"
+      << "  If elastix stops or segfaults for no obvious reason, reduce this value.\n"
+      << "  You may select the RandomSparseMask image sampler to fix mask-related problems.\n"
+      << std::endl;
+  }
+
+}   // end BeforeEachResolution()
+
+
+/**
+ * ***************** AfterEachIteration *************************
+ */
+
+template< class TElastix >
+void
+PreconditionedStochasticGradientDescent< TElastix >
+::AfterEachIteration( void )
+{
+  /** Print some information. The gradient is the preconditioned one. */
+  xl::xout[ "iteration" ][ "2:Metric" ] << this->GetValue();
+  xl::xout[ "iteration" ][ "3a:Time" ] << this->GetCurrentTime();
+  xl::xout[ "iteration" ][ "3b:StepSize" ] << this->GetLearningRate();
+  xl::xout[ "iteration" ][ "4:||Gradient||" ] << this->GetGradient().magnitude();
+
+  /** Select new spatial samples for the computation of the metric */
+  if( this->GetNewSamplesEveryIteration() )
+  {
+    this->SelectNewSamples();
+  }
+
+}   // end AfterEachIteration()
+
+
+/**
+ * ***************** AfterEachResolution *************************
+ */
+
+template< class TElastix >
+void
+PreconditionedStochasticGradientDescent< TElastix >
+::AfterEachResolution( void )
+{
+  /**
+   * enum   StopConditionType {  MaximumNumberOfIterations, MetricError }
+   */
+  std::string stopcondition;
+  switch( this->GetStopCondition() )
+  {
+
+    case MaximumNumberOfIterations:
+      stopcondition = "Maximum number of iterations has been reached";
+      break;
+
+    case MetricError:
+      stopcondition = "Error in metric";
+      break;
+
+    default:
+      stopcondition = "Unknown";
+      break;
+
+  }
+
+  /** Print the stopping condition */
+  elxout << "Stopping condition: " << stopcondition << "." << std::endl;
+
+  /** The preconditioner is not needed anymore. */
+  this->ClearPreconditioner();
+
+}   // end AfterEachResolution()
+
+
+/**
+ * ******************* AfterRegistration ************************
+ */
+
+template< class TElastix >
+void
+PreconditionedStochasticGradientDescent< TElastix >
+::AfterRegistration( void )
+{
+  /** Print the best metric value */
+  double bestValue = this->GetValue();
+  elxout
+    << std::endl
+    << "Final metric value  = "
+    << bestValue
+    << std::endl;
+
+}   // end AfterRegistration()
+
+
+/**
+ * ****************** StartOptimization *************************
+ */
+
+template< class TElastix >
+void
+PreconditionedStochasticGradientDescent< TElastix >
+::StartOptimization( void )
+{
+  /** Check if the entered scales are correct and != [ 1 1 1 ...] */
+  this->SetUseScales( false );
+  const ScalesType & scales = this->GetScales();
+  if( scales.GetSize() == this->GetInitialPosition().GetSize() )
+  {
+    ScalesType unit_scales( scales.GetSize() );
+    unit_scales.Fill( 1.0 );
+    if( scales != unit_scales )
+    {
+      /** only then: */
+      this->SetUseScales( true );
+    }
+  }
+
+  /** Reset these values. */
+  this->m_CurrentNumberOfSamplingAttempts = 0;
+  this->m_PreviousErrorAtIteration        = 0;
+
+  /** Compute the preconditioner at the initial position. */
+  this->ComputePreconditioner();
+
+  /** Superclass implementation. */
+  this->Superclass1::StartOptimization();
+
+}   // end StartOptimization()
+
+
+/**
+ * ****************** ComputePreconditioner *************************
+ */
+
+template< class TElastix >
+void
+PreconditionedStochasticGradientDescent< TElastix >
+::ComputePreconditioner( void )
+{
+  itk::TimeProbe timer;
+  timer.Start();
+  elxout << "Computing the preconditioner for "
+         << this->elxGetClassName() << " ..." << std::endl;
+
+  /** Cast to advanced metric type. */
+  AdvancedMetricType * metric = dynamic_cast< AdvancedMetricType * >(
+    this->GetRegistration()->GetAsITKBaseType()->GetMetric() );
+  if( !metric )
+  {
+    itkExceptionMacro( << "ERROR: PreconditionedStochasticGradientDescent expects "
+                       << "the metric to be of type AdvancedImageToImageMetric!" );
+  }
+
+  /** Compute the SelfHessian, multi-threaded. */
+  SelfHessianType H;
+  metric->GetCompressedSelfHessian( this->GetInitialPosition(), H );
+
+  /** Select the block size. The B-spline parameters of dimension d of
+   * control point c have index d * N + c, so blocks of size D with stride N
+   * contain the D parameters of each control point. For other transforms
+   * these blocks have no meaning.
+   */
+  const unsigned int dimension          = FixedImageType::ImageDimension;
+  const unsigned int numberOfParameters = H.GetNumberOfRows();
+  unsigned int       blockSize          = 1;
+  if( this->m_PreconditionerType == "BlockJacobi" )
+  {
+    if( !metric->GetTransformIsBSpline() )
+    {
+      elxout[ "warning" ]
+        << "WARNING: The BlockJacobi preconditioner requires a B-spline transform.\n"
+        << "  A diagonal preconditioner is used instead." << std::endl;
+    }
+    else if( numberOfParameters % dimension != 0 )
+    {
+      elxout[ "warning" ]
+        << "WARNING: The number of parameters is not a multiple of the image dimension.\n"
+        << "  A diagonal preconditioner is used instead." << std::endl;
+    }
+    else
+    {
+      blockSize = dimension;
+    }
+  }
+
+  /** Invert the blocks. */
+  this->BuildPreconditioner( H, blockSize, this->m_PreconditionerRegularization );
+
+  timer.Stop();
+  elxout << "  SelfHessian: " << numberOfParameters << " parameters, "
+         << H.GetNumberOfNonZeros() << " stored nonzeros.\n"
+         << "  Preconditioner: " << ( blockSize > 1 ? "BlockJacobi" : "Diagonal" )
+         << ", with blocks of " << blockSize << " parameters.\n"
+         << "Computing the preconditioner took "
+         << this->ConvertSecondsToDHMS( timer.GetMean(), 2 ) << std::endl;
+
+}   // end ComputePreconditioner()
+
+
+/**
+ * ****************** MetricErrorResponse *************************
+ */
+
+template< class TElastix >
+void
+PreconditionedStochasticGradientDescent< TElastix >
+::MetricErrorResponse( itk::ExceptionObject & err )
+{
+  if( this->GetCurrentIteration() != this->m_PreviousErrorAtIteration )
+  {
+    this->m_PreviousErrorAtIteration        = this->GetCurrentIteration();
+    this->m_CurrentNumberOfSamplingAttempts = 1;
+  }
+  else
+  {
+    this->m_CurrentNumberOfSamplingAttempts++;
+  }
+
+  if( this->m_CurrentNumberOfSamplingAttempts <= this->m_MaximumNumberOfSamplingAttempts )
+  {
+    this->SelectNewSamples();
+    this->ResumeOptimization();
+  }
+  else
+  {
+    /** Stop optimisation and pass on exception. */
+    this->Superclass1::MetricErrorResponse( err );
+  }
+
+}   // end MetricErrorResponse()
+
+
+} // end namespace elastix
+
+#endif // end #ifndef __elxPreconditionedStochasticGradientDescent_hxx
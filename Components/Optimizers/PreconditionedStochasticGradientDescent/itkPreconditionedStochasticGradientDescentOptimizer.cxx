@@ -0,0 +1,199 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkPreconditionedStochasticGradientDescentOptimizer.h"
+
+#include "vnl/vnl_math.h"
+#include "vnl/vnl_matrix.h"
+#include "vnl/algo/vnl_matrix_inverse.h"
+
+namespace itk
+{
+
+/**
+ * ************************* Constructor ************************
+ */
+
+PreconditionedStochasticGradientDescentOptimizer
+::PreconditionedStochasticGradientDescentOptimizer()
+{
+  this->m_PreconditionerBlockSize      = 0;
+  this->m_NumberOfPreconditionerBlocks = 0;
+
+}   // end Constructor
+
+
+/**
+ * ********************* BuildPreconditioner ********************
+ */
+
+void
+PreconditionedStochasticGradientDescentOptimizer
+::BuildPreconditioner( const SelfHessianType & H,
+  unsigned int blockSize, double regularization )
+{
+  const unsigned int numberOfParameters = H.GetNumberOfRows();
+  if( blockSize == 0 || numberOfParameters % blockSize != 0 )
+  {
+    itkExceptionMacro( << "The number of parameters (" << numberOfParameters
+                       << ") is not a multiple of the block size (" << blockSize << ")." );
+  }
+  const unsigned int numberOfBlocks = numberOfParameters / blockSize;
+
+  /** Compute the regularization, relative to the mean of the diagonal. */
+  SelfHessianType::VnlVectorType diagonal;
+  H.GetDiagonal( diagonal );
+  double meanDiagonal = ( numberOfParameters > 0 ) ? diagonal.mean() : 0.0;
+  if( !( meanDiagonal > 0.0 ) )
+  {
+    meanDiagonal = 1.0;
+  }
+  const double lambda = regularization * meanDiagonal;
+
+  /** Invert the diagonal blocks of H + lambda I. */
+  this->m_PreconditionerValues.resize( numberOfBlocks * blockSize * blockSize );
+  vnl_matrix< double > block( blockSize, blockSize );
+  for( unsigned int b = 0; b < numberOfBlocks; ++b )
+  {
+    double * values = &this->m_PreconditionerValues[ b * blockSize * blockSize ];
+
+    if( blockSize == 1 )
+    {
+      const double d = diagonal[ b ] + lambda;
+      values[ 0 ] = ( d > 0.0 ) ? 1.0 / d : 0.0;
+      continue;
+    }
+
+    /** Only the upper triangular part of H is stored. */
+    for( unsigned int k = 0; k < blockSize; ++k )
+    {
+      const unsigned int row = b + k * numberOfBlocks;
+      block( k, k ) = diagonal[ row ] + lambda;
+      for( unsigned int l = k + 1; l < blockSize; ++l )
+      {
+        const unsigned int col = b + l * numberOfBlocks;
+        block( k, l ) = H.GetEntry( row, col );
+        block( l, k ) = block( k, l );
+      }
+    }
+
+    const vnl_matrix< double > inverse = vnl_matrix_inverse< double >( block );
+    for( unsigned int k = 0; k < blockSize; ++k )
+    {
+      for( unsigned int l = 0; l < blockSize; ++l )
+      {
+        values[ k * blockSize + l ] = inverse( k, l );
+      }
+    }
+  }
+
+  this->m_PreconditionerBlockSize      = blockSize;
+  this->m_NumberOfPreconditionerBlocks = numberOfBlocks;
+
+}   // end BuildPreconditioner()
+
+
+/**
+ * ********************* ClearPreconditioner ********************
+ */
+
+void
+PreconditionedStochasticGradientDescentOptimizer
+::ClearPreconditioner( void )
+{
+  this->m_PreconditionerBlockSize      = 0;
+  this->m_NumberOfPreconditionerBlocks = 0;
+  PreconditionerValuesType().swap( this->m_PreconditionerValues );
+
+}   // end ClearPreconditioner()
+
+
+/**
+ * ******************** AdvanceOneStep **************************
+ */
+
+void
+PreconditionedStochasticGradientDescentOptimizer
+::AdvanceOneStep( void )
+{
+  if( this->m_PreconditionerBlockSize > 0 )
+  {
+    this->PreconditionGradient();
+  }
+
+  this->Superclass::AdvanceOneStep();
+
+}   // end AdvanceOneStep()
+
+
+/**
+ * ******************* PreconditionGradient *********************
+ */
+
+void
+PreconditionedStochasticGradientDescentOptimizer
+::PreconditionGradient( void )
+{
+  const unsigned int blockSize          = this->m_PreconditionerBlockSize;
+  const unsigned int numberOfBlocks     = this->m_NumberOfPreconditionerBlocks;
+  const unsigned int numberOfParameters = this->m_Gradient.GetSize();
+  if( blockSize * numberOfBlocks != numberOfParameters )
+  {
+    itkExceptionMacro( << "The size of the preconditioner does not match the "
+                       << "number of parameters." );
+  }
+
+  /** The gradient is taken in the scaled space, y = s x, with s the square
+   * root of the scales. In that space the preconditioner is S P S.
+   */
+  DerivativeType & gradient = this->m_Gradient;
+  const bool       useScales = this->GetUseScales();
+  ScalesType       sqrtScales;
+  if( useScales )
+  {
+    sqrtScales = this->GetScales();
+    for( unsigned int i = 0; i < numberOfParameters; ++i )
+    {
+      sqrtScales[ i ] = vcl_sqrt( sqrtScales[ i ] );
+    }
+  }
+
+  this->m_PreconditionedGradient.SetSize( numberOfParameters );
+  for( unsigned int b = 0; b < numberOfBlocks; ++b )
+  {
+    const double * values = &this->m_PreconditionerValues[ b * blockSize * blockSize ];
+    for( unsigned int k = 0; k < blockSize; ++k )
+    {
+      const unsigned int row = b + k * numberOfBlocks;
+      double             sum = 0.0;
+      for( unsigned int l = 0; l < blockSize; ++l )
+      {
+        const unsigned int col = b + l * numberOfBlocks;
+        const double       g   = useScales ? sqrtScales[ col ] * gradient[ col ] : gradient[ col ];
+        sum += values[ k * blockSize + l ] * g;
+      }
+      this->m_PreconditionedGradient[ row ] = useScales ? sqrtScales[ row ] * sum : sum;
+    }
+  }
+
+  gradient = this->m_PreconditionedGradient;
+
+}   // end PreconditionGradient()
+
+
+} // end namespace itk
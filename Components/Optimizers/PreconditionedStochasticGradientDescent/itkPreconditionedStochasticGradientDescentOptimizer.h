@@ -0,0 +1,139 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef __itkPreconditionedStochasticGradientDescentOptimizer_h
+#define __itkPreconditionedStochasticGradientDescentOptimizer_h
+
+#include "../AdaptiveStochasticGradientDescent/itkAdaptiveStochasticGradientDescentOptimizer.h"
+#include "itkCompressedSparseRowMatrix.h"
+#include <vector>
+
+namespace itk
+{
+
+/**
+* \class PreconditionedStochasticGradientDescentOptimizer
+* \brief This class implements an adaptive stochastic gradient descent
+* optimizer with a block diagonal preconditioner.
+*
+* If \f$C(x)\f$ is a costfunction that has to be minimised, the following iterative
+* algorithm is used to find the optimal parameters \f$x\f$:
+*
+*     \f[ x(k+1) = x(k) - a(t_k) P dC/dx \f]
+*
+* The gain \f$a(t_k)\f$ and the time \f$t_k\f$ are computed as in the
+* superclass, the AdaptiveStochasticGradientDescentOptimizer, but using the
+* preconditioned gradient \f$P dC/dx\f$.
+*
+* The preconditioner \f$P\f$ is a block diagonal matrix. It is typically built
+* from the SelfHessian \f$H\f$ of the metric, with BuildPreconditioner(), by
+* inverting the diagonal blocks of \f$H + \lambda I\f$. The parameters in block
+* \f$b\f$ are \f$b + k s\f$, with \f$k = 0 .. B-1\f$, \f$B\f$ the block size and
+* \f$s\f$ the number of blocks. With \f$B = 1\f$ this is a Jacobi (diagonal)
+* preconditioner. For a B-spline transform in \f$D\f$ dimensions, \f$B = D\f$
+* groups the \f$D\f$ parameters of each control point.
+*
+* If the preconditioner is not set, this optimizer is equal to its superclass.
+* When scales are used, the preconditioner is applied in the unscaled space.
+*
+* \sa PreconditionedStochasticGradientDescent, AdaptiveStochasticGradientDescentOptimizer
+* \ingroup Optimizers
+*/
+
+class PreconditionedStochasticGradientDescentOptimizer :
+  public AdaptiveStochasticGradientDescentOptimizer
+{
+public:
+
+  /** Standard ITK.*/
+  typedef PreconditionedStochasticGradientDescentOptimizer Self;
+  typedef AdaptiveStochasticGradientDescentOptimizer       Superclass;
+
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( PreconditionedStochasticGradientDescentOptimizer,
+    AdaptiveStochasticGradientDescentOptimizer );
+
+  /** Typedefs inherited from the superclass. */
+  typedef Superclass::MeasureType               MeasureType;
+  typedef Superclass::ParametersType            ParametersType;
+  typedef Superclass::DerivativeType            DerivativeType;
+  typedef Superclass::CostFunctionType          CostFunctionType;
+  typedef Superclass::ScalesType                ScalesType;
+  typedef Superclass::ScaledCostFunctionType    ScaledCostFunctionType;
+  typedef Superclass::ScaledCostFunctionPointer ScaledCostFunctionPointer;
+  typedef Superclass::StopConditionType         StopConditionType;
+
+  /** Typedefs for the preconditioner. */
+  typedef CompressedSparseRowMatrix< double > SelfHessianType;
+  typedef std::vector< double >               PreconditionerValuesType;
+
+  /** Build the preconditioner from the upper triangular part of the
+   * SelfHessian H, by inverting the diagonal blocks of H + lambda I, with
+   * lambda = regularization * mean( diag( H ) ). The number of parameters
+   * should be a multiple of the block size.
+   */
+  virtual void BuildPreconditioner( const SelfHessianType & H,
+    unsigned int blockSize, double regularization );
+
+  /** Remove the preconditioner. */
+  virtual void ClearPreconditioner( void );
+
+  /** Get the size of the blocks of the preconditioner; 0 if none is set. */
+  itkGetConstMacro( PreconditionerBlockSize, unsigned int );
+
+  /** Get the values of the preconditioner blocks, each block stored row by row. */
+  const PreconditionerValuesType & GetPreconditionerValues( void ) const
+  { return this->m_PreconditionerValues; }
+
+  /** Replace the gradient by the preconditioned gradient before calling the
+   * superclass' implementation. GetGradient() therefore returns the
+   * preconditioned gradient afterwards. */
+  virtual void AdvanceOneStep( void );
+
+protected:
+
+  PreconditionedStochasticGradientDescentOptimizer();
+  virtual ~PreconditionedStochasticGradientDescentOptimizer() {}
+
+  /** Compute m_Gradient = P m_Gradient. */
+  virtual void PreconditionGradient( void );
+
+  /** Storage for the preconditioned gradient. */
+  DerivativeType m_PreconditionedGradient;
+
+private:
+
+  PreconditionedStochasticGradientDescentOptimizer( const Self & ); // purposely not implemented
+  void operator=( const Self & );                                   // purposely not implemented
+
+  /** The inverted blocks of the preconditioner. */
+  unsigned int             m_PreconditionerBlockSize;
+  unsigned int             m_NumberOfPreconditionerBlocks;
+  PreconditionerValuesType m_PreconditionerValues;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkPreconditionedStochasticGradientDescentOptimizer_h
@@ -232,8 +232,7 @@ GradientDescentOptimizer2
 
   /** Update the new position. */
   const int nthreads = static_cast< int >( this->m_Threader->GetNumberOfThreads() );
-  omp_set_num_threads( nthreads );
-  #pragma omp parallel for
+  #pragma omp parallel for num_threads( nthreads )
   for( int j = 0; j < static_cast< int >( spaceDimension ); j++ )
   {
     newPosition[ j ] = currentPosition[ j ] - this->m_LearningRate * this->m_Gradient[ j ];
@@ -274,8 +273,7 @@ GradientDescentOptimizer2
     /** Update the new position. */
     const int spaceDim = static_cast< int >( spaceDimension );
     const int nthreads = static_cast< int >( this->m_Threader->GetNumberOfThreads() );
-    omp_set_num_threads( nthreads );
-    #pragma omp parallel for
+    #pragma omp parallel for num_threads( nthreads )
     for( int i = 0; i < nthreads; i += 1 )
     {
       int threadId = omp_get_thread_num();
@@ -77,12 +77,13 @@ public:
   typedef Superclass::ScaledCostFunctionPointer ScaledCostFunctionPointer;
 
   /** Codes of stopping conditions
-   * The MinimumStepSize stopcondition never occurs, but may
-   * be implemented in inheriting classes */
+   * The MinimumStepSize and ConvergenceDetected stopconditions never occur,
+   * but may be implemented in inheriting classes */
   typedef enum {
     MaximumNumberOfIterations,
     MetricError,
-    MinimumStepSize
+    MinimumStepSize,
+    ConvergenceDetected
   } StopConditionType;
 
   /** Advance one step following the gradient direction. */
@@ -88,6 +88,17 @@ namespace elastix
  *    example: <tt>(Metric0Use "false" "true")</tt> \n
  *    example: <tt>(Metric1Use "true" "false")</tt> \n
  *    The default is "true".
+ * \parameter UseConcurrentMetricEvaluation: Whether metrics that support it
+ *    are evaluated at the same time, each with a share of the threads that is
+ *    proportional to its computation time in the previous iteration. \n
+ *    example: <tt>(UseConcurrentMetricEvaluation "true")</tt> \n
+ *    The default is "false".
+ * \parameter UseMultiThreadedDerivativeCombination: Whether the weighted sum of
+ *    the metric derivatives is computed by the threads that compute the
+ *    derivative magnitudes, instead of afterwards by a single thread. The result
+ *    is the same. \n
+ *    example: <tt>(UseMultiThreadedDerivativeCombination "true")</tt> \n
+ *    The default is "false".
  *
  * \ingroup Registrations
  */
@@ -192,6 +203,7 @@ public:
    * \li Connect all components to the registration framework.
    * \li Set the number of resolution levels.
    * \li Set the fixed image regions.
+   * \li Reuse the fixed image pyramid outputs of a previous registration.
    * \li Add the sub metric columns to the iteration info object.
    */
   virtual void BeforeRegistration( void );
@@ -207,6 +219,11 @@ public:
    */
   virtual void AfterEachIteration( void );
 
+  /** Execute stuff after the registration:
+   * \li Store the fixed image pyramid outputs for following registrations.
+   */
+  virtual void AfterRegistration( void );
+
 protected:
 
   /** The constructor. */
@@ -78,6 +78,11 @@ MultiMetricMultiResolutionRegistration< TElastix >
     this->SetFixedImageRegion( this->GetElastix()->GetFixedImage( i )->GetBufferedRegion(), i );
   }
 
+  /** Reuse the fixed image pyramid outputs of a previous registration with
+   * the same fixed images and parameter map, such as a previous batch job.
+   */
+  this->ReuseFixedImagePyramidOutputs( this->GetNumberOfFixedImagePyramids() );
+
   /** Add the target cells "Metric<i>" and "||Gradient<i>||" to xout["iteration"]
    * and format as floats.
    */
@@ -113,9 +118,39 @@ MultiMetricMultiResolutionRegistration< TElastix >
   }
   else { this->GetCombinationMetric()->SetUseMultiThread( false ); }
 
+  /** Evaluate the thread-safe sub-metrics concurrently or not. */
+  bool useConcurrentMetricEvaluation = false;
+  this->m_Configuration->ReadParameter( useConcurrentMetricEvaluation,
+    "UseConcurrentMetricEvaluation", 0, false );
+  this->GetCombinationMetric()->SetUseConcurrentMetricEvaluation( useConcurrentMetricEvaluation );
+
+  /** Combine the metric derivatives multi-threadedly or not. */
+  bool useMultiThreadedDerivativeCombination = false;
+  this->m_Configuration->ReadParameter( useMultiThreadedDerivativeCombination,
+    "UseMultiThreadedDerivativeCombination", 0, false );
+  this->GetCombinationMetric()->SetUseMultiThreadedDerivativeCombination(
+    useMultiThreadedDerivativeCombination );
+
 } // end BeforeRegistration()
 
 
+/**
+ * ******************* AfterRegistration ***********************
+ */
+
+template< class TElastix >
+void
+MultiMetricMultiResolutionRegistration< TElastix >
+::AfterRegistration( void )
+{
+  /** Store the fixed image pyramid outputs, if they were computed by this
+   * registration, so that following registrations can reuse them.
+   */
+  this->StoreFixedImagePyramidOutputs( this->GetNumberOfFixedImagePyramids() );
+
+} // end AfterRegistration()
+
+
 /**
  * ******************* AfterEachIteration ***********************
  */
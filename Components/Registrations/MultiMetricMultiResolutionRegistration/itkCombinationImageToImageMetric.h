@@ -116,6 +116,7 @@ public:
   /** Some typedefs for computing the SelfHessian */
   typedef typename Superclass::HessianValueType HessianValueType;
   typedef typename Superclass::HessianType      HessianType;
+  typedef typename Superclass::CSRHessianType   CSRHessianType;
 
   /**
   typedef typename Superclass::ImageSamplerType             ImageSamplerType;
@@ -203,6 +204,28 @@ public:
   /** \todo: Temporary, should think about interface. */
   itkSetMacro( UseMultiThread, bool );
 
+  /** Set and get whether the sub-metrics are evaluated concurrently in
+   * GetValueAndDerivative(). Only metrics that report
+   * GetSupportsConcurrentGetValueAndDerivative() are run concurrently; the
+   * others are computed one after the other, before the concurrent ones.
+   * The number of threads of the combination metric is divided over the
+   * concurrent metrics, in proportion to their computation time in the
+   * previous iteration. Default false.
+   */
+  itkSetMacro( UseConcurrentMetricEvaluation, bool );
+  itkGetConstMacro( UseConcurrentMetricEvaluation, bool );
+  itkBooleanMacro( UseConcurrentMetricEvaluation );
+
+  /** Whether the weighted sum of the metric derivatives is computed by the
+   * threads that compute the derivative magnitudes, instead of afterwards by a
+   * single thread. With fixed weights this is done in the same pass over the
+   * derivatives. Only used when multi-threading. The result is the same, as
+   * every element is summed in the same order. Default false.
+   */
+  itkSetMacro( UseMultiThreadedDerivativeCombination, bool );
+  itkGetConstMacro( UseMultiThreadedDerivativeCombination, bool );
+  itkBooleanMacro( UseMultiThreadedDerivativeCombination );
+
   /** Select which metrics are used.
    * This is useful in case you want to compute a certain measure, but not
    * actually use it during the registration.
@@ -398,6 +421,13 @@ public:
     const TransformParametersType & parameters,
     HessianType & H ) const;
 
+  /** Experimental feature: compute SelfHessian in compressed sparse row
+   * format, as the weighted sum of the SelfHessians of the sub metrics.
+   */
+  virtual void GetCompressedSelfHessian(
+    const TransformParametersType & parameters,
+    CSRHessianType & H ) const;
+
   /** Method to return the latest modified time of this object or any of its
    * cached ivars.
    */
@@ -406,12 +436,11 @@ public:
   /** GetValueAndDerivatives threader callback function */
   static ITK_THREAD_RETURN_TYPE GetValueAndDerivativeComboThreaderCallback( void * arg );
 
-  /** CombineDerivatives threader callback function */
+  /** CombineDerivatives threader callback function. Computes the squared
+   * magnitudes of the metric derivatives and/or their weighted sum, in a
+   * single pass over the parameters. */
   static ITK_THREAD_RETURN_TYPE CombineDerivativesThreaderCallback( void * arg );
 
-  /** Compute Derivatives Magnitude threader callback function */
-  static ITK_THREAD_RETURN_TYPE ComputeDerivativesMagnitudeThreaderCallback( void * arg );
-
 protected:
 
   CombinationImageToImageMetric();
@@ -450,24 +479,43 @@ private:
    */
   double GetFinalMetricWeight( unsigned int pos ) const;
 
+  /** Divide the number of threads over the concurrently evaluated metrics,
+   * in proportion to their last computation time. */
+  void DistributeThreadsOverMetrics( void ) const;
+
+  /** Launch the CombineDerivativesThreaderCallback. */
+  void LaunchCombineDerivativesThreaderCallback( void ) const;
+
   /** For threading: store thread data. */
   struct MultiThreaderComboMetricsType
   {
-    std::vector< SingleValuedCostFunctionPointer > st_MetricsIterator;
-    typename std::vector< MeasureType >::iterator st_MetricValuesIterator;
-    typename std::vector< DerivativeType >::iterator st_MetricDerivativesIterator;
-    std::vector< double > st_MetricComputationTime;
-    ParametersType *      st_Parameters;
+    Self *                       st_ThisComboMetric;
+    const ParametersType *       st_Parameters;
+    std::vector< unsigned int >  st_ConcurrentMetrics;
+    std::vector< std::string >   st_ExceptionMessages;
   };
 
   struct MultiThreaderCombineDerivativeType
   {
     Self *                st_ThisComboMetric;
     std::vector< double > st_DerivativesSumOfSquares;
+    std::vector< double > st_Weights;
+    bool                  st_ComputeMagnitudes;
+    bool                  st_CombineDerivatives;
     DerivativeValueType * st_Derivative;
   };
 
+  /** The thread data is kept, so that its memory is reused in every iteration. */
+  mutable MultiThreaderComboMetricsType      m_ComboMetricsParameters;
+  mutable MultiThreaderCombineDerivativeType m_CombineDerivativeParameters;
+
+  /** The number of threads of each metric after initialization. The thread
+   * budget of a concurrently evaluated metric never exceeds this number. */
+  std::vector< ThreadIdType > m_MetricMaximumNumberOfThreads;
+
   bool m_UseMultiThread;
+  bool m_UseConcurrentMetricEvaluation;
+  bool m_UseMultiThreadedDerivativeCombination;
 
 };
 
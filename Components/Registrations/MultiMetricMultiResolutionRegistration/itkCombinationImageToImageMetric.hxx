@@ -164,7 +164,14 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
   this->m_UseRelativeWeights = false;
   this->ComputeGradientOff();
 
-  this->m_UseMultiThread = true;
+  this->m_UseMultiThread                = true;
+  this->m_UseConcurrentMetricEvaluation = false;
+  this->m_UseMultiThreadedDerivativeCombination = false;
+
+  this->m_ComboMetricsParameters.st_ThisComboMetric      = this;
+  this->m_ComboMetricsParameters.st_Parameters           = 0;
+  this->m_CombineDerivativeParameters.st_ThisComboMetric = this;
+  this->m_CombineDerivativeParameters.st_Derivative      = 0;
 
 } // end Constructor
 
@@ -195,6 +202,10 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
     os << indent << "UseMetric: " << ( this->m_UseMetric[ i ] ? "true\n" : "false\n" );
     os << indent << "MetricComputationTime: " << this->m_MetricComputationTime[ i ] << "\n";
   }
+  os << "UseConcurrentMetricEvaluation: "
+     << ( this->m_UseConcurrentMetricEvaluation ? "true" : "false" ) << std::endl;
+  os << "UseMultiThreadedDerivativeCombination: "
+     << ( this->m_UseMultiThreadedDerivativeCombination ? "true" : "false" ) << std::endl;
 
 } // end PrintSelf()
 
@@ -282,6 +293,7 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
     this->m_MetricDerivatives.resize( count );
     this->m_MetricDerivativesMagnitude.resize( count );
     this->m_MetricComputationTime.resize( count );
+    this->m_MetricMaximumNumberOfThreads.resize( count, 1 );
     this->Modified();
   }
 
@@ -633,6 +645,8 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
       // set it on.
       unsigned nrOfThreadsPerMetric = this->GetNumberOfThreads();
       testPtr1->Initialize();
+      this->m_MetricMaximumNumberOfThreads[ i ]
+        = std::min( testPtr1->GetNumberOfThreads(), static_cast< ThreadIdType >( nrOfThreadsPerMetric ) );
       testPtr1->SetNumberOfThreads( nrOfThreadsPerMetric );
     }
     else if( testPtr2 )
@@ -829,9 +843,8 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
   MeasureType & value,
   DerivativeType & derivative ) const
 {
-  /** Declare timer and multi-threader. */
+  /** Declare timer. */
   itk::TimeProbe timer;
-  typename ThreaderType::Pointer local_threader = ThreaderType::New();
 
   /** This function must be called before the multi-threaded code.
    * It calls all the non thread-safe stuff.
@@ -857,121 +870,168 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
   /** Initialize some threading related parameters. */
   this->InitializeThreadingParameters();
 
-  /** Decide whether or not to use multi-threading.
-   * If the global maximum number of threads is smaller than the number
-   * of metrics, then setting the number of threads to the number of
-   * threads will result in a bug: all metrics after the max will not be
-   * run. For now we decide to run this metric single-threadedly in that case.
-   *
-   * Actually we should sum the number of threads of each metric and check that
-   * it does not surpass the global maximum. But for now we don't.
+  /** Decide which metrics are computed concurrently. Only metrics that do
+   * not touch the shared transform and sampler anymore (now that
+   * BeforeThreadedGetValueAndDerivative() is switched off) qualify.
+   * Every concurrent metric needs its own thread, so we fall back to
+   * sequential computation when the threader cannot provide them.
    */
-  bool useMultiThread = this->m_UseMultiThread;
-  if( MultiThreader::GetGlobalMaximumNumberOfThreads() < this->m_NumberOfMetrics )
+  std::vector< unsigned int > & concurrentMetrics
+    = this->m_ComboMetricsParameters.st_ConcurrentMetrics;
+  concurrentMetrics.clear();
+  if( this->m_UseConcurrentMetricEvaluation )
   {
-    useMultiThread = false;
-  }
+    for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+    {
+      ImageMetricType * testPtr = dynamic_cast< ImageMetricType * >( this->GetMetric( i ) );
+      if( testPtr && testPtr->GetSupportsConcurrentGetValueAndDerivative() )
+      {
+        concurrentMetrics.push_back( i );
+      }
+    }
 
-  // For now we disable multi-threading of the combo metric, since the MacMini build
-  // segfaults with it. Have to investigate this issue later
-  useMultiThread = false;
+    if( concurrentMetrics.size() > 1 )
+    {
+      this->m_Threader->SetNumberOfThreads( concurrentMetrics.size() );
+    }
+    if( concurrentMetrics.size() < 2
+      || this->m_Threader->GetNumberOfThreads() != concurrentMetrics.size() )
+    {
+      concurrentMetrics.clear();
+    }
+  }
 
-  /** Compute all metric values and derivatives, single-threadedly. */
-  if( !useMultiThread )
+  /** Compute the other metric values and derivatives, sequentially.
+   * These may still change the shared transform, so they are computed
+   * before the concurrent ones are started.
+   */
+  std::vector< unsigned int >::const_iterator concurrentIt = concurrentMetrics.begin();
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
   {
-    for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+    if( concurrentIt != concurrentMetrics.end() && *concurrentIt == i )
     {
-      /** Compute ... */
-      timer.Reset();
-      timer.Start();
-      this->m_Metrics[ i ]->GetValueAndDerivative( parameters,
-        this->m_MetricValues[ i ], this->m_MetricDerivatives[ i ] );
-      timer.Stop();
-
-      /** Store computation time. */
-      this->m_MetricComputationTime[ i ] = timer.GetMean() * 1000.0;
+      ++concurrentIt;
+      continue;
     }
+
+    /** Compute ... */
+    timer.Reset();
+    timer.Start();
+    this->m_Metrics[ i ]->GetValueAndDerivative( parameters,
+      this->m_MetricValues[ i ], this->m_MetricDerivatives[ i ] );
+    timer.Stop();
+
+    /** Store computation time. */
+    this->m_MetricComputationTime[ i ] = timer.GetMean() * 1000.0;
   }
-  /** Compute all metric values and derivatives, multi-threadedly. */
-  else
+
+  /** Compute the remaining metric values and derivatives, concurrently. */
+  if( !concurrentMetrics.empty() )
   {
+    /** Give each metric its share of the threads. */
+    this->DistributeThreadsOverMetrics();
+
     /** Setup struct with multi-threading information. */
-    MultiThreaderComboMetricsType * temp_c = new MultiThreaderComboMetricsType;
-    temp_c->st_MetricsIterator           = this->m_Metrics;
-    temp_c->st_MetricDerivativesIterator = this->m_MetricDerivatives.begin();
-    temp_c->st_MetricValuesIterator      = this->m_MetricValues.begin();
-    temp_c->st_MetricComputationTime.resize( this->m_NumberOfMetrics, 0 );
-    temp_c->st_Parameters = const_cast< ParametersType * >( &parameters );
+    this->m_ComboMetricsParameters.st_Parameters = &parameters;
+    this->m_ComboMetricsParameters.st_ExceptionMessages.resize( concurrentMetrics.size() );
+    for( unsigned int k = 0; k < concurrentMetrics.size(); k++ )
+    {
+      this->m_ComboMetricsParameters.st_ExceptionMessages[ k ].clear();
+    }
 
     /** GetValueAndDerivative */
-    local_threader->SetNumberOfThreads( this->m_NumberOfMetrics );
-    local_threader->SetSingleMethod( GetValueAndDerivativeComboThreaderCallback, temp_c );
-    local_threader->SingleMethodExecute();
+    this->m_Threader->SetSingleMethod( GetValueAndDerivativeComboThreaderCallback,
+      const_cast< void * >( static_cast< const void * >( &this->m_ComboMetricsParameters ) ) );
+    this->m_Threader->SingleMethodExecute();
 
-    /** Store computation time. */
-    for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+    /** Restore the number of threads of the metrics. */
+    for( unsigned int k = 0; k < concurrentMetrics.size(); k++ )
     {
-      this->m_MetricComputationTime[ i ] = temp_c->st_MetricComputationTime[ i ];
+      const unsigned int i = concurrentMetrics[ k ];
+      ImageMetricType * testPtr = dynamic_cast< ImageMetricType * >( this->GetMetric( i ) );
+      testPtr->SetNumberOfThreads( this->m_MetricMaximumNumberOfThreads[ i ] );
     }
 
-    delete temp_c;
+    /** Exceptions can not cross thread boundaries, so rethrow them here. */
+    for( unsigned int k = 0; k < concurrentMetrics.size(); k++ )
+    {
+      if( !this->m_ComboMetricsParameters.st_ExceptionMessages[ k ].empty() )
+      {
+        itkExceptionMacro( << "Error while computing metric " << concurrentMetrics[ k ] << ":\n"
+                           << this->m_ComboMetricsParameters.st_ExceptionMessages[ k ] );
+      }
+    }
   }
 
-  /** Compute the derivative magnitude, single-threadedly. */
-  // I get random segfaults on the Linux or Mac systems when this is enabled.
-  // For now disable multi-threading and force single-threaded:
-  //if( !this->m_UseMultiThread )
-  if( true )
+  /** Make sure the derivative has the right size. */
+  derivative.SetSize( this->GetNumberOfParameters() );
+
+  /** Compute the derivative magnitudes, single-threadedly. */
+  if( !this->m_UseMultiThread )
   {
     for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
     {
       this->m_MetricDerivativesMagnitude[ i ] = this->m_MetricDerivatives[ i ].magnitude();
     }
   }
-  /** Compute the derivative magnitude, multi-threadedly. */
+  /** Compute the derivative magnitudes, multi-threadedly. */
   else
   {
-    /** Setup struct with multi-threading information. */
-    ThreadIdType                         numberOfThreads = this->GetNumberOfThreads();
-    MultiThreaderCombineDerivativeType * temp_m          = new MultiThreaderCombineDerivativeType;
-    temp_m->st_ThisComboMetric = const_cast< Self * >( this );
-    temp_m->st_DerivativesSumOfSquares.resize( numberOfThreads * this->m_NumberOfMetrics );
-
-    /** Compute derivatives magnitude multi-threadedly. */
-    local_threader->SetNumberOfThreads( numberOfThreads );
-    local_threader->SetSingleMethod( ComputeDerivativesMagnitudeThreaderCallback, temp_m );
-    local_threader->SingleMethodExecute();
+    /** Setup struct with multi-threading information. The threader may
+     * provide less threads than requested, so ask for the actual number.
+     */
+    this->m_Threader->SetNumberOfThreads( this->GetNumberOfThreads() );
+    const ThreadIdType numberOfThreads = this->m_Threader->GetNumberOfThreads();
+    MultiThreaderCombineDerivativeType & temp = this->m_CombineDerivativeParameters;
+    temp.st_DerivativesSumOfSquares.assign( numberOfThreads * this->m_NumberOfMetrics, 0.0 );
+    temp.st_Weights.resize( this->m_NumberOfMetrics );
+    temp.st_Derivative = derivative.data_block();
+
+    /** With fixed weights, the threads can also combine the derivatives in
+     * the same pass. Relative weights depend on the magnitudes, so then the
+     * derivatives are combined afterwards.
+     */
+    temp.st_ComputeMagnitudes  = true;
+    temp.st_CombineDerivatives = this->m_UseMultiThreadedDerivativeCombination
+      && !this->m_UseRelativeWeights;
+    for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+    {
+      temp.st_Weights[ i ] = ( temp.st_CombineDerivatives && this->m_UseMetric[ i ] )
+        ? this->GetFinalMetricWeight( i ) : 0.0;
+    }
+    this->LaunchCombineDerivativesThreaderCallback();
 
-    /** Gather the results. */
+    /** Gather the magnitudes. */
     for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
     {
       double mag = 0.0;
       for( unsigned int j = 0; j < numberOfThreads; j++ )
       {
-        mag += temp_m->st_DerivativesSumOfSquares[ i * numberOfThreads + j ];
+        mag += temp.st_DerivativesSumOfSquares[ i * numberOfThreads + j ];
       }
       this->m_MetricDerivativesMagnitude[ i ] = vcl_sqrt( mag );
     }
-
-    delete temp_m;
   }
 
-  /** Combine the metric values, single-threadedly. */
-  value = NumericTraits< MeasureType >::Zero;
-  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  /** Combine the derivatives, multi-threadedly. Skipped when the pass above
+   * combined them already.
+   */
+  if( this->m_UseMultiThread && this->m_UseMultiThreadedDerivativeCombination )
   {
-    if( this->m_UseMetric[ i ] )
+    MultiThreaderCombineDerivativeType & temp = this->m_CombineDerivativeParameters;
+    if( !temp.st_CombineDerivatives )
     {
-      double weight = this->GetFinalMetricWeight( i );
-      value += weight * this->m_MetricValues[ i ];
-    } // end if m_UseMetric[i]
-  }   // end of combine metrics
-
-  /** Combine the metric derivatives, single-threadedly. */
-  // I get random segfaults on the linux or Mac systems when this is enabled.
-  // For now disable multi-threading and force single-threaded:
-  //if( !this->m_UseMultiThread )
-  if( true )
+      temp.st_ComputeMagnitudes  = false;
+      temp.st_CombineDerivatives = true;
+      for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+      {
+        temp.st_Weights[ i ] = this->m_UseMetric[ i ] ? this->GetFinalMetricWeight( i ) : 0.0;
+      }
+      this->LaunchCombineDerivativesThreaderCallback();
+    }
+  }
+  /** Combine the derivatives, single-threadedly. */
+  else
   {
     /** The first derivative. */
     if( this->m_UseMetric[ 0 ] )
@@ -995,24 +1055,59 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
       } // end if m_UseMetric[i]
     }   // end of combine metrics
   }
-  /** Combine the derivatives, multi-threadedly. */
-  else
+
+  /** Combine the metric values, single-threadedly. */
+  value = NumericTraits< MeasureType >::Zero;
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
   {
-    /** Setup struct with multi-threading information. */
-    ThreadIdType                         numberOfThreads = this->GetNumberOfThreads();
-    MultiThreaderCombineDerivativeType * temp_d          = new MultiThreaderCombineDerivativeType;
-    temp_d->st_ThisComboMetric = const_cast< Self * >( this );
-    temp_d->st_Derivative      = &derivative[ 0 ];
+    if( this->m_UseMetric[ i ] )
+    {
+      double weight = this->GetFinalMetricWeight( i );
+      value += weight * this->m_MetricValues[ i ];
+    } // end if m_UseMetric[i]
+  }   // end of combine metrics
+
+} // end GetValueAndDerivative()
+
 
-    /** Combine derivatives */
-    local_threader->SetNumberOfThreads( numberOfThreads );
-    local_threader->SetSingleMethod( CombineDerivativesThreaderCallback, temp_d );
-    local_threader->SingleMethodExecute();
+/**
+ * **************** DistributeThreadsOverMetrics *******
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::DistributeThreadsOverMetrics( void ) const
+{
+  const std::vector< unsigned int > & concurrentMetrics
+    = this->m_ComboMetricsParameters.st_ConcurrentMetrics;
 
-    delete temp_d;
+  /** The total cost, from the timings of the previous iteration.
+   * In the first iteration all timings are zero, which gives an equal split.
+   */
+  double totalCost = 0.0;
+  for( unsigned int k = 0; k < concurrentMetrics.size(); k++ )
+  {
+    totalCost += this->m_MetricComputationTime[ concurrentMetrics[ k ] ];
   }
 
-} // end GetValueAndDerivative()
+  const double numberOfThreads = static_cast< double >( this->GetNumberOfThreads() );
+  for( unsigned int k = 0; k < concurrentMetrics.size(); k++ )
+  {
+    const unsigned int i = concurrentMetrics[ k ];
+    const double fraction = totalCost > 0.0
+      ? this->m_MetricComputationTime[ i ] / totalCost
+      : 1.0 / static_cast< double >( concurrentMetrics.size() );
+
+    ThreadIdType threads = static_cast< ThreadIdType >( vcl_floor( fraction * numberOfThreads ) );
+    threads = std::max( threads, static_cast< ThreadIdType >( 1 ) );
+    threads = std::min( threads, this->m_MetricMaximumNumberOfThreads[ i ] );
+
+    ImageMetricType * testPtr = dynamic_cast< ImageMetricType * >( this->GetMetric( i ) );
+    testPtr->SetNumberOfThreads( threads );
+  }
+
+} // end DistributeThreadsOverMetrics()
 
 
 /**
@@ -1030,14 +1125,33 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
   MultiThreaderComboMetricsType * temp
     = static_cast< MultiThreaderComboMetricsType * >( infoStruct->UserData );
 
+  /** Each thread computes one metric. */
+  Self *             comboMetric = temp->st_ThisComboMetric;
+  const unsigned int i           = temp->st_ConcurrentMetrics[ threadID ];
+
   itk::TimeProbe timer;
   timer.Start();
-  temp->st_MetricsIterator[ threadID ]->GetValueAndDerivative(
-    *temp->st_Parameters,
-    temp->st_MetricValuesIterator[ threadID ],
-    temp->st_MetricDerivativesIterator[ threadID ] );
+  try
+  {
+    comboMetric->m_Metrics[ i ]->GetValueAndDerivative(
+      *temp->st_Parameters,
+      comboMetric->m_MetricValues[ i ],
+      comboMetric->m_MetricDerivatives[ i ] );
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    temp->st_ExceptionMessages[ threadID ] = excp.GetDescription();
+  }
+  catch( std::exception & excp )
+  {
+    temp->st_ExceptionMessages[ threadID ] = std::string( "std::exception: " ) + excp.what();
+  }
+  catch( ... )
+  {
+    temp->st_ExceptionMessages[ threadID ] = "Unknown exception.";
+  }
   timer.Stop();
-  temp->st_MetricComputationTime[ threadID ] = timer.GetMean() * 1000.0;
+  comboMetric->m_MetricComputationTime[ i ] = timer.GetMean() * 1000.0;
 
   return ITK_THREAD_RETURN_VALUE;
 
@@ -1045,52 +1159,19 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
 
 
 /**
- *********** ComputeDerivativesMagnitudeThreaderCallback *************
+ *********** LaunchCombineDerivativesThreaderCallback *************
  */
 
 template< class TFixedImage, class TMovingImage >
-ITK_THREAD_RETURN_TYPE
+void
 CombinationImageToImageMetric< TFixedImage, TMovingImage >
-::ComputeDerivativesMagnitudeThreaderCallback( void * arg )
+::LaunchCombineDerivativesThreaderCallback( void ) const
 {
-  ThreadInfoType * infoStruct  = static_cast< ThreadInfoType * >( arg );
-  ThreadIdType     threadId    = infoStruct->ThreadID;
-  ThreadIdType     nrOfThreads = infoStruct->NumberOfThreads;
-
-  MultiThreaderCombineDerivativeType * temp
-    = static_cast< MultiThreaderCombineDerivativeType * >( infoStruct->UserData );
-
-  /** Get references to member variables. */
-  const unsigned int numberOfParameters = temp->st_ThisComboMetric->GetNumberOfParameters();
-  const unsigned int numberOfMetrics    = temp->st_ThisComboMetric->GetNumberOfMetrics();
-
-  /** Determine compute range of this thread. */
-  const unsigned int subSize = static_cast< unsigned int >(
-    vcl_ceil( static_cast< double >( numberOfParameters ) / static_cast< double >( nrOfThreads ) ) );
-  unsigned int jmin = threadId * subSize;
-  unsigned int jmax = ( threadId + 1 ) * subSize;
-  jmax = ( jmax > numberOfParameters ) ? numberOfParameters : jmax;
-
-  /** Compute the sum of squares within compute range. */
-  double derivativeValue = 0.0;
-  for( unsigned int i = 0; i < numberOfMetrics; i++ )
-  {
-    if( temp->st_ThisComboMetric->m_UseMetric[ i ] )
-    {
-      const DerivativeType & derivative   = temp->st_ThisComboMetric->m_MetricDerivatives[ i ];
-      double                 sumOfSquares = 0.0;
-      for( unsigned int j = jmin; j < jmax; j++ )
-      {
-        derivativeValue = derivative[ j ];
-        sumOfSquares   += derivativeValue * derivativeValue;
-      }
-      temp->st_DerivativesSumOfSquares[ i * nrOfThreads + threadId ] = sumOfSquares;
-    }
-  }
-
-  return ITK_THREAD_RETURN_VALUE;
+  this->m_Threader->SetSingleMethod( CombineDerivativesThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_CombineDerivativeParameters ) ) );
+  this->m_Threader->SingleMethodExecute();
 
-} // end ComputeDerivativesMagnitudeThreaderCallback()
+} // end LaunchCombineDerivativesThreaderCallback()
 
 
 /**
@@ -1118,29 +1199,54 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
     vcl_ceil( static_cast< double >( numberOfParameters ) / static_cast< double >( nrOfThreads ) ) );
   unsigned int jmin = threadId * subSize;
   unsigned int jmax = ( threadId + 1 ) * subSize;
+  jmin = ( jmin > numberOfParameters ) ? numberOfParameters : jmin;
   jmax = ( jmax > numberOfParameters ) ? numberOfParameters : jmax;
 
-  // First metric, assign
-  if( temp->st_ThisComboMetric->m_UseMetric[ 0 ] )
+  /** Initialize the weighted sum within compute range. */
+  DerivativeValueType * derivative = temp->st_Derivative;
+  if( temp->st_CombineDerivatives )
   {
-    double                 weight           = temp->st_ThisComboMetric->GetFinalMetricWeight( 0 );
-    const DerivativeType & metricDerivative = temp->st_ThisComboMetric->m_MetricDerivatives[ 0 ];
     for( unsigned int j = jmin; j < jmax; j++ )
     {
-      temp->st_Derivative[ j ] = weight * metricDerivative[ j ];
+      derivative[ j ] = NumericTraits< DerivativeValueType >::ZeroValue();
     }
   }
 
-  // Other metrics, add
-  for( unsigned int i = 1; i < numberOfMetrics; i++ )
+  /** Visit each metric derivative once: accumulate its sum of squares
+   * and add its weighted contribution within compute range.
+   */
+  for( unsigned int i = 0; i < numberOfMetrics; i++ )
   {
-    if( temp->st_ThisComboMetric->m_UseMetric[ i ] )
+    const DerivativeType & metricDerivative = temp->st_ThisComboMetric->m_MetricDerivatives[ i ];
+    const double           weight           = temp->st_Weights[ i ];
+    const bool             combine          = temp->st_CombineDerivatives && weight != 0.0;
+
+    if( temp->st_ComputeMagnitudes && combine )
     {
-      double                 weight           = temp->st_ThisComboMetric->GetFinalMetricWeight( i );
-      const DerivativeType & metricDerivative = temp->st_ThisComboMetric->m_MetricDerivatives[ i ];
+      double sumOfSquares = 0.0;
       for( unsigned int j = jmin; j < jmax; j++ )
       {
-        temp->st_Derivative[ j ] += weight * metricDerivative[ j ];
+        const double derivativeValue = metricDerivative[ j ];
+        sumOfSquares  += derivativeValue * derivativeValue;
+        derivative[ j ] += weight * derivativeValue;
+      }
+      temp->st_DerivativesSumOfSquares[ i * nrOfThreads + threadId ] = sumOfSquares;
+    }
+    else if( temp->st_ComputeMagnitudes )
+    {
+      double sumOfSquares = 0.0;
+      for( unsigned int j = jmin; j < jmax; j++ )
+      {
+        const double derivativeValue = metricDerivative[ j ];
+        sumOfSquares += derivativeValue * derivativeValue;
+      }
+      temp->st_DerivativesSumOfSquares[ i * nrOfThreads + threadId ] = sumOfSquares;
+    }
+    else if( combine )
+    {
+      for( unsigned int j = jmin; j < jmax; j++ )
+      {
+        derivative[ j ] += weight * metricDerivative[ j ];
       }
     }
   }
@@ -1160,12 +1266,24 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
 ::GetSelfHessian( const TransformParametersType & parameters,
   HessianType & H ) const
 {
-  /** Prepare Hessian */
-  H.set_size( this->GetNumberOfParameters(),
-    this->GetNumberOfParameters() );
-  //H.Fill(0.0);
-  HessianType tmpH( this->GetNumberOfParameters(),
-  this->GetNumberOfParameters() );
+  CSRHessianType compressedH;
+  this->GetCompressedSelfHessian( parameters, compressedH );
+  compressedH.GetVnlSparseMatrix( H );
+
+} // end GetSelfHessian()
+
+
+/**
+ * ********************* GetCompressedSelfHessian ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::GetCompressedSelfHessian( const TransformParametersType & parameters,
+  CSRHessianType & H ) const
+{
+  CSRHessianType tmpH;
 
   /** Add all metrics' selfhessians. */
   bool initialized = false;
@@ -1177,14 +1295,34 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
       ImageMetricType * metric = dynamic_cast< ImageMetricType * >( this->GetMetric( i ) );
       if( metric )
       {
-        initialized = true;
-        metric->GetSelfHessian( parameters, tmpH );
+        metric->GetCompressedSelfHessian( parameters, tmpH );
+        tmpH.Scale( w );
+
+        if( !initialized )
+        {
+          H           = tmpH;
+          initialized = true;
+          continue;
+        }
 
-        /** H=H+tmpH; \todo: maybe this can be done more efficiently. */
-        tmpH.reset();
-        while( tmpH.next() )
+        /** H = H + tmpH. The sparsity patterns are either equal, or one of
+         * them is the diagonal of a metric without a SelfHessian. Make sure
+         * the sum gets the largest pattern.
+         */
+        typename CSRHessianType::OffsetType missed = 0;
+        if( tmpH.GetNumberOfNonZeros() > H.GetNumberOfNonZeros() )
+        {
+          missed = tmpH.Add( H, 1.0 );
+          H      = tmpH;
+        }
+        else
         {
-          H( tmpH.getrow(), tmpH.getcolumn() ) += w * tmpH.value();
+          missed = H.Add( tmpH, 1.0 );
+        }
+        if( missed > 0 )
+        {
+          itkExceptionMacro( << "The sparsity patterns of the SelfHessians of the "
+                             << "sub metrics are incompatible." );
         }
 
       } // end if metric i exists
@@ -1195,14 +1333,11 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
    * then return an identity matrix */
   if( !initialized )
   {
-    //H.fill_diagonal(1.0);
-    for( unsigned int j = 0; j < this->GetNumberOfParameters(); ++j )
-    {
-      H( j, j ) = 1.0;
-    }
+    H.SetDiagonalPattern( this->GetNumberOfParameters() );
+    H.Fill( 1.0 );
   }
 
-} // end GetSelfHessian()
+} // end GetCompressedSelfHessian()
 
 
 /**
@@ -133,10 +133,16 @@ public:
     FixedImageType, MovingImageType >                   CombinationMetricType;
   typedef typename CombinationMetricType::Pointer CombinationMetricPointer;
 
-  /** Unfortunately the StopRegistration method is not virtual and
-   * the m_Stop member is private in the superclass. That's why
-   * we provide the following function to interrupt registration.
+  /** The m_Stop member of the superclass is shadowed by the m_Stop member
+   * of this class. That's why StopRegistration is overridden, and why we
+   * provide the following function to interrupt registration.
    */
+  virtual void StopRegistration( void )
+  {
+    this->StopMultiMetricRegistration();
+  }
+
+
   virtual void StopMultiMetricRegistration( void )
   {
     this->m_Stop = true;
@@ -227,6 +233,15 @@ public:
   itkSetNumberOfMacro( FixedImagePyramid );
   itkGetNumberOfMacro( FixedImagePyramid );
 
+  /** Get the fixed image at a level: the precomputed output of fixed image
+   * pyramid \a pos, if it has one for every level, or else its output.
+   */
+  virtual const FixedImageType * GetFixedImageAtLevel( unsigned long level,
+    unsigned int pos ) const;
+
+  virtual const FixedImageType * GetFixedImageAtLevel( unsigned long level ) const
+  { return this->GetFixedImageAtLevel( level, 0 ); }
+
   /** Set/Get the MovingImagePyramid. */
   virtual void SetMovingImagePyramid( MovingImagePyramidType * _arg, unsigned int pos );
 
@@ -119,6 +119,27 @@ MultiMetricMultiResolutionImageRegistrationMethod< TFixedImage, TMovingImage >
 
 } // end GetFixedImageRegion()
 
+
+/**
+ * **************** GetFixedImageAtLevel **********************************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+const typename
+MultiMetricMultiResolutionImageRegistrationMethod< TFixedImage, TMovingImage >
+::FixedImageType
+* MultiMetricMultiResolutionImageRegistrationMethod< TFixedImage, TMovingImage >
+::GetFixedImageAtLevel( unsigned long level, unsigned int pos ) const
+{
+  if( this->HasFixedImagePyramidOutputs( pos ) )
+  {
+    return this->Superclass::GetFixedImageAtLevel( level, pos );
+  }
+  return this->GetFixedImagePyramid( pos )->GetOutput( level );
+
+} // end GetFixedImageAtLevel()
+
+
 /**
  * ********************** SetMetric *******************************
  * Reimplement this method to check if
@@ -164,11 +185,11 @@ MultiMetricMultiResolutionImageRegistrationMethod< TFixedImage, TMovingImage >
   this->GetCombinationMetric()->SetTransform( this->GetTransform() );
 
   this->GetCombinationMetric()->SetFixedImage(
-    this->GetFixedImagePyramid()->GetOutput( this->GetCurrentLevel() ) );
+    this->GetFixedImageAtLevel( this->GetCurrentLevel() ) );
   for( unsigned int i = 0; i < this->GetNumberOfFixedImagePyramids(); ++i )
   {
     this->GetCombinationMetric()->SetFixedImage(
-      this->GetFixedImagePyramid( i )->GetOutput( this->GetCurrentLevel() ), i );
+      this->GetFixedImageAtLevel( this->GetCurrentLevel(), i ), i );
   }
 
   this->GetCombinationMetric()->SetMovingImage(
@@ -242,7 +263,10 @@ MultiMetricMultiResolutionImageRegistrationMethod< TFixedImage, TMovingImage >
       {
         fixpyr->SetInput( this->GetFixedImage() );
       }
-      fixpyr->UpdateLargestPossibleRegion();
+      if( !this->HasFixedImagePyramidOutputs( i ) )
+      {
+        fixpyr->UpdateLargestPossibleRegion();
+      }
 
       ScheduleType schedule = fixpyr->GetSchedule();
 
@@ -287,11 +311,11 @@ MultiMetricMultiResolutionImageRegistrationMethod< TFixedImage, TMovingImage >
 
       for( unsigned int level = 0; level < this->GetNumberOfLevels(); level++ )
       {
-        SizeType         size;
-        IndexType        start;
-        CIndexType       startcindex;
-        CIndexType       endcindex;
-        FixedImageType * fixedImageAtLevel = fixpyr->GetOutput( level );
+        SizeType               size;
+        IndexType              start;
+        CIndexType             startcindex;
+        CIndexType             endcindex;
+        const FixedImageType * fixedImageAtLevel = this->GetFixedImageAtLevel( level, i );
         /** map the original fixed image region to the image resulting from the
          * FixedImagePyramid at level l.
          * To be on the safe side, the start point is ceiled, and the end point
@@ -127,13 +127,18 @@ public:
   /** Execute stuff before the actual registration:
    * \li Connect all components to the registration framework.
    * \li Set the number of resolution levels.
-   * \li Set the fixed image region. */
+   * \li Set the fixed image region.
+   * \li Reuse the fixed image pyramid outputs of a previous registration. */
   virtual void BeforeRegistration( void );
 
   /** Execute stuff before each resolution:
    * \li Update masks with an erosion. */
   virtual void BeforeEachResolution( void );
 
+  /** Execute stuff after the registration:
+   * \li Store the fixed image pyramid outputs for following registrations. */
+  virtual void AfterRegistration( void );
+
 protected:
 
   /** The constructor. */
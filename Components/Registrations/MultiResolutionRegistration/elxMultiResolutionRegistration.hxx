@@ -78,6 +78,11 @@ MultiResolutionRegistration< TElastix >
   /** Set the fixedImageRegion. */
   this->SetFixedImageRegion( this->GetElastix()->GetFixedImage()->GetBufferedRegion() );
 
+  /** Reuse the fixed image pyramid outputs of a previous registration with
+   * the same fixed image and parameter map, such as a previous batch job.
+   */
+  this->ReuseFixedImagePyramidOutputs( 1 );
+
 } // end BeforeRegistration()
 
 
@@ -101,6 +106,23 @@ MultiResolutionRegistration< TElastix >
 } // end BeforeEachResolution()
 
 
+/**
+ * ******************* AfterRegistration ***********************
+ */
+
+template< class TElastix >
+void
+MultiResolutionRegistration< TElastix >
+::AfterRegistration( void )
+{
+  /** Store the fixed image pyramid outputs, if they were computed by this
+   * registration, so that following registrations can reuse them.
+   */
+  this->StoreFixedImagePyramidOutputs( 1 );
+
+} // end AfterRegistration()
+
+
 /**
  * *********************** SetComponents ************************
  */
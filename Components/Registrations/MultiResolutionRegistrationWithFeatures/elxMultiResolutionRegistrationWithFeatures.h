@@ -147,6 +147,7 @@ public:
    * \li Connect all components to the registration framework.
    * \li Set the number of resolution levels.
    * \li Set the fixed image regions.
+   * \li Reuse the fixed image pyramid outputs of a previous registration.
    * \li Add the sub metric columns to the iteration info object.
    */
   virtual void BeforeRegistration( void );
@@ -157,6 +158,11 @@ public:
    */
   virtual void BeforeEachResolution( void );
 
+  /** Execute stuff after the registration:
+   * \li Store the fixed image pyramid outputs for following registrations.
+   */
+  virtual void AfterRegistration( void );
+
 protected:
 
   /** The constructor. */
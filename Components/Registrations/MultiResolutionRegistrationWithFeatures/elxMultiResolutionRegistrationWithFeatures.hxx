@@ -47,9 +47,31 @@ MultiResolutionRegistrationWithFeatures< TElastix >
   /** Set the fixed image interpolators. */
   this->GetAndSetFixedImageInterpolators();
 
+  /** Reuse the fixed image pyramid outputs of a previous registration with
+   * the same fixed images and parameter map, such as a previous batch job.
+   */
+  this->ReuseFixedImagePyramidOutputs( this->GetNumberOfFixedImagePyramids() );
+
 }   // end BeforeRegistration()
 
 
+/**
+ * ******************* AfterRegistration ***********************
+ */
+
+template< class TElastix >
+void
+MultiResolutionRegistrationWithFeatures< TElastix >
+::AfterRegistration( void )
+{
+  /** Store the fixed image pyramid outputs, if they were computed by this
+   * registration, so that following registrations can reuse them.
+   */
+  this->StoreFixedImagePyramidOutputs( this->GetNumberOfFixedImagePyramids() );
+
+}   // end AfterRegistration()
+
+
 /**
  * ******************* BeforeEachResolution ***********************
  */
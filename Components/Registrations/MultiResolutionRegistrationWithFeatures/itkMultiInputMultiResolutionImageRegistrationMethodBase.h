@@ -183,6 +183,15 @@ public:
   itkSetNumberOfMacro( FixedImagePyramid );
   itkGetNumberOfMacro( FixedImagePyramid );
 
+  /** Get the fixed image at a level: the precomputed output of fixed image
+   * pyramid \a pos, if it has one for every level, or else its output.
+   */
+  virtual const FixedImageType * GetFixedImageAtLevel( unsigned long level,
+    unsigned int pos ) const;
+
+  virtual const FixedImageType * GetFixedImageAtLevel( unsigned long level ) const
+  { return this->GetFixedImageAtLevel( level, 0 ); }
+
   /** Set/Get the Moving image. */
   virtual void SetMovingImage( const MovingImageType * _arg, unsigned int pos );
 
@@ -191,6 +191,25 @@ MultiInputMultiResolutionImageRegistrationMethodBase< TFixedImage, TMovingImage
 
 }   // end GetFixedImagePyramid()
 
+/**
+ * **************** GetFixedImageAtLevel **********************************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+const typename
+MultiInputMultiResolutionImageRegistrationMethodBase< TFixedImage, TMovingImage >
+::FixedImageType
+* MultiInputMultiResolutionImageRegistrationMethodBase< TFixedImage, TMovingImage >
+::GetFixedImageAtLevel( unsigned long level, unsigned int pos ) const
+{
+  if( this->HasFixedImagePyramidOutputs( pos ) )
+  {
+    return this->Superclass::GetFixedImageAtLevel( level, pos );
+  }
+  return this->GetFixedImagePyramid( pos )->GetOutput( level );
+
+}   // end GetFixedImageAtLevel()
+
 /**
  * **************** GetMovingImagePyramid **********************************
  */
@@ -282,7 +301,7 @@ MultiInputMultiResolutionImageRegistrationMethodBase< TFixedImage, TMovingImage
   for( unsigned int i = 0; i < this->GetNumberOfFixedImagePyramids(); ++i )
   {
     this->GetMultiInputMetric()->SetFixedImage(
-      this->GetFixedImagePyramid( i )->GetOutput( this->GetCurrentLevel() ), i );
+      this->GetFixedImageAtLevel( this->GetCurrentLevel(), i ), i );
   }
 
   for( unsigned int i = 0; i < this->GetNumberOfMovingImagePyramids(); ++i )
@@ -380,7 +399,10 @@ MultiInputMultiResolutionImageRegistrationMethodBase< TFixedImage, TMovingImage
       {
         fixpyr->SetInput( this->GetFixedImage() );
       }
-      fixpyr->UpdateLargestPossibleRegion();
+      if( !this->HasFixedImagePyramidOutputs( i ) )
+      {
+        fixpyr->UpdateLargestPossibleRegion();
+      }
 
       /** Setup the fixed image region pyramid. */
       ScheduleType schedule = fixpyr->GetSchedule();
@@ -426,11 +448,11 @@ MultiInputMultiResolutionImageRegistrationMethodBase< TFixedImage, TMovingImage
 
       for( unsigned int level = 0; level < this->GetNumberOfLevels(); level++ )
       {
-        SizeType         size;
-        IndexType        start;
-        CIndexType       startcindex;
-        CIndexType       endcindex;
-        FixedImageType * fixedImageAtLevel = fixpyr->GetOutput( level );
+        SizeType               size;
+        IndexType              start;
+        CIndexType             startcindex;
+        CIndexType             endcindex;
+        const FixedImageType * fixedImageAtLevel = this->GetFixedImageAtLevel( level, i );
         /** Map the original fixed image region to the image resulting from the
          * FixedImagePyramid at level l.
          * To be on the safe side, the start point is ceiled, and the end point is
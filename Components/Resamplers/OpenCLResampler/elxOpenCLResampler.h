@@ -119,6 +119,11 @@ public:
   /** Function to write parameters to a file. */
   virtual void WriteToFile( void ) const;
 
+  /** The GPU resampler copies the complete transform chain,
+   * so the transform is not compiled.
+   */
+  virtual void CompileTransform( void ) {}
+
 protected:
 
   /** The constructor. */
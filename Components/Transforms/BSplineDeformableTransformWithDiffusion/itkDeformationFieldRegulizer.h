@@ -112,6 +112,10 @@ public:
   /** Method to transform a point. */
   virtual OutputPointType TransformPoint( const InputPointType & inputPoint ) const;
 
+  /** The intermediary deformation field is added in TransformPoint(), so the
+   * current transform can not be evaluated on its own. */
+  virtual bool IsPlainCombination( void ) const { return false; }
+
 protected:
 
   /** The constructor. */
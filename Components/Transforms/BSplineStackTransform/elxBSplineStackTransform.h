@@ -80,6 +80,13 @@ namespace elastix
  *   The default is zero for all resolutions. A value of 4 will avoid all deformations
  *   at the edge of the image. Make sure that 2*PassiveEdgeWidth < ControlPointGridSize
  *   in each dimension.
+ * \parameter UpsampleGridUsingTwoScaleRelation: compute the B-spline coefficients of a refined
+ *   control point grid directly from the coarser ones, using the two-scale relation of the
+ *   B-spline, instead of by sampling and B-spline decomposition. This is exact and multi-threaded,
+ *   but only applies when the grid spacing is refined by an integer factor and the grids are aligned;
+ *   otherwise the default method is used. Coefficients at the grid border can differ slightly from the default. \n
+ *   example: <tt>(UpsampleGridUsingTwoScaleRelation "true")</tt> \n
+ *   The default is false.
  *
  *
  * The transform parameters necessary for transformix, additionally defined by this class, are:
@@ -463,6 +463,12 @@ BSplineStackTransform< TElastix >
   this->m_GridScheduleComputer->GetBSplineGrid( level,
     requiredGridRegion, requiredGridSpacing, requiredGridOrigin, requiredGridDirection );
 
+  /** Use the direct two-scale relation for aligned grids, if requested. */
+  bool upsampleUsingTwoScaleRelation = false;
+  this->GetConfiguration()->ReadParameter( upsampleUsingTwoScaleRelation,
+    "UpsampleGridUsingTwoScaleRelation", this->GetComponentLabel(), 0, 0, false );
+  this->m_GridUpsampler->SetUseTwoScaleRelation( upsampleUsingTwoScaleRelation );
+
   /** Setup the GridUpsampler. */
   this->m_GridUpsampler->SetCurrentGridOrigin( currentGridOrigin );
   this->m_GridUpsampler->SetCurrentGridSpacing( currentGridSpacing );
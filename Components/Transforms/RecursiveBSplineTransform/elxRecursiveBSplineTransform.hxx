@@ -448,6 +448,15 @@ RecursiveBSplineTransform< TElastix >
   ParametersType latestParameters
     = this->m_Registration->GetAsITKBaseType()->GetLastTransformParameters();
 
+  /** Use the direct two-scale relation for aligned grids, if requested.
+   * Not for the cyclic transform, which wraps the last dimension.
+   */
+  bool upsampleUsingTwoScaleRelation = false;
+  this->GetConfiguration()->ReadParameter( upsampleUsingTwoScaleRelation,
+    "UpsampleGridUsingTwoScaleRelation", this->GetComponentLabel(), 0, 0, false );
+  this->m_GridUpsampler->SetUseTwoScaleRelation(
+    upsampleUsingTwoScaleRelation && !this->m_Cyclic );
+
   /** Setup the GridUpsampler. */
   this->m_GridUpsampler->SetCurrentGridOrigin( currentGridOrigin );
   this->m_GridUpsampler->SetCurrentGridSpacing( currentGridSpacing );
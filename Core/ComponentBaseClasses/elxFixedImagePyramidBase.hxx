@@ -180,8 +180,24 @@ FixedImagePyramidBase< TElastix >
   typedef itk::ImageFileCastWriter< OutputImageType > WriterType;
   typename WriterType::Pointer writer = WriterType::New();
 
+  /** Write the output that the registration took from a previous
+   * registration, if any, since this pyramid is then not updated.
+   */
+  unsigned int pos = 0;
+  while( pos < this->GetElastix()->GetNumberOfFixedImagePyramids()
+    && this->GetElastix()->GetElxFixedImagePyramidBase( pos ) != this )
+  {
+    ++pos;
+  }
+  typedef typename RegistrationType::ITKBaseType RegistrationITKBaseType;
+  const RegistrationITKBaseType * registration
+    = this->GetRegistration()->GetAsITKBaseType();
+  const OutputImageType * image = registration->HasFixedImagePyramidOutputs( pos )
+    ? registration->GetFixedImageAtLevel( level, pos )
+    : this->GetAsITKBaseType()->GetOutput( level );
+
   /** Setup the pipeline. */
-  writer->SetInput( this->GetAsITKBaseType()->GetOutput( level ) );
+  writer->SetInput( image );
   writer->SetFileName( filename.c_str() );
   writer->SetOutputComponentType( resultImagePixelType.c_str() );
   writer->SetUseCompression( doCompression );
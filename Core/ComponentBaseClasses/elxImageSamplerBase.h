@@ -65,6 +65,9 @@ public:
 
   /** ITKBaseType. */
   typedef itk::ImageSamplerBase< InputImageType > ITKBaseType;
+  typedef typename ITKBaseType::ImageSampleContainerType    ImageSampleContainerType;
+  typedef typename ITKBaseType::ImageSampleContainerPointer ImageSampleContainerPointer;
+  typedef typename ElastixType::DataObjectCacheType         DataObjectCacheType;
 
   /** Cast to ITKBaseType. */
   virtual ITKBaseType * GetAsITKBaseType( void )
@@ -80,12 +83,39 @@ public:
   }
 
 
+  /** Execute stuff before the registration:
+   * \li Set the random generator of this registration.
+   */
+  virtual void BeforeRegistrationBase( void );
+
   /** Execute stuff before each resolution:
    * \li Give a warning when NewSamplesEveryIteration is specified,
    * but the sampler is ignoring it.
+   * \li Set the samples that the same sampler of a previous registration
+   * stored in the data object cache, if the sampler selects the same
+   * samples on every update.
    */
   virtual void BeforeEachResolutionBase( void );
 
+  /** Execute stuff after each resolution:
+   * \li Store a copy of the samples in the data object cache, so that
+   * following registrations with the same fixed image, such as the other
+   * jobs of a batch, do not have to sample again.
+   */
+  virtual void AfterEachResolutionBase( void );
+
+  /** Replace the samples of the output by the pruning samples of the
+   * current resolution. These are the samples of the first registration
+   * that stored them in the data object cache, so the metric values of all
+   * registrations that share the cache, such as the starts of a multi-start
+   * registration, are computed on the same samples and can be compared.
+   * Without a cache, the output is left unchanged.
+   */
+  virtual void SelectPruningSamples( void );
+
+  /** Restore the samples that SelectPruningSamples() replaced. */
+  virtual void RestoreSamples( void );
+
 protected:
 
   /** The constructor. */
@@ -93,8 +123,14 @@ protected:
   /** The destructor. */
   virtual ~ImageSamplerBase() {}
 
+  /** Get the key of the samples of a resolution in the data object cache. */
+  std::string GetSampleContainerKey( unsigned int level ) const;
+
 private:
 
+  /** The samples that SelectPruningSamples() replaced. */
+  ImageSampleContainerPointer m_SavedSamples;
+
   /** The private constructor. */
   ImageSamplerBase( const Self & );   // purposely not implemented
   /** The private copy constructor. */
@@ -24,6 +24,24 @@
 namespace elastix
 {
 
+/**
+ * ******************* BeforeRegistrationBase ******************
+ */
+
+template< class TElastix >
+void
+ImageSamplerBase< TElastix >
+::BeforeRegistrationBase( void )
+{
+  /** Draw from the random generator of this registration, which is seeded
+   * with the RandomSeed, and not shared with other registrations.
+   */
+  this->GetAsITKBaseType()->SetRandomGenerator(
+    this->GetElastix()->GetRandomGenerator() );
+
+} // end BeforeRegistrationBase()
+
+
 /**
  * ******************* BeforeEachResolutionBase ******************
  */
@@ -64,9 +82,131 @@ ImageSamplerBase< TElastix >
   }
   else { this->GetAsITKBaseType()->SetUseMultiThread( false ); }
 
+  /** Reuse the samples of a previous registration, if any. Only samplers
+   * that select the same samples on every update can do so.
+   */
+  typename ImageSampleContainerType::ConstPointer precomputedSamples = 0;
+  DataObjectCacheType * cache = this->GetElastix()->GetDataObjectCache();
+  if( cache != 0 && !this->GetAsITKBaseType()->SelectingNewSamplesOnUpdateSupported() )
+  {
+    precomputedSamples = dynamic_cast< const ImageSampleContainerType * >(
+      cache->GetDataObject( this->GetSampleContainerKey( level ) ).GetPointer() );
+  }
+  this->GetAsITKBaseType()->SetPrecomputedSampleContainer( precomputedSamples );
+
 } // end BeforeEachResolutionBase()
 
 
+/**
+ * ******************* AfterEachResolutionBase ******************
+ */
+
+template< class TElastix >
+void
+ImageSamplerBase< TElastix >
+::AfterEachResolutionBase( void )
+{
+  /** Nothing to store if there is no cache, if the samples change on every
+   * update, or if they were taken from the cache.
+   */
+  ITKBaseType *         sampler = this->GetAsITKBaseType();
+  DataObjectCacheType * cache   = this->GetElastix()->GetDataObjectCache();
+  if( cache == 0 || sampler->SelectingNewSamplesOnUpdateSupported()
+    || sampler->GetPrecomputedSampleContainer() != 0
+    || sampler->GetOutput()->Size() == 0 )
+  {
+    return;
+  }
+
+  /** Store a copy, since the output is overwritten in the next resolution. */
+  const unsigned int level
+    = this->m_Registration->GetAsITKBaseType()->GetCurrentLevel();
+  ImageSampleContainerPointer samples = ImageSampleContainerType::New();
+  samples->CastToSTLContainer() = sampler->GetOutput()->CastToSTLConstContainer();
+  cache->AddDataObject( this->GetSampleContainerKey( level ), samples );
+
+} // end AfterEachResolutionBase()
+
+
+/**
+ * ******************* SelectPruningSamples ******************
+ */
+
+template< class TElastix >
+void
+ImageSamplerBase< TElastix >
+::SelectPruningSamples( void )
+{
+  this->m_SavedSamples = 0;
+  DataObjectCacheType * cache = this->GetElastix()->GetDataObjectCache();
+  if( cache == 0 )
+  {
+    return;
+  }
+
+  /** Update first, so that the metric does not select new samples. */
+  ITKBaseType * sampler = this->GetAsITKBaseType();
+  sampler->Update();
+
+  /** The first registration stores its current samples. */
+  const unsigned int level
+    = this->m_Registration->GetAsITKBaseType()->GetCurrentLevel();
+  const std::string key = DataObjectCacheType::MakeKey(
+    this->GetComponentLabel() + "PruningSamples",
+    this->m_Configuration->GetElastixLevel(), level );
+  typename ImageSampleContainerType::ConstPointer pruningSamples
+    = dynamic_cast< const ImageSampleContainerType * >( cache->GetDataObject( key ).GetPointer() );
+  if( pruningSamples.IsNull() )
+  {
+    ImageSampleContainerPointer samples = ImageSampleContainerType::New();
+    samples->CastToSTLContainer() = sampler->GetOutput()->CastToSTLConstContainer();
+    pruningSamples = dynamic_cast< const ImageSampleContainerType * >(
+      cache->AddDataObject( key, samples ).GetPointer() );
+  }
+
+  this->m_SavedSamples = ImageSampleContainerType::New();
+  this->m_SavedSamples->CastToSTLContainer().swap( sampler->GetOutput()->CastToSTLContainer() );
+  sampler->GetOutput()->CastToSTLContainer() = pruningSamples->CastToSTLConstContainer();
+
+} // end SelectPruningSamples()
+
+
+/**
+ * ******************* RestoreSamples ******************
+ */
+
+template< class TElastix >
+void
+ImageSamplerBase< TElastix >
+::RestoreSamples( void )
+{
+  if( this->m_SavedSamples.IsNull() )
+  {
+    return;
+  }
+
+  this->GetAsITKBaseType()->GetOutput()->CastToSTLContainer().swap(
+    this->m_SavedSamples->CastToSTLContainer() );
+  this->m_SavedSamples = 0;
+
+} // end RestoreSamples()
+
+
+/**
+ * ******************* GetSampleContainerKey ******************
+ */
+
+template< class TElastix >
+std::string
+ImageSamplerBase< TElastix >
+::GetSampleContainerKey( unsigned int level ) const
+{
+  return DataObjectCacheType::MakeKey( this->GetComponentLabel(),
+    this->m_Configuration->GetElastixLevel(), level );
+
+} // end GetSampleContainerKey()
+
+
 } // end namespace elastix
 
 #endif //#ifndef __elxImageSamplerBase_hxx
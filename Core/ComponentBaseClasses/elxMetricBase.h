@@ -63,6 +63,58 @@ namespace elastix
  *    CheckNumberOfSamples. \n
  *    example: <tt>(RequiredRatioOfValidSamples 0.1)</tt> \n
  *    The default is 0.25.
+ * \parameter UseFastPathKernels: Whether the advanced metrics use loops that are
+ *    specialized for the affine and B-spline transforms combined with a linear or
+ *    B-spline interpolator. The results are the same; set this to "false" to
+ *    always use the generic loops. Can be given for each resolution. \n
+ *    example: <tt>(UseFastPathKernels "false")</tt> \n
+ *    The default is true.
+ * \parameter UseSinglePrecisionAccumulation: Whether the threads accumulate their
+ *    part of the derivative in single precision. The per-thread derivatives are
+ *    summed in double precision, and the parameters remain double. This reduces
+ *    the memory traffic for transforms with many parameters, at the cost of a
+ *    relative error in the derivative of about 1e-6. Used by the AdvancedMeanSquares
+ *    and AdvancedMattesMutualInformation metrics, when multi-threaded.
+ *    Can be given for each resolution. \n
+ *    example: <tt>(UseSinglePrecisionAccumulation "true")</tt> \n
+ *    The default is false.
+ * \parameter UseDeterministicReduction: Whether the metric value and derivative should
+ *    be independent of the number of threads. The samples are then divided over a
+ *    fixed number of work units instead of over the threads, and the results of the
+ *    work units are summed in a fixed order. Registrations then give the same result
+ *    on machines with different numbers of cores. Used by the AdvancedMeanSquares,
+ *    AdvancedNormalizedCorrelation, AdvancedMattesMutualInformation,
+ *    SumSquaredTissueVolumeDifference and TransformBendingEnergyPenalty metrics,
+ *    when multi-threaded. The self Hessian of the metrics, used by the preconditioned
+ *    optimizers, does not depend on the number of threads anyway. Can be given for
+ *    each resolution. \n
+ *    example: <tt>(UseDeterministicReduction "true")</tt> \n
+ *    The default is false.
+ * \parameter NumberOfDeterministicWorkUnits: The number of work units with
+ *    UseDeterministicReduction. At most this number of threads is used by the metric.
+ *    With fewer samples than work units, the number of work units is lowered to the
+ *    number of samples. Each work unit stores its own derivative. Between 1 and 256.
+ *    Can be given for each resolution. \n
+ *    example: <tt>(NumberOfDeterministicWorkUnits 32)</tt> \n
+ *    The default is 16.
+ * \parameter UseBSplineWeightTables: Whether the weights of a RecursiveBSplineTransform
+ *    are looked up in tables for samples on the voxel lattice of the fixed image. Used
+ *    with the Full and Grid samplers, when the B-spline grid is aligned with the voxel
+ *    lattice and its spacing is an integer multiple of the voxel spacing. The results
+ *    are the same. The gain over the direct evaluation of the cubic kernels is measured
+ *    by the RecursiveBSplineWeightTablesPerformance test. Can be given for each
+ *    resolution. \n
+ *    example: <tt>(UseBSplineWeightTables "true")</tt> \n
+ *    The default is false.
+ * \parameter UseOpenCL: Whether the samples of the metric are evaluated on the
+ *    OpenCL device. Used by the AdvancedMeanSquares and AdvancedMattesMutualInformation
+ *    metrics, when elastix is compiled with OpenCL, for a linear interpolator, no moving
+ *    mask, and an affine, Euler, similarity or third order B-spline transform without
+ *    initial transform. The mutual information additionally requires the low memory
+ *    derivative and the default Parzen window orders. Otherwise the CPU is used.
+ *    The device computes in single precision. Can be given for each resolution. \n
+ *    example: <tt>(UseOpenCL "true" "true" "false")</tt> \n
+ *    The default is false.
  *
  * \ingroup Metrics
  * \ingroup ComponentBaseClasses
@@ -109,6 +109,9 @@ MetricBase< TElastix >
   /** For advanced metrics several other things can be set. */
   if( thisAsAdvanced != 0 )
   {
+    /** Draw random numbers with the random generator of this registration. */
+    thisAsAdvanced->SetRandomGenerator( this->GetElastix()->GetRandomGenerator() );
+
     /** Should the metric check for enough samples? */
     bool checkNumberOfSamples = true;
     this->GetConfiguration()->ReadParameter( checkNumberOfSamples,
@@ -180,6 +183,41 @@ MetricBase< TElastix >
       }
     }
 
+    /** Should the metric use the specialized kernels, if available? */
+    bool useFastPathKernels = true;
+    this->GetConfiguration()->ReadParameter( useFastPathKernels,
+      "UseFastPathKernels", this->GetComponentLabel(), level, 0 );
+    thisAsAdvanced->SetUseFastPathKernels( useFastPathKernels );
+
+    /** Should the threads accumulate the derivative in single precision? */
+    bool useSinglePrecisionAccumulation = false;
+    this->GetConfiguration()->ReadParameter( useSinglePrecisionAccumulation,
+      "UseSinglePrecisionAccumulation", this->GetComponentLabel(), level, 0 );
+    thisAsAdvanced->SetUseSinglePrecisionAccumulation( useSinglePrecisionAccumulation );
+
+    /** Should the results be independent of the number of threads? */
+    bool useDeterministicReduction = false;
+    this->GetConfiguration()->ReadParameter( useDeterministicReduction,
+      "UseDeterministicReduction", this->GetComponentLabel(), level, 0 );
+    thisAsAdvanced->SetUseDeterministicReduction( useDeterministicReduction );
+
+    unsigned int numberOfDeterministicWorkUnits = 16;
+    this->GetConfiguration()->ReadParameter( numberOfDeterministicWorkUnits,
+      "NumberOfDeterministicWorkUnits", this->GetComponentLabel(), level, 0 );
+    thisAsAdvanced->SetNumberOfDeterministicWorkUnits( numberOfDeterministicWorkUnits );
+
+    /** Should the B-spline weights be tabulated for samples on the voxel lattice? */
+    bool useBSplineWeightTables = false;
+    this->GetConfiguration()->ReadParameter( useBSplineWeightTables,
+      "UseBSplineWeightTables", this->GetComponentLabel(), level, 0 );
+    thisAsAdvanced->SetUseBSplineWeightTables( useBSplineWeightTables );
+
+    /** Should the samples be evaluated on the OpenCL device? */
+    bool useOpenCL = false;
+    this->GetConfiguration()->ReadParameter( useOpenCL,
+      "UseOpenCL", this->GetComponentLabel(), level, 0 );
+    thisAsAdvanced->SetUseOpenCL( useOpenCL );
+
   } // end advanced metric
 
 } // end BeforeEachResolutionBase()
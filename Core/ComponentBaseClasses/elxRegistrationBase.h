@@ -169,8 +169,14 @@ protected:
   typedef typename
     MovingMaskSpatialObjectType::Pointer MovingMaskSpatialObjectPointer;
 
-  typedef typename ITKBaseType::FixedImagePyramidType  FixedImagePyramidType;
-  typedef typename ITKBaseType::MovingImagePyramidType MovingImagePyramidType;
+  typedef typename ITKBaseType::FixedImagePyramidType        FixedImagePyramidType;
+  typedef typename ITKBaseType::MovingImagePyramidType       MovingImagePyramidType;
+  typedef typename ITKBaseType::FixedImagePyramidOutputsType FixedImagePyramidOutputsType;
+
+  /** Typedef for the cache that registrations with the same fixed images,
+   * masks and parameter maps share.
+   */
+  typedef typename ElastixType::DataObjectCacheType DataObjectCacheType;
 
   /** Some typedef's used for eroding the masks */
   typedef itk::ErodeMaskImageFilter< FixedMaskImageType >  FixedMaskErodeFilterType;
@@ -188,6 +194,8 @@ protected:
    * Output:
    * \li the mask as a spatial object, which can be set in a metric for example
    *
+   * The eroded mask image is shared with following registrations through
+   * the data object cache. The spatial object is always new.
    * This function is used by the registration components
    */
   FixedMaskSpatialObjectPointer GenerateFixedMaskSpatialObject(
@@ -204,12 +212,45 @@ protected:
    * Output:
    * \li the mask as a spatial object, which can be set in a metric for example
    *
+   * The eroded mask image is shared with following registrations through
+   * the data object cache. The spatial object is always new.
    * This function is used by the registration components
    */
   MovingMaskSpatialObjectPointer GenerateMovingMaskSpatialObject(
     const MovingMaskImageType * maskImage, bool useMaskErosion,
     const MovingImagePyramidType * pyramid, unsigned int level ) const;
 
+  /** Get whether the fixed image pyramid outputs are shared through the
+   * data object cache. This is the case when the cache is set, and the
+   * pyramid computes all resolutions at once.
+   */
+  bool GetUseFixedImagePyramidCache( void ) const;
+
+  /** Set the outputs of the first \a numberOfPyramids fixed image pyramids
+   * that a previous registration stored in the data object cache, such that
+   * these pyramids are not updated. To be called in BeforeRegistration().
+   */
+  void ReuseFixedImagePyramidOutputs( unsigned int numberOfPyramids );
+
+  /** Store the outputs of the first \a numberOfPyramids fixed image pyramids
+   * in the data object cache, unless they were taken from it. To be called
+   * in AfterRegistration().
+   */
+  void StoreFixedImagePyramidOutputs( unsigned int numberOfPyramids );
+
+  /** Get the key of a fixed image pyramid output in the data object cache. */
+  std::string GetFixedImagePyramidKey( unsigned int pos, unsigned int level ) const;
+
+  /** Get the key of an eroded mask in the data object cache, from the name
+   * "Fixed" or "Moving", the index of the mask and the index of the pyramid
+   * that determines the erosion. Returns an empty string if the mask or the
+   * pyramid is not one of those of elastix, in which case the eroded mask is
+   * not shared.
+   */
+  std::string GetErodedMaskKey( const std::string & whichMask,
+    const itk::DataObject * maskImage, const itk::Object * pyramid,
+    unsigned int level ) const;
+
 private:
 
   /** The private constructor. */
@@ -118,6 +118,21 @@ RegistrationBase< TElastix >
     return fixedMaskSpatialObject;
   }
 
+  /** Take the eroded mask of a previous registration, if there is one. */
+  DataObjectCacheType * cache = this->GetElastix()->GetDataObjectCache();
+  const std::string     key   = cache != 0
+    ? this->GetErodedMaskKey( "Fixed", maskImage, pyramid, level ) : std::string( "" );
+  if( !key.empty() )
+  {
+    const FixedMaskImageType * cachedMask = dynamic_cast< const FixedMaskImageType * >(
+      cache->GetDataObject( key ).GetPointer() );
+    if( cachedMask != 0 )
+    {
+      fixedMaskSpatialObject->SetImage( cachedMask );
+      return fixedMaskSpatialObject;
+    }
+  }
+
   /** Erode, and convert to spatial object. */
   FixedMaskErodeFilterPointer erosion = FixedMaskErodeFilterType::New();
   erosion->SetInput( maskImage );
@@ -147,6 +162,12 @@ RegistrationBase< TElastix >
   /** Release some memory. */
   erodedFixedMaskAsImage->DisconnectPipeline();
 
+  /** Share the eroded mask with following registrations. */
+  if( !key.empty() )
+  {
+    cache->AddDataObject( key, erodedFixedMaskAsImage );
+  }
+
   fixedMaskSpatialObject->SetImage( erodedFixedMaskAsImage );
   return fixedMaskSpatialObject;
 
@@ -178,6 +199,21 @@ RegistrationBase< TElastix >
     return movingMaskSpatialObject;
   }
 
+  /** Take the eroded mask of a previous registration, if there is one. */
+  DataObjectCacheType * cache = this->GetElastix()->GetDataObjectCache();
+  const std::string     key   = cache != 0
+    ? this->GetErodedMaskKey( "Moving", maskImage, pyramid, level ) : std::string( "" );
+  if( !key.empty() )
+  {
+    const MovingMaskImageType * cachedMask = dynamic_cast< const MovingMaskImageType * >(
+      cache->GetDataObject( key ).GetPointer() );
+    if( cachedMask != 0 )
+    {
+      movingMaskSpatialObject->SetImage( cachedMask );
+      return movingMaskSpatialObject;
+    }
+  }
+
   /** Erode, and convert to spatial object. */
   MovingMaskErodeFilterPointer erosion = MovingMaskErodeFilterType::New();
   erosion->SetInput( maskImage );
@@ -207,12 +243,200 @@ RegistrationBase< TElastix >
   /** Release some memory */
   erodedMovingMaskAsImage->DisconnectPipeline();
 
+  /** Share the eroded mask with following registrations. */
+  if( !key.empty() )
+  {
+    cache->AddDataObject( key, erodedMovingMaskAsImage );
+  }
+
   movingMaskSpatialObject->SetImage( erodedMovingMaskAsImage );
   return movingMaskSpatialObject;
 
 } // end GenerateMovingMaskSpatialObject()
 
 
+/**
+ * ******************* GetUseFixedImagePyramidCache **********************
+ */
+
+template< class TElastix >
+bool
+RegistrationBase< TElastix >
+::GetUseFixedImagePyramidCache( void ) const
+{
+  if( this->GetElastix()->GetDataObjectCache() == 0 )
+  {
+    return false;
+  }
+
+  /** A pyramid that computes one resolution at a time has no outputs of the
+   * other resolutions to share.
+   */
+  bool computeThisResolution = false;
+  this->m_Configuration->ReadParameter( computeThisResolution,
+    "ComputePyramidImagesPerResolution", 0, false );
+  return !computeThisResolution;
+
+} // end GetUseFixedImagePyramidCache()
+
+
+/**
+ * ******************* ReuseFixedImagePyramidOutputs **********************
+ */
+
+template< class TElastix >
+void
+RegistrationBase< TElastix >
+::ReuseFixedImagePyramidOutputs( unsigned int numberOfPyramids )
+{
+  if( !this->GetUseFixedImagePyramidCache() )
+  {
+    return;
+  }
+
+  DataObjectCacheType * cache          = this->GetElastix()->GetDataObjectCache();
+  ITKBaseType *         registration   = this->GetAsITKBaseType();
+  unsigned int          numberOfReused = 0;
+  for( unsigned int pos = 0; pos < numberOfPyramids; ++pos )
+  {
+    /** Only use the outputs if there is one for every resolution. */
+    FixedImagePyramidOutputsType outputs;
+    for( unsigned int level = 0; level < registration->GetNumberOfLevels(); ++level )
+    {
+      const FixedImageType * image = dynamic_cast< const FixedImageType * >(
+        cache->GetDataObject( this->GetFixedImagePyramidKey( pos, level ) ).GetPointer() );
+      if( image == 0 )
+      {
+        outputs.clear();
+        break;
+      }
+      outputs.push_back( image );
+    }
+    registration->SetFixedImagePyramidOutputs( outputs, pos );
+    numberOfReused += outputs.empty() ? 0 : 1;
+  }
+
+  if( numberOfReused > 0 )
+  {
+    elxout << "Reusing " << numberOfReused
+           << " fixed image pyramid(s) of a previous registration." << std::endl;
+  }
+
+} // end ReuseFixedImagePyramidOutputs()
+
+
+/**
+ * ******************* StoreFixedImagePyramidOutputs **********************
+ */
+
+template< class TElastix >
+void
+RegistrationBase< TElastix >
+::StoreFixedImagePyramidOutputs( unsigned int numberOfPyramids )
+{
+  if( !this->GetUseFixedImagePyramidCache() )
+  {
+    return;
+  }
+
+  DataObjectCacheType * cache        = this->GetElastix()->GetDataObjectCache();
+  ITKBaseType *         registration = this->GetAsITKBaseType();
+  for( unsigned int pos = 0; pos < numberOfPyramids; ++pos )
+  {
+    if( registration->HasFixedImagePyramidOutputs( pos ) )
+    {
+      continue;
+    }
+    for( unsigned int level = 0; level < registration->GetNumberOfLevels(); ++level )
+    {
+      /** Graft the output in a new image, which shares the pixel buffer, but
+       * not the pipeline of the pyramid, which is deleted with this registration.
+       */
+      typename FixedImageType::Pointer image = FixedImageType::New();
+      image->Graft( registration->GetFixedImageAtLevel( level, pos ) );
+      cache->AddDataObject( this->GetFixedImagePyramidKey( pos, level ), image );
+    }
+  }
+
+} // end StoreFixedImagePyramidOutputs()
+
+
+/**
+ * ******************* GetFixedImagePyramidKey **********************
+ */
+
+template< class TElastix >
+std::string
+RegistrationBase< TElastix >
+::GetFixedImagePyramidKey( unsigned int pos, unsigned int level ) const
+{
+  std::ostringstream name;
+  name << "FixedImagePyramid" << pos;
+  return DataObjectCacheType::MakeKey( name.str(),
+    this->m_Configuration->GetElastixLevel(), level );
+
+} // end GetFixedImagePyramidKey()
+
+
+/**
+ * ******************* GetErodedMaskKey **********************
+ */
+
+template< class TElastix >
+std::string
+RegistrationBase< TElastix >
+::GetErodedMaskKey( const std::string & whichMask,
+  const itk::DataObject * maskImage, const itk::Object * pyramid,
+  unsigned int level ) const
+{
+  ElastixType * elastix = this->GetElastix();
+  const bool    isFixed = ( whichMask == "Fixed" );
+
+  /** Find the index of the mask. */
+  const unsigned int numberOfMasks = isFixed
+    ? elastix->GetNumberOfFixedMasks() : elastix->GetNumberOfMovingMasks();
+  unsigned int maskIndex = 0;
+  for( ; maskIndex < numberOfMasks; ++maskIndex )
+  {
+    const itk::DataObject * mask = isFixed
+      ? static_cast< const itk::DataObject * >( elastix->GetFixedMask( maskIndex ) )
+      : static_cast< const itk::DataObject * >( elastix->GetMovingMask( maskIndex ) );
+    if( mask == maskImage )
+    {
+      break;
+    }
+  }
+
+  /** Find the index of the pyramid. */
+  const unsigned int numberOfPyramids = isFixed
+    ? elastix->GetNumberOfFixedImagePyramids() : elastix->GetNumberOfMovingImagePyramids();
+  unsigned int pyramidIndex = 0;
+  for( ; pyramidIndex < numberOfPyramids; ++pyramidIndex )
+  {
+    const itk::Object * pyramid_i = isFixed
+      ? static_cast< const itk::Object * >(
+      elastix->GetElxFixedImagePyramidBase( pyramidIndex )->GetAsITKBaseType() )
+      : static_cast< const itk::Object * >(
+      elastix->GetElxMovingImagePyramidBase( pyramidIndex )->GetAsITKBaseType() );
+    if( pyramid_i == pyramid )
+    {
+      break;
+    }
+  }
+
+  if( maskIndex == numberOfMasks || pyramidIndex == numberOfPyramids )
+  {
+    return "";
+  }
+
+  std::ostringstream name;
+  name << "Eroded" << whichMask << "Mask" << maskIndex << ".P" << pyramidIndex;
+  return DataObjectCacheType::MakeKey( name.str(),
+    this->m_Configuration->GetElastixLevel(), level );
+
+} // end GetErodedMaskKey()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef __elxRegistrationBase_hxx
@@ -64,6 +64,25 @@ namespace elastix
  *    of the written image is desired.\n
  *    example: <tt>(CompressResultImage "true")</tt> \n
  *    The default is "false".
+ * \parameter CompressResultImageChunkSize: the size in bytes of the chunks in which
+ *    a compressed .mhd result image is cast and compressed in parallel. 0 compresses
+ *    the image in one piece.\n
+ *    example: <tt>(CompressResultImageChunkSize 4194304)</tt> \n
+ *    The default is 1048576.
+ * \parameter CompileTransformChain: in transformix, flatten the chain of initial
+ *    transforms before resampling, folding consecutive linear transforms into a
+ *    single matrix.\n
+ *    example: <tt>(CompileTransformChain "true")</tt> \n
+ *    The default is "false".
+ * \parameter CompiledTransformGridSpacingFactor: if larger than zero, a compiled
+ *    chain that contains nonlinear transforms is also baked into a displacement grid,
+ *    with a spacing of this factor times the output image spacing.\n
+ *    example: <tt>(CompiledTransformGridSpacingFactor 2.0)</tt> \n
+ *    The default is 0.0, which means no baking.
+ * \parameter CompiledTransformMaximumError: the displacement grid is only used if its
+ *    maximum error (in mm) is below this value.\n
+ *    example: <tt>(CompiledTransformMaximumError 0.05)</tt> \n
+ *    The default is 0.1 times the smallest output image spacing.
  *
  * \ingroup Resamplers
  * \ingroup ComponentBaseClasses
@@ -181,6 +200,11 @@ public:
   /** Function to create the result image in the format of an itk::Image. */
   virtual void CreateItkResultImage( void );
 
+  /** Function to replace the transform by a compiled copy of the transform
+   * chain, if desired. Used by transformix, before resampling.
+   */
+  virtual void CompileTransform( void );
+
 protected:
 
   /** The constructor. */
@@ -23,6 +23,7 @@
 #include "itkImageFileCastWriter.h"
 #include "itkChangeInformationImageFilter.h"
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
+#include "itkCompiledCombinationTransform.h"
 #include "itkTimeProbe.h"
 
 namespace elastix
@@ -368,6 +369,102 @@ ResamplerBase< TElastix >
 } // end ResampleAndWriteResultImage()
 
 
+/**
+ * ******************* CompileTransform ********************
+ */
+
+template< class TElastix >
+void
+ResamplerBase< TElastix >
+::CompileTransform( void )
+{
+  /** Check if compilation is desired. */
+  bool compileTransformChain = false;
+  this->m_Configuration->ReadParameter( compileTransformChain,
+    "CompileTransformChain", 0, false );
+  if( !compileTransformChain )
+  {
+    return;
+  }
+
+  /** Typedef's. */
+  typedef itk::CompiledCombinationTransform<
+    CoordRepType, ImageDimension >                      CompiledTransformType;
+  typedef typename CompiledTransformType::GridSizeType    GridSizeType;
+  typedef typename CompiledTransformType::GridSpacingType GridSpacingType;
+  typedef typename CompiledTransformType::GridOriginType  GridOriginType;
+
+  ITKBaseType * resampler = this->GetAsITKBaseType();
+  typename CompiledTransformType::Pointer compiledTransform
+    = CompiledTransformType::New();
+  compiledTransform->SetTransform( resampler->GetTransform() );
+
+  /** Setup the displacement grid, such that it covers the output image. */
+  double gridSpacingFactor = 0.0;
+  this->m_Configuration->ReadParameter( gridSpacingFactor,
+    "CompiledTransformGridSpacingFactor", 0, false );
+  if( gridSpacingFactor > 0.0 )
+  {
+    const SizeType        size      = resampler->GetSize();
+    const IndexType       index     = resampler->GetOutputStartIndex();
+    const SpacingType     spacing   = resampler->GetOutputSpacing();
+    const OriginPointType origin    = resampler->GetOutputOrigin();
+    const DirectionType   direction = resampler->GetOutputDirection();
+
+    GridSizeType    gridSize;
+    GridSpacingType gridSpacing;
+    GridOriginType  gridOrigin;
+    double          minimumSpacing = spacing[ 0 ];
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+      gridSpacing[ i ] = spacing[ i ] * gridSpacingFactor;
+      gridSize[ i ]    = ( size[ i ] > 1 )
+        ? static_cast< unsigned long >( vcl_ceil( ( size[ i ] - 1 ) / gridSpacingFactor ) ) + 1
+        : size[ i ];
+      gridOrigin[ i ] = origin[ i ];
+      for( unsigned int j = 0; j < ImageDimension; j++ )
+      {
+        gridOrigin[ i ] += direction( i, j ) * spacing[ j ] * index[ j ];
+      }
+      minimumSpacing = vnl_math_min( minimumSpacing, spacing[ i ] );
+    }
+
+    double maximumError = 0.1 * minimumSpacing;
+    this->m_Configuration->ReadParameter( maximumError,
+      "CompiledTransformMaximumError", 0, false );
+
+    compiledTransform->BakeNonlinearStagesOn();
+    compiledTransform->SetGridSize( gridSize );
+    compiledTransform->SetGridSpacing( gridSpacing );
+    compiledTransform->SetGridOrigin( gridOrigin );
+    compiledTransform->SetGridDirection( direction );
+    compiledTransform->SetMaximumBakingError( maximumError );
+  }
+
+  /** Compile and report. */
+  compiledTransform->Compile();
+  elxout << "  The transform chain of "
+         << compiledTransform->GetNumberOfOriginalStages()
+         << " stage(s) is compiled into "
+         << compiledTransform->GetNumberOfStages() << " stage(s)." << std::endl;
+  if( compiledTransform->GetIsBaked() )
+  {
+    elxout << "  The chain is baked into a displacement grid of size "
+           << compiledTransform->GetGridSize() << ", with a maximum error of "
+           << compiledTransform->GetBakingError() << "." << std::endl;
+  }
+  else if( compiledTransform->GetBakeNonlinearStages() )
+  {
+    elxout << "  The chain is not baked into a displacement grid, its maximum error of "
+           << compiledTransform->GetBakingError() << " exceeds "
+           << compiledTransform->GetMaximumBakingError() << "." << std::endl;
+  }
+
+  resampler->SetTransform( compiledTransform );
+
+} // end CompileTransform()
+
+
 /**
  * ******************* WriteResultImage ********************
  */
@@ -407,6 +504,11 @@ ResamplerBase< TElastix >
   this->m_Configuration->ReadParameter(
     doCompression, "CompressResultImage", 0, false );
 
+  /** Read the size of the chunks that are compressed in parallel. */
+  unsigned long compressionChunkSize = 1 << 20;
+  this->m_Configuration->ReadParameter(
+    compressionChunkSize, "CompressResultImageChunkSize", 0, false );
+
   /** Typedef's for writing the output image. */
   typedef itk::ImageFileCastWriter< OutputImageType > WriterType;
   typedef typename WriterType::Pointer                WriterPointer;
@@ -432,6 +534,7 @@ ResamplerBase< TElastix >
   writer->SetFileName( filename );
   writer->SetOutputComponentType( resultImagePixelType.c_str() );
   writer->SetUseCompression( doCompression );
+  writer->SetCompressionChunkSize( compressionChunkSize );
 
   /** Do the writing. */
   if( showProgress )
@@ -26,9 +26,11 @@
 #include "itkAdvancedCombinationTransform.h"
 #include "elxComponentDatabase.h"
 #include "elxProgressCommand.h"
+#include "itkMultiThreader.h"
 
 #include <fstream>
 #include <iomanip>
+#include <vector>
 
 namespace elastix
 {
@@ -107,6 +109,13 @@ namespace elastix
  * The location is relative to the path from where elastix/transformix is started!\n
  * Default: "NoInitialTransform", which (obviously) means that there is no initial transform
  * to be loaded.
+ * \transformparameter NumberOfStreamDivisions: The number of pieces in which transformix
+ * computes and writes the deformation field and the (determinant of the) spatial Jacobian.
+ * Only one piece is held in memory at a time, which reduces the memory usage for large
+ * images. Streaming is only supported for the (uncompressed) mhd and mha result image
+ * formats; for other formats a warning is given and the whole image is computed at once.\n
+ * example <tt>(NumberOfStreamDivisions 16)</tt>\n
+ * Default: 1, which means that the whole image is computed at once.
  *
  * The command line arguments used by this class are:
  * \commandlinearg -t0: optional argument for elastix for specifying an initial transform
@@ -346,6 +355,31 @@ private:
   /** Boolean to decide whether or not the transform parameters are written. */
   bool m_ReadWriteTransformParameters;
 
+  /** The variables of the threads that transform a chunk of points. */
+  struct TransformPointsThreaderParameters
+  {
+    const Self *                          m_Self;
+    const std::vector< InputPointType > * m_InputPoints;
+    std::vector< std::string > *          m_Output;
+    unsigned long                         m_FirstPointNumber;
+    bool                                  m_PointsAreIndices;
+    bool                                  m_AlsoMovingIndices;
+    const FixedImageType *                m_DummyImage;
+    const MovingImageType *               m_MovingImage;
+  };
+
+  /** Transform and print the points of a chunk, multi-threaded. */
+  static ITK_THREAD_RETURN_TYPE TransformPointsThreaderCallback( void * arg );
+
+  /** Read the number of pieces in which the deformation field and the spatial
+   * Jacobian images are computed and written, from NumberOfStreamDivisions.
+   * Returns 1, with a warning, for formats that cannot be written in pieces.
+   */
+  unsigned int ReadNumberOfStreamDivisions( const std::string & resultImageFormat ) const;
+
+  void ThreadedTransformPoints( const TransformPointsThreaderParameters & parameters,
+    const itk::ThreadIdType threadId, const itk::ThreadIdType numberOfThreads ) const;
+
   std::string GetInitialTransformParametersFileName( void ) const
   {
     if( !this->GetInitialTransform() )
@@ -38,6 +38,10 @@
 #include "itkMeshFileWriter.h"
 #include "itkTransformMeshFilter.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
 namespace itk
 {
 
@@ -1089,6 +1093,10 @@ TransformBase< TElastix >
  * Computes the transformed points, converts them back to an index and compute
  * the deformation vector as the difference between the outputpoint and
  * the input point. Save the results.
+ *
+ * The points are read, transformed and saved in chunks of
+ * NumberOfPointsPerChunk points, so that the memory use does not depend
+ * on the number of points. Each chunk is transformed multi-threaded.
  */
 
 template< class TElastix >
@@ -1097,17 +1105,9 @@ TransformBase< TElastix >
 ::TransformPointsSomePoints( const std::string filename ) const
 {
   /** Typedef's. */
-  typedef typename FixedImageType::RegionType           FixedImageRegionType;
-  typedef typename FixedImageType::PointType            FixedImageOriginType;
-  typedef typename FixedImageType::SpacingType          FixedImageSpacingType;
-  typedef typename FixedImageType::IndexType            FixedImageIndexType;
-  typedef typename FixedImageIndexType::IndexValueType  FixedImageIndexValueType;
-  typedef typename MovingImageType::IndexType           MovingImageIndexType;
-  typedef typename MovingImageIndexType::IndexValueType MovingImageIndexValueType;
-  typedef
-    itk::ContinuousIndex< double, FixedImageDimension >   FixedImageContinuousIndexType;
-  typedef
-    itk::ContinuousIndex< double, MovingImageDimension >  MovingImageContinuousIndexType;
+  typedef typename FixedImageType::RegionType    FixedImageRegionType;
+  typedef typename FixedImageType::PointType     FixedImageOriginType;
+  typedef typename FixedImageType::SpacingType   FixedImageSpacingType;
   typedef typename FixedImageType::DirectionType FixedImageDirectionType;
 
   typedef bool DummyIPPPixelType;
@@ -1118,22 +1118,27 @@ TransformBase< TElastix >
     FixedImageDimension, MeshTraitsType >                PointSetType;
   typedef itk::TransformixInputPointFileReader<
     PointSetType >                                      IPPReaderType;
-  typedef itk::Vector< float, FixedImageDimension > DeformationVectorType;
 
   /** Construct an ipp-file reader. */
   typename IPPReaderType::Pointer ippReader = IPPReaderType::New();
   ippReader->SetFileName( filename.c_str() );
 
-  /** Read the input points. */
+  /** Read the header of the input point file. */
   elxout << "  Reading input point file: " << filename << std::endl;
   try
   {
-    ippReader->Update();
+    ippReader->UpdateOutputInformation();
   }
-  catch( itk::ExceptionObject & err )
+  catch( itk::ExceptionObject & excp )
   {
-    xl::xout[ "error" ] << "  Error while opening input point file." << std::endl;
-    xl::xout[ "error" ] << err << std::endl;
+    /** Add information to the exception. */
+    excp.SetLocation( "TransformBase - TransformPointsSomePoints()" );
+    std::string err_str = excp.GetDescription();
+    err_str += "\nError while opening the input point file.\n";
+    excp.SetDescription( err_str );
+
+    /** Pass the exception to an higher level. */
+    throw excp;
   }
 
   /** Some user-feedback. */
@@ -1145,20 +1150,9 @@ TransformBase< TElastix >
   {
     elxout << "  Input points are specified in world coordinates." << std::endl;
   }
-  unsigned int nrofpoints = ippReader->GetNumberOfPoints();
+  const unsigned long nrofpoints = ippReader->GetNumberOfPoints();
   elxout << "  Number of specified input points: " << nrofpoints << std::endl;
 
-  /** Get the set of input points. */
-  typename PointSetType::Pointer inputPointSet = ippReader->GetOutput();
-
-  /** Create the storage classes. */
-  std::vector< FixedImageIndexType >   inputindexvec(  nrofpoints );
-  std::vector< InputPointType >        inputpointvec(  nrofpoints );
-  std::vector< OutputPointType >       outputpointvec( nrofpoints );
-  std::vector< FixedImageIndexType >   outputindexfixedvec( nrofpoints );
-  std::vector< MovingImageIndexType >  outputindexmovingvec( nrofpoints );
-  std::vector< DeformationVectorType > deformationvec( nrofpoints );
-
   /** Make a temporary image with the right region info,
    * which we can use to convert between points and indices.
    * By taking the image from the resampler output, the UseDirectionCosines
@@ -1181,149 +1175,250 @@ TransformBase< TElastix >
   dummyImage->SetSpacing( spacing );
   dummyImage->SetDirection( direction );
 
-  /** Temp vars */
-  FixedImageContinuousIndexType  fixedcindex;
-  MovingImageContinuousIndexType movingcindex;
-
   /** Also output moving image indices if a moving image was supplied. */
-  bool alsoMovingIndices = false;
   typename MovingImageType::Pointer movingImage = this->GetElastix()->GetMovingImage();
-  if( movingImage.IsNotNull() )
+
+  /** Get the number of points that are transformed at once. */
+  unsigned long numberOfPointsPerChunk = 100000;
+  this->m_Configuration->ReadParameter( numberOfPointsPerChunk,
+    "NumberOfPointsPerChunk", 0, false );
+  numberOfPointsPerChunk = std::max( numberOfPointsPerChunk, 1UL );
+
+  /** Create filename and file stream. */
+  std::string outputPointsFileName = this->m_Configuration
+    ->GetCommandLineArgument( "-out" );
+  outputPointsFileName += "outputpoints.txt";
+  std::ofstream outputPointsFile( outputPointsFileName.c_str() );
+  elxout << "  The transformed points are saved in: "
+         <<  outputPointsFileName << std::endl;
+
+  /** Set up the threads, that transform a chunk of points and print the
+   * results of their part of the chunk.
+   */
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  std::vector< InputPointType > chunk;
+  std::vector< std::string >    threadOutput( threader->GetNumberOfThreads() );
+
+  TransformPointsThreaderParameters parameters;
+  parameters.m_Self              = this;
+  parameters.m_InputPoints       = &chunk;
+  parameters.m_Output            = &threadOutput;
+  parameters.m_FirstPointNumber  = 0;
+  parameters.m_PointsAreIndices  = ippReader->GetPointsAreIndices();
+  parameters.m_AlsoMovingIndices = movingImage.IsNotNull();
+  parameters.m_DummyImage        = dummyImage.GetPointer();
+  parameters.m_MovingImage       = movingImage.GetPointer();
+  threader->SetSingleMethod( Self::TransformPointsThreaderCallback, &parameters );
+
+  /** Read, transform and save the points, one chunk at a time. */
+  elxout << "  The input points are transformed." << std::endl;
+  try
+  {
+    while( parameters.m_FirstPointNumber < nrofpoints )
+    {
+      const unsigned long n = ippReader->ReadNextPoints( chunk, numberOfPointsPerChunk );
+      if( n == 0 )
+      {
+        break;
+      }
+      threader->SingleMethodExecute();
+      for( std::size_t t = 0; t < threadOutput.size(); ++t )
+      {
+        outputPointsFile << threadOutput[ t ];
+      }
+      parameters.m_FirstPointNumber += n;
+    }
+  }
+  catch( itk::ExceptionObject & excp )
   {
-    alsoMovingIndices = true;
+    /** Do not leave a truncated output point file behind. */
+    outputPointsFile.close();
+    std::remove( outputPointsFileName.c_str() );
+
+    /** Add information to the exception. */
+    excp.SetLocation( "TransformBase - TransformPointsSomePoints()" );
+    std::string err_str = excp.GetDescription();
+    err_str += "\nError while reading the input point file. The incomplete output point file "
+      + outputPointsFileName + " is removed.\n";
+    excp.SetDescription( err_str );
+
+    /** Pass the exception to an higher level. */
+    throw excp;
   }
 
-  /** Read the input points, as index or as point. */
-  if( !( ippReader->GetPointsAreIndices() ) )
+} // end TransformPointsSomePoints()
+
+
+/**
+ * ************** TransformPointsThreaderCallback *********************
+ */
+
+template< class TElastix >
+ITK_THREAD_RETURN_TYPE
+TransformBase< TElastix >
+::TransformPointsThreaderCallback( void * arg )
+{
+  typedef itk::MultiThreader::ThreadInfoStruct ThreadInfoType;
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+
+  const TransformPointsThreaderParameters * parameters
+    = static_cast< TransformPointsThreaderParameters * >( infoStruct->UserData );
+  parameters->m_Self->ThreadedTransformPoints( *parameters,
+    infoStruct->ThreadID, infoStruct->NumberOfThreads );
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end TransformPointsThreaderCallback()
+
+
+/**
+ * ************** ThreadedTransformPoints *********************
+ *
+ * Transforms the part of a chunk of input points of one thread, and
+ * prints the results of each point on a line of the output of the thread.
+ */
+
+template< class TElastix >
+void
+TransformBase< TElastix >
+::ThreadedTransformPoints( const TransformPointsThreaderParameters & parameters,
+  const itk::ThreadIdType threadId, const itk::ThreadIdType numberOfThreads ) const
+{
+  /** Typedef's. */
+  typedef typename FixedImageType::IndexType            FixedImageIndexType;
+  typedef typename FixedImageIndexType::IndexValueType  FixedImageIndexValueType;
+  typedef typename MovingImageType::IndexType           MovingImageIndexType;
+  typedef typename MovingImageIndexType::IndexValueType MovingImageIndexValueType;
+  typedef
+    itk::ContinuousIndex< double, FixedImageDimension >   FixedImageContinuousIndexType;
+  typedef
+    itk::ContinuousIndex< double, MovingImageDimension >  MovingImageContinuousIndexType;
+  typedef itk::Vector< float, FixedImageDimension > DeformationVectorType;
+
+  /** The part of the chunk of this thread. */
+  const std::vector< InputPointType > & chunk = *parameters.m_InputPoints;
+  const unsigned long                   begin = chunk.size() * threadId / numberOfThreads;
+  const unsigned long                   end   = chunk.size() * ( threadId + 1 ) / numberOfThreads;
+
+  /** Temp vars */
+  FixedImageIndexType            inputindex;
+  InputPointType                 inputpoint;
+  OutputPointType                outputpoint;
+  FixedImageIndexType            outputindexfixed;
+  MovingImageIndexType           outputindexmoving;
+  DeformationVectorType          deformation;
+  FixedImageContinuousIndexType  fixedcindex;
+  MovingImageContinuousIndexType movingcindex;
+
+  std::ostringstream outputPoints;
+  outputPoints << std::showpoint << std::fixed;
+
+  for( unsigned long j = begin; j < end; ++j )
   {
-    for( unsigned int j = 0; j < nrofpoints; j++ )
+    /** Read the input point, as index or as point. */
+    if( !parameters.m_PointsAreIndices )
     {
       /** Compute index of nearest voxel in fixed image. */
-      InputPointType point; point.Fill( 0.0f );
-      inputPointSet->GetPoint( j, &point );
-      inputpointvec[ j ] = point;
-      dummyImage->TransformPhysicalPointToContinuousIndex(
-        point, fixedcindex );
+      inputpoint = chunk[ j ];
+      parameters.m_DummyImage->TransformPhysicalPointToContinuousIndex(
+        inputpoint, fixedcindex );
       for( unsigned int i = 0; i < FixedImageDimension; i++ )
       {
-        inputindexvec[ j ][ i ] = static_cast< FixedImageIndexValueType >(
+        inputindex[ i ] = static_cast< FixedImageIndexValueType >(
           itk::Math::Round< double >( fixedcindex[ i ] ) );
       }
     }
-  }
-  else //so: inputasindex
-  {
-    for( unsigned int j = 0; j < nrofpoints; j++ )
+    else //so: inputasindex
     {
-      /** The read point from the inutPointSet is actually an index
-       * Cast to the proper type.
-       */
-      InputPointType point; point.Fill( 0.0f );
-      inputPointSet->GetPoint( j, &point );
+      /** The read point is actually an index. Cast to the proper type. */
       for( unsigned int i = 0; i < FixedImageDimension; i++ )
       {
-        inputindexvec[ j ][ i ] = static_cast< FixedImageIndexValueType >(
-          itk::Math::Round< double >( point[ i ] ) );
+        inputindex[ i ] = static_cast< FixedImageIndexValueType >(
+          itk::Math::Round< double >( chunk[ j ][ i ] ) );
       }
       /** Compute the input point in physical coordinates. */
-      dummyImage->TransformIndexToPhysicalPoint(
-        inputindexvec[ j ], inputpointvec[ j ] );
+      parameters.m_DummyImage->TransformIndexToPhysicalPoint(
+        inputindex, inputpoint );
     }
-  }
 
-  /** Apply the transform. */
-  elxout << "  The input points are transformed." << std::endl;
-  for( unsigned int j = 0; j < nrofpoints; j++ )
-  {
     /** Call TransformPoint. */
-    outputpointvec[ j ] = this->GetAsITKBaseType()->TransformPoint( inputpointvec[ j ] );
+    outputpoint = this->GetAsITKBaseType()->TransformPoint( inputpoint );
 
     /** Transform back to index in fixed image domain. */
-    dummyImage->TransformPhysicalPointToContinuousIndex(
-      outputpointvec[ j ], fixedcindex );
+    parameters.m_DummyImage->TransformPhysicalPointToContinuousIndex(
+      outputpoint, fixedcindex );
     for( unsigned int i = 0; i < FixedImageDimension; i++ )
     {
-      outputindexfixedvec[ j ][ i ] = static_cast< FixedImageIndexValueType >(
+      outputindexfixed[ i ] = static_cast< FixedImageIndexValueType >(
         itk::Math::Round< double >( fixedcindex[ i ] ) );
     }
 
-    if( alsoMovingIndices )
+    if( parameters.m_AlsoMovingIndices )
     {
       /** Transform back to index in moving image domain. */
-      movingImage->TransformPhysicalPointToContinuousIndex(
-        outputpointvec[ j ], movingcindex );
+      parameters.m_MovingImage->TransformPhysicalPointToContinuousIndex(
+        outputpoint, movingcindex );
       for( unsigned int i = 0; i < MovingImageDimension; i++ )
       {
-        outputindexmovingvec[ j ][ i ] = static_cast< MovingImageIndexValueType >(
+        outputindexmoving[ i ] = static_cast< MovingImageIndexValueType >(
           itk::Math::Round< double >( movingcindex[ i ] ) );
       }
     }
 
     /** Compute displacement. */
-    deformationvec[ j ].CastFrom( outputpointvec[ j ] - inputpointvec[ j ] );
-  }
+    deformation.CastFrom( outputpoint - inputpoint );
 
-  /** Create filename and file stream. */
-  std::string outputPointsFileName = this->m_Configuration
-    ->GetCommandLineArgument( "-out" );
-  outputPointsFileName += "outputpoints.txt";
-  std::ofstream outputPointsFile( outputPointsFileName.c_str() );
-  outputPointsFile << std::showpoint << std::fixed;
-  elxout << "  The transformed points are saved in: "
-         <<  outputPointsFileName << std::endl;
-
-  /** Print the results. */
-  for( unsigned int j = 0; j < nrofpoints; j++ )
-  {
     /** The input index. */
-    outputPointsFile << "Point\t" << j << "\t; InputIndex = [ ";
+    outputPoints << "Point\t" << parameters.m_FirstPointNumber + j << "\t; InputIndex = [ ";
     for( unsigned int i = 0; i < FixedImageDimension; i++ )
     {
-      outputPointsFile << inputindexvec[ j ][ i ] << " ";
+      outputPoints << inputindex[ i ] << " ";
     }
 
     /** The input point. */
-    outputPointsFile << "]\t; InputPoint = [ ";
+    outputPoints << "]\t; InputPoint = [ ";
     for( unsigned int i = 0; i < FixedImageDimension; i++ )
     {
-      outputPointsFile << inputpointvec[ j ][ i ] << " ";
+      outputPoints << inputpoint[ i ] << " ";
     }
 
     /** The output index in fixed image. */
-    outputPointsFile << "]\t; OutputIndexFixed = [ ";
+    outputPoints << "]\t; OutputIndexFixed = [ ";
     for( unsigned int i = 0; i < FixedImageDimension; i++ )
     {
-      outputPointsFile << outputindexfixedvec[ j ][ i ] << " ";
+      outputPoints << outputindexfixed[ i ] << " ";
     }
 
     /** The output point. */
-    outputPointsFile << "]\t; OutputPoint = [ ";
+    outputPoints << "]\t; OutputPoint = [ ";
     for( unsigned int i = 0; i < FixedImageDimension; i++ )
     {
-      outputPointsFile << outputpointvec[ j ][ i ] << " ";
+      outputPoints << outputpoint[ i ] << " ";
     }
 
     /** The output point minus the input point. */
-    outputPointsFile << "]\t; Deformation = [ ";
+    outputPoints << "]\t; Deformation = [ ";
     for( unsigned int i = 0; i < MovingImageDimension; i++ )
     {
-      outputPointsFile << deformationvec[ j ][ i ] << " ";
+      outputPoints << deformation[ i ] << " ";
     }
 
-    if( alsoMovingIndices )
+    if( parameters.m_AlsoMovingIndices )
     {
       /** The output index in moving image. */
-      outputPointsFile << "]\t; OutputIndexMoving = [ ";
+      outputPoints << "]\t; OutputIndexMoving = [ ";
       for( unsigned int i = 0; i < MovingImageDimension; i++ )
       {
-        outputPointsFile << outputindexmovingvec[ j ][ i ] << " ";
+        outputPoints << outputindexmoving[ i ] << " ";
       }
     }
 
-    outputPointsFile << "]" << std::endl;
-  } // end for nrofpoints
+    outputPoints << "]" << std::endl;
+  } // end for points
 
-} // end TransformPointsSomePoints()
+  ( *parameters.m_Output )[ threadId ] = outputPoints.str();
+
+} // end ThreadedTransformPoints()
 
 
 /**
@@ -1484,6 +1579,9 @@ TransformBase< TElastix >
   defWriter->SetInput( infoChanger->GetOutput() );
   defWriter->SetFileName( makeFileName.str().c_str() );
 
+  /** Compute and write the image in pieces, to limit the memory usage. */
+  defWriter->SetNumberOfStreamDivisions( this->ReadNumberOfStreamDivisions( resultImageFormat ) );
+
   /** Do the writing. */
   elxout << "  Computing and writing the deformation field ..." << std::endl;
   try
@@ -1505,6 +1603,39 @@ TransformBase< TElastix >
 } // end TransformPointsAllPoints()
 
 
+/**
+ * ************** ReadNumberOfStreamDivisions **********************
+ */
+
+template< class TElastix >
+unsigned int
+TransformBase< TElastix >
+::ReadNumberOfStreamDivisions( const std::string & resultImageFormat ) const
+{
+  /** The number of pieces in which the images of transformix are computed
+   * and written. Default: 1, i.e. no streaming.
+   */
+  unsigned int numberOfStreamDivisions = 1;
+  this->m_Configuration->ReadParameter( numberOfStreamDivisions,
+    "NumberOfStreamDivisions", 0, false );
+
+  /** Only the uncompressed MetaImage writer can write in pieces. Other writers
+   * would request the whole image anyway, so then compute it at once.
+   */
+  if( numberOfStreamDivisions > 1
+    && resultImageFormat != "mhd" && resultImageFormat != "mha" )
+  {
+    xl::xout[ "warning" ] << "WARNING: NumberOfStreamDivisions is ignored for the result image format \""
+                          << resultImageFormat << "\".\n"
+                          << "  Streaming is only supported for mhd and mha.\n"
+                          << "  The whole image is computed at once." << std::endl;
+    numberOfStreamDivisions = 1;
+  }
+  return numberOfStreamDivisions;
+
+} // end ReadNumberOfStreamDivisions()
+
+
 /**
  * ************** ComputeDeterminantOfSpatialJacobian **********************
  */
@@ -1587,6 +1718,9 @@ TransformBase< TElastix >
   jacWriter->SetInput( infoChanger->GetOutput() );
   jacWriter->SetFileName( makeFileName.str().c_str() );
 
+  /** Compute and write the image in pieces, to limit the memory usage. */
+  jacWriter->SetNumberOfStreamDivisions( this->ReadNumberOfStreamDivisions( resultImageFormat ) );
+
   /** Do the writing. */
   elxout << "  Computing and writing the spatial Jacobian determinant..." << std::endl;
   try
@@ -1689,6 +1823,10 @@ TransformBase< TElastix >
   typename JacobianWriterType::Pointer jacWriter = JacobianWriterType::New();
   jacWriter->SetInput( infoChanger->GetOutput() );
   jacWriter->SetFileName( makeFileName.str().c_str() );
+
+  /** Compute and write the image in pieces, to limit the memory usage. */
+  jacWriter->SetNumberOfStreamDivisions( this->ReadNumberOfStreamDivisions( resultImageFormat ) );
+
   /** Hack to change the pixel type to vector. Not necessary for mhd. */
   typename PixelTypeChangeCommandType::Pointer jacStartWriteCommand
     = PixelTypeChangeCommandType::New();
@@ -66,6 +66,7 @@ ComponentDatabase::SetCreator(
   PtrToCreator creator )
 {
   /** Get the map */
+  MutexHolderType  holder( this->m_Mutex );
   CreatorMapType & map = GetCreatorMap();
 
   /** Make a key with the input arguments */
@@ -102,7 +103,8 @@ ComponentDatabase::SetIndex(
   IndexType i )
 {
   /** Get the map.*/
-  IndexMapType & map = GetIndexMap();
+  MutexHolderType holder( this->m_Mutex );
+  IndexMapType &  map = GetIndexMap();
 
   /** Make a key with the input arguments.*/
   ImageTypeDescriptionType fixedImage( fixedPixelType, fixedDimension );
@@ -137,7 +139,8 @@ ComponentDatabase::GetCreator(
   IndexType i )
 {
   /** Get the map */
-  CreatorMapType map = GetCreatorMap();
+  MutexHolderType  holder( this->m_Mutex );
+  CreatorMapType & map = GetCreatorMap();
 
   /** Make a key with the input arguments */
   CreatorMapKeyType key( name, i );
@@ -171,7 +174,8 @@ ComponentDatabase::GetIndex(
   ImageDimensionType movingDimension )
 {
   /** Get the map */
-  IndexMapType map = GetIndexMap();
+  MutexHolderType holder( this->m_Mutex );
+  IndexMapType &  map = GetIndexMap();
 
   /** Make a key with the input arguments */
   ImageTypeDescriptionType fixedImage( fixedPixelType, fixedDimension );
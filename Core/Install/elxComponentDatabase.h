@@ -21,6 +21,8 @@
 
 #include "itkObject.h"
 #include "itkObjectFactory.h"
+#include "itkSimpleFastMutexLock.h"
+#include "itkMutexLockHolder.h"
 #include <iostream>
 #include <string>
 #include <utility>
@@ -45,6 +47,10 @@ namespace elastix
  * known" by calling the elxInstallMacro, which is defined in
  * elxMacro.h .
  *
+ * The Set and Get functions may be called from different threads, for example
+ * when components are installed lazily for one image type, while components
+ * of another image type are created. They are serialized by a mutex.
+ *
  * \sa elxInstallFunctions
  * \ingroup Install
  */
@@ -144,6 +150,10 @@ protected:
   CreatorMapType CreatorMap;
   IndexMapType   IndexMap;
 
+  /** Serializes the access to the maps by the Set and Get functions. */
+  typedef itk::MutexLockHolder< itk::SimpleFastMutexLock > MutexHolderType;
+  itk::SimpleFastMutexLock m_Mutex;
+
 private:
 
   ComponentDatabase( const Self & ); // purposely not implemented
@@ -24,6 +24,7 @@
 #include "elxInstallFunctions.h"
 #include "elxMacro.h"
 #include "elxInstallAllComponents.h"
+#include "itkTimeProbe.h"
 #include <iostream>
 #include <string>
 
@@ -89,6 +90,7 @@ public:
 ComponentLoader::ComponentLoader()
 {
   this->m_ImageTypeSupportInstalled = false;
+  this->m_ComponentsInstalled.resize( NrOfSupportedImageTypes + 1, false );
 }
 
 
@@ -154,10 +156,61 @@ ComponentLoader::LoadComponents( const char * /** argv0 */ )
     }
   }   //end if !ImageTypeSupportInstalled
 
+  return 0;
+
+}   // end LoadComponents
+
+
+/**
+ * ****************** InstallComponents **************************
+ */
+
+int
+ComponentLoader::InstallComponents( const IndexType index )
+{
+  /** Several ElastixFilter instances may request components concurrently. */
+  itk::MutexLockHolder< itk::SimpleFastMutexLock > holder( this->m_Mutex );
+  return this->InstallComponentsLocked( index );
+
+}   // end InstallComponents
+
+
+/**
+ * ****************** InstallComponentsLocked ********************
+ */
+
+int
+ComponentLoader::InstallComponentsLocked( const IndexType index )
+{
+  if( index > NrOfSupportedImageTypes )
+  {
+    xout[ "error" ]
+      << "ERROR: Image type index " << index << " is not supported." << std::endl;
+    return 1;
+  }
+
+  /** Nothing to do if the components of this index are installed already. */
+  if( this->m_ComponentsInstalled[ index ] ) { return 0; }
+
+  /** Index 0 means all image types; skip those installed already. */
+  if( index == 0 )
+  {
+    int installReturnCode = 0;
+    for( IndexType i = 1; i <= NrOfSupportedImageTypes; ++i )
+    {
+      installReturnCode |= this->InstallComponentsLocked( i );
+    }
+    this->m_ComponentsInstalled[ 0 ] = ( installReturnCode == 0 );
+    return installReturnCode;
+  }
+
   elxout << "Installing all components." << std::endl;
 
-  /** Fill the component database */
-  installReturnCode = InstallAllComponents( this->m_ComponentDatabase );
+  /** Fill the component database, and time it. */
+  itk::TimeProbe timer;
+  timer.Start();
+  const int installReturnCode = InstallAllComponents( this->m_ComponentDatabase, index );
+  timer.Stop();
 
   if( installReturnCode )
   {
@@ -166,11 +219,15 @@ ComponentLoader::LoadComponents( const char * /** argv0 */ )
     return installReturnCode;
   }
 
-  elxout << "InstallingComponents was successful.\n" << std::endl;
+  this->m_ComponentsInstalled[ index ] = true;
+
+  elxout << "InstallingComponents was successful (took "
+         << static_cast< unsigned long >( timer.GetMean() * 1000 )
+         << " ms).\n" << std::endl;
 
   return 0;
 
-}   // end LoadComponents
+}   // end InstallComponentsLocked()
 
 
 /**
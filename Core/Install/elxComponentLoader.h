@@ -22,6 +22,8 @@
 #include "elxComponentDatabase.h"
 #include "xoutmain.h"
 
+#include <vector>
+
 namespace elastix
 {
 
@@ -36,6 +38,11 @@ namespace elastix
 *
 * Each new component (a new metric for example should "make itself
 * known" by calling the elxInstallMacro, which is defined in elxMacro.h.
+*
+* The components are installed lazily, per image type combination, which
+* reduces the startup time. They are still compiled for all supported image
+* types, so the binary size and build time are determined by the CMake
+* options ELASTIX_IMAGE_DIMENSIONS and ELASTIX_IMAGE_<N>D_PIXELTYPES.
 */
 
 class ComponentLoader : public itk::Object
@@ -53,17 +60,27 @@ public:
   itkTypeMacro( ComponentLoader, Object );
 
   /** Typedef's. */
-  typedef ComponentDatabase              ComponentDatabaseType;
-  typedef ComponentDatabaseType::Pointer ComponentDatabasePointer;
+  typedef ComponentDatabase                ComponentDatabaseType;
+  typedef ComponentDatabaseType::Pointer   ComponentDatabasePointer;
+  typedef ComponentDatabaseType::IndexType IndexType;
 
   /** Set and get the ComponentDatabase. */
   itkSetObjectMacro( ComponentDatabase, ComponentDatabaseType );
   itkGetObjectMacro( ComponentDatabase, ComponentDatabaseType );
 
   /** Function to load components. The argv0 used to be useful
-   * to find the program directory, but is not used anymore. */
+   * to find the program directory, but is not used anymore.
+   * Only the supported image types are installed here; the components
+   * themselves are installed lazily by InstallComponents(). */
   virtual int LoadComponents( const char * argv0 );
 
+  /** Function to install all components for the image type combination
+   * with the given index in the component database. Components are only
+   * installed the first time an index is requested. An index of 0
+   * installs the components for all supported image types. This function
+   * may be called from several threads. */
+  virtual int InstallComponents( const IndexType index );
+
   /** Function to unload components. */
   virtual void UnloadComponents( void );
 
@@ -78,6 +95,15 @@ protected:
   bool m_ImageTypeSupportInstalled;
   virtual int   InstallSupportedImageTypes( void );
 
+  /** Install the components of an index; the caller holds m_Mutex. */
+  virtual int InstallComponentsLocked( const IndexType index );
+
+  /** For each index, whether its components have been installed. */
+  std::vector< bool > m_ComponentsInstalled;
+
+  /** Serializes InstallComponents(), which updates m_ComponentsInstalled. */
+  itk::SimpleFastMutexLock m_Mutex;
+
 private:
 
   /** Standard private (copy)constructor. */
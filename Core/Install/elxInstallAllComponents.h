@@ -28,8 +28,12 @@
  * the InstallComponent functions implemented by the components. */
 #include "elxInstallComponentFunctionDeclarations.h"
 
+/** Install all components for the image type combination with index
+ * _index in the component database, or for all supported image types
+ * when _index is 0. */
 int
-InstallAllComponents( elx::ComponentDatabase * _cdb )
+InstallAllComponents( elx::ComponentDatabase * _cdb,
+  elx::ComponentDatabase::IndexType _index )
 {
   int ret = 0;
 
@@ -82,11 +82,13 @@
  * IMPORTANT: only one template argument <class TElastix> is allowed. Not more,
  * not less.
  *
- * Details: a function "int _classname##InstallComponent( _cdb )" is defined.
- * In this function a template is defined, _classname##_install<VIndex>.
- * It contains the ElastixTypedef<VIndex>, and recursive function DO(cdb).
- * DO installs the component for all defined ElastixTypedefs (so for all
- * supported image types).
+ * Details: a function "int _classname##InstallComponent( _cdb, _index )" is
+ * defined. In this function a template is defined, _classname##_install<VIndex>.
+ * It contains the ElastixTypedef<VIndex>, and recursive function DO(cdb,index).
+ * DO installs the component for the ElastixTypedef with index _index, or for
+ * all defined ElastixTypedefs (so for all supported image types) when _index
+ * is 0. This allows the ComponentLoader to install the components lazily,
+ * only for the image type that is actually requested.
  *
  */
 #define elxInstallMacro( _classname ) \
@@ -96,12 +98,17 @@
 public: \
     typedef typename::elx::ElastixTypedef< VIndex >::ElastixType ElastixType; \
     typedef::elx::ComponentDatabase::ComponentDescriptionType    ComponentDescriptionType; \
-    static int DO( ::elx::ComponentDatabase * cdb ) \
+    typedef::elx::ComponentDatabase::IndexType                   IndexType; \
+    static int DO( ::elx::ComponentDatabase * cdb, IndexType index ) \
     { \
-      ComponentDescriptionType name  = ::elx::_classname< ElastixType >::elxGetClassNameStatic(); \
-      int                      dummy = ::elx::InstallFunctions< ::elx::_classname< ElastixType > >::InstallComponent( name, VIndex, cdb ); \
-      if( ::elx::ElastixTypedef< VIndex + 1 >::Defined() ) \
-      { return _classname##_install< VIndex + 1 >::DO( cdb ); } \
+      int dummy = 0; \
+      if( index == 0 || index == VIndex ) \
+      { \
+        ComponentDescriptionType name = ::elx::_classname< ElastixType >::elxGetClassNameStatic(); \
+        dummy = ::elx::InstallFunctions< ::elx::_classname< ElastixType > >::InstallComponent( name, VIndex, cdb ); \
+      } \
+      if( ::elx::ElastixTypedef< VIndex + 1 >::Defined() && index != VIndex ) \
+      { return dummy | _classname##_install< VIndex + 1 >::DO( cdb, index ); } \
       return dummy;  \
     } \
   }; \
@@ -109,14 +116,14 @@ public: \
   class _classname##_install< ::elx::NrOfSupportedImageTypes + 1 > \
   { \
 public: \
-    typedef::elx::ComponentDatabase::ComponentDescriptionType ComponentDescriptionType; \
-    static int DO( ::elx::ComponentDatabase * /** cdb */ ) \
+    typedef::elx::ComponentDatabase::IndexType IndexType; \
+    static int DO( ::elx::ComponentDatabase * /** cdb */, IndexType /** index */ ) \
     { return 0; } \
   }; \
   extern "C" int _classname##InstallComponent( \
-  ::elx::ComponentDatabase * _cdb ) \
+  ::elx::ComponentDatabase * _cdb, ::elx::ComponentDatabase::IndexType _index ) \
   { \
-    int _InstallDummy##_classname = _classname##_install< 1 >::DO( _cdb  ); \
+    int _InstallDummy##_classname = _classname##_install< 1 >::DO( _cdb, _index ); \
     return _InstallDummy##_classname; \
   } //ignore semicolon
 
@@ -139,7 +146,7 @@ public: \
  */
 #define elxInstallComponentFunctionDeclarationMacro( _classname ) \
   extern "C" int _classname##InstallComponent( \
-  ::elx::ComponentDatabase * _cdb )
+  ::elx::ComponentDatabase * _cdb, ::elx::ComponentDatabase::IndexType _index )
 
 /**
  * elxInstallComponentFunctionCallMacro
@@ -159,7 +166,7 @@ public: \
  * See also elxInstallAllComponents.h.
  */
 #define elxInstallComponentFunctionCallMacro( _classname ) \
-  ret |= _classname##InstallComponent( _cdb )
+  ret |= _classname##InstallComponent( _cdb, _index )
 
 /**
  * elxPrepareImageTypeSupportMacro
@@ -0,0 +1,356 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __elxAsynchronousStreamBuffer_cxx
+#define __elxAsynchronousStreamBuffer_cxx
+
+#include "elxAsynchronousStreamBuffer.h"
+
+#include <itksys/SystemTools.hxx>
+#include <algorithm>
+#include <cstring>
+
+namespace elastix
+{
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+AsynchronousStreamBuffer::AsynchronousStreamBuffer( std::size_t capacity )
+{
+  this->m_RingBuffer.resize( std::max( capacity, static_cast< std::size_t >( 2 ) ) );
+  this->m_PutArea.resize( 256 );
+  this->m_Head           = 0;
+  this->m_Tail           = 0;
+  this->m_FlushRequested = 0;
+  this->m_StopRequested  = 0;
+  this->m_Stream         = 0;
+  this->m_Target         = 0;
+  this->m_FlushInterval  = 0;
+  this->m_DataCondition  = itk::ConditionVariable::New();
+  this->m_RoomCondition  = itk::ConditionVariable::New();
+  this->m_Threader       = itk::MultiThreader::New();
+  this->m_ThreadID       = 0;
+
+} // end Constructor
+
+
+/**
+ * ********************* Destructor *****************************
+ */
+
+AsynchronousStreamBuffer::~AsynchronousStreamBuffer()
+{
+  this->Detach();
+
+} // end Destructor
+
+
+/**
+ * ************************ Attach ******************************
+ */
+
+bool
+AsynchronousStreamBuffer::Attach( std::ostream & stream )
+{
+  this->Detach();
+
+  /** Take over the original stream buffer as target. */
+  this->m_Target = stream.rdbuf();
+  if( this->m_Target == 0 )
+  {
+    return false;
+  }
+  stream.flush();
+  this->m_Stream = &stream;
+
+  /** Start with empty buffers. */
+  this->m_Head           = 0;
+  this->m_Tail           = 0;
+  this->m_FlushRequested = 0;
+  this->m_StopRequested  = 0;
+  this->setp( &this->m_PutArea[ 0 ], &this->m_PutArea[ 0 ] + this->m_PutArea.size() );
+
+  /** Start the writer thread and redirect the stream. */
+  this->m_ThreadID = this->m_Threader->SpawnThread( WriterThreaderCallback, this );
+  stream.rdbuf( this );
+
+  return true;
+
+} // end Attach()
+
+
+/**
+ * ************************ Detach ******************************
+ */
+
+void
+AsynchronousStreamBuffer::Detach( void )
+{
+  if( this->m_Stream == 0 )
+  {
+    return;
+  }
+
+  /** Hand over the last data, and wait until the writer thread has written it. */
+  this->PushPutArea();
+  this->m_StopRequested = 1;
+  this->SignalWriterThread();
+  this->m_Threader->TerminateThread( this->m_ThreadID );
+
+  /** Restore the stream. */
+  this->m_Stream->rdbuf( this->m_Target );
+  this->m_Stream = 0;
+  this->m_Target = 0;
+  this->setp( 0, 0 );
+
+} // end Detach()
+
+
+/**
+ * ************************ overflow ****************************
+ */
+
+AsynchronousStreamBuffer::int_type
+AsynchronousStreamBuffer::overflow( int_type c )
+{
+  this->PushPutArea();
+  if( !traits_type::eq_int_type( c, traits_type::eof() ) )
+  {
+    *this->pptr() = traits_type::to_char_type( c );
+    this->pbump( 1 );
+  }
+  return traits_type::not_eof( c );
+
+} // end overflow()
+
+
+/**
+ * ************************ xsputn ******************************
+ */
+
+std::streamsize
+AsynchronousStreamBuffer::xsputn( const char_type * s, std::streamsize n )
+{
+  /** Small pieces go to the put area, large pieces directly to the ring buffer. */
+  if( n <= this->epptr() - this->pptr() )
+  {
+    std::memcpy( this->pptr(), s, n * sizeof( char_type ) );
+    this->pbump( static_cast< int >( n ) );
+  }
+  else
+  {
+    this->PushPutArea();
+    this->PushToRingBuffer( s, n );
+  }
+  return n;
+
+} // end xsputn()
+
+
+/**
+ * ************************** sync ******************************
+ */
+
+int
+AsynchronousStreamBuffer::sync( void )
+{
+  this->PushPutArea();
+  this->m_FlushRequested = 1;
+  this->SignalWriterThread();
+  return 0;
+
+} // end sync()
+
+
+/**
+ * ********************** PushPutArea ***************************
+ */
+
+void
+AsynchronousStreamBuffer::PushPutArea( void )
+{
+  if( this->pptr() != this->pbase() )
+  {
+    this->PushToRingBuffer( this->pbase(), this->pptr() - this->pbase() );
+    this->setp( this->pbase(), this->epptr() );
+    this->SignalWriterThread();
+  }
+
+} // end PushPutArea()
+
+
+/**
+ * ******************** PushToRingBuffer ************************
+ */
+
+void
+AsynchronousStreamBuffer::PushToRingBuffer( const char_type * s, std::streamsize n )
+{
+  const int capacity = static_cast< int >( this->m_RingBuffer.size() );
+  int       head     = this->m_Head;
+
+  while( n > 0 )
+  {
+    /** Wait for room. The tail is checked again under the mutex, under
+     * which the writer thread signals that it has moved the tail.
+     */
+    const int tail = this->m_Tail;
+    const int room = ( tail - head - 1 + capacity ) % capacity;
+    if( room == 0 )
+    {
+      this->SignalWriterThread();
+      itk::MutexLockHolder< itk::SimpleMutexLock > holder( this->m_Mutex );
+      while( this->m_Tail == tail )
+      {
+        this->m_RoomCondition->Wait( &this->m_Mutex );
+      }
+      continue;
+    }
+
+    /** Copy as much as fits before the end of the buffer. */
+    const int count = static_cast< int >( std::min< std::streamsize >(
+      n, std::min( room, capacity - head ) ) );
+    std::memcpy( &this->m_RingBuffer[ head ], s, count * sizeof( char_type ) );
+    s   += count;
+    n   -= count;
+    head = ( head + count ) % capacity;
+
+    /** Publish the data to the writer thread. */
+    this->m_Head = head;
+  }
+
+} // end PushToRingBuffer()
+
+
+/**
+ * ******************* SignalWriterThread ***********************
+ */
+
+void
+AsynchronousStreamBuffer::SignalWriterThread( void )
+{
+  itk::MutexLockHolder< itk::SimpleMutexLock > holder( this->m_Mutex );
+  this->m_DataCondition->Signal();
+
+} // end SignalWriterThread()
+
+
+/**
+ * ******************** PopFromRingBuffer ***********************
+ */
+
+bool
+AsynchronousStreamBuffer::PopFromRingBuffer( void )
+{
+  const int capacity = static_cast< int >( this->m_RingBuffer.size() );
+  const int head     = this->m_Head;
+  int       tail     = this->m_Tail;
+  if( head == tail )
+  {
+    return false;
+  }
+
+  /** Write the data up to the head, in at most two pieces. */
+  while( tail != head )
+  {
+    const int end = ( head > tail ) ? head : capacity;
+    this->m_Target->sputn( &this->m_RingBuffer[ tail ], end - tail );
+    tail = end % capacity;
+
+    /** Give the room back to the producer. */
+    this->m_Tail = tail;
+  }
+
+  /** Wake up the producer, in case it waits for room. */
+  itk::MutexLockHolder< itk::SimpleMutexLock > holder( this->m_Mutex );
+  this->m_RoomCondition->Signal();
+
+  return true;
+
+} // end PopFromRingBuffer()
+
+
+/**
+ * ***************** WriterThreaderCallback *********************
+ */
+
+ITK_THREAD_RETURN_TYPE
+AsynchronousStreamBuffer::WriterThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  Self *           self       = static_cast< Self * >( infoStruct->UserData );
+
+  double lastFlushTime = itksys::SystemTools::GetTime();
+  while( true )
+  {
+    /** Wait for data, a flush request, or the stop request. The producer
+     * signals under the mutex after publishing any of them.
+     */
+    {
+      itk::MutexLockHolder< itk::SimpleMutexLock > holder( self->m_Mutex );
+      while( self->m_Head == self->m_Tail && self->m_StopRequested == 0
+        && ( self->m_FlushInterval < 0 || self->m_FlushRequested == 0 ) )
+      {
+        self->m_DataCondition->Wait( &self->m_Mutex );
+      }
+    }
+
+    /** Read the stop flag first, so that all data written before
+     * the stop request is also written below.
+     */
+    const bool stop    = self->m_StopRequested != 0;
+    const bool written = self->PopFromRingBuffer();
+
+    /** Flush the target, according to the flush interval. A flush that is
+     * not due yet is waited for, unless there is more data to write.
+     */
+    if( self->m_FlushInterval >= 0 && self->m_FlushRequested != 0 )
+    {
+      const double now     = itksys::SystemTools::GetTime();
+      const double elapsed = ( now - lastFlushTime ) * 1000.0;
+      if( elapsed >= self->m_FlushInterval )
+      {
+        self->m_FlushRequested = 0;
+        self->m_Target->pubsync();
+        lastFlushTime = now;
+      }
+      else if( !written && !stop )
+      {
+        itksys::SystemTools::Delay(
+          static_cast< unsigned int >( self->m_FlushInterval - elapsed ) + 1 );
+      }
+    }
+
+    if( stop && self->m_Head == self->m_Tail )
+    {
+      break;
+    }
+  }
+
+  /** Always flush at the end. */
+  self->m_Target->pubsync();
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end WriterThreaderCallback()
+
+
+} // end namespace elastix
+
+#endif // end #ifndef __elxAsynchronousStreamBuffer_cxx
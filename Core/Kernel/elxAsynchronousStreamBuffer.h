@@ -0,0 +1,166 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __elxAsynchronousStreamBuffer_h
+#define __elxAsynchronousStreamBuffer_h
+
+#include "itkMultiThreader.h"
+#include "itkAtomicInt.h"
+#include "itkMutexLock.h"
+#include "itkConditionVariable.h"
+
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+namespace elastix
+{
+
+/**
+ * \class AsynchronousStreamBuffer
+ * \brief A stream buffer that passes its data to another stream buffer
+ * in a background thread.
+ *
+ * Attach() replaces the stream buffer of a stream, like the log file,
+ * by this one. Everything that is written to the stream is then copied
+ * into a ring buffer, with one producer (the thread that writes to the
+ * stream) and one consumer (a writer thread, which passes the data to the
+ * original stream buffer). Detach() writes the remaining data, stops the
+ * writer thread, and restores the original stream buffer. It has to be
+ * called explicitly before the stream is closed, and before the end of
+ * main(); the buffer should therefore not be a static object.
+ *
+ * Flushing the stream, for example with std::endl, never waits for the
+ * writer thread. Instead, it requests the writer thread to flush the
+ * original stream buffer, according to the FlushInterval (in ms):
+ * \li FlushInterval < 0: only flush when detaching.
+ * \li FlushInterval = 0: flush as soon as the requested data is written.
+ * \li FlushInterval > 0: flush at most once per FlushInterval.
+ *
+ * The writer thread waits on a condition variable until data or a flush
+ * request arrives. When the ring buffer is full, writing to the stream
+ * waits on a condition variable until the writer thread has made room, so
+ * no data is lost. Only a single thread may write to the stream, so it
+ * should not be attached to a stream that is shared with other code, like
+ * std::cout. For the log file of elastix this holds, since it is only
+ * written by xout.
+ *
+ * \ingroup Kernel
+ */
+
+class AsynchronousStreamBuffer : public std::streambuf
+{
+public:
+
+  /** Standard typedefs. */
+  typedef AsynchronousStreamBuffer Self;
+  typedef std::streambuf           Superclass;
+
+  typedef Superclass::char_type   char_type;
+  typedef Superclass::int_type    int_type;
+  typedef Superclass::traits_type traits_type;
+
+  /** Constructor, taking the capacity of the ring buffer in bytes. */
+  AsynchronousStreamBuffer( std::size_t capacity = 1 << 20 );
+
+  /** Destructor, which detaches the buffer if still needed. */
+  virtual ~AsynchronousStreamBuffer();
+
+  /** Set/Get the flush interval in ms. Default: 0. */
+  void SetFlushInterval( int flushInterval ) { this->m_FlushInterval = flushInterval; }
+  int GetFlushInterval( void ) const { return this->m_FlushInterval; }
+
+  /** Redirect the stream through this buffer and start the writer thread.
+   * Returns false if the stream has no stream buffer.
+   */
+  bool Attach( std::ostream & stream );
+
+  /** Write all data, stop the writer thread and restore the stream. */
+  void Detach( void );
+
+  /** Whether a stream is redirected through this buffer. */
+  bool IsAttached( void ) const { return this->m_Stream != 0; }
+
+protected:
+
+  /** Called when the put area is full. */
+  virtual int_type overflow( int_type c );
+
+  /** Write a sequence of characters. */
+  virtual std::streamsize xsputn( const char_type * s, std::streamsize n );
+
+  /** Called when the stream is flushed. */
+  virtual int sync( void );
+
+private:
+
+  AsynchronousStreamBuffer( const Self & ); // purposely not implemented
+  void operator=( const Self & );           // purposely not implemented
+
+  typedef itk::MultiThreader::ThreadInfoStruct ThreadInfoType;
+
+  /** The function that is executed by the writer thread. */
+  static ITK_THREAD_RETURN_TYPE WriterThreaderCallback( void * arg );
+
+  /** Producer side: copy data into the ring buffer, waiting for room if needed. */
+  void PushToRingBuffer( const char_type * s, std::streamsize n );
+
+  /** Producer side: move the contents of the put area to the ring buffer. */
+  void PushPutArea( void );
+
+  /** Producer side: wake up the writer thread. */
+  void SignalWriterThread( void );
+
+  /** Consumer side: pass the data in the ring buffer to the target.
+   * Returns whether any data was written.
+   */
+  bool PopFromRingBuffer( void );
+
+  /** The ring buffer. m_Head is only changed by the producer,
+   * m_Tail only by the consumer. One byte is always kept free to
+   * distinguish a full from an empty buffer. The data itself is copied
+   * without holding the mutex.
+   */
+  std::vector< char_type > m_RingBuffer;
+  itk::AtomicInt< int >    m_Head;
+  itk::AtomicInt< int >    m_Tail;
+
+  /** Flags to communicate with the writer thread. */
+  itk::AtomicInt< int > m_FlushRequested;
+  itk::AtomicInt< int > m_StopRequested;
+
+  /** The mutex and conditions to wait for data and for room. */
+  itk::SimpleMutexLock            m_Mutex;
+  itk::ConditionVariable::Pointer m_DataCondition;
+  itk::ConditionVariable::Pointer m_RoomCondition;
+
+  /** A small put area, to avoid a call per character. */
+  std::vector< char_type > m_PutArea;
+
+  /** The redirected stream and its original stream buffer. */
+  std::ostream *   m_Stream;
+  std::streambuf * m_Target;
+
+  int                         m_FlushInterval;
+  itk::MultiThreader::Pointer m_Threader;
+  itk::ThreadIdType           m_ThreadID;
+
+};
+
+} // end namespace elastix
+
+#endif // end #ifndef __elxAsynchronousStreamBuffer_h
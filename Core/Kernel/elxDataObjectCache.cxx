@@ -0,0 +1,113 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "elxDataObjectCache.h"
+#include "itkMutexLockHolder.h"
+
+#include <sstream>
+
+namespace elastix
+{
+
+/**
+ * ********************* MakeKey *********************
+ */
+
+std::string
+DataObjectCache
+::MakeKey( const std::string & name,
+  unsigned int elastixLevel, unsigned int level )
+{
+  std::ostringstream key;
+  key << name << "." << elastixLevel << ".R" << level;
+  return key.str();
+
+} // end MakeKey()
+
+
+/**
+ * ********************* GetDataObject *********************
+ */
+
+DataObjectCache::DataObjectPointer
+DataObjectCache
+::GetDataObject( const std::string & key ) const
+{
+  itk::MutexLockHolder< itk::SimpleFastMutexLock > holder( this->m_Mutex );
+
+  DataObjectMapType::const_iterator it = this->m_DataObjects.find( key );
+  if( it == this->m_DataObjects.end() )
+  {
+    return 0;
+  }
+  return it->second;
+
+} // end GetDataObject()
+
+
+/**
+ * ********************* AddDataObject *********************
+ */
+
+DataObjectCache::DataObjectPointer
+DataObjectCache
+::AddDataObject( const std::string & key, DataObjectType * object )
+{
+  itk::MutexLockHolder< itk::SimpleFastMutexLock > holder( this->m_Mutex );
+
+  /** Keep the object of the registration that was first. */
+  DataObjectPointer & stored = this->m_DataObjects[ key ];
+  if( stored.IsNull() )
+  {
+    stored = object;
+  }
+  return stored;
+
+} // end AddDataObject()
+
+
+/**
+ * ********************* GetNumberOfDataObjects *********************
+ */
+
+unsigned long
+DataObjectCache
+::GetNumberOfDataObjects( void ) const
+{
+  itk::MutexLockHolder< itk::SimpleFastMutexLock > holder( this->m_Mutex );
+  return this->m_DataObjects.size();
+
+} // end GetNumberOfDataObjects()
+
+
+/**
+ * ********************* PrintSelf *********************
+ */
+
+void
+DataObjectCache
+::PrintSelf( std::ostream & os, itk::Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "NumberOfDataObjects: " << this->GetNumberOfDataObjects() << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace elastix
@@ -0,0 +1,107 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __elxDataObjectCache_h
+#define __elxDataObjectCache_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkDataObject.h"
+#include "itkSimpleFastMutexLock.h"
+
+#include <map>
+#include <string>
+
+namespace elastix
+{
+
+/**
+ * \class DataObjectCache
+ * \brief A thread-safe map from strings to data objects, which registrations
+ * use to share data that only depends on their fixed images, masks and
+ * parameter maps.
+ *
+ * The ElastixFilter creates a cache for the jobs of a batch and for the
+ * starts of a multi-start registration, which all have the same fixed images,
+ * masks and parameter maps. The first registration that computes an object,
+ * like the fixed image pyramid or an eroded mask of a resolution, stores it;
+ * the others get it instead of computing it again. The keys are made with
+ * MakeKey(), from a name, the elastix level and the resolution. The objects
+ * are shared by registrations that may run at the same time, so they should
+ * not be modified after they are stored, and should not be connected to a
+ * pipeline.
+ *
+ * \ingroup Kernel
+ */
+
+class DataObjectCache : public itk::Object
+{
+public:
+
+  /** Standard ITK typedefs. */
+  typedef DataObjectCache                 Self;
+  typedef itk::Object                     Superclass;
+  typedef itk::SmartPointer< Self >       Pointer;
+  typedef itk::SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( DataObjectCache, itk::Object );
+
+  /** Typedefs. */
+  typedef itk::DataObject         DataObjectType;
+  typedef DataObjectType::Pointer DataObjectPointer;
+
+  /** Make a key from a name, the elastix level and the resolution. */
+  static std::string MakeKey( const std::string & name,
+    unsigned int elastixLevel, unsigned int level );
+
+  /** Get the object that is stored under a key, or 0 if there is none. */
+  DataObjectPointer GetDataObject( const std::string & key ) const;
+
+  /** Store an object under a key, unless another registration stored an
+   * object under it first. Returns the object that is stored under the key.
+   */
+  DataObjectPointer AddDataObject( const std::string & key, DataObjectType * object );
+
+  /** Get the number of stored objects. */
+  unsigned long GetNumberOfDataObjects( void ) const;
+
+protected:
+
+  DataObjectCache() {}
+  virtual ~DataObjectCache() {}
+
+  void PrintSelf( std::ostream & os, itk::Indent indent ) const;
+
+private:
+
+  DataObjectCache( const Self & );  // purposely not implemented
+  void operator=( const Self & );   // purposely not implemented
+
+  typedef std::map< std::string, DataObjectPointer > DataObjectMapType;
+
+  DataObjectMapType                m_DataObjects;
+  mutable itk::SimpleFastMutexLock m_Mutex;
+
+};
+
+} // end namespace elastix
+
+#endif // end #ifndef __elxDataObjectCache_h
@@ -17,7 +17,7 @@
  *=========================================================================*/
 #include "elxElastixBase.h"
 #include <sstream>
-#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include <cmath>
 
 namespace elastix
 {
@@ -61,6 +61,10 @@ ElastixBase::ElastixBase()
 
   this->m_ResultImageContainer = DataObjectContainerType::New();
 
+  /** No shared data, and a random generator of its own. */
+  this->m_DataObjectCache = 0;
+  this->m_RandomGenerator = RandomGeneratorType::New();
+
   /** Initialize initialTransform and final transform. */
   this->m_InitialTransform = 0;
   this->m_FinalTransform   = 0;
@@ -69,6 +73,11 @@ ElastixBase::ElastixBase()
    * backward compatability. From Elastix 4.8: set it to true by default.*/
   this->m_UseDirectionCosines = true;
 
+  /** No metric values at the end of each resolution, and no pruning. */
+  this->m_ComputeResolutionMetricValues = false;
+  this->m_PruningMargin                 = 0.1;
+  this->m_Pruned                        = false;
+
 } // end Constructor
 
 
@@ -238,12 +247,10 @@ ElastixBase::BeforeAllBase( void )
    * the default in the MersenneTwister code.
    * Use silent parameter file readout, to avoid annoying warning when
    * starting elastix */
-  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
-  typedef RandomGeneratorType::IntegerType                       SeedType;
+  typedef RandomGeneratorType::IntegerType SeedType;
   unsigned int randomSeed = 121212;
   this->GetConfiguration()->ReadParameter( randomSeed, "RandomSeed", 0, false );
-  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
-  randomGenerator->SetSeed( static_cast< SeedType >( randomSeed ) );
+  this->m_RandomGenerator->SetSeed( static_cast< SeedType >( randomSeed ) );
 
   /** Return a value. */
   return returndummy;
@@ -490,4 +497,118 @@ ElastixBase::GetOriginalFixedImageDirectionFlat( void ) const
 }
 
 
+/**
+ * ******************** SetComputeResolutionMetricValues ********************
+ */
+
+void
+ElastixBase::SetComputeResolutionMetricValues( bool _arg )
+{
+  this->m_ComputeResolutionMetricValues = _arg;
+}
+
+
+/**
+ * ******************** GetComputeResolutionMetricValues ********************
+ */
+
+bool
+ElastixBase::GetComputeResolutionMetricValues( void ) const
+{
+  return this->m_ComputeResolutionMetricValues;
+}
+
+
+/**
+ * ******************** GetResolutionMetricValues ********************
+ */
+
+const ElastixBase::ResolutionMetricValuesType &
+ElastixBase::GetResolutionMetricValues( void ) const
+{
+  return this->m_ResolutionMetricValues;
+}
+
+
+/**
+ * ******************** SetPruningReferenceMetricValues ********************
+ */
+
+void
+ElastixBase::SetPruningReferenceMetricValues(
+  const ResolutionMetricValuesType & values )
+{
+  this->m_PruningReferenceMetricValues = values;
+}
+
+
+/**
+ * ******************** GetPruningReferenceMetricValues ********************
+ */
+
+const ElastixBase::ResolutionMetricValuesType &
+ElastixBase::GetPruningReferenceMetricValues( void ) const
+{
+  return this->m_PruningReferenceMetricValues;
+}
+
+
+/**
+ * ******************** SetPruningMargin ********************
+ */
+
+void
+ElastixBase::SetPruningMargin( double _arg )
+{
+  this->m_PruningMargin = _arg;
+}
+
+
+/**
+ * ******************** GetPruningMargin ********************
+ */
+
+double
+ElastixBase::GetPruningMargin( void ) const
+{
+  return this->m_PruningMargin;
+}
+
+
+/**
+ * ******************** GetPruned ********************
+ */
+
+bool
+ElastixBase::GetPruned( void ) const
+{
+  return this->m_Pruned;
+}
+
+
+/**
+ * ******************** AddResolutionMetricValue ********************
+ */
+
+bool
+ElastixBase::AddResolutionMetricValue( double value )
+{
+  const std::size_t resolution = this->m_ResolutionMetricValues.size();
+  this->m_ResolutionMetricValues.push_back( value );
+
+  /** Compare with the reference value of the same resolution. */
+  if( resolution < this->m_PruningReferenceMetricValues.size() )
+  {
+    const double reference = this->m_PruningReferenceMetricValues[ resolution ];
+    if( value > reference + this->m_PruningMargin * std::abs( reference ) )
+    {
+      this->m_Pruned = true;
+    }
+  }
+
+  return this->m_Pruned;
+
+} // end AddResolutionMetricValue()
+
+
 } // end namespace elastix
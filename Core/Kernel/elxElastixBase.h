@@ -31,12 +31,15 @@
 #include "elxBaseComponent.h"
 #include "elxComponentDatabase.h"
 #include "elxConfiguration.h"
+#include "elxDataObjectCache.h"
 #include "itkObject.h"
 #include "itkDataObject.h"
 #include "elxMacro.h"
 #include "xoutmain.h"
 #include "itkVectorContainer.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
 #include "itkImageFileReader.h"
+#include "itkChunkedMetaImageIO.h"
 #include "itkChangeInformationImageFilter.h"
 
 #include <fstream>
@@ -170,6 +173,13 @@ public:
   typedef ComponentDatabaseType::Pointer   ComponentDatabasePointer;
   typedef ComponentDatabaseType::IndexType DBIndexType;
   typedef std::vector< double >            FlatDirectionCosinesType;
+  typedef std::vector< double >            ResolutionMetricValuesType;
+  typedef DataObjectCache                  DataObjectCacheType;
+  typedef DataObjectCacheType::Pointer     DataObjectCachePointer;
+
+  /** The type of the random number generator of a registration. */
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+  typedef RandomGeneratorType::Pointer                           RandomGeneratorPointer;
 
   /** Typedef that is used in the elastix dll version. */
   typedef itk::ParameterMapInterface::ParameterMapType ParameterMapType;
@@ -252,6 +262,21 @@ public:
   elxGetObjectMacro( ResultImageContainer, DataObjectContainerType );
   elxSetObjectMacro( ResultImageContainer, DataObjectContainerType );
 
+  /** Set/Get the cache of data that only depends on the fixed images, the
+   * masks and the parameter maps, like the fixed image pyramid and the eroded
+   * masks. It is shared by registrations for which these are the same, such
+   * as the jobs of a batch. Default: 0, i.e. no cache.
+   */
+  elxGetObjectMacro( DataObjectCache, DataObjectCacheType );
+  elxSetObjectMacro( DataObjectCache, DataObjectCacheType );
+
+  /** Get the random number generator of this registration. The components
+   * draw their random numbers from it, instead of from the global instance,
+   * so that registrations can run at the same time. It is seeded with the
+   * parameter RandomSeed in BeforeAllBase().
+   */
+  elxGetObjectMacro( RandomGenerator, RandomGeneratorType );
+
   /** Set/Get The Image FileName containers.
    * Normally, these are filled in the BeforeAllBase function.
    */
@@ -350,6 +375,39 @@ public:
 
   virtual const FlatDirectionCosinesType & GetOriginalFixedImageDirectionFlat( void ) const;
 
+  /** Set/Get whether the metric value is computed at the end of each
+   * resolution. This costs one extra metric evaluation per resolution.
+   * It is needed for the pruning of multi-start registrations. With a data
+   * object cache, the value is computed on the pruning samples that are
+   * shared by all registrations, see ImageSamplerBase::SelectPruningSamples().
+   * Default: false.
+   */
+  virtual void SetComputeResolutionMetricValues( bool _arg );
+
+  virtual bool GetComputeResolutionMetricValues( void ) const;
+
+  /** Get the metric values computed at the end of each resolution. */
+  virtual const ResolutionMetricValuesType & GetResolutionMetricValues( void ) const;
+
+  /** Set/Get the metric values at the end of each resolution of a reference
+   * registration, such as the best start of a multi-start registration that
+   * finished before this one started.
+   * When the metric value at the end of resolution r exceeds reference value r
+   * by more than PruningMargin * |reference value|, the remaining resolutions
+   * are skipped and GetPruned() returns true. Metric values are assumed to be
+   * minimized. An empty vector (the default) disables pruning.
+   */
+  virtual void SetPruningReferenceMetricValues( const ResolutionMetricValuesType & values );
+
+  virtual const ResolutionMetricValuesType & GetPruningReferenceMetricValues( void ) const;
+
+  virtual void SetPruningMargin( double _arg );
+
+  virtual double GetPruningMargin( void ) const;
+
+  /** Get whether the registration was pruned. */
+  virtual bool GetPruned( void ) const;
+
   /** Creates transformation parameters map. */
   virtual void CreateTransformParametersMap( void ) = 0;
 
@@ -370,6 +428,12 @@ protected:
 
   FlatDirectionCosinesType m_OriginalFixedImageDirection;
 
+  /** Store the metric value at the end of the current resolution, and compare
+   * it with the pruning reference. Returns true if the registration should be
+   * pruned, in which case GetPruned() returns true from then on.
+   */
+  virtual bool AddResolutionMetricValue( double value );
+
   /** Convenient mini class to load the files specified by a filename container
    * The function GenerateImageContainer can be used without instantiating an
    * object of this class, since it is static. It has 2 arguments: the
@@ -407,6 +471,13 @@ public:
         /** Setup reader. */
         ImageReaderPointer imageReader = ImageReaderType::New();
         imageReader->SetFileName( fileNameContainer->ElementAt( i ).c_str() );
+
+        /** Decompress the chunks of a chunked compressed MetaImage in parallel. */
+        itk::ChunkedMetaImageIO::Pointer metaImageIO = itk::ChunkedMetaImageIO::New();
+        if( metaImageIO->CanReadFile( fileNameContainer->ElementAt( i ).c_str() ) )
+        {
+          imageReader->SetImageIO( metaImageIO );
+        }
         ChangeInfoFilterPointer infoChanger = ChangeInfoFilterType::New();
         DirectionType           direction;
         direction.SetIdentity();
@@ -525,6 +596,12 @@ private:
   /** The result image container. These are stored as pointers to itk::DataObject. */
   DataObjectContainerPointer m_ResultImageContainer;
 
+  /** The cache of data shared with other registrations. */
+  DataObjectCachePointer m_DataObjectCache;
+
+  /** The random number generator. */
+  RandomGeneratorPointer m_RandomGenerator;
+
   /** The image and mask FileNameContainers. */
   FileNameContainerPointer m_FixedImageFileNameContainer;
   FileNameContainerPointer m_MovingImageFileNameContainer;
@@ -538,6 +615,13 @@ private:
   /** Use or ignore direction cosines. */
   bool m_UseDirectionCosines;
 
+  /** The metric values at the end of each resolution, and pruning. */
+  bool                       m_ComputeResolutionMetricValues;
+  ResolutionMetricValuesType m_ResolutionMetricValues;
+  ResolutionMetricValuesType m_PruningReferenceMetricValues;
+  double                     m_PruningMargin;
+  bool                       m_Pruned;
+
   /** Read a series of command line options that satisfy the following syntax:
    * {-f,-f0} \<filename0\> [-f1 \<filename1\> [ -f2 \<filename2\> ... ] ]
    *
@@ -27,7 +27,10 @@
 #include "elxElastixMain.h"
 
 #include "elxMacro.h"
+#include "elxAsynchronousStreamBuffer.h"
 #include "itkMultiThreader.h"
+#include "itkSimpleFastMutexLock.h"
+#include "itkMutexLockHolder.h"
 
 #ifdef ELASTIX_USE_OPENCL
 #include "itkOpenCLSetup.h"
@@ -56,6 +59,12 @@ xoutsimple_type g_CoutOnlyXout;
 xoutsimple_type g_LogOnlyXout;
 std::ofstream   g_LogFileStream;
 
+/** Asynchronous writer for the logfile. It is created and deleted by
+ * xoutSetAsynchronous, and not a static object, so that its writer thread
+ * is never joined by a static destructor.
+ */
+AsynchronousStreamBuffer * g_AsynchronousLogFileBuffer = 0;
+
 /**
  * ********************* xoutSetup ******************************
  *
@@ -72,6 +81,9 @@ xoutSetup( const char * logfilename, bool setupLogging, bool setupCout )
   int returndummy = 0;
   set_xout( &g_xout );
 
+  /** Write everything of a previous run, before touching the streams. */
+  xoutSetAsynchronous( false, 0 );
+
   if( setupLogging )
   {
     /** Open the logfile for writing. */
@@ -123,6 +135,98 @@ xoutSetup( const char * logfilename, bool setupLogging, bool setupCout )
 } // end xoutSetup()
 
 
+/**
+ * ****************** xoutSetAsynchronous ***********************
+ *
+ * NB: this function is a global function, not part of the ElastixMain
+ * class!!
+ */
+
+int
+xoutSetAsynchronous( bool asynchronous, int flushInterval )
+{
+  /** Always start from the synchronous situation. Deleting the buffer
+   * writes the remaining data and stops the writer thread.
+   */
+  delete g_AsynchronousLogFileBuffer;
+  g_AsynchronousLogFileBuffer = 0;
+  if( !asynchronous || !g_LogFileStream.is_open() )
+  {
+    return 0;
+  }
+
+  /** Redirect the logfile through a writer thread. std::cout is left
+   * alone, since other code and other threads write to it as well.
+   */
+  g_AsynchronousLogFileBuffer = new AsynchronousStreamBuffer;
+  g_AsynchronousLogFileBuffer->SetFlushInterval( flushInterval );
+  if( !g_AsynchronousLogFileBuffer->Attach( g_LogFileStream ) )
+  {
+    delete g_AsynchronousLogFileBuffer;
+    g_AsynchronousLogFileBuffer = 0;
+    return 1;
+  }
+
+  return 0;
+
+} // end xoutSetAsynchronous()
+
+
+/**
+ * ****************** xoutThreadSetup ***************************
+ */
+
+xoutThreadSetup::xoutThreadSetup( std::ostream & logStream, std::ostream & coutStream )
+{
+  /** Send output to the streams that correspond to the outputs of the
+   * shared xout, as configured by xoutSetup.
+   */
+  const xoutbase_type::CStreamMapType & sharedOutputs = xout.GetCOutputs();
+  if( sharedOutputs.find( "log" ) != sharedOutputs.end() )
+  {
+    this->m_Xout.AddOutput( "log", &logStream );
+  }
+  if( sharedOutputs.find( "cout" ) != sharedOutputs.end() )
+  {
+    this->m_Xout.AddOutput( "cout", &coutStream );
+  }
+  this->m_LogOnlyXout.AddOutput( "log", &logStream );
+  this->m_CoutOnlyXout.AddOutput( "cout", &coutStream );
+
+  this->m_WarningXout.SetOutputs( this->m_Xout.GetCOutputs() );
+  this->m_ErrorXout.SetOutputs( this->m_Xout.GetCOutputs() );
+  this->m_StandardXout.SetOutputs( this->m_Xout.GetCOutputs() );
+
+  this->m_Xout.AddTargetCell( "warning", &this->m_WarningXout );
+  this->m_Xout.AddTargetCell( "error", &this->m_ErrorXout );
+  this->m_Xout.AddTargetCell( "standard", &this->m_StandardXout );
+  this->m_Xout.AddTargetCell( "logonly", &this->m_LogOnlyXout );
+  this->m_Xout.AddTargetCell( "coutonly", &this->m_CoutOnlyXout );
+
+  this->m_Xout[ "standard" ] << std::fixed;
+  this->m_Xout[ "standard" ] << std::showpoint;
+
+  set_thread_xout( &this->m_Xout );
+
+} // end xoutThreadSetup()
+
+
+xoutThreadSetup::~xoutThreadSetup()
+{
+  set_thread_xout( 0 );
+
+} // end ~xoutThreadSetup()
+
+
+void
+xoutThreadSetup::WriteToSharedXout( const std::string & logText, const std::string & coutText )
+{
+  xout[ "logonly" ] << logText << std::flush;
+  xout[ "coutonly" ] << coutText << std::flush;
+
+} // end WriteToSharedXout()
+
+
 /**
  * ********************* Constructor ****************************
  */
@@ -149,11 +253,16 @@ ElastixMain::ElastixMain()
   this->m_MovingMaskContainer = 0;
 
   this->m_ResultImageContainer = 0;
+  this->m_DataObjectCache      = 0;
 
   this->m_FinalTransform   = 0;
   this->m_InitialTransform = 0;
   this->m_TransformParametersMap.clear();
 
+  this->m_ComputeResolutionMetricValues = false;
+  this->m_PruningMargin                 = 0.1;
+  this->m_Pruned                        = false;
+
 } // end Constructor
 
 
@@ -164,6 +273,10 @@ ElastixMain::ElastixMain()
 ElastixMain::ComponentDatabasePointer ElastixMain::s_CDB             = 0;
 ElastixMain::ComponentLoaderPointer   ElastixMain::s_ComponentLoader = 0;
 
+/** Serializes the creation of the component database and loader, which may
+ * be requested by several ElastixFilter instances at the same time. */
+static itk::SimpleFastMutexLock ComponentLoaderMutex;
+
 /**
  * ********************** Destructor ****************************
  */
@@ -267,6 +380,7 @@ ElastixMain::Run( void )
   /** Set process properties. */
   this->SetProcessPriority();
   this->SetMaximumNumberOfThreads();
+  this->SetAsynchronousLogging();
 
   /** Initialize database. */
   int errorCode = this->InitDBIndex();
@@ -379,6 +493,9 @@ ElastixMain::Run( void )
   this->GetElastixBase()->SetMovingMaskContainer( this->GetMovingMaskContainer() );
   this->GetElastixBase()->SetResultImageContainer( this->GetResultImageContainer() );
 
+  /** Set the cache of data shared with other registrations, if it happens to be there. */
+  this->GetElastixBase()->SetDataObjectCache( this->GetDataObjectCache() );
+
   /** Set the initial transform, if it happens to be there. */
   this->GetElastixBase()->SetInitialTransform( this->GetInitialTransform() );
 
@@ -388,6 +505,13 @@ ElastixMain::Run( void )
   this->GetElastixBase()->SetOriginalFixedImageDirectionFlat(
     this->GetOriginalFixedImageDirectionFlat() );
 
+  /** Set the metric values of a reference registration, for pruning. */
+  this->GetElastixBase()->SetComputeResolutionMetricValues(
+    this->GetComputeResolutionMetricValues() );
+  this->GetElastixBase()->SetPruningReferenceMetricValues(
+    this->GetPruningReferenceMetricValues() );
+  this->GetElastixBase()->SetPruningMargin( this->GetPruningMargin() );
+
   /** Run elastix! */
   try
   {
@@ -431,6 +555,10 @@ ElastixMain::Run( void )
   this->SetOriginalFixedImageDirectionFlat(
     this->GetElastixBase()->GetOriginalFixedImageDirectionFlat() );
 
+  /** Store the metric values at the end of each resolution. */
+  this->m_ResolutionMetricValues = this->GetElastixBase()->GetResolutionMetricValues();
+  this->m_Pruned                 = this->GetElastixBase()->GetPruned();
+
   /** Return a value. */
   return errorCode;
 
@@ -659,6 +787,17 @@ ElastixMain::InitDBIndex( void )
         xout[ "error" ] << "Something went wrong in the ComponentDatabase" << std::endl;
         return 1;
       }
+
+      /** Install the components for this image type, if not done already. */
+      if( this->s_ComponentLoader.IsNotNull() )
+      {
+        int installReturnCode = this->s_ComponentLoader->InstallComponents( this->m_DBIndex );
+        if( installReturnCode != 0 )
+        {
+          xout[ "error" ] << "Installing components failed" << std::endl;
+          return installReturnCode;
+        }
+      }
     } // end if s_CDB!=0
 
   } // end if m_Configuration->Initialized();
@@ -737,6 +876,8 @@ ElastixMain::GetTotalNumberOfElastixLevels( void )
 int
 ElastixMain::LoadComponents( void )
 {
+  itk::MutexLockHolder< itk::SimpleFastMutexLock > holder( ComponentLoaderMutex );
+
   /** Create a ComponentDatabase. */
   if( this->s_CDB.IsNull() )
   {
@@ -986,6 +1127,30 @@ ElastixMain::SetMaximumNumberOfThreads( void ) const
 } // end SetMaximumNumberOfThreads()
 
 
+/**
+ * *********************** SetAsynchronousLogging *************************
+ */
+
+void
+ElastixMain::SetAsynchronousLogging( void ) const
+{
+  /** Get the flush interval from the command line. */
+  std::string flushIntervalString
+    = this->m_Configuration->GetCommandLineArgument( "-asynclog" );
+
+  /** If supplied, write the log and console output in a separate thread. */
+  if( flushIntervalString != "" )
+  {
+    const int flushInterval = atoi( flushIntervalString.c_str() );
+    if( xoutSetAsynchronous( true, flushInterval ) )
+    {
+      xl::xout[ "warning" ]
+        << "WARNING: asynchronous logging could not be enabled." << std::endl;
+    }
+  }
+} // end SetAsynchronousLogging()
+
+
 /**
  * ******************** SetOriginalFixedImageDirectionFlat ********************
  */
@@ -1009,6 +1174,40 @@ ElastixMain::GetOriginalFixedImageDirectionFlat( void ) const
 } // end GetOriginalFixedImageDirectionFlat()
 
 
+/**
+ * ******************** SetPruningReferenceMetricValues ********************
+ */
+
+void
+ElastixMain::SetPruningReferenceMetricValues(
+  const ResolutionMetricValuesType & arg )
+{
+  this->m_PruningReferenceMetricValues = arg;
+} // end SetPruningReferenceMetricValues()
+
+
+/**
+ * ******************** GetPruningReferenceMetricValues ********************
+ */
+
+const ElastixMain::ResolutionMetricValuesType &
+ElastixMain::GetPruningReferenceMetricValues( void ) const
+{
+  return this->m_PruningReferenceMetricValues;
+} // end GetPruningReferenceMetricValues()
+
+
+/**
+ * ******************** GetResolutionMetricValues ********************
+ */
+
+const ElastixMain::ResolutionMetricValuesType &
+ElastixMain::GetResolutionMetricValues( void ) const
+{
+  return this->m_ResolutionMetricValues;
+} // end GetResolutionMetricValues()
+
+
 /**
  * ******************** GetTransformParametersMap ********************
  */
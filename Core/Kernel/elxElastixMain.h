@@ -54,6 +54,57 @@ namespace elastix
  */
 extern int xoutSetup( const char * logfilename, bool setupLogging, bool setupCout );
 
+/**
+ * function xoutSetAsynchronous
+ * Write the logfile, as set up by xoutSetup, in a background thread, such
+ * that writing and flushing do not stall the registration. std::cout is
+ * still written synchronously. A flushInterval (in ms) below 0 only flushes
+ * at the end, 0 flushes as soon as possible, and larger values flush at
+ * most once per interval. Call with asynchronous = false to write the
+ * remaining data and write synchronously again; this has to be done before
+ * the end of main().
+ *
+ * It returns 0 if everything went ok. 1 otherwise.
+ */
+extern int xoutSetAsynchronous( bool asynchronous, int flushInterval );
+
+/**
+ * \class xoutThreadSetup
+ * \brief Gives the calling thread its own xout, while the object exists.
+ *
+ * The xout of the thread has the same fields as the one of xoutSetup.
+ * Everything that would be written to the logfile is written to the given
+ * log stream instead, and everything that would be written to std::cout to
+ * the given cout stream. This way registrations that run at the same time
+ * do not mix their output; the caller writes the streams to the shared
+ * xout afterwards, with WriteToSharedXout().
+ */
+class xoutThreadSetup
+{
+public:
+
+  xoutThreadSetup( std::ostream & logStream, std::ostream & coutStream );
+  ~xoutThreadSetup();
+
+  /** Write the contents of the streams to the shared xout. To be called
+   * from one thread at a time, after the thread xout is deleted.
+   */
+  static void WriteToSharedXout( const std::string & logText, const std::string & coutText );
+
+private:
+
+  xoutThreadSetup( const xoutThreadSetup & ); // purposely not implemented
+  void operator=( const xoutThreadSetup & );  // purposely not implemented
+
+  xl::xoutbase_type   m_Xout;
+  xl::xoutsimple_type m_WarningXout;
+  xl::xoutsimple_type m_ErrorXout;
+  xl::xoutsimple_type m_StandardXout;
+  xl::xoutsimple_type m_CoutOnlyXout;
+  xl::xoutsimple_type m_LogOnlyXout;
+
+};
+
 /**
  * \class ElastixMain
  * \brief A class with all functionality to configure elastix.
@@ -128,7 +179,10 @@ public:
   typedef ElastixBase::DataObjectContainerType          DataObjectContainerType;
   typedef ElastixBase::ObjectContainerPointer           ObjectContainerPointer;
   typedef ElastixBase::DataObjectContainerPointer       DataObjectContainerPointer;
+  typedef ElastixBase::DataObjectCacheType              DataObjectCacheType;
+  typedef ElastixBase::DataObjectCachePointer           DataObjectCachePointer;
   typedef ElastixBase::FlatDirectionCosinesType         FlatDirectionCosinesType;
+  typedef ElastixBase::ResolutionMetricValuesType       ResolutionMetricValuesType;
 
   /** Typedefs for the database that holds pointers to New() functions.
    * Those functions are used to instantiate components, such as the metric etc.
@@ -183,6 +237,13 @@ public:
   itkSetObjectMacro( ResultImageContainer, DataObjectContainerType );
   itkGetObjectMacro( ResultImageContainer, DataObjectContainerType );
 
+  /** Set/Get the cache of data that is shared by registrations with the
+   * same fixed images, masks and parameter maps. See
+   * ElastixBase::SetDataObjectCache().
+   */
+  itkSetObjectMacro( DataObjectCache, DataObjectCacheType );
+  itkGetObjectMacro( DataObjectCache, DataObjectCacheType );
+
   /** Set/Get the configuration object. */
   itkSetObjectMacro( Configuration, ConfigurationType );
   itkGetObjectMacro( Configuration, ConfigurationType );
@@ -219,6 +280,28 @@ public:
 
   virtual const FlatDirectionCosinesType & GetOriginalFixedImageDirectionFlat( void ) const;
 
+  /** Set/Get whether the metric value is computed at the end of each
+   * resolution, the metric values of a reference registration, and the
+   * pruning margin. These are passed to the ElastixBase; see there.
+   */
+  itkSetMacro( ComputeResolutionMetricValues, bool );
+  itkGetConstMacro( ComputeResolutionMetricValues, bool );
+
+  virtual void SetPruningReferenceMetricValues(
+    const ResolutionMetricValuesType & arg );
+
+  virtual const ResolutionMetricValuesType & GetPruningReferenceMetricValues( void ) const;
+
+  itkSetMacro( PruningMargin, double );
+  itkGetConstMacro( PruningMargin, double );
+
+  /** Get the metric values at the end of each resolution, and whether the
+   * registration was pruned. Only valid after calling Run()!
+   */
+  virtual const ResolutionMetricValuesType & GetResolutionMetricValues( void ) const;
+
+  itkGetConstMacro( Pruned, bool );
+
   /** Get and Set the elastix level. */
   void SetElastixLevel( unsigned int level );
 
@@ -272,6 +355,13 @@ public:
    */
   virtual void SetMaximumNumberOfThreads( void ) const;
 
+  /** Write the log file in a background thread, if the flush
+   * interval (in ms) is given on the command line.
+   * Syntax:
+   * -asynclog \<int\>
+   */
+  virtual void SetAsynchronousLogging( void ) const;
+
   /** Functions to get/set the ComponentDatabase. */
   static ComponentDatabase * GetComponentDatabase( void )
   {
@@ -324,6 +414,9 @@ protected:
   DataObjectContainerPointer m_MovingMaskContainer;
   DataObjectContainerPointer m_ResultImageContainer;
 
+  /** The cache of data shared with other registrations. */
+  DataObjectCachePointer m_DataObjectCache;
+
   /** A transform that is the result of registration. */
   ObjectPointer m_FinalTransform;
 
@@ -336,6 +429,13 @@ protected:
 
   FlatDirectionCosinesType m_OriginalFixedImageDirection;
 
+  /** The metric values at the end of each resolution, and pruning. */
+  bool                       m_ComputeResolutionMetricValues;
+  ResolutionMetricValuesType m_ResolutionMetricValues;
+  ResolutionMetricValuesType m_PruningReferenceMetricValues;
+  double                     m_PruningMargin;
+  bool                       m_Pruned;
+
   static ComponentDatabasePointer s_CDB;
   static ComponentLoaderPointer   s_ComponentLoader;
   virtual int LoadComponents( void );
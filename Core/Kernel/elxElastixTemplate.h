@@ -94,6 +94,12 @@ namespace elastix
  *    example: <tt>(WriteTransformParametersEachResolution "true")</tt>\n
  *    This parameter can not be specified for each resolution separately.
  *    Default value: "false".
+ * \parameter IterationInfoFileFormat: Controls the format of the
+ *    IterationInfo files, "text" or "binary". A binary file stores the
+ *    values at full precision, and avoids formatting text for the file. It
+ *    can be converted to text with the elxIterationInfoToText tool.\n
+ *    example: <tt>(IterationInfoFileFormat "binary")</tt>\n
+ *    Default value: "text".
  * \parameter UseDirectionCosines: Controls whether to use or ignore the
  * direction cosines (world matrix, transform matrix) set in the images.
  * Voxel spacing and image origin are always taken into account, regardless
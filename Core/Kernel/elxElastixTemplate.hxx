@@ -452,6 +452,9 @@ ElastixTemplate< TFixedImage, TMovingImage >
     timer.Start();
     elxout << "Resampling image and writing to disk ..." << std::endl;
 
+    /** Possibly compile the transform chain, to speed up the resampling. */
+    this->GetElxResamplerBase()->CompileTransform();
+
     /** Create a name for the final result. */
     std::string resultImageFormat = "mhd";
     this->GetConfiguration()->ReadParameter( resultImageFormat,
@@ -594,6 +597,12 @@ void
 ElastixTemplate< TFixedImage, TMovingImage >
 ::BeforeEachResolution( void )
 {
+  /** A pruned registration stops before the next resolution is started. */
+  if( this->GetPruned() )
+  {
+    return;
+  }
+
   /** Get current resolution level. */
   unsigned long level
     = this->GetElxRegistrationBase()->GetAsITKBaseType()->GetCurrentLevel();
@@ -675,6 +684,42 @@ ElastixTemplate< TFixedImage, TMovingImage >
   CallInEachComponent( &BaseComponentType::AfterEachResolutionBase );
   CallInEachComponent( &BaseComponentType::AfterEachResolution );
 
+  /** Compute the metric value at the end of this resolution, and prune the
+   * registration when it is clearly worse than the reference registration.
+   * The value is computed on the pruning samples, which are the same for
+   * all registrations that share the data object cache.
+   */
+  if( this->GetComputeResolutionMetricValues() )
+  {
+    double value = itk::NumericTraits< double >::max();
+    try
+    {
+      for( unsigned int i = 0; i < this->GetNumberOfImageSamplers(); ++i )
+      {
+        this->GetElxImageSamplerBase( i )->SelectPruningSamples();
+      }
+      value = this->GetElxRegistrationBase()->GetAsITKBaseType()->GetMetric()->GetValue(
+        this->GetElxOptimizerBase()->GetAsITKBaseType()->GetCurrentPosition() );
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      xl::xout[ "warning" ] << "WARNING: the metric value at the end of resolution "
+                            << level << " could not be computed.\n" << excp << std::endl;
+    }
+    for( unsigned int i = 0; i < this->GetNumberOfImageSamplers(); ++i )
+    {
+      this->GetElxImageSamplerBase( i )->RestoreSamples();
+    }
+    elxout << "Metric value at the end of resolution " << level << ": " << value << std::endl;
+
+    if( this->AddResolutionMetricValue( value ) )
+    {
+      elxout << "The registration is pruned, because its metric value is clearly "
+             << "worse than that of the reference registration." << std::endl;
+      this->GetElxRegistrationBase()->GetAsITKBaseType()->StopRegistration();
+    }
+  }
+
   /** Create a TransformParameter-file for the current resolution. */
   bool writeTransformParameterEachResolution = false;
   this->GetConfiguration()->ReadParameter( writeTransformParameterEachResolution,
@@ -1139,7 +1184,8 @@ ElastixTemplate< TFixedImage, TMovingImage >
  * ************** OpenIterationInfoFile *************************
  *
  * Open a file called IterationInfo.<ElastixLevel>.R<Resolution>.txt,
- * which will contain the iteration info table.
+ * which will contain the iteration info table. In case of the binary
+ * format, the file is called IterationInfo.<ElastixLevel>.R<Resolution>.bin.
  */
 
 template< class TFixedImage, class TMovingImage >
@@ -1151,27 +1197,55 @@ ElastixTemplate< TFixedImage, TMovingImage >
 
   /** Remove the current iteration info output file, if any. */
   xout[ "iteration" ].RemoveOutput( "IterationInfoFile" );
+  xoutrow_type * iterationInfo = dynamic_cast< xoutrow_type * >( &xout[ "iteration" ] );
+  if( iterationInfo )
+  {
+    iterationInfo->RemoveBinaryOutput( "IterationInfoFile" );
+  }
 
   if( this->m_IterationInfoFile.is_open() )
   {
     this->m_IterationInfoFile.close();
   }
 
+  /** Read the format of the file. */
+  std::string fileFormat = "text";
+  this->GetConfiguration()->ReadParameter( fileFormat,
+    "IterationInfoFileFormat", 0, false );
+  const bool binary = ( fileFormat == "binary" ) && iterationInfo;
+  if( fileFormat != "text" && !binary )
+  {
+    xout[ "warning" ] << "WARNING: IterationInfoFileFormat \"" << fileFormat
+                      << "\" is not supported, \"text\" is used instead." << std::endl;
+  }
+
   /** Create the IterationInfo filename for this resolution. */
   std::ostringstream makeFileName( "" );
   makeFileName << this->m_Configuration->GetCommandLineArgument( "-out" )
                << "IterationInfo."
                << this->m_Configuration->GetElastixLevel()
                << ".R" << this->GetElxRegistrationBase()->GetAsITKBaseType()->GetCurrentLevel()
-               << ".txt";
+               << ( binary ? ".bin" : ".txt" );
   std::string fileName = makeFileName.str();
 
   /** Open the IterationInfoFile. */
-  this->m_IterationInfoFile.open( fileName.c_str() );
+  if( binary )
+  {
+    this->m_IterationInfoFile.open( fileName.c_str(), std::ios::out | std::ios::binary );
+  }
+  else
+  {
+    this->m_IterationInfoFile.open( fileName.c_str() );
+  }
   if( !( this->m_IterationInfoFile.is_open() ) )
   {
     xout[ "error" ] << "ERROR: File \"" << fileName << "\" could not be opened!" << std::endl;
   }
+  else if( binary )
+  {
+    /** Add this file to the binary outputs of xout["iteration"]. */
+    iterationInfo->AddBinaryOutput( "IterationInfoFile", &( this->m_IterationInfoFile ) );
+  }
   else
   {
     /** Add this file to the list of outputs of xout["iteration"]. */
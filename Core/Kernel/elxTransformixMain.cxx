@@ -48,6 +48,7 @@ TransformixMain::Run( void )
   /** Set process properties. */
   this->SetProcessPriority();
   this->SetMaximumNumberOfThreads();
+  this->SetAsynchronousLogging();
 
   /** Initialize database. */
   int errorCode = this->InitDBIndex();
@@ -308,6 +309,17 @@ TransformixMain::InitDBIndex( void )
         xl::xout[ "error" ] << "Something went wrong in the ComponentDatabase." << std::endl;
         return 1;
       }
+
+      /** Install the components for this image type, if not done already. */
+      if( this->s_ComponentLoader.IsNotNull() )
+      {
+        int installReturnCode = this->s_ComponentLoader->InstallComponents( this->m_DBIndex );
+        if( installReturnCode != 0 )
+        {
+          xl::xout[ "error" ] << "Installing components failed" << std::endl;
+          return installReturnCode;
+        }
+      }
     } //end if s_CDB!=0
 
   } // end if m_Configuration->Initialized();
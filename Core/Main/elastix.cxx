@@ -268,6 +268,7 @@ main( int argc, char ** argv )
     if( returndummy != 0 )
     {
       xl::xout[ "error" ] << "Errors occurred!" << std::endl;
+      elx::xoutSetAsynchronous( false, 0 );
       return returndummy;
     }
 
@@ -322,6 +323,9 @@ main( int argc, char ** argv )
   /** Close the modules. */
   ElastixMainType::UnloadComponents();
 
+  /** Write the remaining log output, and stop the writer thread. */
+  elx::xoutSetAsynchronous( false, 0 );
+
   /** Exit and return the error code. */
   return returndummy;
 
@@ -362,7 +366,9 @@ PrintHelp( void )
   std::cout << "  -t0       parameter file for initial transform\n";
   std::cout << "  -priority set the process priority to high, abovenormal, normal (default),\n"
             << "            belownormal, or idle (Windows only option)\n";
-  std::cout << "  -threads  set the maximum number of threads of elastix\n"
+  std::cout << "  -threads  set the maximum number of threads of elastix\n";
+  std::cout << "  -asynclog write the log file in a separate thread,\n"
+            << "            flushing at most every <int> ms (-1: only at the end)\n"
             << std::endl;
 
   /** The parameter file.*/
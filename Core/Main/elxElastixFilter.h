@@ -19,6 +19,7 @@
 #define elxElastixFilter_h
 
 #include "itkImageSource.h"
+#include "itkMultiThreader.h"
 
 #include "elxElastixMain.h"
 #include "elxParameterObject.h"
@@ -50,17 +51,21 @@ public:
   itkTypeMacro( Self, itk::ImageSource );
 
   /** Typedefs. */
-  typedef elastix::ElastixMain                      ElastixMainType;
-  typedef ElastixMainType::Pointer                  ElastixMainPointer;
-  typedef std::vector< ElastixMainPointer >         ElastixMainVectorType;
-  typedef ElastixMainType::ObjectPointer            ElastixMainObjectPointer;
-  typedef ElastixMainType::ArgumentMapType          ArgumentMapType;
-  typedef ArgumentMapType::value_type               ArgumentMapEntryType;
-  typedef ElastixMainType::FlatDirectionCosinesType FlatDirectionCosinesType;
+  typedef elastix::ElastixMain                        ElastixMainType;
+  typedef ElastixMainType::Pointer                    ElastixMainPointer;
+  typedef std::vector< ElastixMainPointer >           ElastixMainVectorType;
+  typedef ElastixMainType::ObjectPointer              ElastixMainObjectPointer;
+  typedef ElastixMainType::ArgumentMapType            ArgumentMapType;
+  typedef ArgumentMapType::value_type                 ArgumentMapEntryType;
+  typedef ElastixMainType::FlatDirectionCosinesType   FlatDirectionCosinesType;
+  typedef ElastixMainType::ResolutionMetricValuesType ResolutionMetricValuesType;
+  typedef std::vector< ResolutionMetricValuesType >   ResolutionMetricValuesVectorType;
 
   typedef ElastixMainType::DataObjectContainerType           DataObjectContainerType;
   typedef ElastixMainType::DataObjectContainerPointer        DataObjectContainerPointer;
   typedef DataObjectContainerType::Iterator                  DataObjectContainerIterator;
+  typedef ElastixMainType::DataObjectCacheType               DataObjectCacheType;
+  typedef ElastixMainType::DataObjectCachePointer            DataObjectCachePointer;
   typedef itk::ProcessObject::DataObjectIdentifierType       DataObjectIdentifierType;
   typedef itk::ProcessObject::DataObjectPointerArraySizeType DataObjectPointerArraySizeType;
   typedef itk::ProcessObject::NameArray                      NameArrayType;
@@ -101,6 +106,22 @@ public:
   MovingImageConstPointer GetMovingImage( const unsigned int index ) const;
   unsigned int GetNumberOfMovingImages( void ) const;
 
+  /** Add/Get/Remove/NumberOf batch moving images. When batch moving images
+   * are given, every batch moving image is registered separately to the
+   * (shared) fixed images, using the same parameter object. The fixed images,
+   * fixed masks, parameter maps and logging are set up only once for all jobs.
+   * The per-job results can be retrieved with GetBatchResultImage( i ) and
+   * GetBatchTransformParameterObject( i ). The primary output is the result
+   * image of the first job. When an output directory is set, the files of
+   * job i are written to the subdirectory "batch<i>/". The jobs share the
+   * fixed image pyramids, eroded masks and fixed sample sets, and can run at
+   * the same time, see SetNumberOfConcurrentRegistrations().
+   */
+  virtual void AddBatchMovingImage( TMovingImage * movingImage );
+  MovingImageConstPointer GetBatchMovingImage( const unsigned int index ) const;
+  virtual void RemoveBatchMovingImages( void );
+  unsigned int GetNumberOfBatchMovingImages( void ) const;
+
   /** Set/Add/Get/Remove/NumberOf fixed masks. */
   virtual void AddFixedMask( FixedMaskType * fixedMask );
   virtual void SetFixedMask( FixedMaskType * fixedMask );
@@ -126,11 +147,44 @@ public:
   ParameterObjectType * GetTransformParameterObject( void );
   const ParameterObjectType * GetTransformParameterObject( void ) const;
 
+  /** Get the result image and transform parameter object of batch job i. */
+  TFixedImage * GetBatchResultImage( const unsigned int index );
+  ParameterObjectType * GetBatchTransformParameterObject( const unsigned int index );
+
   /** Set/Get/Remove initial transform parameter filename. */
   itkSetMacro( InitialTransformParameterFileName, std::string );
   itkGetMacro( InitialTransformParameterFileName, std::string );
   virtual void RemoveInitialTransformParameterFileName( void ) { this->SetInitialTransformParameterFileName( "" ); }
 
+  /** Add/Get/Remove/NumberOf multi-start initial transform parameter
+   * filenames. When these are given, the registration is started from each
+   * of the initial transforms, and the start with the lowest final metric
+   * value gives the outputs. The images, masks, parameter maps and logging
+   * are set up only once for all starts, and the starts run like the jobs of
+   * a batch, see SetNumberOfConcurrentRegistrations(). At the end of each
+   * resolution, the metric value of a start is compared with that of the
+   * best start that finished before it started. When it is higher by more
+   * than MultiStartPruningMargin times the absolute value of the best start,
+   * the start is pruned: its remaining resolutions and parameter maps are
+   * skipped. These metric values are computed on one set of samples that is
+   * shared by all starts. When an output directory is set, the files of
+   * start i are written to the subdirectory "start<i>/".
+   */
+  virtual void AddMultiStartInitialTransformParameterFileName( const std::string & fileName );
+  std::string GetMultiStartInitialTransformParameterFileName( const unsigned int index ) const;
+  virtual void RemoveMultiStartInitialTransformParameterFileNames( void );
+  unsigned int GetNumberOfMultiStarts( void ) const;
+
+  /** Set/Get the relative pruning margin of multi-start registration. Default: 0.1. */
+  itkSetMacro( MultiStartPruningMargin, double );
+  itkGetConstMacro( MultiStartPruningMargin, double );
+
+  /** Get the index of the start that gave the outputs, and the number of
+   * pruned starts. Only valid after Update() with multi-start initial transforms.
+   */
+  itkGetConstMacro( BestMultiStart, unsigned int );
+  itkGetConstMacro( NumberOfPrunedMultiStarts, unsigned int );
+
   /** Set/Get/Remove fixed point set filename. */
   itkSetMacro( FixedPointSetFileName, std::string );
   itkGetMacro( FixedPointSetFileName, std::string );
@@ -165,6 +219,19 @@ public:
   itkSetMacro( NumberOfThreads, int );
   itkGetMacro( NumberOfThreads, int );
 
+  /** Set/Get the number of batch jobs that run at the same time. The threads,
+   * NumberOfThreads or else the global default number of threads, are
+   * divided evenly between them, and every job, also when it runs alone,
+   * uses this share, so that the results do not depend on the order in
+   * which the jobs finish. The first job runs alone, before the others, so
+   * that they can reuse what it computed. The logs of the other jobs are
+   * written when all jobs are done, in the order of the jobs. With OpenCL,
+   * jobs always run one after the other. Default: 1.
+   */
+  itkSetClampMacro( NumberOfConcurrentRegistrations, unsigned int, 1,
+    itk::NumericTraits< unsigned int >::max() );
+  itkGetConstMacro( NumberOfConcurrentRegistrations, unsigned int );
+
 protected:
 
   ElastixFilter( void );
@@ -176,6 +243,93 @@ private:
   ElastixFilter( const Self & );  // purposely not implemented
   void operator=( const Self & ); // purposely not implemented
 
+  /** Run the (possibly multiple) registration(s) defined by the parameter
+   * maps for one set of moving images. The fixed-side containers are shared
+   * between calls. When resolutionMetricValues is given, the metric values
+   * at the end of each resolution of each parameter map are returned in it.
+   * When pruningReferenceMetricValues is given as well, the registrations
+   * are pruned against these values, and true is returned if that happened.
+   * The registrations share m_DataObjectCache, when it is set.
+   */
+  bool RunRegistrations( ParameterMapVectorType & parameterMapVector,
+    ArgumentMapType & argumentMap,
+    DataObjectContainerPointer fixedImageContainer,
+    DataObjectContainerPointer movingImageContainer,
+    DataObjectContainerPointer fixedMaskContainer,
+    DataObjectContainerPointer movingMaskContainer,
+    DataObjectContainerPointer & resultImageContainer,
+    ParameterMapVectorType & transformParameterMapVector,
+    ResolutionMetricValuesVectorType * resolutionMetricValues = 0,
+    const ResolutionMetricValuesVectorType * pruningReferenceMetricValues = 0 );
+
+  /** The inputs and outputs of one batch job or multi-start. When
+   * ComputeResolutionMetricValues is set, the job is pruned against the
+   * metric values of the best job that finished before it started.
+   */
+  struct RegistrationJob
+  {
+    RegistrationJob() : ComputeResolutionMetricValues( false ), Pruned( false ) {}
+
+    ArgumentMapType                  ArgumentMap;
+    ParameterMapVectorType           ParameterMapVector;
+    DataObjectContainerPointer       MovingImageContainer;
+    DataObjectContainerPointer       ResultImageContainer;
+    ParameterMapVectorType           TransformParameterMapVector;
+    bool                             ComputeResolutionMetricValues;
+    ResolutionMetricValuesVectorType ResolutionMetricValues;
+    ResolutionMetricValuesVectorType PruningReferenceMetricValues;
+    bool                             Pruned;
+    std::string                      ErrorMessage;
+    std::string                      Log;
+    std::string                      CoutLog;
+  };
+  typedef std::vector< RegistrationJob > RegistrationJobVectorType;
+
+  /** The arguments of RunJobsThreaderCallback(). */
+  struct RunJobsThreaderParameterType
+  {
+    Self *                      m_Filter;
+    RegistrationJobVectorType * m_Jobs;
+    DataObjectContainerPointer  m_FixedImageContainer;
+    DataObjectContainerPointer  m_FixedMaskContainer;
+    DataObjectContainerPointer  m_MovingMaskContainer;
+  };
+
+  /** Run the jobs, NumberOfConcurrentRegistrations at a time, with the
+   * shared fixed images and masks. Throws an exception if a job failed,
+   * in which the jobs are called jobName followed by their index.
+   */
+  void RunJobs( RegistrationJobVectorType & jobs,
+    DataObjectContainerPointer fixedImageContainer,
+    DataObjectContainerPointer fixedMaskContainer,
+    DataObjectContainerPointer movingMaskContainer,
+    const std::string & jobName );
+
+  /** Run one job. A concurrent job writes to its own xout, and gets its own
+   * copies of the image and mask containers, grafted from the shared ones,
+   * such that no pipeline or image is modified by two threads. Errors are
+   * returned in the ErrorMessage of the job.
+   */
+  void RunJob( RegistrationJob & job,
+    DataObjectContainerPointer fixedImageContainer,
+    DataObjectContainerPointer fixedMaskContainer,
+    DataObjectContainerPointer movingMaskContainer,
+    bool concurrent );
+
+  /** Get the metric value at the end of the last resolution of a job. */
+  static double GetFinalMetricValue( const RegistrationJob & job );
+
+  /** Replace bestJob by job, if job computed metric values, was not
+   * pruned, and has a lower final metric value.
+   */
+  static void UpdateBestJob( const RegistrationJob & job, const RegistrationJob *& bestJob );
+
+  /** Run the jobs 1 + threadId, 1 + threadId + numberOfThreads, etc. */
+  static ITK_THREAD_RETURN_TYPE RunJobsThreaderCallback( void * arg );
+
+  /** Get a container with grafts of the data objects of a container. */
+  static DataObjectContainerPointer GraftContainer( DataObjectContainerPointer container );
+
   /** MakeUniqueName. */
   std::string MakeUniqueName( const DataObjectIdentifierType & key );
 
@@ -201,10 +355,27 @@ private:
   bool m_LogToConsole;
   bool m_LogToFile;
 
-  int m_NumberOfThreads;
+  int          m_NumberOfThreads;
+  unsigned int m_NumberOfConcurrentRegistrations;
 
   unsigned int m_InputUID;
 
+  /** The names of the batch moving image inputs, in the order they were added. */
+  std::vector< DataObjectIdentifierType > m_BatchMovingImageNames;
+
+  /** The initial transform parameter filenames of multi-start registration. */
+  std::vector< std::string > m_MultiStartInitialTransformParameterFileNames;
+
+  double       m_MultiStartPruningMargin;
+  unsigned int m_BestMultiStart;
+  unsigned int m_NumberOfPrunedMultiStarts;
+
+  /** The fixed image pyramid outputs, eroded masks and fixed sample sets,
+   * shared by the jobs of a batch and by the starts of a multi-start
+   * registration. Only set during GenerateData().
+   */
+  DataObjectCachePointer m_DataObjectCache;
+
 };
 
 } // namespace elx
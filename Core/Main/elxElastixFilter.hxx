@@ -46,7 +46,14 @@ ElastixFilter< TFixedImage, TMovingImage >
   this->m_LogToConsole = false;
   this->m_LogToFile    = false;
 
-  this->m_NumberOfThreads = 0;
+  this->m_NumberOfThreads                 = 0;
+  this->m_NumberOfConcurrentRegistrations = 1;
+
+  this->m_MultiStartPruningMargin   = 0.1;
+  this->m_BestMultiStart            = 0;
+  this->m_NumberOfPrunedMultiStarts = 0;
+
+  this->m_DataObjectCache = 0;
 
   ParameterObjectPointer defaultParameterObject = ParameterObject::New();
   defaultParameterObject->AddParameterMap( ParameterObject::GetDefaultParameterMap( "translation" ) );
@@ -79,9 +86,18 @@ ElastixFilter< TFixedImage, TMovingImage >
   DataObjectContainerPointer fixedMaskContainer   = 0;
   DataObjectContainerPointer movingMaskContainer  = 0;
   DataObjectContainerPointer resultImageContainer = 0;
-  ElastixMainObjectPointer   transform            = 0;
   ParameterMapVectorType     transformParameterMapVector;
-  FlatDirectionCosinesType   fixedImageOriginalDirection;
+
+  // Remove the batch outputs of a previous run
+  const NameArrayType outputNames = this->GetOutputNames();
+  for( unsigned int i = 0; i < outputNames.size(); ++i )
+  {
+    if( this->IsInputOfType( "BatchResultImage", outputNames[ i ] )
+      || this->IsInputOfType( "BatchTransformParameterObject", outputNames[ i ] ) )
+    {
+      this->RemoveOutput( outputNames[ i ] );
+    }
+  }
 
   // Split inputs into separate containers
   const NameArrayType inputNames = this->GetInputNames();
@@ -121,6 +137,23 @@ ElastixFilter< TFixedImage, TMovingImage >
     }
   }
 
+  const unsigned int numberOfBatchJobs = this->m_BatchMovingImageNames.size();
+  if( numberOfBatchJobs > 0 && movingImageContainer->Size() > 0 )
+  {
+    itkExceptionMacro( "Moving images and batch moving images cannot be used at the same time." );
+  }
+
+  const unsigned int numberOfMultiStarts = this->m_MultiStartInitialTransformParameterFileNames.size();
+  if( numberOfMultiStarts > 0 && numberOfBatchJobs > 0 )
+  {
+    itkExceptionMacro( "Batch moving images and multi-start initial transforms cannot be used at the same time." );
+  }
+
+  if( numberOfMultiStarts > 0 && !this->m_InitialTransformParameterFileName.empty() )
+  {
+    itkExceptionMacro( "An initial transform and multi-start initial transforms cannot be used at the same time." );
+  }
+
   // Set ParameterMap
   ParameterObjectPointer parameterObject    = itkDynamicCastInDebugMode< ParameterObject * >( this->GetInput( "ParameterObject" ) );
   ParameterMapVectorType parameterMapVector = parameterObject->GetParameterMap();
@@ -133,6 +166,17 @@ ElastixFilter< TFixedImage, TMovingImage >
   // Elastix must always write result image to guarantee that the ITK pipeline is in a consistent state
   parameterMapVector[ parameterMapVector.size() - 1 ][ "WriteResultImage" ] = ParameterValueVectorType( 1, "true" );
 
+  // Set image dimension from input images, override user settings
+  for( unsigned int i = 0; i < parameterMapVector.size(); ++i )
+  {
+    parameterMapVector[ i ][ "FixedImageDimension" ]
+      = ParameterValueVectorType( 1, ParameterObject::ToString( fixedImageDimension ) ) ;
+    parameterMapVector[ i ][ "MovingImageDimension" ]
+      = ParameterValueVectorType( 1, ParameterObject::ToString( movingImageDimension ) );
+    parameterMapVector[ i ][ "ResultImagePixelType" ]
+      = ParameterValueVectorType( 1, ParameterObject::ToString( PixelType< typename TFixedImage::PixelType >::ToString() ) );
+  }
+
   // Setup argument map
   ArgumentMapType argumentMap;
 
@@ -204,18 +248,177 @@ ElastixFilter< TFixedImage, TMovingImage >
     itkExceptionMacro( "Error while setting up xout" );
   }
 
-  // Run the (possibly multiple) registration(s)
-  for( unsigned int i = 0; i < parameterMapVector.size(); ++i )
+  if( numberOfMultiStarts > 0 )
   {
-    // Set image dimension from input images, override user settings
-    parameterMapVector[ i ][ "FixedImageDimension" ]
-      = ParameterValueVectorType( 1, ParameterObject::ToString( fixedImageDimension ) ) ;
-    parameterMapVector[ i ][ "MovingImageDimension" ]
-      = ParameterValueVectorType( 1, ParameterObject::ToString( movingImageDimension ) );
-    parameterMapVector[ i ][ "ResultImagePixelType" ]
-      = ParameterValueVectorType( 1, ParameterObject::ToString( PixelType< typename TFixedImage::PixelType >::ToString() ) );
+    // Register from every initial transform. The image and mask containers,
+    // the parameter maps and xout are shared by all starts, which run like
+    // batch jobs. Each start is pruned against the metric values of the best
+    // start that finished before it started. The fixed image pyramids,
+    // eroded masks, fixed sample sets and pruning samples are computed by
+    // the first start, and reused by the others.
+    this->m_DataObjectCache = DataObjectCacheType::New();
+    RegistrationJobVectorType jobs( numberOfMultiStarts );
+    for( unsigned int start = 0; start < numberOfMultiStarts; ++start )
+    {
+      jobs[ start ].ParameterMapVector            = parameterMapVector;
+      jobs[ start ].ArgumentMap                   = argumentMap;
+      jobs[ start ].ArgumentMap[ "-t0" ]          = this->m_MultiStartInitialTransformParameterFileNames[ start ];
+      jobs[ start ].MovingImageContainer          = movingImageContainer;
+      jobs[ start ].ComputeResolutionMetricValues = true;
+
+      // Write the files of each start to its own subdirectory
+      if( !this->GetOutputDirectory().empty() )
+      {
+        const std::string startOutputDirectory
+          = this->GetOutputDirectory() + "start" + ParameterObject::ToString( start ) + "/";
+        if( !itksys::SystemTools::MakeDirectory( startOutputDirectory.c_str() ) )
+        {
+          itkExceptionMacro( "Could not create output directory \"" << startOutputDirectory << "\"." );
+        }
+        jobs[ start ].ArgumentMap[ "-out" ] = startOutputDirectory;
+      }
+    }
+
+    try
+    {
+      this->RunJobs( jobs, fixedImageContainer, fixedMaskContainer, movingMaskContainer, "start" );
+    }
+    catch( itk::ExceptionObject & )
+    {
+      this->m_DataObjectCache = 0;
+      throw;
+    }
+    this->m_DataObjectCache = 0;
 
+    // The first start with the lowest final metric value gives the outputs
+    const RegistrationJob * bestJob = 0;
+    this->m_BestMultiStart            = 0;
+    this->m_NumberOfPrunedMultiStarts = 0;
+    for( unsigned int start = 0; start < numberOfMultiStarts; ++start )
+    {
+      if( jobs[ start ].Pruned )
+      {
+        ++this->m_NumberOfPrunedMultiStarts;
+      }
+      else if( bestJob == 0 || GetFinalMetricValue( jobs[ start ] ) < GetFinalMetricValue( *bestJob ) )
+      {
+        bestJob                = &jobs[ start ];
+        this->m_BestMultiStart = start;
+      }
+    }
+    if( bestJob != 0 )
+    {
+      resultImageContainer        = bestJob->ResultImageContainer;
+      transformParameterMapVector = bestJob->TransformParameterMapVector;
+    }
+  }
+  else if( numberOfBatchJobs == 0 )
+  {
+    // Run the (possibly multiple) registration(s)
+    this->RunRegistrations( parameterMapVector, argumentMap,
+      fixedImageContainer, movingImageContainer, fixedMaskContainer, movingMaskContainer,
+      resultImageContainer, transformParameterMapVector );
+  }
+  else
+  {
+    // Register every batch moving image to the same fixed images. The fixed
+    // image and mask containers, the parameter maps and xout are shared by
+    // all jobs. The fixed image pyramids, eroded masks and fixed sample sets
+    // are computed by the first job, and reused by the others.
+    this->m_DataObjectCache = DataObjectCacheType::New();
+    RegistrationJobVectorType jobs( numberOfBatchJobs );
+    for( unsigned int job = 0; job < numberOfBatchJobs; ++job )
+    {
+      jobs[ job ].ParameterMapVector   = parameterMapVector;
+      jobs[ job ].ArgumentMap          = argumentMap;
+      jobs[ job ].MovingImageContainer = DataObjectContainerType::New();
+      jobs[ job ].MovingImageContainer->push_back( this->GetInput( this->m_BatchMovingImageNames[ job ] ) );
+
+      // Write the files of each job to its own subdirectory
+      if( !this->GetOutputDirectory().empty() )
+      {
+        const std::string jobOutputDirectory
+          = this->GetOutputDirectory() + "batch" + ParameterObject::ToString( job ) + "/";
+        if( !itksys::SystemTools::MakeDirectory( jobOutputDirectory.c_str() ) )
+        {
+          itkExceptionMacro( "Could not create output directory \"" << jobOutputDirectory << "\"." );
+        }
+        jobs[ job ].ArgumentMap[ "-out" ] = jobOutputDirectory;
+      }
+    }
 
+    try
+    {
+      this->RunJobs( jobs, fixedImageContainer, fixedMaskContainer, movingMaskContainer, "batch job" );
+    }
+    catch( itk::ExceptionObject & )
+    {
+      this->m_DataObjectCache = 0;
+      throw;
+    }
+    this->m_DataObjectCache = 0;
+
+    for( unsigned int job = 0; job < numberOfBatchJobs; ++job )
+    {
+      if( jobs[ job ].ResultImageContainer.IsNull() || jobs[ job ].ResultImageContainer->Size() == 0 )
+      {
+        itkExceptionMacro( "Errors occured during registration of batch job " << job << ": Could not read result image." );
+      }
+
+      ParameterObject::Pointer jobTransformParameterObject = ParameterObject::New();
+      jobTransformParameterObject->SetParameterMap( jobs[ job ].TransformParameterMapVector );
+      this->SetOutput( "BatchResultImage" + ParameterObject::ToString( job ),
+        jobs[ job ].ResultImageContainer->ElementAt( 0 ) );
+      this->SetOutput( "BatchTransformParameterObject" + ParameterObject::ToString( job ),
+        jobTransformParameterObject );
+    }
+
+    // The primary outputs are those of the first job
+    resultImageContainer        = jobs[ 0 ].ResultImageContainer;
+    transformParameterMapVector = jobs[ 0 ].TransformParameterMapVector;
+  }
+
+  // Save result image
+  if( resultImageContainer.IsNotNull() && resultImageContainer->Size() > 0 )
+  {
+    this->GraftOutput( "ResultImage", resultImageContainer->ElementAt( 0 ) );
+  }
+  else
+  {
+    itkExceptionMacro( "Errors occured during registration: Could not read result image." );
+  }
+
+  // Save parameter map
+  ParameterObject::Pointer transformParameterObject = ParameterObject::New();
+  transformParameterObject->SetParameterMap( transformParameterMapVector );
+  this->SetOutput( "TransformParameterObject", transformParameterObject );
+}
+
+
+/**
+ * ********************* RunRegistrations *********************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+bool
+ElastixFilter< TFixedImage, TMovingImage >
+::RunRegistrations( ParameterMapVectorType & parameterMapVector,
+  ArgumentMapType & argumentMap,
+  DataObjectContainerPointer fixedImageContainer,
+  DataObjectContainerPointer movingImageContainer,
+  DataObjectContainerPointer fixedMaskContainer,
+  DataObjectContainerPointer movingMaskContainer,
+  DataObjectContainerPointer & resultImageContainer,
+  ParameterMapVectorType & transformParameterMapVector,
+  ResolutionMetricValuesVectorType * resolutionMetricValues,
+  const ResolutionMetricValuesVectorType * pruningReferenceMetricValues )
+{
+  ElastixMainObjectPointer transform = 0;
+  FlatDirectionCosinesType fixedImageOriginalDirection;
+
+  // Run the (possibly multiple) registration(s)
+  for( unsigned int i = 0; i < parameterMapVector.size(); ++i )
+  {
     // Create new instance of ElastixMain
     ElastixMainPointer elastix = ElastixMainType::New();
 
@@ -231,6 +434,18 @@ ElastixFilter< TFixedImage, TMovingImage >
     elastix->SetMovingMaskContainer( movingMaskContainer );
     elastix->SetResultImageContainer( resultImageContainer );
     elastix->SetOriginalFixedImageDirectionFlat( fixedImageOriginalDirection );
+    elastix->SetDataObjectCache( this->m_DataObjectCache );
+
+    // Compare the metric values with those of a reference registration
+    if( resolutionMetricValues != 0 )
+    {
+      elastix->SetComputeResolutionMetricValues( true );
+      elastix->SetPruningMargin( this->m_MultiStartPruningMargin );
+      if( pruningReferenceMetricValues != 0 && i < pruningReferenceMetricValues->size() )
+      {
+        elastix->SetPruningReferenceMetricValues( ( *pruningReferenceMetricValues )[ i ] );
+      }
+    }
 
     // Start registration
     unsigned int isError = 0;
@@ -248,6 +463,16 @@ ElastixFilter< TFixedImage, TMovingImage >
       itkExceptionMacro( << "Internal elastix error: See elastix log (use LogToConsoleOn() or LogToFileOn())." );
     }
 
+    // Skip the remaining registrations when this one was pruned
+    if( resolutionMetricValues != 0 )
+    {
+      resolutionMetricValues->push_back( elastix->GetResolutionMetricValues() );
+      if( elastix->GetPruned() )
+      {
+        return true;
+      }
+    }
+
     // Get stuff in order to put it in the next registration
     transform                   = elastix->GetFinalTransform();
     fixedImageContainer         = elastix->GetFixedImageContainer();
@@ -272,21 +497,257 @@ ElastixFilter< TFixedImage, TMovingImage >
     }
   } // End loop over registrations
 
-  // Save result image
-  if( resultImageContainer.IsNotNull() && resultImageContainer->Size() > 0 )
+  return false;
+} // end RunRegistrations()
+
+
+/**
+ * ********************* RunJobs *********************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+void
+ElastixFilter< TFixedImage, TMovingImage >
+::RunJobs( RegistrationJobVectorType & jobs,
+  DataObjectContainerPointer fixedImageContainer,
+  DataObjectContainerPointer fixedMaskContainer,
+  DataObjectContainerPointer movingMaskContainer,
+  const std::string & jobName )
+{
+  // The first job runs alone, so at most all other jobs run at the same time
+  unsigned int numberOfConcurrentJobs = std::min( this->m_NumberOfConcurrentRegistrations,
+    static_cast< unsigned int >( jobs.size() > 1 ? jobs.size() - 1 : 1 ) );
+#ifdef ELASTIX_USE_OPENCL
+  // The OpenCL context is shared by all registrations of the process
+  numberOfConcurrentJobs = 1;
+#endif
+
+  // Prune each job against the best job that finished before it started
+  const RegistrationJob * bestJob = 0;
+  if( numberOfConcurrentJobs == 1 )
   {
-    this->GraftOutput( "ResultImage", resultImageContainer->ElementAt( 0 ) );
+    for( unsigned int job = 0; job < jobs.size(); ++job )
+    {
+      if( bestJob != 0 )
+      {
+        jobs[ job ].PruningReferenceMetricValues = bestJob->ResolutionMetricValues;
+      }
+      this->RunJob( jobs[ job ], fixedImageContainer, fixedMaskContainer, movingMaskContainer, false );
+      if( !jobs[ job ].ErrorMessage.empty() )
+      {
+        itkExceptionMacro( "Errors occurred during registration of " << jobName << " " << job << ": "
+                                                                    << jobs[ job ].ErrorMessage );
+      }
+      UpdateBestJob( jobs[ job ], bestJob );
+    }
+    return;
   }
-  else
+
+  // Divide the threads between the concurrent jobs. The maximum number of
+  // threads is a global setting of ITK, which every job sets to its share.
+  const itk::ThreadIdType globalMaximumNumberOfThreads = itk::MultiThreader::GetGlobalMaximumNumberOfThreads();
+  const itk::ThreadIdType globalDefaultNumberOfThreads = itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+  const unsigned int      numberOfThreads              = this->m_NumberOfThreads > 0
+    ? static_cast< unsigned int >( this->m_NumberOfThreads ) : globalDefaultNumberOfThreads;
+  const unsigned int threadsPerJob = std::max( 1u, numberOfThreads / numberOfConcurrentJobs );
+  for( unsigned int job = 0; job < jobs.size(); ++job )
   {
-    itkExceptionMacro( "Errors occured during registration: Could not read result image." );
+    jobs[ job ].ArgumentMap[ "-threads" ] = ParameterObjectType::ToString( threadsPerJob );
   }
 
-  // Save parameter map
-  ParameterObject::Pointer transformParameterObject = ParameterObject::New();
-  transformParameterObject->SetParameterMap( transformParameterMapVector );
-  this->SetOutput( "TransformParameterObject", transformParameterObject );
-}
+  // The first job computes what the others reuse through the data object
+  // cache, and loads the components, so it runs before the others
+  this->RunJob( jobs[ 0 ], fixedImageContainer, fixedMaskContainer, movingMaskContainer, false );
+  UpdateBestJob( jobs[ 0 ], bestJob );
+  for( unsigned int job = 1; bestJob != 0 && job < jobs.size(); ++job )
+  {
+    jobs[ job ].PruningReferenceMetricValues = bestJob->ResolutionMetricValues;
+  }
+
+  // Run the other jobs, each in its own thread. The number of threads of the
+  // threader itself is limited by the global maximum, which the first job set.
+  if( jobs[ 0 ].ErrorMessage.empty() )
+  {
+    itk::MultiThreader::SetGlobalMaximumNumberOfThreads(
+      std::max( globalMaximumNumberOfThreads, static_cast< itk::ThreadIdType >( numberOfConcurrentJobs ) ) );
+
+    RunJobsThreaderParameterType parameters;
+    parameters.m_Filter              = this;
+    parameters.m_Jobs                = &jobs;
+    parameters.m_FixedImageContainer = fixedImageContainer;
+    parameters.m_FixedMaskContainer  = fixedMaskContainer;
+    parameters.m_MovingMaskContainer = movingMaskContainer;
+
+    itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+    threader->SetNumberOfThreads( numberOfConcurrentJobs );
+    threader->SetSingleMethod( RunJobsThreaderCallback, &parameters );
+    threader->SingleMethodExecute();
+
+    // Write the logs of the concurrent jobs, in the order of the jobs
+    for( unsigned int job = 1; job < jobs.size(); ++job )
+    {
+      xoutThreadSetup::WriteToSharedXout( jobs[ job ].Log, jobs[ job ].CoutLog );
+    }
+  }
+
+  itk::MultiThreader::SetGlobalMaximumNumberOfThreads( globalMaximumNumberOfThreads );
+  itk::MultiThreader::SetGlobalDefaultNumberOfThreads( globalDefaultNumberOfThreads );
+
+  for( unsigned int job = 0; job < jobs.size(); ++job )
+  {
+    if( !jobs[ job ].ErrorMessage.empty() )
+    {
+      itkExceptionMacro( "Errors occurred during registration of " << jobName << " " << job << ": "
+                                                                  << jobs[ job ].ErrorMessage );
+    }
+  }
+} // end RunJobs()
+
+
+/**
+ * ********************* RunJob *********************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+void
+ElastixFilter< TFixedImage, TMovingImage >
+::RunJob( RegistrationJob & job,
+  DataObjectContainerPointer fixedImageContainer,
+  DataObjectContainerPointer fixedMaskContainer,
+  DataObjectContainerPointer movingMaskContainer,
+  bool concurrent )
+{
+  ResolutionMetricValuesVectorType * resolutionMetricValues
+    = job.ComputeResolutionMetricValues ? &job.ResolutionMetricValues : 0;
+  const ResolutionMetricValuesVectorType * pruningReferenceMetricValues
+    = job.PruningReferenceMetricValues.empty() ? 0 : &job.PruningReferenceMetricValues;
+
+  std::ostringstream log;
+  std::ostringstream coutLog;
+  try
+  {
+    if( concurrent )
+    {
+      xoutThreadSetup threadXout( log, coutLog );
+      DataObjectContainerPointer movingImageContainer = GraftContainer( job.MovingImageContainer );
+      job.Pruned = this->RunRegistrations( job.ParameterMapVector, job.ArgumentMap,
+        GraftContainer( fixedImageContainer ), movingImageContainer,
+        GraftContainer( fixedMaskContainer ), GraftContainer( movingMaskContainer ),
+        job.ResultImageContainer, job.TransformParameterMapVector,
+        resolutionMetricValues, pruningReferenceMetricValues );
+    }
+    else
+    {
+      job.Pruned = this->RunRegistrations( job.ParameterMapVector, job.ArgumentMap,
+        fixedImageContainer, job.MovingImageContainer, fixedMaskContainer, movingMaskContainer,
+        job.ResultImageContainer, job.TransformParameterMapVector,
+        resolutionMetricValues, pruningReferenceMetricValues );
+    }
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    job.ErrorMessage = e.GetDescription();
+  }
+  catch( std::exception & e )
+  {
+    job.ErrorMessage = e.what();
+  }
+  job.Log     = log.str();
+  job.CoutLog = coutLog.str();
+} // end RunJob()
+
+
+/**
+ * ********************* GetFinalMetricValue *********************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+double
+ElastixFilter< TFixedImage, TMovingImage >
+::GetFinalMetricValue( const RegistrationJob & job )
+{
+  // The final metric value is the one at the end of the last resolution
+  if( job.ResolutionMetricValues.empty() || job.ResolutionMetricValues.back().empty() )
+  {
+    return itk::NumericTraits< double >::max();
+  }
+  return job.ResolutionMetricValues.back().back();
+
+} // end GetFinalMetricValue()
+
+
+/**
+ * ********************* UpdateBestJob *********************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+void
+ElastixFilter< TFixedImage, TMovingImage >
+::UpdateBestJob( const RegistrationJob & job, const RegistrationJob *& bestJob )
+{
+  if( job.ComputeResolutionMetricValues && !job.Pruned && job.ErrorMessage.empty()
+    && ( bestJob == 0 || GetFinalMetricValue( job ) < GetFinalMetricValue( *bestJob ) ) )
+  {
+    bestJob = &job;
+  }
+
+} // end UpdateBestJob()
+
+
+/**
+ * ********************* RunJobsThreaderCallback *********************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+ITK_THREAD_RETURN_TYPE
+ElastixFilter< TFixedImage, TMovingImage >
+::RunJobsThreaderCallback( void * arg )
+{
+  itk::MultiThreader::ThreadInfoStruct * infoStruct
+    = static_cast< itk::MultiThreader::ThreadInfoStruct * >( arg );
+  const itk::ThreadIdType        threadId        = infoStruct->ThreadID;
+  const itk::ThreadIdType        numberOfThreads = infoStruct->NumberOfThreads;
+  RunJobsThreaderParameterType * parameters
+    = static_cast< RunJobsThreaderParameterType * >( infoStruct->UserData );
+
+  // The first job has already run
+  RegistrationJobVectorType & jobs = *parameters->m_Jobs;
+  for( unsigned int job = 1 + threadId; job < jobs.size(); job += numberOfThreads )
+  {
+    parameters->m_Filter->RunJob( jobs[ job ], parameters->m_FixedImageContainer,
+      parameters->m_FixedMaskContainer, parameters->m_MovingMaskContainer, true );
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+} // end RunJobsThreaderCallback()
+
+
+/**
+ * ********************* GraftContainer *********************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+typename ElastixFilter< TFixedImage, TMovingImage >::DataObjectContainerPointer
+ElastixFilter< TFixedImage, TMovingImage >
+::GraftContainer( DataObjectContainerPointer container )
+{
+  if( container.IsNull() )
+  {
+    return container;
+  }
+
+  // The grafts share the pixel buffers, but have no source, such that
+  // updating them does not update the pipeline of the inputs
+  DataObjectContainerPointer grafts = DataObjectContainerType::New();
+  for( unsigned int i = 0; i < container->Size(); ++i )
+  {
+    const itk::DataObject *  object = container->ElementAt( i );
+    itk::DataObject::Pointer graft  = dynamic_cast< itk::DataObject * >( object->CreateAnother().GetPointer() );
+    graft->Graft( object );
+    grafts->push_back( graft );
+  }
+  return grafts;
+} // end GraftContainer()
 
 
 /**
@@ -360,6 +821,44 @@ ElastixFilter< TFixedImage, TMovingImage >
   itkExceptionMacro( "TransformParameterObject has not been generated. Update() ElastixFilter before requesting this output.")
 }
 
+/**
+ * ********************* GetBatchResultImage *********************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+TFixedImage *
+ElastixFilter< TFixedImage, TMovingImage >
+::GetBatchResultImage( const unsigned int index )
+{
+  const DataObjectIdentifierType name = "BatchResultImage" + ParameterObject::ToString( index );
+  if( this->HasOutput( name ) )
+  {
+    return itkDynamicCastInDebugMode< TFixedImage * >( itk::ProcessObject::GetOutput( name ) );
+  }
+
+  itkExceptionMacro( << "BatchResultImage " << index << " has not been generated. "
+                     << "Add batch moving images and Update() ElastixFilter before requesting this output." )
+}
+
+/**
+ * ********************* GetBatchTransformParameterObject *********************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+typename ElastixFilter< TFixedImage, TMovingImage >::ParameterObjectType *
+ElastixFilter< TFixedImage, TMovingImage >
+::GetBatchTransformParameterObject( const unsigned int index )
+{
+  const DataObjectIdentifierType name = "BatchTransformParameterObject" + ParameterObject::ToString( index );
+  if( this->HasOutput( name ) )
+  {
+    return itkDynamicCastInDebugMode< ParameterObjectType * >( itk::ProcessObject::GetOutput( name ) );
+  }
+
+  itkExceptionMacro( << "BatchTransformParameterObject " << index << " has not been generated. "
+                     << "Add batch moving images and Update() ElastixFilter before requesting this output." )
+}
+
 /**
  * ********************* SetFixedImage *********************
  */
@@ -550,6 +1049,133 @@ ElastixFilter< TFixedImage, TMovingImage >
 }
 
 
+/**
+ * ********************* AddBatchMovingImage *********************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+void
+ElastixFilter< TFixedImage, TMovingImage >
+::AddBatchMovingImage( TMovingImage * movingImage )
+{
+  // In batch mode the moving images are given per job
+  this->RemoveRequiredInputName( "MovingImage" );
+
+  const DataObjectIdentifierType name = this->MakeUniqueName( "BatchMovingImage" );
+  this->SetInput( name, movingImage );
+  this->m_BatchMovingImageNames.push_back( name );
+} // end AddBatchMovingImage()
+
+
+/**
+ * ********************* GetBatchMovingImage *********************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+typename ElastixFilter< TFixedImage, TMovingImage >::MovingImageConstPointer
+ElastixFilter< TFixedImage, TMovingImage >
+::GetBatchMovingImage( const unsigned int index ) const
+{
+  if( index >= this->m_BatchMovingImageNames.size() )
+  {
+    itkExceptionMacro( << "Index exceeds the number of batch moving images (index: "
+                       << index << ", "
+                       << "number of batch moving images: " << this->m_BatchMovingImageNames.size() << ")" );
+  }
+
+  return itkDynamicCastInDebugMode< const TMovingImage * >( this->GetInput( this->m_BatchMovingImageNames[ index ] ) );
+}
+
+
+/**
+ * ********************* RemoveBatchMovingImages *********************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+void
+ElastixFilter< TFixedImage, TMovingImage >
+::RemoveBatchMovingImages( void )
+{
+  this->RemoveInputsOfType( "BatchMovingImage" );
+  this->m_BatchMovingImageNames.clear();
+  this->AddRequiredInputName( "MovingImage" );
+} // end RemoveBatchMovingImages()
+
+
+/**
+ * ********************* GetNumberOfBatchMovingImages *********************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+unsigned int
+ElastixFilter< TFixedImage, TMovingImage >
+::GetNumberOfBatchMovingImages( void ) const
+{
+  return this->m_BatchMovingImageNames.size();
+}
+
+
+/**
+ * ********************* AddMultiStartInitialTransformParameterFileName *********************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+void
+ElastixFilter< TFixedImage, TMovingImage >
+::AddMultiStartInitialTransformParameterFileName( const std::string & fileName )
+{
+  this->m_MultiStartInitialTransformParameterFileNames.push_back( fileName );
+  this->Modified();
+} // end AddMultiStartInitialTransformParameterFileName()
+
+
+/**
+ * ********************* GetMultiStartInitialTransformParameterFileName *********************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+std::string
+ElastixFilter< TFixedImage, TMovingImage >
+::GetMultiStartInitialTransformParameterFileName( const unsigned int index ) const
+{
+  if( index >= this->m_MultiStartInitialTransformParameterFileNames.size() )
+  {
+    itkExceptionMacro( << "Index exceeds the number of multi-start initial transforms (index: " << index << ", "
+                       << "number of multi-start initial transforms: "
+                       << this->m_MultiStartInitialTransformParameterFileNames.size() << ")" );
+  }
+
+  return this->m_MultiStartInitialTransformParameterFileNames[ index ];
+} // end GetMultiStartInitialTransformParameterFileName()
+
+
+/**
+ * ********************* RemoveMultiStartInitialTransformParameterFileNames *********************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+void
+ElastixFilter< TFixedImage, TMovingImage >
+::RemoveMultiStartInitialTransformParameterFileNames( void )
+{
+  this->m_MultiStartInitialTransformParameterFileNames.clear();
+  this->Modified();
+} // end RemoveMultiStartInitialTransformParameterFileNames()
+
+
+/**
+ * ********************* GetNumberOfMultiStarts *********************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+unsigned int
+ElastixFilter< TFixedImage, TMovingImage >
+::GetNumberOfMultiStarts( void ) const
+{
+  return this->m_MultiStartInitialTransformParameterFileNames.size();
+} // end GetNumberOfMultiStarts()
+
+
 /**
  * ********************* SetFixedMask *********************
  */
@@ -211,6 +211,7 @@ main( int argc, char ** argv )
   if( returndummy != 0 )
   {
     xl::xout[ "error" ] << "Errors occurred" << std::endl;
+    elx::xoutSetAsynchronous( false, 0 );
     return returndummy;
   }
 
@@ -224,6 +225,9 @@ main( int argc, char ** argv )
   transformix = 0;
   TransformixMainType::UnloadComponents();
 
+  /** Write the remaining log output, and stop the writer thread. */
+  elx::xoutSetAsynchronous( false, 0 );
+
   /** Exit and return the error code. */
   return returndummy;
 
@@ -269,6 +273,8 @@ PrintHelp( void )
   std::cout << "  -priority set the process priority to high, abovenormal, normal (default),\n"
             << "            belownormal, or idle (Windows only option)\n";
   std::cout << "  -threads  set the maximum number of threads of transformix\n";
+  std::cout << "  -asynclog write the log file in a separate thread,\n"
+            << "            flushing at most every <int> ms (-1: only at the end)\n";
   std::cout << "\nAt least one of the options \"-in\", \"-def\", \"-jac\", or \"-jacmat\" should be given.\n"
             << std::endl;
 
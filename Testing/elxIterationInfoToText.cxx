@@ -0,0 +1,97 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkCommandLineArgumentParser.h"
+#include "xoutrow.h"
+
+#include <iostream>
+#include <fstream>
+
+/**
+ * ******************* GetHelpString *******************
+ */
+
+std::string
+GetHelpString( void )
+{
+  std::stringstream ss;
+  ss << "Usage:" << std::endl
+     << "elxIterationInfoToText" << std::endl
+     << "  -in    binary IterationInfo file, written with (IterationInfoFileFormat \"binary\")\n"
+     << "  [-out] output text file, default: standard output";
+  return ss.str();
+
+} // end GetHelpString()
+
+
+int
+main( int argc, char * argv[] )
+{
+  /** Read the command line arguments. */
+  itk::CommandLineArgumentParser::Pointer clParser = itk::CommandLineArgumentParser::New();
+  clParser->SetCommandLineArguments( argc, argv );
+  clParser->SetProgramHelpText( GetHelpString() );
+
+  clParser->MarkArgumentAsRequired( "-in", "The binary IterationInfo file." );
+
+  itk::CommandLineArgumentParser::ReturnValue validateArguments = clParser->CheckForRequiredArguments();
+
+  if( validateArguments == itk::CommandLineArgumentParser::FAILED )
+  {
+    return EXIT_FAILURE;
+  }
+  else if( validateArguments == itk::CommandLineArgumentParser::HELPREQUESTED )
+  {
+    return EXIT_SUCCESS;
+  }
+
+  std::string inputFileName = "";
+  clParser->GetCommandLineArgument( "-in", inputFileName );
+
+  std::string outputFileName = "";
+  clParser->GetCommandLineArgument( "-out", outputFileName );
+
+  /** Open the files. */
+  std::ifstream input( inputFileName.c_str(), std::ios::in | std::ios::binary );
+  if( !input.is_open() )
+  {
+    std::cerr << "ERROR: the file \"" << inputFileName << "\" could not be opened." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::ofstream outputFile;
+  if( !outputFileName.empty() )
+  {
+    outputFile.open( outputFileName.c_str() );
+    if( !outputFile.is_open() )
+    {
+      std::cerr << "ERROR: the file \"" << outputFileName << "\" could not be opened." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  std::ostream & output = outputFileName.empty() ? std::cout : outputFile;
+
+  /** Convert. */
+  if( xoutlibrary::xoutrow< char >::ConvertBinaryToText( input, output ) != 0 )
+  {
+    std::cerr << "ERROR: \"" << inputFileName << "\" is not a valid binary IterationInfo file." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+
+} // end main
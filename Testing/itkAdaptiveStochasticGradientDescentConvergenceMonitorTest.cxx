@@ -0,0 +1,220 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "AdaptiveStochasticGradientDescent/itkAdaptiveStochasticGradientDescentOptimizer.h"
+#include "itkSingleValuedCostFunction.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+// This test tests the convergence monitor of the AdaptiveStochasticGradientDescentOptimizer.
+// A quadratic cost function, with noise on the derivative to mimic stochastic gradients,
+// is minimized with and without the monitor. Without the monitor, the maximum number of
+// iterations should be used. With the monitor, the optimization should stop early with
+// the ConvergenceDetected stop condition, at almost the same value.
+
+namespace
+{
+
+/** A quadratic cost function with a noisy derivative. */
+class QuadraticCostFunction : public itk::SingleValuedCostFunction
+{
+public:
+
+  typedef QuadraticCostFunction               Self;
+  typedef itk::SingleValuedCostFunction       Superclass;
+  typedef itk::SmartPointer< Self >           Pointer;
+  typedef itk::SmartPointer< const Self >     ConstPointer;
+  typedef Superclass::MeasureType             MeasureType;
+  typedef Superclass::DerivativeType          DerivativeType;
+  typedef Superclass::ParametersType          ParametersType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+
+  itkNewMacro( Self );
+  itkTypeMacro( QuadraticCostFunction, SingleValuedCostFunction );
+
+  itkStaticConstMacro( NumberOfParameters, unsigned int, 20 );
+
+  /** Set the standard deviation of the derivative noise, and reset the noise. */
+  void SetNoise( double noise )
+  {
+    this->m_Noise = noise;
+    this->m_RandomGenerator->Initialize( 1 );
+  }
+
+  virtual unsigned int GetNumberOfParameters( void ) const
+  {
+    return NumberOfParameters;
+  }
+
+  virtual MeasureType GetValue( const ParametersType & parameters ) const
+  {
+    MeasureType value = 0.0;
+    for( unsigned int i = 0; i < NumberOfParameters; ++i )
+    {
+      const double d = parameters[ i ] - this->GetTarget( i );
+      value += 0.5 * this->GetCurvature( i ) * d * d;
+    }
+    return value;
+  }
+
+  virtual void GetDerivative( const ParametersType & parameters,
+    DerivativeType & derivative ) const
+  {
+    derivative.SetSize( NumberOfParameters );
+    for( unsigned int i = 0; i < NumberOfParameters; ++i )
+    {
+      derivative[ i ] = this->GetCurvature( i ) * ( parameters[ i ] - this->GetTarget( i ) )
+        + this->m_Noise * this->m_RandomGenerator->GetNormalVariate( 0.0, 1.0 );
+    }
+  }
+
+  virtual void GetValueAndDerivative( const ParametersType & parameters,
+    MeasureType & value, DerivativeType & derivative ) const
+  {
+    value = this->GetValue( parameters );
+    this->GetDerivative( parameters, derivative );
+  }
+
+  double GetTarget( unsigned int i ) const
+  {
+    return 5.0 * std::sin( 1.3 * i + 0.4 );
+  }
+
+  double GetCurvature( unsigned int i ) const
+  {
+    return 0.2 + 0.2 * ( i % 5 );
+  }
+
+protected:
+
+  QuadraticCostFunction()
+  {
+    this->m_Noise           = 0.0;
+    this->m_RandomGenerator = RandomGeneratorType::New();
+    this->m_RandomGenerator->Initialize( 1 );
+  }
+
+  virtual ~QuadraticCostFunction() {}
+
+private:
+
+  QuadraticCostFunction( const Self & ); // purposely not implemented
+  void operator=( const Self & );        // purposely not implemented
+
+  double                       m_Noise;
+  RandomGeneratorType::Pointer m_RandomGenerator;
+
+};
+
+typedef itk::AdaptiveStochasticGradientDescentOptimizer OptimizerType;
+
+//-------------------------------------------------------------------------------------
+// Runs the optimizer, and returns the final value.
+double
+Optimize( OptimizerType * optimizer, QuadraticCostFunction * costFunction,
+  double noise, bool useConvergenceMonitor )
+{
+  costFunction->SetNoise( noise );
+
+  OptimizerType::ParametersType initialPosition(
+    QuadraticCostFunction::NumberOfParameters );
+  initialPosition.Fill( 0.0 );
+
+  optimizer->SetCostFunction( costFunction );
+  optimizer->SetInitialPosition( initialPosition );
+  optimizer->SetNumberOfIterations( 1000 );
+  optimizer->SetParam_a( 2.0 );
+  optimizer->SetParam_A( 20.0 );
+  optimizer->SetParam_alpha( 0.602 );
+  optimizer->SetUseAdaptiveStepSizes( false );
+  optimizer->SetUseConvergenceMonitor( useConvergenceMonitor );
+  optimizer->StartOptimization();
+
+  return costFunction->GetValue( optimizer->GetCurrentPosition() );
+}
+
+
+} // end namespace
+
+int
+main( int argc, char * argv[] )
+{
+  QuadraticCostFunction::Pointer costFunction = QuadraticCostFunction::New();
+  OptimizerType::Pointer         optimizer    = OptimizerType::New();
+
+  OptimizerType::ParametersType zero( QuadraticCostFunction::NumberOfParameters );
+  zero.Fill( 0.0 );
+  const double initialValue = costFunction->GetValue( zero );
+
+  const double noises[ 2 ] = { 0.0, 0.1 };
+  for( unsigned int n = 0; n < 2; ++n )
+  {
+    double valueWithout = 0.0;
+    double valueWith    = 0.0;
+    try
+    {
+      valueWithout = Optimize( optimizer, costFunction, noises[ n ], false );
+      if( optimizer->GetStopCondition() != OptimizerType::MaximumNumberOfIterations
+        || optimizer->GetCurrentIteration() != optimizer->GetNumberOfIterations() )
+      {
+        std::cerr << "ERROR: without the convergence monitor the optimization "
+                  << "stopped early." << std::endl;
+        return EXIT_FAILURE;
+      }
+
+      valueWith = Optimize( optimizer, costFunction, noises[ n ], true );
+    }
+    catch( itk::ExceptionObject & e )
+    {
+      std::cerr << e << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    const unsigned long usedIterations = optimizer->GetCurrentIteration() + 1;
+    std::cout << "Noise " << noises[ n ]
+              << ": without monitor " << valueWithout
+              << ", with monitor " << valueWith
+              << " after " << usedIterations << " iterations" << std::endl;
+
+    if( optimizer->GetStopCondition() != OptimizerType::ConvergenceDetected
+      || usedIterations > optimizer->GetNumberOfIterations() / 2
+      || usedIterations % optimizer->GetConvergenceMonitorInterval() != 0 )
+    {
+      std::cerr << "ERROR: the convergence monitor did not stop the optimization "
+                << "at an evaluation in the first half of the iterations." << std::endl;
+      return EXIT_FAILURE;
+    }
+    if( valueWith > valueWithout + 1e-3 * initialValue )
+    {
+      std::cerr << "ERROR: the convergence monitor stopped too early." << std::endl;
+      return EXIT_FAILURE;
+    }
+    if( optimizer->GetConvergenceMonitorSmoothedGradientMagnitude() <= 0.0 )
+    {
+      std::cerr << "ERROR: the smoothed gradient magnitude is not computed." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,301 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "AdvancedNormalizedCorrelation/itkAdvancedNormalizedCorrelationImageToImageMetric.h"
+#include "AdvancedMattesMutualInformation/itkParzenWindowMutualInformationImageToImageMetric.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkRecursiveBSplineTransform.h"
+#include "itkAdvancedLinearInterpolateImageFunction.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkImageFullSampler.h"
+#include "itkImageRegionIterator.h"
+
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+//------------------------------------------------------------------------------
+// This test compares the compile-time specialized kernels of the metrics with
+// the generic kernel. The value and derivative of the AdvancedMeanSquares,
+// AdvancedNormalizedCorrelation and ParzenWindowMutualInformation metrics are
+// computed with UseFastPathKernels off and on, for each transform and
+// interpolator for which a FastSampleEvaluator exists:
+// - an affine, a B-spline and a recursive B-spline transform,
+// - a linear and a B-spline interpolator,
+// used directly, as current transform of a combination transform, and with a
+// composed initial transform. It is also checked that SelectFastPathKernel()
+// falls back to the generic kernel for an added initial transform and for an
+// interpolator without evaluator. The specialized kernels call the same
+// functions in the same order, so the results should be equal up to rounding.
+
+namespace
+{
+const unsigned int Dimension = 2;
+typedef float                                    PixelType;
+typedef itk::Image< PixelType, Dimension >       ImageType;
+typedef itk::AdvancedImageToImageMetric<
+  ImageType, ImageType >                         MetricType;
+typedef MetricType::MeasureType                  MeasureType;
+typedef MetricType::DerivativeType               DerivativeType;
+typedef MetricType::TransformParametersType      ParametersType;
+
+//------------------------------------------------------------------------------
+// Computes the value and derivative of the metric with UseFastPathKernels off
+// and on, and returns whether the expected kernel is selected and the results
+// are the same within the tolerance.
+bool
+CompareGenericAndFastPath( MetricType * metric, const ParametersType & parameters,
+  const std::string & name, const bool expectFastPath, const double tolerance )
+{
+  MeasureType    value[ 2 ];
+  DerivativeType derivative[ 2 ];
+  for( unsigned int d = 0; d < 2; ++d )
+  {
+    const bool useFastPath = ( d == 1 );
+    metric->SetUseFastPathKernels( useFastPath );
+    metric->Initialize();
+    if( metric->GetUsesFastPathKernel() != ( useFastPath && expectFastPath ) )
+    {
+      std::cerr << "ERROR: " << name << ": the specialized kernel is "
+                << ( metric->GetUsesFastPathKernel() ? "" : "not " ) << "selected." << std::endl;
+      return false;
+    }
+    metric->GetValueAndDerivative( parameters, value[ d ], derivative[ d ] );
+  }
+
+  /** Compare the value and the derivative, relative to their magnitude. */
+  const double valueError = std::abs( value[ 1 ] - value[ 0 ] )
+    / std::max( std::abs( value[ 0 ] ), 1e-8 );
+  double maxDifference = 0.0;
+  for( unsigned int i = 0; i < derivative[ 0 ].GetSize(); ++i )
+  {
+    maxDifference = std::max( maxDifference, std::abs( derivative[ 1 ][ i ] - derivative[ 0 ][ i ] ) );
+  }
+  const double derivativeError = maxDifference
+    / std::max( derivative[ 0 ].inf_norm(), 1e-8 );
+  std::cout << name << ( expectFastPath ? " (specialized)" : " (generic)" )
+            << " value: " << value[ 0 ]
+            << ", relative difference of value: " << valueError
+            << ", of derivative: " << derivativeError << std::endl;
+
+  if( valueError > tolerance || derivativeError > tolerance )
+  {
+    std::cerr << "ERROR: " << name << ": the specialized kernel differs from the generic kernel." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+} // end namespace
+
+int
+main( int argc, char * argv[] )
+{
+  typedef itk::AdvancedMeanSquaresImageToImageMetric<
+    ImageType, ImageType >                                   MeanSquaresMetricType;
+  typedef itk::AdvancedNormalizedCorrelationImageToImageMetric<
+    ImageType, ImageType >                                   NormalizedCorrelationMetricType;
+  typedef itk::ParzenWindowMutualInformationImageToImageMetric<
+    ImageType, ImageType >                                   MutualInformationMetricType;
+  typedef itk::AdvancedCombinationTransform< double, Dimension > CombinationTransformType;
+  typedef CombinationTransformType::CurrentTransformType     CurrentTransformType;
+  typedef itk::AdvancedMatrixOffsetTransformBase<
+    double, Dimension, Dimension >                           AffineTransformType;
+  typedef itk::AdvancedBSplineDeformableTransform<
+    double, Dimension, 3 >                                   BSplineTransformType;
+  typedef itk::RecursiveBSplineTransform<
+    double, Dimension, 3 >                                   RecursiveBSplineTransformType;
+  typedef MetricType::InterpolatorType                       InterpolatorType;
+  typedef itk::AdvancedLinearInterpolateImageFunction<
+    ImageType, double >                                      LinearInterpolatorType;
+  typedef itk::BSplineInterpolateImageFunction<
+    ImageType, double, double >                              BSplineInterpolatorType;
+  typedef itk::LinearInterpolateImageFunction<
+    ImageType, double >                                      GenericInterpolatorType;
+  typedef itk::ImageFullSampler< ImageType >                 SamplerType;
+  typedef itk::ImageRegionIterator< ImageType >              IteratorType;
+
+  const double tolerance = 1e-10;
+
+  try
+  {
+    /** Create a fixed and a moving image with a shifted blob. */
+    ImageType::SizeType imageSize;
+    imageSize.Fill( 64 );
+    ImageType::Pointer fixedImage  = ImageType::New();
+    ImageType::Pointer movingImage = ImageType::New();
+    fixedImage->SetRegions( imageSize );
+    fixedImage->Allocate();
+    movingImage->SetRegions( imageSize );
+    movingImage->Allocate();
+    IteratorType fit( fixedImage, fixedImage->GetLargestPossibleRegion() );
+    IteratorType mit( movingImage, movingImage->GetLargestPossibleRegion() );
+    for( fit.GoToBegin(), mit.GoToBegin(); !fit.IsAtEnd(); ++fit, ++mit )
+    {
+      const ImageType::IndexType index = fit.GetIndex();
+      const double               x     = index[ 0 ] - 32.0;
+      const double               y     = index[ 1 ] - 32.0;
+      fit.Set( static_cast< PixelType >( 100.0 * std::exp( -( x * x + y * y ) / 200.0 ) ) );
+      mit.Set( static_cast< PixelType >( 100.0 * std::exp(
+        -( ( x - 2.3 ) * ( x - 2.3 ) + ( y + 1.7 ) * ( y + 1.7 ) ) / 250.0 ) ) );
+    }
+
+    /** Create an affine transform, with a small rotation and translation. */
+    AffineTransformType::Pointer affine = AffineTransformType::New();
+    ParametersType               affineParameters( affine->GetNumberOfParameters() );
+    affineParameters.Fill( 0.0 );
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      affineParameters[ i * Dimension + i ] = 1.0;
+      affineParameters[ Dimension * Dimension + i ] = 0.8 * ( i + 1.0 );
+    }
+    affineParameters[ 1 ] = 0.03;
+    affineParameters[ 2 ] = -0.02;
+
+    /** Create an initial transform, with another small rotation and translation. */
+    AffineTransformType::Pointer initial = AffineTransformType::New();
+    ParametersType               initialParameters( affineParameters );
+    initialParameters[ 1 ] = -0.01;
+    initialParameters[ 2 ] = 0.015;
+    initialParameters[ Dimension * Dimension ] = -0.6;
+    initial->SetParameters( initialParameters );
+
+    /** Create a B-spline and a recursive B-spline transform, with some deformation. */
+    BSplineTransformType::Pointer          bspline          = BSplineTransformType::New();
+    RecursiveBSplineTransformType::Pointer recursiveBSpline = RecursiveBSplineTransformType::New();
+    BSplineTransformType::SizeType         gridSize;
+    BSplineTransformType::SpacingType      gridSpacing;
+    BSplineTransformType::OriginType       gridOrigin;
+    BSplineTransformType::DirectionType    gridDirection;
+    gridSize.Fill( 10 );
+    gridSpacing.Fill( 8.0 );
+    gridOrigin.Fill( -9.0 );
+    gridDirection.SetIdentity();
+    BSplineTransformType::RegionType gridRegion;
+    gridRegion.SetSize( gridSize );
+    BSplineTransformType * bsplines[ 2 ] = { bspline.GetPointer(), recursiveBSpline.GetPointer() };
+    for( unsigned int b = 0; b < 2; ++b )
+    {
+      bsplines[ b ]->SetGridRegion( gridRegion );
+      bsplines[ b ]->SetGridSpacing( gridSpacing );
+      bsplines[ b ]->SetGridOrigin( gridOrigin );
+      bsplines[ b ]->SetGridDirection( gridDirection );
+    }
+    ParametersType bsplineParameters( bspline->GetNumberOfParameters() );
+    for( unsigned int i = 0; i < bsplineParameters.GetSize(); ++i )
+    {
+      bsplineParameters[ i ] = 0.7 * std::sin( 0.37 * i );
+    }
+
+    CurrentTransformType::Pointer transforms[ 3 ] = {
+      affine.GetPointer(), bspline.GetPointer(), recursiveBSpline.GetPointer() };
+    const ParametersType transformParameters[ 3 ] = {
+      affineParameters, bsplineParameters, bsplineParameters };
+    const std::string    transformNames[ 3 ] = { "Affine", "BSpline", "RecursiveBSpline" };
+
+    /** The ways to use the transform: directly, as current transform of a
+     * combination transform, with a composed and with an added initial transform.
+     * The added initial transform has no specialized kernel.
+     */
+    const std::string wrapperNames[ 4 ] = { "", "Combination", "Composed", "Added" };
+
+    /** Create the interpolators. The last one has no specialized kernel. */
+    BSplineInterpolatorType::Pointer bsplineInterpolator = BSplineInterpolatorType::New();
+    bsplineInterpolator->SetSplineOrder( 3 );
+    InterpolatorType::Pointer interpolators[ 3 ] = {
+      LinearInterpolatorType::New().GetPointer(),
+      bsplineInterpolator.GetPointer(),
+      GenericInterpolatorType::New().GetPointer() };
+    const std::string interpolatorNames[ 3 ] = { "Linear", "BSpline", "GenericLinear" };
+
+    /** Create the metrics. */
+    MeanSquaresMetricType::Pointer           meanSquares           = MeanSquaresMetricType::New();
+    NormalizedCorrelationMetricType::Pointer normalizedCorrelation = NormalizedCorrelationMetricType::New();
+    MutualInformationMetricType::Pointer     mutualInformation     = MutualInformationMetricType::New();
+    mutualInformation->SetNumberOfFixedHistogramBins( 32 );
+    mutualInformation->SetNumberOfMovingHistogramBins( 32 );
+    mutualInformation->SetUseExplicitPDFDerivatives( false );
+
+    MetricType::Pointer metrics[ 3 ] = {
+      meanSquares.GetPointer(), normalizedCorrelation.GetPointer(), mutualInformation.GetPointer() };
+    const std::string metricNames[ 3 ] = { "MeanSquares", "NormalizedCorrelation", "MutualInformation" };
+
+    for( unsigned int t = 0; t < 3; ++t )
+    {
+      for( unsigned int w = 0; w < 4; ++w )
+      {
+        MetricType::TransformPointer transform;
+        if( w == 0 )
+        {
+          transform = transforms[ t ].GetPointer();
+        }
+        else
+        {
+          CombinationTransformType::Pointer combination = CombinationTransformType::New();
+          combination->SetCurrentTransform( transforms[ t ] );
+          if( w > 1 )
+          {
+            combination->SetInitialTransform( initial );
+            combination->SetUseComposition( w == 2 );
+          }
+          transform = combination.GetPointer();
+        }
+        transform->SetParameters( transformParameters[ t ] );
+
+        for( unsigned int i = 0; i < 3; ++i )
+        {
+          const bool expectFastPath = ( w != 3 && i != 2 );
+          for( unsigned int m = 0; m < 3; ++m )
+          {
+            MetricType * metric = metrics[ m ];
+            metric->SetFixedImage( fixedImage );
+            metric->SetMovingImage( movingImage );
+            metric->SetFixedImageRegion( fixedImage->GetLargestPossibleRegion() );
+            metric->SetTransform( transform );
+            metric->SetInterpolator( interpolators[ i ] );
+            metric->SetImageSampler( SamplerType::New() );
+            metric->SetNumberOfThreads( 2 );
+
+            const std::string name = metricNames[ m ] + " " + wrapperNames[ w ]
+              + transformNames[ t ] + " " + interpolatorNames[ i ];
+            if( !CompareGenericAndFastPath( metric, transformParameters[ t ],
+              name, expectFastPath, tolerance ) )
+            {
+              return EXIT_FAILURE;
+            }
+          }
+        }
+      }
+    }
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "Caught ITK exception: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,149 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkImageFullSampler.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkImageRegionIterator.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+// This test tests the multi-threaded assembly of the SelfHessian of the
+// AdvancedMeanSquares metric. Each thread adds the contributions of all samples to
+// its own rows of the matrix, in the order of the samples. Repeated computations with
+// 4 threads and the computation with 1 thread should therefore be bitwise equal.
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int Dimension   = 2;
+  const unsigned int SplineOrder = 3;
+  typedef float                                   PixelType;
+  typedef itk::Image< PixelType, Dimension >      ImageType;
+  typedef itk::ImageRegionIterator< ImageType >   IteratorType;
+  typedef itk::AdvancedMeanSquaresImageToImageMetric<
+    ImageType, ImageType >                        MetricType;
+  typedef MetricType::CSRHessianType              CSRHessianType;
+  typedef CSRHessianType::ValuesType              ValuesType;
+  typedef itk::AdvancedBSplineDeformableTransform<
+    double, Dimension, SplineOrder >              TransformType;
+  typedef TransformType::ParametersType           ParametersType;
+  typedef itk::ImageFullSampler< ImageType >      SamplerType;
+  typedef itk::LinearInterpolateImageFunction<
+    ImageType, double >                           InterpolatorType;
+
+  /** Create a fixed and a moving image with a shifted blob. */
+  ImageType::SizeType imageSize;
+  imageSize.Fill( 96 );
+  ImageType::Pointer fixedImage  = ImageType::New();
+  ImageType::Pointer movingImage = ImageType::New();
+  fixedImage->SetRegions( imageSize );
+  fixedImage->Allocate();
+  movingImage->SetRegions( imageSize );
+  movingImage->Allocate();
+  IteratorType fit( fixedImage, fixedImage->GetLargestPossibleRegion() );
+  IteratorType mit( movingImage, movingImage->GetLargestPossibleRegion() );
+  for( fit.GoToBegin(), mit.GoToBegin(); !fit.IsAtEnd(); ++fit, ++mit )
+  {
+    const ImageType::IndexType index = fit.GetIndex();
+    const double               x     = index[ 0 ] - 48.0;
+    const double               y     = index[ 1 ] - 48.0;
+    fit.Set( static_cast< PixelType >( 100.0 * std::exp( -( x * x + y * y ) / 400.0 ) ) );
+    mit.Set( static_cast< PixelType >( 100.0 * std::exp( -( ( x - 3.3 ) * ( x - 3.3 ) + y * y ) / 500.0 ) ) );
+  }
+
+  /** Create a B-spline transform. */
+  TransformType::Pointer       transform = TransformType::New();
+  TransformType::SizeType      gridSize;
+  TransformType::SpacingType   gridSpacing;
+  TransformType::OriginType    gridOrigin;
+  TransformType::DirectionType gridDirection;
+  gridSize.Fill( 12 );
+  gridSpacing.Fill( 10.0 );
+  gridOrigin.Fill( -12.0 );
+  gridDirection.SetIdentity();
+  TransformType::RegionType gridRegion;
+  gridRegion.SetSize( gridSize );
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridDirection( gridDirection );
+  ParametersType parameters( transform->GetNumberOfParameters() );
+  parameters.Fill( 0.0 );
+  transform->SetParameters( parameters );
+
+  /** Create the metric. */
+  SamplerType::Pointer      sampler      = SamplerType::New();
+  InterpolatorType::Pointer interpolator = InterpolatorType::New();
+  MetricType::Pointer       metric       = MetricType::New();
+  metric->SetFixedImage( fixedImage );
+  metric->SetMovingImage( movingImage );
+  metric->SetFixedImageRegion( fixedImage->GetLargestPossibleRegion() );
+  metric->SetTransform( transform );
+  metric->SetInterpolator( interpolator );
+  metric->SetImageSampler( sampler );
+  metric->SetNumberOfSamplesForSelfHessian( 5000 );
+
+  /** Compute the SelfHessian with 1 thread, and three times with 4 threads. */
+  const unsigned int numberOfRuns = 4;
+  ValuesType         values[ numberOfRuns ];
+  CSRHessianType     reference;
+  for( unsigned int run = 0; run < numberOfRuns; ++run )
+  {
+    CSRHessianType H;
+    try
+    {
+      metric->SetNumberOfThreads( run == 0 ? 1 : 4 );
+      metric->Initialize();
+      metric->GetCompressedSelfHessian( parameters, H );
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      std::cerr << excp << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    if( run == 0 )
+    {
+      reference = H;
+    }
+    else if( !H.HasSamePattern( reference ) )
+    {
+      std::cerr << "ERROR: the pattern depends on the number of threads." << std::endl;
+      return EXIT_FAILURE;
+    }
+    values[ run ] = H.GetValues();
+  }
+
+  /** All runs should be bitwise equal. */
+  for( unsigned int run = 1; run < numberOfRuns; ++run )
+  {
+    if( values[ run ] != values[ 0 ] )
+    {
+      std::cerr << "ERROR: the SelfHessian with 4 threads differs from that with 1 thread." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
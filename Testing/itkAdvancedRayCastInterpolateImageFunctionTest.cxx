@@ -0,0 +1,129 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkAdvancedRayCastInterpolateImageFunction.h"
+#include "itkEuler3DTransform.h"
+#include "itkImage.h"
+#include "itkImageRegionIterator.h"
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+// This test tests the reuse of the volume geometry by the
+// AdvancedRayCastInterpolateImageFunction. A DRR of a synthetic volume is rendered
+// with Evaluate() per detector point. Evaluate() reuses the volume geometry computed
+// by SetInputImage(). When the spacing of the volume changes afterwards, it should
+// give the same result as an interpolator that is set up for the new spacing.
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int Dimension = 3;
+  typedef float                                        PixelType;
+  typedef itk::Image< PixelType, Dimension >           ImageType;
+  typedef itk::AdvancedRayCastInterpolateImageFunction<
+    ImageType, double >                                RayCastInterpolatorType;
+  typedef RayCastInterpolatorType::PointType           PointType;
+  typedef std::vector< PointType >                     PointContainerType;
+  typedef itk::Euler3DTransform< double >              TransformType;
+
+  /** Create a volume with a smooth blob on a background of 50. */
+  ImageType::SizeType size;
+  size.Fill( 64 );
+  ImageType::SpacingType spacing;
+  spacing.Fill( 1.0 );
+  ImageType::Pointer volume = ImageType::New();
+  volume->SetRegions( size );
+  volume->SetSpacing( spacing );
+  volume->Allocate();
+  itk::ImageRegionIterator< ImageType > it( volume, volume->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const ImageType::IndexType index = it.GetIndex();
+    const double               x     = index[ 0 ] - 28.0;
+    const double               y     = index[ 1 ] - 34.0;
+    const double               z     = index[ 2 ] - 30.0;
+    it.Set( static_cast< PixelType >( 50.0 + 100.0 * std::exp( -( x * x + 2.0 * y * y + z * z ) / 300.0 ) ) );
+  }
+
+  /** A small rotation and translation of the volume. */
+  TransformType::Pointer transform = TransformType::New();
+  transform->SetRotation( 0.05, -0.03, 0.1 );
+  TransformType::OutputVectorType translation;
+  translation[ 0 ] = 2.0; translation[ 1 ] = -1.5; translation[ 2 ] = 3.0;
+  transform->SetTranslation( translation );
+
+  /** The detector plane and focal point. */
+  PointType focalPoint;
+  focalPoint[ 0 ] = 0.0; focalPoint[ 1 ] = 0.0; focalPoint[ 2 ] = -500.0;
+  const unsigned int detectorSize = 96;
+  PointContainerType points;
+  for( unsigned int j = 0; j < detectorSize; ++j )
+  {
+    for( unsigned int i = 0; i < detectorSize; ++i )
+    {
+      PointType point;
+      point[ 0 ] = 1.25 * i - 60.0;
+      point[ 1 ] = 1.25 * j - 60.0;
+      point[ 2 ] = 200.0;
+      points.push_back( point );
+    }
+  }
+
+  RayCastInterpolatorType::Pointer interpolator = RayCastInterpolatorType::New();
+  interpolator->SetInputImage( volume );
+  interpolator->SetTransform( transform );
+  interpolator->SetFocalPoint( focalPoint );
+  interpolator->SetThreshold( 20.0 );
+
+  /** Render the DRR by Evaluate() per detector point. */
+  double drrSum = 0.0;
+  for( std::size_t i = 0; i < points.size(); ++i )
+  {
+    drrSum += interpolator->Evaluate( transform->TransformPoint( points[ i ] ) );
+  }
+  if( !( drrSum > 0.0 ) )
+  {
+    std::cerr << "ERROR: the rays do not pass through the volume." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Change the spacing of the volume after SetInputImage(). */
+  spacing.Fill( 1.25 );
+  volume->SetSpacing( spacing );
+  RayCastInterpolatorType::Pointer newInterpolator = RayCastInterpolatorType::New();
+  newInterpolator->SetInputImage( volume );
+  newInterpolator->SetTransform( transform );
+  newInterpolator->SetFocalPoint( focalPoint );
+  newInterpolator->SetThreshold( 20.0 );
+  for( std::size_t i = 0; i < points.size(); ++i )
+  {
+    const PointType point = transform->TransformPoint( points[ i ] );
+    if( interpolator->Evaluate( point ) != newInterpolator->Evaluate( point ) )
+    {
+      std::cerr << "ERROR: Evaluate() does not use the new spacing of the volume." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
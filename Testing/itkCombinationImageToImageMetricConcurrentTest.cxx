@@ -0,0 +1,246 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "MultiMetricMultiResolutionRegistration/itkCombinationImageToImageMetric.h"
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "AdvancedNormalizedCorrelation/itkAdvancedNormalizedCorrelationImageToImageMetric.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkImageFullSampler.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkImageRegionIterator.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+// This test tests the concurrent evaluation of the sub-metrics of the
+// CombinationImageToImageMetric. The combined value and derivative, and those of the
+// sub-metrics, are computed sequentially and with UseConcurrentMetricEvaluation, and
+// should be equal up to the summation order of the multi-threaded sub-metrics. The
+// concurrent evaluation is repeated, since the threads are divided over the metrics
+// from the timings of the previous evaluation. Finally, the derivatives combined by
+// the threads (UseMultiThreadedDerivativeCombination) should be bitwise equal to
+// those combined afterwards by a single thread, with fixed and relative weights.
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int Dimension   = 2;
+  const unsigned int SplineOrder = 3;
+  typedef float                                   PixelType;
+  typedef itk::Image< PixelType, Dimension >      ImageType;
+  typedef itk::ImageRegionIterator< ImageType >   IteratorType;
+  typedef itk::CombinationImageToImageMetric<
+    ImageType, ImageType >                        CombinationMetricType;
+  typedef itk::AdvancedMeanSquaresImageToImageMetric<
+    ImageType, ImageType >                        MeanSquaresMetricType;
+  typedef itk::AdvancedNormalizedCorrelationImageToImageMetric<
+    ImageType, ImageType >                        NormalizedCorrelationMetricType;
+  typedef CombinationMetricType::MeasureType      MeasureType;
+  typedef CombinationMetricType::DerivativeType   DerivativeType;
+  typedef itk::AdvancedBSplineDeformableTransform<
+    double, Dimension, SplineOrder >              TransformType;
+  typedef TransformType::ParametersType           ParametersType;
+  typedef itk::ImageFullSampler< ImageType >      SamplerType;
+  typedef itk::LinearInterpolateImageFunction<
+    ImageType, double >                           InterpolatorType;
+
+  /** Create a fixed and a moving image with a shifted blob. */
+  ImageType::SizeType imageSize;
+  imageSize.Fill( 96 );
+  ImageType::Pointer fixedImage  = ImageType::New();
+  ImageType::Pointer movingImage = ImageType::New();
+  fixedImage->SetRegions( imageSize );
+  fixedImage->Allocate();
+  movingImage->SetRegions( imageSize );
+  movingImage->Allocate();
+  IteratorType fit( fixedImage, fixedImage->GetLargestPossibleRegion() );
+  IteratorType mit( movingImage, movingImage->GetLargestPossibleRegion() );
+  for( fit.GoToBegin(), mit.GoToBegin(); !fit.IsAtEnd(); ++fit, ++mit )
+  {
+    const ImageType::IndexType index = fit.GetIndex();
+    const double               x     = index[ 0 ] - 48.0;
+    const double               y     = index[ 1 ] - 48.0;
+    fit.Set( static_cast< PixelType >( 100.0 * std::exp( -( x * x + y * y ) / 400.0 ) ) );
+    mit.Set( static_cast< PixelType >( 100.0 * std::exp( -( ( x - 3.3 ) * ( x - 3.3 ) + y * y ) / 500.0 ) ) );
+  }
+
+  /** Create a B-spline transform, with some deformation. */
+  TransformType::Pointer       transform = TransformType::New();
+  TransformType::SizeType      gridSize;
+  TransformType::SpacingType   gridSpacing;
+  TransformType::OriginType    gridOrigin;
+  TransformType::DirectionType gridDirection;
+  gridSize.Fill( 12 );
+  gridSpacing.Fill( 10.0 );
+  gridOrigin.Fill( -12.0 );
+  gridDirection.SetIdentity();
+  TransformType::RegionType gridRegion;
+  gridRegion.SetSize( gridSize );
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridDirection( gridDirection );
+
+  ParametersType parameters( transform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = 0.7 * std::sin( 0.37 * i );
+  }
+  transform->SetParameters( parameters );
+
+  /** Create two sub-metrics that support concurrent evaluation, each with its own sampler. */
+  MeanSquaresMetricType::Pointer           meanSquares           = MeanSquaresMetricType::New();
+  NormalizedCorrelationMetricType::Pointer normalizedCorrelation = NormalizedCorrelationMetricType::New();
+  SamplerType::Pointer                     sampler0              = SamplerType::New();
+  SamplerType::Pointer                     sampler1              = SamplerType::New();
+  meanSquares->SetImageSampler( sampler0 );
+  normalizedCorrelation->SetImageSampler( sampler1 );
+  if( !meanSquares->GetSupportsConcurrentGetValueAndDerivative()
+    || !normalizedCorrelation->GetSupportsConcurrentGetValueAndDerivative() )
+  {
+    std::cerr << "ERROR: the sub-metrics should support concurrent evaluation." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Create the combination metric. */
+  InterpolatorType::Pointer      interpolator = InterpolatorType::New();
+  CombinationMetricType::Pointer metric       = CombinationMetricType::New();
+  metric->SetNumberOfMetrics( 2 );
+  metric->SetMetric( meanSquares, 0 );
+  metric->SetMetric( normalizedCorrelation, 1 );
+  metric->SetMetricWeight( 1.0, 0 );
+  metric->SetMetricWeight( 50.0, 1 );
+  metric->SetFixedImage( fixedImage );
+  metric->SetMovingImage( movingImage );
+  metric->SetFixedImageRegion( fixedImage->GetLargestPossibleRegion() );
+  metric->SetTransform( transform );
+  metric->SetInterpolator( interpolator );
+  metric->SetNumberOfThreads( 4 );
+
+  /** Compute sequentially, and concurrently a few times. */
+  const unsigned int numberOfRuns = 4;
+  MeasureType        referenceValue = 0.0;
+  DerivativeType     referenceDerivative;
+  MeasureType        referenceMetricValues[ 2 ];
+  DerivativeType     referenceMetricDerivatives[ 2 ];
+  double             maxError = 0.0;
+  for( unsigned int run = 0; run < numberOfRuns; ++run )
+  {
+    const bool     concurrent = ( run > 0 );
+    MeasureType    value      = 0.0;
+    DerivativeType derivative( parameters.GetSize() );
+    try
+    {
+      metric->SetUseConcurrentMetricEvaluation( concurrent );
+      metric->Initialize();
+      metric->GetValueAndDerivative( parameters, value, derivative );
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      std::cerr << excp << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    if( !concurrent )
+    {
+      referenceValue      = value;
+      referenceDerivative = derivative;
+      for( unsigned int i = 0; i < 2; ++i )
+      {
+        referenceMetricValues[ i ]      = metric->GetMetricValue( i );
+        referenceMetricDerivatives[ i ] = metric->GetMetricDerivative( i );
+      }
+      continue;
+    }
+
+    /** Compare relative to the magnitude of the reference. */
+    const double valueScale      = std::max( std::abs( referenceValue ), 1.0 );
+    const double derivativeScale = std::max( referenceDerivative.inf_norm(), 1.0 );
+    maxError = std::max( maxError, std::abs( value - referenceValue ) / valueScale );
+    for( unsigned int j = 0; j < derivative.GetSize(); ++j )
+    {
+      maxError = std::max( maxError, std::abs( derivative[ j ] - referenceDerivative[ j ] ) / derivativeScale );
+    }
+    for( unsigned int i = 0; i < 2; ++i )
+    {
+      const double metricValueScale = std::max( std::abs( referenceMetricValues[ i ] ), 1.0 );
+      const double metricDerivativeScale = std::max( referenceMetricDerivatives[ i ].inf_norm(), 1.0 );
+      maxError = std::max( maxError,
+        std::abs( metric->GetMetricValue( i ) - referenceMetricValues[ i ] ) / metricValueScale );
+      const DerivativeType & metricDerivative = metric->GetMetricDerivative( i );
+      for( unsigned int j = 0; j < metricDerivative.GetSize(); ++j )
+      {
+        maxError = std::max( maxError,
+          std::abs( metricDerivative[ j ] - referenceMetricDerivatives[ i ][ j ] ) / metricDerivativeScale );
+      }
+    }
+  }
+
+  std::cout << "Sequential value: " << referenceValue
+            << ", max relative difference of the concurrent evaluation: " << maxError << std::endl;
+  if( maxError > 1e-10 )
+  {
+    std::cerr << "ERROR: the concurrent evaluation differs from the sequential evaluation." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Combine the derivatives by the threads and by a single thread. */
+  metric->SetUseConcurrentMetricEvaluation( false );
+  metric->SetMetricRelativeWeight( 0.5, 0 );
+  metric->SetMetricRelativeWeight( 0.2, 1 );
+  for( unsigned int relative = 0; relative < 2; ++relative )
+  {
+    MeasureType    values[ 2 ];
+    DerivativeType derivatives[ 2 ];
+    double         magnitudes[ 2 ][ 2 ];
+    for( unsigned int threaded = 0; threaded < 2; ++threaded )
+    {
+      try
+      {
+        metric->SetUseRelativeWeights( relative == 1 );
+        metric->SetUseMultiThreadedDerivativeCombination( threaded == 1 );
+        metric->Initialize();
+        metric->GetValueAndDerivative( parameters, values[ threaded ], derivatives[ threaded ] );
+      }
+      catch( itk::ExceptionObject & excp )
+      {
+        std::cerr << excp << std::endl;
+        return EXIT_FAILURE;
+      }
+      for( unsigned int i = 0; i < 2; ++i )
+      {
+        magnitudes[ threaded ][ i ] = metric->GetMetricDerivativeMagnitude( i );
+      }
+    }
+
+    if( values[ 1 ] != values[ 0 ] || derivatives[ 1 ] != derivatives[ 0 ]
+      || magnitudes[ 1 ][ 0 ] != magnitudes[ 0 ][ 0 ] || magnitudes[ 1 ][ 1 ] != magnitudes[ 0 ][ 1 ] )
+    {
+      std::cerr << "ERROR: the multi-threaded combination of the derivatives differs from the "
+                << "single-threaded combination, with " << ( relative ? "relative" : "fixed" )
+                << " weights." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
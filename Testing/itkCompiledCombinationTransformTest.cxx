@@ -0,0 +1,232 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkAdvancedTranslationTransform.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkCompiledCombinationTransform.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTimeProbe.h"
+
+#include <iomanip>
+
+//-------------------------------------------------------------------------------------
+// This test tests the itkCompiledCombinationTransform.
+// A chain affine - translation - B-spline - affine is created, in the way
+// transformix creates it from a series of initial transforms. The compiled
+// chain should fold the first two stages, and map points exactly like the
+// original chain. When baked into a displacement grid, the error should be
+// small inside the grid. The evaluation of the chains is also timed.
+
+int
+main( int argc, char * argv[] )
+{
+  /** Some basic type definitions. */
+  const unsigned int Dimension    = 3;
+  const unsigned int SplineOrder  = 3;
+  typedef double ScalarType;
+  const double       distance     = 1e-8;   // the allowable distance for the folded chain
+  const double       maximumError = 0.05;   // the allowable distance for the baked chain
+  const unsigned int N            = 100000; // the number of tested points
+
+  /** Other typedefs. */
+  typedef itk::AdvancedCombinationTransform< ScalarType, Dimension >
+    CombinationTransformType;
+  typedef itk::AdvancedMatrixOffsetTransformBase< ScalarType, Dimension, Dimension >
+    AffineTransformType;
+  typedef itk::AdvancedTranslationTransform< ScalarType, Dimension >
+    TranslationTransformType;
+  typedef itk::AdvancedBSplineDeformableTransform< ScalarType, Dimension, SplineOrder >
+    BSplineTransformType;
+  typedef itk::CompiledCombinationTransform< ScalarType, Dimension >
+    CompiledTransformType;
+  typedef CombinationTransformType::InputPointType  InputPointType;
+  typedef CombinationTransformType::OutputPointType OutputPointType;
+  typedef BSplineTransformType::ImageType           ImageType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+
+  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
+  randomGenerator->Initialize( 1234 );
+
+  /** Create the stages. */
+  AffineTransformType::Pointer affine0 = AffineTransformType::New();
+  AffineTransformType::Pointer affine1 = AffineTransformType::New();
+  AffineTransformType::MatrixType matrix0, matrix1;
+  AffineTransformType::OutputVectorType offset0, offset1;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      matrix0( i, j ) = ( i == j ? 1.0 : 0.0 ) + randomGenerator->GetUniformVariate( -0.1, 0.1 );
+      matrix1( i, j ) = ( i == j ? 1.0 : 0.0 ) + randomGenerator->GetUniformVariate( -0.1, 0.1 );
+    }
+    offset0[ i ] = randomGenerator->GetUniformVariate( -5.0, 5.0 );
+    offset1[ i ] = randomGenerator->GetUniformVariate( -5.0, 5.0 );
+  }
+  affine0->SetMatrix( matrix0 );
+  affine0->SetOffset( offset0 );
+  affine1->SetMatrix( matrix1 );
+  affine1->SetOffset( offset1 );
+
+  TranslationTransformType::Pointer translation = TranslationTransformType::New();
+  TranslationTransformType::ParametersType translationParameters( Dimension );
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    translationParameters[ i ] = randomGenerator->GetUniformVariate( -5.0, 5.0 );
+  }
+  translation->SetParameters( translationParameters );
+
+  BSplineTransformType::Pointer bspline = BSplineTransformType::New();
+  ImageType::SizeType gridSize; gridSize.Fill( 10 );
+  ImageType::IndexType gridIndex; gridIndex.Fill( 0 );
+  ImageType::SpacingType gridSpacing; gridSpacing.Fill( 16.0 );
+  ImageType::PointType gridOrigin; gridOrigin.Fill( -40.0 );
+  ImageType::DirectionType gridDirection; gridDirection.SetIdentity();
+  bspline->SetGridRegion( ImageType::RegionType( gridIndex, gridSize ) );
+  bspline->SetGridSpacing( gridSpacing );
+  bspline->SetGridOrigin( gridOrigin );
+  bspline->SetGridDirection( gridDirection );
+  BSplineTransformType::ParametersType bsplineParameters( bspline->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < bsplineParameters.GetSize(); ++i )
+  {
+    bsplineParameters[ i ] = randomGenerator->GetUniformVariate( -2.0, 2.0 );
+  }
+  bspline->SetParameters( bsplineParameters );
+
+  /** Create the chain: T(x) = affine1( bspline( translation( affine0( x ) ) ) ). */
+  CombinationTransformType::Pointer combination0 = CombinationTransformType::New();
+  CombinationTransformType::Pointer combination1 = CombinationTransformType::New();
+  CombinationTransformType::Pointer combination2 = CombinationTransformType::New();
+  CombinationTransformType::Pointer combination3 = CombinationTransformType::New();
+  combination0->SetCurrentTransform( affine0 );
+  combination1->SetCurrentTransform( translation );
+  combination1->SetInitialTransform( combination0 );
+  combination2->SetCurrentTransform( bspline );
+  combination2->SetInitialTransform( combination1 );
+  combination3->SetCurrentTransform( affine1 );
+  combination3->SetInitialTransform( combination2 );
+
+  /** Compile the chain, without baking. */
+  CompiledTransformType::Pointer compiled = CompiledTransformType::New();
+  compiled->SetTransform( combination3 );
+  try
+  {
+    compiled->Compile();
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( compiled->GetNumberOfOriginalStages() != 4 || compiled->GetNumberOfStages() != 3 )
+  {
+    std::cerr << "ERROR: expected 4 stages to be folded into 3, got "
+              << compiled->GetNumberOfOriginalStages() << " and "
+              << compiled->GetNumberOfStages() << "." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Generate the test points, inside the domain of the grid used below. */
+  std::vector< InputPointType > points( N );
+  for( unsigned int k = 0; k < N; ++k )
+  {
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      points[ k ][ i ] = randomGenerator->GetUniformVariate( -20.0, 60.0 );
+    }
+  }
+
+  /** Compare the folded chain with the original one. */
+  itk::TimeProbe timer1, timer2, timer3;
+  std::vector< OutputPointType > exact( N );
+  timer1.Start();
+  for( unsigned int k = 0; k < N; ++k )
+  {
+    exact[ k ] = combination3->TransformPoint( points[ k ] );
+  }
+  timer1.Stop();
+
+  double maxDifference = 0.0;
+  timer2.Start();
+  for( unsigned int k = 0; k < N; ++k )
+  {
+    const OutputPointType p = compiled->TransformPoint( points[ k ] );
+    maxDifference = vnl_math_max( maxDifference, p.EuclideanDistanceTo( exact[ k ] ) );
+  }
+  timer2.Stop();
+
+  std::cerr << "folded chain: maximum difference: " << maxDifference << std::endl;
+  if( maxDifference > distance )
+  {
+    std::cerr << "ERROR: the folded chain is not equal to the original one." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Compile the chain, with baking. */
+  CompiledTransformType::GridSizeType    bakeSize; bakeSize.Fill( 81 );
+  CompiledTransformType::GridSpacingType bakeSpacing; bakeSpacing.Fill( 1.0 );
+  CompiledTransformType::GridOriginType  bakeOrigin; bakeOrigin.Fill( -20.0 );
+  compiled->BakeNonlinearStagesOn();
+  compiled->SetGridSize( bakeSize );
+  compiled->SetGridSpacing( bakeSpacing );
+  compiled->SetGridOrigin( bakeOrigin );
+  compiled->SetGridDirection( gridDirection );
+  compiled->SetMaximumBakingError( maximumError );
+  try
+  {
+    compiled->Compile();
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cerr << "baked chain: measured error: " << compiled->GetBakingError() << std::endl;
+  if( !compiled->GetIsBaked() )
+  {
+    std::cerr << "ERROR: the chain is not baked." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  maxDifference = 0.0;
+  timer3.Start();
+  for( unsigned int k = 0; k < N; ++k )
+  {
+    const OutputPointType p = compiled->TransformPoint( points[ k ] );
+    maxDifference = vnl_math_max( maxDifference, p.EuclideanDistanceTo( exact[ k ] ) );
+  }
+  timer3.Stop();
+
+  std::cerr << "baked chain: maximum difference: " << maxDifference << std::endl;
+  if( maxDifference > 2.0 * maximumError )
+  {
+    std::cerr << "ERROR: the baked chain is not close to the original one." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cerr << "Timing of " << N << " points:\n"
+            << "  original chain: " << std::setprecision( 4 ) << timer1.GetMean() << " s\n"
+            << "  folded chain:   " << timer2.GetMean() << " s\n"
+            << "  baked chain:    " << timer3.GetMean() << " s" << std::endl;
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,191 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkCompressedSparseRowMatrix.h"
+
+#include "vnl/vnl_sparse_matrix.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+// This test tests the CompressedSparseRowMatrix, which is used for the SelfHessian.
+// A banded upper triangular matrix is filled through AddToRow, both in a CSR matrix
+// and in a vnl_sparse_matrix, and the results are compared. Also the conversion to
+// vnl, the diagonal and the addition of matrices with different patterns are tested.
+
+int
+main( int argc, char * argv[] )
+{
+  typedef itk::CompressedSparseRowMatrix< double > MatrixType;
+  typedef MatrixType::IndexType                    IndexType;
+  typedef MatrixType::RowPointersType              RowPointersType;
+  typedef MatrixType::ColumnIndicesType            ColumnIndicesType;
+  typedef vnl_sparse_matrix< double >              VnlSparseMatrixType;
+
+  const IndexType n         = 50;
+  const IndexType bandwidth = 4;
+  const double    tolerance = 1e-12;
+
+  /** Create a banded upper triangular pattern. */
+  RowPointersType   rowPointers( n + 1, 0 );
+  ColumnIndicesType columns;
+  for( IndexType i = 0; i < n; ++i )
+  {
+    rowPointers[ i ] = columns.size();
+    for( IndexType j = i; j < n && j <= i + bandwidth; ++j )
+    {
+      columns.push_back( j );
+    }
+  }
+  rowPointers[ n ] = columns.size();
+
+  MatrixType H;
+  H.SetPattern( n, rowPointers, columns );
+  VnlSparseMatrixType reference( n, n );
+
+  /** Add some values, sorted, unsorted and partly outside the pattern. */
+  unsigned int missed         = 0;
+  unsigned int expectedMissed = 0;
+  for( unsigned int iter = 0; iter < 3; ++iter )
+  {
+    for( IndexType i = 0; i < n; ++i )
+    {
+      unsigned long cols[ 3 ];
+      double        vals[ 3 ];
+      cols[ 0 ] = i;
+      cols[ 1 ] = ( iter == 1 ) ? i + 3 : i + 1;
+      cols[ 2 ] = ( iter == 1 ) ? i + 1 : i + bandwidth + 1;
+      for( unsigned int k = 0; k < 3; ++k )
+      {
+        vals[ k ] = 1.0 + i + 0.1 * k + 0.01 * iter;
+        if( cols[ k ] < n && cols[ k ] <= i + bandwidth )
+        {
+          reference( i, cols[ k ] ) += vals[ k ];
+        }
+        else
+        {
+          ++expectedMissed;
+        }
+      }
+      missed += H.AddToRow( i, cols, vals, 3 );
+    }
+  }
+
+  if( missed != expectedMissed )
+  {
+    std::cerr << "ERROR: AddToRow missed " << missed
+              << " entries, while " << expectedMissed << " were expected." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Compare with the reference. */
+  for( IndexType i = 0; i < n; ++i )
+  {
+    for( IndexType j = 0; j < n; ++j )
+    {
+      if( std::abs( H.GetEntry( i, j ) - reference( i, j ) ) > tolerance )
+      {
+        std::cerr << "ERROR: entry (" << i << "," << j << ") is " << H.GetEntry( i, j )
+                  << ", while " << reference( i, j ) << " was expected." << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  /** Test the conversion to vnl. */
+  VnlSparseMatrixType converted;
+  H.GetVnlSparseMatrix( converted );
+  for( IndexType i = 0; i < n; ++i )
+  {
+    for( IndexType j = 0; j < n; ++j )
+    {
+      if( std::abs( converted( i, j ) - reference( i, j ) ) > tolerance )
+      {
+        std::cerr << "ERROR: the vnl_sparse_matrix differs at (" << i << "," << j << ")." << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  /** Test the diagonal. */
+  MatrixType::VnlVectorType diagonal;
+  H.GetDiagonal( diagonal );
+  for( IndexType i = 0; i < n; ++i )
+  {
+    if( std::abs( diagonal[ i ] - reference( i, i ) ) > tolerance )
+    {
+      std::cerr << "ERROR: the diagonal differs at " << i << "." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** Add a scaled identity, which has a different pattern. */
+  MatrixType I;
+  I.SetDiagonalPattern( n );
+  I.Fill( 1.0 );
+  if( H.Add( I, 2.0 ) != 0 )
+  {
+    std::cerr << "ERROR: the identity does not fit in the banded pattern." << std::endl;
+    return EXIT_FAILURE;
+  }
+  for( IndexType i = 0; i < n; ++i )
+  {
+    if( std::abs( H.GetEntry( i, i ) - diagonal[ i ] - 2.0 ) > tolerance )
+    {
+      std::cerr << "ERROR: Add() failed at (" << i << "," << i << ")." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** The banded matrix does not fit in the diagonal pattern; only its nonzero
+   * off-diagonal entries are reported. */
+  MatrixType::OffsetType expectedMissedByAdd = 0;
+  for( IndexType i = 0; i < n; ++i )
+  {
+    for( IndexType j = i + 1; j < n; ++j )
+    {
+      if( H.GetEntry( i, j ) != 0.0 )
+      {
+        ++expectedMissedByAdd;
+      }
+    }
+  }
+  if( I.Add( H, 1.0 ) != expectedMissedByAdd )
+  {
+    std::cerr << "ERROR: Add() did not report the entries outside the pattern." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Adding a matrix with the same pattern. */
+  MatrixType H2 = H;
+  H2.Scale( 3.0 );
+  H2.Add( H, -3.0 );
+  for( MatrixType::OffsetType k = 0; k < H2.GetNumberOfNonZeros(); ++k )
+  {
+    if( std::abs( H2.GetValues()[ k ] ) > tolerance )
+    {
+      std::cerr << "ERROR: Scale() or Add() failed." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
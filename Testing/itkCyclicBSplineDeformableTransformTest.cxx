@@ -0,0 +1,297 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkCyclicBSplineDeformableTransform.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTimeProbe.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+// This test tests the recursive implementation of the CyclicBSplineDeformableTransform.
+// At random points, of which many have a support region that wraps around the last
+// dimension of the grid, TransformPoint, GetJacobian and
+// EvaluateJacobianWithImageGradientProduct are compared with the TransformPoint and
+// GetJacobian functions that return the weights and indices, which split the support
+// region in two parts. GetSpatialJacobian is compared with finite differences. This
+// is done for a 2D+t and a 3D+t transform.
+
+namespace
+{
+
+template< unsigned int Dimension >
+bool
+TestCyclicTransform( void )
+{
+  typedef itk::CyclicBSplineDeformableTransform< double, Dimension, 3 > TransformType;
+  typedef typename TransformType::ParametersType                        ParametersType;
+  typedef typename TransformType::JacobianType                          JacobianType;
+  typedef typename TransformType::SpatialJacobianType                   SpatialJacobianType;
+  typedef typename TransformType::NonZeroJacobianIndicesType            NonZeroJacobianIndicesType;
+  typedef typename TransformType::WeightsType                           WeightsType;
+  typedef typename TransformType::ParameterIndexArrayType               ParameterIndexArrayType;
+  typedef typename TransformType::MovingImageGradientType               MovingImageGradientType;
+  typedef typename TransformType::DerivativeType                        DerivativeType;
+  typedef typename TransformType::InputPointType                        PointType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator        RandomGeneratorType;
+
+  /** Create a cyclic B-spline transform. The last dimension has few grid points,
+   * so that the support region often wraps around.
+   */
+  typename TransformType::SizeType      gridSize;
+  typename TransformType::SpacingType   gridSpacing;
+  typename TransformType::OriginType    gridOrigin;
+  typename TransformType::DirectionType gridDirection;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    gridSize[ i ]    = 9 + i;
+    gridSpacing[ i ] = 4.0 + 1.5 * i;
+    gridOrigin[ i ]  = -10.0 + 3.25 * i;
+  }
+  gridSize[ Dimension - 1 ]    = 6;
+  gridSpacing[ Dimension - 1 ] = 1.0;
+  gridDirection.SetIdentity();
+  typename TransformType::RegionType gridRegion;
+  gridRegion.SetSize( gridSize );
+
+  typename TransformType::Pointer transform = TransformType::New();
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridDirection( gridDirection );
+
+  /** The coefficients of the last dimension are zero, as the last dimension
+   * is not displaced, so that the spatial Jacobian equals the derivative of
+   * TransformPoint.
+   */
+  const unsigned long parametersPerDim = transform->GetNumberOfParametersPerDimension();
+  ParametersType      parameters( transform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = i < ( Dimension - 1 ) * parametersPerDim ? 1.3 * std::sin( 0.41 * i ) : 0.0;
+  }
+  transform->SetParametersByValue( parameters );
+
+  /** Random points within the grid. */
+  const unsigned int numberOfPoints = 2000;
+  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::New();
+  randomGenerator->Initialize( 1 );
+  std::vector< PointType > points( numberOfPoints );
+  for( unsigned int p = 0; p < numberOfPoints; ++p )
+  {
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      points[ p ][ i ] = gridOrigin[ i ] + gridSpacing[ i ]
+        * randomGenerator->GetUniformVariate( 0.0, gridSize[ i ] - 1.0 );
+    }
+  }
+
+  /** Compare the recursive functions with the split region functions. */
+  const unsigned long numberOfWeights = TransformType::WeightsFunctionType::NumberOfWeights;
+  const unsigned long nnzji           = transform->GetNumberOfNonZeroJacobianIndices();
+  const double        tolerance       = 1e-10;
+  const double        fdTolerance     = 1e-6;
+  const double        delta           = 1e-4;
+  double              maxError        = 0.0;
+  double              maxFDError      = 0.0;
+  unsigned int        numberOfInside  = 0;
+  for( unsigned int p = 0; p < numberOfPoints; ++p )
+  {
+    const PointType & point = points[ p ];
+
+    /** TransformPoint. */
+    WeightsType             weights( numberOfWeights );
+    ParameterIndexArrayType indices( numberOfWeights );
+    PointType               splitPoint;
+    bool                    inside;
+    transform->TransformPoint( point, splitPoint, weights, indices, inside );
+    const PointType recursivePoint = transform->TransformPoint( point );
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      maxError = std::max( maxError, std::abs( recursivePoint[ i ] - splitPoint[ i ] ) );
+    }
+    if( recursivePoint[ Dimension - 1 ] != point[ Dimension - 1 ] )
+    {
+      std::cerr << "ERROR: the last dimension is displaced at " << point << std::endl;
+      return false;
+    }
+    if( !inside )
+    {
+      continue;
+    }
+    ++numberOfInside;
+
+    /** GetJacobian. */
+    JacobianType               jacobian;
+    NonZeroJacobianIndicesType nzji;
+    transform->GetJacobian( point, weights, indices );
+    transform->GetJacobian( point, jacobian, nzji );
+    if( nzji.size() != nnzji )
+    {
+      std::cerr << "ERROR: the number of nonzero Jacobian indices is wrong." << std::endl;
+      return false;
+    }
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      for( unsigned long mu = 0; mu < numberOfWeights; ++mu )
+      {
+        if( nzji[ mu + d * numberOfWeights ] != indices[ mu ] + d * parametersPerDim )
+        {
+          std::cerr << "ERROR: the nonzero Jacobian indices differ at " << point << std::endl;
+          return false;
+        }
+        for( unsigned int e = 0; e < Dimension; ++e )
+        {
+          const double expected = e == d ? weights[ mu ] : 0.0;
+          maxError = std::max( maxError,
+            std::abs( jacobian( e, mu + d * numberOfWeights ) - expected ) );
+        }
+      }
+    }
+
+    /** EvaluateJacobianWithImageGradientProduct. */
+    MovingImageGradientType movingImageGradient;
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      movingImageGradient[ d ] = 0.7 * d - 1.1 + 0.01 * p;
+    }
+    DerivativeType             imageJacobian( nnzji );
+    NonZeroJacobianIndicesType nzji2;
+    transform->EvaluateJacobianWithImageGradientProduct(
+      point, movingImageGradient, imageJacobian, nzji2 );
+    if( nzji2 != nzji )
+    {
+      std::cerr << "ERROR: the nonzero Jacobian indices of "
+                << "EvaluateJacobianWithImageGradientProduct differ at " << point << std::endl;
+      return false;
+    }
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      for( unsigned long mu = 0; mu < numberOfWeights; ++mu )
+      {
+        maxError = std::max( maxError, std::abs( imageJacobian[ mu + d * numberOfWeights ]
+          - weights[ mu ] * movingImageGradient[ d ] ) );
+      }
+    }
+
+    /** GetSpatialJacobian, compared with central differences. */
+    SpatialJacobianType sj;
+    transform->GetSpatialJacobian( point, sj );
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      PointType pointPlus  = point;
+      PointType pointMinus = point;
+      pointPlus[ j ]  += delta;
+      pointMinus[ j ] -= delta;
+      transform->TransformPoint( pointPlus, splitPoint, weights, indices, inside );
+      bool insideMinus;
+      transform->TransformPoint( pointMinus, splitPoint, weights, indices, insideMinus );
+      if( !inside || !insideMinus )
+      {
+        continue;
+      }
+      const PointType transformedPlus  = transform->TransformPoint( pointPlus );
+      const PointType transformedMinus = transform->TransformPoint( pointMinus );
+      for( unsigned int i = 0; i < Dimension; ++i )
+      {
+        const double fd = ( transformedPlus[ i ] - transformedMinus[ i ] ) / ( 2.0 * delta );
+        maxFDError = std::max( maxFDError, std::abs( sj( i, j ) - fd ) );
+      }
+    }
+  }
+
+  std::cout << Dimension << "D: " << numberOfInside << " of " << numberOfPoints
+            << " points inside, max difference " << maxError
+            << ", max spatial Jacobian difference " << maxFDError << std::endl;
+  if( numberOfInside < numberOfPoints / 4 )
+  {
+    std::cerr << "ERROR: too few points are inside the valid region." << std::endl;
+    return false;
+  }
+  if( maxError > tolerance )
+  {
+    std::cerr << "ERROR: the recursive implementation differs from the split regions." << std::endl;
+    return false;
+  }
+  if( maxFDError > fdTolerance )
+  {
+    std::cerr << "ERROR: the spatial Jacobian differs from the finite differences." << std::endl;
+    return false;
+  }
+
+  /** Compare the time of the recursive and the split region TransformPoint. */
+  const unsigned int repetitions = 50;
+  for( unsigned int t = 0; t < 2; ++t )
+  {
+    WeightsType             weights( numberOfWeights );
+    ParameterIndexArrayType indices( numberOfWeights );
+    PointType               outputPoint;
+    bool                    inside;
+    itk::TimeProbe          timer;
+    double                  sum = 0.0;
+    timer.Start();
+    for( unsigned int r = 0; r < repetitions; ++r )
+    {
+      for( unsigned int p = 0; p < numberOfPoints; ++p )
+      {
+        if( t == 0 )
+        {
+          transform->TransformPoint( points[ p ], outputPoint, weights, indices, inside );
+        }
+        else
+        {
+          outputPoint = transform->TransformPoint( points[ p ] );
+        }
+        sum += outputPoint[ 0 ];
+      }
+    }
+    timer.Stop();
+    std::cout << "  TransformPoint " << ( t == 0 ? "split regions:" : "recursive:    " )
+              << std::setprecision( 4 ) << timer.GetMean() << " s  (checksum " << sum << ")" << std::endl;
+  }
+
+  return true;
+}
+
+
+} // end namespace
+
+int
+main( int argc, char * argv[] )
+{
+  try
+  {
+    if( !TestCyclicTransform< 3 >() || !TestCyclicTransform< 4 >() )
+    {
+      return EXIT_FAILURE;
+    }
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
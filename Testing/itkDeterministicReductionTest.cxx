@@ -0,0 +1,281 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "AdvancedNormalizedCorrelation/itkAdvancedNormalizedCorrelationImageToImageMetric.h"
+#include "AdvancedMattesMutualInformation/itkParzenWindowMutualInformationImageToImageMetric.h"
+#include "SumSquaredTissueVolumeDifferenceMetric/itkSumSquaredTissueVolumeDifferenceImageToImageMetric.h"
+#include "BendingEnergyPenalty/itkTransformBendingEnergyPenaltyTerm.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkImageFullSampler.h"
+#include "itkImageGridSampler.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkImageRegionIterator.h"
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+// This test tests the deterministic reduction of the metrics. The value and derivative
+// of the AdvancedMeanSquares, AdvancedNormalizedCorrelation, ParzenWindowMutualInformation,
+// SumSquaredTissueVolumeDifference and TransformBendingEnergyPenalty metrics of a B-spline
+// transform are computed with several numbers of threads, and with UseDeterministicReduction
+// they should be bitwise equal. This is done for a full sampler, and for a grid sampler with
+// fewer samples than work units, for which only the nonempty work units are used.
+// The self Hessian of the AdvancedMeanSquares and TransformBendingEnergyPenalty metrics
+// does not depend on the number of threads, also without UseDeterministicReduction,
+// and is tested in the same way.
+
+const unsigned int Dimension = 2;
+typedef float                                                   PixelType;
+typedef itk::Image< PixelType, Dimension >                      ImageType;
+typedef itk::AdvancedImageToImageMetric< ImageType, ImageType > MetricBaseType;
+typedef MetricBaseType::MeasureType                             MeasureType;
+typedef MetricBaseType::DerivativeType                          DerivativeType;
+typedef MetricBaseType::ParametersType                          ParametersType;
+typedef MetricBaseType::CSRHessianType                          CSRHessianType;
+
+/** Compute the value and derivative of a metric with several numbers of threads,
+ * and check that they are bitwise equal to the result with one thread.
+ */
+bool
+TestDeterministicReduction( const std::string & name,
+  MetricBaseType * metric, const ParametersType & parameters,
+  MetricBaseType::ImageSamplerType * sampler, const unsigned int numberOfWorkUnits )
+{
+  metric->SetImageSampler( sampler );
+  metric->SetUseMultiThread( true );
+  metric->SetUseDeterministicReduction( true );
+  metric->SetNumberOfDeterministicWorkUnits( numberOfWorkUnits );
+
+  const unsigned int numberOfThreadsToTest[] = { 1, 2, 3, 5, 8 };
+  MeasureType        referenceValue          = 0.0;
+  DerivativeType     referenceDerivative;
+  for( unsigned int t = 0; t < 5; ++t )
+  {
+    MeasureType    value = 0.0;
+    DerivativeType derivative( parameters.GetSize() );
+    try
+    {
+      metric->SetNumberOfThreads( numberOfThreadsToTest[ t ] );
+      metric->Initialize();
+
+      /** Call it twice, to also test the reuse of the work units. */
+      metric->GetValueAndDerivative( parameters, value, derivative );
+      metric->GetValueAndDerivative( parameters, value, derivative );
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      std::cerr << name << ": " << excp << std::endl;
+      return false;
+    }
+
+    if( t == 0 )
+    {
+      referenceValue      = value;
+      referenceDerivative = derivative;
+      continue;
+    }
+
+    bool equal = ( value == referenceValue );
+    for( unsigned int i = 0; i < derivative.GetSize(); ++i )
+    {
+      equal &= ( derivative[ i ] == referenceDerivative[ i ] );
+    }
+    if( !equal )
+    {
+      std::cerr << "ERROR: " << name << " with " << numberOfThreadsToTest[ t ]
+                << " threads and " << numberOfWorkUnits
+                << " work units differs from the result with 1 thread." << std::endl;
+      return false;
+    }
+  }
+  return true;
+
+} // end TestDeterministicReduction()
+
+
+/** Compute the self Hessian of a metric with several numbers of threads,
+ * and check that it is bitwise equal to the result with one thread.
+ */
+bool
+TestSelfHessian( const std::string & name,
+  MetricBaseType * metric, const ParametersType & parameters )
+{
+  metric->SetUseDeterministicReduction( false );
+
+  const unsigned int numberOfThreadsToTest[] = { 1, 2, 3, 5, 8 };
+  CSRHessianType     reference;
+  for( unsigned int t = 0; t < 5; ++t )
+  {
+    CSRHessianType H;
+    try
+    {
+      metric->SetNumberOfThreads( numberOfThreadsToTest[ t ] );
+      metric->Initialize();
+      metric->GetCompressedSelfHessian( parameters, H );
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      std::cerr << name << ": " << excp << std::endl;
+      return false;
+    }
+
+    if( t == 0 )
+    {
+      reference = H;
+      continue;
+    }
+
+    if( !H.HasSamePattern( reference ) || H.GetValues() != reference.GetValues() )
+    {
+      std::cerr << "ERROR: the self Hessian of " << name << " with "
+                << numberOfThreadsToTest[ t ]
+                << " threads differs from the result with 1 thread." << std::endl;
+      return false;
+    }
+  }
+  return true;
+
+} // end TestSelfHessian()
+
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int SplineOrder = 3;
+  typedef itk::ImageRegionIterator< ImageType > IteratorType;
+  typedef itk::AdvancedBSplineDeformableTransform<
+    double, Dimension, SplineOrder >            TransformType;
+  typedef itk::ImageFullSampler< ImageType >    FullSamplerType;
+  typedef itk::ImageGridSampler< ImageType >    GridSamplerType;
+  typedef itk::LinearInterpolateImageFunction<
+    ImageType, double >                         InterpolatorType;
+
+  typedef itk::AdvancedMeanSquaresImageToImageMetric<
+    ImageType, ImageType >                      MeanSquaresType;
+  typedef itk::AdvancedNormalizedCorrelationImageToImageMetric<
+    ImageType, ImageType >                      NormalizedCorrelationType;
+  typedef itk::ParzenWindowMutualInformationImageToImageMetric<
+    ImageType, ImageType >                      MutualInformationType;
+  typedef itk::SumSquaredTissueVolumeDifferenceImageToImageMetric<
+    ImageType, ImageType >                      TissueVolumeDifferenceType;
+  typedef itk::TransformBendingEnergyPenaltyTerm<
+    ImageType, double >                         BendingEnergyType;
+
+  /** Create a fixed and a moving image with a shifted blob. */
+  ImageType::SizeType imageSize;
+  imageSize.Fill( 96 );
+  ImageType::Pointer fixedImage  = ImageType::New();
+  ImageType::Pointer movingImage = ImageType::New();
+  fixedImage->SetRegions( imageSize );
+  fixedImage->Allocate();
+  movingImage->SetRegions( imageSize );
+  movingImage->Allocate();
+  IteratorType fit( fixedImage, fixedImage->GetLargestPossibleRegion() );
+  IteratorType mit( movingImage, movingImage->GetLargestPossibleRegion() );
+  for( fit.GoToBegin(), mit.GoToBegin(); !fit.IsAtEnd(); ++fit, ++mit )
+  {
+    const ImageType::IndexType index = fit.GetIndex();
+    const double               x     = index[ 0 ] - 48.0;
+    const double               y     = index[ 1 ] - 48.0;
+    fit.Set( static_cast< PixelType >( 100.0 * std::exp( -( x * x + y * y ) / 400.0 ) ) );
+    mit.Set( static_cast< PixelType >( 100.0 * std::exp( -( ( x - 3.3 ) * ( x - 3.3 ) + y * y ) / 500.0 ) ) );
+  }
+
+  /** Create a B-spline transform, with some deformation. */
+  TransformType::Pointer       transform = TransformType::New();
+  TransformType::SizeType      gridSize;
+  TransformType::SpacingType   gridSpacing;
+  TransformType::OriginType    gridOrigin;
+  TransformType::DirectionType gridDirection;
+  gridSize.Fill( 12 );
+  gridSpacing.Fill( 10.0 );
+  gridOrigin.Fill( -12.0 );
+  gridDirection.SetIdentity();
+  TransformType::RegionType gridRegion;
+  gridRegion.SetSize( gridSize );
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridDirection( gridDirection );
+
+  ParametersType parameters( transform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = 0.7 * std::sin( 0.37 * i );
+  }
+  transform->SetParameters( parameters );
+
+  /** Create the metrics. */
+  MeanSquaresType::Pointer           meanSquares           = MeanSquaresType::New();
+  NormalizedCorrelationType::Pointer normalizedCorrelation = NormalizedCorrelationType::New();
+  MutualInformationType::Pointer     mutualInformation     = MutualInformationType::New();
+  mutualInformation->SetNumberOfFixedHistogramBins( 32 );
+  mutualInformation->SetNumberOfMovingHistogramBins( 32 );
+  mutualInformation->SetUseExplicitPDFDerivatives( false );
+  TissueVolumeDifferenceType::Pointer tissueVolumeDifference = TissueVolumeDifferenceType::New();
+  tissueVolumeDifference->SetAirValue( -1000.0 );
+  tissueVolumeDifference->SetTissueValue( 55.0 );
+  BendingEnergyType::Pointer bendingEnergy = BendingEnergyType::New();
+
+  const unsigned int numberOfMetrics = 5;
+  MetricBaseType *   metrics[ numberOfMetrics ] = {
+    meanSquares, normalizedCorrelation, mutualInformation,
+    tissueVolumeDifference, bendingEnergy
+  };
+  const char * names[ numberOfMetrics ] = {
+    "AdvancedMeanSquares", "AdvancedNormalizedCorrelation",
+    "ParzenWindowMutualInformation", "SumSquaredTissueVolumeDifference",
+    "TransformBendingEnergyPenalty"
+  };
+
+  /** The full sampler gives more samples than work units; the grid sampler,
+   * with 3 x 3 samples, fewer.
+   */
+  FullSamplerType::Pointer               fullSampler = FullSamplerType::New();
+  GridSamplerType::Pointer               gridSampler = GridSamplerType::New();
+  GridSamplerType::SampleGridSpacingType sampleGridSpacing;
+  sampleGridSpacing.Fill( 40 );
+  gridSampler->SetSampleGridSpacing( sampleGridSpacing );
+
+  bool success = true;
+  for( unsigned int m = 0; m < numberOfMetrics; ++m )
+  {
+    InterpolatorType::Pointer interpolator = InterpolatorType::New();
+    metrics[ m ]->SetFixedImage( fixedImage );
+    metrics[ m ]->SetMovingImage( movingImage );
+    metrics[ m ]->SetFixedImageRegion( fixedImage->GetLargestPossibleRegion() );
+    metrics[ m ]->SetTransform( transform );
+    metrics[ m ]->SetInterpolator( interpolator );
+
+    success &= TestDeterministicReduction( names[ m ], metrics[ m ], parameters, fullSampler, 8 );
+    success &= TestDeterministicReduction( names[ m ], metrics[ m ], parameters, gridSampler, 16 );
+  }
+
+  /** The self Hessian, with the default number of samples. */
+  meanSquares->SetImageSampler( fullSampler );
+  bendingEnergy->SetImageSampler( fullSampler );
+  success &= TestSelfHessian( names[ 0 ], meanSquares, parameters );
+  success &= TestSelfHessian( names[ 4 ], bendingEnergy, parameters );
+
+  /** Return a value. */
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+
+} // end main
@@ -0,0 +1,205 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "elxElastixFilter.h"
+#include "elxParameterObject.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionConstIterator.h"
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+// This test tests the batch mode of the ElastixFilter. Three moving images are
+// registered to the same fixed image in one batch, in which the other jobs reuse
+// the fixed image pyramid of the first job. The batch is run sequentially, and
+// with two concurrent registrations that divide two threads, such that the second
+// and third job run at the same time. The transforms and result images are
+// compared with those of single registrations. The registration is made
+// deterministic with a full sampler and a single thread per registration.
+
+namespace
+{
+
+typedef itk::Image< float, 2 >                          ImageType;
+typedef elastix::ElastixFilter< ImageType, ImageType >  ElastixFilterType;
+typedef elastix::ParameterObject                        ParameterObjectType;
+typedef ParameterObjectType::ParameterMapType           ParameterMapType;
+typedef ParameterObjectType::ParameterValueVectorType   ParameterValueVectorType;
+
+/** Create an image with two Gaussian blobs, translated over the given shift. */
+ImageType::Pointer
+CreateImage( const double shiftX, const double shiftY )
+{
+  ImageType::SizeType size;
+  size.Fill( 64 );
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( size );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const double x  = it.GetIndex()[ 0 ] - shiftX;
+    const double y  = it.GetIndex()[ 1 ] - shiftY;
+    const double d1 = ( x - 28.0 ) * ( x - 28.0 ) + ( y - 30.0 ) * ( y - 30.0 );
+    const double d2 = ( x - 40.0 ) * ( x - 40.0 ) + ( y - 26.0 ) * ( y - 26.0 );
+    it.Set( static_cast< float >( 100.0 * std::exp( -d1 / 72.0 ) + 60.0 * std::exp( -d2 / 32.0 ) ) );
+  }
+  return image;
+}
+
+
+/** Get the transform parameters of the last parameter map. */
+std::vector< double >
+GetTransformParameters( const ParameterObjectType * parameterObject )
+{
+  const ParameterMapType & parameterMap = parameterObject->GetParameterMap().back();
+  const ParameterValueVectorType & values = parameterMap.find( "TransformParameters" )->second;
+  std::vector< double >            parameters( values.size() );
+  for( unsigned int i = 0; i < values.size(); ++i )
+  {
+    parameters[ i ] = std::atof( values[ i ].c_str() );
+  }
+  return parameters;
+}
+
+
+/** Compute the maximum absolute difference of two images. */
+double
+ComputeMaximumDifference( const ImageType * image1, const ImageType * image2 )
+{
+  itk::ImageRegionConstIterator< ImageType > it1( image1, image1->GetLargestPossibleRegion() );
+  itk::ImageRegionConstIterator< ImageType > it2( image2, image2->GetLargestPossibleRegion() );
+  double                                     maxDifference = 0.0;
+  for( it1.GoToBegin(), it2.GoToBegin(); !it1.IsAtEnd(); ++it1, ++it2 )
+  {
+    maxDifference = std::max( maxDifference, std::abs(
+      static_cast< double >( it1.Get() ) - static_cast< double >( it2.Get() ) ) );
+  }
+  return maxDifference;
+}
+
+
+} // end namespace
+
+int
+main( int argc, char * argv[] )
+{
+  /** A deterministic translation registration with two resolutions. */
+  ParameterMapType parameterMap = ParameterObjectType::GetDefaultParameterMap( "translation", 2 );
+  parameterMap[ "ImageSampler" ]              = ParameterValueVectorType( 1, "Full" );
+  parameterMap[ "Metric" ]                    = ParameterValueVectorType( 1, "AdvancedMeanSquares" );
+  parameterMap[ "Optimizer" ]                 = ParameterValueVectorType( 1, "RegularStepGradientDescent" );
+  parameterMap[ "MaximumNumberOfIterations" ] = ParameterValueVectorType( 1, "100" );
+  parameterMap[ "MaximumStepLength" ]         = ParameterValueVectorType( 1, "1.0" );
+  parameterMap[ "MinimumStepLength" ]         = ParameterValueVectorType( 1, "0.001" );
+  ParameterObjectType::Pointer parameterObject = ParameterObjectType::New();
+  parameterObject->SetParameterMap( parameterMap );
+
+  const unsigned int numberOfJobs = 3;
+  const double       shifts[ numberOfJobs ][ 2 ] = { { 3.0, -2.0 }, { -4.0, 1.5 }, { 1.5, 3.5 } };
+  ImageType::Pointer fixedImage = CreateImage( 0.0, 0.0 );
+  ImageType::Pointer movingImages[ numberOfJobs ];
+  for( unsigned int job = 0; job < numberOfJobs; ++job )
+  {
+    movingImages[ job ] = CreateImage( shifts[ job ][ 0 ], shifts[ job ][ 1 ] );
+  }
+
+  try
+  {
+    /** Register all moving images in one batch, sequentially and concurrently. */
+    ElastixFilterType::Pointer batchFilters[ 2 ];
+    for( unsigned int b = 0; b < 2; ++b )
+    {
+      batchFilters[ b ] = ElastixFilterType::New();
+      batchFilters[ b ]->SetFixedImage( fixedImage );
+      for( unsigned int job = 0; job < numberOfJobs; ++job )
+      {
+        batchFilters[ b ]->AddBatchMovingImage( movingImages[ job ] );
+      }
+      batchFilters[ b ]->SetParameterObject( parameterObject );
+      batchFilters[ b ]->SetNumberOfThreads( b == 0 ? 1 : 2 );
+      batchFilters[ b ]->SetNumberOfConcurrentRegistrations( b == 0 ? 1 : 2 );
+      batchFilters[ b ]->LogToConsoleOff();
+      batchFilters[ b ]->Update();
+    }
+
+    /** Compare each job of both batches with a single registration. */
+    for( unsigned int job = 0; job < numberOfJobs; ++job )
+    {
+      ElastixFilterType::Pointer singleFilter = ElastixFilterType::New();
+      singleFilter->SetFixedImage( fixedImage );
+      singleFilter->SetMovingImage( movingImages[ job ] );
+      singleFilter->SetParameterObject( parameterObject );
+      singleFilter->SetNumberOfThreads( 1 );
+      singleFilter->LogToConsoleOff();
+      singleFilter->Update();
+
+      for( unsigned int b = 0; b < 2; ++b )
+      {
+        const std::vector< double > batchParameters
+          = GetTransformParameters( batchFilters[ b ]->GetBatchTransformParameterObject( job ) );
+        const std::vector< double > singleParameters
+          = GetTransformParameters( singleFilter->GetTransformParameterObject() );
+        if( batchParameters.size() != 2 || singleParameters.size() != 2 )
+        {
+          std::cerr << "ERROR: expected two translation parameters." << std::endl;
+          return EXIT_FAILURE;
+        }
+
+        std::cout << "Job " << job << ": batch " << b << " (" << batchParameters[ 0 ] << ", " << batchParameters[ 1 ]
+                  << "), single (" << singleParameters[ 0 ] << ", " << singleParameters[ 1 ] << ")" << std::endl;
+        for( unsigned int i = 0; i < 2; ++i )
+        {
+          if( std::abs( batchParameters[ i ] - singleParameters[ i ] ) > 1e-6 )
+          {
+            std::cerr << "ERROR: the transform of job " << job << " of batch " << b
+                      << " differs from the single registration." << std::endl;
+            return EXIT_FAILURE;
+          }
+          if( std::abs( batchParameters[ i ] - shifts[ job ][ i ] ) > 0.1 )
+          {
+            std::cerr << "ERROR: job " << job << " of batch " << b << " did not find the translation." << std::endl;
+            return EXIT_FAILURE;
+          }
+        }
+
+        const double maxDifference = ComputeMaximumDifference(
+          batchFilters[ b ]->GetBatchResultImage( job ), singleFilter->GetOutput() );
+        if( maxDifference > 1e-3 )
+        {
+          std::cerr << "ERROR: the result image of job " << job << " of batch " << b
+                    << " differs from the single registration by " << maxDifference << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+    }
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
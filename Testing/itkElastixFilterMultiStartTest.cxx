@@ -0,0 +1,237 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "elxElastixFilter.h"
+#include "elxParameterObject.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionConstIterator.h"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+// This test tests multi-start registration with the ElastixFilter. A moving image
+// is registered from three initial translations. The first start is bad, and is
+// completed since there is no reference yet. The second start is good, and should
+// be selected. The third start is bad, and should be pruned after the first
+// resolution against the second start. The number of iterations and the step
+// length are small enough that the bad starts cannot reach the optimum. The starts
+// are then run again with two concurrent registrations that divide two threads,
+// in which the second and third start are pruned against the first one. The same
+// start should be selected, with the same result image.
+//
+// Usage: itkElastixFilterMultiStartTest <output directory>
+
+namespace
+{
+
+typedef itk::Image< float, 2 >                          ImageType;
+typedef elastix::ElastixFilter< ImageType, ImageType >  ElastixFilterType;
+typedef elastix::ParameterObject                        ParameterObjectType;
+typedef ParameterObjectType::ParameterMapType           ParameterMapType;
+typedef ParameterObjectType::ParameterValueVectorType   ParameterValueVectorType;
+
+/** Create an image with two Gaussian blobs, translated over the given shift. */
+ImageType::Pointer
+CreateImage( const double shiftX, const double shiftY )
+{
+  ImageType::SizeType size;
+  size.Fill( 64 );
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( size );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const double x  = it.GetIndex()[ 0 ] - shiftX;
+    const double y  = it.GetIndex()[ 1 ] - shiftY;
+    const double d1 = ( x - 28.0 ) * ( x - 28.0 ) + ( y - 30.0 ) * ( y - 30.0 );
+    const double d2 = ( x - 40.0 ) * ( x - 40.0 ) + ( y - 26.0 ) * ( y - 26.0 );
+    it.Set( static_cast< float >( 100.0 * std::exp( -d1 / 72.0 ) + 60.0 * std::exp( -d2 / 32.0 ) ) );
+  }
+  return image;
+}
+
+
+/** Write a translation transform parameter file. */
+bool
+WriteTranslation( const std::string & fileName, const double tx, const double ty )
+{
+  std::ofstream file( fileName.c_str() );
+  if( !file.is_open() )
+  {
+    return false;
+  }
+
+  file << "(Transform \"TranslationTransform\")\n"
+       << "(NumberOfParameters 2)\n"
+       << "(TransformParameters " << tx << " " << ty << ")\n"
+       << "(InitialTransformParametersFileName \"NoInitialTransform\")\n"
+       << "(HowToCombineTransforms \"Compose\")\n"
+       << "(FixedImageDimension 2)\n"
+       << "(MovingImageDimension 2)\n"
+       << "(FixedInternalImagePixelType \"float\")\n"
+       << "(MovingInternalImagePixelType \"float\")\n"
+       << "(Size 64 64)\n"
+       << "(Index 0 0)\n"
+       << "(Spacing 1.0 1.0)\n"
+       << "(Origin 0.0 0.0)\n"
+       << "(Direction 1.0 0.0 0.0 1.0)\n"
+       << "(UseDirectionCosines \"true\")\n";
+  return true;
+}
+
+
+} // end namespace
+
+int
+main( int argc, char * argv[] )
+{
+  /** Check. */
+  if( argc != 2 )
+  {
+    std::cerr << "ERROR: You should specify the output directory." << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string outputDirectory = argv[ 1 ];
+
+  /** A deterministic translation registration with two resolutions, with at
+   * most 40 steps of at most 0.5 voxel.
+   */
+  ParameterMapType parameterMap = ParameterObjectType::GetDefaultParameterMap( "translation", 2 );
+  parameterMap[ "ImageSampler" ]              = ParameterValueVectorType( 1, "Full" );
+  parameterMap[ "Metric" ]                    = ParameterValueVectorType( 1, "AdvancedMeanSquares" );
+  parameterMap[ "Optimizer" ]                 = ParameterValueVectorType( 1, "RegularStepGradientDescent" );
+  parameterMap[ "MaximumNumberOfIterations" ] = ParameterValueVectorType( 1, "20" );
+  parameterMap[ "MaximumStepLength" ]         = ParameterValueVectorType( 1, "0.5" );
+  parameterMap[ "MinimumStepLength" ]         = ParameterValueVectorType( 1, "0.001" );
+  ParameterObjectType::Pointer parameterObject = ParameterObjectType::New();
+  parameterObject->SetParameterMap( parameterMap );
+
+  /** The bad starts are more than 20 voxels away from the true translation. */
+  const double       shift[ 2 ] = { 3.0, -2.0 };
+  const unsigned int numberOfStarts = 3;
+  const double       starts[ numberOfStarts ][ 2 ] = { { -12.0, 12.0 }, { 2.0, -1.0 }, { 14.0, -14.0 } };
+  ImageType::Pointer fixedImage  = CreateImage( 0.0, 0.0 );
+  ImageType::Pointer movingImage = CreateImage( shift[ 0 ], shift[ 1 ] );
+
+  try
+  {
+    ElastixFilterType::Pointer filter = ElastixFilterType::New();
+    filter->SetFixedImage( fixedImage );
+    filter->SetMovingImage( movingImage );
+    filter->SetParameterObject( parameterObject );
+    for( unsigned int start = 0; start < numberOfStarts; ++start )
+    {
+      const std::string fileName = outputDirectory + "/ElastixFilterMultiStartTest_start"
+        + ParameterObjectType::ToString( start ) + ".txt";
+      if( !WriteTranslation( fileName, starts[ start ][ 0 ], starts[ start ][ 1 ] ) )
+      {
+        std::cerr << "ERROR: could not write " << fileName << std::endl;
+        return EXIT_FAILURE;
+      }
+      filter->AddMultiStartInitialTransformParameterFileName( fileName );
+    }
+    filter->SetMultiStartPruningMargin( 0.1 );
+    filter->SetNumberOfThreads( 1 );
+    filter->LogToConsoleOff();
+    filter->Update();
+
+    std::cout << "Best start: " << filter->GetBestMultiStart()
+              << ", number of pruned starts: " << filter->GetNumberOfPrunedMultiStarts() << std::endl;
+    if( filter->GetBestMultiStart() != 1 )
+    {
+      std::cerr << "ERROR: the good start was not selected." << std::endl;
+      return EXIT_FAILURE;
+    }
+    if( filter->GetNumberOfPrunedMultiStarts() != 1 )
+    {
+      std::cerr << "ERROR: expected the last bad start to be pruned." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    /** The result image of the selected start should match the fixed image. */
+    itk::ImageRegionConstIterator< ImageType > itFixed( fixedImage, fixedImage->GetLargestPossibleRegion() );
+    itk::ImageRegionConstIterator< ImageType > itResult( filter->GetOutput(),
+      filter->GetOutput()->GetLargestPossibleRegion() );
+    double maxDifference = 0.0;
+    for( itFixed.GoToBegin(), itResult.GoToBegin(); !itFixed.IsAtEnd(); ++itFixed, ++itResult )
+    {
+      maxDifference = std::max( maxDifference, std::abs(
+        static_cast< double >( itFixed.Get() ) - static_cast< double >( itResult.Get() ) ) );
+    }
+    std::cout << "Maximum difference of the result and the fixed image: " << maxDifference << std::endl;
+    if( maxDifference > 5.0 )
+    {
+      std::cerr << "ERROR: the result image does not match the fixed image." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    /** Run the starts concurrently. */
+    ElastixFilterType::Pointer concurrentFilter = ElastixFilterType::New();
+    concurrentFilter->SetFixedImage( fixedImage );
+    concurrentFilter->SetMovingImage( movingImage );
+    concurrentFilter->SetParameterObject( parameterObject );
+    for( unsigned int start = 0; start < numberOfStarts; ++start )
+    {
+      concurrentFilter->AddMultiStartInitialTransformParameterFileName(
+        filter->GetMultiStartInitialTransformParameterFileName( start ) );
+    }
+    concurrentFilter->SetMultiStartPruningMargin( 0.1 );
+    concurrentFilter->SetNumberOfThreads( 2 );
+    concurrentFilter->SetNumberOfConcurrentRegistrations( 2 );
+    concurrentFilter->LogToConsoleOff();
+    concurrentFilter->Update();
+
+    std::cout << "Concurrent best start: " << concurrentFilter->GetBestMultiStart()
+              << ", number of pruned starts: " << concurrentFilter->GetNumberOfPrunedMultiStarts() << std::endl;
+    if( concurrentFilter->GetBestMultiStart() != 1 )
+    {
+      std::cerr << "ERROR: the good start was not selected by the concurrent starts." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    itk::ImageRegionConstIterator< ImageType > itConcurrent( concurrentFilter->GetOutput(),
+      concurrentFilter->GetOutput()->GetLargestPossibleRegion() );
+    maxDifference = 0.0;
+    for( itResult.GoToBegin(), itConcurrent.GoToBegin(); !itResult.IsAtEnd(); ++itResult, ++itConcurrent )
+    {
+      maxDifference = std::max( maxDifference, std::abs(
+        static_cast< double >( itResult.Get() ) - static_cast< double >( itConcurrent.Get() ) ) );
+    }
+    if( maxDifference > 1e-3 )
+    {
+      std::cerr << "ERROR: the concurrent result image differs from the sequential one by "
+                << maxDifference << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
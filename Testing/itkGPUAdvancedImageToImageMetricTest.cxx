@@ -0,0 +1,264 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkTestHelper.h"
+
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "AdvancedMattesMutualInformation/itkParzenWindowMutualInformationImageToImageMetric.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedLinearInterpolateImageFunction.h"
+#include "itkImageFullSampler.h"
+#include "itkImageRegionIterator.h"
+
+#include <iomanip> // setprecision, etc.
+#include <algorithm>
+#include <cmath>
+
+//------------------------------------------------------------------------------
+// This test compares the CPU with the OpenCL evaluation of the metrics.
+// The value and derivative of the AdvancedMeanSquares and the
+// ParzenWindowMutualInformation metric are computed for an affine and a
+// B-spline transform, with UseOpenCL off and on. The OpenCL device works in
+// single precision, so the results are compared with a relative tolerance.
+// Repeated evaluations should be bitwise equal, because the kernels do not
+// depend on the scheduling of the work items.
+// This test can be run on a CPU OpenCL implementation, such as POCL.
+
+namespace
+{
+const unsigned int Dimension = 3;
+typedef float                                    PixelType;
+typedef itk::Image< PixelType, Dimension >       ImageType;
+typedef itk::AdvancedImageToImageMetric<
+  ImageType, ImageType >                         MetricType;
+typedef MetricType::MeasureType                  MeasureType;
+typedef MetricType::DerivativeType               DerivativeType;
+typedef MetricType::TransformParametersType      ParametersType;
+
+//------------------------------------------------------------------------------
+// Computes the value and derivative of the metric with UseOpenCL off and on,
+// and returns whether the results are the same within the tolerance.
+bool
+CompareCPUAndOpenCL( MetricType * metric, const ParametersType & parameters,
+  const std::string & name, const double tolerance )
+{
+  MeasureType    value[ 2 ];
+  DerivativeType derivative[ 2 ];
+  for( unsigned int d = 0; d < 2; ++d )
+  {
+    const bool useOpenCL = ( d == 1 );
+    metric->SetUseOpenCL( useOpenCL );
+    metric->Initialize();
+    if( metric->GetUseOpenCLEvaluator() != useOpenCL )
+    {
+      std::cerr << "ERROR: " << name << ": the OpenCL evaluator is "
+                << ( useOpenCL ? "not " : "" ) << "selected." << std::endl;
+      return false;
+    }
+
+    /** Repeated evaluations on the device should be bitwise equal. */
+    for( unsigned int r = 0; r < 3; ++r )
+    {
+      MeasureType    repeatedValue = 0.0;
+      DerivativeType repeatedDerivative;
+      metric->GetValueAndDerivative( parameters, repeatedValue, repeatedDerivative );
+      if( r == 0 )
+      {
+        value[ d ]      = repeatedValue;
+        derivative[ d ] = repeatedDerivative;
+      }
+      else if( useOpenCL
+        && ( repeatedValue != value[ d ] || repeatedDerivative != derivative[ d ] ) )
+      {
+        std::cerr << "ERROR: " << name << ": repeated OpenCL evaluations differ." << std::endl;
+        return false;
+      }
+    }
+  }
+
+  /** Compare the value and the derivative, relative to their magnitude. */
+  const double valueError = std::abs( value[ 1 ] - value[ 0 ] )
+    / std::max( std::abs( value[ 0 ] ), 1e-8 );
+  double maxDifference = 0.0;
+  for( unsigned int i = 0; i < derivative[ 0 ].GetSize(); ++i )
+  {
+    maxDifference = std::max( maxDifference, std::abs( derivative[ 1 ][ i ] - derivative[ 0 ][ i ] ) );
+  }
+  const double derivativeError = maxDifference
+    / std::max( derivative[ 0 ].inf_norm(), 1e-8 );
+  if( valueError > tolerance || derivativeError > tolerance )
+  {
+    std::cerr << "ERROR: " << name << ": the OpenCL result differs from the CPU result." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+} // end namespace
+
+int
+main( int argc, char * argv[] )
+{
+  // Setup for debugging
+  itk::SetupForDebugging();
+
+  // Create and check OpenCL context
+  if( !itk::CreateContext() )
+  {
+    return EXIT_FAILURE;
+  }
+
+  std::cout << std::showpoint << std::setprecision( 6 );
+
+  typedef itk::AdvancedMeanSquaresImageToImageMetric<
+    ImageType, ImageType >                                   MeanSquaresMetricType;
+  typedef itk::ParzenWindowMutualInformationImageToImageMetric<
+    ImageType, ImageType >                                   MutualInformationMetricType;
+  typedef itk::AdvancedCombinationTransform< double, Dimension > CombinationTransformType;
+  typedef itk::AdvancedMatrixOffsetTransformBase<
+    double, Dimension, Dimension >                           AffineTransformType;
+  typedef itk::AdvancedBSplineDeformableTransform<
+    double, Dimension, 3 >                                   BSplineTransformType;
+  typedef itk::AdvancedLinearInterpolateImageFunction<
+    ImageType, double >                                      InterpolatorType;
+  typedef itk::ImageFullSampler< ImageType >                 SamplerType;
+  typedef itk::ImageRegionIterator< ImageType >              IteratorType;
+
+  const double tolerance = 1e-3;
+
+  try
+  {
+    /** Create a fixed and a moving image with a shifted blob. */
+    ImageType::SizeType imageSize;
+    imageSize.Fill( 48 );
+    ImageType::SpacingType spacing;
+    spacing.Fill( 1.5 );
+    ImageType::Pointer fixedImage  = ImageType::New();
+    ImageType::Pointer movingImage = ImageType::New();
+    fixedImage->SetRegions( imageSize );
+    fixedImage->SetSpacing( spacing );
+    fixedImage->Allocate();
+    movingImage->SetRegions( imageSize );
+    movingImage->SetSpacing( spacing );
+    movingImage->Allocate();
+    IteratorType fit( fixedImage, fixedImage->GetLargestPossibleRegion() );
+    IteratorType mit( movingImage, movingImage->GetLargestPossibleRegion() );
+    for( fit.GoToBegin(), mit.GoToBegin(); !fit.IsAtEnd(); ++fit, ++mit )
+    {
+      const ImageType::IndexType index = fit.GetIndex();
+      const double               x     = index[ 0 ] - 24.0;
+      const double               y     = index[ 1 ] - 24.0;
+      const double               z     = index[ 2 ] - 24.0;
+      fit.Set( static_cast< PixelType >( 100.0 * std::exp( -( x * x + y * y + z * z ) / 200.0 ) ) );
+      mit.Set( static_cast< PixelType >( 100.0 * std::exp(
+        -( ( x - 2.3 ) * ( x - 2.3 ) + y * y + ( z + 1.7 ) * ( z + 1.7 ) ) / 250.0 ) ) );
+    }
+
+    /** Create an affine transform, with a small rotation and translation. */
+    AffineTransformType::Pointer affine = AffineTransformType::New();
+    ParametersType               affineParameters( affine->GetNumberOfParameters() );
+    affineParameters.Fill( 0.0 );
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      affineParameters[ i * Dimension + i ] = 1.0;
+      affineParameters[ Dimension * Dimension + i ] = 0.8 * ( i + 1.0 );
+    }
+    affineParameters[ 1 ] = 0.03;
+    affineParameters[ 3 ] = -0.02;
+
+    /** Create a B-spline transform, with some deformation. */
+    BSplineTransformType::Pointer       bspline = BSplineTransformType::New();
+    BSplineTransformType::SizeType      gridSize;
+    BSplineTransformType::SpacingType   gridSpacing;
+    BSplineTransformType::OriginType    gridOrigin;
+    BSplineTransformType::DirectionType gridDirection;
+    gridSize.Fill( 10 );
+    gridSpacing.Fill( 10.0 );
+    gridOrigin.Fill( -12.0 );
+    gridDirection.SetIdentity();
+    BSplineTransformType::RegionType gridRegion;
+    gridRegion.SetSize( gridSize );
+    bspline->SetGridRegion( gridRegion );
+    bspline->SetGridSpacing( gridSpacing );
+    bspline->SetGridOrigin( gridOrigin );
+    bspline->SetGridDirection( gridDirection );
+    ParametersType bsplineParameters( bspline->GetNumberOfParameters() );
+    for( unsigned int i = 0; i < bsplineParameters.GetSize(); ++i )
+    {
+      bsplineParameters[ i ] = 0.7 * std::sin( 0.37 * i );
+    }
+
+    /** Create the metrics. */
+    MeanSquaresMetricType::Pointer meanSquares = MeanSquaresMetricType::New();
+    MutualInformationMetricType::Pointer mutualInformation = MutualInformationMetricType::New();
+    mutualInformation->SetNumberOfFixedHistogramBins( 32 );
+    mutualInformation->SetNumberOfMovingHistogramBins( 32 );
+    mutualInformation->SetUseExplicitPDFDerivatives( false );
+
+    MetricType::Pointer metrics[ 2 ] = { meanSquares.GetPointer(), mutualInformation.GetPointer() };
+    const std::string   metricNames[ 2 ] = { "MeanSquares", "MutualInformation" };
+
+    for( unsigned int t = 0; t < 2; ++t )
+    {
+      CombinationTransformType::Pointer transform = CombinationTransformType::New();
+      ParametersType                    parameters;
+      std::string                       transformName;
+      if( t == 0 )
+      {
+        transform->SetCurrentTransform( affine );
+        parameters    = affineParameters;
+        transformName = "Affine";
+      }
+      else
+      {
+        transform->SetCurrentTransform( bspline );
+        parameters    = bsplineParameters;
+        transformName = "BSpline";
+      }
+      transform->SetParameters( parameters );
+
+      for( unsigned int m = 0; m < 2; ++m )
+      {
+        MetricType * metric = metrics[ m ];
+        metric->SetFixedImage( fixedImage );
+        metric->SetMovingImage( movingImage );
+        metric->SetFixedImageRegion( fixedImage->GetLargestPossibleRegion() );
+        metric->SetTransform( transform );
+        metric->SetInterpolator( InterpolatorType::New() );
+        metric->SetImageSampler( SamplerType::New() );
+
+        if( !CompareCPUAndOpenCL( metric, parameters, metricNames[ m ] + transformName, tolerance ) )
+        {
+          itk::ReleaseContext();
+          return EXIT_FAILURE;
+        }
+      }
+    }
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "Caught ITK exception: " << e << std::endl;
+    itk::ReleaseContext();
+    return EXIT_FAILURE;
+  }
+
+  itk::ReleaseContext();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,205 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkGenericMultiResolutionPyramidImageFilter.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkSmoothingRecursiveGaussianImageFilter.h"
+#include "itkShrinkImageFilter.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+// This test tests the ComputeFromPreviousLevel option of the
+// GenericMultiResolutionPyramidImageFilter. The levels computed in a cascade, where a
+// level is derived from the next finer level, are compared with the levels computed
+// from the input image. The shrink factors are odd, so that the shrinker picks the
+// same voxels in both cases, and the geometry should be exactly equal. The Gaussians
+// only compose approximately with the recursive filters, and differ near the border,
+// so the intensities are compared in the interior with a tolerance.
+// With the shrinker, the pyramid smooths and shrinks one axis at a time. The levels
+// computed from the input are therefore also compared with smoothing along all axes
+// followed by shrinking, which should give the same result.
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int Dimension      = 2;
+  const unsigned int numberOfLevels = 3;
+  typedef itk::Image< float, Dimension >                           ImageType;
+  typedef itk::GenericMultiResolutionPyramidImageFilter<
+    ImageType, ImageType >                                         PyramidType;
+  typedef PyramidType::RescaleScheduleType                         RescaleScheduleType;
+  typedef PyramidType::SmoothingScheduleType                       SmoothingScheduleType;
+  typedef itk::ImageRegionIteratorWithIndex< ImageType >           IteratorType;
+
+  /** Create a smooth input image, with a size that is divisible by the shrink factors. */
+  ImageType::SizeType size;
+  size[ 0 ] = 270; size[ 1 ] = 216;
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( size );
+  image->Allocate();
+  const double pi = 3.14159265358979323846;
+  IteratorType it( image, image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const ImageType::IndexType index = it.GetIndex();
+    it.Set( static_cast< float >( 100.0 * std::sin( 2.0 * pi * index[ 0 ] / 90.0 )
+      * std::cos( 2.0 * pi * index[ 1 ] / 72.0 ) + 0.2 * index[ 0 ] ) );
+  }
+  const double range = 100.0 + 0.2 * size[ 0 ];
+
+  /** Shrink factors 9, 3 and 1, with sigmas of half the factors. */
+  RescaleScheduleType   rescaleSchedule( numberOfLevels, Dimension );
+  SmoothingScheduleType smoothingSchedule( numberOfLevels, Dimension );
+  const unsigned int    factors[ numberOfLevels ] = { 9, 3, 1 };
+  for( unsigned int level = 0; level < numberOfLevels; ++level )
+  {
+    for( unsigned int dim = 0; dim < Dimension; ++dim )
+    {
+      rescaleSchedule[ level ][ dim ]   = factors[ level ];
+      smoothingSchedule[ level ][ dim ] = 0.5 * factors[ level ];
+    }
+  }
+
+  /** Compute the pyramid from the input, and in a cascade. */
+  PyramidType::Pointer pyramids[ 2 ];
+  for( unsigned int p = 0; p < 2; ++p )
+  {
+    pyramids[ p ] = PyramidType::New();
+    pyramids[ p ]->SetInput( image );
+    pyramids[ p ]->SetNumberOfLevels( numberOfLevels );
+    pyramids[ p ]->SetRescaleSchedule( rescaleSchedule );
+    pyramids[ p ]->SetSmoothingSchedule( smoothingSchedule );
+    pyramids[ p ]->SetUseShrinkImageFilter( true );
+    pyramids[ p ]->SetComputeOnlyForCurrentLevel( false );
+    pyramids[ p ]->SetComputeFromPreviousLevel( p == 1 );
+
+    try
+    {
+      pyramids[ p ]->Update();
+    }
+    catch( itk::ExceptionObject & e )
+    {
+      std::cerr << e << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** Compare the levels. */
+  const double tolerance = 1e-2 * range;
+  for( unsigned int level = 0; level < numberOfLevels; ++level )
+  {
+    ImageType * direct  = pyramids[ 0 ]->GetOutput( level );
+    ImageType * cascade = pyramids[ 1 ]->GetOutput( level );
+    if( direct->GetLargestPossibleRegion() != cascade->GetLargestPossibleRegion()
+      || direct->GetSpacing() != cascade->GetSpacing()
+      || direct->GetOrigin() != cascade->GetOrigin() )
+    {
+      std::cerr << "ERROR: the geometry of level " << level << " differs." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    /** Skip a border of 3 times the largest sigma, in voxels of this level. */
+    const long margin = static_cast< long >( std::ceil( 3.0 * 0.5 * factors[ 0 ] / factors[ level ] ) );
+    ImageType::RegionType interior = direct->GetLargestPossibleRegion();
+    for( unsigned int dim = 0; dim < Dimension; ++dim )
+    {
+      interior.SetIndex( dim, interior.GetIndex( dim ) + margin );
+      interior.SetSize( dim, interior.GetSize( dim ) - 2 * margin );
+    }
+
+    double maxError = 0.0;
+    IteratorType itDirect( direct, interior );
+    IteratorType itCascade( cascade, interior );
+    for( itDirect.GoToBegin(), itCascade.GoToBegin(); !itDirect.IsAtEnd(); ++itDirect, ++itCascade )
+    {
+      maxError = std::max( maxError, std::abs(
+        static_cast< double >( itDirect.Get() ) - static_cast< double >( itCascade.Get() ) ) );
+    }
+    if( maxError > tolerance )
+    {
+      std::cerr << "ERROR: the cascade differs from the direct computation at level "
+                << level << " by " << maxError << "." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** Compare the levels computed from the input with smoothing along all axes
+   * followed by shrinking. The pixels are only picked in a different order, so
+   * the results should be equal up to rounding.
+   */
+  typedef itk::SmoothingRecursiveGaussianImageFilter< ImageType, ImageType > SmootherType;
+  typedef itk::ShrinkImageFilter< ImageType, ImageType >                     ShrinkerType;
+  for( unsigned int level = 0; level + 1 < numberOfLevels; ++level )
+  {
+    SmootherType::SigmaArrayType    sigmaArray;
+    ShrinkerType::ShrinkFactorsType shrinkFactors;
+    for( unsigned int dim = 0; dim < Dimension; ++dim )
+    {
+      sigmaArray[ dim ]    = smoothingSchedule[ level ][ dim ];
+      shrinkFactors[ dim ] = factors[ level ];
+    }
+    SmootherType::Pointer smoother = SmootherType::New();
+    smoother->SetInput( image );
+    smoother->SetSigmaArray( sigmaArray );
+    ShrinkerType::Pointer shrinker = ShrinkerType::New();
+    shrinker->SetInput( smoother->GetOutput() );
+    shrinker->SetShrinkFactors( shrinkFactors );
+    try
+    {
+      shrinker->Update();
+    }
+    catch( itk::ExceptionObject & e )
+    {
+      std::cerr << e << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    ImageType * direct    = pyramids[ 0 ]->GetOutput( level );
+    ImageType * reference = shrinker->GetOutput();
+    if( direct->GetLargestPossibleRegion() != reference->GetLargestPossibleRegion()
+      || direct->GetSpacing() != reference->GetSpacing()
+      || direct->GetOrigin() != reference->GetOrigin() )
+    {
+      std::cerr << "ERROR: the geometry of level " << level
+                << " differs from smoothing followed by shrinking." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    double maxError = 0.0;
+    IteratorType itDirect( direct, direct->GetLargestPossibleRegion() );
+    IteratorType itReference( reference, reference->GetLargestPossibleRegion() );
+    for( itDirect.GoToBegin(), itReference.GoToBegin(); !itDirect.IsAtEnd(); ++itDirect, ++itReference )
+    {
+      maxError = std::max( maxError, std::abs(
+        static_cast< double >( itDirect.Get() ) - static_cast< double >( itReference.Get() ) ) );
+    }
+    if( maxError > 1e-5 * range )
+    {
+      std::cerr << "ERROR: level " << level << " differs from smoothing followed by shrinking by "
+                << maxError << "." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,337 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkImageFileCastWriter.h"
+#include "itkChunkedZlibCodec.h"
+#include "itkChunkedMetaImageIO.h"
+#include "itkImageFileReader.h"
+#include "itkImageRegionIterator.h"
+#include "itkMetaDataObject.h"
+#include "itkTimeProbe.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdlib>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+// This test tests the chunked compression of the ImageFileCastWriter. A float image
+// is written as a compressed short MetaImage, in chunks and in one piece. Both files
+// are read with the ImageFileReader, and should equal the cast image, including the
+// geometry. They are also read with the ChunkedMetaImageIO, which should decompress
+// only the chunked image in parallel. The header of the chunked image should contain
+// all fields of the header that MetaImageIO writes, including the meta data
+// dictionary. The data file of the chunked image is also decompressed in parallel
+// with the chunk table of the header.
+
+namespace
+{
+const unsigned int Dimension = 3;
+typedef float                                      InputPixelType;
+typedef short                                      OutputPixelType;
+typedef itk::Image< InputPixelType, Dimension >    InputImageType;
+typedef itk::Image< OutputPixelType, Dimension >   OutputImageType;
+typedef itk::ImageFileCastWriter< InputImageType > WriterType;
+typedef itk::ImageFileReader< OutputImageType >    ReaderType;
+
+//-------------------------------------------------------------------------------------
+// Writes the image as a compressed short image, with the given chunk size.
+bool
+WriteImage( InputImageType * image, const std::string & fileName,
+  const itk::SizeValueType chunkSize )
+{
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetInput( image );
+  writer->SetFileName( fileName.c_str() );
+  writer->SetOutputComponentType( "short" );
+  writer->SetUseCompression( true );
+  writer->SetCompressionChunkSize( chunkSize );
+  writer->SetNumberOfThreads( 4 );
+
+  itk::TimeProbe timer;
+  try
+  {
+    timer.Start();
+    writer->Update();
+    timer.Stop();
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << e << std::endl;
+    return false;
+  }
+  std::cout << "Chunk size " << chunkSize << ": written in "
+            << std::setprecision( 4 ) << timer.GetMean() << " s" << std::endl;
+  return true;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Reads the image, and compares it with the cast input image. If a
+// ChunkedMetaImageIO is given, it is used for reading, and it should have
+// decompressed the chunks in parallel if and only if readChunksInParallel.
+bool
+CompareImage( InputImageType * image, const std::string & fileName,
+  itk::ChunkedMetaImageIO * metaImageIO = 0, bool readChunksInParallel = false )
+{
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( fileName.c_str() );
+  if( metaImageIO )
+  {
+    reader->SetImageIO( metaImageIO );
+  }
+  try
+  {
+    reader->Update();
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << e << std::endl;
+    return false;
+  }
+  OutputImageType * output = reader->GetOutput();
+
+  if( metaImageIO && metaImageIO->GetReadChunksInParallel() != readChunksInParallel )
+  {
+    std::cerr << "ERROR: the ChunkedMetaImageIO read " << fileName
+              << ( readChunksInParallel ? " serially." : " in parallel." ) << std::endl;
+    return false;
+  }
+
+  if( output->GetLargestPossibleRegion().GetSize() != image->GetLargestPossibleRegion().GetSize()
+    || output->GetSpacing() != image->GetSpacing()
+    || output->GetOrigin() != image->GetOrigin()
+    || output->GetDirection() != image->GetDirection() )
+  {
+    std::cerr << "ERROR: the geometry of " << fileName << " is wrong." << std::endl;
+    return false;
+  }
+
+  itk::ImageRegionIterator< InputImageType >  it( image, image->GetLargestPossibleRegion() );
+  itk::ImageRegionIterator< OutputImageType > ot( output, output->GetLargestPossibleRegion() );
+  for( it.GoToBegin(), ot.GoToBegin(); !it.IsAtEnd(); ++it, ++ot )
+  {
+    if( ot.Get() != static_cast< OutputPixelType >( it.Get() ) )
+    {
+      std::cerr << "ERROR: the pixel at " << it.GetIndex() << " of " << fileName
+                << " is " << ot.Get() << " instead of "
+                << static_cast< OutputPixelType >( it.Get() ) << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Reads the fields of a header, as a map from the names to the values.
+std::map< std::string, std::string >
+ReadHeader( const std::string & fileName )
+{
+  std::ifstream                        header( fileName.c_str() );
+  std::map< std::string, std::string > fields;
+  std::string                          line;
+  while( std::getline( header, line ) )
+  {
+    const std::string::size_type equals = line.find( " = " );
+    if( equals != std::string::npos )
+    {
+      fields[ line.substr( 0, equals ) ] = line.substr( equals + 3 );
+    }
+  }
+  return fields;
+}
+
+
+} // end namespace
+
+int
+main( int argc, char * argv[] )
+{
+  if( argc != 2 )
+  {
+    std::cerr << "ERROR: You should specify the output directory." << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string outputDirectory = argv[ 1 ];
+  const std::string chunkedFileName = outputDirectory + "/ImageFileCastWriterChunked.mhd";
+  const std::string singleFileName  = outputDirectory + "/ImageFileCastWriterSingle.mhd";
+
+  /** Create a float image with a smooth pattern and some noise. */
+  InputImageType::SizeType size;
+  size[ 0 ] = 97; size[ 1 ] = 64; size[ 2 ] = 45;
+  InputImageType::SpacingType spacing;
+  spacing[ 0 ] = 0.7; spacing[ 1 ] = 1.1; spacing[ 2 ] = 2.5;
+  InputImageType::PointType origin;
+  origin[ 0 ] = -12.3; origin[ 1 ] = 4.56; origin[ 2 ] = 0.1;
+  InputImageType::DirectionType direction;
+  direction.SetIdentity();
+  direction[ 0 ][ 0 ] = 0.0; direction[ 0 ][ 1 ] = 1.0;
+  direction[ 1 ][ 0 ] = -1.0; direction[ 1 ][ 1 ] = 0.0;
+
+  InputImageType::Pointer image = InputImageType::New();
+  image->SetRegions( size );
+  image->SetSpacing( spacing );
+  image->SetOrigin( origin );
+  image->SetDirection( direction );
+  image->Allocate();
+  itk::EncapsulateMetaData< std::string >( image->GetMetaDataDictionary(), "PatientName", "Phantom" );
+  itk::EncapsulateMetaData< std::string >( image->GetMetaDataDictionary(), "ProtocolName", "T1 3D" );
+  itk::ImageRegionIterator< InputImageType > it( image, image->GetLargestPossibleRegion() );
+  unsigned int                               seed = 1;
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const InputImageType::IndexType index = it.GetIndex();
+    seed = seed * 1103515245u + 12345u;
+    it.Set( static_cast< InputPixelType >( 1000.0 * std::sin( 0.1 * index[ 0 ] + 0.05 * index[ 2 ] )
+      + 20.0 * index[ 1 ] + ( ( seed >> 16 ) % 100 ) * 0.37 ) );
+  }
+
+  /** Write the image in chunks that do not divide the image, and in one piece. */
+  const itk::SizeValueType chunkSize = 10001;
+  if( !WriteImage( image, chunkedFileName, chunkSize ) || !WriteImage( image, singleFileName, 0 ) )
+  {
+    std::cerr << "ERROR: the image could not be written." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if( !CompareImage( image, chunkedFileName ) || !CompareImage( image, singleFileName ) )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Read both images with the ChunkedMetaImageIO. */
+  itk::ChunkedMetaImageIO::Pointer metaImageIO = itk::ChunkedMetaImageIO::New();
+  metaImageIO->SetNumberOfThreads( 4 );
+  if( !CompareImage( image, chunkedFileName, metaImageIO, true )
+    || !CompareImage( image, singleFileName, metaImageIO, false ) )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** The chunked header should contain the fields of the single header, with the
+   * same values for the meta data dictionary.
+   */
+  typedef std::map< std::string, std::string > FieldsType;
+  const FieldsType chunkedHeader = ReadHeader( chunkedFileName );
+  const FieldsType singleHeader  = ReadHeader( singleFileName );
+  for( FieldsType::const_iterator field = singleHeader.begin(); field != singleHeader.end(); ++field )
+  {
+    if( chunkedHeader.find( field->first ) == chunkedHeader.end() )
+    {
+      std::cerr << "ERROR: the field " << field->first << " of " << singleFileName
+                << " is missing in " << chunkedFileName << "." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  const char * dictionaryKeys[ 2 ]   = { "PatientName", "ProtocolName" };
+  const char * dictionaryValues[ 2 ] = { "Phantom", "T1 3D" };
+  for( unsigned int i = 0; i < 2; ++i )
+  {
+    const FieldsType::const_iterator field = chunkedHeader.find( dictionaryKeys[ i ] );
+    if( field == chunkedHeader.end() || field->second != dictionaryValues[ i ] )
+    {
+      std::cerr << "ERROR: the meta data " << dictionaryKeys[ i ] << " is not written in "
+                << chunkedFileName << "." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** Read the chunk table from the header. */
+  itk::SizeValueType                    compressedDataSize = 0;
+  itk::SizeValueType                    chunkLength        = 0;
+  itk::ChunkedZlibCodec::ChunkSizesType compressedChunkSizes;
+  if( chunkedHeader.count( "CompressedDataSize" ) == 0 || chunkedHeader.count( "CompressedDataChunkLength" ) == 0 )
+  {
+    std::cerr << "ERROR: the compressed data size or chunk length is missing in the header." << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::istringstream sizeStream( chunkedHeader.find( "CompressedDataSize" )->second );
+  std::istringstream lengthStream( chunkedHeader.find( "CompressedDataChunkLength" )->second );
+  sizeStream >> compressedDataSize;
+  lengthStream >> chunkLength;
+  for( unsigned int k = 0;; ++k )
+  {
+    std::ostringstream name;
+    name << "CompressedDataChunkSizes_" << k;
+    const FieldsType::const_iterator field = chunkedHeader.find( name.str() );
+    if( field == chunkedHeader.end() )
+    {
+      break;
+    }
+    std::istringstream stream( field->second );
+    itk::SizeValueType value;
+    while( stream >> value )
+    {
+      compressedChunkSizes.push_back( value );
+    }
+  }
+  const itk::SizeValueType numberOfBytes = size[ 0 ] * size[ 1 ] * size[ 2 ] * sizeof( OutputPixelType );
+  const itk::SizeValueType expectedChunkLength = chunkSize / sizeof( OutputPixelType ) * sizeof( OutputPixelType );
+  if( chunkLength != expectedChunkLength
+    || compressedChunkSizes.size() != ( numberOfBytes + chunkLength - 1 ) / chunkLength )
+  {
+    std::cerr << "ERROR: the chunk table of the header is wrong." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Decompress the data file in parallel. */
+  std::vector< unsigned char > stream( compressedDataSize );
+  {
+    std::ifstream data( ( outputDirectory + "/ImageFileCastWriterChunked.zraw" ).c_str(),
+      std::ios::in | std::ios::binary );
+    data.read( reinterpret_cast< char * >( &stream[ 0 ] ), compressedDataSize );
+    if( data.gcount() != static_cast< std::streamsize >( compressedDataSize ) )
+    {
+      std::cerr << "ERROR: the data file is shorter than CompressedDataSize." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  std::vector< OutputPixelType > decompressed( size[ 0 ] * size[ 1 ] * size[ 2 ] );
+  if( !itk::ChunkedZlibCodec::DecompressChunks( &stream[ 0 ], stream.size(), chunkLength,
+    compressedChunkSizes, &decompressed[ 0 ], numberOfBytes, 4 ) )
+  {
+    std::cerr << "ERROR: the data could not be decompressed in parallel." << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::size_t i = 0;
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it, ++i )
+  {
+    if( decompressed[ i ] != static_cast< OutputPixelType >( it.Get() ) )
+    {
+      std::cerr << "ERROR: the parallel decompressed pixel " << i << " is wrong." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** A corrupt chunk should be detected. */
+  stream[ stream.size() / 2 ] ^= 0x5a;
+  if( itk::ChunkedZlibCodec::DecompressChunks( &stream[ 0 ], stream.size(), chunkLength,
+    compressedChunkSizes, &decompressed[ 0 ], numberOfBytes, 4 ) )
+  {
+    std::cerr << "ERROR: a corrupt stream is not detected." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,132 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkImageRandomCoordinateSampler.h"
+#include "itkImage.h"
+#include "itkImageRegionIterator.h"
+#include "itkTimeProbe.h"
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+// This test tests the batched interpolation of the ImageRandomCoordinateSampler.
+// The samples drawn with and without batched interpolation, with the same seed, are
+// compared. The coordinates should be identical, and the values, which are in the
+// order of 100, should be equal up to the single precision of the batched B-spline
+// coefficients. Both the single threaded and the multi-threaded code paths are tested.
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int Dimension = 3;
+  typedef float                                          PixelType;
+  typedef itk::Image< PixelType, Dimension >             ImageType;
+  typedef itk::ImageRandomCoordinateSampler< ImageType > SamplerType;
+  typedef SamplerType::ImageSampleContainerType          SampleContainerType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator GeneratorType;
+
+  /** Create a smooth test image with a non-zero start index. */
+  ImageType::RegionType region;
+  ImageType::SizeType   size;
+  ImageType::IndexType  index;
+  size[ 0 ] = 40; size[ 1 ] = 30; size[ 2 ] = 20;
+  index[ 0 ] = 2; index[ 1 ] = -3; index[ 2 ] = 0;
+  region.SetSize( size );
+  region.SetIndex( index );
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+
+  itk::ImageRegionIterator< ImageType > it( image, region );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const ImageType::IndexType ind = it.GetIndex();
+    it.Set( static_cast< PixelType >( 100.0 * std::sin( 0.2 * ind[ 0 ] )
+      + 50.0 * std::cos( 0.3 * ind[ 1 ] ) + 2.0 * ind[ 2 ] ) );
+  }
+
+  const unsigned long numberOfSamples = 20000;
+  const double        tolerance       = 1e-2;
+  const unsigned int  threads[ 2 ]    = { 1, 4 };
+
+  for( unsigned int t = 0; t < 2; ++t )
+  {
+    SampleContainerType::Pointer samples[ 2 ];
+    double                       times[ 2 ];
+    for( unsigned int batched = 0; batched < 2; ++batched )
+    {
+      SamplerType::Pointer sampler = SamplerType::New();
+      sampler->SetInput( image );
+      sampler->SetNumberOfSamples( numberOfSamples );
+      sampler->SetUseMultiThread( threads[ t ] > 1 );
+      sampler->SetNumberOfThreads( threads[ t ] );
+      sampler->SetUseBatchedInterpolation( batched == 1 );
+      sampler->SetInputImageRegion( region );
+
+      /** Generate twice; the second run uses the cached coefficients,
+       * and the same seed for both samplers. */
+      sampler->Update();
+      GeneratorType::GetInstance()->SetSeed( 12345 );
+      itk::TimeProbe timer;
+      timer.Start();
+      sampler->Modified();
+      sampler->Update();
+      timer.Stop();
+      times[ batched ]   = timer.GetMean();
+      samples[ batched ] = sampler->GetOutput();
+    }
+
+    if( samples[ 0 ]->Size() != numberOfSamples || samples[ 1 ]->Size() != numberOfSamples )
+    {
+      std::cerr << "ERROR: the number of samples is wrong." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    double maxError = 0.0;
+    for( unsigned long i = 0; i < numberOfSamples; ++i )
+    {
+      const SamplerType::ImageSampleType & s0 = samples[ 0 ]->ElementAt( i );
+      const SamplerType::ImageSampleType & s1 = samples[ 1 ]->ElementAt( i );
+      if( s0.m_ImageCoordinates != s1.m_ImageCoordinates )
+      {
+        std::cerr << "ERROR: the sample coordinates differ at sample " << i << "." << std::endl;
+        return EXIT_FAILURE;
+      }
+      const double error = std::abs( static_cast< double >( s0.m_ImageValue - s1.m_ImageValue ) );
+      maxError = error > maxError ? error : maxError;
+    }
+
+    std::cout << "Threads: " << threads[ t ]
+              << "  default: " << std::setprecision( 4 ) << times[ 0 ] << " s"
+              << "  batched: " << times[ 1 ] << " s"
+              << "  max difference: " << maxError << std::endl;
+
+    if( maxError > tolerance )
+    {
+      std::cerr << "ERROR: the batched values differ " << maxError
+                << " from the default interpolator." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
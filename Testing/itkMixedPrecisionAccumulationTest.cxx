@@ -0,0 +1,188 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "AdvancedMattesMutualInformation/itkParzenWindowMutualInformationImageToImageMetric.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedLinearInterpolateImageFunction.h"
+#include "itkImageFullSampler.h"
+#include "itkImageRegionIterator.h"
+
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+// This test tests the single precision accumulation of the derivative by the
+// metrics. The value and derivative of the AdvancedMeanSquares and the
+// ParzenWindowMutualInformation metric are computed for a B-spline transform with
+// many parameters, with UseSinglePrecisionAccumulation off and on. The per-thread
+// derivatives are accumulated in float, and summed in double, so the results
+// should be the same up to a relative tolerance.
+
+namespace
+{
+const unsigned int Dimension = 3;
+typedef float                                    PixelType;
+typedef itk::Image< PixelType, Dimension >       ImageType;
+typedef itk::AdvancedImageToImageMetric<
+  ImageType, ImageType >                         MetricType;
+typedef MetricType::MeasureType                  MeasureType;
+typedef MetricType::DerivativeType               DerivativeType;
+typedef MetricType::TransformParametersType      ParametersType;
+
+//-------------------------------------------------------------------------------------
+// Computes the value and derivative of the metric with UseSinglePrecisionAccumulation
+// off and on, and returns whether the results are the same within the tolerance.
+bool
+CompareDoubleAndSinglePrecision( MetricType * metric, const ParametersType & parameters,
+  const std::string & name, const double tolerance )
+{
+  MeasureType    value[ 2 ];
+  DerivativeType derivative[ 2 ];
+  for( unsigned int d = 0; d < 2; ++d )
+  {
+    const bool useSinglePrecision = ( d == 1 );
+    metric->SetUseSinglePrecisionAccumulation( useSinglePrecision );
+    metric->Initialize();
+
+    metric->GetValueAndDerivative( parameters, value[ d ], derivative[ d ] );
+  }
+
+  /** Compare the value and the derivative, relative to their magnitude. */
+  const double valueError = std::abs( value[ 1 ] - value[ 0 ] )
+    / std::max( std::abs( value[ 0 ] ), 1e-8 );
+  const double referenceNorm   = derivative[ 0 ].two_norm();
+  const double derivativeError = ( derivative[ 1 ] - derivative[ 0 ] ).two_norm()
+    / std::max( referenceNorm, 1e-8 );
+  std::cout << name << " relative difference of value: " << valueError
+            << ", of derivative: " << derivativeError << std::endl;
+
+  if( !( referenceNorm > 0.0 ) || valueError > tolerance || derivativeError > tolerance )
+  {
+    std::cerr << "ERROR: " << name << ": the single precision accumulation differs "
+              << "too much from the double precision accumulation." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+} // end namespace
+
+int
+main( int argc, char * argv[] )
+{
+  typedef itk::AdvancedMeanSquaresImageToImageMetric<
+    ImageType, ImageType >                                   MeanSquaresMetricType;
+  typedef itk::ParzenWindowMutualInformationImageToImageMetric<
+    ImageType, ImageType >                                   MutualInformationMetricType;
+  typedef itk::AdvancedBSplineDeformableTransform<
+    double, Dimension, 3 >                                   TransformType;
+  typedef itk::AdvancedLinearInterpolateImageFunction<
+    ImageType, double >                                      InterpolatorType;
+  typedef itk::ImageFullSampler< ImageType >                 SamplerType;
+  typedef itk::ImageRegionIterator< ImageType >              IteratorType;
+
+  const double tolerance = 1e-4;
+
+  try
+  {
+    /** Create a fixed and a moving image with a shifted blob. */
+    ImageType::SizeType imageSize;
+    imageSize.Fill( 64 );
+    ImageType::Pointer fixedImage  = ImageType::New();
+    ImageType::Pointer movingImage = ImageType::New();
+    fixedImage->SetRegions( imageSize );
+    fixedImage->Allocate();
+    movingImage->SetRegions( imageSize );
+    movingImage->Allocate();
+    IteratorType fit( fixedImage, fixedImage->GetLargestPossibleRegion() );
+    IteratorType mit( movingImage, movingImage->GetLargestPossibleRegion() );
+    for( fit.GoToBegin(), mit.GoToBegin(); !fit.IsAtEnd(); ++fit, ++mit )
+    {
+      const ImageType::IndexType index = fit.GetIndex();
+      const double               x     = index[ 0 ] - 32.0;
+      const double               y     = index[ 1 ] - 32.0;
+      const double               z     = index[ 2 ] - 32.0;
+      fit.Set( static_cast< PixelType >( 100.0 * std::exp( -( x * x + y * y + z * z ) / 300.0 ) ) );
+      mit.Set( static_cast< PixelType >( 100.0 * std::exp(
+        -( ( x - 2.3 ) * ( x - 2.3 ) + y * y + ( z + 1.7 ) * ( z + 1.7 ) ) / 350.0 ) ) );
+    }
+
+    /** Create a B-spline transform with many parameters, with some deformation. */
+    TransformType::Pointer       transform = TransformType::New();
+    TransformType::SizeType      gridSize;
+    TransformType::SpacingType   gridSpacing;
+    TransformType::OriginType    gridOrigin;
+    TransformType::DirectionType gridDirection;
+    gridSize.Fill( 20 );
+    gridSpacing.Fill( 4.0 );
+    gridOrigin.Fill( -6.0 );
+    gridDirection.SetIdentity();
+    TransformType::RegionType gridRegion;
+    gridRegion.SetSize( gridSize );
+    transform->SetGridRegion( gridRegion );
+    transform->SetGridSpacing( gridSpacing );
+    transform->SetGridOrigin( gridOrigin );
+    transform->SetGridDirection( gridDirection );
+    ParametersType parameters( transform->GetNumberOfParameters() );
+    for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+    {
+      parameters[ i ] = 0.5 * std::sin( 0.37 * i );
+    }
+    transform->SetParameters( parameters );
+
+    /** Create the metrics. */
+    MeanSquaresMetricType::Pointer       meanSquares       = MeanSquaresMetricType::New();
+    MutualInformationMetricType::Pointer mutualInformation = MutualInformationMetricType::New();
+    mutualInformation->SetNumberOfFixedHistogramBins( 32 );
+    mutualInformation->SetNumberOfMovingHistogramBins( 32 );
+    mutualInformation->SetUseExplicitPDFDerivatives( false );
+
+    MetricType::Pointer metrics[ 2 ] = { meanSquares.GetPointer(), mutualInformation.GetPointer() };
+    const std::string   metricNames[ 2 ] = { "MeanSquares", "MutualInformation" };
+
+    for( unsigned int m = 0; m < 2; ++m )
+    {
+      MetricType * metric = metrics[ m ];
+      metric->SetFixedImage( fixedImage );
+      metric->SetMovingImage( movingImage );
+      metric->SetFixedImageRegion( fixedImage->GetLargestPossibleRegion() );
+      metric->SetTransform( transform );
+      metric->SetInterpolator( InterpolatorType::New() );
+      metric->SetImageSampler( SamplerType::New() );
+      metric->SetNumberOfThreads( 4 );
+
+      if( !CompareDoubleAndSinglePrecision( metric, parameters, metricNames[ m ], tolerance ) )
+      {
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "Caught ITK exception: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
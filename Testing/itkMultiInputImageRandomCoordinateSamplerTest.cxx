@@ -0,0 +1,153 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkMultiInputImageRandomCoordinateSampler.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImage.h"
+#include "itkImageRegionIterator.h"
+#include "itkTimeProbe.h"
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+// This test tests the channel values of the MultiInputImageRandomCoordinateSampler.
+// Three channels are sampled, of which the last one has a different spacing, so that
+// it can not share the interpolation weights of the first channel. The channel values
+// are compared with the values of a BSplineInterpolateImageFunction per channel, for
+// spline orders 1 and 3, single and multi-threaded.
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int Dimension = 3;
+  typedef float                                                    PixelType;
+  typedef itk::Image< PixelType, Dimension >                       ImageType;
+  typedef itk::MultiInputImageRandomCoordinateSampler< ImageType > SamplerType;
+  typedef SamplerType::ImageSampleContainerType                    SampleContainerType;
+  typedef SamplerType::ChannelValueContainerType                   ChannelValueContainerType;
+  typedef itk::BSplineInterpolateImageFunction<
+    ImageType, double, double >                                    InterpolatorType;
+
+  /** Create three smooth test images. */
+  const unsigned int    numberOfChannels = 3;
+  ImageType::Pointer    images[ numberOfChannels ];
+  ImageType::RegionType region;
+  ImageType::SizeType   size;
+  size[ 0 ] = 30; size[ 1 ] = 25; size[ 2 ] = 20;
+  region.SetSize( size );
+  for( unsigned int c = 0; c < numberOfChannels; ++c )
+  {
+    ImageType::SpacingType spacing;
+    spacing.Fill( c < 2 ? 1.0 : 1.5 );
+    images[ c ] = ImageType::New();
+    images[ c ]->SetRegions( region );
+    images[ c ]->SetSpacing( spacing );
+    images[ c ]->Allocate();
+
+    itk::ImageRegionIterator< ImageType > it( images[ c ], region );
+    for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+      const ImageType::IndexType ind = it.GetIndex();
+      it.Set( static_cast< PixelType >( 10.0 * std::sin( 0.2 * ( c + 1 ) * ind[ 0 ] )
+        + 5.0 * std::cos( 0.3 * ind[ 1 ] ) + 0.5 * c * ind[ 2 ] ) );
+    }
+  }
+
+  const unsigned long numberOfSamples   = 10000;
+  const double        tolerance         = 1e-4;
+  const unsigned int  splineOrders[ 2 ] = { 1, 3 };
+  const unsigned int  threads[ 2 ]      = { 1, 4 };
+
+  for( unsigned int o = 0; o < 2; ++o )
+  {
+    /** The reference interpolators. */
+    InterpolatorType::Pointer interpolators[ numberOfChannels ];
+    for( unsigned int c = 0; c < numberOfChannels; ++c )
+    {
+      interpolators[ c ] = InterpolatorType::New();
+      interpolators[ c ]->SetSplineOrder( splineOrders[ o ] );
+      interpolators[ c ]->SetInputImage( images[ c ] );
+    }
+
+    for( unsigned int t = 0; t < 2; ++t )
+    {
+      InterpolatorType::Pointer interpolator = InterpolatorType::New();
+      interpolator->SetSplineOrder( splineOrders[ o ] );
+
+      SamplerType::Pointer sampler = SamplerType::New();
+      for( unsigned int c = 0; c < numberOfChannels; ++c )
+      {
+        sampler->SetInput( c, images[ c ] );
+        sampler->SetInputImageRegion( region, c );
+      }
+      sampler->SetInterpolator( interpolator );
+      sampler->SetNumberOfSamples( numberOfSamples );
+      sampler->SetUseMultiThread( threads[ t ] > 1 );
+      sampler->SetNumberOfThreads( threads[ t ] );
+      sampler->SetComputeChannelValues( true );
+
+      itk::TimeProbe timer;
+      timer.Start();
+      sampler->Update();
+      timer.Stop();
+
+      const SampleContainerType *       samples       = sampler->GetOutput();
+      const ChannelValueContainerType & channelValues = sampler->GetChannelValues();
+      if( sampler->GetNumberOfChannels() != numberOfChannels
+        || channelValues.size() != samples->Size() * numberOfChannels )
+      {
+        std::cerr << "ERROR: the number of channel values is wrong." << std::endl;
+        return EXIT_FAILURE;
+      }
+
+      double maxError = 0.0;
+      for( unsigned long i = 0; i < samples->Size(); ++i )
+      {
+        const SamplerType::ImageSampleType & sample = samples->ElementAt( i );
+        for( unsigned int c = 0; c < numberOfChannels; ++c )
+        {
+          const double reference = interpolators[ c ]->Evaluate( sample.m_ImageCoordinates );
+          const double error     = std::abs( reference - channelValues[ i * numberOfChannels + c ] );
+          maxError = error > maxError ? error : maxError;
+        }
+        if( sample.m_ImageValue != channelValues[ i * numberOfChannels ] )
+        {
+          std::cerr << "ERROR: the sample value differs from the first channel value." << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+
+      std::cout << "Spline order: " << splineOrders[ o ] << "  threads: " << threads[ t ]
+                << "  time: " << std::setprecision( 4 ) << timer.GetMean() << " s"
+                << "  max difference: " << maxError << std::endl;
+
+      if( maxError > tolerance )
+      {
+        std::cerr << "ERROR: the channel values differ " << maxError
+                  << " from the BSplineInterpolateImageFunction." << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,108 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkTestHelper.h"
+#include "itkOpenCLKernelManager.h"
+#include "itkTimeProbe.h"
+
+#include "itksys/SystemTools.hxx"
+
+//------------------------------------------------------------------------------
+// This test tests the on-disk program cache of the OpenCLKernelManager.
+// A program is built twice, by two kernel managers. The first build compiles
+// from source and stores the binary, the second one should load the binary.
+// A program with a different prefix source should not be taken from the cache.
+// This test can be run on a CPU OpenCL implementation, such as POCL.
+int
+main( int argc, char * argv[] )
+{
+  const std::string source
+    = "__kernel void CacheKernel( __global float *output, float input )\n"
+      "{\n"
+      "  output[ get_global_id( 0 ) ] = SCALE * input;\n"
+      "}\n";
+
+  try
+  {
+    itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
+    context->Create( itk::OpenCLContext::SingleMaximumFlopsDevice );
+    if( !context->IsCreated() )
+    {
+      itk::ReleaseContext();
+      return EXIT_FAILURE;
+    }
+
+    // Start with an empty cache
+    const std::string cacheDirectory
+      = itksys::SystemTools::GetCurrentWorkingDirectory() + "/OpenCLProgramCacheTest";
+    itksys::SystemTools::RemoveADirectory( cacheDirectory.c_str() );
+    itk::OpenCLKernelManager::SetProgramCacheDirectory( cacheDirectory );
+
+    // Build from source
+    itk::TimeProbe                    timer1;
+    itk::OpenCLKernelManager::Pointer manager1 = itk::OpenCLKernelManager::New();
+    timer1.Start();
+    itk::OpenCLProgram program1 = manager1->BuildProgramFromSourceCode( source, "#define SCALE 2.0f" );
+    timer1.Stop();
+    if( program1.IsNull() || manager1->GetLastProgramLoadedFromCache() )
+    {
+      itkGenericExceptionMacro( << "The first build should be from source." );
+    }
+    if( program1.CreateKernel( "CacheKernel" ).IsNull() )
+    {
+      itkGenericExceptionMacro( << "Could not create the kernel from source." );
+    }
+
+    // Build from the cache
+    itk::TimeProbe                    timer2;
+    itk::OpenCLKernelManager::Pointer manager2 = itk::OpenCLKernelManager::New();
+    timer2.Start();
+    itk::OpenCLProgram program2 = manager2->BuildProgramFromSourceCode( source, "#define SCALE 2.0f" );
+    timer2.Stop();
+    if( program2.IsNull() || !manager2->GetLastProgramLoadedFromCache() )
+    {
+      itkGenericExceptionMacro( << "The second build should be from the cache." );
+    }
+    if( program2.CreateKernel( "CacheKernel" ).IsNull() )
+    {
+      itkGenericExceptionMacro( << "Could not create the kernel from the cache." );
+    }
+
+    // Another source should not hit the cache
+    itk::OpenCLKernelManager::Pointer manager3 = itk::OpenCLKernelManager::New();
+    itk::OpenCLProgram program3 = manager3->BuildProgramFromSourceCode( source, "#define SCALE 3.0f" );
+    if( program3.IsNull() || manager3->GetLastProgramLoadedFromCache() )
+    {
+      itkGenericExceptionMacro( << "A different source should be built from source." );
+    }
+
+    std::cout << "Build from source: " << timer1.GetMean() << " s, "
+              << "build from cache: " << timer2.GetMean() << " s" << std::endl;
+
+    itk::OpenCLKernelManager::SetProgramCacheDirectory( "" );
+    itksys::SystemTools::RemoveADirectory( cacheDirectory.c_str() );
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "Caught ITK exception: " << e << std::endl;
+    itk::ReleaseContext();
+    return EXIT_FAILURE;
+  }
+
+  itk::ReleaseContext();
+  return EXIT_SUCCESS;
+}
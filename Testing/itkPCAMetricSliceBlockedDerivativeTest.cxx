@@ -0,0 +1,195 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "PCAMetric/itkPCAMetric_F_multithreaded.h"
+#include "itkStackTransform.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedLinearInterpolateImageFunction.h"
+#include "itkImageGridSampler.h"
+#include "itkImageRegionIterator.h"
+#include "itkTimeProbe.h"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+// This test tests the slice-blocked derivative of the PCAMetric. A 2D+t image is
+// registered groupwise with a StackTransform of B-spline transforms. The value and
+// derivative are computed multi-threaded, with the threads assigned to samples and
+// with the threads assigned to time points. The results should be equal up to the
+// order of summation. Also the sub transform index of the StackTransform is checked.
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int Dimension = 3;
+  typedef float                                                  PixelType;
+  typedef itk::Image< PixelType, Dimension >                     ImageType;
+  typedef itk::PCAMetric< ImageType, ImageType >                 MetricType;
+  typedef MetricType::MeasureType                                MeasureType;
+  typedef MetricType::DerivativeType                             DerivativeType;
+  typedef MetricType::TransformParametersType                    ParametersType;
+  typedef itk::StackTransform< double, Dimension, Dimension >    StackTransformType;
+  typedef itk::AdvancedBSplineDeformableTransform<
+    double, Dimension - 1, 3 >                                   BSplineTransformType;
+  typedef itk::AdvancedCombinationTransform< double, Dimension > CombinationTransformType;
+  typedef itk::AdvancedLinearInterpolateImageFunction<
+    ImageType, double >                                          InterpolatorType;
+  typedef itk::ImageGridSampler< ImageType >                     SamplerType;
+
+  /** Create a 2D+t image of a blob moving over time. */
+  const unsigned int  numberOfTimePoints = 12;
+  ImageType::SizeType size;
+  size[ 0 ] = 48; size[ 1 ] = 48; size[ 2 ] = numberOfTimePoints;
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( size );
+  image->Allocate();
+  itk::ImageRegionIterator< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const ImageType::IndexType index = it.GetIndex();
+    const double               x     = index[ 0 ] - 24.0 - 0.4 * index[ 2 ];
+    const double               y     = index[ 1 ] - 22.0 + 0.3 * index[ 2 ];
+    it.Set( static_cast< PixelType >( 100.0 * std::exp( -( x * x + y * y ) / 90.0 ) ) );
+  }
+
+  /** Create a stack of B-spline transforms, one for each time point. */
+  BSplineTransformType::Pointer       bspline = BSplineTransformType::New();
+  BSplineTransformType::SizeType      gridSize;
+  BSplineTransformType::SpacingType   gridSpacing;
+  BSplineTransformType::OriginType    gridOrigin;
+  BSplineTransformType::DirectionType gridDirection;
+  gridSize.Fill( 9 );
+  gridSpacing.Fill( 8.0 );
+  gridOrigin.Fill( -9.0 );
+  gridDirection.SetIdentity();
+  BSplineTransformType::RegionType gridRegion;
+  gridRegion.SetSize( gridSize );
+  bspline->SetGridRegion( gridRegion );
+  bspline->SetGridSpacing( gridSpacing );
+  bspline->SetGridOrigin( gridOrigin );
+  bspline->SetGridDirection( gridDirection );
+  ParametersType bsplineParameters( bspline->GetNumberOfParameters() );
+  bsplineParameters.Fill( 0.0 );
+  bspline->SetParameters( bsplineParameters );
+
+  StackTransformType::Pointer stack = StackTransformType::New();
+  stack->SetNumberOfSubTransforms( numberOfTimePoints );
+  stack->SetStackOrigin( 0.0 );
+  stack->SetStackSpacing( 1.0 );
+  stack->SetAllSubTransforms( bspline );
+
+  ParametersType parameters( stack->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = 0.8 * std::sin( 0.23 * i );
+  }
+  stack->SetParameters( parameters );
+
+  if( stack->GetNumberOfParametersPerSubTransform() * numberOfTimePoints != stack->GetNumberOfParameters() )
+  {
+    std::cerr << "ERROR: the number of parameters per sub transform is wrong." << std::endl;
+    return EXIT_FAILURE;
+  }
+  for( unsigned int t = 0; t < numberOfTimePoints; ++t )
+  {
+    StackTransformType::InputPointType point;
+    point[ 0 ] = 10.0; point[ 1 ] = 20.0; point[ 2 ] = t + 0.2;
+    if( stack->GetSubTransformIndex( point ) != t )
+    {
+      std::cerr << "ERROR: the sub transform index of time point " << t << " is wrong." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  CombinationTransformType::Pointer transform = CombinationTransformType::New();
+  transform->SetCurrentTransform( stack );
+
+  /** Sample every other voxel of the first time point. */
+  SamplerType::Pointer              sampler = SamplerType::New();
+  SamplerType::SampleGridSpacingType samplingSpacing;
+  samplingSpacing[ 0 ] = 2; samplingSpacing[ 1 ] = 2; samplingSpacing[ 2 ] = numberOfTimePoints;
+  sampler->SetSampleGridSpacing( samplingSpacing );
+
+  MetricType::Pointer metric = MetricType::New();
+  metric->SetFixedImage( image );
+  metric->SetMovingImage( image );
+  metric->SetFixedImageRegion( image->GetLargestPossibleRegion() );
+  metric->SetTransform( transform );
+  metric->SetInterpolator( InterpolatorType::New() );
+  metric->SetImageSampler( sampler );
+  metric->SetNumEigenValues( 3 );
+  metric->SetUseMultiThread( true );
+  metric->SetNumberOfThreads( 4 );
+
+  /** Compute the value and derivative with both thread assignments. */
+  MeasureType    value[ 2 ];
+  DerivativeType derivative[ 2 ];
+  try
+  {
+    for( unsigned int b = 0; b < 2; ++b )
+    {
+      metric->SetUseSliceBlockedDerivative( b == 1 );
+      metric->Initialize();
+
+      itk::TimeProbe timer;
+      for( unsigned int r = 0; r < 5; ++r )
+      {
+        timer.Start();
+        metric->GetValueAndDerivative( parameters, value[ b ], derivative[ b ] );
+        timer.Stop();
+      }
+      std::cout << "Slice-blocked derivative: " << b
+                << "  time: " << std::setprecision( 4 ) << timer.GetMean() << " s"
+                << "  value: " << value[ b ] << std::endl;
+    }
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "Caught ITK exception: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( derivative[ 0 ].GetSize() != derivative[ 1 ].GetSize() )
+  {
+    std::cerr << "ERROR: the size of the slice-blocked derivative is wrong." << std::endl;
+    return EXIT_FAILURE;
+  }
+  double maxDifference = 0.0;
+  for( unsigned int i = 0; i < derivative[ 0 ].GetSize(); ++i )
+  {
+    maxDifference = std::max( maxDifference,
+      static_cast< double >( std::abs( derivative[ 1 ][ i ] - derivative[ 0 ][ i ] ) ) );
+  }
+  const double relativeDifference = maxDifference
+    / std::max( static_cast< double >( derivative[ 0 ].inf_norm() ), 1e-12 );
+  std::cout << "Max relative difference of the derivative: " << relativeDifference << std::endl;
+
+  if( value[ 0 ] != value[ 1 ] || relativeDifference > 1e-10 )
+  {
+    std::cerr << "ERROR: the slice-blocked derivative differs." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,244 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "PreconditionedStochasticGradientDescent/itkPreconditionedStochasticGradientDescentOptimizer.h"
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedTranslationTransform.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkImageFullSampler.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkImageRegionIterator.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+// This test tests the PreconditionedStochasticGradientDescentOptimizer with the
+// SelfHessian of the AdvancedMeanSquares metric of a B-spline transform.
+// - The BlockJacobi preconditioner, with blocks of the parameters of each control
+//   point, should be the inverse of the regularized diagonal blocks of the
+//   SelfHessian, and the Diagonal preconditioner that of its diagonal.
+// - Both preconditioners should decrease the metric value.
+// - The elastix component only uses BlockJacobi when the metric reports a B-spline
+//   transform, so this is checked for a B-spline, a translation, and a combination
+//   transform with a B-spline as current transform. The translation has as many
+//   parameters as the image dimension, so it would pass a check on the number of
+//   parameters only.
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int Dimension   = 2;
+  const unsigned int SplineOrder = 3;
+  typedef float                                   PixelType;
+  typedef itk::Image< PixelType, Dimension >      ImageType;
+  typedef itk::ImageRegionIterator< ImageType >   IteratorType;
+  typedef itk::AdvancedMeanSquaresImageToImageMetric<
+    ImageType, ImageType >                        MetricType;
+  typedef MetricType::CSRHessianType              CSRHessianType;
+  typedef itk::AdvancedBSplineDeformableTransform<
+    double, Dimension, SplineOrder >              BSplineTransformType;
+  typedef itk::AdvancedTranslationTransform<
+    double, Dimension >                           TranslationTransformType;
+  typedef itk::AdvancedCombinationTransform<
+    double, Dimension >                           CombinationTransformType;
+  typedef BSplineTransformType::ParametersType    ParametersType;
+  typedef itk::ImageFullSampler< ImageType >      SamplerType;
+  typedef itk::LinearInterpolateImageFunction<
+    ImageType, double >                           InterpolatorType;
+  typedef itk::PreconditionedStochasticGradientDescentOptimizer OptimizerType;
+  typedef OptimizerType::PreconditionerValuesType               PreconditionerValuesType;
+
+  /** Create a fixed and a moving image with a shifted blob. */
+  ImageType::SizeType imageSize;
+  imageSize.Fill( 64 );
+  ImageType::Pointer fixedImage  = ImageType::New();
+  ImageType::Pointer movingImage = ImageType::New();
+  fixedImage->SetRegions( imageSize );
+  fixedImage->Allocate();
+  movingImage->SetRegions( imageSize );
+  movingImage->Allocate();
+  IteratorType fit( fixedImage, fixedImage->GetLargestPossibleRegion() );
+  IteratorType mit( movingImage, movingImage->GetLargestPossibleRegion() );
+  for( fit.GoToBegin(), mit.GoToBegin(); !fit.IsAtEnd(); ++fit, ++mit )
+  {
+    const ImageType::IndexType index = fit.GetIndex();
+    const double               x     = index[ 0 ] - 32.0;
+    const double               y     = index[ 1 ] - 32.0;
+    fit.Set( static_cast< PixelType >( 100.0 * std::exp( -( x * x + y * y ) / 200.0 ) ) );
+    mit.Set( static_cast< PixelType >( 100.0 * std::exp( -( ( x - 2.0 ) * ( x - 2.0 ) + ( y + 1.0 ) * ( y + 1.0 ) ) / 200.0 ) ) );
+  }
+
+  /** Create a B-spline transform, without deformation. */
+  BSplineTransformType::Pointer       transform = BSplineTransformType::New();
+  BSplineTransformType::SizeType      gridSize;
+  BSplineTransformType::SpacingType   gridSpacing;
+  BSplineTransformType::OriginType    gridOrigin;
+  BSplineTransformType::DirectionType gridDirection;
+  gridSize.Fill( 9 );
+  gridSpacing.Fill( 10.0 );
+  gridOrigin.Fill( -9.0 );
+  gridDirection.SetIdentity();
+  BSplineTransformType::RegionType gridRegion;
+  gridRegion.SetSize( gridSize );
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridDirection( gridDirection );
+  const unsigned int numberOfParameters = transform->GetNumberOfParameters();
+  ParametersType     zero( numberOfParameters );
+  zero.Fill( 0.0 );
+  transform->SetParameters( zero );
+
+  /** Create the metric. */
+  SamplerType::Pointer      sampler      = SamplerType::New();
+  InterpolatorType::Pointer interpolator = InterpolatorType::New();
+  MetricType::Pointer       metric       = MetricType::New();
+  metric->SetFixedImage( fixedImage );
+  metric->SetMovingImage( movingImage );
+  metric->SetFixedImageRegion( fixedImage->GetLargestPossibleRegion() );
+  metric->SetTransform( transform );
+  metric->SetInterpolator( interpolator );
+  metric->SetImageSampler( sampler );
+  metric->SetNumberOfSamplesForSelfHessian( 4096 );
+  metric->SetNumberOfThreads( 2 );
+
+  const double   regularization = 0.01;
+  CSRHessianType H;
+  try
+  {
+    /** Which transforms are recognized as B-spline transforms. */
+    TranslationTransformType::Pointer translation = TranslationTransformType::New();
+    metric->SetTransform( translation );
+    metric->Initialize();
+    if( metric->GetTransformIsBSpline() )
+    {
+      std::cerr << "ERROR: a translation transform is reported as a B-spline transform." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    CombinationTransformType::Pointer combination = CombinationTransformType::New();
+    combination->SetCurrentTransform( transform );
+    metric->SetTransform( combination );
+    metric->Initialize();
+    if( !metric->GetTransformIsBSpline() )
+    {
+      std::cerr << "ERROR: a B-spline as current transform of a combination transform "
+                << "is not reported as a B-spline transform." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    metric->SetTransform( transform );
+    metric->Initialize();
+    if( !metric->GetTransformIsBSpline() )
+    {
+      std::cerr << "ERROR: a B-spline transform is not reported as a B-spline transform." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    /** The SelfHessian at the initial position. */
+    metric->GetCompressedSelfHessian( zero, H );
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** The regularization, as in BuildPreconditioner(). */
+  CSRHessianType::VnlVectorType diagonal;
+  H.GetDiagonal( diagonal );
+  const double lambda = regularization * diagonal.mean();
+
+  /** Test both preconditioners: Diagonal and BlockJacobi. */
+  OptimizerType::Pointer optimizer = OptimizerType::New();
+  const double           initialValue = metric->GetValue( zero );
+  const unsigned int     blockSizes[ 2 ] = { 1, Dimension };
+  for( unsigned int i = 0; i < 2; ++i )
+  {
+    const unsigned int blockSize = blockSizes[ i ];
+    const char *       name      = ( blockSize == 1 ) ? "Diagonal" : "BlockJacobi";
+
+    /** Check that the blocks are the inverses of those of H + lambda I. */
+    optimizer->BuildPreconditioner( H, blockSize, regularization );
+    const PreconditionerValuesType & values         = optimizer->GetPreconditionerValues();
+    const unsigned int               numberOfBlocks = numberOfParameters / blockSize;
+    double                           maxError       = 0.0;
+    for( unsigned int b = 0; b < numberOfBlocks; ++b )
+    {
+      const double * P = &values[ b * blockSize * blockSize ];
+      for( unsigned int k = 0; k < blockSize; ++k )
+      {
+        for( unsigned int l = 0; l < blockSize; ++l )
+        {
+          /** Entry (k,l) of P times the block of H + lambda I. */
+          double product = 0.0;
+          for( unsigned int m = 0; m < blockSize; ++m )
+          {
+            const unsigned int row   = b + std::min( m, l ) * numberOfBlocks;
+            const unsigned int col   = b + std::max( m, l ) * numberOfBlocks;
+            const double       entry = H.GetEntry( row, col ) + ( m == l ? lambda : 0.0 );
+            product += P[ k * blockSize + m ] * entry;
+          }
+          maxError = std::max( maxError, std::abs( product - ( k == l ? 1.0 : 0.0 ) ) );
+        }
+      }
+    }
+    if( maxError > 1e-8 )
+    {
+      std::cerr << "ERROR: the " << name << " preconditioner is not the inverse of the "
+                << "blocks of the SelfHessian (error " << maxError << ")." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    /** Optimize, and check that the metric value decreases. */
+    double finalValue = 0.0;
+    try
+    {
+      optimizer->SetCostFunction( metric );
+      optimizer->SetInitialPosition( zero );
+      optimizer->SetNumberOfIterations( 50 );
+      optimizer->SetParam_a( 2.0 );
+      optimizer->SetParam_A( 20.0 );
+      optimizer->SetParam_alpha( 1.0 );
+      optimizer->SetUseAdaptiveStepSizes( false );
+      optimizer->StartOptimization();
+      finalValue = metric->GetValue( optimizer->GetCurrentPosition() );
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      std::cerr << excp << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    std::cout << name << ": max error of the inverse " << maxError
+              << ", metric value " << initialValue << " -> " << finalValue << std::endl;
+    if( !( finalValue < 0.5 * initialValue ) )
+    {
+      std::cerr << "ERROR: the " << name << " preconditioned optimizer did not "
+                << "decrease the metric value." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,202 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkRecursiveBSplineTransform.h"
+#include "itkImage.h"
+
+// Report timings
+#include "itkTimeProbe.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+// This test measures the speed of the weight tables of the RecursiveBSplineTransform.
+// TransformPoint, GetJacobian, EvaluateJacobianWithImageGradientProduct and
+// GetSpatialHessian are timed at the voxel positions of an image whose spacing
+// divides the grid spacing, once with the direct evaluation of the cubic B-spline
+// kernels and once with the weights looked up in the tables. The speedup is reported
+// per function; the tables are off by default in the metrics, see the parameter
+// UseBSplineWeightTables.
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int Dimension = 3;
+  typedef itk::RecursiveBSplineTransform< double, Dimension, 3 > TransformType;
+  typedef TransformType::ParametersType                          ParametersType;
+  typedef TransformType::JacobianType                            JacobianType;
+  typedef TransformType::SpatialHessianType                      SpatialHessianType;
+  typedef TransformType::NonZeroJacobianIndicesType              NonZeroJacobianIndicesType;
+  typedef TransformType::DerivativeType                          DerivativeType;
+  typedef TransformType::MovingImageGradientType                 MovingImageGradientType;
+  typedef TransformType::InputPointType                          PointType;
+  typedef itk::Image< float, Dimension >                         ImageType;
+
+  /** The number of repetitions. Distinguish between Debug and Release mode. */
+#ifndef NDEBUG
+  const unsigned int repetitions = 1;
+#else
+  const unsigned int repetitions = 10;
+#endif
+
+  /** Create a B-spline transform with a grid spacing of 4 voxels. */
+  TransformType::SizeType      gridSize;
+  TransformType::SpacingType   gridSpacing;
+  TransformType::OriginType    gridOrigin;
+  TransformType::DirectionType gridDirection;
+  gridSize.Fill( 19 );
+  gridSpacing.Fill( 4.0 );
+  gridOrigin.Fill( -6.0 );
+  gridDirection.SetIdentity();
+  TransformType::RegionType gridRegion;
+  gridRegion.SetSize( gridSize );
+
+  TransformType::Pointer transform = TransformType::New();
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridDirection( gridDirection );
+  ParametersType parameters( transform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = 1.3 * std::sin( 0.41 * i );
+  }
+  transform->SetParametersByValue( parameters );
+
+  /** The voxel positions of a 60^3 image with unit spacing. */
+  ImageType::SizeType size;
+  size.Fill( 60 );
+  ImageType::SpacingType spacing;
+  spacing.Fill( 1.0 );
+  ImageType::PointType origin;
+  origin.Fill( 0.0 );
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( size );
+  image->SetSpacing( spacing );
+  image->SetOrigin( origin );
+
+  std::vector< PointType > points;
+  points.reserve( image->GetLargestPossibleRegion().GetNumberOfPixels() );
+  ImageType::IndexType index;
+  for( index[ 2 ] = 0; index[ 2 ] < static_cast< long >( size[ 2 ] ); ++index[ 2 ] )
+  {
+    for( index[ 1 ] = 0; index[ 1 ] < static_cast< long >( size[ 1 ] ); ++index[ 1 ] )
+    {
+      for( index[ 0 ] = 0; index[ 0 ] < static_cast< long >( size[ 0 ] ); ++index[ 0 ] )
+      {
+        PointType point;
+        image->TransformIndexToPhysicalPoint( index, point );
+        points.push_back( point );
+      }
+    }
+  }
+  std::cerr << "Number of points: " << points.size()
+            << ", repetitions: " << repetitions << std::endl;
+
+  /** Time the functions without (t = 0) and with (t = 1) the weight tables. */
+  JacobianType               jacobian;
+  SpatialHessianType         spatialHessian;
+  NonZeroJacobianIndicesType nzji;
+  MovingImageGradientType    movingImageGradient;
+  movingImageGradient.Fill( 0.5 );
+  DerivativeType imageJacobian( transform->GetNumberOfNonZeroJacobianIndices() );
+
+  double times[ 4 ][ 2 ];
+  double checksums[ 4 ][ 2 ];
+  for( unsigned int t = 0; t < 2; ++t )
+  {
+    if( t == 1 && !transform->ComputeWeightTables(
+      origin, spacing, image->GetDirection() ) )
+    {
+      std::cerr << "ERROR: weight tables are not computed for an aligned spacing." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    itk::TimeProbe timers[ 4 ];
+    for( unsigned int f = 0; f < 4; ++f )
+    {
+      checksums[ f ][ t ] = 0.0;
+    }
+    for( unsigned int r = 0; r < repetitions; ++r )
+    {
+      timers[ 0 ].Start();
+      for( std::size_t p = 0; p < points.size(); ++p )
+      {
+        checksums[ 0 ][ t ] += transform->TransformPoint( points[ p ] )[ 0 ];
+      }
+      timers[ 0 ].Stop();
+
+      timers[ 1 ].Start();
+      for( std::size_t p = 0; p < points.size(); ++p )
+      {
+        transform->GetJacobian( points[ p ], jacobian, nzji );
+        checksums[ 1 ][ t ] += jacobian( 0, 0 );
+      }
+      timers[ 1 ].Stop();
+
+      timers[ 2 ].Start();
+      for( std::size_t p = 0; p < points.size(); ++p )
+      {
+        transform->EvaluateJacobianWithImageGradientProduct(
+          points[ p ], movingImageGradient, imageJacobian, nzji );
+        checksums[ 2 ][ t ] += imageJacobian[ 0 ];
+      }
+      timers[ 2 ].Stop();
+
+      timers[ 3 ].Start();
+      for( std::size_t p = 0; p < points.size(); ++p )
+      {
+        transform->GetSpatialHessian( points[ p ], spatialHessian );
+        checksums[ 3 ][ t ] += spatialHessian[ 0 ]( 0, 0 );
+      }
+      timers[ 3 ].Stop();
+    }
+    for( unsigned int f = 0; f < 4; ++f )
+    {
+      times[ f ][ t ] = timers[ f ].GetTotal();
+    }
+  }
+
+  /** Report the timings. */
+  const char * names[ 4 ] = {
+    "TransformPoint", "GetJacobian",
+    "EvaluateJacobianWithImageGradientProduct", "GetSpatialHessian"
+  };
+  std::cout << std::setprecision( 4 );
+  for( unsigned int f = 0; f < 4; ++f )
+  {
+    std::cout << names[ f ] << ": without tables " << times[ f ][ 0 ]
+              << " s, with tables " << times[ f ][ 1 ] << " s, speedup "
+              << times[ f ][ 0 ] / times[ f ][ 1 ] << std::endl;
+
+    /** The tables should not change the result. */
+    if( std::abs( checksums[ f ][ 0 ] - checksums[ f ][ 1 ] )
+      > 1e-9 * ( 1.0 + std::abs( checksums[ f ][ 0 ] ) ) )
+    {
+      std::cerr << "ERROR: the weight tables change the result of " << names[ f ] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,202 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkRecursiveBSplineTransform.h"
+#include "itkImage.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+// This test tests the weight tables of the RecursiveBSplineTransform. The transform
+// with tables is compared with a transform without tables, at the voxel positions of
+// an image whose spacing divides the grid spacing, and at positions between the
+// voxels, which are not in the tables. TransformPoint, GetJacobian and
+// GetSpatialHessian are compared, which use the weights, the derivative weights and
+// the second order derivative weights. Also the tables should not be computed for
+// a spacing that does not divide the grid spacing, the tables of one lattice should
+// be kept when another lattice is released, and the tables should follow a change
+// of the grid. The speed is measured by the RecursiveBSplineWeightTablesPerformance
+// test.
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int Dimension = 3;
+  typedef itk::RecursiveBSplineTransform< double, Dimension, 3 > TransformType;
+  typedef TransformType::ParametersType                          ParametersType;
+  typedef TransformType::JacobianType                            JacobianType;
+  typedef TransformType::SpatialHessianType                      SpatialHessianType;
+  typedef TransformType::NonZeroJacobianIndicesType              NonZeroJacobianIndicesType;
+  typedef TransformType::InputPointType                          PointType;
+  typedef itk::Image< float, Dimension >                         ImageType;
+
+  /** Create two identical B-spline transforms. */
+  TransformType::SizeType      gridSize;
+  TransformType::SpacingType   gridSpacing;
+  TransformType::OriginType    gridOrigin;
+  TransformType::DirectionType gridDirection;
+  gridSize[ 0 ] = 10; gridSize[ 1 ] = 12; gridSize[ 2 ] = 9;
+  gridSpacing[ 0 ] = 8.0; gridSpacing[ 1 ] = 4.0; gridSpacing[ 2 ] = 16.0;
+  gridOrigin[ 0 ] = -13.25; gridOrigin[ 1 ] = -11.0; gridOrigin[ 2 ] = -17.5;
+  gridDirection.SetIdentity();
+  TransformType::RegionType gridRegion;
+  gridRegion.SetSize( gridSize );
+
+  TransformType::Pointer transforms[ 2 ];
+  ParametersType         parameters;
+  for( unsigned int t = 0; t < 2; ++t )
+  {
+    transforms[ t ] = TransformType::New();
+    transforms[ t ]->SetGridRegion( gridRegion );
+    transforms[ t ]->SetGridSpacing( gridSpacing );
+    transforms[ t ]->SetGridOrigin( gridOrigin );
+    transforms[ t ]->SetGridDirection( gridDirection );
+    parameters.SetSize( transforms[ t ]->GetNumberOfParameters() );
+    for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+    {
+      parameters[ i ] = 1.3 * std::sin( 0.41 * i );
+    }
+    transforms[ t ]->SetParametersByValue( parameters );
+  }
+
+  /** An image with a spacing that divides the grid spacing 4, 4 and 8 times.
+   * The coordinates are chosen exactly representable, so that the continuous
+   * grid indices at the voxel positions have no rounding errors.
+   */
+  ImageType::SizeType size;
+  size[ 0 ] = 40; size[ 1 ] = 50; size[ 2 ] = 60;
+  ImageType::SpacingType spacing;
+  spacing[ 0 ] = 2.0; spacing[ 1 ] = 1.0; spacing[ 2 ] = 2.0;
+  ImageType::PointType origin;
+  origin[ 0 ] = 0.75; origin[ 1 ] = -0.25; origin[ 2 ] = 1.5;
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( size );
+  image->SetSpacing( spacing );
+  image->SetOrigin( origin );
+
+  /** A wrong spacing should not give tables. */
+  ImageType::SpacingType wrongSpacing = spacing;
+  wrongSpacing[ 1 ] = 1.3;
+  if( transforms[ 1 ]->ComputeWeightTables( origin, wrongSpacing, image->GetDirection() ) )
+  {
+    std::cerr << "ERROR: weight tables are computed for a misaligned spacing." << std::endl;
+    return EXIT_FAILURE;
+  }
+  transforms[ 1 ]->ReleaseWeightTables( origin, wrongSpacing, image->GetDirection() );
+
+  /** Request the tables of the image lattice twice, as two metrics would,
+   * and those of a second lattice. Releasing the second lattice and one of
+   * the requests of the first should keep the tables of the first lattice.
+   */
+  ImageType::PointType otherOrigin = origin;
+  otherOrigin[ 0 ] += 0.5 * spacing[ 0 ];
+  for( unsigned int r = 0; r < 2; ++r )
+  {
+    if( !transforms[ 1 ]->ComputeWeightTables( origin, spacing, image->GetDirection() ) )
+    {
+      std::cerr << "ERROR: weight tables are not computed for an aligned spacing." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  transforms[ 1 ]->ComputeWeightTables( otherOrigin, spacing, image->GetDirection() );
+  if( transforms[ 1 ]->GetNumberOfWeightTables() != 2 )
+  {
+    std::cerr << "ERROR: expected the weight tables of two lattices." << std::endl;
+    return EXIT_FAILURE;
+  }
+  transforms[ 1 ]->ReleaseWeightTables( otherOrigin, spacing, image->GetDirection() );
+  transforms[ 1 ]->ReleaseWeightTables( origin, spacing, image->GetDirection() );
+  if( transforms[ 1 ]->GetNumberOfWeightTables() != 1 )
+  {
+    std::cerr << "ERROR: releasing a lattice removed the tables of another request." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** A grid that is not aligned has no tables; setting the grid back restores them. */
+  TransformType::SpacingType wrongGridSpacing = gridSpacing;
+  wrongGridSpacing[ 2 ] = 15.0;
+  transforms[ 1 ]->SetGridSpacing( wrongGridSpacing );
+  if( transforms[ 1 ]->GetNumberOfWeightTables() != 0 )
+  {
+    std::cerr << "ERROR: weight tables are kept for a misaligned grid." << std::endl;
+    return EXIT_FAILURE;
+  }
+  transforms[ 1 ]->SetGridSpacing( gridSpacing );
+  if( transforms[ 1 ]->GetNumberOfWeightTables() != 1 )
+  {
+    std::cerr << "ERROR: weight tables are not recomputed for the new grid." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Compare the transforms at the voxel positions and halfway between them. */
+  const double tolerance = 1e-12;
+  double       maxError  = 0.0;
+  for( unsigned int offset = 0; offset < 2; ++offset )
+  {
+    ImageType::IndexType index;
+    for( index[ 2 ] = 0; index[ 2 ] < static_cast< long >( size[ 2 ] ); ++index[ 2 ] )
+    {
+      for( index[ 1 ] = 0; index[ 1 ] < static_cast< long >( size[ 1 ] ); ++index[ 1 ] )
+      {
+        for( index[ 0 ] = 0; index[ 0 ] < static_cast< long >( size[ 0 ] ); ++index[ 0 ] )
+        {
+          PointType point;
+          image->TransformIndexToPhysicalPoint( index, point );
+          point[ 0 ] += 0.5 * offset * spacing[ 0 ];
+
+          const PointType p0 = transforms[ 0 ]->TransformPoint( point );
+          const PointType p1 = transforms[ 1 ]->TransformPoint( point );
+
+          JacobianType               j0, j1;
+          NonZeroJacobianIndicesType nzji0, nzji1;
+          transforms[ 0 ]->GetJacobian( point, j0, nzji0 );
+          transforms[ 1 ]->GetJacobian( point, j1, nzji1 );
+
+          SpatialHessianType sh0, sh1;
+          transforms[ 0 ]->GetSpatialHessian( point, sh0 );
+          transforms[ 1 ]->GetSpatialHessian( point, sh1 );
+
+          if( nzji0 != nzji1 )
+          {
+            std::cerr << "ERROR: the nonzero Jacobian indices differ at " << point << std::endl;
+            return EXIT_FAILURE;
+          }
+          for( unsigned int i = 0; i < Dimension; ++i )
+          {
+            maxError = std::max( maxError, std::abs( p0[ i ] - p1[ i ] ) );
+            maxError = std::max( maxError, ( sh0[ i ] - sh1[ i ] ).GetVnlMatrix().absolute_value_max() );
+          }
+          maxError = std::max( maxError, ( j0 - j1 ).absolute_value_max() );
+        }
+      }
+    }
+  }
+
+  std::cout << "Max difference with and without weight tables: " << maxError << std::endl;
+  if( maxError > tolerance )
+  {
+    std::cerr << "ERROR: the weight tables change the result." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
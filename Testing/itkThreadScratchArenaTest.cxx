@@ -0,0 +1,364 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkThreadScratchArena.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "AdvancedMattesMutualInformation/itkParzenWindowMutualInformationImageToImageMetric.h"
+#include "itkAdvancedLinearInterpolateImageFunction.h"
+#include "itkImageFullSampler.h"
+#include "itkImageRegionIterator.h"
+#include "itkAtomicInt.h"
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cmath>
+#include <new>
+
+//-------------------------------------------------------------------------------------
+// This test tests the ThreadScratchArena, which holds the temporaries of the
+// sample loops of the metrics. The global operator new is replaced to count
+// the heap allocations. The temporaries of a B-spline transform Jacobian
+// computation are taken from the scratch space, sized from the number of
+// nonzero Jacobian indices, and it is checked that after a first iteration
+// no heap allocations are made anymore.
+// Then the allocations of repeated multi-threaded GetValueAndDerivative() calls
+// of the AdvancedMeanSquares and the ParzenWindowMutualInformation metric are
+// counted. After the first call, which sizes the buffers, a call should not
+// make any heap allocation, for a small and a large image.
+// The counter is atomic, because the metrics allocate from several threads.
+
+static itk::AtomicInt< long > numberOfAllocations;
+
+void *
+operator new( std::size_t size ) throw ( std::bad_alloc )
+{
+  ++numberOfAllocations;
+  void * p = std::malloc( size > 0 ? size : 1 );
+  if( p == 0 )
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+
+void *
+operator new[]( std::size_t size ) throw ( std::bad_alloc )
+{
+  return operator new( size );
+}
+
+
+void
+operator delete( void * p ) throw ( )
+{
+  std::free( p );
+}
+
+
+void
+operator delete[]( void * p ) throw ( )
+{
+  std::free( p );
+}
+
+
+typedef itk::Image< float, 2 >                     MetricImageType;
+typedef itk::AdvancedImageToImageMetric<
+  MetricImageType, MetricImageType >               MetricType;
+
+//-------------------------------------------------------------------------------------
+// Counts the heap allocations of repeated GetValueAndDerivative() calls of the
+// metric, for a small and a large image, and returns whether all calls after the
+// first one are free of heap allocations.
+bool
+CheckMetricAllocations( MetricType * metric, const std::string & name )
+{
+  typedef MetricImageType::PixelType                  PixelType;
+  typedef itk::ImageRegionIterator< MetricImageType > IteratorType;
+  typedef itk::AdvancedBSplineDeformableTransform<
+    double, 2, 3 >                                    TransformType;
+  typedef TransformType::ParametersType               ParametersType;
+  typedef itk::AdvancedLinearInterpolateImageFunction<
+    MetricImageType, double >                         InterpolatorType;
+  typedef itk::ImageFullSampler< MetricImageType >    SamplerType;
+
+  const unsigned int numberOfSizes = 2;
+  const unsigned int imageSizes[ numberOfSizes ] = { 32, 96 };
+  const unsigned int numberOfCalls = 5;
+  for( unsigned int k = 0; k < numberOfSizes; ++k )
+  {
+    /** Create a fixed and a moving image with a shifted blob. */
+    const double              center = 0.5 * imageSizes[ k ];
+    MetricImageType::SizeType imageSize;
+    imageSize.Fill( imageSizes[ k ] );
+    MetricImageType::Pointer fixedImage  = MetricImageType::New();
+    MetricImageType::Pointer movingImage = MetricImageType::New();
+    fixedImage->SetRegions( imageSize );
+    fixedImage->Allocate();
+    movingImage->SetRegions( imageSize );
+    movingImage->Allocate();
+    IteratorType fit( fixedImage, fixedImage->GetLargestPossibleRegion() );
+    IteratorType mit( movingImage, movingImage->GetLargestPossibleRegion() );
+    for( fit.GoToBegin(), mit.GoToBegin(); !fit.IsAtEnd(); ++fit, ++mit )
+    {
+      const double x = ( fit.GetIndex()[ 0 ] - center ) / center;
+      const double y = ( fit.GetIndex()[ 1 ] - center ) / center;
+      fit.Set( static_cast< PixelType >( 100.0 * std::exp( -( x * x + y * y ) / 0.2 ) ) );
+      mit.Set( static_cast< PixelType >( 100.0 * std::exp( -( ( x - 0.1 ) * ( x - 0.1 ) + y * y ) / 0.25 ) ) );
+    }
+
+    /** Create a B-spline transform with the same grid relative to the image. */
+    TransformType::Pointer       transform = TransformType::New();
+    TransformType::SizeType      gridSize;
+    TransformType::SpacingType   gridSpacing;
+    TransformType::OriginType    gridOrigin;
+    TransformType::DirectionType gridDirection;
+    gridSize.Fill( 10 );
+    gridSpacing.Fill( imageSizes[ k ] / 6.0 );
+    gridOrigin.Fill( -1.5 * gridSpacing[ 0 ] );
+    gridDirection.SetIdentity();
+    TransformType::RegionType gridRegion;
+    gridRegion.SetSize( gridSize );
+    transform->SetGridRegion( gridRegion );
+    transform->SetGridSpacing( gridSpacing );
+    transform->SetGridOrigin( gridOrigin );
+    transform->SetGridDirection( gridDirection );
+    ParametersType parameters( transform->GetNumberOfParameters() );
+    for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+    {
+      parameters[ i ] = 0.3 * std::sin( 0.37 * i );
+    }
+    transform->SetParameters( parameters );
+
+    metric->SetFixedImage( fixedImage );
+    metric->SetMovingImage( movingImage );
+    metric->SetFixedImageRegion( fixedImage->GetLargestPossibleRegion() );
+    metric->SetTransform( transform );
+    metric->SetInterpolator( InterpolatorType::New() );
+    metric->SetImageSampler( SamplerType::New() );
+    metric->SetNumberOfThreads( 2 );
+    metric->Initialize();
+
+    /** Call GetValueAndDerivative() repeatedly. The first call is not counted. */
+    MetricType::MeasureType    value = 0.0;
+    MetricType::DerivativeType derivative( transform->GetNumberOfParameters() );
+    for( unsigned int call = 0; call < numberOfCalls; ++call )
+    {
+      const long allocationsBefore = numberOfAllocations.Get();
+      metric->GetValueAndDerivative( parameters, value, derivative );
+      const long allocationsAfter = numberOfAllocations.Get();
+      if( call > 0 && allocationsAfter != allocationsBefore )
+      {
+        std::cerr << "ERROR: " << name << ": " << allocationsAfter - allocationsBefore
+                  << " heap allocations in call " << call << " with image size "
+                  << imageSizes[ k ] << "." << std::endl;
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int Dimension   = 3;
+  const unsigned int SplineOrder = 3;
+  typedef double ScalarType;
+
+  typedef itk::ThreadScratchArena< ScalarType > ArenaType;
+  typedef ArenaType::ArrayType                  ArrayType;
+
+  /** Test the arena itself. */
+  ArenaType arena;
+  arena.Reserve( 10 );
+  ArrayType a, b, c;
+  arena.Allocate( a, 4 );
+  arena.Allocate( b, 6 );
+  if( a.GetSize() != 4 || b.GetSize() != 6 || b.data_block() != a.data_block() + 4
+    || arena.GetNumberOfAllocatedValues() != 10 || arena.GetNumberOfOverflows() != 0 )
+  {
+    std::cerr << "ERROR: Allocate() did not take the arrays from the arena." << std::endl;
+    return EXIT_FAILURE;
+  }
+  arena.Allocate( c, 1 );
+  if( c.GetSize() != 1 || arena.GetNumberOfOverflows() != 1 )
+  {
+    std::cerr << "ERROR: an allocation that does not fit is not handled correctly." << std::endl;
+    return EXIT_FAILURE;
+  }
+  arena.Release();
+  arena.Reserve( 5 );
+  if( arena.GetCapacity() != 10 || arena.GetNumberOfAllocatedValues() != 0 )
+  {
+    std::cerr << "ERROR: Reserve() should not shrink the arena." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Create a B-spline transform. */
+  typedef itk::AdvancedBSplineDeformableTransform<
+    ScalarType, Dimension, SplineOrder >            TransformType;
+  typedef TransformType::NumberOfParametersType     NumberOfParametersType;
+  typedef TransformType::InputPointType             InputPointType;
+  typedef TransformType::ParametersType             ParametersType;
+  typedef TransformType::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
+  typedef TransformType::JacobianType               JacobianType;
+  typedef TransformType::MovingImageGradientType    MovingImageGradientType;
+  typedef TransformType::RegionType                 RegionType;
+  typedef TransformType::SizeType                   SizeType;
+  typedef TransformType::IndexType                  IndexType;
+  typedef TransformType::SpacingType                SpacingType;
+  typedef TransformType::OriginType                 OriginType;
+  typedef TransformType::DirectionType              DirectionType;
+
+  TransformType::Pointer transform = TransformType::New();
+  SizeType               gridSize;
+  gridSize.Fill( 10 );
+  IndexType gridIndex;
+  gridIndex.Fill( 0 );
+  RegionType gridRegion;
+  gridRegion.SetSize( gridSize );
+  gridRegion.SetIndex( gridIndex );
+  SpacingType gridSpacing;
+  gridSpacing.Fill( 8.0 );
+  OriginType gridOrigin;
+  gridOrigin.Fill( -10.0 );
+  DirectionType gridDirection;
+  gridDirection.SetIdentity();
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridDirection( gridDirection );
+
+  ParametersType parameters( transform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = std::sin( 0.1 * i );
+  }
+  transform->SetParameters( parameters );
+
+  /** The scratch space of one thread, sized from the transform. */
+  const NumberOfParametersType nnzji = transform->GetNumberOfNonZeroJacobianIndices();
+  NonZeroJacobianIndicesType   nzji( nnzji );
+  JacobianType                 jacobian( Dimension, nnzji );
+  ArenaType                    scratchArena;
+  scratchArena.Reserve( 2 * nnzji );
+
+  MovingImageGradientType movingImageGradient;
+  movingImageGradient[ 0 ] = 1.0;
+  movingImageGradient[ 1 ] = -2.0;
+  movingImageGradient[ 2 ] = 0.5;
+
+  /** Some iterations of a sample loop. The first one is not counted. */
+  const unsigned int numberOfIterations = 4;
+  const unsigned int numberOfSamples    = 200;
+  long               allocationsAfterFirstIteration = 0;
+  double             maxError                       = 0.0;
+  for( unsigned int iter = 0; iter < numberOfIterations; ++iter )
+  {
+    const long allocationsBefore = numberOfAllocations.Get();
+
+    scratchArena.Release();
+    ArrayType imageJacobian, reference;
+    scratchArena.Allocate( imageJacobian, nnzji );
+    scratchArena.Allocate( reference, nnzji );
+
+    for( unsigned int s = 0; s < numberOfSamples; ++s )
+    {
+      InputPointType point;
+      for( unsigned int d = 0; d < Dimension; ++d )
+      {
+        point[ d ] = 10.0 + 0.23 * s + 2.0 * d + 0.01 * iter;
+      }
+
+      transform->EvaluateJacobianWithImageGradientProduct(
+        point, movingImageGradient, imageJacobian, nzji );
+
+      /** Compare with the explicit inner product. */
+      transform->GetJacobian( point, jacobian, nzji );
+      for( unsigned int mu = 0; mu < nnzji; ++mu )
+      {
+        reference[ mu ] = 0.0;
+        for( unsigned int d = 0; d < Dimension; ++d )
+        {
+          reference[ mu ] += jacobian( d, mu ) * movingImageGradient[ d ];
+        }
+        const double error = std::abs( reference[ mu ] - imageJacobian[ mu ] );
+        maxError = error > maxError ? error : maxError;
+      }
+    }
+
+    if( iter > 0 )
+    {
+      allocationsAfterFirstIteration += numberOfAllocations.Get() - allocationsBefore;
+    }
+  }
+
+  if( maxError > 1e-10 )
+  {
+    std::cerr << "ERROR: the image Jacobian differs " << maxError
+              << " from the explicit inner product." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( scratchArena.GetNumberOfOverflows() != 0 )
+  {
+    std::cerr << "ERROR: the scratch space was too small." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( allocationsAfterFirstIteration != 0 )
+  {
+    std::cerr << "ERROR: " << allocationsAfterFirstIteration
+              << " heap allocations were made after the first iteration." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Count the heap allocations of the metrics. */
+  typedef itk::AdvancedMeanSquaresImageToImageMetric<
+    MetricImageType, MetricImageType >              MeanSquaresMetricType;
+  typedef itk::ParzenWindowMutualInformationImageToImageMetric<
+    MetricImageType, MetricImageType >              MutualInformationMetricType;
+
+  MeanSquaresMetricType::Pointer       meanSquares       = MeanSquaresMetricType::New();
+  MutualInformationMetricType::Pointer mutualInformation = MutualInformationMetricType::New();
+  mutualInformation->SetNumberOfFixedHistogramBins( 32 );
+  mutualInformation->SetNumberOfMovingHistogramBins( 32 );
+  mutualInformation->SetUseExplicitPDFDerivatives( false );
+  try
+  {
+    if( !CheckMetricAllocations( meanSquares, "AdvancedMeanSquares" )
+      || !CheckMetricAllocations( mutualInformation, "ParzenWindowMutualInformation" ) )
+    {
+      return EXIT_FAILURE;
+    }
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,230 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkTransformToDisplacementFieldFilter.h"
+#include "itkTransformToDeterminantOfSpatialJacobianSource.h"
+#include "itkTransformToSpatialJacobianSource.h"
+#include "itkStreamingImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+// This test tests that the deformation field, the spatial Jacobian determinant and
+// the full spatial Jacobian, which transformix writes in pieces when
+// NumberOfStreamDivisions is set, are equal when computed at once and when computed
+// in pieces. The pieces are requested with a StreamingImageFilter, in the same way
+// as the ImageFileWriter does.
+
+namespace
+{
+
+const unsigned int Dimension = 3;
+
+typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 > TransformType;
+typedef itk::Vector< float, Dimension >                                 VectorPixelType;
+typedef itk::Matrix< float, Dimension, Dimension >                      MatrixPixelType;
+typedef itk::Image< VectorPixelType, Dimension >                        DeformationFieldImageType;
+typedef itk::Image< float, Dimension >                                  DeterminantImageType;
+typedef itk::Image< MatrixPixelType, Dimension >                        SpatialJacobianImageType;
+
+/** The difference of two pixels. */
+double
+PixelDifference( const float & a, const float & b )
+{
+  return std::abs( static_cast< double >( a ) - static_cast< double >( b ) );
+}
+
+
+double
+PixelDifference( const VectorPixelType & a, const VectorPixelType & b )
+{
+  double difference = 0.0;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    difference = std::max( difference, PixelDifference( a[ i ], b[ i ] ) );
+  }
+  return difference;
+}
+
+
+double
+PixelDifference( const MatrixPixelType & a, const MatrixPixelType & b )
+{
+  double difference = 0.0;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      difference = std::max( difference, PixelDifference( a( i, j ), b( i, j ) ) );
+    }
+  }
+  return difference;
+}
+
+
+/** Compute the output of a source at once and in pieces, and compare them. */
+template< class TImage >
+bool
+CompareStreamedOutput( itk::ImageSource< TImage > * source, const std::string & name )
+{
+  typedef itk::StreamingImageFilter< TImage, TImage > StreamerType;
+  typedef itk::ImageRegionConstIterator< TImage >     IteratorType;
+
+  /** Compute the output at once. */
+  source->UpdateLargestPossibleRegion();
+  typename TImage::Pointer unstreamed = source->GetOutput();
+  unstreamed->DisconnectPipeline();
+
+  /** Compute the output in pieces. */
+  typename StreamerType::Pointer streamer = StreamerType::New();
+  streamer->SetInput( source->GetOutput() );
+  streamer->SetNumberOfStreamDivisions( 7 );
+  streamer->Update();
+  const TImage * streamed = streamer->GetOutput();
+
+  if( streamed->GetLargestPossibleRegion() != unstreamed->GetLargestPossibleRegion()
+    || streamed->GetBufferedRegion() != unstreamed->GetBufferedRegion() )
+  {
+    std::cerr << "ERROR: the streamed " << name << " has a different region." << std::endl;
+    return false;
+  }
+
+  double       maxDifference = 0.0;
+  IteratorType itUnstreamed( unstreamed, unstreamed->GetBufferedRegion() );
+  IteratorType itStreamed( streamed, streamed->GetBufferedRegion() );
+  for( itUnstreamed.GoToBegin(), itStreamed.GoToBegin(); !itUnstreamed.IsAtEnd(); ++itUnstreamed, ++itStreamed )
+  {
+    maxDifference = std::max( maxDifference, PixelDifference( itUnstreamed.Get(), itStreamed.Get() ) );
+  }
+
+  std::cout << name << ": max difference " << maxDifference << std::endl;
+  if( maxDifference > 1e-6 )
+  {
+    std::cerr << "ERROR: the streamed " << name << " differs from the unstreamed one." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+} // end namespace
+
+int
+main( int argc, char * argv[] )
+{
+  typedef itk::TransformToDisplacementFieldFilter<
+    DeformationFieldImageType, double >                  DeformationFieldGeneratorType;
+  typedef itk::TransformToDeterminantOfSpatialJacobianSource<
+    DeterminantImageType, double >                       DeterminantGeneratorType;
+  typedef itk::TransformToSpatialJacobianSource<
+    SpatialJacobianImageType, double >                   SpatialJacobianGeneratorType;
+
+  /** Create a B-spline transform with a smooth deformation. */
+  TransformType::RegionType::SizeType gridSize;
+  gridSize[ 0 ] = 9; gridSize[ 1 ] = 8; gridSize[ 2 ] = 7;
+  TransformType::RegionType gridRegion;
+  gridRegion.SetSize( gridSize );
+  TransformType::SpacingType gridSpacing;
+  gridSpacing[ 0 ] = 6.0; gridSpacing[ 1 ] = 6.5; gridSpacing[ 2 ] = 7.0;
+  TransformType::OriginType gridOrigin;
+  gridOrigin[ 0 ] = -10.0; gridOrigin[ 1 ] = -12.0; gridOrigin[ 2 ] = -14.0;
+  TransformType::DirectionType gridDirection;
+  gridDirection.SetIdentity();
+
+  TransformType::Pointer transform = TransformType::New();
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridDirection( gridDirection );
+  TransformType::ParametersType parameters( transform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = 1.5 * std::sin( 0.37 * i ) * std::cos( 0.11 * i );
+  }
+  transform->SetParametersByValue( parameters );
+
+  /** The output geometry, with a direction that is not the identity. */
+  DeterminantImageType::SizeType size;
+  size[ 0 ] = 33; size[ 1 ] = 29; size[ 2 ] = 25;
+  DeterminantImageType::IndexType index;
+  index[ 0 ] = 2; index[ 1 ] = 0; index[ 2 ] = 1;
+  DeterminantImageType::SpacingType spacing;
+  spacing[ 0 ] = 1.0; spacing[ 1 ] = 1.2; spacing[ 2 ] = 1.4;
+  DeterminantImageType::PointType origin;
+  origin[ 0 ] = 0.5; origin[ 1 ] = -0.5; origin[ 2 ] = 1.0;
+  DeterminantImageType::DirectionType direction;
+  direction.SetIdentity();
+  direction[ 0 ][ 0 ] = std::cos( 0.1 ); direction[ 0 ][ 1 ] = -std::sin( 0.1 );
+  direction[ 1 ][ 0 ] = std::sin( 0.1 ); direction[ 1 ][ 1 ] = std::cos( 0.1 );
+
+  try
+  {
+    /** The deformation field. */
+    DeformationFieldGeneratorType::Pointer defGenerator = DeformationFieldGeneratorType::New();
+    defGenerator->SetSize( size );
+    defGenerator->SetOutputStartIndex( index );
+    defGenerator->SetOutputSpacing( spacing );
+    defGenerator->SetOutputOrigin( origin );
+    defGenerator->SetOutputDirection( direction );
+    defGenerator->SetTransform( transform );
+    if( !CompareStreamedOutput< DeformationFieldImageType >( defGenerator, "deformation field" ) )
+    {
+      return EXIT_FAILURE;
+    }
+
+    /** The spatial Jacobian determinant. */
+    DeterminantGeneratorType::Pointer detGenerator = DeterminantGeneratorType::New();
+    detGenerator->SetOutputSize( size );
+    detGenerator->SetOutputIndex( index );
+    detGenerator->SetOutputSpacing( spacing );
+    detGenerator->SetOutputOrigin( origin );
+    detGenerator->SetOutputDirection( direction );
+    detGenerator->SetTransform( transform );
+    if( !CompareStreamedOutput< DeterminantImageType >( detGenerator, "spatial Jacobian determinant" ) )
+    {
+      return EXIT_FAILURE;
+    }
+
+    /** The full spatial Jacobian. */
+    SpatialJacobianGeneratorType::Pointer jacGenerator = SpatialJacobianGeneratorType::New();
+    jacGenerator->SetOutputSize( size );
+    jacGenerator->SetOutputIndex( index );
+    jacGenerator->SetOutputSpacing( spacing );
+    jacGenerator->SetOutputOrigin( origin );
+    jacGenerator->SetOutputDirection( direction );
+    jacGenerator->SetTransform( transform );
+    if( !CompareStreamedOutput< SpatialJacobianImageType >( jacGenerator, "spatial Jacobian" ) )
+    {
+      return EXIT_FAILURE;
+    }
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
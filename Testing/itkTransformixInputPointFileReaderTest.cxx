@@ -0,0 +1,268 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkTransformixInputPointFileReader.h"
+#include "itkPointSet.h"
+#include "itkDefaultStaticMeshTraits.h"
+#include "itkByteSwapper.h"
+#include "itkIntTypes.h"
+#include "itkTimeProbe.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <locale>
+#include <vector>
+#include <string>
+#include <cstdlib>
+
+//-------------------------------------------------------------------------------------
+// This test tests the TransformixInputPointFileReader. A text point file with
+// coordinates in several notations is read, and the coordinates are compared with
+// the values read by a stream with the classic locale. The same points are written
+// in the binary format, and read back. Reading in chunks with ReadNextPoints()
+// should give the same points as Update(). A file with too few points should give
+// an exception.
+
+namespace
+{
+const unsigned int Dimension = 3;
+typedef itk::DefaultStaticMeshTraits<
+  bool, Dimension, Dimension, double >                         MeshTraitsType;
+typedef itk::PointSet< bool, Dimension, MeshTraitsType >       PointSetType;
+typedef itk::TransformixInputPointFileReader< PointSetType >   ReaderType;
+typedef ReaderType::PointType                                  PointType;
+typedef ReaderType::PointVectorType                            PointVectorType;
+
+//-------------------------------------------------------------------------------------
+// Reads a point file with Update() and returns the points.
+bool
+ReadAllPoints( const std::string & fileName, PointVectorType & points )
+{
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( fileName.c_str() );
+  try
+  {
+    reader->Update();
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << e << std::endl;
+    return false;
+  }
+  points.clear();
+  for( unsigned long i = 0; i < reader->GetOutput()->GetNumberOfPoints(); ++i )
+  {
+    PointType point;
+    reader->GetOutput()->GetPoint( i, &point );
+    points.push_back( point );
+  }
+  return points.size() == reader->GetNumberOfPoints();
+}
+
+
+//-------------------------------------------------------------------------------------
+// Returns whether two lists of points are exactly equal.
+bool
+ArePointsEqual( const PointVectorType & points1, const PointVectorType & points2 )
+{
+  if( points1.size() != points2.size() )
+  {
+    return false;
+  }
+  for( std::size_t i = 0; i < points1.size(); ++i )
+  {
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      if( points1[ i ][ j ] != points2[ i ][ j ] )
+      {
+        std::cerr << "Point " << i << " differs: " << points1[ i ]
+                  << " != " << points2[ i ] << std::endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+
+} // end namespace
+
+int
+main( int argc, char * argv[] )
+{
+  if( argc != 2 )
+  {
+    std::cerr << "ERROR: You should specify the output directory." << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string outputDirectory = argv[ 1 ];
+  const std::string textFileName    = outputDirectory + "/TransformixInputPointFileReaderTest.txt";
+  const std::string binaryFileName  = outputDirectory + "/TransformixInputPointFileReaderTest.bin";
+  const std::string shortFileName   = outputDirectory + "/TransformixInputPointFileReaderTestShort.txt";
+
+  /** Coordinates in several notations, including words longer than the
+   * exactly representable range, which use the fallback.
+   */
+  const char * words[] = {
+    "1", "-2", "+3.5", ".25", "-0.0", "12.", "1e3", "-4.5E-2", "6.02214076e+23",
+    "0.1", "0.30000000000000004", "123456.789012", "-98765.4321", "3.14159265358979323846",
+    "1e-30", "2.5e22", "0.000001", "7", "-123.456e-5", "42.42", "1000000000000000000000000"
+  };
+  const unsigned int numberOfWords   = sizeof( words ) / sizeof( words[ 0 ] );
+  const unsigned int numberOfPoints  = 20000;
+
+  /** Write the text file, with mixed white space, and the expected points. */
+  PointVectorType expected( numberOfPoints );
+  {
+    std::ofstream file( textFileName.c_str(), std::ios::out | std::ios::binary );
+    file << "point\r\n" << numberOfPoints << "\r\n";
+    for( unsigned int i = 0; i < numberOfPoints; ++i )
+    {
+      for( unsigned int j = 0; j < Dimension; ++j )
+      {
+        const unsigned int w = ( i * Dimension + j ) % numberOfWords;
+        std::string        word( words[ w ] );
+        if( i % 7 == 3 )
+        {
+          std::ostringstream random;
+          random.imbue( std::locale::classic() );
+          random << std::setprecision( 17 ) << ( i * 0.731 - j * 1234.5677 );
+          word = random.str();
+        }
+        file << word << ( j + 1 < Dimension ? ( i % 3 ? " " : "\t" ) : "\r\n" );
+
+        std::istringstream stream( word );
+        stream.imbue( std::locale::classic() );
+        stream >> expected[ i ][ j ];
+      }
+    }
+  }
+
+  /** Read the text file and compare. */
+  PointVectorType textPoints;
+  itk::TimeProbe  textTimer;
+  textTimer.Start();
+  if( !ReadAllPoints( textFileName, textPoints ) )
+  {
+    std::cerr << "ERROR: the text file could not be read." << std::endl;
+    return EXIT_FAILURE;
+  }
+  textTimer.Stop();
+  std::cout << "Text file read in " << textTimer.GetMean() << " s" << std::endl;
+  if( !ArePointsEqual( textPoints, expected ) )
+  {
+    std::cerr << "ERROR: the text file is not read correctly." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Write the binary file, read it and compare. */
+  {
+    std::ofstream file( binaryFileName.c_str(), std::ios::out | std::ios::binary );
+    file.write( "elxpoint", 8 );
+    itk::uint64_t n = numberOfPoints;
+    itk::uint32_t d = Dimension;
+    itk::ByteSwapper< itk::uint64_t >::SwapFromSystemToLittleEndian( &n );
+    itk::ByteSwapper< itk::uint32_t >::SwapFromSystemToLittleEndian( &d );
+    file.write( reinterpret_cast< const char * >( &n ), sizeof( n ) );
+    file.write( reinterpret_cast< const char * >( &d ), sizeof( d ) );
+    for( unsigned int i = 0; i < numberOfPoints; ++i )
+    {
+      for( unsigned int j = 0; j < Dimension; ++j )
+      {
+        double value = expected[ i ][ j ];
+        itk::ByteSwapper< double >::SwapFromSystemToLittleEndian( &value );
+        file.write( reinterpret_cast< const char * >( &value ), sizeof( value ) );
+      }
+    }
+  }
+  PointVectorType binaryPoints;
+  itk::TimeProbe  binaryTimer;
+  binaryTimer.Start();
+  if( !ReadAllPoints( binaryFileName, binaryPoints ) )
+  {
+    std::cerr << "ERROR: the binary file could not be read." << std::endl;
+    return EXIT_FAILURE;
+  }
+  binaryTimer.Stop();
+  std::cout << "Binary file read in " << binaryTimer.GetMean() << " s" << std::endl;
+  if( !ArePointsEqual( binaryPoints, expected ) )
+  {
+    std::cerr << "ERROR: the binary file is not read correctly." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Read both files in chunks. */
+  const std::string fileNames[ 2 ] = { textFileName, binaryFileName };
+  for( unsigned int f = 0; f < 2; ++f )
+  {
+    ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName( fileNames[ f ].c_str() );
+    PointVectorType chunkedPoints;
+    try
+    {
+      reader->UpdateOutputInformation();
+      if( reader->GetPointsAreBinary() != ( f == 1 ) || reader->GetPointsAreIndices() )
+      {
+        std::cerr << "ERROR: the header of " << fileNames[ f ] << " is not read correctly." << std::endl;
+        return EXIT_FAILURE;
+      }
+      PointVectorType chunk;
+      while( reader->ReadNextPoints( chunk, 777 ) > 0 )
+      {
+        chunkedPoints.insert( chunkedPoints.end(), chunk.begin(), chunk.end() );
+      }
+    }
+    catch( itk::ExceptionObject & e )
+    {
+      std::cerr << "ERROR: " << e << std::endl;
+      return EXIT_FAILURE;
+    }
+    if( !ArePointsEqual( chunkedPoints, expected ) )
+    {
+      std::cerr << "ERROR: " << fileNames[ f ] << " is not read correctly in chunks." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** A file with less points than its header should give an exception. */
+  {
+    std::ofstream file( shortFileName.c_str() );
+    file << "index 3\n1 2 3\n4 5 6\n7 8\n";
+  }
+  ReaderType::Pointer shortReader = ReaderType::New();
+  shortReader->SetFileName( shortFileName.c_str() );
+  bool caught = false;
+  try
+  {
+    shortReader->Update();
+  }
+  catch( itk::ExceptionObject & )
+  {
+    caught = true;
+  }
+  if( !caught )
+  {
+    std::cerr << "ERROR: no exception for a file with too few points." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
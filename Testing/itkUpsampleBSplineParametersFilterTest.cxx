@@ -0,0 +1,164 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkUpsampleBSplineParametersFilter.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTimeProbe.h"
+
+#include <iomanip>
+
+//-------------------------------------------------------------------------------------
+// This test tests the two-scale relation of the itkUpsampleBSplineParametersFilter.
+// A random cubic B-spline transform is upsampled to a grid with half the spacing.
+// The upsampled transform should be exactly equal to the original one inside the
+// valid region of the new grid. This is tested for an aligned grid and a shifted
+// grid. The default sampling and decomposition method is also timed.
+
+int
+main( int argc, char * argv[] )
+{
+  /** Some basic type definitions. */
+  const unsigned int Dimension   = 3;
+  const unsigned int SplineOrder = 3;
+  typedef double CoordinateRepresentationType;
+  const double distance = 1e-8; // the allowable distance
+  const unsigned int N  = 1000; // the number of tested points
+
+  /** Other typedefs. */
+  typedef itk::AdvancedBSplineDeformableTransform<
+    CoordinateRepresentationType, Dimension, SplineOrder >    TransformType;
+  typedef TransformType::ParametersType  ParametersType;
+  typedef TransformType::ImageType       ImageType;
+  typedef TransformType::InputPointType  InputPointType;
+  typedef TransformType::OutputPointType OutputPointType;
+  typedef ImageType::RegionType          RegionType;
+  typedef ImageType::SizeType            SizeType;
+  typedef ImageType::IndexType           IndexType;
+  typedef ImageType::SpacingType         SpacingType;
+  typedef ImageType::PointType           OriginType;
+  typedef ImageType::DirectionType       DirectionType;
+  typedef itk::UpsampleBSplineParametersFilter<
+    ParametersType, ImageType >                               UpsamplerType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+
+  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
+  randomGenerator->Initialize( 1234 );
+
+  /** Setup the current grid. */
+  SizeType currentSize; currentSize.Fill( 12 );
+  IndexType gridIndex; gridIndex.Fill( 0 );
+  RegionType currentRegion( gridIndex, currentSize );
+  SpacingType currentSpacing; currentSpacing.Fill( 8.0 );
+  OriginType currentOrigin;
+  currentOrigin[ 0 ] = -10.0; currentOrigin[ 1 ] = 3.5; currentOrigin[ 2 ] = 0.0;
+  DirectionType direction; direction.SetIdentity();
+
+  TransformType::Pointer currentTransform = TransformType::New();
+  currentTransform->SetGridOrigin( currentOrigin );
+  currentTransform->SetGridSpacing( currentSpacing );
+  currentTransform->SetGridRegion( currentRegion );
+  currentTransform->SetGridDirection( direction );
+
+  ParametersType currentParameters( currentTransform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < currentParameters.GetSize(); ++i )
+  {
+    currentParameters[ i ] = randomGenerator->GetUniformVariate( -5.0, 5.0 );
+  }
+  currentTransform->SetParameters( currentParameters );
+
+  /** Test an aligned grid (shift 0) and a grid shifted by one new spacing. */
+  for( unsigned int shift = 0; shift < 2; ++shift )
+  {
+    /** Setup the required grid. */
+    SpacingType requiredSpacing; requiredSpacing.Fill( 4.0 );
+    SizeType    requiredSize;
+    OriginType  requiredOrigin;
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      requiredSize[ d ]   = 2 * ( currentSize[ d ] - 1 ) + 1 - 2 * shift;
+      requiredOrigin[ d ] = currentOrigin[ d ] + shift * requiredSpacing[ d ];
+    }
+    RegionType requiredRegion( gridIndex, requiredSize );
+
+    /** Upsample using the two-scale relation. */
+    UpsamplerType::Pointer upsampler = UpsamplerType::New();
+    upsampler->SetBSplineOrder( SplineOrder );
+    upsampler->SetCurrentGridOrigin( currentOrigin );
+    upsampler->SetCurrentGridSpacing( currentSpacing );
+    upsampler->SetCurrentGridRegion( currentRegion );
+    upsampler->SetCurrentGridDirection( direction );
+    upsampler->SetRequiredGridOrigin( requiredOrigin );
+    upsampler->SetRequiredGridSpacing( requiredSpacing );
+    upsampler->SetRequiredGridRegion( requiredRegion );
+    upsampler->SetRequiredGridDirection( direction );
+
+    ParametersType twoScaleParameters, defaultParameters;
+    itk::TimeProbe timer1, timer2;
+
+    upsampler->UseTwoScaleRelationOn();
+    timer1.Start();
+    upsampler->UpsampleParameters( currentParameters, twoScaleParameters );
+    timer1.Stop();
+
+    upsampler->UseTwoScaleRelationOff();
+    timer2.Start();
+    upsampler->UpsampleParameters( currentParameters, defaultParameters );
+    timer2.Stop();
+
+    std::cerr << "shift " << shift << ":\n"
+              << "  two-scale relation:        " << std::setprecision( 4 )
+              << timer1.GetMean() << " s\n"
+              << "  sampling and decomposition: "
+              << timer2.GetMean() << " s" << std::endl;
+
+    /** Create the upsampled transform. */
+    TransformType::Pointer requiredTransform = TransformType::New();
+    requiredTransform->SetGridOrigin( requiredOrigin );
+    requiredTransform->SetGridSpacing( requiredSpacing );
+    requiredTransform->SetGridRegion( requiredRegion );
+    requiredTransform->SetGridDirection( direction );
+    requiredTransform->SetParameters( twoScaleParameters );
+
+    /** Compare at random points well inside both valid regions. */
+    double maxDifference = 0.0;
+    for( unsigned int i = 0; i < N; ++i )
+    {
+      InputPointType point;
+      for( unsigned int d = 0; d < Dimension; ++d )
+      {
+        point[ d ] = currentOrigin[ d ] + currentSpacing[ d ]
+          * randomGenerator->GetUniformVariate( 2.0, currentSize[ d ] - 4.0 );
+      }
+      const OutputPointType p1 = currentTransform->TransformPoint( point );
+      const OutputPointType p2 = requiredTransform->TransformPoint( point );
+      maxDifference = vnl_math_max( maxDifference, p1.EuclideanDistanceTo( p2 ) );
+    }
+
+    std::cerr << "  maximum difference: " << maxDifference << std::endl;
+    if( maxDifference > distance )
+    {
+      std::cerr << "ERROR: the upsampled transform is not equal to the original one."
+                << std::endl;
+      return 1;
+    }
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
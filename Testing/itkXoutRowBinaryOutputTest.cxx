@@ -0,0 +1,109 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "xoutrow.h"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
+
+//-------------------------------------------------------------------------------------
+// This test tests the binary outputs of the xoutrow, which are used for the binary
+// IterationInfo files. A table is written to a normal and to a binary output, the
+// latter is converted back to text, and the results should be equal.
+
+int
+main( int argc, char * argv[] )
+{
+  typedef xoutlibrary::xoutrow< char > XoutRowType;
+
+  std::ostringstream textOutput;
+  std::ostringstream binaryOutput;
+
+  /** Setup the row, like elastix does for the iteration info. */
+  XoutRowType row;
+  row.AddTargetCell( "1:ItNr" );
+  row.AddTargetCell( "2:Metric" );
+  row.AddTargetCell( "3a:Time" );
+  row.AddTargetCell( "4:Info" );
+  row.AddOutput( "text", &textOutput );
+  row.AddBinaryOutput( "binary", &binaryOutput );
+  row[ "2:Metric" ] << std::showpoint << std::fixed << std::setprecision( 8 );
+  row[ "3a:Time" ] << std::scientific << std::setprecision( 3 );
+
+  /** Write two resolutions. */
+  for( unsigned int level = 0; level < 2; ++level )
+  {
+    row[ "WriteHeaders" ];
+    for( unsigned int i = 0; i < 100; ++i )
+    {
+      row[ "1:ItNr" ] << i;
+      row[ "2:Metric" ] << -1.0 / ( i + 1.0 );
+      row[ "3a:Time" ] << static_cast< float >( 0.001 * i );
+      if( i % 10 == 0 )
+      {
+        row[ "4:Info" ] << "converged " << i;
+      }
+      else
+      {
+        row[ "4:Info" ] << "-";
+      }
+      row.WriteBufferedData();
+    }
+  }
+
+  /** Convert the binary output back to text. */
+  std::istringstream binaryInput( binaryOutput.str() );
+  std::ostringstream convertedOutput;
+  if( XoutRowType::ConvertBinaryToText( binaryInput, convertedOutput ) != 0 )
+  {
+    std::cerr << "ERROR: the binary output could not be converted." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cerr << "text size: " << textOutput.str().size()
+            << ", binary size: " << binaryOutput.str().size() << std::endl;
+  if( convertedOutput.str() != textOutput.str() )
+  {
+    std::cerr << "ERROR: the converted binary output differs from the text output.\n"
+              << "text:\n" << textOutput.str().substr( 0, 400 ) << "\n"
+              << "converted:\n" << convertedOutput.str().substr( 0, 400 ) << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** The metric values should be stored as the raw doubles. */
+  const double      metricValue = -1.0 / 3.0;
+  const std::string metricBytes( reinterpret_cast< const char * >( &metricValue ), sizeof( metricValue ) );
+  if( binaryOutput.str().find( metricBytes ) == std::string::npos )
+  {
+    std::cerr << "ERROR: the binary output does not contain the metric value at full precision." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** An invalid input should be detected. */
+  std::istringstream invalidInput( "no iteration info" );
+  if( XoutRowType::ConvertBinaryToText( invalidInput, convertedOutput ) == 0 )
+  {
+    std::cerr << "ERROR: an invalid input was not detected." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main